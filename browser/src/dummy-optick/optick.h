@@ -1,11 +1,19 @@
 
-#define OPTICK_EVENT(...)
+// without Optick, the events are recorded by the built-in tracer of the browser
+//   the event names must be string literals
+
+#include "../vts-libbrowser/include/vts-browser/trace.hpp"
+
+#define OPTICK_CONCAT_IMPL(A, B) A##B
+#define OPTICK_CONCAT(A, B) OPTICK_CONCAT_IMPL(A, B)
+
+#define OPTICK_EVENT(...) ::vts::TraceScope OPTICK_CONCAT(vtsTraceScope, __LINE__)(__func__, "" __VA_ARGS__)
 #define OPTICK_CATEGORY(NAME, CATEGORY)
-#define OPTICK_FRAME(NAME)
-#define OPTICK_THREAD(THREAD_NAME)
+#define OPTICK_FRAME(NAME) ::vts::TraceScope OPTICK_CONCAT(vtsTraceScope, __LINE__)(__func__, NAME)
+#define OPTICK_THREAD(THREAD_NAME) ::vts::traceThread(THREAD_NAME)
 #define OPTICK_START_THREAD(THREAD_NAME)
 #define OPTICK_STOP_THREAD()
-#define OPTICK_TAG(NAME, DATA)
+#define OPTICK_TAG(NAME, DATA) ::vts::traceTag(NAME, DATA)
 #define OPTICK_EVENT_DYNAMIC(NAME)
 #define OPTICK_PUSH_DYNAMIC(NAME)
 #define OPTICK_PUSH(NAME)
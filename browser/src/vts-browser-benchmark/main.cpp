@@ -0,0 +1,542 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// headless benchmark
+//   replays a camera path in a hidden window
+//   and writes per-frame timings and final statistics as json
+
+#include <vts-browser/log.hpp>
+#include <vts-browser/map.hpp>
+#include <vts-browser/mapOptions.hpp>
+#include <vts-browser/mapStatistics.hpp>
+#include <vts-browser/camera.hpp>
+#include <vts-browser/cameraOptions.hpp>
+#include <vts-browser/cameraStatistics.hpp>
+#include <vts-browser/navigation.hpp>
+#include <vts-browser/navigationOptions.hpp>
+#include <vts-browser/position.hpp>
+#include <vts-browser/fetcher.hpp>
+#include <vts-browser/boostProgramOptions.hpp>
+#include <vts-renderer/renderer.hpp>
+#include <vts-renderer/highPerformanceGpuHint.h>
+
+#include <json/json.h>
+
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+struct Keyframe
+{
+    double time = 0; // seconds since start of the playback
+    vts::Position position;
+};
+
+struct FrameRecord
+{
+    double time = 0;
+    // cpu time in milliseconds
+    double mapUpdate = 0;
+    double cameraUpdate = 0;
+    double render = 0;
+    double total = 0;
+    // gpu time in milliseconds, lags a few frames behind
+    double gpu = 0;
+    uint32 queueDownload = 0;
+    uint32 queueDecode = 0;
+    uint32 queueUpload = 0;
+    uint32 ramKB = 0;
+    uint32 gpuKB = 0;
+};
+
+struct BenchmarkOptions
+{
+    std::string mapconfig = "https://cdn.melown.com/mario/store/melown2015/map-config/melown/Melown-Earth-Intergeo-2017/mapConfig.json";
+    std::string auth;
+    std::string path;
+    std::string output;
+    uint32 width = 1920;
+    uint32 height = 1080;
+    double fps = 60; // simulated time step of the playback
+    double warmup = 30; // seconds to wait for complete render of the first position
+    double timeout = 60; // seconds to wait for the mapconfig
+};
+
+SDL_Window *window;
+SDL_GLContext renderContext;
+SDL_GLContext dataContext;
+std::shared_ptr<vts::Map> map;
+std::shared_ptr<vts::Camera> cam;
+std::shared_ptr<vts::Navigation> nav;
+std::shared_ptr<vts::renderer::RenderContext> context;
+std::shared_ptr<vts::renderer::RenderView> view;
+std::thread dataThread;
+
+typedef std::chrono::steady_clock Clock;
+
+double millis(Clock::time_point a, Clock::time_point b)
+{
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+void dataEntry()
+{
+    vts::setLogThreadName("data");
+    SDL_GL_MakeCurrent(window, dataContext);
+    vts::renderer::installGlDebugCallback();
+    map->dataAllRun();
+    SDL_GL_DeleteContext(dataContext);
+    dataContext = nullptr;
+}
+
+Json::Value parseJson(const std::string &str, const std::string &what)
+{
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value v;
+    std::string errs;
+    if (!reader->parse(str.data(), str.data() + str.size(), &v, &errs))
+        throw std::runtime_error("Failed to parse " + what + ": " + errs);
+    return v;
+}
+
+std::string writeJson(const Json::Value &v, bool pretty)
+{
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = pretty ? "  " : "";
+    return Json::writeString(builder, v);
+}
+
+// the path is a json array of objects with time and position
+//   the position uses either the url or the json format
+//   eg. { "time": 2.5, "position": "obj,14.4,50.1,fix,300,0,-60,0,2000,45" }
+std::vector<Keyframe> loadPath(const std::string &file)
+{
+    std::ifstream f(file);
+    if (!f)
+        throw std::runtime_error("Failed to open camera path <" + file + ">");
+    std::stringstream ss;
+    ss << f.rdbuf();
+    const Json::Value v = parseJson(ss.str(), "camera path");
+    if (!v.isArray() || v.empty())
+        throw std::runtime_error("Camera path must be a non-empty array");
+    std::vector<Keyframe> r;
+    for (const Json::Value &k : v)
+    {
+        Keyframe kf;
+        kf.time = k["time"].asDouble();
+        const Json::Value &p = k["position"];
+        kf.position = vts::Position(p.isString()
+            ? p.asString() : writeJson(p, false));
+        if (!r.empty() && kf.time < r.back().time)
+            throw std::runtime_error("Camera path must be ordered by time");
+        r.push_back(kf);
+    }
+    return r;
+}
+
+double interpolateAngle(double a, double b, double f)
+{
+    double d = std::fmod(b - a + 540, 360) - 180;
+    return a + d * f;
+}
+
+vts::Position pathPosition(const std::vector<Keyframe> &path, double t,
+    bool projected)
+{
+    auto it = std::upper_bound(path.begin(), path.end(), t,
+        [](double t, const Keyframe &k) { return t < k.time; });
+    if (it == path.begin())
+        return path.front().position;
+    if (it == path.end())
+        return path.back().position;
+    const Keyframe &a = *(it - 1);
+    const Keyframe &b = *it;
+    const double f = (t - a.time) / (b.time - a.time);
+    vts::Position r = a.position;
+    for (int i = 0; i < 3; i++)
+    {
+        r.point[i] = a.position.point[i]
+            + (b.position.point[i] - a.position.point[i]) * f;
+        r.orientation[i] = interpolateAngle(a.position.orientation[i],
+            b.position.orientation[i], f);
+    }
+    if (!projected)
+        r.point[0] = interpolateAngle(a.position.point[0],
+            b.position.point[0], f);
+    // the extent changes exponentially when zooming
+    r.viewExtent = a.position.viewExtent
+        * std::pow(b.position.viewExtent / a.position.viewExtent, f);
+    r.fov = a.position.fov + (b.position.fov - a.position.fov) * f;
+    return r;
+}
+
+void frame(double elapsed, FrameRecord *rec)
+{
+    SDL_Event event;
+    while (SDL_PollEvent(&event))
+    {}
+
+    auto t0 = Clock::now();
+    map->renderUpdate(elapsed);
+    auto t1 = Clock::now();
+    cam->renderUpdate();
+    auto t2 = Clock::now();
+    view->render();
+    auto t3 = Clock::now();
+    SDL_GL_SwapWindow(window);
+
+    if (!rec)
+        return;
+    rec->mapUpdate = millis(t0, t1);
+    rec->cameraUpdate = millis(t1, t2);
+    rec->render = millis(t2, t3);
+    rec->total = millis(t0, t3);
+    rec->gpu = view->statistics().gpuTimeTotal;
+    const vts::MapStatistics &ms = map->statistics();
+    rec->queueDownload = ms.resourcesQueueDownload;
+    rec->queueDecode = ms.resourcesQueueDecode;
+    rec->queueUpload = ms.resourcesQueueUpload;
+    rec->ramKB = ms.currentRamMemUseKB;
+    rec->gpuKB = ms.currentGpuMemUseKB;
+}
+
+Json::Value summary(std::vector<double> v)
+{
+    Json::Value r(Json::objectValue);
+    if (v.empty())
+        return r;
+    std::sort(v.begin(), v.end());
+    double sum = 0;
+    for (double d : v)
+        sum += d;
+    const auto &percentile = [&](double p) {
+        return v[std::min<std::size_t>(v.size() - 1,
+            (std::size_t)(p * v.size()))];
+    };
+    r["mean"] = sum / v.size();
+    r["p50"] = percentile(0.5);
+    r["p95"] = percentile(0.95);
+    r["p99"] = percentile(0.99);
+    r["max"] = v.back();
+    return r;
+}
+
+Json::Value report(const BenchmarkOptions &opts,
+    const std::vector<FrameRecord> &records, double warmupTime,
+    bool warmupComplete)
+{
+    Json::Value r;
+    r["mapconfig"] = opts.mapconfig;
+    r["path"] = opts.path;
+    r["width"] = opts.width;
+    r["height"] = opts.height;
+    r["fps"] = opts.fps;
+    r["warmupTime"] = warmupTime;
+    r["warmupComplete"] = warmupComplete;
+
+    {
+        Json::Value &fs = r["frames"];
+        fs = Json::Value(Json::arrayValue);
+        for (const FrameRecord &f : records)
+        {
+            Json::Value j;
+            j["time"] = f.time;
+            j["mapUpdate"] = f.mapUpdate;
+            j["cameraUpdate"] = f.cameraUpdate;
+            j["render"] = f.render;
+            j["total"] = f.total;
+            j["gpu"] = f.gpu;
+            j["queueDownload"] = f.queueDownload;
+            j["queueDecode"] = f.queueDecode;
+            j["queueUpload"] = f.queueUpload;
+            j["ramKB"] = f.ramKB;
+            j["gpuKB"] = f.gpuKB;
+            fs.append(j);
+        }
+    }
+
+    {
+        Json::Value &s = r["summary"];
+        const auto &column = [&](double FrameRecord::*m) {
+            std::vector<double> v;
+            v.reserve(records.size());
+            for (const FrameRecord &f : records)
+                v.push_back(f.*m);
+            return summary(v);
+        };
+        s["mapUpdate"] = column(&FrameRecord::mapUpdate);
+        s["cameraUpdate"] = column(&FrameRecord::cameraUpdate);
+        s["render"] = column(&FrameRecord::render);
+        s["total"] = column(&FrameRecord::total);
+        s["gpu"] = column(&FrameRecord::gpu);
+    }
+
+    // the statistics include the download timings of all resource types
+    r["mapStatistics"] = parseJson(map->statistics().toJson(), "statistics");
+    r["cameraStatistics"] = parseJson(cam->statistics().toJson(),
+        "statistics");
+    {
+        const vts::renderer::ContextStatistics cs = context->statistics();
+        Json::Value &m = r["memory"];
+        m["ramKB"] = map->statistics().currentRamMemUseKB;
+        m["gpuKB"] = map->statistics().currentGpuMemUseKB;
+        m["uboKB"] = view->statistics().uboMemoryKB;
+        m["gpuCapacityKB"] = cs.gpuMemoryCapacityKB;
+        m["gpuAvailableKB"] = cs.gpuMemoryAvailableKB;
+    }
+    return r;
+}
+
+bool programOptions(BenchmarkOptions &opts,
+    vts::MapCreateOptions &createOptions,
+    vts::MapRuntimeOptions &mapOptions,
+    vts::FetcherOptions &fetcherOptions,
+    vts::CameraOptions &camOptions,
+    vts::NavigationOptions &navOptions,
+    int argc, char *argv[])
+{
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help", "Show this help.")
+        ("path",
+            po::value<std::string>(&opts.path),
+            "Camera path to replay.\n"
+            "Json array of objects with time (seconds) and position."
+        )
+        ("url",
+            po::value<std::string>(&opts.mapconfig)
+            ->default_value(opts.mapconfig),
+            "Mapconfig URL."
+        )
+        ("auth",
+            po::value<std::string>(&opts.auth),
+            "Authentication url."
+        )
+        ("output,o",
+            po::value<std::string>(&opts.output),
+            "Output json file, standard output if empty."
+        )
+        ("width",
+            po::value<uint32>(&opts.width)
+            ->default_value(opts.width),
+            "Render width."
+        )
+        ("height",
+            po::value<uint32>(&opts.height)
+            ->default_value(opts.height),
+            "Render height."
+        )
+        ("fps",
+            po::value<double>(&opts.fps)
+            ->default_value(opts.fps),
+            "Simulated frames per second of the playback.\n"
+            "The frames are rendered as fast as possible."
+        )
+        ("warmup",
+            po::value<double>(&opts.warmup)
+            ->default_value(opts.warmup),
+            "Seconds to wait for complete render of the first position."
+        )
+        ("timeout",
+            po::value<double>(&opts.timeout)
+            ->default_value(opts.timeout),
+            "Seconds to wait for the mapconfig."
+        )
+        ;
+
+    po::positional_options_description popts;
+    popts.add("path", 1);
+
+    vts::optionsConfigLog(desc);
+    vts::optionsConfigMapCreate(desc, &createOptions);
+    vts::optionsConfigMapRuntime(desc, &mapOptions);
+    vts::optionsConfigCamera(desc, &camOptions);
+    vts::optionsConfigNavigation(desc, &navOptions);
+    vts::optionsConfigFetcherOptions(desc, &fetcherOptions);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(popts).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help") || opts.path.empty())
+    {
+        std::cout << "Usage: " << argv[0] << " [options] [--]"
+            << " <path>" << std::endl << desc << std::endl;
+        return false;
+    }
+    if (opts.fps <= 0 || opts.width == 0 || opts.height == 0)
+        throw std::runtime_error("Invalid fps or resolution");
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions opts;
+    vts::MapCreateOptions createOptions;
+    vts::MapRuntimeOptions mapOptions;
+    vts::FetcherOptions fetcherOptions;
+    vts::CameraOptions camOptions;
+    vts::NavigationOptions navOptions;
+    // identical positions in every run
+    navOptions.type = vts::NavigationType::Instant;
+    createOptions.clientId = "vts-browser-benchmark";
+    if (!programOptions(opts, createOptions, mapOptions, fetcherOptions,
+        camOptions, navOptions, argc, argv))
+        return 0;
+    const std::vector<Keyframe> path = loadPath(opts.path);
+
+    // initialize SDL with hidden window
+    vts::log(vts::LogLevel::info3, "Initializing SDL library");
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0)
+    {
+        vts::log(vts::LogLevel::err4, SDL_GetError());
+        throw std::runtime_error("Failed to initialize SDL");
+    }
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 0);
+    SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 0);
+    SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 0);
+    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    window = SDL_CreateWindow("vts-browser-benchmark",
+        SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+        opts.width, opts.height, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (!window)
+    {
+        vts::log(vts::LogLevel::err4, SDL_GetError());
+        throw std::runtime_error("Failed to create window");
+    }
+    dataContext = SDL_GL_CreateContext(window);
+    renderContext = SDL_GL_CreateContext(window);
+    SDL_GL_SetSwapInterval(0); // no v-sync
+    vts::renderer::loadGlFunctions(&SDL_GL_GetProcAddress);
+
+    context = std::make_shared<vts::renderer::RenderContext>();
+    map = std::make_shared<vts::Map>(createOptions,
+        vts::Fetcher::create(fetcherOptions));
+    map->options() = mapOptions;
+    context->bindLoadFunctions(map.get());
+    dataThread = std::thread(&dataEntry);
+    cam = map->createCamera();
+    cam->options() = camOptions;
+    nav = cam->createNavigation();
+    nav->options() = navOptions;
+    view = context->createView(cam.get());
+    view->options().width = opts.width;
+    view->options().height = opts.height;
+    cam->setViewportSize(opts.width, opts.height);
+    map->setMapconfigPath(opts.mapconfig, opts.auth);
+
+    const double step = 1 / opts.fps;
+    std::vector<FrameRecord> records;
+    double warmupTime = 0;
+    bool warmupComplete = false;
+    {
+        // wait for the mapconfig
+        const auto start = Clock::now();
+        while (!map->getMapconfigReady())
+        {
+            if (millis(start, Clock::now()) > opts.timeout * 1000)
+                throw std::runtime_error("Timeout waiting for the mapconfig");
+            frame(step, nullptr);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        // resources of the first position are loaded before the playback
+        //   so that the playback starts from the same state
+        nav->setPosition(path.front().position);
+        const auto warm = Clock::now();
+        while (millis(warm, Clock::now()) < opts.warmup * 1000)
+        {
+            frame(step, nullptr);
+            if (map->getMapRenderComplete())
+            {
+                warmupComplete = true;
+                break;
+            }
+        }
+        warmupTime = millis(warm, Clock::now()) * 1e-3;
+
+        // playback in simulated time
+        const bool projected = map->getMapProjected();
+        const double duration = path.back().time - path.front().time;
+        const uint32 count = (uint32)std::ceil(duration * opts.fps) + 1;
+        records.reserve(count);
+        for (uint32 i = 0; i < count; i++)
+        {
+            FrameRecord rec;
+            rec.time = std::min(i * step, duration);
+            nav->setPosition(pathPosition(path,
+                path.front().time + rec.time, projected));
+            frame(step, &rec);
+            records.push_back(rec);
+        }
+    }
+
+    const std::string out = writeJson(report(opts, records,
+        warmupTime, warmupComplete), true);
+    if (opts.output.empty())
+        std::cout << out << std::endl;
+    else
+    {
+        std::ofstream f(opts.output);
+        f << out << std::endl;
+        if (!f)
+            throw std::runtime_error("Failed to write <" + opts.output + ">");
+    }
+
+    // release all
+    nav.reset();
+    cam.reset();
+    view.reset();
+    map->renderFinalize();
+    dataThread.join();
+    map.reset();
+    context.reset();
+    SDL_GL_DeleteContext(renderContext);
+    renderContext = nullptr;
+    SDL_DestroyWindow(window);
+    window = nullptr;
+    return 0;
+}
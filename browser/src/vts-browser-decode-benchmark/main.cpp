@@ -0,0 +1,562 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// decoders micro-benchmark
+//   decodes a corpus of captured resources repeatedly
+//   and writes throughput and allocation counts as json
+// the corpus directory contains one subdirectory per resource type
+//   named after FetchTask::ResourceType, eg. Mesh, MetaTile, Texture
+//   metatiles require a Mapconfig, geodata tiles use the first GeodataStylesheet
+
+#include <vts-browser/log.hpp>
+#include <vts-browser/mapOptions.hpp>
+#include <vts-browser/fetcher.hpp>
+#include <vts-browser/boostProgramOptions.hpp>
+
+#include "vts-libbrowser/map.hpp"
+#include "vts-libbrowser/resources.hpp"
+#include "vts-libbrowser/fetchTask.hpp"
+#include "vts-libbrowser/gpuResource.hpp"
+#include "vts-libbrowser/metaTile.hpp"
+#include "vts-libbrowser/mapConfig.hpp"
+#include "vts-libbrowser/geodata.hpp"
+#include "vts-libbrowser/image/image.hpp"
+
+#include <json/json.h>
+#include <boost/filesystem.hpp>
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+// every allocation made by the decoders goes through here
+std::atomic<uint64> allocations{ 0 };
+std::atomic<uint64> allocatedBytes{ 0 };
+
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    allocations++;
+    allocatedBytes += size;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+
+using vts::FetchTask;
+
+struct BenchmarkOptions
+{
+    std::string corpus;
+    std::string output;
+    uint32 iterations = 10; // decodes of each sample
+    uint32 threads = std::max(std::thread::hardware_concurrency(), 1u);
+};
+
+struct Sample
+{
+    std::string name;
+    std::shared_ptr<vts::Buffer> content;
+    // prepared inputs of geodata tiles
+    std::shared_ptr<const std::string> features;
+    std::shared_ptr<const vts::GeodataParsedFeatures> parsed;
+
+    // a view of the content, nothing is copied
+    vts::Buffer view() const
+    {
+        return vts::Buffer(content, content->data(), content->size());
+    }
+};
+
+struct Suite
+{
+    std::string name;
+    std::vector<Sample> samples;
+    std::function<void(const Sample &)> decode;
+};
+
+struct Measurement
+{
+    double seconds = 0;
+    uint64 decodes = 0;
+    uint64 bytes = 0;
+    uint64 allocations = 0;
+    uint64 allocatedBytes = 0;
+};
+
+const char *const ResourceTypeNames[] = {
+    "Undefined",
+    "Mapconfig",
+    "AuthConfig",
+    "BoundLayerConfig",
+    "FreeLayerConfig",
+    "TilesetMappingConfig",
+    "BoundMetaTile",
+    "MetaTile",
+    "Mesh",
+    "Texture",
+    "NavTile",
+    "Search",
+    "SriIndex",
+    "GeodataFeatures",
+    "GeodataStylesheet",
+    "Font",
+};
+
+typedef std::chrono::steady_clock Clock;
+
+std::map<FetchTask::ResourceType, std::vector<Sample>> loadCorpus(
+    const std::string &dir)
+{
+    namespace fs = boost::filesystem;
+    if (!fs::is_directory(dir))
+        throw std::runtime_error("Corpus <" + dir + "> is not a directory");
+    std::map<FetchTask::ResourceType, std::vector<Sample>> r;
+    for (uint32 t = 0; t < sizeof(ResourceTypeNames)
+        / sizeof(ResourceTypeNames[0]); t++)
+    {
+        const fs::path sub = fs::path(dir) / ResourceTypeNames[t];
+        if (!fs::is_directory(sub))
+            continue;
+        std::vector<std::string> files;
+        for (fs::recursive_directory_iterator it(sub), e; it != e; it++)
+            if (fs::is_regular_file(it->path()))
+                files.push_back(it->path().string());
+        std::sort(files.begin(), files.end()); // deterministic order
+        auto &v = r[(FetchTask::ResourceType)t];
+        for (const std::string &f : files)
+        {
+            Sample s;
+            s.name = f;
+            s.content = std::make_shared<vts::Buffer>(
+                vts::readLocalFileBuffer(f));
+            v.push_back(std::move(s));
+        }
+    }
+    return r;
+}
+
+// decodes the resource the same way the decode queue does
+template<class T>
+std::shared_ptr<T> decodeResource(vts::MapImpl *map, const Sample &s)
+{
+    std::shared_ptr<T> r = std::make_shared<T>(map, s.name);
+    r->fetch = std::make_shared<vts::FetchTaskImpl>(r);
+    r->fetch->reply.content = s.view();
+    r->decode();
+    return r;
+}
+
+bool isPng(const vts::Buffer &b)
+{
+    static const unsigned char signature[] = { 0x89, 'P', 'N', 'G' };
+    return b.size() >= 4 && std::equal(signature, signature + 4,
+        (const unsigned char *)b.data());
+}
+
+// samples are claimed by the threads in turns until all iterations are done
+Measurement measure(const Suite &suite, uint32 iterations, uint32 threads)
+{
+    const uint64 total = (uint64)suite.samples.size() * iterations;
+    std::atomic<uint64> next{ 0 };
+    const auto &work = [&]() {
+        while (true)
+        {
+            const uint64 i = next++;
+            if (i >= total)
+                return;
+            suite.decode(suite.samples[i % suite.samples.size()]);
+        }
+    };
+
+    Measurement m;
+    const uint64 a = allocations;
+    const uint64 ab = allocatedBytes;
+    const auto start = Clock::now();
+    {
+        std::vector<std::thread> thrs;
+        thrs.reserve(threads - 1);
+        for (uint32 i = 1; i < threads; i++)
+            thrs.emplace_back(work);
+        work();
+        for (auto &t : thrs)
+            t.join();
+    }
+    m.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    m.allocations = allocations - a;
+    m.allocatedBytes = allocatedBytes - ab;
+    m.decodes = total;
+    for (const Sample &s : suite.samples)
+        m.bytes += s.content->size();
+    m.bytes *= iterations;
+    return m;
+}
+
+Json::Value toJson(const Measurement &m, uint32 threads)
+{
+    Json::Value r;
+    r["threads"] = threads;
+    r["seconds"] = m.seconds;
+    r["decodes"] = (Json::UInt64)m.decodes;
+    r["bytes"] = (Json::UInt64)m.bytes;
+    r["MBps"] = m.seconds > 0 ? m.bytes / m.seconds * 1e-6 : 0.0;
+    r["tilesps"] = m.seconds > 0 ? m.decodes / m.seconds : 0.0;
+    r["allocationsPerDecode"] = m.decodes
+        ? (double)m.allocations / m.decodes : 0.0;
+    r["allocatedBytesPerDecode"] = m.decodes
+        ? (double)m.allocatedBytes / m.decodes : 0.0;
+    return r;
+}
+
+std::string writeJson(const Json::Value &v, bool pretty)
+{
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = pretty ? "  " : "";
+    return Json::writeString(builder, v);
+}
+
+// samples that fail to decode are excluded from the measurements
+void validate(Suite &suite)
+{
+    std::vector<Sample> ok;
+    ok.reserve(suite.samples.size());
+    for (Sample &s : suite.samples)
+    {
+        try
+        {
+            suite.decode(s);
+            ok.push_back(std::move(s));
+        }
+        catch (const std::exception &e)
+        {
+            vts::log(vts::LogLevel::warn3, "Skipping <" + s.name
+                + "> in <" + suite.name + ">, with error <" + e.what() + ">");
+        }
+    }
+    suite.samples.swap(ok);
+}
+
+bool programOptions(BenchmarkOptions &opts,
+    vts::MapCreateOptions &createOptions,
+    vts::MapRuntimeOptions &mapOptions,
+    int argc, char *argv[])
+{
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help", "Show this help.")
+        ("corpus",
+            po::value<std::string>(&opts.corpus),
+            "Directory with captured resources.\n"
+            "Contains subdirectories named after the resource types."
+        )
+        ("output,o",
+            po::value<std::string>(&opts.output),
+            "Output json file, standard output if empty."
+        )
+        ("iterations",
+            po::value<uint32>(&opts.iterations)
+            ->default_value(opts.iterations),
+            "Number of decodes of each sample."
+        )
+        ("threads",
+            po::value<uint32>(&opts.threads)
+            ->default_value(opts.threads),
+            "Number of threads for the multi-threaded measurement."
+        )
+        ;
+
+    po::positional_options_description popts;
+    popts.add("corpus", 1);
+
+    vts::optionsConfigLog(desc);
+    vts::optionsConfigMapCreate(desc, &createOptions);
+    vts::optionsConfigMapRuntime(desc, &mapOptions);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(popts).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help") || opts.corpus.empty())
+    {
+        std::cout << "Usage: " << argv[0] << " [options] [--]"
+            << " <corpus>" << std::endl << desc << std::endl;
+        return false;
+    }
+    if (opts.iterations == 0 || opts.threads == 0)
+        throw std::runtime_error("Invalid iterations or threads");
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions opts;
+    vts::MapCreateOptions createOptions;
+    vts::MapRuntimeOptions mapOptions;
+    createOptions.clientId = "vts-browser-decode-benchmark";
+    createOptions.diskCache = false;
+    if (!programOptions(opts, createOptions, mapOptions, argc, argv))
+        return 0;
+    // every decode must do the full work
+    mapOptions.cacheGeodataLayers = false;
+    mapOptions.debugExtractRawResources = false;
+    mapOptions.progressiveTextures = false;
+
+    auto corpus = loadCorpus(opts.corpus);
+
+    // the decoders need a map, but nothing is downloaded
+    auto map = std::make_shared<vts::MapImpl>(nullptr, createOptions,
+        vts::Fetcher::create(vts::FetcherOptions()));
+    map->options = mapOptions;
+    vts::MapImpl *const m = map.get();
+
+    // metatiles are decoded against the mapconfig
+    std::shared_ptr<const Json::Value> browserOptions
+        = std::make_shared<const Json::Value>(Json::objectValue);
+    if (!corpus[FetchTask::ResourceType::Mapconfig].empty())
+    {
+        const Sample &s = corpus[FetchTask::ResourceType::Mapconfig][0];
+        map->mapconfigPath = s.name;
+        map->mapconfig = decodeResource<vts::Mapconfig>(m, s);
+        browserOptions = map->mapconfig->browserOptions.value;
+    }
+
+    // geodata tiles are processed with the first stylesheet
+    std::shared_ptr<vts::GeodataStylesheet> style;
+    if (!corpus[FetchTask::ResourceType::GeodataStylesheet].empty())
+    {
+        style = decodeResource<vts::GeodataStylesheet>(m,
+            corpus[FetchTask::ResourceType::GeodataStylesheet][0]);
+        if (style->dependencies() == vts::Validity::Invalid)
+            style.reset();
+    }
+
+    std::vector<Suite> suites;
+    {
+        Suite jpeg, png;
+        jpeg.name = "jpeg";
+        png.name = "png";
+        for (Sample &s : corpus[FetchTask::ResourceType::Texture])
+        {
+            if (vts::isJpeg(*s.content))
+                jpeg.samples.push_back(s);
+            else if (isPng(*s.content))
+                png.samples.push_back(s);
+        }
+        jpeg.decode = [](const Sample &s) {
+            vts::Buffer out;
+            uint32 w, h, c;
+            vts::decodeJpeg(*s.content, out, w, h, c, true);
+        };
+        png.decode = [](const Sample &s) {
+            vts::Buffer out;
+            uint32 w, h, c;
+            vts::decodePng(*s.content, out, w, h, c, true);
+        };
+        suites.push_back(std::move(jpeg));
+        suites.push_back(std::move(png));
+    }
+    {
+        // includes the conversion to gpu meshes
+        Suite suite;
+        suite.name = "meshAggregate";
+        suite.samples = corpus[FetchTask::ResourceType::Mesh];
+        suite.decode = [m](const Sample &s) {
+            decodeResource<vts::MeshAggregate>(m, s);
+        };
+        suites.push_back(std::move(suite));
+    }
+    if (map->mapconfig)
+    {
+        Suite suite;
+        suite.name = "metaTile";
+        suite.samples = corpus[FetchTask::ResourceType::MetaTile];
+        suite.decode = [m](const Sample &s) {
+            decodeResource<vts::MetaTile>(m, s);
+        };
+        suites.push_back(std::move(suite));
+    }
+    else if (!corpus[FetchTask::ResourceType::MetaTile].empty())
+        vts::log(vts::LogLevel::warn3, "Metatiles require a mapconfig");
+    {
+        Suite suite;
+        suite.name = "geodataStylesheet";
+        suite.samples = corpus[FetchTask::ResourceType::GeodataStylesheet];
+        suite.decode = [m](const Sample &s) {
+            auto r = decodeResource<vts::GeodataStylesheet>(m, s);
+            r->compiled = vts::compileGeodataStyle(r->data);
+        };
+        suites.push_back(std::move(suite));
+    }
+    {
+        // includes parsing, if cacheParsedGeodataFeatures is enabled
+        Suite suite;
+        suite.name = "geodataFeatures";
+        suite.samples = corpus[FetchTask::ResourceType::GeodataFeatures];
+        suite.decode = [m](const Sample &s) {
+            decodeResource<vts::GeodataFeatures>(m, s);
+        };
+        suites.push_back(std::move(suite));
+    }
+    {
+        // the same features converted to the binary encoding
+        Suite suite;
+        suite.name = "geodataFeaturesBinary";
+        for (Sample &f : corpus[FetchTask::ResourceType::GeodataFeatures])
+        {
+            Sample t = f;
+            try
+            {
+                t.content = std::make_shared<vts::Buffer>(
+                    vts::encodeGeodataBinary(f.content->str()));
+            }
+            catch (...)
+            {
+                continue; // not quantized or invalid
+            }
+            suite.samples.push_back(std::move(t));
+        }
+        suite.decode = [m](const Sample &s) {
+            decodeResource<vts::GeodataFeatures>(m, s);
+        };
+        suites.push_back(std::move(suite));
+    }
+    if (style)
+    {
+        // the features are parsed beforehand
+        //   as they would be shared from the features resource
+        Suite suite;
+        suite.name = "geodataTile";
+        for (Sample &f : corpus[FetchTask::ResourceType::GeodataFeatures])
+        {
+            Sample t = f;
+            t.features = std::make_shared<const std::string>(
+                f.content->str());
+            if (mapOptions.cacheParsedGeodataFeatures)
+            {
+                try
+                {
+                    uint64 memory = 0;
+                    t.parsed = vts::parseGeodataFeatures(*t.features, memory);
+                }
+                catch (...)
+                {
+                    // left for the tile to report
+                }
+            }
+            suite.samples.push_back(std::move(t));
+        }
+        suite.decode = [m, style, browserOptions](const Sample &s) {
+            auto r = std::make_shared<vts::GeodataTile>(m, s.name);
+            r->style = style;
+            r->features = s.features;
+            r->parsedFeatures = s.parsed;
+            r->browserOptions = browserOptions;
+            r->aabbPhys[0] = -vts::inf3(); // no culling
+            r->aabbPhys[1] = vts::inf3();
+            r->tileId = vts::TileId();
+            r->texelSize = vts::inf1(); // no simplification
+            r->state = vts::Resource::State::decodeQueue;
+            r->decode();
+        };
+        suites.push_back(std::move(suite));
+    }
+    else if (!corpus[FetchTask::ResourceType::GeodataFeatures].empty())
+        vts::log(vts::LogLevel::warn3, "Geodata tiles require a stylesheet");
+    {
+        Suite suite;
+        suite.name = "font";
+        suite.samples = corpus[FetchTask::ResourceType::Font];
+        suite.decode = [m](const Sample &s) {
+            decodeResource<vts::GpuFont>(m, s);
+        };
+        suites.push_back(std::move(suite));
+    }
+
+    Json::Value report;
+    report["corpus"] = opts.corpus;
+    report["iterations"] = opts.iterations;
+    for (Suite &s : suites)
+    {
+        validate(s);
+        if (s.samples.empty())
+            continue;
+        vts::log(vts::LogLevel::info3, "Measuring <" + s.name + ">");
+        Json::Value &r = report["decoders"][s.name];
+        r["samples"] = (Json::UInt64)s.samples.size();
+        r["single"] = toJson(measure(s, opts.iterations, 1), 1);
+        if (opts.threads > 1)
+            r["multi"] = toJson(measure(s, opts.iterations, opts.threads),
+                opts.threads);
+    }
+
+    const std::string out = writeJson(report, true);
+    if (opts.output.empty())
+        std::cout << out << std::endl;
+    else
+    {
+        std::ofstream f(opts.output);
+        f << out << std::endl;
+        if (!f)
+            throw std::runtime_error("Failed to write <" + opts.output + ">");
+    }
+
+    // release all
+    //   all resources must be gone before the map finalizes
+    suites.clear();
+    corpus.clear();
+    style.reset();
+    map->resources->renderFinalize();
+    map->resources->dataFinalize();
+    map.reset();
+    return 0;
+}
@@ -26,6 +26,7 @@
 
 #include <cstring>
 #include <set>
+#include <algorithm>
 
 #include <vts-browser/enumNames.hpp>
 #include <vts-browser/mapStatistics.hpp>
@@ -35,6 +36,7 @@
 #include <vts-browser/search.hpp>
 #include <vts-browser/celestial.hpp>
 #include <vts-browser/position.hpp>
+#include <vts-browser/trace.hpp>
 
 #include "mainWindow.hpp"
 #include "guiSkin.hpp"
@@ -60,6 +62,7 @@ constexpr const nk_rune FontUnicodeRanges[] = {
 };
 
 constexpr const char *ControlOptionsPath = "vts-browser-desktop.control-options.json";
+constexpr const char *TracePath = "vts-browser-desktop.trace.json";
 
 constexpr const char *LodBlendingModeNames[] = {
     "off",
@@ -74,6 +77,73 @@ constexpr const char *GeodataDebugNames[] = {
     "glyphs",
 };
 
+// indexed by FetchTask::ResourceType
+constexpr const char *ResourceTypeNames[] = {
+    "Undefined",
+    "Mapconfig",
+    "Auth config",
+    "Bound layer config",
+    "Free layer config",
+    "Tileset mapping",
+    "Bound meta tile",
+    "Meta tile",
+    "Mesh",
+    "Texture",
+    "Nav tile",
+    "Search",
+    "Sri index",
+    "Geodata features",
+    "Geodata stylesheet",
+    "Font",
+};
+
+const struct nk_color GraphColors[] = {
+    { 230, 80, 80, 255 },
+    { 80, 200, 80, 255 },
+    { 90, 140, 240, 255 },
+    { 230, 200, 60, 255 },
+    { 200, 90, 220, 255 },
+    { 70, 210, 210, 255 },
+    { 240, 140, 50, 255 },
+    { 200, 200, 200, 255 },
+};
+
+// rolling history of a value shown in the performance graphs
+struct History
+{
+    static constexpr uint32 Samples = 240;
+    float values[Samples] = {};
+    uint32 next = 0;
+
+    void add(float v)
+    {
+        values[next] = v;
+        next = (next + 1) % Samples;
+    }
+
+    // i-th oldest sample
+    float operator [] (uint32 i) const
+    {
+        return values[(next + i) % Samples];
+    }
+
+    float last() const
+    {
+        return values[(next + Samples - 1) % Samples];
+    }
+
+    float max() const
+    {
+        return *std::max_element(values, values + Samples);
+    }
+};
+
+struct GraphSeries
+{
+    std::string name;
+    const History *history;
+};
+
 constexpr const char *FpsSlowdownNames[] = {
     "off",
     "on",
@@ -540,8 +610,23 @@ public:
                     sprintf(buffer, "%3.1f", c.targetPixelRatioGeodata);
                     nk_label(&ctx, buffer, NK_TEXT_RIGHT);
 
+                    // priority model
+                    nk_label(&ctx, "Priority:", NK_TEXT_LEFT);
+                    if (nk_combo_begin_label(&ctx, PriorityModelNames[(int)c.priorityModel], nk_vec2(nk_widget_width(&ctx), 200)))
+                    {
+                        nk_layout_row_dynamic(&ctx, 16, 1);
+                        for (unsigned i = 0; i < sizeof(PriorityModelNames) / sizeof(PriorityModelNames[0]); i++)
+                        {
+                            if (nk_combo_item_label(&ctx, PriorityModelNames[i], NK_TEXT_LEFT))
+                                c.priorityModel = (PriorityModel)i;
+                        }
+                        nk_combo_end(&ctx);
+                    }
+                    nk_label(&ctx, "", NK_TEXT_RIGHT);
+
                     // balanced grids
-                    if (c.traverseModeSurfaces == TraverseMode::Balanced || c.traverseModeGeodata == TraverseMode::Balanced)
+                    if (c.traverseModeSurfaces == TraverseMode::Balanced || c.traverseModeGeodata == TraverseMode::Balanced
+                        || c.traverseModeSurfaces == TraverseMode::Coherent || c.traverseModeGeodata == TraverseMode::Coherent)
                     {
                         // balancedGridLodOffset
                         nk_label(&ctx, "Grid offset:", NK_TEXT_LEFT);
@@ -606,6 +691,11 @@ public:
                     sprintf(buffer, "%3.1f", c.cullingOffsetDistance);
                     nk_label(&ctx, buffer, NK_TEXT_RIGHT);
 
+                    // occlusionCulling
+                    nk_label(&ctx, "Occlusion:", NK_TEXT_LEFT);
+                    c.occlusionCulling = nk_check_label(&ctx, "", c.occlusionCulling);
+                    nk_label(&ctx, "", NK_TEXT_RIGHT);
+
                     // antialiasing samples
                     nk_label(&ctx, "Antialiasing:", NK_TEXT_LEFT);
                     r.antialiasingSamples = nk_slide_int(&ctx, 1, r.antialiasingSamples, 16, 1);
@@ -617,6 +707,31 @@ public:
                     else
                         nk_label(&ctx, "no", NK_TEXT_RIGHT);
 
+                    // dynamic resolution
+                    nk_label(&ctx, "Gpu budget:", NK_TEXT_LEFT);
+                    r.dynamicResolutionBudget = nk_slide_float(&ctx, 0, r.dynamicResolutionBudget, 50, 1);
+                    if (r.dynamicResolutionBudget > 0)
+                    {
+                        sprintf(buffer, "%2.0f ms", r.dynamicResolutionBudget);
+                        nk_label(&ctx, buffer, NK_TEXT_RIGHT);
+                    }
+                    else
+                        nk_label(&ctx, "no", NK_TEXT_RIGHT);
+
+                    // background downscale
+                    nk_label(&ctx, "Background res.:", NK_TEXT_LEFT);
+                    r.backgroundDownscale = nk_slide_int(&ctx, 1, r.backgroundDownscale, 4, 1);
+                    sprintf(buffer, "1/%d", r.backgroundDownscale);
+                    nk_label(&ctx, buffer, NK_TEXT_RIGHT);
+
+                    // pipelined render
+                    {
+                        bool &p = window->appOptions.pipelinedRender;
+                        nk_label(&ctx, "Pipelined:", NK_TEXT_LEFT);
+                        p = nk_check_label(&ctx, "", p);
+                        nk_label(&ctx, "", NK_TEXT_RIGHT);
+                    }
+
                     // maxResourcesMemory
                     nk_label(&ctx, "Target memory:", NK_TEXT_LEFT);
                     mr.targetResourcesMemoryKB = 1024 * nk_slide_int(&ctx, 0, mr.targetResourcesMemoryKB / 1024, 8192, 128);
@@ -645,6 +760,9 @@ public:
                 // render atmosphere
                 r.renderAtmosphere = nk_check_label(&ctx, "Atmosphere", r.renderAtmosphere);
 
+                // reverse depth
+                r.reverseDepth = nk_check_label(&ctx, "Reverse depth", r.reverseDepth);
+
                 // render mesh boxes
                 c.debugRenderMeshBoxes = nk_check_label(&ctx, "Mesh boxes", c.debugRenderMeshBoxes);
 
@@ -871,10 +989,20 @@ public:
 
                 S("GPU memory:", ms.currentGpuMemUseKB / 1024, " MB");
                 S("RAM memory:", ms.currentRamMemUseKB / 1024, " MB");
+                S("Buffer pool:", ms.bufferPoolRetainedKB / 1024, " MB");
+                {
+                    const uint64 total = ms.bufferPoolHits + ms.bufferPoolMisses;
+                    S("Pool hit rate:", uint32(total ? 100 * ms.bufferPoolHits / total : 0), " %");
+                }
                 S("Node meta updates:", cs.currentNodeMetaUpdates, "");
                 S("Node draw updates:", cs.currentNodeDrawsUpdates, "");
+                S("Node draws waiting:", cs.currentNodeDrawsWaiting, "");
+                S("Nodes cleared:", ms.traverseNodesCleared, "");
+                S("Nodes existing:", ms.currentTraverseNodes, "");
                 S("Preparing:", ms.resourcesPreparing, "");
                 S("Downloading:", ms.resourcesDownloading, "");
+                S("Window:", ms.downloadsWindow, "");
+                S("Blocked hosts:", ms.downloadsBlockedHosts, "");
                 S("Accessing:", ms.resourcesAccessed, "");
 
                 if (nk_tree_push(&ctx, NK_TREE_TAB, "Queues", NK_MINIMIZED))
@@ -887,6 +1015,8 @@ public:
                     S("Downloads:", ms.resourcesQueueDownload, "");
                     S("Decode:", ms.resourcesQueueDecode, "");
                     S("Gpu:", ms.resourcesQueueUpload, "");
+                    S("Reprioritized:", ms.resourcesQueueReprioritized, "");
+                    S("Contentions:", ms.resourcesQueueContentions, "");
 
                     nk_tree_pop(&ctx);
                 }
@@ -900,11 +1030,20 @@ public:
                     S("Active:", ms.resourcesActive, "");
                     S("Downloaded:", ms.resourcesDownloaded, "");
                     S("Disk loaded:", ms.resourcesDiskLoaded, "");
+                    S("Cache skipped:", ms.resourcesCacheSkipped, "");
+                    S("Revalidated:", ms.resourcesRevalidated, "");
                     S("Decoded:", ms.resourcesDecoded, "");
                     S("Uploaded:", ms.resourcesUploaded, "");
+                    S("Uploads deferred:", ms.resourcesUploadsDeferred, "");
+                    S("Upgraded:", ms.resourcesUpgraded, "");
                     S("Created:", ms.resourcesCreated, "");
                     S("Released:", ms.resourcesReleased, "");
+                    S("Cancelled:", ms.resourcesCancelled, "");
+                    S("Shed:", ms.resourcesShed, "");
                     S("Failed:", ms.resourcesFailed, "");
+                    S("Meshes optimized:", ms.meshesOptimized, "");
+                    S("ACMR before:", ms.meshesAcmrBefore, "");
+                    S("ACMR after:", ms.meshesAcmrAfter, "");
 
                     nk_tree_pop(&ctx);
                 }
@@ -928,6 +1067,12 @@ public:
 
                 S("Total:", cs.metaNodesTraversedTotal, "");
                 S("Grid nodes:", cs.currentGridNodes, "");
+                S("Prefetch nodes:", cs.currentPrefetchNodes, "");
+                S("Occluded:", cs.nodesOccludedTotal, "");
+                S("Beyond horizon:", cs.nodesBeyondHorizonTotal, "");
+                S("Over budget:", cs.nodesSkippedByBudget, "");
+                S("Merged:", cs.nodesMergedTotal, "");
+                S("Blending snapped:", cs.nodesBlendingSnapped, "");
 
                 nk_tree_pop(&ctx);
             }
@@ -964,6 +1109,36 @@ public:
 
                 nk_tree_pop(&ctx);
             }
+
+            // renderer
+            if (nk_tree_push(&ctx, NK_TREE_TAB, "Renderer", NK_MINIMIZED))
+            {
+                const float ratio[] = { width * 0.5f, width * 0.5f };
+                nk_layout_row(&ctx, NK_STATIC, 16, 2, ratio);
+
+                const ContextStatistics rs = window->context.statistics();
+                const uint64 lookups = rs.shapedTextsCacheHits + rs.shapedTextsCacheMisses;
+                S("Shaped texts:", rs.shapedTextsCacheEntries, "");
+                S("Shaping hits:", lookups ? 100 * rs.shapedTextsCacheHits / lookups : 0, " %");
+                S("Gpu capacity:", rs.gpuMemoryCapacityKB / 1024, " MB");
+                S("Gpu available:", rs.gpuMemoryAvailableKB / 1024, " MB");
+
+                const RenderStatistics &vs = window->view->statistics();
+                S("Gpu opaque:", uint32(vs.gpuTimeOpaque * 1000), " us");
+                S("Gpu background:", uint32(vs.gpuTimeBackground * 1000), " us");
+                S("Gpu transparent:", uint32(vs.gpuTimeTransparent * 1000), " us");
+                S("Gpu wireframe:", uint32(vs.gpuTimeWireframe * 1000), " us");
+                S("Gpu depth copy:", uint32(vs.gpuTimeDepthCopy * 1000), " us");
+                S("Gpu geodata:", uint32(vs.gpuTimeGeodata * 1000), " us");
+                S("Gpu finalize:", uint32(vs.gpuTimeFinalize * 1000), " us");
+                S("Gpu total:", uint32(vs.gpuTimeTotal * 1000), " us");
+                S("Resolution scale:", uint32(vs.resolutionScale * 100), " %");
+                S("Ubo memory:", vs.uboMemoryKB, " KB");
+                S("Geodata jobs:", vs.geodataJobs, "");
+                S("Hysteresis jobs:", vs.geodataHysteresisJobs, "");
+
+                nk_tree_pop(&ctx);
+            }
         }
 
         // end window
@@ -1717,10 +1892,146 @@ public:
         nk_end(&ctx);
     }
 
+    // multiple series in one chart, scaled to the largest value
+    void graph(const std::vector<GraphSeries> &series, const char *unit, float width)
+    {
+        const uint32 colors = sizeof(GraphColors) / sizeof(GraphColors[0]);
+        float top = 1;
+        for (const GraphSeries &s : series)
+            top = std::max(top, s.history->max());
+
+        nk_layout_row_dynamic(&ctx, 80, 1);
+        if (nk_chart_begin_colored(&ctx, NK_CHART_LINES, GraphColors[0], GraphColors[0], History::Samples, 0, top))
+        {
+            for (uint32 j = 1; j < series.size(); j++)
+                nk_chart_add_slot_colored(&ctx, NK_CHART_LINES, GraphColors[j % colors], GraphColors[j % colors], History::Samples, 0, top);
+            for (uint32 i = 0; i < History::Samples; i++)
+                for (uint32 j = 0; j < series.size(); j++)
+                    nk_chart_push_slot(&ctx, (*series[j].history)[i], j);
+            nk_chart_end(&ctx);
+        }
+
+        // legend with the latest values
+        const float ratio[] = { width * 0.6f, width * 0.4f };
+        nk_layout_row(&ctx, NK_STATIC, 16, 2, ratio);
+        for (uint32 j = 0; j < series.size(); j++)
+        {
+            nk_label_colored(&ctx, series[j].name.c_str(), NK_TEXT_LEFT, GraphColors[j % colors]);
+            std::ostringstream ss;
+            ss.precision(3);
+            ss << series[j].history->last() << unit;
+            nk_label(&ctx, ss.str().c_str(), NK_TEXT_RIGHT);
+        }
+    }
+
+    void preparePerformance()
+    {
+        MapStatistics &ms = window->map->statistics();
+        CameraStatistics &cs = window->camera->statistics();
+        const RenderStatistics &vs = window->view->statistics();
+
+        // the history is collected even while the window is minimized
+        histMapUpdate.add(std::max(0.f, float(window->timingMapProcess * 1000 - cs.timeUpdate)));
+        histTraversal.add(cs.timeTraversal);
+        histBlending.add(cs.timeBlending);
+        histSorting.add(cs.timeSorting);
+        histPrefetch.add(cs.timePrefetch);
+        histGpu.add(vs.gpuTimeTotal);
+        histFrame.add(window->timingTotalFrame * 1000);
+        histUpload.add(ms.dataUploadTime);
+        histQueueDecode.add(ms.resourcesQueueDecode);
+        histQueueDownload.add(ms.resourcesQueueDownload);
+        histQueueUpload.add(ms.resourcesQueueUpload);
+        if (histLayers.size() < cs.timeLayers.size())
+            histLayers.resize(cs.timeLayers.size());
+        for (uint32 i = 0; i < histLayers.size(); i++)
+            histLayers[i].add(i < cs.timeLayers.size() ? cs.timeLayers[i] : 0);
+
+        int flags = NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_TITLE | NK_WINDOW_MINIMIZABLE;
+        if (prepareFirst)
+            flags |= NK_WINDOW_MINIMIZED;
+        if (nk_begin(&ctx, "Performance", nk_rect(1150, 420, 350, 650), flags))
+        {
+            float width = nk_window_get_content_region_size(&ctx).x - 30;
+
+            // the trace opens in chrome://tracing or perfetto
+            {
+                const float ratio[] = { width * 0.5f, width * 0.5f };
+                nk_layout_row(&ctx, NK_STATIC, 20, 2, ratio);
+                setTraceEnabled(nk_check_label(&ctx, "Trace", getTraceEnabled()));
+                if (nk_button_label(&ctx, "Save trace"))
+                    writeLocalFileBuffer(TracePath, Buffer(exportTrace()));
+            }
+
+            if (nk_tree_push(&ctx, NK_TREE_TAB, "Render thread", NK_MAXIMIZED))
+            {
+                graph({
+                    { "Frame", &histFrame },
+                    { "Map update", &histMapUpdate },
+                    { "Traversal", &histTraversal },
+                    { "Blending", &histBlending },
+                    { "Sorting", &histSorting },
+                    { "Prefetch", &histPrefetch },
+                    { "Gpu", &histGpu },
+                }, " ms", width);
+                nk_tree_pop(&ctx);
+            }
+
+            if (!histLayers.empty() && nk_tree_push(&ctx, NK_TREE_TAB, "Traversal per layer", NK_MINIMIZED))
+            {
+                std::vector<GraphSeries> series;
+                for (uint32 i = 0; i < histLayers.size(); i++)
+                    series.push_back({ "Layer " + std::to_string(i), &histLayers[i] });
+                graph(series, " ms", width);
+                nk_tree_pop(&ctx);
+            }
+
+            if (nk_tree_push(&ctx, NK_TREE_TAB, "Data thread", NK_MAXIMIZED))
+            {
+                graph({ { "Upload", &histUpload } }, " ms", width);
+                nk_tree_pop(&ctx);
+            }
+
+            if (nk_tree_push(&ctx, NK_TREE_TAB, "Queues", NK_MAXIMIZED))
+            {
+                graph({
+                    { "Decode", &histQueueDecode },
+                    { "Download", &histQueueDownload },
+                    { "Upload", &histQueueUpload },
+                }, "", width);
+                nk_tree_pop(&ctx);
+            }
+
+            if (nk_tree_push(&ctx, NK_TREE_TAB, "Memory per type", NK_MINIMIZED))
+            {
+                const float ratio[] = { width * 0.4f, width * 0.35f, width * 0.25f };
+                nk_layout_row(&ctx, NK_STATIC, 16, 3, ratio);
+                const uint32 namesCount = sizeof(ResourceTypeNames) / sizeof(ResourceTypeNames[0]);
+                const uint32 total = std::max(1u, ms.currentGpuMemUseKB + ms.currentRamMemUseKB);
+                for (uint32 i = 0; i < ms.currentMemUsePerTypeKB.size() && i < namesCount; i++)
+                {
+                    const uint32 kb = ms.currentMemUsePerTypeKB[i];
+                    if (kb == 0)
+                        continue;
+                    nk_label(&ctx, ResourceTypeNames[i], NK_TEXT_LEFT);
+                    nk_prog(&ctx, (nk_size)(1000.0 * kb / total), 1000, false);
+                    std::ostringstream ss;
+                    ss << kb / 1024 << " MB";
+                    nk_label(&ctx, ss.str().c_str(), NK_TEXT_RIGHT);
+                }
+                nk_tree_pop(&ctx);
+            }
+        }
+
+        // end window
+        nk_end(&ctx);
+    }
+
     void prepare()
     {
         prepareOptions();
         prepareStatistics();
+        preparePerformance();
         preparePosition();
         prepareViews();
         prepareMarks();
@@ -1754,6 +2065,19 @@ public:
     nk_convert_config config;
     nk_draw_null_texture null;
 
+    History histFrame;
+    History histMapUpdate;
+    History histTraversal;
+    History histBlending;
+    History histSorting;
+    History histPrefetch;
+    History histGpu;
+    History histUpload;
+    History histQueueDecode;
+    History histQueueDownload;
+    History histQueueUpload;
+    std::vector<History> histLayers;
+
     vec3 posAutoMotion = { 0, 0, 0 };
     double posAutoRotation = 0;
     double viewExtentLimitScaleMin = 0;
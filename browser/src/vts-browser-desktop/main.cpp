@@ -26,6 +26,9 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 #include <GLFW/glfw3.h>
 #include <optick.h>
@@ -45,7 +48,8 @@ void logGlfwErr()
 #endif
 }
 
-void initializeGlfw(GLFWwindow *&renderWindow, GLFWwindow *&dataWindow)
+void initializeGlfw(GLFWwindow *&renderWindow,
+    std::vector<GLFWwindow *> &dataWindows)
 {
     if (glfwInit() != GLFW_TRUE)
     {
@@ -82,21 +86,26 @@ void initializeGlfw(GLFWwindow *&renderWindow, GLFWwindow *&dataWindow)
         throw std::runtime_error("Failed to create opengl window");
     }
 
-    dataWindow = glfwCreateWindow(10, 10, "", nullptr, renderWindow);
-    if (!dataWindow)
+    for (GLFWwindow *&dataWindow : dataWindows)
     {
-        logGlfwErr();
-        throw std::runtime_error("Failed to create shared opengl context");
+        dataWindow = glfwCreateWindow(10, 10, "", nullptr, renderWindow);
+        if (!dataWindow)
+        {
+            logGlfwErr();
+            throw std::runtime_error("Failed to create shared opengl context");
+        }
     }
 
     glfwMakeContextCurrent(renderWindow);
     glfwSwapInterval(1);
 }
 
-void finalizeGlfw(GLFWwindow *renderWindow, GLFWwindow *dataWindow)
+void finalizeGlfw(GLFWwindow *renderWindow,
+    const std::vector<GLFWwindow *> &dataWindows)
 {
     glfwDestroyWindow(renderWindow);
-    glfwDestroyWindow(dataWindow);
+    for (GLFWwindow *dataWindow : dataWindows)
+        glfwDestroyWindow(dataWindow);
     glfwTerminate();
 }
 
@@ -127,8 +136,9 @@ int main(int argc, char *argv[])
         if (!programOptions(createOptions, mapOptions, fetcherOptions, camOptions, navOptions, renderOptions, appOptions, argc, argv))
             return 0;
         struct GLFWwindow *renderWindow = nullptr;
-        struct GLFWwindow *dataWindow = nullptr;
-        initializeGlfw(renderWindow, dataWindow);
+        std::vector<struct GLFWwindow *> dataWindows(
+            std::max<uint32>(appOptions.dataThreads, 1), nullptr);
+        initializeGlfw(renderWindow, dataWindows);
         vts::renderer::loadGlFunctions((GLADloadproc)&glfwGetProcAddress);
 
         // vts map and main loop entry
@@ -139,13 +149,21 @@ int main(int argc, char *argv[])
             map.options() = mapOptions;
             camera->options() = camOptions;
             navigation->options() = navOptions;
-            DataThread data(dataWindow, &map);
+            {
+                std::string cache = map.getDiskCachePath();
+                if (!cache.empty())
+                    vts::renderer::Shader::binaryCachePath = cache + "shaders/";
+            }
+            std::vector<std::unique_ptr<DataThread>> data;
+            for (GLFWwindow *dataWindow : dataWindows)
+                data.push_back(std::make_unique<DataThread>(dataWindow, &map));
             MainWindow main(renderWindow, &map, camera.get(), navigation.get(), appOptions, renderOptions);
-            data.start();
+            for (auto &d : data)
+                d->start();
             main.run();
         }
 
-        finalizeGlfw(renderWindow, dataWindow);
+        finalizeGlfw(renderWindow, dataWindows);
         return 0;
 
 #ifdef NDEBUG
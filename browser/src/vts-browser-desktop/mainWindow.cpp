@@ -25,6 +25,7 @@
  */
 
 #include <thread>
+#include <future>
 #include <chrono>
 #include <limits>
 #include <cmath>
@@ -69,18 +70,21 @@ void windowSwap(GLFWwindow *window)
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
     MainWindow *w = (MainWindow *)glfwGetWindowUserPointer(window);
+    w->inputEvents++;
     w->key_callback(key, scancode, action, mods);
 }
 
 void character_callback(GLFWwindow *window, unsigned int codepoint)
 {
     MainWindow *w = (MainWindow *)glfwGetWindowUserPointer(window);
+    w->inputEvents++;
     w->character_callback(codepoint);
 }
 
 void cursor_position_callback(GLFWwindow *window, double xpos, double ypos)
 {
     MainWindow *w = (MainWindow *)glfwGetWindowUserPointer(window);
+    w->inputEvents++;
     w->cursor_position_callback(xpos, ypos);
     w->lastXPos = xpos;
     w->lastYPos = ypos;
@@ -89,17 +93,27 @@ void cursor_position_callback(GLFWwindow *window, double xpos, double ypos)
 void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
 {
     MainWindow *w = (MainWindow *)glfwGetWindowUserPointer(window);
+    w->inputEvents++;
     w->mouse_button_callback(button, action, mods);
 }
 
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
 {
     MainWindow *w = (MainWindow *)glfwGetWindowUserPointer(window);
+    w->inputEvents++;
     w->scroll_callback(xoffset, yoffset);
 }
 
+void window_refresh_callback(GLFWwindow *window)
+{
+    MainWindow *w = (MainWindow *)glfwGetWindowUserPointer(window);
+    w->inputEvents++;
+}
+
 MainWindow::MainWindow(GLFWwindow *window, vts::Map *map, vts::Camera *camera, vts::Navigation *navigation, const AppOptions &appOptions, const vts::renderer::RenderOptions &renderOptions) : appOptions(appOptions), map(map), camera(camera), navigation(navigation), window(window)
 {
+    if (appOptions.dataThreads > 1)
+        context.options().fenceUploads = true;
     context.bindLoadFunctions(map);
     view = context.createView(camera);
     view->options() = renderOptions;
@@ -110,6 +124,7 @@ MainWindow::MainWindow(GLFWwindow *window, vts::Map *map, vts::Camera *camera, v
     glfwSetCursorPosCallback(window, &::cursor_position_callback);
     glfwSetMouseButtonCallback(window, &::mouse_button_callback);
     glfwSetScrollCallback(window, &::scroll_callback);
+    glfwSetWindowRefreshCallback(window, &::window_refresh_callback);
 }
 
 MainWindow::~MainWindow()
@@ -154,8 +169,15 @@ void MainWindow::renderFrame()
 {
     OPTICK_EVENT();
 
-    vts::renderer::RenderOptions &ro = view->options();
     view->render();
+    renderOverlays();
+}
+
+void MainWindow::renderOverlays()
+{
+    OPTICK_EVENT();
+
+    vts::renderer::RenderOptions &ro = view->options();
 
     // compas
     if (appOptions.renderCompas)
@@ -176,14 +198,14 @@ void MainWindow::renderFrame()
     }
 }
 
-void MainWindow::prepareMarks()
+void MainWindow::prepareMarks(vts::CameraDraws &draws, double viewExtent)
 {
-    vts::mat4 view = vts::rawToMat4(camera->draws().camera.view);
+    vts::mat4 view = vts::rawToMat4(draws.camera.view);
 
     const Mark *prev = nullptr;
     for (const Mark &m : marks)
     {
-        vts::mat4 mv = view * vts::translationMatrix(m.coord) * vts::scaleMatrix(navigation->getViewExtent() * 0.005);
+        vts::mat4 mv = view * vts::translationMatrix(m.coord) * vts::scaleMatrix(viewExtent * 0.005);
         vts::mat4f mvf = mv.cast<float>();
         vts::DrawInfographicsTask t;
         vts::vec4f c = vts::vec3to4(m.color, 1);
@@ -191,14 +213,14 @@ void MainWindow::prepareMarks()
             t.color[i] = c(i);
         t.mesh = meshSphere;
         vts::matToRaw(mvf, t.mv);
-        camera->draws().infographics.push_back(t);
+        draws.infographics.push_back(t);
         if (prev)
         {
             t.mesh = meshLine;
             mv = view * vts::lookAt(m.coord, prev->coord);
             mvf = mv.cast<float>();
             vts::matToRaw(mvf, t.mv);
-            camera->draws().infographics.push_back(t);
+            draws.infographics.push_back(t);
         }
         prev = &m;
     }
@@ -359,14 +381,30 @@ void MainWindow::scroll_callback(double xoffset, double yoffset)
     }
 }
 
-void MainWindow::processEvents()
+void MainWindow::processEvents(double waitTimeout)
 {
     OPTICK_EVENT();
     gui.inputBegin();
-    glfwPollEvents();
+    if (waitTimeout > 0)
+        glfwWaitEventsTimeout(waitTimeout);
+    else
+        glfwPollEvents();
     gui.inputEnd();
 }
 
+bool MainWindow::frameNeeded()
+{
+    // the gui is redrawn after any input
+    if (inputEvents > 0)
+        return true;
+    if (map->needsUpdate() || camera->needsRedraw() || view->needsRedraw())
+        return true;
+    int w = 0, h = 0;
+    glfwGetFramebufferSize(window, &w, &h);
+    return (uint32)w * appOptions.oversampleRender != view->options().width
+        || (uint32)h * appOptions.oversampleRender != view->options().height;
+}
+
 void MainWindow::updateWindowSize()
 {
     // update resolution
@@ -448,29 +486,74 @@ void MainWindow::run()
     double accumulatedTime = 0;
     while (!glfwWindowShouldClose(window))
     {
+        // skip the whole frame while nothing changes
+        //   the events collected while waiting belong to the next frame
+        bool eventsProcessed = false;
+        if (appOptions.renderOnDemand && !frameNeeded())
+        {
+            processEvents(0.1);
+            eventsProcessed = true;
+            lastTime = std::chrono::high_resolution_clock::now();
+            if (!frameNeeded())
+                continue;
+        }
+        inputEvents = 0;
+
         OPTICK_FRAME("frame");
         const auto time1 = std::chrono::high_resolution_clock::now();
-        try
+        auto time2 = time1;
+        if (appOptions.pipelinedRender)
         {
+            // the draws of the previous traversal are rendered
+            //   while the next frame is traversed concurrently
             updateWindowSize();
-            map->renderUpdate(timingTotalFrame);
-            camera->renderUpdate();
+            if (!eventsProcessed)
+                processEvents();
+            if (!pipelinedDraws)
+                pipelinedDraws = std::make_unique<vts::renderer::RenderDraws>();
+            pipelinedDraws->swap(camera);
+            prepareMarks(pipelinedDraws->draws, navigation->getViewExtent());
+            const double elapsedTime = timingTotalFrame;
+            std::future<double> traversal = std::async(std::launch::async,
+                [this, elapsedTime]() {
+                    vts::setLogThreadName("traversal");
+                    const auto t1 = std::chrono::high_resolution_clock::now();
+                    map->renderUpdate(elapsedTime);
+                    camera->renderUpdate();
+                    const auto t2 = std::chrono::high_resolution_clock::now();
+                    return std::chrono::duration<double>(t2 - t1).count();
+                });
+            view->render(pipelinedDraws.get());
+            try
+            {
+                timingMapProcess = traversal.get();
+            }
+            catch (const vts::MapconfigException &e)
+            {
+                mapconfigFailed(e);
+            }
+            renderOverlays();
         }
-        catch (const vts::MapconfigException &e)
+        else
         {
-            std::stringstream s;
-            s << "Exception <" << e.what() << ">";
-            vts::log(vts::LogLevel::err4, s.str());
-            if (appOptions.paths.size() > 1)
-                setMapConfigPath(MapPaths());
-            else
-                throw;
-        }
+            try
+            {
+                updateWindowSize();
+                map->renderUpdate(timingTotalFrame);
+                camera->renderUpdate();
+            }
+            catch (const vts::MapconfigException &e)
+            {
+                mapconfigFailed(e);
+            }
 
-        const auto time2 = std::chrono::high_resolution_clock::now();
-        processEvents();
-        prepareMarks();
-        renderFrame();
+            time2 = std::chrono::high_resolution_clock::now();
+            timingMapProcess = std::chrono::duration<double>(time2 - time1).count();
+            if (!eventsProcessed)
+                processEvents();
+            prepareMarks(camera->draws(), navigation->getViewExtent());
+            renderFrame();
+        }
         const bool renderCompleted = map->getMapRenderComplete();
         if (appOptions.screenshotOnFullRender && renderCompleted)
         {
@@ -500,7 +583,6 @@ void MainWindow::run()
         }
 
         const auto time4 = std::chrono::high_resolution_clock::now();
-        timingMapProcess = std::chrono::duration<double>(time2 - time1).count();
         timingAppProcess = std::chrono::duration<double>(time3 - time2).count();
         timingTotalFrame = std::chrono::duration<double>(time4 - lastTime).count();
         lastTime = time4;
@@ -519,6 +601,17 @@ void MainWindow::run()
     map->renderFinalize();
 }
 
+void MainWindow::mapconfigFailed(const vts::MapconfigException &e)
+{
+    std::stringstream s;
+    s << "Exception <" << e.what() << ">";
+    vts::log(vts::LogLevel::err4, s.str());
+    if (appOptions.paths.size() > 1)
+        setMapConfigPath(MapPaths());
+    else
+        throw;
+}
+
 void MainWindow::colorizeMarks()
 {
     if (marks.empty())
@@ -40,11 +40,13 @@
 #include <vts-browser/resources.hpp>
 #include <vts-renderer/renderer.hpp>
 #include <vts-renderer/classes.hpp>
+#include <vts-renderer/renderDraws.hpp>
 
 namespace vts
 {
 
 class Map;
+class MapconfigException;
 
 } // namespace vts
 
@@ -70,10 +72,13 @@ struct AppOptions
     uint32 oversampleRender = 1;
     int renderCompas = 0;
     int simulatedFpsSlowdown = 0;
+    uint32 dataThreads = 1; // each with its own shared context
     bool screenshotOnFullRender = false;
     bool closeOnFullRender = false;
     bool purgeDiskCache = false;
     bool guiVisible = true;
+    bool pipelinedRender = false;
+    bool renderOnDemand = false;
 };
 
 void key_callback(struct GLFWwindow *window, int key, int scancode, int action, int mods);
@@ -81,6 +86,7 @@ void character_callback(struct GLFWwindow *window, unsigned int codepoint);
 void cursor_position_callback(struct GLFWwindow *window, double xpos, double ypos);
 void mouse_button_callback(struct GLFWwindow *window, int button, int action, int mods);
 void scroll_callback(struct GLFWwindow *window, double xoffset, double yoffset);
+void window_refresh_callback(struct GLFWwindow *window);
 
 class MainWindow
 {
@@ -112,9 +118,12 @@ public:
     void colorizeMarks();
     vts::vec3 getWorldPositionFromCursor();
     void run();
-    void prepareMarks();
+    void prepareMarks(vts::CameraDraws &draws, double viewExtent);
     void renderFrame();
-    void processEvents();
+    void renderOverlays();
+    void processEvents(double waitTimeout = 0);
+    bool frameNeeded();
+    void mapconfigFailed(const vts::MapconfigException &e);
     void updateWindowSize();
     void makeScreenshot();
     void setMapConfigPath(const MapPaths &paths);
@@ -128,6 +137,7 @@ public:
     AppOptions appOptions;
     vts::renderer::RenderContext context;
     std::shared_ptr<vts::renderer::RenderView> view;
+    std::unique_ptr<vts::renderer::RenderDraws> pipelinedDraws;
     std::shared_ptr<vts::renderer::Mesh> meshSphere;
     std::shared_ptr<vts::renderer::Mesh> meshLine;
     std::vector<Mark> marks;
@@ -143,6 +153,7 @@ public:
     double lastXPos = 0;
     double lastYPos = 0;
     double contentScale = 1;
+    uint32 inputEvents = 0; // since the last frame
 };
 
 #endif
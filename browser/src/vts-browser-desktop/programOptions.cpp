@@ -99,6 +99,12 @@ bool programOptions(vts::MapCreateOptions &createOptions,
             ->implicit_value(!appOptions.closeOnFullRender),
             "Quit the application when it finishes rendering."
         )
+        ("dataThreads",
+            po::value<uint32>(&appOptions.dataThreads)
+            ->default_value(appOptions.dataThreads),
+            "Number of threads uploading data to the gpu.\n"
+            "Each thread uses its own shared opengl context."
+        )
         ("render.atmosphere",
             po::value<bool>(&renderOptions.renderAtmosphere)
             ->default_value(renderOptions.renderAtmosphere)
@@ -117,6 +123,20 @@ bool programOptions(vts::MapCreateOptions &createOptions,
             ->implicit_value(2),
             "Rendering resolution multiplier."
         )
+        ("render.pipelined",
+            po::value<bool>(&appOptions.pipelinedRender)
+            ->default_value(appOptions.pipelinedRender)
+            ->implicit_value(!appOptions.pipelinedRender),
+            "Traverse the next frame while the current one is rendered.\n"
+            "Adds one frame of latency."
+        )
+        ("render.onDemand",
+            po::value<bool>(&appOptions.renderOnDemand)
+            ->default_value(appOptions.renderOnDemand)
+            ->implicit_value(!appOptions.renderOnDemand),
+            "Skip the frames while nothing changes in the map.\n"
+            "The timings in the gui are not updated while idle."
+        )
         ("gui.scale",
             po::value<double>(&appOptions.guiScale)
             ->default_value(appOptions.guiScale)
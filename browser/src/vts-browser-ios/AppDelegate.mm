@@ -69,6 +69,13 @@
     // Restart any tasks that were paused (or not yet started) while the application was inactive. If the application was previously in the background, optionally refresh the user interface.
 }
 
+- (void)applicationDidReceiveMemoryWarning:(UIApplication *)application
+{
+    // the map is rendered on the main thread too
+    if (map)
+        map->memoryPressure(vts::MemoryPressure::Severe);
+}
+
 - (void)applicationWillTerminate:(UIApplication *)application
 {
     // Called when the application is about to terminate. Save data if appropriate. See also applicationDidEnterBackground:.
@@ -245,6 +245,7 @@ void defaultMapOptions(vts::MapRuntimeOptions &mapOptions, vts::CameraOptions &c
     cameraOptions.targetPixelRatioSurfaces = 3.2;
     mapOptions.maxResourceProcessesPerTick = -1; // the resources are processed on a separate thread
     mapOptions.targetResourcesMemoryKB = 200 * 1024;
+    mapOptions.lowPowerMode = [[NSProcessInfo processInfo] isLowPowerModeEnabled];
 }
 
 EAGLContext *mapRenderContext()
@@ -34,6 +34,7 @@
     NSTimer* timer;
     id object;
     SEL selector;
+    double sinceUpdate;
 }
 @end
 
@@ -43,6 +44,7 @@
 {
     if (self = [super init])
     {
+        sinceUpdate = 0;
         timer = [NSTimer timerWithTimeInterval:0.2 target:self selector:@selector(timerTick) userInfo:nil repeats:YES];
         [[NSRunLoop mainRunLoop] addTimer:timer forMode:NSRunLoopCommonModes];
     }
@@ -53,14 +55,20 @@
 {
     if (!object || !map)
         return;
-    try
+    // the map is updated only as often as it needs to be
+    sinceUpdate += 0.2;
+    if (sinceUpdate + 0.01 >= map->recommendedFrameInterval())
     {
-        map->renderUpdate(0.2);
-        camera->renderUpdate();
-    }
-    catch (const vts::MapconfigException &)
-    {
-        // do nothing
+        try
+        {
+            map->renderUpdate(sinceUpdate);
+            camera->renderUpdate();
+        }
+        catch (const vts::MapconfigException &)
+        {
+            // do nothing
+        }
+        sinceUpdate = 0;
     }
     
     // https://stackoverflow.com/questions/7017281/performselector-may-cause-a-leak-because-its-selector-is-unknown
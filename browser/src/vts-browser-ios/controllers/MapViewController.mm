@@ -24,6 +24,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include "../Map.h"
@@ -530,6 +531,26 @@ using namespace vts;
 
     [self updateFullscreen];
     [self progressUpdate];
+    [self framePacing];
+}
+
+- (void)framePacing
+{
+    double interval = map->recommendedFrameInterval();
+    if (view->needsRedraw())
+        interval = std::min(interval, map->options().frameIntervalTransition);
+    NSInteger fps = 60;
+    if (interval > 0)
+        fps = std::max<NSInteger>(1, std::min<NSInteger>(60, 1 / interval + 0.5));
+    if (self.preferredFramesPerSecond != fps)
+        self.preferredFramesPerSecond = fps;
+}
+
+- (void)touchesBegan:(NSSet<UITouch *> *)touches withEvent:(UIEvent *)event
+{
+    // respond to the gestures without waiting for the next slow frame
+    self.preferredFramesPerSecond = 60;
+    [super touchesBegan:touches withEvent:event];
 }
 
 - (void)glkView:(nonnull GLKView *)gview drawInRect:(CGRect)rect
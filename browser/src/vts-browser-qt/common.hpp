@@ -29,6 +29,8 @@
 
 #include <memory>
 #include <chrono>
+#include <mutex>
+#include <atomic>
 #include <QWindow>
 #include <QThread>
 #include <QOpenGLContext>
@@ -67,6 +69,39 @@ public:
     void run() override;
 };
 
+// input collected by the gui thread and applied by the render thread
+struct Input
+{
+    double pan[3] = { 0, 0, 0 };
+    double rotate[3] = { 0, 0, 0 };
+    double zoom = 0;
+    int width = 0;
+    int height = 0;
+    bool exposed = false;
+    bool redraw = false; // the window has been exposed or resized
+};
+
+// map update, traversal and rendering run here
+//   so that they do not stall the qt event processing and vice versa
+class RenderThread : public QThread
+{
+public:
+    std::shared_ptr<Gl> gl;
+    std::shared_ptr<vts::renderer::RenderContext> context;
+    std::shared_ptr<vts::Map> map;
+    std::shared_ptr<vts::Camera> camera;
+    std::shared_ptr<vts::Navigation> navigation;
+    std::shared_ptr<vts::renderer::RenderView> view;
+    class QWindow *window = nullptr;
+
+    Input input;
+    std::mutex inputMutex;
+    std::atomic<bool> stop{ false };
+
+    void run() override;
+    bool tick(double elapsedTime);
+};
+
 class MainWindow : public QWindow
 {
 public:
@@ -74,24 +109,18 @@ public:
     ~MainWindow();
 
     bool event(QEvent *event);
-    void tick();
+    void exposeEvent(class QExposeEvent *event) override;
+    void resizeEvent(class QResizeEvent *event) override;
 
     void mouseMove(class QMouseEvent *event);
     void mousePress(class QMouseEvent *event);
     void mouseRelease(class QMouseEvent *event);
     void mouseWheel(class QWheelEvent *event);
 
-    std::shared_ptr<Gl> gl;
-    std::shared_ptr<vts::renderer::RenderContext> context;
-    std::shared_ptr<vts::Map> map;
-    std::shared_ptr<vts::Camera> camera;
-    std::shared_ptr<vts::Navigation> navigation;
-    std::shared_ptr<vts::renderer::RenderView> view;
-
     QPoint lastMousePosition;
-    std::chrono::high_resolution_clock::time_point lastTime;
 
     DataThread dataThread;
+    RenderThread renderThread;
 };
 
 #endif
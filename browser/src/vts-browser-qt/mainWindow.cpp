@@ -28,6 +28,8 @@
 #include <QGuiApplication>
 #include <QMouseEvent>
 #include <QWheelEvent>
+#include <QExposeEvent>
+#include <QResizeEvent>
 #include <vts-browser/log.hpp>
 #include <vts-browser/map.hpp>
 #include <vts-browser/mapOptions.hpp>
@@ -70,6 +72,89 @@ void DataThread::run()
     map->dataAllRun();
 }
 
+void RenderThread::run()
+{
+    vts::setLogThreadName("render");
+    gl->current();
+
+    auto lastTime = std::chrono::high_resolution_clock::now();
+    while (!stop)
+    {
+        auto currentTime = std::chrono::high_resolution_clock::now();
+        double elapsedTime = std::chrono::duration_cast<
+            std::chrono::microseconds>(currentTime - lastTime).count() * 1e-6;
+        lastTime = currentTime;
+
+        // release build -> catch exceptions and close the window
+        // debug build -> let the debugger handle the exceptions
+#ifdef NDEBUG
+        try
+        {
+#endif
+            if (!tick(elapsedTime))
+                msleep(10); // the window is not visible or nothing changed
+#ifdef NDEBUG
+        }
+        catch(...)
+        {
+            QMetaObject::invokeMethod(window, "close", Qt::QueuedConnection);
+            break;
+        }
+#endif
+    }
+
+    // the renderer resources must be released with the context current
+    view.reset();
+    context.reset();
+    navigation.reset();
+    camera.reset();
+    map->renderFinalize();
+    gl->current(false);
+}
+
+bool RenderThread::tick(double elapsedTime)
+{
+    Input in;
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        in = input;
+        input = Input();
+        input.width = in.width;
+        input.height = in.height;
+        input.exposed = in.exposed;
+    }
+
+    if (in.pan[0] != 0 || in.pan[1] != 0)
+        navigation->pan(in.pan);
+    if (in.rotate[0] != 0 || in.rotate[1] != 0)
+        navigation->rotate(in.rotate);
+    if (in.zoom != 0)
+        navigation->zoom(in.zoom);
+
+    // render on demand, skip the whole frame if nothing has changed
+    if (!in.redraw && !map->needsUpdate() && !camera->needsRedraw()
+        && !view->needsRedraw())
+        return false;
+
+    map->renderUpdate(elapsedTime);
+    if (!in.exposed || in.width <= 0 || in.height <= 0)
+        return false;
+
+    if (!gl->isValid())
+        throw std::runtime_error("invalid gl context");
+
+    camera->setViewportSize(in.width, in.height);
+    camera->renderUpdate();
+    view->options().targetFrameBuffer = gl->defaultFramebufferObject();
+    view->options().width = in.width;
+    view->options().height = in.height;
+    view->render();
+
+    // finish the frame, waits for the vertical sync
+    gl->swapBuffers(window);
+    return true;
+}
+
 MainWindow::MainWindow()
 {
     QSurfaceFormat format;
@@ -90,7 +175,7 @@ MainWindow::MainWindow()
     dataThread.gl->initialize();
     dataThread.gl->current(false);
 
-    gl = std::make_shared<Gl>(this);
+    std::shared_ptr<Gl> gl = renderThread.gl = std::make_shared<Gl>(this);
     gl->setShareContext(dataThread.gl.get());
     gl->initialize();
     gl->current();
@@ -100,45 +185,77 @@ MainWindow::MainWindow()
 
     vts::MapCreateOptions mapopts;
     mapopts.clientId = "vts-browser-qt";
-    map = dataThread.map = std::make_shared<vts::Map>(mapopts);
+    auto map = dataThread.map = renderThread.map
+        = std::make_shared<vts::Map>(mapopts);
     map->setMapconfigPath(
             "https://cdn.melown.com/mario/store/melown2015/"
             "map-config/melown/Melown-Earth-Intergeo-2017/mapConfig.json",
             "");
-    camera = map->createCamera();
-    navigation = camera->createNavigation();
+    renderThread.camera = map->createCamera();
+    renderThread.navigation = renderThread.camera->createNavigation();
+
+    renderThread.context = std::make_shared<vts::renderer::RenderContext>();
+    renderThread.context->bindLoadFunctions(map.get());
+    renderThread.view = renderThread.context->createView(
+        renderThread.camera.get());
+    // the render thread waits for the uploads on the gpu only
+    renderThread.context->options().fenceUploads = true;
 
-    context = std::make_shared<vts::renderer::RenderContext>();
-    context->bindLoadFunctions(map.get());
-    view = context->createView(camera.get());
+    {
+        std::lock_guard<std::mutex> lock(renderThread.inputMutex);
+        renderThread.input.width = QWindow::width();
+        renderThread.input.height = QWindow::height();
+        renderThread.input.exposed = isExposed();
+    }
 
     dataThread.gl->moveToThread(&dataThread);
     dataThread.start();
 
-    lastTime = std::chrono::high_resolution_clock::now();
-    requestUpdate();
+    gl->current(false);
+    renderThread.window = this;
+    gl->moveToThread(&renderThread);
+    renderThread.start();
 }
 
 MainWindow::~MainWindow()
 {
-    view.reset();
-    navigation.reset();
-    camera.reset();
-    if (map)
-        map->renderFinalize();
+    renderThread.stop = true;
+    renderThread.wait();
     dataThread.wait();
 }
 
+void MainWindow::exposeEvent(QExposeEvent *)
+{
+    std::lock_guard<std::mutex> lock(renderThread.inputMutex);
+    renderThread.input.exposed = isExposed();
+    renderThread.input.redraw = true;
+}
+
+void MainWindow::resizeEvent(QResizeEvent *)
+{
+    std::lock_guard<std::mutex> lock(renderThread.inputMutex);
+    renderThread.input.width = QWindow::width();
+    renderThread.input.height = QWindow::height();
+    renderThread.input.redraw = true;
+}
+
 void MainWindow::mouseMove(QMouseEvent *event)
 {
     QPoint diff = event->globalPos() - lastMousePosition;
     lastMousePosition = event->globalPos();
-    double n[3] = { (double)diff.x(), (double)diff.y(), 0 };
+    std::lock_guard<std::mutex> lock(renderThread.inputMutex);
+    Input &in = renderThread.input;
     if (event->buttons() & Qt::LeftButton)
-        navigation->pan(n);
+    {
+        in.pan[0] += diff.x();
+        in.pan[1] += diff.y();
+    }
     if ((event->buttons() & Qt::RightButton)
         || (event->buttons() & Qt::MiddleButton))
-        navigation->rotate(n);
+    {
+        in.rotate[0] += diff.x();
+        in.rotate[1] += diff.y();
+    }
 }
 
 void MainWindow::mousePress(QMouseEvent *)
@@ -149,16 +266,14 @@ void MainWindow::mouseRelease(QMouseEvent *)
 
 void MainWindow::mouseWheel(QWheelEvent *event)
 {
-    navigation->zoom(event->angleDelta().y() / 120.0);
+    std::lock_guard<std::mutex> lock(renderThread.inputMutex);
+    renderThread.input.zoom += event->angleDelta().y() / 120.0;
 }
 
 bool MainWindow::event(QEvent *event)
 {
     switch (event->type())
     {
-    case QEvent::UpdateRequest:
-        tick();
-        return true;
     case QEvent::MouseMove:
         mouseMove(dynamic_cast<QMouseEvent*>(event));
         return true;
@@ -175,50 +290,3 @@ bool MainWindow::event(QEvent *event)
         return QWindow::event(event);
     }
 }
-
-void MainWindow::tick()
-{
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    double elapsedTime = std::chrono::duration_cast<std::chrono::microseconds>(
-                currentTime - lastTime).count() * 1e-6;
-    lastTime = currentTime;
-
-    requestUpdate();
-    if (!isExposed())
-        return;
-
-    if (!gl->isValid())
-        throw std::runtime_error("invalid gl context");
-
-    gl->makeCurrent(this);
-    QSize size = QWindow::size();
-
-    // release build -> catch exceptions and close the window
-    // debug build -> let the debugger handle the exceptions
-#ifdef NDEBUG
-    try
-    {
-#endif
-
-        map->renderUpdate(elapsedTime);
-        camera->setViewportSize(size.width(), size.height());
-        camera->renderUpdate();
-        view->options().targetFrameBuffer = gl->defaultFramebufferObject();
-        view->options().width = size.width();
-        view->options().height = size.height();
-        view->render();
-
-#ifdef NDEBUG
-    }
-    catch(...)
-    {
-        this->close();
-        return;
-    }
-#endif
-
-    // finish the frame
-    gl->swapBuffers(this);
-}
-
-
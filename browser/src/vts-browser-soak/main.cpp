@@ -0,0 +1,633 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// headless soak benchmark
+//   wanders randomly between a set of positions for hours in a hidden window
+//   samples memory, object counts and frame times periodically
+//   and flags metrics that keep growing once the run has settled
+// meant to be run with the downloads replayed from a recorded archive
+//   (see FetcherOptions::replayArchive), so that the runs are comparable
+// the process exits with code 1 if any metric is flagged
+
+#include <vts-browser/log.hpp>
+#include <vts-browser/map.hpp>
+#include <vts-browser/mapOptions.hpp>
+#include <vts-browser/mapStatistics.hpp>
+#include <vts-browser/camera.hpp>
+#include <vts-browser/cameraOptions.hpp>
+#include <vts-browser/cameraStatistics.hpp>
+#include <vts-browser/navigation.hpp>
+#include <vts-browser/navigationOptions.hpp>
+#include <vts-browser/position.hpp>
+#include <vts-browser/fetcher.hpp>
+#include <vts-browser/boostProgramOptions.hpp>
+#include <vts-renderer/renderer.hpp>
+#include <vts-renderer/highPerformanceGpuHint.h>
+
+#include <json/json.h>
+
+#include <thread>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+struct SoakOptions
+{
+    std::string mapconfig = "https://cdn.melown.com/mario/store/melown2015/map-config/melown/Melown-Earth-Intergeo-2017/mapConfig.json";
+    std::string auth;
+    std::string positions;
+    std::string output;
+    uint32 width = 1280;
+    uint32 height = 720;
+    uint32 seed = 0;
+    double duration = 4 * 3600; // seconds
+    double interval = 60; // seconds between samples
+    double dwell = 20; // average seconds spent around each position
+    double settle = 0.25; // fraction of the run excluded from the analysis
+    double growthTolerance = 0.1; // relative to the mean
+    double driftTolerance = 0.25; // relative to the start of the steady phase
+    double timeout = 60; // seconds to wait for the mapconfig
+};
+
+// memory metrics are tested for growth, latency metrics for drift
+struct Metric
+{
+    const char *name;
+    bool latency;
+};
+
+const Metric Metrics[] = {
+    { "ramKB", false },
+    { "gpuKB", false },
+    { "traverseKB", false },
+    { "traverseNodes", false },
+    { "resourcesExists", false },
+    { "bufferPoolKB", false },
+    { "uboKB", false },
+    { "geodataHysteresisJobs", false },
+    { "heapKB", false },
+    { "rssKB", false },
+    { "frameMean", true },
+    { "frameP95", true },
+    { "gpuMean", true },
+};
+
+const uint32 MetricsCount = sizeof(Metrics) / sizeof(Metrics[0]);
+
+struct Sample
+{
+    double time = 0; // seconds since start of the run
+    uint32 frames = 0; // rendered since previous sample
+    double values[MetricsCount] = {};
+};
+
+SDL_Window *window;
+SDL_GLContext renderContext;
+SDL_GLContext dataContext;
+std::shared_ptr<vts::Map> map;
+std::shared_ptr<vts::Camera> cam;
+std::shared_ptr<vts::Navigation> nav;
+std::shared_ptr<vts::renderer::RenderContext> context;
+std::shared_ptr<vts::renderer::RenderView> view;
+std::thread dataThread;
+
+typedef std::chrono::steady_clock Clock;
+
+double millis(Clock::time_point a, Clock::time_point b)
+{
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+void dataEntry()
+{
+    vts::setLogThreadName("data");
+    SDL_GL_MakeCurrent(window, dataContext);
+    vts::renderer::installGlDebugCallback();
+    map->dataAllRun();
+    SDL_GL_DeleteContext(dataContext);
+    dataContext = nullptr;
+}
+
+Json::Value parseJson(const std::string &str, const std::string &what)
+{
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value v;
+    std::string errs;
+    if (!reader->parse(str.data(), str.data() + str.size(), &v, &errs))
+        throw std::runtime_error("Failed to parse " + what + ": " + errs);
+    return v;
+}
+
+std::string writeJson(const Json::Value &v, bool pretty)
+{
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = pretty ? "  " : "";
+    return Json::writeString(builder, v);
+}
+
+// json array of positions, in the url or the json format
+//   the camera paths of vts-browser-benchmark are accepted too
+std::vector<vts::Position> loadPositions(const std::string &file)
+{
+    std::ifstream f(file);
+    if (!f)
+        throw std::runtime_error("Failed to open positions <" + file + ">");
+    std::stringstream ss;
+    ss << f.rdbuf();
+    const Json::Value v = parseJson(ss.str(), "positions");
+    if (!v.isArray() || v.empty())
+        throw std::runtime_error("Positions must be a non-empty array");
+    std::vector<vts::Position> r;
+    for (const Json::Value &k : v)
+    {
+        const Json::Value &p = k.isObject() && k.isMember("position")
+            ? k["position"] : k;
+        r.push_back(vts::Position(p.isString()
+            ? p.asString() : writeJson(p, false)));
+    }
+    return r;
+}
+
+uint64 heapKB()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return mallinfo2().uordblks / 1024;
+#elif defined(__GLIBC__)
+    return (uint32)mallinfo().uordblks / 1024;
+#else
+    return 0;
+#endif
+}
+
+uint64 rssKB()
+{
+#ifdef __linux__
+    std::ifstream f("/proc/self/statm");
+    uint64 size = 0, resident = 0;
+    f >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE) / 1024;
+#else
+    return 0;
+#endif
+}
+
+void frame(double elapsed)
+{
+    SDL_Event event;
+    while (SDL_PollEvent(&event))
+    {}
+    map->renderUpdate(elapsed);
+    cam->renderUpdate();
+    view->render();
+    SDL_GL_SwapWindow(window);
+}
+
+Sample sample(double time, std::vector<double> &frameTimes,
+    std::vector<double> &gpuTimes)
+{
+    Sample s;
+    s.time = time;
+    s.frames = frameTimes.size();
+    const vts::MapStatistics &ms = map->statistics();
+    const vts::renderer::RenderStatistics &rs = view->statistics();
+    const auto &mean = [](const std::vector<double> &v) {
+        double sum = 0;
+        for (double d : v)
+            sum += d;
+        return v.empty() ? 0 : sum / v.size();
+    };
+    std::sort(frameTimes.begin(), frameTimes.end());
+    const double p95 = frameTimes.empty() ? 0 : frameTimes[std::min<
+        std::size_t>(frameTimes.size() - 1, frameTimes.size() * 95 / 100)];
+    const double values[MetricsCount] = {
+        (double)ms.currentRamMemUseKB,
+        (double)ms.currentGpuMemUseKB,
+        (double)ms.currentTraverseMemUseKB,
+        (double)ms.currentTraverseNodes,
+        (double)ms.resourcesExists,
+        (double)ms.bufferPoolRetainedKB,
+        (double)rs.uboMemoryKB,
+        (double)rs.geodataHysteresisJobs,
+        (double)heapKB(),
+        (double)rssKB(),
+        mean(frameTimes),
+        p95,
+        mean(gpuTimes),
+    };
+    std::copy(values, values + MetricsCount, s.values);
+    frameTimes.clear();
+    gpuTimes.clear();
+    return s;
+}
+
+// the memory metrics are fitted with a line over the steady phase
+//   growth is the rise of the line over the phase, relative to the mean
+// the latency metrics compare the last quarter of the steady phase
+//   to the first quarter
+Json::Value analyze(const SoakOptions &opts,
+    const std::vector<Sample> &samples, Json::Value &flagged)
+{
+    Json::Value r(Json::objectValue);
+    std::vector<const Sample *> steady;
+    for (const Sample &s : samples)
+        if (s.time >= opts.duration * opts.settle)
+            steady.push_back(&s);
+    if (steady.size() < 4)
+    {
+        vts::log(vts::LogLevel::warn3,
+            "Too few samples in the steady phase for the analysis");
+        return r;
+    }
+    const std::size_t n = steady.size();
+    const std::size_t quarter = std::max<std::size_t>(n / 4, 1);
+    for (uint32 m = 0; m < MetricsCount; m++)
+    {
+        Json::Value &j = r[Metrics[m].name];
+        double st = 0, sv = 0, stt = 0, stv = 0;
+        for (const Sample *s : steady)
+        {
+            const double v = s->values[m];
+            st += s->time;
+            sv += v;
+            stt += s->time * s->time;
+            stv += s->time * v;
+        }
+        const double mean = sv / n;
+        bool bad = false;
+        if (Metrics[m].latency)
+        {
+            double first = 0, last = 0;
+            for (std::size_t i = 0; i < quarter; i++)
+            {
+                first += steady[i]->values[m];
+                last += steady[n - 1 - i]->values[m];
+            }
+            const double drift = first > 0 ? last / first - 1 : 0;
+            j["drift"] = drift;
+            bad = drift > opts.driftTolerance;
+        }
+        else
+        {
+            const double den = n * stt - st * st;
+            const double slope = den > 0 ? (n * stv - st * sv) / den : 0;
+            const double span = steady.back()->time - steady.front()->time;
+            const double growth = mean > 0 ? slope * span / mean : 0;
+            j["slopePerHour"] = slope * 3600;
+            j["growth"] = growth;
+            bad = growth > opts.growthTolerance;
+        }
+        j["mean"] = mean;
+        j["flagged"] = bad;
+        if (bad)
+            flagged.append(Metrics[m].name);
+    }
+    return r;
+}
+
+Json::Value report(const SoakOptions &opts,
+    const std::vector<Sample> &samples)
+{
+    Json::Value r;
+    r["mapconfig"] = opts.mapconfig;
+    r["positions"] = opts.positions;
+    r["width"] = opts.width;
+    r["height"] = opts.height;
+    r["seed"] = opts.seed;
+    r["duration"] = opts.duration;
+    r["interval"] = opts.interval;
+    r["settle"] = opts.settle;
+
+    {
+        Json::Value &ss = r["samples"];
+        ss = Json::Value(Json::arrayValue);
+        for (const Sample &s : samples)
+        {
+            Json::Value j;
+            j["time"] = s.time;
+            j["frames"] = s.frames;
+            for (uint32 m = 0; m < MetricsCount; m++)
+                j[Metrics[m].name] = s.values[m];
+            ss.append(j);
+        }
+    }
+
+    Json::Value &flagged = r["flagged"];
+    flagged = Json::Value(Json::arrayValue);
+    r["analysis"] = analyze(opts, samples, flagged);
+    r["mapStatistics"] = parseJson(map->statistics().toJson(), "statistics");
+    r["cameraStatistics"] = parseJson(cam->statistics().toJson(),
+        "statistics");
+    return r;
+}
+
+bool programOptions(SoakOptions &opts,
+    vts::MapCreateOptions &createOptions,
+    vts::MapRuntimeOptions &mapOptions,
+    vts::FetcherOptions &fetcherOptions,
+    vts::CameraOptions &camOptions,
+    vts::NavigationOptions &navOptions,
+    int argc, char *argv[])
+{
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help", "Show this help.")
+        ("positions",
+            po::value<std::string>(&opts.positions),
+            "Positions to wander between.\n"
+            "Json array of positions (or camera path of the benchmark)."
+        )
+        ("url",
+            po::value<std::string>(&opts.mapconfig)
+            ->default_value(opts.mapconfig),
+            "Mapconfig URL."
+        )
+        ("auth",
+            po::value<std::string>(&opts.auth),
+            "Authentication url."
+        )
+        ("output,o",
+            po::value<std::string>(&opts.output),
+            "Output json file, standard output if empty.\n"
+            "The file is rewritten after each sample."
+        )
+        ("width",
+            po::value<uint32>(&opts.width)
+            ->default_value(opts.width),
+            "Render width."
+        )
+        ("height",
+            po::value<uint32>(&opts.height)
+            ->default_value(opts.height),
+            "Render height."
+        )
+        ("seed",
+            po::value<uint32>(&opts.seed)
+            ->default_value(opts.seed),
+            "Seed of the random navigation."
+        )
+        ("duration",
+            po::value<double>(&opts.duration)
+            ->default_value(opts.duration),
+            "Length of the run in seconds."
+        )
+        ("interval",
+            po::value<double>(&opts.interval)
+            ->default_value(opts.interval),
+            "Seconds between samples."
+        )
+        ("dwell",
+            po::value<double>(&opts.dwell)
+            ->default_value(opts.dwell),
+            "Average seconds spent around each position."
+        )
+        ("settle",
+            po::value<double>(&opts.settle)
+            ->default_value(opts.settle),
+            "Fraction of the run excluded from the analysis."
+        )
+        ("growthTolerance",
+            po::value<double>(&opts.growthTolerance)
+            ->default_value(opts.growthTolerance),
+            "Allowed growth of memory metrics over the steady phase, "
+            "relative to their mean."
+        )
+        ("driftTolerance",
+            po::value<double>(&opts.driftTolerance)
+            ->default_value(opts.driftTolerance),
+            "Allowed relative increase of frame times over the steady phase."
+        )
+        ("timeout",
+            po::value<double>(&opts.timeout)
+            ->default_value(opts.timeout),
+            "Seconds to wait for the mapconfig."
+        )
+        ;
+
+    po::positional_options_description popts;
+    popts.add("positions", 1);
+
+    vts::optionsConfigLog(desc);
+    vts::optionsConfigMapCreate(desc, &createOptions);
+    vts::optionsConfigMapRuntime(desc, &mapOptions);
+    vts::optionsConfigCamera(desc, &camOptions);
+    vts::optionsConfigNavigation(desc, &navOptions);
+    vts::optionsConfigFetcherOptions(desc, &fetcherOptions);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(popts).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help") || opts.positions.empty())
+    {
+        std::cout << "Usage: " << argv[0] << " [options] [--]"
+            << " <positions>" << std::endl << desc << std::endl;
+        return false;
+    }
+    if (opts.duration <= 0 || opts.interval <= 0 || opts.dwell <= 0
+        || opts.width == 0 || opts.height == 0)
+        throw std::runtime_error("Invalid duration, interval, dwell "
+            "or resolution");
+    return true;
+}
+
+void writeReport(const SoakOptions &opts, const Json::Value &r)
+{
+    const std::string out = writeJson(r, true);
+    if (opts.output.empty())
+        std::cout << out << std::endl;
+    else
+    {
+        std::ofstream f(opts.output);
+        f << out << std::endl;
+        if (!f)
+            throw std::runtime_error("Failed to write <" + opts.output + ">");
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    SoakOptions opts;
+    vts::MapCreateOptions createOptions;
+    vts::MapRuntimeOptions mapOptions;
+    vts::FetcherOptions fetcherOptions;
+    vts::CameraOptions camOptions;
+    vts::NavigationOptions navOptions;
+    createOptions.clientId = "vts-browser-soak";
+    if (!programOptions(opts, createOptions, mapOptions, fetcherOptions,
+        camOptions, navOptions, argc, argv))
+        return 0;
+    const std::vector<vts::Position> positions
+        = loadPositions(opts.positions);
+
+    // initialize SDL with hidden window
+    vts::log(vts::LogLevel::info3, "Initializing SDL library");
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0)
+    {
+        vts::log(vts::LogLevel::err4, SDL_GetError());
+        throw std::runtime_error("Failed to initialize SDL");
+    }
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 0);
+    SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 0);
+    SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 0);
+    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    window = SDL_CreateWindow("vts-browser-soak",
+        SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+        opts.width, opts.height, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (!window)
+    {
+        vts::log(vts::LogLevel::err4, SDL_GetError());
+        throw std::runtime_error("Failed to create window");
+    }
+    dataContext = SDL_GL_CreateContext(window);
+    renderContext = SDL_GL_CreateContext(window);
+    SDL_GL_SetSwapInterval(0); // no v-sync
+    vts::renderer::loadGlFunctions(&SDL_GL_GetProcAddress);
+
+    context = std::make_shared<vts::renderer::RenderContext>();
+    map = std::make_shared<vts::Map>(createOptions,
+        vts::Fetcher::create(fetcherOptions));
+    map->options() = mapOptions;
+    context->bindLoadFunctions(map.get());
+    dataThread = std::thread(&dataEntry);
+    cam = map->createCamera();
+    cam->options() = camOptions;
+    nav = cam->createNavigation();
+    nav->options() = navOptions;
+    view = context->createView(cam.get());
+    view->options().width = opts.width;
+    view->options().height = opts.height;
+    cam->setViewportSize(opts.width, opts.height);
+    map->setMapconfigPath(opts.mapconfig, opts.auth);
+
+    std::vector<Sample> samples;
+    {
+        // wait for the mapconfig
+        const auto start = Clock::now();
+        while (!map->getMapconfigReady())
+        {
+            if (millis(start, Clock::now()) > opts.timeout * 1000)
+                throw std::runtime_error("Timeout waiting for the mapconfig");
+            frame(0.016);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        // random walk in real time
+        std::mt19937 rng(opts.seed);
+        std::uniform_real_distribution<double> uniform(0, 1);
+        std::vector<double> frameTimes, gpuTimes;
+        const auto begin = Clock::now();
+        auto last = begin;
+        double nextMove = 0;
+        double nextSample = opts.interval;
+        while (true)
+        {
+            const auto now = Clock::now();
+            const double time = millis(begin, now) * 1e-3;
+            if (time >= opts.duration)
+                break;
+
+            if (time >= nextMove)
+            {
+                // random heading and zoom around one of the positions
+                vts::Position p = positions[std::min<std::size_t>(
+                    positions.size() - 1, uniform(rng) * positions.size())];
+                p.orientation[0] = uniform(rng) * 360;
+                p.viewExtent *= std::pow(2, uniform(rng) * 2 - 1);
+                nav->setPosition(p);
+                nextMove = time + opts.dwell * (0.5 + uniform(rng));
+            }
+
+            frame(millis(last, now) * 1e-3);
+            last = now;
+            frameTimes.push_back(millis(now, Clock::now()));
+            gpuTimes.push_back(view->statistics().gpuTimeTotal);
+
+            if (time >= nextSample)
+            {
+                samples.push_back(sample(time, frameTimes, gpuTimes));
+                nextSample += opts.interval;
+                const Sample &s = samples.back();
+                std::stringstream ss;
+                ss << "Soak sample at " << uint32(time) << " s, ram: "
+                    << uint32(s.values[0] / 1024) << " MB, gpu: "
+                    << uint32(s.values[1] / 1024) << " MB, nodes: "
+                    << uint32(s.values[3]) << ", frame p95: "
+                    << s.values[11] << " ms";
+                vts::log(vts::LogLevel::info3, ss.str());
+                // partial results survive an interrupted run
+                if (!opts.output.empty())
+                    writeReport(opts, report(opts, samples));
+            }
+        }
+    }
+
+    const Json::Value r = report(opts, samples);
+    writeReport(opts, r);
+    for (const Json::Value &f : r["flagged"])
+        vts::log(vts::LogLevel::warn4, "Unbounded growth or drift of <"
+            + f.asString() + ">");
+
+    // release all
+    nav.reset();
+    cam.reset();
+    view.reset();
+    map->renderFinalize();
+    dataThread.join();
+    map.reset();
+    context.reset();
+    SDL_GL_DeleteContext(renderContext);
+    renderContext = nullptr;
+    SDL_DestroyWindow(window);
+    window = nullptr;
+    return r["flagged"].empty() ? 0 : 1;
+}
@@ -0,0 +1,463 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// headless batch thumbnails
+//   renders a list of positions into png files
+//   all jobs share one map, so the resources (and the cache) are reused
+//   across the batch
+
+#include <vts-browser/log.hpp>
+#include <vts-browser/map.hpp>
+#include <vts-browser/mapOptions.hpp>
+#include <vts-browser/camera.hpp>
+#include <vts-browser/cameraOptions.hpp>
+#include <vts-browser/navigation.hpp>
+#include <vts-browser/navigationOptions.hpp>
+#include <vts-browser/position.hpp>
+#include <vts-browser/fetcher.hpp>
+#include <vts-browser/resources.hpp>
+#include <vts-browser/buffer.hpp>
+#include <vts-browser/boostProgramOptions.hpp>
+#include <vts-renderer/renderer.hpp>
+#include <vts-renderer/highPerformanceGpuHint.h>
+
+#include <json/json.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+struct Job
+{
+    vts::Position position;
+    std::string output;
+    uint32 width = 0;
+    uint32 height = 0;
+};
+
+struct ThumbnailsOptions
+{
+    std::string mapconfig = "https://cdn.melown.com/mario/store/melown2015/map-config/melown/Melown-Earth-Intergeo-2017/mapConfig.json";
+    std::string auth;
+    std::string jobs;
+    std::string videoDriver = "offscreen";
+    uint32 width = 512; // default resolution of jobs without one
+    uint32 height = 512;
+    double jobTimeout = 30; // seconds to wait for complete render of a job
+    double timeout = 60; // seconds to wait for the mapconfig
+};
+
+SDL_Window *window;
+SDL_GLContext renderContext;
+SDL_GLContext dataContext;
+std::shared_ptr<vts::Map> map;
+std::shared_ptr<vts::Camera> cam;
+std::shared_ptr<vts::Navigation> nav;
+std::shared_ptr<vts::renderer::RenderContext> context;
+std::shared_ptr<vts::renderer::RenderView> view;
+std::thread dataThread;
+
+typedef std::chrono::steady_clock Clock;
+
+double millis(Clock::time_point a, Clock::time_point b)
+{
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+void dataEntry()
+{
+    vts::setLogThreadName("data");
+    SDL_GL_MakeCurrent(window, dataContext);
+    vts::renderer::installGlDebugCallback();
+    map->dataAllRun();
+    SDL_GL_DeleteContext(dataContext);
+    dataContext = nullptr;
+}
+
+// png encoding runs on its own thread
+//   so that the rendering of the next job is not delayed
+class Writer
+{
+public:
+    Writer() : thr(&Writer::entry, this)
+    {}
+
+    ~Writer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            stop = true;
+        }
+        con.notify_all();
+        thr.join();
+    }
+
+    void push(vts::GpuTextureSpec &&spec, const std::string &path)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            q.emplace_back(std::move(spec), path);
+        }
+        con.notify_one();
+    }
+
+private:
+    void entry()
+    {
+        vts::setLogThreadName("writer");
+        while (true)
+        {
+            std::pair<vts::GpuTextureSpec, std::string> t;
+            {
+                std::unique_lock<std::mutex> lock(mut);
+                con.wait(lock, [&]() { return stop || !q.empty(); });
+                if (q.empty())
+                    return;
+                t = std::move(q.front());
+                q.pop_front();
+            }
+            try
+            {
+                t.first.verticalFlip();
+                vts::writeLocalFileBuffer(t.second, t.first.encodePng());
+                vts::log(vts::LogLevel::info3, "Written <"
+                    + t.second + ">");
+            }
+            catch (const std::exception &e)
+            {
+                vts::log(vts::LogLevel::err3, "Failed to write <"
+                    + t.second + ">, " + e.what());
+            }
+        }
+    }
+
+    std::deque<std::pair<vts::GpuTextureSpec, std::string>> q;
+    std::mutex mut;
+    std::condition_variable con;
+    std::thread thr;
+    bool stop = false;
+};
+
+Json::Value parseJson(const std::string &str, const std::string &what)
+{
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value v;
+    std::string errs;
+    if (!reader->parse(str.data(), str.data() + str.size(), &v, &errs))
+        throw std::runtime_error("Failed to parse " + what + ": " + errs);
+    return v;
+}
+
+std::string writeJson(const Json::Value &v)
+{
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    return Json::writeString(builder, v);
+}
+
+// the jobs are a json array of objects with position, output,
+//   and optional width and height
+//   the position uses either the url or the json format
+//   eg. { "position": "obj,14.4,50.1,fix,300,0,-60,0,2000,45",
+//         "output": "prague.png", "width": 256, "height": 256 }
+std::vector<Job> loadJobs(const ThumbnailsOptions &opts)
+{
+    std::ifstream f(opts.jobs);
+    if (!f)
+        throw std::runtime_error("Failed to open jobs <" + opts.jobs + ">");
+    std::stringstream ss;
+    ss << f.rdbuf();
+    const Json::Value v = parseJson(ss.str(), "jobs");
+    if (!v.isArray() || v.empty())
+        throw std::runtime_error("Jobs must be a non-empty array");
+    std::vector<Job> r;
+    for (const Json::Value &k : v)
+    {
+        Job j;
+        const Json::Value &p = k["position"];
+        j.position = vts::Position(p.isString()
+            ? p.asString() : writeJson(p));
+        j.output = k["output"].asString();
+        j.width = k.get("width", opts.width).asUInt();
+        j.height = k.get("height", opts.height).asUInt();
+        if (j.output.empty() || j.width == 0 || j.height == 0)
+            throw std::runtime_error("Invalid output or resolution of a job");
+        r.push_back(j);
+    }
+    return r;
+}
+
+void frame(double elapsed)
+{
+    SDL_Event event;
+    while (SDL_PollEvent(&event))
+    {}
+
+    map->renderUpdate(elapsed);
+    cam->renderUpdate();
+    view->render();
+    SDL_GL_SwapWindow(window);
+}
+
+bool programOptions(ThumbnailsOptions &opts,
+    vts::MapCreateOptions &createOptions,
+    vts::MapRuntimeOptions &mapOptions,
+    vts::FetcherOptions &fetcherOptions,
+    vts::CameraOptions &camOptions,
+    int argc, char *argv[])
+{
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help", "Show this help.")
+        ("jobs",
+            po::value<std::string>(&opts.jobs),
+            "Json array of objects with position, output, "
+            "and optional width and height."
+        )
+        ("url",
+            po::value<std::string>(&opts.mapconfig)
+            ->default_value(opts.mapconfig),
+            "Mapconfig URL."
+        )
+        ("auth",
+            po::value<std::string>(&opts.auth),
+            "Authentication url."
+        )
+        ("videoDriver",
+            po::value<std::string>(&opts.videoDriver)
+            ->default_value(opts.videoDriver),
+            "SDL video driver.\n"
+            "The offscreen driver uses EGL pbuffers "
+            "and needs no display server.\n"
+            "Empty for the default driver."
+        )
+        ("width",
+            po::value<uint32>(&opts.width)
+            ->default_value(opts.width),
+            "Default width of the thumbnails."
+        )
+        ("height",
+            po::value<uint32>(&opts.height)
+            ->default_value(opts.height),
+            "Default height of the thumbnails."
+        )
+        ("jobTimeout",
+            po::value<double>(&opts.jobTimeout)
+            ->default_value(opts.jobTimeout),
+            "Seconds to wait for complete render of each job.\n"
+            "Incomplete thumbnails are written anyway."
+        )
+        ("timeout",
+            po::value<double>(&opts.timeout)
+            ->default_value(opts.timeout),
+            "Seconds to wait for the mapconfig."
+        )
+        ;
+
+    po::positional_options_description popts;
+    popts.add("jobs", 1);
+
+    vts::optionsConfigLog(desc);
+    vts::optionsConfigMapCreate(desc, &createOptions);
+    vts::optionsConfigMapRuntime(desc, &mapOptions);
+    vts::optionsConfigCamera(desc, &camOptions);
+    vts::optionsConfigFetcherOptions(desc, &fetcherOptions);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(popts).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help") || opts.jobs.empty())
+    {
+        std::cout << "Usage: " << argv[0] << " [options] [--]"
+            << " <jobs>" << std::endl << desc << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    ThumbnailsOptions opts;
+    vts::MapCreateOptions createOptions;
+    vts::MapRuntimeOptions mapOptions;
+    vts::FetcherOptions fetcherOptions;
+    vts::CameraOptions camOptions;
+    vts::NavigationOptions navOptions;
+    navOptions.type = vts::NavigationType::Instant;
+    createOptions.clientId = "vts-browser-thumbnails";
+    if (!programOptions(opts, createOptions, mapOptions, fetcherOptions,
+        camOptions, argc, argv))
+        return 0;
+    const std::vector<Job> jobs = loadJobs(opts);
+    uint32 maxWidth = 0, maxHeight = 0;
+    for (const Job &j : jobs)
+    {
+        maxWidth = std::max(maxWidth, j.width);
+        maxHeight = std::max(maxHeight, j.height);
+    }
+
+    // initialize SDL with hidden window
+    vts::log(vts::LogLevel::info3, "Initializing SDL library");
+    if (!opts.videoDriver.empty())
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, opts.videoDriver.c_str());
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0)
+    {
+        vts::log(vts::LogLevel::err4, SDL_GetError());
+        throw std::runtime_error("Failed to initialize SDL");
+    }
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 0);
+    SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 0);
+    SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 0);
+    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    // the map renders into its own framebuffers,
+    //   the window only needs to exist
+    window = SDL_CreateWindow("vts-browser-thumbnails",
+        SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+        maxWidth, maxHeight, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (!window)
+    {
+        vts::log(vts::LogLevel::err4, SDL_GetError());
+        throw std::runtime_error("Failed to create window");
+    }
+    dataContext = SDL_GL_CreateContext(window);
+    renderContext = SDL_GL_CreateContext(window);
+    SDL_GL_SetSwapInterval(0); // no v-sync
+    vts::renderer::loadGlFunctions(&SDL_GL_GetProcAddress);
+
+    context = std::make_shared<vts::renderer::RenderContext>();
+    map = std::make_shared<vts::Map>(createOptions,
+        vts::Fetcher::create(fetcherOptions));
+    map->options() = mapOptions;
+    context->bindLoadFunctions(map.get());
+    dataThread = std::thread(&dataEntry);
+    cam = map->createCamera();
+    cam->options() = camOptions;
+    nav = cam->createNavigation();
+    nav->options() = navOptions;
+    view = context->createView(cam.get());
+    // the color is read back from the texture
+    //   instead of the (possibly smaller) window
+    view->options().colorToTexture = true;
+    view->options().colorToTargetFrameBuffer = false;
+    map->setMapconfigPath(opts.mapconfig, opts.auth);
+
+    const double step = 1.0 / 60;
+    uint32 pending = 0;
+    uint32 incomplete = 0;
+    {
+        Writer writer;
+
+        // wait for the mapconfig
+        const auto start = Clock::now();
+        while (!map->getMapconfigReady())
+        {
+            if (millis(start, Clock::now()) > opts.timeout * 1000)
+                throw std::runtime_error("Timeout waiting for the mapconfig");
+            frame(step);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        for (const Job &j : jobs)
+        {
+            view->options().width = j.width;
+            view->options().height = j.height;
+            cam->setViewportSize(j.width, j.height);
+            nav->setPosition(j.position);
+            const auto t = Clock::now();
+            while (true)
+            {
+                frame(step);
+                if (map->getMapRenderComplete())
+                    break;
+                if (millis(t, Clock::now()) > opts.jobTimeout * 1000)
+                {
+                    vts::log(vts::LogLevel::warn3, "Timeout rendering <"
+                        + j.output + ">");
+                    incomplete++;
+                    break;
+                }
+            }
+
+            // the pixels arrive during some of the following frames
+            //   which already render the next job
+            pending++;
+            const std::string output = j.output;
+            view->readbackColor([&, output](const unsigned char *pixels,
+                uint32 width, uint32 height) {
+                vts::GpuTextureSpec spec;
+                spec.width = width;
+                spec.height = height;
+                spec.components = 3;
+                spec.buffer.resize(spec.expectedSize());
+                std::memcpy(spec.buffer.data(), pixels, spec.buffer.size());
+                writer.push(std::move(spec), output);
+                pending--;
+            });
+            frame(step);
+        }
+
+        // collect the remaining readbacks
+        while (pending > 0)
+            frame(step);
+    }
+
+    // release all
+    nav.reset();
+    cam.reset();
+    view.reset();
+    map->renderFinalize();
+    dataThread.join();
+    map.reset();
+    context.reset();
+    SDL_GL_DeleteContext(renderContext);
+    renderContext = nullptr;
+    SDL_DestroyWindow(window);
+    window = nullptr;
+    return incomplete > 0 ? 2 : 0;
+}
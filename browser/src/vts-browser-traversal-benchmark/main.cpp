@@ -0,0 +1,824 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// synthetic traversal benchmark
+//   generates a procedural world (mapconfig, metatiles and meshes)
+//   served from memory by a custom fetcher
+//   and measures the camera traversal in each traverse mode
+//   from a set of canned camera poses
+// nothing is downloaded and nothing is rendered,
+//   which isolates the traversal from network and gpu effects
+
+#include <vts-browser/log.hpp>
+#include <vts-browser/map.hpp>
+#include <vts-browser/mapOptions.hpp>
+#include <vts-browser/mapCallbacks.hpp>
+#include <vts-browser/mapStatistics.hpp>
+#include <vts-browser/camera.hpp>
+#include <vts-browser/cameraOptions.hpp>
+#include <vts-browser/cameraStatistics.hpp>
+#include <vts-browser/resources.hpp>
+#include <vts-browser/fetcher.hpp>
+#include <vts-browser/enumNames.hpp>
+#include <vts-browser/boostProgramOptions.hpp>
+
+#include <vts-libs/vts/tileop.hpp>
+#include <vts-libs/vts/metatile.hpp>
+#include <vts-libs/vts/mesh.hpp>
+
+#include <json/json.h>
+
+#include <array>
+#include <memory>
+#include <limits>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+typedef std::array<double, 3> Vec;
+using vtslibs::vts::TileId;
+
+const double Pi = 3.14159265358979323846;
+const double MercatorExtent = 20037508.342789244;
+const std::string UrlPrefix = "synthetic://world/";
+
+struct WorldOptions
+{
+    uint32 depth = 16; // finest lod
+    double branching = 3; // average number of children of each node (0 to 4)
+    uint32 seed = 0; // changes which children are present
+    uint32 metaBinaryOrder = 5;
+    uint32 meshGrid = 8; // quads along each side of a mesh
+    uint32 displaySize = 256;
+    double terrainAmplitude = 1000; // meters
+    double terrainWavelength = 50000; // meters
+    // geocentric: obb, disks and horizon culling are generated
+    // projected: only obb are generated
+    bool geocentric = true;
+    // without geometry extents the metanodes have no bounding volumes
+    bool geomExtents = true;
+};
+
+struct BenchmarkOptions
+{
+    std::string output;
+    std::string modes = "flat,stable,balanced,hierarchical,fixed,coherent";
+    uint32 width = 1920;
+    uint32 height = 1080;
+    uint32 frames = 100; // measured frames of each pose
+    double warmup = 30; // seconds to wait for complete render of each pose
+};
+
+struct Pose
+{
+    const char *name;
+    double x, y; // target, in the mercator srs of the tiles
+    double distance; // meters from the target
+    double pitch; // degrees above the horizon
+    double yaw; // degrees from north
+};
+
+// the tiles are in web mercator, x and y are in meters
+const Pose Poses[] = {
+    { "global", 0, 0, 20000000, 89, 0 },
+    { "continent", 1500000, 6000000, 3000000, 60, 20 },
+    { "region", 1600000, 6400000, 200000, 45, 45 },
+    { "city", 1610000, 6460000, 10000, 35, 120 },
+    { "horizon", 1612000, 6462000, 2000, 8, 250 },
+};
+
+double millis(Clock::time_point a, Clock::time_point b)
+{
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+Vec add(const Vec &a, const Vec &b)
+{
+    return { a[0] + b[0], a[1] + b[1], a[2] + b[2] };
+}
+
+Vec sub(const Vec &a, const Vec &b)
+{
+    return { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+}
+
+Vec mul(const Vec &a, double s)
+{
+    return { a[0] * s, a[1] * s, a[2] * s };
+}
+
+double dot(const Vec &a, const Vec &b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+Vec cross(const Vec &a, const Vec &b)
+{
+    return { a[1] * b[2] - a[2] * b[1],
+        a[2] * b[0] - a[0] * b[2],
+        a[0] * b[1] - a[1] * b[0] };
+}
+
+Vec normalize(const Vec &a)
+{
+    return mul(a, 1 / std::sqrt(dot(a, a)));
+}
+
+uint64 hash(uint64 x)
+{
+    // splitmix64
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// deterministic procedural world
+//   all functions are thread safe
+class World
+{
+public:
+    explicit World(const WorldOptions &o) : o(o)
+    {}
+
+    const WorldOptions o;
+
+    bool exists(const TileId &id) const
+    {
+        if (id.lod > o.depth)
+            return false;
+        if (id.lod == 0)
+            return true;
+        const TileId p = vtslibs::vts::parent(id);
+        const uint64 h = hash(((uint64)id.lod << 58)
+            ^ ((uint64)id.x << 29) ^ id.y ^ ((uint64)o.seed << 40));
+        if ((h % 4096) >= o.branching / 4 * 4096)
+            return false;
+        return exists(p);
+    }
+
+    double height(double x, double y) const
+    {
+        const double f = 2 * Pi / o.terrainWavelength;
+        return o.terrainAmplitude * std::sin(x * f) * std::sin(y * f * 0.7);
+    }
+
+    // tile extents in the mercator
+    void extents(const TileId &id, double ll[2], double ur[2]) const
+    {
+        const double s = 2 * MercatorExtent / (1u << id.lod);
+        ll[0] = -MercatorExtent + id.x * s;
+        ur[0] = ll[0] + s;
+        ur[1] = MercatorExtent - id.y * s;
+        ll[1] = ur[1] - s;
+    }
+
+    Vec physical(double x, double y, double h) const
+    {
+        if (!o.geocentric)
+            return { x, y, h };
+        // spherical mercator to wgs84 geocentric
+        const double R = 6378137;
+        const double e2 = 6.69437999014e-3;
+        const double lon = x / R;
+        const double lat = std::atan(std::sinh(y / R));
+        const double N = R / std::sqrt(1 - e2 * std::sin(lat) * std::sin(lat));
+        return { (N + h) * std::cos(lat) * std::cos(lon),
+            (N + h) * std::cos(lat) * std::sin(lon),
+            (N * (1 - e2) + h) * std::sin(lat) };
+    }
+
+    std::string mapconfig() const
+    {
+        Json::Value srses;
+        {
+            Json::Value &s = srses["pseudomerc"];
+            s["comment"] = "Spherical Mercator";
+            s["srsDef"] = "+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0"
+                " +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m"
+                " +nadgrids=@null +wktext +no_defs";
+            s["type"] = "projected";
+        }
+        if (o.geocentric)
+        {
+            Json::Value &g = srses["geocentric-wgs84"];
+            g["comment"] = "Geocentric, WGS84";
+            g["srsDef"] = "+proj=geocent +datum=WGS84 +units=m +no_defs";
+            g["type"] = "cartesian";
+            Json::Value &n = srses["geographic-wgs84"];
+            n["comment"] = "Geographic, WGS84";
+            n["srsDef"] = "+proj=longlat +datum=WGS84 +no_defs";
+            n["type"] = "geographic";
+        }
+
+        Json::Value rf;
+        rf["version"] = 1;
+        rf["id"] = "synthetic";
+        rf["description"] = "Synthetic reference frame";
+        {
+            Json::Value &m = rf["model"];
+            m["physicalSrs"] = o.geocentric ? "geocentric-wgs84" : "pseudomerc";
+            m["navigationSrs"] = o.geocentric ? "geographic-wgs84" : "pseudomerc";
+            m["publicSrs"] = o.geocentric ? "geographic-wgs84" : "pseudomerc";
+        }
+        {
+            Json::Value &d = rf["division"];
+            const double e = o.geocentric ? 7000000 : MercatorExtent;
+            const double h = o.geocentric ? 7000000 : o.terrainAmplitude * 2;
+            d["extents"]["ll"] = array3(-e, -e, -h);
+            d["extents"]["ur"] = array3(e, e, h);
+            d["heightRange"].append(-o.terrainAmplitude * 2);
+            d["heightRange"].append(o.terrainAmplitude * 2);
+            Json::Value n;
+            n["id"]["lod"] = 0;
+            n["id"]["position"].append(0);
+            n["id"]["position"].append(0);
+            n["srs"] = "pseudomerc";
+            n["extents"]["ll"].append(-MercatorExtent);
+            n["extents"]["ll"].append(-MercatorExtent);
+            n["extents"]["ur"].append(MercatorExtent);
+            n["extents"]["ur"].append(MercatorExtent);
+            n["partitioning"] = "bisection";
+            d["nodes"].append(n);
+        }
+        rf["parameters"]["metaBinaryOrder"] = o.metaBinaryOrder;
+        rf["parameters"]["navDelta"] = 1;
+
+        Json::Value surface;
+        surface["id"] = "synthetic";
+        surface["revision"] = 0;
+        surface["lodRange"].append(0);
+        surface["lodRange"].append(o.depth);
+        {
+            Json::Value r(Json::arrayValue);
+            r.append(0);
+            r.append(0);
+            surface["tileRange"].append(r);
+            surface["tileRange"].append(r);
+        }
+        surface["metaUrl"] = UrlPrefix + "meta/{lod}-{x}-{y}.meta";
+        surface["meshUrl"] = UrlPrefix + "mesh/{lod}-{x}-{y}.bin";
+        surface["textureUrl"] = UrlPrefix + "texture/{lod}-{x}-{y}-{sub}.jpg";
+        surface["navUrl"] = UrlPrefix + "nav/{lod}-{x}-{y}.nav";
+
+        Json::Value mc;
+        mc["version"] = 1;
+        mc["srses"] = srses;
+        mc["referenceFrame"] = rf;
+        mc["credits"] = Json::objectValue;
+        mc["boundLayers"] = Json::objectValue;
+        mc["freeLayers"] = Json::objectValue;
+        mc["surfaces"].append(surface);
+        mc["glue"] = Json::arrayValue;
+        mc["view"]["surfaces"]["synthetic"] = Json::arrayValue;
+        mc["view"]["freeLayers"] = Json::objectValue;
+        mc["namedViews"] = Json::objectValue;
+        {
+            Json::Value &p = mc["position"];
+            p.append("obj");
+            p.append(0);
+            p.append(0);
+            p.append("fix");
+            p.append(0);
+            p.append(0);
+            p.append(-90);
+            p.append(0);
+            p.append(20000000);
+            p.append(45);
+        }
+        Json::StreamWriterBuilder builder;
+        return Json::writeString(builder, mc);
+    }
+
+    // one metatile contains tiles of single lod
+    std::string metatile(const TileId &origin) const
+    {
+        vtslibs::vts::MetaTile mt(origin, o.metaBinaryOrder);
+        const uint32 size = std::min(1u << o.metaBinaryOrder,
+            1u << origin.lod);
+        for (uint32 y = 0; y < size; y++)
+        {
+            for (uint32 x = 0; x < size; x++)
+            {
+                const TileId id(origin.lod, origin.x + x, origin.y + y);
+                if (!exists(id))
+                    continue;
+                vtslibs::vts::MetaNode node;
+                node.geometry(true);
+                node.applyDisplaySize(true);
+                node.displaySize = o.displaySize;
+                if (o.geomExtents)
+                {
+                    double zmin, zmax;
+                    heights(id, zmin, zmax);
+                    node.geomExtents.z.min = zmin;
+                    node.geomExtents.z.max = zmax;
+                    double ll[2], ur[2];
+                    extents(id, ll, ur);
+                    node.geomExtents.surrogate = height(
+                        (ll[0] + ur[0]) * 0.5, (ll[1] + ur[1]) * 0.5);
+                }
+                for (const TileId &c : vtslibs::vts::children(id))
+                    if (exists(c))
+                        node.setChildFromId(c);
+                mt.set(id, node);
+            }
+        }
+        std::ostringstream ss;
+        mt.save(ss);
+        return ss.str();
+    }
+
+    // regular grid following the terrain, without texture coordinates
+    std::string mesh(const TileId &id) const
+    {
+        double ll[2], ur[2];
+        extents(id, ll, ur);
+        const uint32 g = o.meshGrid;
+        vtslibs::vts::SubMesh sm;
+        sm.vertices.reserve((g + 1) * (g + 1));
+        for (uint32 j = 0; j <= g; j++)
+        {
+            for (uint32 i = 0; i <= g; i++)
+            {
+                const double x = ll[0] + (ur[0] - ll[0]) * i / g;
+                const double y = ll[1] + (ur[1] - ll[1]) * j / g;
+                const Vec p = physical(x, y, height(x, y));
+                sm.vertices.push_back(math::Point3(p[0], p[1], p[2]));
+            }
+        }
+        sm.faces.reserve(g * g * 2);
+        for (uint32 j = 0; j < g; j++)
+        {
+            for (uint32 i = 0; i < g; i++)
+            {
+                const uint32 a = j * (g + 1) + i;
+                const uint32 b = a + 1;
+                const uint32 c = a + g + 1;
+                const uint32 d = c + 1;
+                sm.faces.emplace_back(a, b, d);
+                sm.faces.emplace_back(a, d, c);
+            }
+        }
+        vtslibs::vts::Mesh mesh;
+        mesh.submeshes.push_back(sm);
+        std::ostringstream ss;
+        vtslibs::vts::saveMesh(ss, mesh);
+        return ss.str();
+    }
+
+private:
+    static Json::Value array3(double a, double b, double c)
+    {
+        Json::Value r(Json::arrayValue);
+        r.append(a);
+        r.append(b);
+        r.append(c);
+        return r;
+    }
+
+    // exact range of the mesh, which samples the terrain at the grid
+    void heights(const TileId &id, double &zmin, double &zmax) const
+    {
+        double ll[2], ur[2];
+        extents(id, ll, ur);
+        const uint32 g = o.meshGrid;
+        zmin = std::numeric_limits<double>::infinity();
+        zmax = -zmin;
+        for (uint32 j = 0; j <= g; j++)
+        {
+            for (uint32 i = 0; i <= g; i++)
+            {
+                const double h = height(ll[0] + (ur[0] - ll[0]) * i / g,
+                    ll[1] + (ur[1] - ll[1]) * j / g);
+                zmin = std::min(zmin, h);
+                zmax = std::max(zmax, h);
+            }
+        }
+    }
+};
+
+// answers every query from the world, synchronously on the fetcher thread
+class SyntheticFetcher : public vts::Fetcher
+{
+public:
+    explicit SyntheticFetcher(const World &world) : world(world)
+    {}
+
+    void fetch(const std::shared_ptr<vts::FetchTask> &task) override
+    {
+        auto &reply = task->reply;
+        try
+        {
+            reply.content = vts::Buffer(generate(task->query.url));
+            reply.code = 200;
+        }
+        catch (const std::exception &e)
+        {
+            vts::log(vts::LogLevel::warn2, "Synthetic <"
+                + task->query.url + "> not available: " + e.what());
+            reply.content = vts::Buffer();
+            reply.code = 404;
+        }
+        reply.expires = -1;
+        task->fetchDone();
+    }
+
+private:
+    std::string generate(const std::string &url) const
+    {
+        if (url.compare(0, UrlPrefix.size(), UrlPrefix) != 0)
+            throw std::runtime_error("unknown scheme");
+        const std::string path = url.substr(UrlPrefix.size());
+        if (path == "mapconfig.json")
+            return world.mapconfig();
+        char kind[16];
+        uint32 lod, x, y;
+        if (std::sscanf(path.c_str(), "%15[a-z]/%u-%u-%u",
+            kind, &lod, &x, &y) != 4)
+            throw std::runtime_error("invalid path");
+        const TileId id(lod, x, y);
+        if (!world.exists(id))
+            throw std::runtime_error("tile does not exist");
+        if (std::string(kind) == "meta")
+            return world.metatile(id);
+        if (std::string(kind) == "mesh")
+            return world.mesh(id);
+        throw std::runtime_error("not generated");
+    }
+
+    const World &world;
+};
+
+// the loaded resources are never rendered
+void bindLoadFunctions(vts::Map *map)
+{
+    vts::MapCallbacks &c = map->callbacks();
+    c.loadMesh = [](vts::ResourceInfo &info, vts::GpuMeshSpec &spec,
+        const std::string &) {
+        info.userData = std::make_shared<int>(0);
+        info.gpuMemoryCost = spec.vertices.size() + spec.indices.size();
+    };
+    c.loadTexture = [](vts::ResourceInfo &info, vts::GpuTextureSpec &spec,
+        const std::string &) {
+        info.userData = std::make_shared<int>(0);
+        info.gpuMemoryCost = spec.buffer.size();
+    };
+    c.loadFont = [](vts::ResourceInfo &info, vts::GpuFontSpec &,
+        const std::string &) {
+        info.userData = std::make_shared<int>(0);
+    };
+    c.loadGeodata = [](vts::ResourceInfo &info, vts::GpuGeodataSpec &,
+        const std::string &) {
+        info.userData = std::make_shared<int>(0);
+    };
+}
+
+void setPose(const World &world, vts::Camera *cam, const Pose &pose)
+{
+    const double h = world.height(pose.x, pose.y);
+    const Vec target = world.physical(pose.x, pose.y, h);
+    const Vec up = world.o.geocentric ? normalize(target) : Vec{ 0, 0, 1 };
+    Vec north = sub(world.physical(pose.x, pose.y + 1, h), target);
+    north = normalize(sub(north, mul(up, dot(north, up))));
+    const Vec east = cross(north, up);
+    const double yaw = pose.yaw * Pi / 180;
+    const double pitch = pose.pitch * Pi / 180;
+    const Vec ahead = add(mul(north, std::cos(yaw)), mul(east, std::sin(yaw)));
+    const Vec back = add(mul(ahead, -std::cos(pitch)),
+        mul(up, std::sin(pitch)));
+    const Vec eye = add(target, mul(back, pose.distance));
+    const Vec right = cross(ahead, up);
+    const Vec camUp = normalize(cross(right, mul(back, -1)));
+    cam->setView(eye, target, camUp);
+    double near_, far_;
+    cam->suggestedNearFar(near_, far_);
+    cam->setProj(45, near_, far_);
+}
+
+Json::Value summary(std::vector<double> v)
+{
+    Json::Value r(Json::objectValue);
+    if (v.empty())
+        return r;
+    std::sort(v.begin(), v.end());
+    double sum = 0;
+    for (double d : v)
+        sum += d;
+    const auto &percentile = [&](double p) {
+        return v[std::min<std::size_t>(v.size() - 1,
+            (std::size_t)(p * v.size()))];
+    };
+    r["mean"] = sum / v.size();
+    r["p50"] = percentile(0.5);
+    r["p95"] = percentile(0.95);
+    r["p99"] = percentile(0.99);
+    r["max"] = v.back();
+    return r;
+}
+
+std::string writeJson(const Json::Value &v, bool pretty)
+{
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = pretty ? "  " : "";
+    return Json::writeString(builder, v);
+}
+
+Json::Value parseJson(const std::string &str)
+{
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value v;
+    std::string errs;
+    if (!reader->parse(str.data(), str.data() + str.size(), &v, &errs))
+        throw std::runtime_error("Failed to parse statistics: " + errs);
+    return v;
+}
+
+// each mode runs in a fresh map
+//   so that the traverse trees are not shared between the modes
+Json::Value measureMode(const World &world, const BenchmarkOptions &opts,
+    const vts::MapCreateOptions &createOptions,
+    const vts::MapRuntimeOptions &mapOptions,
+    vts::CameraOptions camOptions, vts::TraverseMode mode)
+{
+    auto map = std::make_shared<vts::Map>(createOptions,
+        std::make_shared<SyntheticFetcher>(world));
+    map->options() = mapOptions;
+    bindLoadFunctions(map.get());
+    std::thread dataThread([&]() {
+        vts::setLogThreadName("data");
+        map->dataAllRun();
+    });
+    auto cam = map->createCamera();
+    camOptions.traverseModeSurfaces = mode;
+    cam->options() = camOptions;
+    cam->setViewportSize(opts.width, opts.height);
+    map->setMapconfigPath(UrlPrefix + "mapconfig.json");
+
+    const double step = 1.0 / 60;
+    const auto &frame = [&]() {
+        map->renderUpdate(step);
+        cam->renderUpdate();
+    };
+
+    Json::Value result;
+    {
+        const auto start = Clock::now();
+        while (!map->getMapconfigReady())
+        {
+            if (millis(start, Clock::now()) > opts.warmup * 1000)
+                throw std::runtime_error("Timeout waiting for the mapconfig");
+            map->renderUpdate(step);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    for (const Pose &pose : Poses)
+    {
+        setPose(world, cam.get(), pose);
+
+        // the resources are loaded before the measurement
+        const auto warm = Clock::now();
+        bool warmupComplete = false;
+        while (millis(warm, Clock::now()) < opts.warmup * 1000)
+        {
+            frame();
+            if (map->getMapRenderComplete())
+            {
+                warmupComplete = true;
+                break;
+            }
+        }
+        const double warmupTime = millis(warm, Clock::now()) * 1e-3;
+
+        std::vector<double> update, traversal;
+        update.reserve(opts.frames);
+        traversal.reserve(opts.frames);
+        for (uint32 i = 0; i < opts.frames; i++)
+        {
+            map->renderUpdate(step);
+            const auto t0 = Clock::now();
+            cam->renderUpdate();
+            const auto t1 = Clock::now();
+            update.push_back(millis(t0, t1));
+            traversal.push_back(cam->statistics().timeTraversal);
+        }
+
+        const vts::CameraStatistics &cs = cam->statistics();
+        Json::Value &r = result[pose.name];
+        r["warmupTime"] = warmupTime;
+        r["warmupComplete"] = warmupComplete;
+        r["cameraUpdate"] = summary(update);
+        r["traversal"] = summary(traversal);
+        r["nodesRendered"] = cs.nodesRenderedTotal;
+        r["metaNodesTraversed"] = cs.metaNodesTraversedTotal;
+        r["nodesOccluded"] = cs.nodesOccludedTotal;
+        r["nodesBeyondHorizon"] = cs.nodesBeyondHorizonTotal;
+    }
+    result["mapStatistics"] = parseJson(map->statistics().toJson());
+
+    cam.reset();
+    map->renderFinalize();
+    dataThread.join();
+    return result;
+}
+
+std::vector<vts::TraverseMode> parseModes(const std::string &list)
+{
+    std::vector<vts::TraverseMode> r;
+    std::stringstream ss(list);
+    std::string name;
+    while (std::getline(ss, name, ','))
+    {
+        vts::TraverseMode m;
+        std::stringstream ms(name);
+        if (!(ms >> m) || m == vts::TraverseMode::None)
+            throw std::runtime_error("Invalid traverse mode <" + name + ">");
+        r.push_back(m);
+    }
+    if (r.empty())
+        throw std::runtime_error("No traverse modes");
+    return r;
+}
+
+bool programOptions(BenchmarkOptions &opts, WorldOptions &world,
+    vts::MapCreateOptions &createOptions,
+    vts::MapRuntimeOptions &mapOptions,
+    vts::CameraOptions &camOptions,
+    int argc, char *argv[])
+{
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help", "Show this help.")
+        ("output,o",
+            po::value<std::string>(&opts.output),
+            "Output json file, standard output if empty."
+        )
+        ("modes",
+            po::value<std::string>(&opts.modes)
+            ->default_value(opts.modes),
+            "Comma separated list of traverse modes to measure."
+        )
+        ("width",
+            po::value<uint32>(&opts.width)
+            ->default_value(opts.width),
+            "Viewport width."
+        )
+        ("height",
+            po::value<uint32>(&opts.height)
+            ->default_value(opts.height),
+            "Viewport height."
+        )
+        ("frames",
+            po::value<uint32>(&opts.frames)
+            ->default_value(opts.frames),
+            "Measured frames of each camera pose."
+        )
+        ("warmup",
+            po::value<double>(&opts.warmup)
+            ->default_value(opts.warmup),
+            "Seconds to wait for complete render of each camera pose."
+        )
+        ("depth",
+            po::value<uint32>(&world.depth)
+            ->default_value(world.depth),
+            "Finest lod of the synthetic tiles."
+        )
+        ("branching",
+            po::value<double>(&world.branching)
+            ->default_value(world.branching),
+            "Average number of children of each tile, 0 to 4."
+        )
+        ("seed",
+            po::value<uint32>(&world.seed)
+            ->default_value(world.seed),
+            "Changes which children are present."
+        )
+        ("meshGrid",
+            po::value<uint32>(&world.meshGrid)
+            ->default_value(world.meshGrid),
+            "Number of quads along each side of a mesh."
+        )
+        ("geocentric",
+            po::value<bool>(&world.geocentric)
+            ->default_value(world.geocentric),
+            "Geocentric physical srs (obb, disks and horizon culling), "
+            "otherwise projected (obb only)."
+        )
+        ("geomExtents",
+            po::value<bool>(&world.geomExtents)
+            ->default_value(world.geomExtents),
+            "Generate geometry extents of the metanodes.\n"
+            "Without them, the nodes have no bounding volumes."
+        )
+        ;
+
+    vts::optionsConfigLog(desc);
+    vts::optionsConfigMapCreate(desc, &createOptions);
+    vts::optionsConfigMapRuntime(desc, &mapOptions);
+    vts::optionsConfigCamera(desc, &camOptions);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << "Usage: " << argv[0] << " [options]"
+            << std::endl << desc << std::endl;
+        return false;
+    }
+    if (opts.frames == 0 || opts.width == 0 || opts.height == 0)
+        throw std::runtime_error("Invalid frames or resolution");
+    if (world.depth > 22 || world.branching < 0 || world.branching > 4
+        || world.meshGrid == 0)
+        throw std::runtime_error("Invalid depth, branching or mesh grid");
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions opts;
+    WorldOptions worldOptions;
+    vts::MapCreateOptions createOptions;
+    vts::MapRuntimeOptions mapOptions;
+    vts::CameraOptions camOptions;
+    createOptions.clientId = "vts-browser-traversal-benchmark";
+    createOptions.diskCache = false;
+    if (!programOptions(opts, worldOptions, createOptions, mapOptions,
+        camOptions, argc, argv))
+        return 0;
+    const std::vector<vts::TraverseMode> modes = parseModes(opts.modes);
+    const World world(worldOptions);
+
+    Json::Value report;
+    {
+        Json::Value &w = report["world"];
+        w["depth"] = worldOptions.depth;
+        w["branching"] = worldOptions.branching;
+        w["seed"] = worldOptions.seed;
+        w["meshGrid"] = worldOptions.meshGrid;
+        w["geocentric"] = worldOptions.geocentric;
+        w["geomExtents"] = worldOptions.geomExtents;
+    }
+    report["width"] = opts.width;
+    report["height"] = opts.height;
+    report["frames"] = opts.frames;
+    for (vts::TraverseMode m : modes)
+    {
+        std::stringstream ss;
+        ss << m;
+        vts::log(vts::LogLevel::info3, "Measuring <" + ss.str() + ">");
+        report["modes"][ss.str()] = measureMode(world, opts,
+            createOptions, mapOptions, camOptions, m);
+    }
+
+    const std::string out = writeJson(report, true);
+    if (opts.output.empty())
+        std::cout << out << std::endl;
+    else
+    {
+        std::ofstream f(opts.output);
+        f << out << std::endl;
+        if (!f)
+            throw std::runtime_error("Failed to write <" + opts.output + ">");
+    }
+    return 0;
+}
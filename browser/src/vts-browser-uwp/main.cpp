@@ -50,6 +50,7 @@
 
 
 #include <vector>
+#include <atomic>
 #include <agile.h>
 
 
@@ -92,6 +93,7 @@ public:
     virtual void Initialize(Windows::ApplicationModel::Core::CoreApplicationView ^applicationView)
     {
         applicationView->Activated += ref new TypedEventHandler<CoreApplicationView^, IActivatedEventArgs^>(this, &THISCLASS::OnActivated);
+        MemoryManager::AppMemoryUsageIncreased += ref new EventHandler<Object^>(this, &THISCLASS::OnAppMemoryUsageIncreased);
     }
 
     virtual void SetWindow(Windows::UI::Core::CoreWindow ^window)
@@ -147,6 +149,23 @@ public:
         isWindowClosed = true;
     }
 
+    void OnAppMemoryUsageIncreased(Object ^sender, Object ^args)
+    {
+        // the event comes from another thread
+        //   the map is notified in UpdateVts
+        switch (MemoryManager::AppMemoryUsageLevel)
+        {
+        case AppMemoryUsageLevel::High:
+            pendingMemoryPressure = (int)vts::MemoryPressure::Severe;
+            break;
+        case AppMemoryUsageLevel::OverLimit:
+            pendingMemoryPressure = (int)vts::MemoryPressure::Critical;
+            break;
+        default:
+            break;
+        }
+    }
+
     void OnSizeChanged(CoreWindow ^sender, WindowSizeChangedEventArgs ^args)
     {
         // why is this not called when the window is created?
@@ -156,6 +175,7 @@ public:
 
 private:
     bool isWindowClosed, isWindowVisible;
+    std::atomic<int> pendingMemoryPressure{ -1 };
     Platform::Agile<CoreWindow> hWnd;
 
     static THISCLASS ^CurrentView;
@@ -209,6 +229,11 @@ void SingleWindowAppView::UpdateVts()
 {
     // todo input handling
     map->dataUpdate();
+    {
+        int p = pendingMemoryPressure.exchange(-1);
+        if (p >= 0)
+            map->memoryPressure((vts::MemoryPressure)p);
+    }
     map->renderUpdate(0); // todo elapsed time
     camera->setViewportSize(width, height);
     camera->renderUpdate();
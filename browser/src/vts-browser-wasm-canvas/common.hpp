@@ -37,6 +37,8 @@
 #include <emscripten/html5.h>
 #include <emscripten/threading.h>
 
+#include <atomic>
+
 
 using vts::vec3;
 
@@ -47,6 +49,35 @@ std::string positionToHtml(const vts::Position &pos);
 void setHtml(const char *id, const std::string &value);
 void setInputValue(const char *id, const std::string &value);
 
+// statistics and camera state shared with the page
+//   updated every frame, the page reads them directly
+//   from the wasm memory as Float64Array (see getLiveState)
+//   without any string building
+enum LiveStateIndex
+{
+    LiveMainFrameAvg, LiveMainFrameMax,
+    LiveMainMapAvg, LiveMainMapMax,
+    LiveMainCameraAvg, LiveMainCameraMax,
+    LiveRenderFrameAvg, LiveRenderFrameMax,
+    LiveRenderDataAvg, LiveRenderDataMax,
+    LiveRenderRenderAvg, LiveRenderRenderMax,
+    LiveRenderTicks,
+    LiveResourcesActive, LiveResourcesDownloading,
+    LiveResourcesQueueDecode, LiveResourcesQueueUpload,
+    LiveGpuMemUseKB, LiveRamMemUseKB,
+    LiveNodesRendered, LiveMetaNodesTraversed,
+    LiveTimeTraversal,
+    LivePositionX, LivePositionY, LivePositionZ,
+    LiveRotationX, LiveRotationY, LiveRotationZ,
+    LiveViewExtent, LiveFov,
+    LiveStateCount
+};
+extern double liveState[LiveStateCount];
+extern const char *liveStateNames[LiveStateCount];
+
+// the html panels are generated only when the page asks for them
+extern std::atomic<bool> panelsRefreshRequested;
+
 EM_BOOL mouseEvent(int, const EmscriptenMouseEvent *e, void *);
 EM_BOOL wheelEvent(int, const EmscriptenWheelEvent *e, void *);
 EM_BOOL resizeEvent(int, const EmscriptenUiEvent *e, void *);
@@ -232,6 +232,30 @@ extern "C" EMSCRIPTEN_KEEPALIVE void applyOptions(const char *json)
     view->options().applyJson(json);
 }
 
+extern "C" EMSCRIPTEN_KEEPALIVE const double *getLiveState()
+{
+    return liveState;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE const char *getLiveStateNames()
+{
+    // NOT REENTRANT!!, for JS interop only
+    static std::string result;
+    result = "";
+    for (int i = 0; i < LiveStateCount; i++)
+    {
+        if (i)
+            result += ",";
+        result += liveStateNames[i];
+    }
+    return result.c_str();
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE void refreshPanels()
+{
+    panelsRefreshRequested = true;
+}
+
 extern "C" EMSCRIPTEN_KEEPALIVE const char *getOptions()
 {
     if (!map)
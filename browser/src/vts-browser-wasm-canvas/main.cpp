@@ -33,6 +33,7 @@
 #include <vts-browser/cameraCredits.hpp>
 
 #include <iomanip>
+#include <algorithm>
 
 std::shared_ptr<vts::Map> map;
 std::shared_ptr<vts::Camera> cam;
@@ -43,46 +44,72 @@ pthread_t main_thread_id;
 
 DurationBuffer durationMainFrame, durationMainMap, durationMainCamera;
 
+double liveState[LiveStateCount];
+const char *liveStateNames[LiveStateCount] = {
+    "mainFrameAvg", "mainFrameMax",
+    "mainMapAvg", "mainMapMax",
+    "mainCameraAvg", "mainCameraMax",
+    "renderFrameAvg", "renderFrameMax",
+    "renderDataAvg", "renderDataMax",
+    "renderRenderAvg", "renderRenderMax",
+    "renderTicks",
+    "resourcesActive", "resourcesDownloading",
+    "resourcesQueueDecode", "resourcesQueueUpload",
+    "gpuMemUseKB", "ramMemUseKB",
+    "nodesRendered", "metaNodesTraversed",
+    "timeTraversal",
+    "positionX", "positionY", "positionZ",
+    "rotationX", "rotationY", "rotationZ",
+    "viewExtent", "fov",
+};
+std::atomic<bool> panelsRefreshRequested;
+
 namespace
 {
 
 TimerPoint lastFrameTimestamp;
+std::string lastCredits;
 
-void updateStatisticsHtml()
+// the page may read the values while they are written
+//   each value is written atomically, the set as a whole is not
+void updateLiveState()
 {
-    // timing
+    const vts::MapStatistics &ms = map->statistics();
+    const vts::CameraStatistics &cs = cam->statistics();
+    double *s = liveState;
+    s[LiveMainFrameAvg] = durationMainFrame.avg();
+    s[LiveMainFrameMax] = durationMainFrame.max();
+    s[LiveMainMapAvg] = durationMainMap.avg();
+    s[LiveMainMapMax] = durationMainMap.max();
+    s[LiveMainCameraAvg] = durationMainCamera.avg();
+    s[LiveMainCameraMax] = durationMainCamera.max();
+    s[LiveRenderFrameAvg] = durationRenderFrame.avg();
+    s[LiveRenderFrameMax] = durationRenderFrame.max();
+    s[LiveRenderDataAvg] = durationRenderData.avg();
+    s[LiveRenderDataMax] = durationRenderData.max();
+    s[LiveRenderRenderAvg] = durationRenderRender.avg();
+    s[LiveRenderRenderMax] = durationRenderRender.max();
+    s[LiveRenderTicks] = ms.renderTicks;
+    s[LiveResourcesActive] = ms.resourcesActive;
+    s[LiveResourcesDownloading] = ms.resourcesDownloading;
+    s[LiveResourcesQueueDecode] = ms.resourcesQueueDecode;
+    s[LiveResourcesQueueUpload] = ms.resourcesQueueUpload;
+    s[LiveGpuMemUseKB] = ms.currentGpuMemUseKB;
+    s[LiveRamMemUseKB] = ms.currentRamMemUseKB;
+    s[LiveNodesRendered] = cs.nodesRenderedTotal;
+    s[LiveMetaNodesTraversed] = cs.metaNodesTraversedTotal;
+    s[LiveTimeTraversal] = cs.timeTraversal;
+    if (map->getMapconfigAvailable())
     {
-        std::stringstream ss;
-        ss << std::fixed << std::setprecision(1);
-        ss << "<table>";
-        ss << "<tr><td>main frame<td class=number><b>"
-           << durationMainFrame.avg()
-           << "</b><td class=number>"
-           << durationMainFrame.max() << "</tr>";
-        ss << "<tr><td>main map<td class=number>"
-           << durationMainMap.avg()
-           << "<td class=number>"
-           << durationMainMap.max() << "</tr>";
-        ss << "<tr><td>main camera<td class=number>"
-           << durationMainCamera.avg()
-           << "<td class=number>"
-           << durationMainCamera.max() << "</tr>";
-        ss << "<tr><td>render frame<td class=number><b>"
-           << durationRenderFrame.avg()
-           << "</b><td class=number>"
-           << durationRenderFrame.max() << "</tr>";
-        ss << "<tr><td>render data<td class=number>"
-           << durationRenderData.avg()
-           << "<td class=number>"
-           << durationRenderData.max() << "</tr>";
-        ss << "<tr><td>render render<td class=number>"
-           << durationRenderRender.avg()
-           << "<td class=number>"
-           << durationRenderRender.max() << "</tr>";
-        ss << "</table>";
-        setHtml("statisticsTiming", ss.str());
+        nav->getPoint(s + LivePositionX);
+        nav->getRotation(s + LiveRotationX);
+        s[LiveViewExtent] = nav->getViewExtent();
+        s[LiveFov] = nav->getFov();
     }
+}
 
+void updatePanelsHtml()
+{
     // statistics
     setHtml("statisticsMap",
             jsonToHtml(map->statistics().toJson()));
@@ -90,12 +117,21 @@ void updateStatisticsHtml()
             jsonToHtml(cam->statistics().toJson()));
 
     // position
-    vts::Position pos = nav->getPosition();
-    setInputValue("positionCurrent", pos.toUrl());
-    setHtml("positionTable", positionToHtml(pos));
+    if (map->getMapconfigAvailable())
+    {
+        vts::Position pos = nav->getPosition();
+        setInputValue("positionCurrent", pos.toUrl());
+        setHtml("positionTable", positionToHtml(pos));
+    }
+}
 
-    // credits
-    setHtml("credits", cam->credits().textShort());
+void updateCredits()
+{
+    std::string credits = cam->credits().textShort();
+    if (credits == lastCredits)
+        return;
+    lastCredits = credits;
+    setHtml("credits", credits);
 }
 
 void mapconfAvailable()
@@ -175,8 +211,11 @@ void loopIteration()
 
     durationMainMap.update(a, b);
     durationMainCamera.update(b, c);
+    updateLiveState();
+    if (panelsRefreshRequested.exchange(false))
+        updatePanelsHtml();
     if ((map->statistics().renderTicks % DurationBuffer::N) == 0)
-        updateStatisticsHtml();
+        updateCredits();
 }
 
 } // namespace
@@ -189,7 +228,13 @@ int main(int, char *[])
 
     // initialize browser and renderer
     vts::log(vts::LogLevel::info3, "Creating vts browser");
-    map = std::make_shared<vts::Map>();
+    {
+        // the decoding runs in the web workers from the pthread pool
+        vts::MapCreateOptions opts;
+        opts.decodeThreads = std::max(std::min(
+            emscripten_num_logical_cores() - 1, 4), 1);
+        map = std::make_shared<vts::Map>(opts);
+    }
     cam = map->createCamera();
     nav = cam->createNavigation();
     map->callbacks().mapconfigAvailable = &mapconfAvailable;
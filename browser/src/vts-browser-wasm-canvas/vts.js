@@ -146,6 +146,49 @@ function positionToClipboard()
     document.execCommand("copy")
 }
 
+// live statistics
+//   read directly from the wasm memory
+//   the html panels are refreshed only while they are visible
+var refreshPanelsCpp
+var liveStatePtr = 0
+var liveStateNames = []
+function liveState()
+{
+    // the view is created anew, the memory may have grown
+    let view = new Float64Array(Module.HEAPF64.buffer, liveStatePtr, liveStateNames.length)
+    let res = {}
+    for (let i = 0; i < liveStateNames.length; i++)
+        res[liveStateNames[i]] = view[i]
+    return res
+}
+function visibleElement(id)
+{
+    return document.getElementById(id).style.display === "block"
+}
+function updateTiming(s)
+{
+    let rows = [ "mainFrame", "mainMap", "mainCamera", "renderFrame", "renderData", "renderRender" ]
+    let html = "<table>"
+    rows.forEach(function(r)
+    {
+        html += "<tr><td>" + r + "<td class=number>" + s[r + "Avg"].toFixed(1)
+            + "<td class=number>" + s[r + "Max"].toFixed(1) + "</tr>"
+    })
+    html += "</table>"
+    document.getElementById("statisticsTiming").innerHTML = html
+}
+function updatePanels()
+{
+    if (!liveStatePtr)
+        return
+    let statistics = visibleElement("statisticsWindow")
+    if (statistics && visibleElement("statisticsTiming"))
+        updateTiming(liveState())
+    if (statistics || visibleElement("viewWindow"))
+        refreshPanelsCpp()
+}
+setInterval(updatePanels, 500)
+
 // parse url parameters
 var queryString = {}
 {
@@ -175,6 +218,9 @@ var Module =
         gotoPositionCpp = Module.cwrap("gotoPosition", null, ["number", "number", "number", "number"])
         applyOptionsCpp = Module.cwrap("applyOptions", null, ["string"])
         getOptionsCpp = Module.cwrap("getOptions", "string", null)
+        refreshPanelsCpp = Module.cwrap("refreshPanels", null, null)
+        liveStateNames = Module.cwrap("getLiveStateNames", "string", null)().split(",")
+        liveStatePtr = Module.cwrap("getLiveState", "number", null)()
     },
     onMapCreated: function()
     {
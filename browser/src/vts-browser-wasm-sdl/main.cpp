@@ -26,13 +26,17 @@
 
 #include <vts-browser/log.hpp>
 #include <vts-browser/map.hpp>
+#include <vts-browser/mapOptions.hpp>
 #include <vts-browser/camera.hpp>
 #include <vts-browser/navigation.hpp>
 #include <vts-renderer/renderer.hpp>
 
 #include <emscripten.h>
+#include <emscripten/threading.h>
 #include <SDL2/SDL.h>
 
+#include <algorithm>
+
 SDL_Window *window;
 SDL_GLContext renderContext;
 std::shared_ptr<vts::Map> map;
@@ -125,7 +129,13 @@ int main(int, char *[])
 
     // initialize browser and renderer
     vts::log(vts::LogLevel::info3, "Creating browser map");
-    map = std::make_shared<vts::Map>();
+    {
+        // the decoding runs in the web workers from the pthread pool
+        vts::MapCreateOptions opts;
+        opts.decodeThreads = std::max(std::min(
+            emscripten_num_logical_cores() - 1, 4), 1);
+        map = std::make_shared<vts::Map>(opts);
+    }
     context = std::make_shared<vts::renderer::RenderContext>();
     context->bindLoadFunctions(map.get());
     cam = map->createCamera();
@@ -120,6 +120,14 @@ namespace vts
             return Util.CheckString(BrowserInterop.vtsCameraGetStatistics(Handle));
         }
 
+        public unsafe CameraStatistics GetStatisticsStruct()
+        {
+            CameraStatistics s;
+            BrowserInterop.vtsCameraGetStatisticsStruct(Handle, (IntPtr)(&s));
+            Util.CheckInterop();
+            return s;
+        }
+
         public string GetCredits()
         {
             return Util.CheckString(BrowserInterop.vtsCameraGetCredits(Handle));
@@ -147,6 +155,13 @@ namespace vts
             Util.CheckInterop();
         }
 
+        public bool NeedsRedraw()
+        {
+            bool res = BrowserInterop.vtsCameraNeedsRedraw(Handle);
+            Util.CheckInterop();
+            return res;
+        }
+
         public void Dispose()
         {
             Dispose(true);
@@ -30,34 +30,37 @@ using System.Runtime.InteropServices;
 
 namespace vts
 {
+    // the bases are blittable (fixed buffers)
+    //   they are copied from the native memory without any marshalling
+
     [StructLayout(LayoutKind.Sequential)]
-    public struct CameraBase
+    public unsafe struct CameraBase
     {
-        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 16)] public double[] view;
-        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 16)] public double[] proj;
-        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 3)] public double[] eye;
-        [MarshalAs(UnmanagedType.R8)] public double targetDistance;
-        [MarshalAs(UnmanagedType.R8)] public double viewExtent;
-        [MarshalAs(UnmanagedType.R8)] public double altitudeOverEllipsoid;
-        [MarshalAs(UnmanagedType.R8)] public double altitudeOverSurface;
+        public fixed double view[16];
+        public fixed double proj[16];
+        public fixed double eye[3];
+        public double targetDistance;
+        public double viewExtent;
+        public double altitudeOverEllipsoid;
+        public double altitudeOverSurface;
     }
 
     [StructLayout(LayoutKind.Sequential)]
-    public struct DrawSurfaceBase
+    public unsafe struct DrawSurfaceBase
     {
-        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 16)] public float[] mv;
-        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 4)] public float[] uvTrans;
-        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 4)] public float[] uvClip;
-        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 4)] public float[] color;
-        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 3)] public float[] center;
-        [MarshalAs(UnmanagedType.R4)] public float blendingCoverage;
-        [MarshalAs(UnmanagedType.I1)] public bool externalUv;
+        public fixed float mv[16];
+        public fixed float uvTrans[4];
+        public fixed float uvClip[4];
+        public fixed float color[4];
+        public fixed float center[3];
+        public float blendingCoverage;
+        public byte externalUv; // bool
     }
 
     [StructLayout(LayoutKind.Sequential)]
-    public struct DrawColliderBase
+    public unsafe struct DrawColliderBase
     {
-        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 16)] public float[] mv;
+        public fixed float mv[16];
     }
 
     public struct DrawSurfaceTask
@@ -151,55 +154,83 @@ namespace vts
             return hnd.Target;
         }
 
-        private void LoadSurfaces(ref List<DrawSurfaceTask> tasks, IntPtr group, uint cnt)
+        // the whole group is copied by a single call into these buffers
+        private DrawSurfaceBase[] surfaceBases;
+        private DrawColliderBase[] colliderBases;
+        private IntPtr[] bulkHandles;
+
+        private void PrepareHandles(uint cnt, int handlesPerTask)
+        {
+            int handlesSize = (int)cnt * handlesPerTask;
+            if (bulkHandles == null || bulkHandles.Length < handlesSize)
+                bulkHandles = new IntPtr[handlesSize];
+        }
+
+        private unsafe void LoadSurfaces(ref List<DrawSurfaceTask> tasks, IntPtr group, uint cnt)
         {
             Util.CheckInterop();
             if (tasks == null)
                 tasks = new List<DrawSurfaceTask>((int)cnt);
             else
                 tasks.Clear();
-            for (uint i = 0; i < cnt; i++)
+            if (cnt == 0)
+                return;
+            if (surfaceBases == null || surfaceBases.Length < cnt)
+                surfaceBases = new DrawSurfaceBase[cnt];
+            PrepareHandles(cnt, 3);
+            fixed (DrawSurfaceBase *bases = surfaceBases)
             {
-                DrawSurfaceTask t;
-                IntPtr pm = IntPtr.Zero, ptc = IntPtr.Zero, ptm = IntPtr.Zero, pbs = IntPtr.Zero;
-                BrowserInterop.vtsDrawsSurfaceTask(group, i, ref pm, ref ptc, ref ptm, ref pbs);
-                Util.CheckInterop();
+                BrowserInterop.vtsDrawsSurfaceTasks(group, cnt, (IntPtr)bases, bulkHandles);
+            }
+            Util.CheckInterop();
+            for (int i = 0; i < cnt; i++)
+            {
+                IntPtr pm = bulkHandles[i * 3 + 0];
                 if (pm == IntPtr.Zero)
                     continue;
-                t.data = (DrawSurfaceBase)Marshal.PtrToStructure(pbs, typeof(DrawSurfaceBase));
+                DrawSurfaceTask t;
+                t.data = surfaceBases[i];
                 t.mesh = Load(pm);
-                t.texColor = Load(ptc);
-                t.texMask = Load(ptm);
+                t.texColor = Load(bulkHandles[i * 3 + 1]);
+                t.texMask = Load(bulkHandles[i * 3 + 2]);
                 tasks.Add(t);
             }
         }
 
-        private void LoadColliders(ref List<DrawColliderTask> tasks, IntPtr group, uint cnt)
+        private unsafe void LoadColliders(ref List<DrawColliderTask> tasks, IntPtr group, uint cnt)
         {
             Util.CheckInterop();
             if (tasks == null)
                 tasks = new List<DrawColliderTask>((int)cnt);
             else
                 tasks.Clear();
-            for (uint i = 0; i < cnt; i++)
+            if (cnt == 0)
+                return;
+            if (colliderBases == null || colliderBases.Length < cnt)
+                colliderBases = new DrawColliderBase[cnt];
+            PrepareHandles(cnt, 1);
+            fixed (DrawColliderBase *bases = colliderBases)
             {
-                DrawColliderTask t;
-                IntPtr pm = IntPtr.Zero, pbs = IntPtr.Zero;
-                BrowserInterop.vtsDrawsColliderTask(group, i, ref pm, ref pbs);
-                Util.CheckInterop();
+                BrowserInterop.vtsDrawsColliderTasks(group, cnt, (IntPtr)bases, bulkHandles);
+            }
+            Util.CheckInterop();
+            for (int i = 0; i < cnt; i++)
+            {
+                IntPtr pm = bulkHandles[i];
                 if (pm == IntPtr.Zero)
                     continue;
-                t.data = (DrawColliderBase)Marshal.PtrToStructure(pbs, typeof(DrawColliderBase));
+                DrawColliderTask t;
+                t.data = colliderBases[i];
                 t.mesh = Load(pm);
                 tasks.Add(t);
             }
         }
 
-        public void Load(Map map, Camera cam)
+        public unsafe void Load(Map map, Camera cam)
         {
             IntPtr camPtr = BrowserInterop.vtsDrawsCamera(cam.Handle);
             Util.CheckInterop();
-            camera = (CameraBase)Marshal.PtrToStructure(camPtr, typeof(CameraBase));
+            camera = *(CameraBase*)camPtr;
             celestial.Load(map);
             IntPtr group = IntPtr.Zero;
             uint cnt = 0;
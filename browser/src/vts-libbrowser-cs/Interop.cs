@@ -104,6 +104,10 @@ public static extern void vtsCameraSuggestedNearFar(IntPtr cam, ref double near_
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern void vtsCameraRenderUpdate(IntPtr cam);
 
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+[return: MarshalAs(UnmanagedType.I1)]
+public static extern bool vtsCameraNeedsRedraw(IntPtr cam);
+
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern IntPtr vtsCameraGetCredits(IntPtr cam);
 
@@ -119,6 +123,9 @@ public static extern IntPtr vtsCameraGetOptions(IntPtr cam);
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern IntPtr vtsCameraGetStatistics(IntPtr cam);
 
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+public static extern void vtsCameraGetStatisticsStruct(IntPtr cam, IntPtr statistics);
+
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern void vtsCameraSetOptions(IntPtr cam, [MarshalAs(UnmanagedType.LPStr)] string options);
 
@@ -137,6 +144,12 @@ public static extern void vtsDrawsSurfaceTask(IntPtr group, uint index, ref IntP
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern void vtsDrawsColliderTask(IntPtr group, uint index, ref IntPtr mesh, ref IntPtr baseStruct);
 
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+public static extern void vtsDrawsSurfaceTasks(IntPtr group, uint count, IntPtr baseStructs, [Out] IntPtr[] resources);
+
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+public static extern void vtsDrawsColliderTasks(IntPtr group, uint count, IntPtr baseStructs, [Out] IntPtr[] meshes);
+
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern IntPtr vtsDrawsCamera(IntPtr cam);
 
@@ -265,12 +278,22 @@ public static extern void vtsMapRenderUpdate(IntPtr map, double elapsedTime);
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern void vtsMapRenderFinalize(IntPtr map);
 
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+[return: MarshalAs(UnmanagedType.I1)]
+public static extern bool vtsMapNeedsUpdate(IntPtr map);
+
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+public static extern double vtsMapRecommendedFrameInterval(IntPtr map);
+
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern IntPtr vtsMapGetOptions(IntPtr map);
 
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern IntPtr vtsMapGetStatistics(IntPtr map);
 
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+public static extern void vtsMapGetStatisticsStruct(IntPtr map, IntPtr statistics);
+
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern void vtsMapSetOptions(IntPtr map, [MarshalAs(UnmanagedType.LPStr)] string options);
 
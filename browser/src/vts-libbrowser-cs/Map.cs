@@ -156,6 +156,20 @@ namespace vts
             Util.CheckInterop();
         }
 
+        public bool NeedsUpdate()
+        {
+            bool res = BrowserInterop.vtsMapNeedsUpdate(Handle);
+            Util.CheckInterop();
+            return res;
+        }
+
+        public double RecommendedFrameInterval()
+        {
+            double res = BrowserInterop.vtsMapRecommendedFrameInterval(Handle);
+            Util.CheckInterop();
+            return res;
+        }
+
         public string GetOptions()
         {
             return Util.CheckString(BrowserInterop.vtsMapGetOptions(Handle));
@@ -166,6 +180,14 @@ namespace vts
             return Util.CheckString(BrowserInterop.vtsMapGetStatistics(Handle));
         }
 
+        public unsafe MapStatistics GetStatisticsStruct()
+        {
+            MapStatistics s;
+            BrowserInterop.vtsMapGetStatisticsStruct(Handle, (IntPtr)(&s));
+            Util.CheckInterop();
+            return s;
+        }
+
         public void SetOptions(string json)
         {
             BrowserInterop.vtsMapSetOptions(Handle, json);
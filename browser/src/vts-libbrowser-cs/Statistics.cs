@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+using System.Runtime.InteropServices;
+
+namespace vts
+{
+    // blittable copies of the statistics, filled in by single call without json
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct MapStatistics
+    {
+        public uint resourcesExists;
+        public uint resourcesActive;
+        public uint resourcesDownloading;
+        public uint resourcesPreparing;
+        public uint resourcesQueueCacheRead;
+        public uint resourcesQueueCacheWrite;
+        public uint resourcesQueueDownload;
+        public uint resourcesQueueDecode;
+        public uint resourcesQueueUpload;
+        public uint resourcesQueueAtmosphere;
+        public uint currentGpuMemUseKB;
+        public uint currentRamMemUseKB;
+        public uint currentTraverseMemUseKB;
+        public uint renderTicks;
+        public double dataUploadTime;
+        public double timeToMapconfigReady;
+        public double timeToFirstDraw;
+        public double timeToRenderComplete;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public unsafe struct CameraStatistics
+    {
+        public const int MaxLods = 25;
+        public uint nodesRenderedTotal;
+        public fixed uint nodesRenderedPerLod[MaxLods];
+        public uint metaNodesTraversedTotal;
+        public fixed uint metaNodesTraversedPerLod[MaxLods];
+        public uint nodesOccludedTotal;
+        public uint nodesBeyondHorizonTotal;
+        public uint nodesSkippedByBudget;
+        public uint nodesMergedTotal;
+        public uint nodesBlendingSnapped;
+        public uint framesOverBudget;
+        public uint currentNodeMetaUpdates;
+        public uint currentNodeDrawsUpdates;
+        public uint currentNodeDrawsWaiting;
+        public uint currentGridNodes;
+        public uint currentPrefetchNodes;
+        public double timeUpdate;
+        public double timeTraversal;
+        public double timeBlending;
+        public double timeSorting;
+        public double timePrefetch;
+    }
+}
@@ -113,6 +113,58 @@ void optionsConfigMapCreate(
         ->implicit_value(!opts->diskCache),
         "Use disk cache.")
 
+    ((section + "diskCachePacked").c_str(),
+        po::value<bool>(&opts->diskCachePacked)
+        ->implicit_value(!opts->diskCachePacked),
+        "Store disk cache in large pack files.")
+
+    ((section + "diskCacheSeeds").c_str(),
+        po::value<std::string>(&opts->diskCacheSeeds),
+        "Semicolon separated list of read only pre-built cache directories.")
+
+    ((section + "diskCacheMaxSizeMB").c_str(),
+        po::value<uint32>(&opts->diskCacheMaxSizeMB),
+        "Maximum size of the disk cache (in MB), 0 = unlimited.")
+
+    ((section + "diskCacheCompression").c_str(),
+        po::value<bool>(&opts->diskCacheCompression)
+        ->implicit_value(!opts->diskCacheCompression),
+        "Compress cached resources, except for images.")
+
+    ((section + "decodeThreads").c_str(),
+        po::value<uint32>(&opts->decodeThreads),
+        "Number of threads used for decoding resources.")
+
+    ((section + "cacheReadThreads").c_str(),
+        po::value<uint32>(&opts->cacheReadThreads),
+        "Number of threads reading resources from the disk cache.")
+
+    ((section + "mapLocalFiles").c_str(),
+        po::value<bool>(&opts->mapLocalFiles)
+        ->implicit_value(!opts->mapLocalFiles),
+        "Memory map resources with file:// urls instead of reading them.")
+
+    ((section + "ioThreadsPriority").c_str(),
+        po::value<sint32>(&opts->ioThreadsPriority),
+        "Priority of the fetcher and cache threads, -2 to 2.")
+
+    ((section + "decodeThreadsPriority").c_str(),
+        po::value<sint32>(&opts->decodeThreadsPriority),
+        "Priority of the decode threads, -2 to 2.")
+
+    ((section + "ioThreadsAffinity").c_str(),
+        po::value<uint64>(&opts->ioThreadsAffinity),
+        "Mask of cores for the fetcher and cache threads, 0 = any.")
+
+    ((section + "decodeThreadsAffinity").c_str(),
+        po::value<uint64>(&opts->decodeThreadsAffinity),
+        "Mask of cores for the decode threads, 0 = any.")
+
+    ((section + "geodataVirtualTileFeatures").c_str(),
+        po::value<uint32>(&opts->geodataVirtualTileFeatures),
+        "Maximum number of features in virtual tiles "
+        "of monolithic geodata, 0 = no partitioning.")
+
     FILE_OPTIONS;
 }
 
@@ -134,10 +186,49 @@ void optionsConfigMapRuntime(
         "Target memory (in KB) used by resources "
         "before they begin to unload.")
 
+    ((section + "targetRamMemoryKB").c_str(),
+        po::value<uint32>(&opts->targetRamMemoryKB),
+        "Target ram memory (in KB) used by resources, 0 = not used.")
+
+    ((section + "targetGpuMemoryKB").c_str(),
+        po::value<uint32>(&opts->targetGpuMemoryKB),
+        "Target gpu memory (in KB) used by resources, 0 = not used.")
+
+    ((section + "autoGpuMemoryBudget").c_str(),
+        po::value<bool>(&opts->autoGpuMemoryBudget)
+        ->implicit_value(!opts->autoGpuMemoryBudget),
+        "Limit gpu memory to 3/4 of the capacity reported by the renderer.")
+
+    ((section + "targetMetaTilesMemoryKB").c_str(),
+        po::value<uint32>(&opts->targetMetaTilesMemoryKB),
+        "Target memory (in KB) used by metatiles, 0 = not used.")
+
+    ((section + "targetMeshesMemoryKB").c_str(),
+        po::value<uint32>(&opts->targetMeshesMemoryKB),
+        "Target memory (in KB) used by meshes, 0 = not used.")
+
+    ((section + "targetTexturesMemoryKB").c_str(),
+        po::value<uint32>(&opts->targetTexturesMemoryKB),
+        "Target memory (in KB) used by textures, 0 = not used.")
+
+    ((section + "targetGeodataMemoryKB").c_str(),
+        po::value<uint32>(&opts->targetGeodataMemoryKB),
+        "Target memory (in KB) used by geodata, 0 = not used.")
+
+    ((section + "heightfieldMemoryKB").c_str(),
+        po::value<uint32>(&opts->heightfieldMemoryKB),
+        "Memory (in KB) of the cache for altitude queries, "
+        "0 = resolve altitudes from the rendered nodes.")
+
     ((section + "maxConcurrentDownloads").c_str(),
         po::value<uint32>(&opts->maxConcurrentDownloads),
         "Maximum size of the queue for the resources to be downloaded.")
 
+    ((section + "maxAdaptiveDownloads").c_str(),
+        po::value<uint32>(&opts->maxAdaptiveDownloads),
+        "Upper limit of the adaptive number of concurrent downloads "
+        "per host, 0 = adaptation disabled.")
+
     ((section + "maxFetchRedirections").c_str(),
         po::value<uint32>(&opts->maxFetchRedirections),
         "Maximum number of redirections before the download fails.")
@@ -150,6 +241,157 @@ void optionsConfigMapRuntime(
         po::value<uint32>(&opts->fetchFirstRetryTimeOffset),
         "Delay in seconds for first resource download retry.")
 
+    ((section + "hostBlockingFailures").c_str(),
+        po::value<uint32>(&opts->hostBlockingFailures),
+        "Consecutive errors after which a host is blocked, 0 to disable.")
+
+    ((section + "hostBackoffInitial").c_str(),
+        po::value<double>(&opts->hostBackoffInitial),
+        "Initial backoff period in seconds of a blocked host.")
+
+    ((section + "hostBackoffMaximum").c_str(),
+        po::value<double>(&opts->hostBackoffMaximum),
+        "Maximum backoff period in seconds of a blocked host.")
+
+    ((section + "traversalThreads").c_str(),
+        po::value<uint32>(&opts->traversalThreads),
+        "Number of additional threads that traverse map layers "
+        "concurrently, 0 = sequential traversal.")
+
+    ((section + "traverseClearingBudget").c_str(),
+        po::value<double>(&opts->traverseClearingBudget),
+        "Time budget in milliseconds for releasing stale traverse nodes "
+        "per frame, 0 = unlimited.")
+
+    ((section + "optimizeMeshes").c_str(),
+        po::value<bool>(&opts->optimizeMeshes)
+        ->implicit_value(!opts->optimizeMeshes),
+        "Reorder triangles and vertices of meshes "
+        "for better gpu vertex cache utilization.")
+
+    ((section + "quantizeMeshPositions").c_str(),
+        po::value<bool>(&opts->quantizeMeshPositions)
+        ->implicit_value(!opts->quantizeMeshPositions),
+        "Store mesh vertex positions as normalized shorts "
+        "to reduce memory and bandwidth.")
+
+    ((section + "subtileIndexRanges").c_str(),
+        po::value<bool>(&opts->subtileIndexRanges)
+        ->implicit_value(!opts->subtileIndexRanges),
+        "Render only the relevant quarter of parent meshes "
+        "drawn in place of missing children.")
+
+    ((section + "generateMipmapsOnDecode").c_str(),
+        po::value<bool>(&opts->generateMipmapsOnDecode)
+        ->implicit_value(!opts->generateMipmapsOnDecode),
+        "Compute texture mipmaps on decode threads "
+        "instead of the gpu upload.")
+
+    ((section + "reducedPrecisionTextures").c_str(),
+        po::value<bool>(&opts->reducedPrecisionTextures)
+        ->implicit_value(!opts->reducedPrecisionTextures),
+        "Convert tile textures to rgb565 or rgba4444 "
+        "with dithering to halve gpu memory.")
+
+    ((section + "deduplicateTextures").c_str(),
+        po::value<bool>(&opts->deduplicateTextures)
+        ->implicit_value(!opts->deduplicateTextures),
+        "Share gpu objects of textures with identical content.")
+
+    ((section + "combineMaskTextures").c_str(),
+        po::value<bool>(&opts->combineMaskTextures)
+        ->implicit_value(!opts->combineMaskTextures),
+        "Fold bound layer masks into alpha of the color textures.")
+
+    ((section + "deduplicateTilesets").c_str(),
+        po::value<bool>(&opts->deduplicateTilesets)
+        ->implicit_value(!opts->deduplicateTilesets),
+        "Request tiles of the same tileset ids through single url.")
+
+    ((section + "progressiveTextures").c_str(),
+        po::value<bool>(&opts->progressiveTextures)
+        ->implicit_value(!opts->progressiveTextures),
+        "Show low resolution tile textures "
+        "before the full resolution is decoded.")
+
+    ((section + "cacheGeodataLayers").c_str(),
+        po::value<bool>(&opts->cacheGeodataLayers)
+        ->implicit_value(!opts->cacheGeodataLayers),
+        "Keep results of individual style layers with geodata tiles, "
+        "so that stylesheet changes reprocess only modified layers.")
+
+    ((section + "cacheParsedGeodataFeatures").c_str(),
+        po::value<bool>(&opts->cacheParsedGeodataFeatures)
+        ->implicit_value(!opts->cacheParsedGeodataFeatures),
+        "Parse geodata features once and share them "
+        "with all tiles and stylesheets.")
+
+    ((section + "collisionMeshes").c_str(),
+        po::value<bool>(&opts->collisionMeshes)
+        ->implicit_value(!opts->collisionMeshes),
+        "Keep triangles of tile meshes for ray casting.")
+
+    ((section + "decodeTimeSlice").c_str(),
+        po::value<double>(&opts->decodeTimeSlice),
+        "Time slice in milliseconds after which long decodes let "
+        "queued decodes with higher priority run, 0 = disabled.")
+
+    ((section + "uploadTimeSlice").c_str(),
+        po::value<double>(&opts->uploadTimeSlice),
+        "Time slice in milliseconds after which geodata uploads continue "
+        "in following data ticks, 0 = disabled.")
+
+    ((section + "dataUpdateBudget").c_str(),
+        po::value<double>(&opts->dataUpdateBudget),
+        "Time budget in milliseconds of one dataUpdate, uploads "
+        "estimated not to fit are deferred, 0 = disabled.")
+
+    ((section + "queueShedThreshold").c_str(),
+        po::value<uint32>(&opts->queueShedThreshold),
+        "Length of the fetch and cache read queues above which "
+        "the lowest priority resources are removed, 0 = disabled.")
+
+    ((section + "colliderSimplification").c_str(),
+        po::value<double>(&opts->colliderSimplification),
+        "Maximum error of simplified collider meshes, "
+        "relative to the tile size, 0 to use render meshes.")
+
+    ((section + "geodataSimplification").c_str(),
+        po::value<double>(&opts->geodataSimplification),
+        "Maximum error (in texels of the tile) of simplified lines "
+        "and polygons in tiled geodata, 0 = no simplification.")
+
+    ((section + "searchCacheCapacity").c_str(),
+        po::value<uint32>(&opts->searchCacheCapacity),
+        "Number of recent search queries whose results are kept.")
+
+    ((section + "searchCacheBucket").c_str(),
+        po::value<double>(&opts->searchCacheBucket),
+        "Size of the position bucket (in navigation srs) "
+        "for sharing search results, 0 to use exact positions.")
+
+    ((section + "frameIntervalMotion").c_str(),
+        po::value<double>(&opts->frameIntervalMotion),
+        "Recommended frame interval (seconds) while the camera moves.")
+
+    ((section + "frameIntervalTransition").c_str(),
+        po::value<double>(&opts->frameIntervalTransition),
+        "Recommended frame interval (seconds) while the draws change.")
+
+    ((section + "frameIntervalLoading").c_str(),
+        po::value<double>(&opts->frameIntervalLoading),
+        "Recommended frame interval (seconds) while resources load.")
+
+    ((section + "frameIntervalIdle").c_str(),
+        po::value<double>(&opts->frameIntervalIdle),
+        "Recommended frame interval (seconds) while nothing changes.")
+
+    ((section + "lowPowerMode").c_str(),
+        po::value<bool>(&opts->lowPowerMode)
+        ->implicit_value(!opts->lowPowerMode),
+        "Reduce downloads, decoding threads and frame rate "
+        "to save battery.")
+
     ((section + "debugSaveCorruptedFiles").c_str(),
         po::value<bool>(&opts->debugSaveCorruptedFiles)
         ->implicit_value(!opts->debugSaveCorruptedFiles),
@@ -174,6 +416,16 @@ void optionsConfigCamera(
         po::value<double>(&opts->targetPixelRatioGeodata),
         "Target ratio of texture details to the viewport resolution.")
 
+    ((section + "prefetchDuration").c_str(),
+        po::value<double>(&opts->prefetchDuration),
+        "Duration (in seconds) to extrapolate the camera movement "
+        "for prefetching resources, 0 = disabled.")
+
+    ((section + "metaPrefetchRatio").c_str(),
+        po::value<double>(&opts->metaPrefetchRatio),
+        "Nodes with coarseness above this fraction of the target ratio "
+        "request metatiles of their children in advance, 0 = disabled.")
+
     ((section + "traverseModeSurfaces").c_str(),
         po::value<TraverseMode>(&opts->traverseModeSurfaces),
         "Render traversal mode for surfaces:\n"
@@ -182,7 +434,8 @@ void optionsConfigCamera(
         "stable\n"
         "balanced\n"
         "hierarchical\n"
-        "fixed")
+        "fixed\n"
+        "coherent")
 
     ((section + "traverseModeGeodata").c_str(),
         po::value<TraverseMode>(&opts->traverseModeGeodata),
@@ -192,7 +445,14 @@ void optionsConfigCamera(
         "stable\n"
         "balanced\n"
         "hierarchical\n"
-        "fixed")
+        "fixed\n"
+        "coherent")
+
+    ((section + "priorityModel").c_str(),
+        po::value<PriorityModel>(&opts->priorityModel),
+        "Order of resources downloads:\n"
+        "distance\n"
+        "screenSpaceError")
 
     ((section + "balancedGridLodOffset").c_str(),
         po::value<uint32>(&opts->balancedGridLodOffset),
@@ -202,6 +462,23 @@ void optionsConfigCamera(
         po::value<uint32>(&opts->balancedGridNeighborsDistance),
         "Distance to neighbors for grids for use with balanced traversal.")
 
+    ((section + "traversalBudget").c_str(),
+        po::value<uint32>(&opts->traversalBudget),
+        "Maximum number of meta nodes traversed per frame, 0 to disable.")
+
+    ((section + "occlusionCulling").c_str(),
+        po::value<bool>(&opts->occlusionCulling),
+        "Skip nodes hidden behind the terrain in previous frame.")
+
+    ((section + "coherentTraversalJump").c_str(),
+        po::value<double>(&opts->coherentTraversalJump),
+        "Relative camera movement that restarts the coherent traversal.")
+
+    ((section + "mergeTilesScreenSize").c_str(),
+        po::value<double>(&opts->mergeTilesScreenSize),
+        "Nodes smaller on screen (in pixels) are drawn "
+        "instead of their children, 0 to disable.")
+
     ((section + "minSuggestedNearClipPlaneDistance").c_str(),
         po::value<double>(&opts->minSuggestedNearClipPlaneDistance),
         "Lower limit for automatic near clip plane distance.")
@@ -282,6 +559,44 @@ void optionsConfigFetcherOptions(
         ->implicit_value(!opts->extraFileLog),
         "Produce separate log with downloads.")
 
+    ((section + "recordArchive").c_str(),
+        po::value<std::string>(&opts->recordArchive),
+        "Record all downloads into this archive.")
+
+    ((section + "replayArchive").c_str(),
+        po::value<std::string>(&opts->replayArchive),
+        "Replay all downloads from this archive instead of the network.")
+
+    ((section + "replayTimings").c_str(),
+        po::value<bool>(&opts->replayTimings)
+        ->implicit_value(!opts->replayTimings),
+        "Replay the downloads with the recorded latencies.")
+
+    ((section + "simulatedLatency").c_str(),
+        po::value<double>(&opts->simulatedLatency),
+        "Latency added to each download, in milliseconds.")
+
+    ((section + "simulatedJitter").c_str(),
+        po::value<double>(&opts->simulatedJitter),
+        "Variation of the simulated latency, in milliseconds.")
+
+    ((section + "simulatedLatencyDistribution").c_str(),
+        po::value<std::string>(&opts->simulatedLatencyDistribution),
+        "Distribution of the simulated latency: "
+        "normal, uniform or exponential.")
+
+    ((section + "simulatedBandwidth").c_str(),
+        po::value<uint32>(&opts->simulatedBandwidth),
+        "Bandwidth shared by all downloads, in kilobytes per second.")
+
+    ((section + "simulatedLossRate").c_str(),
+        po::value<double>(&opts->simulatedLossRate),
+        "Fraction of downloads that time out.")
+
+    ((section + "simulatedErrorRate").c_str(),
+        po::value<double>(&opts->simulatedErrorRate),
+        "Fraction of downloads that fail with simulated error.")
+
     FILE_OPTIONS;
 }
 
@@ -30,13 +30,21 @@
 #include <windows.h> // GetCurrentProcessId
 #else
 #include <unistd.h> // getpid
+#include <sys/mman.h> // posix_madvise
 #endif
 
 #include <boost/filesystem.hpp>
+#ifndef __EMSCRIPTEN__
+#include <boost/iostreams/device/mapped_file.hpp>
+#endif
 #include <dbglog/dbglog.hpp>
 
 #include <cstring>
 #include <map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
 
 void initializeBrowserData();
 namespace
@@ -85,8 +93,221 @@ dataMapType &dataMap()
     return data;
 }
 
+// pool of allocations in size classes with four steps per octave
+//   freed blocks are cached in the thread and in a shared depot
+//   the blocks are always allocated with the full size of their class
+//   so that the pool may be disabled at any time
+const uint32 PoolMinShift = 12; // smaller allocations are not pooled
+const uint32 PoolMaxShift = 24; // neither are larger
+const uint32 PoolClasses = (PoolMaxShift - PoolMinShift) * 4;
+const uint32 PoolThreadBytes = 1024 * 1024; // per class in each thread
+const uint32 PoolThreadBlocks = 8; // per class in each thread
+const uint64 PoolDepotBytes = 64 * 1024 * 1024;
+
+std::atomic<bool> poolEnabled{ true };
+std::atomic<uint64> poolHits{ 0 };
+std::atomic<uint64> poolMisses{ 0 };
+std::atomic<uint64> poolRetained{ 0 }; // bytes in all caches
+
+int poolClass(uint32 size)
+{
+    if (size <= (1u << PoolMinShift) || size > (1u << PoolMaxShift))
+        return -1;
+    uint32 o = PoolMinShift;
+    while ((size - 1) >> (o + 1))
+        o++;
+    const uint32 step = (1u << o) / 4;
+    const uint32 k = (size - (1u << o) + step - 1) / step; // 1 .. 4
+    return (o - PoolMinShift) * 4 + k - 1;
+}
+
+uint32 poolClassSize(int c)
+{
+    const uint32 b = 1u << (c / 4 + PoolMinShift);
+    return b + (c % 4 + 1) * (b / 4);
+}
+
+struct PoolDepot
+{
+    std::mutex mut;
+    std::vector<char *> blocks[PoolClasses];
+    uint64 bytes = 0;
+};
+
+PoolDepot &poolDepot()
+{
+    // intentionally leaked, buffers may be freed during static destruction
+    static PoolDepot *depot = new PoolDepot();
+    return *depot;
+}
+
+void depotPush(int c, char *p)
+{
+    const uint32 s = poolClassSize(c);
+    PoolDepot &d = poolDepot();
+    {
+        std::lock_guard<std::mutex> lock(d.mut);
+        if (d.bytes + s <= PoolDepotBytes)
+        {
+            d.blocks[c].push_back(p);
+            d.bytes += s;
+            return;
+        }
+    }
+    poolRetained -= s;
+    ::free(p);
+}
+
+char *depotPop(int c)
+{
+    PoolDepot &d = poolDepot();
+    std::lock_guard<std::mutex> lock(d.mut);
+    std::vector<char *> &v = d.blocks[c];
+    if (v.empty())
+        return nullptr;
+    char *p = v.back();
+    v.pop_back();
+    d.bytes -= poolClassSize(c);
+    return p;
+}
+
+struct PoolThreadCache
+{
+    std::vector<char *> blocks[PoolClasses];
+
+    ~PoolThreadCache()
+    {
+        for (uint32 c = 0; c < PoolClasses; c++)
+            for (char *p : blocks[c])
+                depotPush(c, p);
+    }
+};
+
+// the cache is not available during the destruction of the thread
+thread_local PoolThreadCache *poolThreadCachePtr = nullptr;
+thread_local bool poolThreadFinished = false;
+
+struct PoolThreadCacheOwner
+{
+    PoolThreadCache cache;
+
+    PoolThreadCacheOwner()
+    {
+        poolThreadCachePtr = &cache;
+    }
+
+    ~PoolThreadCacheOwner()
+    {
+        poolThreadCachePtr = nullptr;
+        poolThreadFinished = true;
+    }
+};
+
+PoolThreadCache *poolThreadCache()
+{
+    if (!poolThreadCachePtr && !poolThreadFinished)
+    {
+        thread_local PoolThreadCacheOwner owner;
+        (void)owner;
+    }
+    return poolThreadCachePtr;
+}
+
+char *poolAllocate(uint32 size)
+{
+    const int c = poolClass(size);
+    if (c < 0)
+        return (char *)malloc(size);
+    if (poolEnabled)
+    {
+        char *p = nullptr;
+        PoolThreadCache *t = poolThreadCache();
+        if (t && !t->blocks[c].empty())
+        {
+            p = t->blocks[c].back();
+            t->blocks[c].pop_back();
+        }
+        else
+            p = depotPop(c);
+        if (p)
+        {
+            poolRetained -= poolClassSize(c);
+            poolHits++;
+            return p;
+        }
+        poolMisses++;
+    }
+    return (char *)malloc(poolClassSize(c));
+}
+
+void poolFree(char *p, uint32 size)
+{
+    if (!p)
+        return;
+    const int c = poolClass(size);
+    if (c < 0 || !poolEnabled)
+    {
+        ::free(p);
+        return;
+    }
+    const uint32 s = poolClassSize(c);
+    poolRetained += s;
+    PoolThreadCache *t = poolThreadCache();
+    if (!t)
+    {
+        depotPush(c, p);
+        return;
+    }
+    std::vector<char *> &v = t->blocks[c];
+    v.push_back(p);
+    const uint32 limit = std::max(std::min(PoolThreadBlocks,
+        PoolThreadBytes / s), 1u);
+    if (v.size() > limit)
+    {
+        // move half of the blocks to the other threads
+        while (v.size() > limit / 2)
+        {
+            depotPush(c, v.back());
+            v.pop_back();
+        }
+    }
+}
+
 } // namespace
 
+void setBufferPoolEnabled(bool enabled)
+{
+    poolEnabled = enabled;
+    if (!enabled)
+        trimBufferPool();
+}
+
+void trimBufferPool()
+{
+    // the blocks cached by other threads are released when they exit
+    PoolDepot &d = poolDepot();
+    std::lock_guard<std::mutex> lock(d.mut);
+    for (uint32 c = 0; c < PoolClasses; c++)
+    {
+        for (char *p : d.blocks[c])
+        {
+            poolRetained -= poolClassSize(c);
+            ::free(p);
+        }
+        d.blocks[c].clear();
+    }
+    d.bytes = 0;
+}
+
+BufferPoolStatistics bufferPoolStatistics()
+{
+    BufferPoolStatistics s;
+    s.hits = poolHits;
+    s.misses = poolMisses;
+    s.retainedBytes = poolRetained;
+    return s;
+}
+
 Buffer::Buffer() : data_(nullptr), size_(0)
 {}
 
@@ -101,12 +322,19 @@ Buffer::Buffer(const std::string &str) : data_(nullptr), size_(0)
     memcpy(data_, str.data(), size_);
 }
 
+Buffer::Buffer(const std::shared_ptr<void> &owner, char *data, uint32 size)
+    : owner_(owner), data_(data), size_(size)
+{
+    assert(owner_ || size_ == 0);
+}
+
 Buffer::~Buffer()
 {
     this->free();
 }
 
-Buffer::Buffer(Buffer &&other) noexcept : data_(other.data_), size_(other.size_)
+Buffer::Buffer(Buffer &&other) noexcept : owner_(std::move(other.owner_)),
+    data_(other.data_), size_(other.size_)
 {
     other.data_ = nullptr;
     other.size_ = 0;
@@ -116,6 +344,7 @@ Buffer &Buffer::operator = (Buffer &&other) noexcept
 {
     assert(&other != this);
     this->free();
+    owner_ = std::move(other.owner_);
     size_ = other.size_;
     data_ = other.data_;
     other.data_ = nullptr;
@@ -130,6 +359,32 @@ Buffer Buffer::copy() const
     return r;
 }
 
+Buffer Buffer::share()
+{
+    if (!data_)
+        return Buffer();
+    if (!owner_)
+    {
+        const uint32 s = size_;
+        owner_ = std::shared_ptr<char>(data_,
+            [s](char *p) { poolFree(p, s); });
+    }
+    return Buffer(owner_, data_, size_);
+}
+
+Buffer Buffer::slice(uint32 offset, uint32 size)
+{
+    if (offset > size_ || size > size_ - offset)
+    {
+        LOGTHROW(err2, std::runtime_error) << "Buffer slice <" << offset
+            << ", " << size << "> is out of range of " << size_ << " bytes";
+    }
+    if (size == 0)
+        return Buffer();
+    share();
+    return Buffer(owner_, data_ + offset, size);
+}
+
 std::string Buffer::str() const
 {
     return std::string(data_, size_);
@@ -139,7 +394,7 @@ void Buffer::allocate(uint32 size)
 {
     this->free();
     this->size_ = size;
-    data_ = (char*)malloc(size_);
+    data_ = poolAllocate(size_);
     if (!data_)
         LOGTHROW(err2, std::runtime_error)
                 << "Not enough memory for buffer allocation, requested "
@@ -148,6 +403,29 @@ void Buffer::allocate(uint32 size)
 
 void Buffer::resize(uint32 size)
 {
+    if (owner_)
+    {
+        // the memory cannot be reallocated, make own copy
+        Buffer tmp(size);
+        memcpy(tmp.data(), data_, std::min(size, size_));
+        *this = std::move(tmp);
+        return;
+    }
+    const int oc = poolClass(size_);
+    const int nc = poolClass(size);
+    if (oc >= 0 || nc >= 0)
+    {
+        if (oc == nc)
+        {
+            // fits in the same block
+            this->size_ = size;
+            return;
+        }
+        Buffer tmp(size);
+        memcpy(tmp.data(), data_, std::min(size, size_));
+        *this = std::move(tmp);
+        return;
+    }
     char *tmp = (char*)realloc(data_, size);
     if (!tmp)
     {
@@ -166,7 +444,10 @@ void Buffer::zero()
 
 void Buffer::free()
 {
-    ::free(data_);
+    if (owner_)
+        owner_.reset();
+    else
+        poolFree(data_, size_);
     data_ = nullptr;
     size_ = 0;
 }
@@ -221,6 +502,40 @@ Buffer readLocalFileBuffer(const std::string &path)
     }
 }
 
+Buffer mapLocalFileBuffer(const std::string &path)
+{
+#ifdef __EMSCRIPTEN__
+    return readLocalFileBuffer(path);
+#else
+    boost::system::error_code ec;
+    const uint64 size = boost::filesystem::file_size(path, ec);
+    if (ec)
+        LOGTHROW(err1, std::runtime_error) << "Failed to map file <"
+                                           << path << ">";
+    if (size == 0)
+        return Buffer(); // empty files cannot be mapped
+    auto m = std::make_shared<boost::iostreams::mapped_file>();
+    try
+    {
+        boost::iostreams::mapped_file_params params(path);
+        params.flags = boost::iostreams::mapped_file::priv;
+        m->open(params);
+    }
+    catch (const std::exception &)
+    {
+        // handled below
+    }
+    if (!m->is_open())
+        LOGTHROW(err1, std::runtime_error) << "Failed to map file <"
+                                           << path << ">";
+#ifndef _WIN32
+    // the whole file is decoded right after, start reading it now
+    posix_madvise(m->data(), m->size(), POSIX_MADV_WILLNEED);
+#endif
+    return Buffer(m, m->data(), m->size());
+#endif
+}
+
 Buffer readInternalMemoryBuffer(const std::string &path)
 {
     auto it = dataMap().find(path);
@@ -232,6 +547,17 @@ Buffer readInternalMemoryBuffer(const std::string &path)
     return b;
 }
 
+Buffer shareInternalMemoryBuffer(const std::string &path)
+{
+    auto it = dataMap().find(path);
+    if (it == dataMap().end())
+        LOGTHROW(err1, std::runtime_error) << "Internal buffer <"
+                                           << path << "> not found";
+    // the internal memory is static, the owner only marks it as shared
+    static const std::shared_ptr<void> owner = std::make_shared<char>(0);
+    return Buffer(owner, (char *)it->second.second, it->second.first);
+}
+
 namespace detail
 {
 
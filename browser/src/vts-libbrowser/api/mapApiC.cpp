@@ -56,6 +56,7 @@
 #include "../include/vts-browser/resources.hpp"
 #include "../include/vts-browser/search.h"
 #include "../include/vts-browser/search.hpp"
+#include "../include/vts-browser/trace.hpp"
 #include "../include/vts-browser/internalMemory.h"
 
 #include "../utilities/json.hpp"
@@ -293,6 +294,36 @@ void vtsLog(uint32 level, const char *message)
     }
 }
 
+void vtsTraceSetEnabled(bool enable)
+{
+    C_BEGIN
+    vts::setTraceEnabled(enable);
+    C_END
+}
+
+bool vtsTraceGetEnabled()
+{
+    C_BEGIN
+    return vts::getTraceEnabled();
+    C_END
+    return false;
+}
+
+void vtsTraceClear()
+{
+    C_BEGIN
+    vts::clearTrace();
+    C_END
+}
+
+const char *vtsTraceExport()
+{
+    C_BEGIN
+    return vts::retStr(vts::exportTrace());
+    C_END
+    return nullptr;
+}
+
 ////////////////////////////////////////////////////////////////////////////
 // MAP
 ////////////////////////////////////////////////////////////////////////////
@@ -391,6 +422,21 @@ double vtsMapGetRenderProgress(vtsHMap map)
     return 0.0;
 }
 
+const char *vtsMapSaveWorkingSet(vtsHMap map, double seconds)
+{
+    C_BEGIN
+    return vts::retStr(map->p->saveWorkingSet(seconds));
+    C_END
+    return nullptr;
+}
+
+void vtsMapLoadWorkingSet(vtsHMap map, const char *snapshot)
+{
+    C_BEGIN
+    map->p->loadWorkingSet(snapshot);
+    C_END
+}
+
 void vtsMapDataUpdate(vtsHMap map)
 {
     C_BEGIN
@@ -426,6 +472,22 @@ void vtsMapRenderFinalize(vtsHMap map)
     C_END
 }
 
+bool vtsMapNeedsUpdate(vtsHMap map)
+{
+    C_BEGIN
+    return map->p->needsUpdate();
+    C_END
+    return false;
+}
+
+double vtsMapRecommendedFrameInterval(vtsHMap map)
+{
+    C_BEGIN
+    return map->p->recommendedFrameInterval();
+    C_END
+    return 0;
+}
+
 const char *vtsMapGetOptions(vtsHMap map)
 {
     C_BEGIN
@@ -442,6 +504,32 @@ const char *vtsMapGetStatistics(vtsHMap map)
     return nullptr;
 }
 
+void vtsMapGetStatisticsStruct(vtsHMap map, vtsCMapStatistics *statistics)
+{
+    C_BEGIN
+    const vts::MapStatistics &s = map->p->statistics();
+    vtsCMapStatistics &r = *statistics;
+    r.resourcesExists = s.resourcesExists;
+    r.resourcesActive = s.resourcesActive;
+    r.resourcesDownloading = s.resourcesDownloading;
+    r.resourcesPreparing = s.resourcesPreparing;
+    r.resourcesQueueCacheRead = s.resourcesQueueCacheRead;
+    r.resourcesQueueCacheWrite = s.resourcesQueueCacheWrite;
+    r.resourcesQueueDownload = s.resourcesQueueDownload;
+    r.resourcesQueueDecode = s.resourcesQueueDecode;
+    r.resourcesQueueUpload = s.resourcesQueueUpload;
+    r.resourcesQueueAtmosphere = s.resourcesQueueAtmosphere;
+    r.currentGpuMemUseKB = s.currentGpuMemUseKB;
+    r.currentRamMemUseKB = s.currentRamMemUseKB;
+    r.currentTraverseMemUseKB = s.currentTraverseMemUseKB;
+    r.renderTicks = s.renderTicks;
+    r.dataUploadTime = s.dataUploadTime;
+    r.timeToMapconfigReady = s.timeToMapconfigReady;
+    r.timeToFirstDraw = s.timeToFirstDraw;
+    r.timeToRenderComplete = s.timeToRenderComplete;
+    C_END
+}
+
 void vtsMapSetOptions(vtsHMap map, const char *options)
 {
     C_BEGIN
@@ -458,6 +546,13 @@ void vtsMapConvert(vtsHMap map, const double pointFrom[3], double pointTo[3], ui
     C_END
 }
 
+void vtsMapConvertPoints(vtsHMap map, const double *pointsFrom, double *pointsTo, uint32 count, uint32 srsFrom, uint32 srsTo)
+{
+    C_BEGIN
+    map->p->convert(pointsFrom, pointsTo, count, (vts::Srs)srsFrom, (vts::Srs)srsTo);
+    C_END
+}
+
 ////////////////////////////////////////////////////////////////////////////
 // CAMERA
 ////////////////////////////////////////////////////////////////////////////
@@ -488,6 +583,13 @@ void vtsCameraSetViewportSize(vtsHCamera cam, uint32 width, uint32 height)
     C_END
 }
 
+void vtsCameraSetResolutionScale(vtsHCamera cam, double scale)
+{
+    C_BEGIN
+    cam->p->setResolutionScale(scale);
+    C_END
+}
+
 void vtsCameraSetView(vtsHCamera cam, const double eye[3], const double target[3], const double up[3])
 {
     C_BEGIN
@@ -551,6 +653,21 @@ void vtsCameraSuggestedNearFar(vtsHCamera cam, double *near_, double *far_)
     C_END
 }
 
+void vtsCameraSetOcclusionDepth(vtsHCamera cam, const float *depth,
+    uint32 width, uint32 height, const double viewProj[16])
+{
+    C_BEGIN
+    cam->p->setOcclusionDepth(depth, width, height, viewProj);
+    C_END
+}
+
+void vtsCameraShareTraversal(vtsHCamera cam, vtsHCamera leader)
+{
+    C_BEGIN
+    cam->p->shareTraversal(leader ? leader->p : nullptr);
+    C_END
+}
+
 void vtsCameraRenderUpdate(vtsHCamera cam)
 {
     C_BEGIN
@@ -558,6 +675,32 @@ void vtsCameraRenderUpdate(vtsHCamera cam)
     C_END
 }
 
+bool vtsCameraNeedsRedraw(vtsHCamera cam)
+{
+    C_BEGIN
+    return cam->p->needsRedraw();
+    C_END
+    return false;
+}
+
+bool vtsCameraIntersectRay(vtsHCamera cam, const double origin[3],
+    const double direction[3], double *distance)
+{
+    C_BEGIN
+    return cam->p->intersectRay(origin, direction, *distance);
+    C_END
+    return false;
+}
+
+bool vtsCameraLineOfSight(vtsHCamera cam, const double a[3],
+    const double b[3])
+{
+    C_BEGIN
+    return cam->p->lineOfSight(a, b);
+    C_END
+    return false;
+}
+
 // credits
 
 const char *vtsCameraGetCredits(vtsHCamera cam)
@@ -602,6 +745,40 @@ const char *vtsCameraGetStatistics(vtsHCamera cam)
     return nullptr;
 }
 
+void vtsCameraGetStatisticsStruct(vtsHCamera cam,
+    vtsCCameraStatistics *statistics)
+{
+    C_BEGIN
+    static_assert(vts::CameraStatistics::MaxLods == 25,
+        "vtsCCameraStatistics must match the lods count");
+    const vts::CameraStatistics &s = cam->p->statistics();
+    vtsCCameraStatistics &r = *statistics;
+    r.nodesRenderedTotal = s.nodesRenderedTotal;
+    r.metaNodesTraversedTotal = s.metaNodesTraversedTotal;
+    for (uint32 i = 0; i < vts::CameraStatistics::MaxLods; i++)
+    {
+        r.nodesRenderedPerLod[i] = s.nodesRenderedPerLod[i];
+        r.metaNodesTraversedPerLod[i] = s.metaNodesTraversedPerLod[i];
+    }
+    r.nodesOccludedTotal = s.nodesOccludedTotal;
+    r.nodesBeyondHorizonTotal = s.nodesBeyondHorizonTotal;
+    r.nodesSkippedByBudget = s.nodesSkippedByBudget;
+    r.nodesMergedTotal = s.nodesMergedTotal;
+    r.nodesBlendingSnapped = s.nodesBlendingSnapped;
+    r.framesOverBudget = s.framesOverBudget;
+    r.currentNodeMetaUpdates = s.currentNodeMetaUpdates;
+    r.currentNodeDrawsUpdates = s.currentNodeDrawsUpdates;
+    r.currentNodeDrawsWaiting = s.currentNodeDrawsWaiting;
+    r.currentGridNodes = s.currentGridNodes;
+    r.currentPrefetchNodes = s.currentPrefetchNodes;
+    r.timeUpdate = s.timeUpdate;
+    r.timeTraversal = s.timeTraversal;
+    r.timeBlending = s.timeBlending;
+    r.timeSorting = s.timeSorting;
+    r.timePrefetch = s.timePrefetch;
+    C_END
+}
+
 void vtsCameraSetOptions(vtsHCamera cam, const char *options)
 {
     C_BEGIN
@@ -669,6 +846,34 @@ void vtsDrawsColliderTask(void *group, uint32 index, void **mesh, vtsCDrawCollid
     C_END
 }
 
+void vtsDrawsSurfaceTasks(void *group, uint32 count,
+    vtsCDrawSurfaceBase *baseStructs, void **resources)
+{
+    C_BEGIN
+    const vts::DrawSurfaceTask *t = (const vts::DrawSurfaceTask *)group;
+    for (uint32 i = 0; i < count; i++)
+    {
+        baseStructs[i] = t[i];
+        resources[i * 3 + 0] = t[i].mesh.get();
+        resources[i * 3 + 1] = t[i].texColor.get();
+        resources[i * 3 + 2] = t[i].texMask.get();
+    }
+    C_END
+}
+
+void vtsDrawsColliderTasks(void *group, uint32 count,
+    vtsCDrawColliderBase *baseStructs, void **meshes)
+{
+    C_BEGIN
+    const vts::DrawColliderTask *t = (const vts::DrawColliderTask *)group;
+    for (uint32 i = 0; i < count; i++)
+    {
+        baseStructs[i] = t[i];
+        meshes[i] = t[i].mesh.get();
+    }
+    C_END
+}
+
 const vtsCCameraBase *vtsDrawsCamera(vtsHCamera cam)
 {
     C_BEGIN
@@ -28,6 +28,7 @@
 #include "../include/vts-browser/mapView.hpp"
 #include "../utilities/json.hpp"
 #include "../map.hpp"
+#include "../camera.hpp"
 #include "../mapConfig.hpp"
 #include "../gpuResource.hpp"
 #include "../renderInfos.hpp"
@@ -36,6 +37,7 @@
 #include "../geodata.hpp"
 #include "../position.hpp"
 #include "../resources.hpp"
+#include "../cache.hpp"
 
 #include <vts-libs/registry/json.hpp>
 #include <vts-libs/registry/io.hpp>
@@ -156,6 +158,20 @@ Map::Map(const MapCreateOptions &options, const std::shared_ptr<Fetcher> &fetche
     impl = std::make_shared<MapImpl>(this, options, fetcher);
 }
 
+Map::Map(const MapCreateOptions &options, const std::shared_ptr<Map> &resourcesOwner)
+{
+    LOG(info3) << "Creating map sharing resources";
+    if (!resourcesOwner)
+    {
+        LOGTHROW(err4, std::logic_error) << "The map to share the resources with is missing.";
+    }
+    // chains of sharing maps are collapsed to the actual owner
+    std::shared_ptr<Map> owner = resourcesOwner->impl->resourcesOwner;
+    if (!owner)
+        owner = resourcesOwner;
+    impl = std::make_shared<MapImpl>(this, options, owner, owner->impl.get());
+}
+
 Map::~Map()
 {
     LOG(info3) << "Destroying map";
@@ -176,11 +192,35 @@ void Map::purgeDiskCache()
     impl->resources->purgeResourcesCache();
 }
 
+std::string Map::getDiskCachePath() const
+{
+    // the cache is created by the map that owns the resources
+    const MapCreateOptions &co = impl->resources->map->createOptions;
+    if (!co.diskCache)
+        return "";
+    return cacheRoot(co);
+}
+
 void Map::purgeViewCache()
 {
     impl->purgeViewCache();
 }
 
+void Map::memoryPressure(MemoryPressure level)
+{
+    impl->memoryPressure(level);
+}
+
+std::string Map::saveWorkingSet(double seconds) const
+{
+    return impl->saveWorkingSet(seconds);
+}
+
+void Map::loadWorkingSet(const std::string &snapshot)
+{
+    impl->loadWorkingSet(snapshot);
+}
+
 bool Map::getMapconfigAvailable() const
 {
     if (impl->mapconfigAvailable)
@@ -233,30 +273,60 @@ double Map::getMapRenderProgress() const
 
 void Map::dataUpdate()
 {
-    impl->resources->dataUpdate();
+    if (!impl->resourcesOwner)
+        impl->resources->dataUpdate();
 }
 
 void Map::dataAllRun()
 {
-    impl->resources->dataAllRun();
+    if (!impl->resourcesOwner)
+        impl->resources->dataAllRun();
 }
 
 void Map::dataFinalize()
 {
-    impl->resources->dataFinalize();
+    if (!impl->resourcesOwner)
+        impl->resources->dataFinalize();
 }
 
 void Map::renderUpdate(double elapsedTime)
 {
     impl->statistics.renderTicks = ++impl->renderTickIndex;
     impl->statistics.resourcesAccessed = 0;
-    impl->resources->renderUpdate();
+    if (!impl->resourcesOwner)
+        impl->resources->renderUpdate();
     impl->renderUpdate(elapsedTime);
 }
 
 void Map::renderFinalize()
 {
-    impl->resources->renderFinalize();
+    if (!impl->resourcesOwner)
+        impl->resources->renderFinalize();
+}
+
+bool Map::needsUpdate() const
+{
+    if (impl->updateNeeded())
+        return true;
+    for (auto &it : impl->cameras)
+        if (auto cam = it.lock())
+            if (cam->redrawNeeded())
+                return true;
+    return false;
+}
+
+double Map::recommendedFrameInterval() const
+{
+    const MapRuntimeOptions &o = impl->options;
+    double r = o.frameIntervalIdle;
+    if (impl->updateNeeded())
+        r = std::min(r, o.frameIntervalLoading);
+    for (auto &it : impl->cameras)
+        if (auto cam = it.lock())
+            r = std::min(r, cam->frameInterval());
+    if (o.lowPowerMode)
+        r = std::max(r * 2, 1.0 / 30);
+    return std::max(r, 0.0);
 }
 
 double Map::lastRenderUpdateElapsedTime() const
@@ -307,6 +377,15 @@ void Map::convert(const std::array<double, 3> &pointFrom, double pointTo[3], Srs
     convert(pointFrom.data(), pointTo, srsFrom, srsTo);
 }
 
+void Map::convert(const double *pointsFrom, double *pointsTo, uint32 count, Srs srsFrom, Srs srsTo) const
+{
+    if (!getMapconfigAvailable())
+    {
+        LOGTHROW(err4, std::logic_error) << "Map is not yet available.";
+    }
+    impl->convertor->convert(pointsFrom, pointsTo, count, srsFrom, srsTo);
+}
+
 std::vector<std::string> Map::getResourceSurfaces() const
 {
     if (!getMapconfigAvailable())
@@ -385,9 +464,11 @@ std::string Map::getResourceFreeLayerGeodata(const std::string &name) const
     if (getResourceFreeLayerType(name) != FreeLayerType::MonolithicGeodata)
         return "";
     auto r = impl->getActualGeoFeatures(name);
-    if (r.second)
-        return *r.second;
-    return "";
+    if (!r.second)
+        return "";
+    if (isGeodataBinary(*r.second))
+        return geodataBinaryToJson(*r.second);
+    return *r.second;
 }
 
 void Map::setResourceFreeLayerGeodata(const std::string &name, const std::string &value)
@@ -469,7 +550,7 @@ void Map::selectView(const std::string &name)
         LOGTHROW(err2, std::runtime_error) << "Specified mapconfig view could not be found.";
     }
     impl->mapconfig->view = it->second;
-    impl->purgeViewCache();
+    impl->switchView();
     impl->mapconfigView = name;
 }
 
@@ -495,7 +576,7 @@ void Map::setView(const std::string &name, const MapView &view)
     if (name == selectedView())
     {
         impl->mapconfig->view = impl->mapconfig->namedViews[name];
-        impl->purgeViewCache();
+        impl->switchView();
     }
 }
 
@@ -536,4 +617,24 @@ std::shared_ptr<SearchTask> Map::search(const std::string &query, const std::arr
     return search(query, point.data());
 }
 
+std::shared_ptr<OfflineTask> Map::downloadRegion(const double extentsLl[3], const double extentsUr[3], uint32 lodMin, uint32 lodMax)
+{
+    return impl->downloadRegion(extentsLl, extentsUr, lodMin, lodMax);
+}
+
+std::shared_ptr<OfflineTask> Map::downloadRegion(const std::array<double, 3> &extentsLl, const std::array<double, 3> &extentsUr, uint32 lodMin, uint32 lodMax)
+{
+    return downloadRegion(extentsLl.data(), extentsUr.data(), lodMin, lodMax);
+}
+
+std::shared_ptr<AltitudeTask> Map::queryAltitudes(const double *points, uint32 count, double accuracy, const std::function<void(AltitudeTask &)> &callback)
+{
+    return impl->queryAltitudes(points, count, accuracy, callback);
+}
+
+std::shared_ptr<PreloadTask> Map::preload(const Position &position, double duration, double priority)
+{
+    return impl->preload(position, duration, priority);
+}
+
 } // namespace vts
@@ -347,6 +347,23 @@ bool aabbTest(const vec3 aabb[2], const vec4 planes[6])
     return true;
 }
 
+bool obbTest(const vec3 &center, const vec3 halfAxes[3],
+    const vec4 planes[6])
+{
+    for (uint32 i = 0; i < 6; i++)
+    {
+        const vec4 &p = planes[i]; // current plane
+        const vec3 n = vec4to3(p);
+        // projected radius of the box onto the plane normal
+        double r = std::abs(dot(n, halfAxes[0]))
+            + std::abs(dot(n, halfAxes[1]))
+            + std::abs(dot(n, halfAxes[2]));
+        if (dot(n, center) + r < -p[3])
+            return false;
+    }
+    return true;
+}
+
 namespace
 {
 
@@ -63,7 +63,19 @@ void MapCreateOptions::applyJson(const std::string &json)
     AJ(searchSrsFallback, asString);
     AJ(customSrs1, asString);
     AJ(customSrs2, asString);
+    AJ(decodeThreads, asUInt);
+    AJ(cacheReadThreads, asUInt);
+    AJ(mapLocalFiles, asBool);
+    AJ(ioThreadsPriority, asInt);
+    AJ(decodeThreadsPriority, asInt);
+    AJ(ioThreadsAffinity, asUInt64);
+    AJ(decodeThreadsAffinity, asUInt64);
+    AJ(geodataVirtualTileFeatures, asUInt);
     AJ(diskCache, asBool);
+    AJ(diskCachePacked, asBool);
+    AJ(diskCacheSeeds, asString);
+    AJ(diskCacheMaxSizeMB, asUInt);
+    AJ(diskCacheCompression, asBool);
     AJ(hashCachePaths, asBool);
     AJ(searchUrlFallbackOutsideEarth, asBool);
     AJ(browserOptionsSearchUrls, asBool);
@@ -79,7 +91,19 @@ std::string MapCreateOptions::toJson() const
     TJ(searchSrsFallback, asString);
     TJ(customSrs1, asString);
     TJ(customSrs2, asString);
+    TJ(decodeThreads, asUInt);
+    TJ(cacheReadThreads, asUInt);
+    TJ(mapLocalFiles, asBool);
+    TJ(ioThreadsPriority, asInt);
+    TJ(decodeThreadsPriority, asInt);
+    TJ(ioThreadsAffinity, asUInt64);
+    TJ(decodeThreadsAffinity, asUInt64);
+    TJ(geodataVirtualTileFeatures, asUInt);
     TJ(diskCache, asBool);
+    TJ(diskCachePacked, asBool);
+    TJ(diskCacheSeeds, asString);
+    TJ(diskCacheMaxSizeMB, asUInt);
+    TJ(diskCacheCompression, asBool);
     TJ(hashCachePaths, asBool);
     TJ(searchUrlFallbackOutsideEarth, asBool);
     TJ(browserOptionsSearchUrls, asBool);
@@ -102,13 +126,55 @@ void MapRuntimeOptions::applyJson(const std::string &json)
     AJ(pixelsPerInch, asDouble);
     AJ(renderTilesScale, asDouble);
     AJ(targetResourcesMemoryKB, asUInt);
+    AJ(targetRamMemoryKB, asUInt);
+    AJ(targetGpuMemoryKB, asUInt);
+    AJ(autoGpuMemoryBudget, asBool);
+    AJ(targetMetaTilesMemoryKB, asUInt);
+    AJ(targetMeshesMemoryKB, asUInt);
+    AJ(targetTexturesMemoryKB, asUInt);
+    AJ(targetGeodataMemoryKB, asUInt);
+    AJ(heightfieldMemoryKB, asUInt);
     AJ(maxConcurrentDownloads, asUInt);
+    AJ(maxAdaptiveDownloads, asUInt);
     AJ(maxCacheWriteQueueLength, asUInt);
+    AJ(cacheWriteBackpressure, asBool);
     AJ(maxResourceProcessesPerTick, asUInt);
+    AJ(dataUpdateBudget, asDouble);
+    AJ(decodeTimeSlice, asDouble);
+    AJ(uploadTimeSlice, asDouble);
+    AJ(queuedPriorityHalfLife, asUInt);
+    AJ(abandonedResourceTicks, asUInt);
+    AJ(queueShedThreshold, asUInt);
     AJ(maxFetchRedirections, asUInt);
     AJ(maxFetchRetries, asUInt);
     AJ(fetchFirstRetryTimeOffset, asUInt);
+    AJ(hostBlockingFailures, asUInt);
+    AJ(hostBackoffInitial, asDouble);
+    AJ(hostBackoffMaximum, asDouble);
+    AJ(traversalThreads, asUInt);
+    AJ(traverseClearingBudget, asDouble);
     AJ(measurementUnitsSystem, asUInt);
+    AJ(optimizeMeshes, asBool);
+    AJ(quantizeMeshPositions, asBool);
+    AJ(subtileIndexRanges, asBool);
+    AJ(generateMipmapsOnDecode, asBool);
+    AJ(reducedPrecisionTextures, asBool);
+    AJ(deduplicateTextures, asBool);
+    AJ(combineMaskTextures, asBool);
+    AJ(deduplicateTilesets, asBool);
+    AJ(progressiveTextures, asBool);
+    AJ(cacheGeodataLayers, asBool);
+    AJ(cacheParsedGeodataFeatures, asBool);
+    AJ(collisionMeshes, asBool);
+    AJ(colliderSimplification, asDouble);
+    AJ(geodataSimplification, asDouble);
+    AJ(searchCacheCapacity, asUInt);
+    AJ(searchCacheBucket, asDouble);
+    AJ(frameIntervalMotion, asDouble);
+    AJ(frameIntervalTransition, asDouble);
+    AJ(frameIntervalLoading, asDouble);
+    AJ(frameIntervalIdle, asDouble);
+    AJ(lowPowerMode, asBool);
     AJ(debugVirtualSurfaces, asBool);
     AJ(debugSaveCorruptedFiles, asBool);
     AJ(debugValidateGeodataStyles, asBool);
@@ -123,13 +189,55 @@ std::string MapRuntimeOptions::toJson() const
     TJ(pixelsPerInch, asDouble);
     TJ(renderTilesScale, asDouble);
     TJ(targetResourcesMemoryKB, asUInt);
+    TJ(targetRamMemoryKB, asUInt);
+    TJ(targetGpuMemoryKB, asUInt);
+    TJ(autoGpuMemoryBudget, asBool);
+    TJ(targetMetaTilesMemoryKB, asUInt);
+    TJ(targetMeshesMemoryKB, asUInt);
+    TJ(targetTexturesMemoryKB, asUInt);
+    TJ(targetGeodataMemoryKB, asUInt);
+    TJ(heightfieldMemoryKB, asUInt);
     TJ(maxConcurrentDownloads, asUInt);
+    TJ(maxAdaptiveDownloads, asUInt);
     TJ(maxCacheWriteQueueLength, asUInt);
+    TJ(cacheWriteBackpressure, asBool);
     TJ(maxResourceProcessesPerTick, asUInt);
+    TJ(dataUpdateBudget, asDouble);
+    TJ(decodeTimeSlice, asDouble);
+    TJ(uploadTimeSlice, asDouble);
+    TJ(queuedPriorityHalfLife, asUInt);
+    TJ(abandonedResourceTicks, asUInt);
+    TJ(queueShedThreshold, asUInt);
     TJ(maxFetchRedirections, asUInt);
     TJ(maxFetchRetries, asUInt);
     TJ(fetchFirstRetryTimeOffset, asUInt);
+    TJ(hostBlockingFailures, asUInt);
+    TJ(hostBackoffInitial, asDouble);
+    TJ(hostBackoffMaximum, asDouble);
+    TJ(traversalThreads, asUInt);
+    TJ(traverseClearingBudget, asDouble);
     TJ(measurementUnitsSystem, asUInt);
+    TJ(optimizeMeshes, asBool);
+    TJ(quantizeMeshPositions, asBool);
+    TJ(subtileIndexRanges, asBool);
+    TJ(generateMipmapsOnDecode, asBool);
+    TJ(reducedPrecisionTextures, asBool);
+    TJ(deduplicateTextures, asBool);
+    TJ(combineMaskTextures, asBool);
+    TJ(deduplicateTilesets, asBool);
+    TJ(progressiveTextures, asBool);
+    TJ(cacheGeodataLayers, asBool);
+    TJ(cacheParsedGeodataFeatures, asBool);
+    TJ(collisionMeshes, asBool);
+    TJ(colliderSimplification, asDouble);
+    TJ(geodataSimplification, asDouble);
+    TJ(searchCacheCapacity, asUInt);
+    TJ(searchCacheBucket, asDouble);
+    TJ(frameIntervalMotion, asDouble);
+    TJ(frameIntervalTransition, asDouble);
+    TJ(frameIntervalLoading, asDouble);
+    TJ(frameIntervalIdle, asDouble);
+    TJ(lowPowerMode, asBool);
     TJ(debugVirtualSurfaces, asBool);
     TJ(debugSaveCorruptedFiles, asBool);
     TJ(debugValidateGeodataStyles, asBool);
@@ -153,18 +261,31 @@ void CameraOptions::applyJson(const std::string &json)
     AJ(targetPixelRatioSurfaces, asDouble);
     AJ(targetPixelRatioGeodata, asDouble);
     AJ(cullingOffsetDistance, asDouble);
+    AJ(occlusionCulling, asBool);
+    AJ(farFieldDistance, asDouble);
+    AJ(farFieldRefreshThreshold, asDouble);
     AJ(minSuggestedNearClipPlaneDistance, asDouble);
     AJ(maxSuggestedNearClipPlaneDistance, asDouble);
     AJ(lodBlendingDuration, asDouble);
+    AJ(prefetchDuration, asDouble);
+    AJ(metaPrefetchRatio, asDouble);
     AJ(samplesForAltitudeLodSelection, asDouble);
     AJ(fixedTraversalDistance, asDouble);
     AJ(fixedTraversalLod, asUInt);
+    AJ(traversalBudget, asUInt);
+    AJ(coarsenessCacheTolerance, asDouble);
+    AJ(coherentTraversalJump, asDouble);
+    AJ(mergeTilesScreenSize, asDouble);
     AJ(balancedGridLodOffset, asUInt);
     AJ(balancedGridNeighborsDistance, asUInt);
     AJ(lodBlending, asUInt);
     AJE(traverseModeSurfaces, TraverseMode);
     AJE(traverseModeGeodata, TraverseMode);
+    AJE(priorityModel, PriorityModel);
     AJ(lodBlendingTransparent, asBool);
+    AJ(lodBlendingBudget, asUInt);
+    AJ(sortOpaqueByState, asBool);
+    AJ(retainedDraws, asBool);
     AJ(debugDetachedCamera, asBool);
     AJ(debugRenderSurrogates, asBool);
     AJ(debugRenderMeshBoxes, asBool);
@@ -189,18 +310,31 @@ std::string CameraOptions::toJson() const
     TJ(targetPixelRatioSurfaces, asDouble);
     TJ(targetPixelRatioGeodata, asDouble);
     TJ(cullingOffsetDistance, asDouble);
+    TJ(occlusionCulling, asBool);
+    TJ(farFieldDistance, asDouble);
+    TJ(farFieldRefreshThreshold, asDouble);
     TJ(minSuggestedNearClipPlaneDistance, asDouble);
     TJ(maxSuggestedNearClipPlaneDistance, asDouble);
     TJ(lodBlendingDuration, asDouble);
+    TJ(prefetchDuration, asDouble);
+    TJ(metaPrefetchRatio, asDouble);
     TJ(samplesForAltitudeLodSelection, asDouble);
     TJ(fixedTraversalDistance, asDouble);
     TJ(fixedTraversalLod, asUInt);
+    TJ(traversalBudget, asUInt);
+    TJ(coarsenessCacheTolerance, asDouble);
+    TJ(coherentTraversalJump, asDouble);
+    TJ(mergeTilesScreenSize, asDouble);
     TJ(balancedGridLodOffset, asUInt);
     TJ(balancedGridNeighborsDistance, asUInt);
     TJ(lodBlending, asUInt);
     TJE(traverseModeSurfaces, TraverseMode);
     TJE(traverseModeGeodata, TraverseMode);
+    TJE(priorityModel, PriorityModel);
     TJ(lodBlendingTransparent, asBool);
+    TJ(lodBlendingBudget, asUInt);
+    TJ(sortOpaqueByState, asBool);
+    TJ(retainedDraws, asBool);
     TJ(debugDetachedCamera, asBool);
     TJ(debugRenderSurrogates, asBool);
     TJ(debugRenderMeshBoxes, asBool);
@@ -315,6 +449,15 @@ void FetcherOptions::applyJson(const std::string &json)
     AJ(maxTotalConnections, asUInt);
     AJ(maxCacheConections, asUInt);
     AJ(pipelining, asUInt);
+    AJ(recordArchive, asString);
+    AJ(replayArchive, asString);
+    AJ(replayTimings, asBool);
+    AJ(simulatedLatency, asDouble);
+    AJ(simulatedJitter, asDouble);
+    AJ(simulatedLatencyDistribution, asString);
+    AJ(simulatedBandwidth, asUInt);
+    AJ(simulatedLossRate, asDouble);
+    AJ(simulatedErrorRate, asDouble);
 }
 
 std::string FetcherOptions::toJson() const
@@ -327,6 +470,15 @@ std::string FetcherOptions::toJson() const
     TJ(maxTotalConnections, asUInt);
     TJ(maxCacheConections, asUInt);
     TJ(pipelining, asUInt);
+    TJ(recordArchive, asString);
+    TJ(replayArchive, asString);
+    TJ(replayTimings, asBool);
+    TJ(simulatedLatency, asDouble);
+    TJ(simulatedJitter, asDouble);
+    TJ(simulatedLatencyDistribution, asString);
+    TJ(simulatedBandwidth, asUInt);
+    TJ(simulatedLossRate, asDouble);
+    TJ(simulatedErrorRate, asDouble);
     return jsonToString(v);
 }
 
@@ -28,22 +28,135 @@
 #include "../include/vts-browser/mapStatistics.hpp"
 #include "../include/vts-browser/cameraStatistics.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 namespace vts
 {
 
+namespace
+{
+
+const char *resourceTypeNames[] = {
+    "undefined",
+    "mapconfig",
+    "authConfig",
+    "boundLayerConfig",
+    "freeLayerConfig",
+    "tilesetMappingConfig",
+    "boundMetaTile",
+    "metaTile",
+    "mesh",
+    "texture",
+    "navTile",
+    "search",
+    "sriIndex",
+    "geodataFeatures",
+    "geodataStylesheet",
+    "font",
+};
+
+Json::Value histogramToJson(const uint32 (&h)[DownloadTimings::Bins])
+{
+    Json::Value v(Json::arrayValue);
+    for (uint32 it : h)
+        v.append(it);
+    return v;
+}
+
+Json::Value timingsToJson(const DownloadTimings &t)
+{
+    Json::Value v;
+    v["count"] = t.count;
+    v["bytes"] = (Json::UInt64)t.bytes;
+    v["total"] = histogramToJson(t.total);
+    v["dns"] = histogramToJson(t.dns);
+    v["connect"] = histogramToJson(t.connect);
+    v["tls"] = histogramToJson(t.tls);
+    v["firstByte"] = histogramToJson(t.firstByte);
+    v["transfer"] = histogramToJson(t.transfer);
+    for (const auto &it : t.httpVersions)
+        v["httpVersions"][it.first] = it.second;
+    return v;
+}
+
+// upper bound of the bin containing the given fraction of the durations
+//   the last bin is unbounded and reported by its lower bound
+double histogramPercentile(const uint32 (&h)[DownloadTimings::Bins], double p)
+{
+    uint64 total = 0;
+    for (uint32 it : h)
+        total += it;
+    if (total == 0)
+        return 0;
+    uint64 acc = 0;
+    for (uint32 i = 0; i < DownloadTimings::Bins; i++)
+    {
+        acc += h[i];
+        if (acc >= p * total)
+            return std::ldexp(1.0, std::min(i, DownloadTimings::Bins - 2));
+    }
+    return 0;
+}
+
+Json::Value stageToJson(const uint32 (&h)[DownloadTimings::Bins])
+{
+    Json::Value v;
+    v["histogram"] = histogramToJson(h);
+    v["p50"] = histogramPercentile(h, 0.50);
+    v["p95"] = histogramPercentile(h, 0.95);
+    v["p99"] = histogramPercentile(h, 0.99);
+    return v;
+}
+
+Json::Value latenciesToJson(const ResourceLatencies &l)
+{
+    Json::Value v;
+    v["cacheRead"] = stageToJson(l.cacheRead);
+    v["fetchQueue"] = stageToJson(l.fetchQueue);
+    v["decodeQueue"] = stageToJson(l.decodeQueue);
+    v["decode"] = stageToJson(l.decode);
+    v["uploadQueue"] = stageToJson(l.uploadQueue);
+    return v;
+}
+
+bool latenciesEmpty(const ResourceLatencies &l)
+{
+    for (uint32 i = 0; i < ResourceLatencies::Bins; i++)
+    {
+        if (l.cacheRead[i] || l.fetchQueue[i] || l.decodeQueue[i]
+            || l.decode[i] || l.uploadQueue[i])
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
 std::string MapStatistics::toJson() const
 {
     Json::Value v;
     TJ(resourcesCreated, asUint);
     TJ(resourcesDownloaded, asUint);
     TJ(resourcesDiskLoaded, asUint);
+    TJ(resourcesCacheSkipped, asUint);
+    TJ(resourcesRevalidated, asUint);
     TJ(resourcesDecoded, asUint);
+    TJ(resourcesDecodePreempted, asUint);
     TJ(resourcesUploaded, asUint);
+    TJ(resourcesUpgraded, asUint);
+    TJ(resourcesDeduplicated, asUint);
     TJ(resourcesFailed, asUint);
     TJ(resourcesReleased, asUint);
+    TJ(resourcesCancelled, asUint);
+    TJ(resourcesShed, asUint);
+    TJ(resourcesUploadsDeferred, asUint);
+    TJ(traverseNodesCleared, asUint);
     TJ(resourcesExists, asUint);
     TJ(resourcesActive, asUint);
     TJ(resourcesDownloading, asUint);
+    TJ(downloadsWindow, asUint);
+    TJ(downloadsBlockedHosts, asUint);
     TJ(resourcesPreparing, asUint);
     TJ(resourcesQueueCacheRead, asUint);
     TJ(resourcesQueueCacheWrite, asUint);
@@ -52,9 +165,57 @@ std::string MapStatistics::toJson() const
     TJ(resourcesQueueUpload, asUint);
     TJ(resourcesQueueAtmosphere, asUint);
     TJ(resourcesAccessed, asUint);
+    TJ(resourcesQueueReprioritized, asUint);
+    TJ(resourcesQueueContentions, asUint);
+    TJ(meshesOptimized, asUint);
+    TJ(meshesAcmrBefore, asDouble);
+    TJ(meshesAcmrAfter, asDouble);
     TJ(currentGpuMemUseKB, asUint);
     TJ(currentRamMemUseKB, asUint);
+    TJ(dataUploadTime, asDouble);
+    v["bufferPoolHits"] = (Json::UInt64)bufferPoolHits;
+    v["bufferPoolMisses"] = (Json::UInt64)bufferPoolMisses;
+    TJ(bufferPoolRetainedKB, asUint);
     TJ(renderTicks, asUint);
+    TJ(timeToMapconfigAvailable, asDouble);
+    TJ(timeToMapconfigReady, asDouble);
+    TJ(timeToFirstDraw, asDouble);
+    TJ(timeToRenderComplete, asDouble);
+    for (auto it : decodeWorkersUtilization)
+        v["decodeWorkersUtilization"].append(it);
+    for (auto it : cacheReadWorkersUtilization)
+        v["cacheReadWorkersUtilization"].append(it);
+    static const uint32 namesCount
+        = sizeof(resourceTypeNames) / sizeof(resourceTypeNames[0]);
+    for (uint32 i = 0; i < currentMemUsePerTypeKB.size(); i++)
+    {
+        if (currentMemUsePerTypeKB[i] == 0)
+            continue;
+        std::string name = i < namesCount ? resourceTypeNames[i]
+            : std::to_string(i);
+        v["currentMemUsePerTypeKB"][name] = currentMemUsePerTypeKB[i];
+    }
+    for (const auto &it : currentMemUsePerStateKB)
+        v["currentMemUsePerStateKB"][it.first] = it.second;
+    TJ(currentTraverseMemUseKB, asUint);
+    TJ(currentTraverseNodes, asUint);
+    TJ(currentHeightfieldMemUseKB, asUint);
+    for (uint32 i = 0; i < downloadTimings.size(); i++)
+    {
+        if (downloadTimings[i].count == 0)
+            continue;
+        std::string name = i < namesCount ? resourceTypeNames[i]
+            : std::to_string(i);
+        v["downloadTimings"][name] = timingsToJson(downloadTimings[i]);
+    }
+    for (uint32 i = 0; i < resourceLatencies.size(); i++)
+    {
+        if (latenciesEmpty(resourceLatencies[i]))
+            continue;
+        std::string name = i < namesCount ? resourceTypeNames[i]
+            : std::to_string(i);
+        v["resourceLatencies"][name] = latenciesToJson(resourceLatencies[i]);
+    }
     return jsonToString(v);
 }
 
@@ -67,9 +228,24 @@ std::string CameraStatistics::toJson() const
         v["metaNodesTraversedPerLod"].append(it);
     TJ(nodesRenderedTotal, asUInt);
     TJ(metaNodesTraversedTotal, asUInt);
+    TJ(nodesOccludedTotal, asUInt);
+    TJ(nodesBeyondHorizonTotal, asUInt);
+    TJ(nodesSkippedByBudget, asUInt);
+    TJ(nodesMergedTotal, asUInt);
+    TJ(nodesBlendingSnapped, asUInt);
+    TJ(framesOverBudget, asUInt);
     TJ(currentNodeMetaUpdates, asUInt);
     TJ(currentNodeDrawsUpdates, asUInt);
+    TJ(currentNodeDrawsWaiting, asUInt);
     TJ(currentGridNodes, asUInt);
+    TJ(currentPrefetchNodes, asUInt);
+    TJ(timeUpdate, asDouble);
+    TJ(timeTraversal, asDouble);
+    TJ(timeBlending, asDouble);
+    TJ(timeSorting, asDouble);
+    TJ(timePrefetch, asDouble);
+    for (auto it : timeLayers)
+        v["timeLayers"].append(it);
     return jsonToString(v);
 }
 
@@ -0,0 +1,338 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/trace.hpp"
+#include "../utilities/json.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+
+namespace vts
+{
+
+namespace
+{
+
+// events kept per thread, the oldest are overwritten
+static const uint32 RingCapacity = 32768;
+
+std::atomic<bool> enabled{ false };
+
+sint64 now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct TraceEvent
+{
+    const char *name = nullptr;
+    const char *category = nullptr;
+    std::string key; // asynchronous spans only
+    std::string args; // json members, without the braces
+    sint64 begin = 0;
+    sint64 end = 0;
+    char phase = 0; // X = complete, i = instant, b = async span
+};
+
+struct ThreadTrace
+{
+    std::vector<TraceEvent> ring;
+    std::vector<std::string> argsStack; // tags of the open scopes
+    std::string name;
+    uint64 written = 0;
+    uint32 id = 0;
+    std::mutex mut; // taken by the exporter
+
+    TraceEvent &next()
+    {
+        if (ring.size() < RingCapacity)
+        {
+            ring.emplace_back();
+            written++;
+            return ring.back();
+        }
+        return ring[written++ % RingCapacity];
+    }
+};
+
+struct Registry
+{
+    std::vector<std::shared_ptr<ThreadTrace>> threads;
+    std::mutex mut;
+    uint32 nextId = 1;
+};
+
+Registry &registry()
+{
+    static Registry r;
+    return r;
+}
+
+ThreadTrace &thisThread()
+{
+    thread_local std::shared_ptr<ThreadTrace> t;
+    if (!t)
+    {
+        t = std::make_shared<ThreadTrace>();
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mut);
+        t->id = r.nextId++;
+        r.threads.push_back(t);
+    }
+    return *t;
+}
+
+std::string jsonQuote(const char *s)
+{
+    return Json::valueToQuotedString(s);
+}
+
+void addTag(const char *name, const std::string &value)
+{
+    if (!enabled)
+        return;
+    ThreadTrace &t = thisThread();
+    std::lock_guard<std::mutex> lock(t.mut);
+    std::string member = jsonQuote(name) + ":" + value;
+    if (!t.argsStack.empty())
+    {
+        // attach to the innermost open scope
+        std::string &a = t.argsStack.back();
+        if (!a.empty())
+            a += ",";
+        a += member;
+        return;
+    }
+    TraceEvent &e = t.next();
+    e.name = name;
+    e.category = "tag";
+    e.key.clear();
+    e.args = member;
+    e.begin = e.end = now();
+    e.phase = 'i';
+}
+
+std::string timestamp(sint64 ns)
+{
+    // microseconds
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(3) << ns * 1e-3;
+    return ss.str();
+}
+
+} // namespace
+
+void setTraceEnabled(bool enable)
+{
+    enabled = enable;
+}
+
+bool getTraceEnabled()
+{
+    return enabled;
+}
+
+void clearTrace()
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mut);
+    for (auto &t : r.threads)
+    {
+        std::lock_guard<std::mutex> lock2(t->mut);
+        t->ring.clear();
+        t->written = 0;
+    }
+}
+
+std::string exportTrace()
+{
+    std::ostringstream ss;
+    ss << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    const auto &sep = [&]() {
+        if (!first)
+            ss << ",\n";
+        first = false;
+    };
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mut);
+    for (auto &t : r.threads)
+    {
+        std::lock_guard<std::mutex> lock2(t->mut);
+        const std::string common = ",\"pid\":1,\"tid\":"
+            + std::to_string(t->id);
+        if (!t->name.empty())
+        {
+            sep();
+            ss << "{\"ph\":\"M\",\"name\":\"thread_name\"" << common
+                << ",\"args\":{\"name\":" << jsonQuote(t->name.c_str())
+                << "}}";
+        }
+        const uint64 count = t->ring.size();
+        for (uint64 i = 0; i < count; i++)
+        {
+            // oldest first
+            const TraceEvent &e = t->ring[(t->written - count + i)
+                % RingCapacity];
+            const std::string name = jsonQuote(e.name);
+            const std::string cat = jsonQuote(e.category);
+            const std::string args = "\"args\":{" + e.args + "}";
+            switch (e.phase)
+            {
+            case 'X':
+                sep();
+                ss << "{\"ph\":\"X\",\"name\":" << name << ",\"cat\":"
+                    << cat << common << ",\"ts\":" << timestamp(e.begin)
+                    << ",\"dur\":" << timestamp(e.end - e.begin) << ","
+                    << args << "}";
+                break;
+            case 'i':
+                sep();
+                ss << "{\"ph\":\"i\",\"s\":\"t\",\"name\":" << name
+                    << ",\"cat\":" << cat << common << ",\"ts\":"
+                    << timestamp(e.begin) << "," << args << "}";
+                break;
+            case 'b':
+            {
+                const std::string id = ",\"id2\":{\"local\":"
+                    + jsonQuote(e.key.c_str()) + "}";
+                sep();
+                ss << "{\"ph\":\"b\",\"name\":" << name << ",\"cat\":"
+                    << cat << common << id << ",\"ts\":"
+                    << timestamp(e.begin) << "," << args << "}";
+                sep();
+                ss << "{\"ph\":\"e\",\"name\":" << name << ",\"cat\":"
+                    << cat << common << id << ",\"ts\":"
+                    << timestamp(e.end) << "}";
+            } break;
+            default:
+                break;
+            }
+        }
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+void traceThread(const char *name)
+{
+    ThreadTrace &t = thisThread();
+    std::lock_guard<std::mutex> lock(t.mut);
+    t.name = name;
+}
+
+void traceTag(const char *name, const char *value)
+{
+    if (enabled)
+        addTag(name, jsonQuote(value));
+}
+
+void traceTag(const char *name, double value)
+{
+    if (enabled)
+        addTag(name, Json::valueToString(value));
+}
+
+void traceTag(const char *name, sint64 value)
+{
+    if (enabled)
+        addTag(name, std::to_string(value));
+}
+
+void traceTag(const char *name, uint64 value)
+{
+    if (enabled)
+        addTag(name, std::to_string(value));
+}
+
+void traceTag(const char *name, sint32 value)
+{
+    traceTag(name, (sint64)value);
+}
+
+void traceTag(const char *name, uint32 value)
+{
+    traceTag(name, (uint64)value);
+}
+
+void traceAsyncSpan(const char *category, const char *name,
+    const std::string &key, sint64 beginNs, sint64 endNs)
+{
+    if (!enabled)
+        return;
+    ThreadTrace &t = thisThread();
+    std::lock_guard<std::mutex> lock(t.mut);
+    TraceEvent &e = t.next();
+    e.name = name;
+    e.category = category;
+    e.key = key;
+    e.args = "\"key\":" + jsonQuote(key.c_str());
+    e.begin = beginNs;
+    e.end = endNs;
+    e.phase = 'b';
+}
+
+TraceScope::TraceScope(const char *function, const char *name)
+    : name(name && name[0] ? name : function), begin(0)
+{
+    if (!enabled)
+        return;
+    ThreadTrace &t = thisThread();
+    std::lock_guard<std::mutex> lock(t.mut);
+    t.argsStack.emplace_back();
+    begin = now();
+}
+
+TraceScope::~TraceScope()
+{
+    if (!begin)
+        return;
+    const sint64 end = now();
+    ThreadTrace &t = thisThread();
+    std::lock_guard<std::mutex> lock(t.mut);
+    TraceEvent &e = t.next();
+    e.name = name;
+    e.category = "cpu";
+    e.key.clear();
+    if (!t.argsStack.empty())
+    {
+        e.args = std::move(t.argsStack.back());
+        t.argsStack.pop_back();
+    }
+    else
+        e.args.clear();
+    e.begin = begin;
+    e.end = end;
+    e.phase = 'X';
+}
+
+} // namespace vts
@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef CACHE_HPP_sdf4g56hj4k
+#define CACHE_HPP_sdf4g56hj4k
+
+#include <memory>
+#include <string>
+
+#include "include/vts-browser/foundation.hpp"
+
+namespace vts
+{
+
+class MapCreateOptions;
+class CacheData;
+class Buffer;
+
+class Cache : private Immovable
+{
+public:
+    static std::shared_ptr<Cache> create(const MapCreateOptions &options);
+
+    virtual ~Cache();
+    virtual void write(const CacheData &cd) = 0;
+
+    // writes multiple items at once
+    //   the default implementation writes the items one by one
+    virtual void write(const std::vector<CacheData> &batch);
+    virtual CacheData read(const std::string &name) = 0;
+    virtual void purge() = 0;
+
+    // false if the entry is certainly not in the cache
+    //   allows skipping the cache read thread for definite misses
+    // must be cheap, it is called on the data thread
+    // the default implementation does not know
+    virtual bool mayContain(const std::string &name);
+
+    // called periodically on the cache write thread
+    //   to enforce the size limit, etc.
+    // each call should do only limited amount of work
+    virtual void maintenance();
+
+    static std::string stripScheme(const std::string &name);
+};
+
+// all cache entries begin with this header
+//   followed by the name, the validators (etag and last-modified)
+//   and the content
+struct CacheHeader
+{
+    static const char Magic[];
+    static const uint16 Version;
+
+    enum class Flags : uint16
+    {
+        None = 0,
+        AvailFailed = 1 << 0,
+        Compressed = 1 << 1, // zlib, the rawSize is the original size
+    };
+
+    char magic[16];
+    uint16 version;
+    uint16 flags;
+    uint16 nameLen;
+    uint16 etagLen;
+    uint16 lastModifiedLen;
+    uint32 rawSize;
+    sint64 expires;
+
+    // fill in the header including magic and version
+    void initialize(const CacheData &cd, const std::string &name);
+
+    // compose whole entry, including the header, name and validators
+    static Buffer encode(const CacheData &cd, const std::string &name);
+
+    // validate magic, version, expiration and name
+    //   (the name is expected to immediately follow the header)
+    // available is number of bytes valid starting at the header
+    // copies expiration, flags and validators into cd
+    // expired entries with validators are accepted and marked stale
+    bool validate(CacheData &cd, const std::string &name,
+        uint64 available) const;
+
+    // offset of the content from the beginning of the header
+    uint32 contentOffset() const;
+
+    // the content referring into the owner memory
+    //   or its decompressed copy
+    Buffer content(const std::shared_ptr<void> &owner,
+        uint64 available) const;
+};
+
+std::string cacheRoot(const MapCreateOptions &options);
+void purgeDirectory(const std::string &root);
+std::shared_ptr<Cache> createFilesCache(const MapCreateOptions &options);
+std::shared_ptr<Cache> createPackedCache(const MapCreateOptions &options);
+std::shared_ptr<Cache> createPackedSeedCache(const std::string &root);
+std::shared_ptr<Cache> createSeedCache(const MapCreateOptions &options,
+    const std::string &root);
+std::shared_ptr<Cache> createIdbCache(const MapCreateOptions &options);
+
+} // namespace vts
+
+#endif
@@ -31,6 +31,7 @@
 #include <vector>
 #include <unordered_map>
 #include <map>
+#include <mutex>
 
 #include <vts-libs/registry/referenceframe.hpp>
 
@@ -41,6 +42,10 @@
 #include "include/vts-browser/math.hpp"
 
 #include "subtileMerger.hpp"
+#include "credits.hpp"
+#include "renderTasks.hpp"
+#include "hashTileId.hpp"
+#include "utilities/frameArena.hpp"
 
 namespace vts
 {
@@ -51,15 +56,14 @@ class MapImpl;
 class Camera;
 class TraverseNode;
 class NavigationImpl;
-class RenderSurfaceTask;
-class RenderInfographicsTask;
-class RenderColliderTask;
 class GpuTexture;
+class MeshPart;
 class DrawSurfaceTask;
 class DrawGeodataTask;
 class DrawInfographicsTask;
 class DrawColliderTask;
 class MapLayer;
+class GeodataPartition;
 class BoundParamInfo;
 
 using TileId = vtslibs::registry::ReferenceFrame::Division::Node::Id;
@@ -84,10 +88,68 @@ public:
     OldDraw(const TileId &id);
 };
 
+class RetainedDrawState
+{
+public:
+    // identify the draw, the ids may collide
+    const void *mesh = nullptr;
+    const void *texColor = nullptr;
+    const void *texMask = nullptr;
+    float uvClip[4];
+    float uvTrans[4];
+    float color[4];
+    float blendingCoverage = 0;
+    uint32 frame = 0;
+    bool externalUv = false;
+    bool transparent = false;
+};
+
+// corners resolved for altitude interpolation
+class SurfaceSample
+{
+public:
+    vec2 points[4];
+    double altitudes[4];
+    uint32 metaEpoch = 0;
+    uint32 lastAccessTick = 0;
+    bool valid = false;
+    bool complete = false; // all corners are found at the desired lod
+};
+
 class CameraMapLayer
 {
 public:
     std::vector<OldDraw> blendDraws;
+
+    // cut of the tree rendered in previous frame by coherent traversal
+    std::vector<TraverseNode*> coherentFrontier;
+    vec3 coherentEye = vec3(0, 0, 0);
+    vec3 coherentForward = vec3(0, 0, 0);
+    uint32 coherentTick = 0;
+};
+
+// max-depth pyramid of a previously rendered frame
+class OcclusionDepth : private Immovable
+{
+public:
+    OcclusionDepth(const float *depth, uint32 width, uint32 height,
+        const mat4 &viewProj);
+
+    // returns true if the box is entirely behind the recorded depth
+    // the box is projected with the matrix of the recorded frame
+    //   which avoids reprojecting the depth itself
+    bool occluded(const vec3 &center, const vec3 halfAxes[3]) const;
+
+private:
+    struct Level
+    {
+        std::vector<float> data;
+        uint32 width = 0;
+        uint32 height = 0;
+    };
+
+    std::vector<Level> levels;
+    mat4 viewProj;
 };
 
 class CameraImpl : private Immovable
@@ -97,13 +159,34 @@ public:
     Camera *const camera = nullptr;
     std::weak_ptr<NavigationImpl> navigation;
     CameraCredits credits;
+    CreditsRanking creditsRanking;
     CameraDraws draws;
     CameraOptions options;
     CameraStatistics statistics;
     std::vector<TileId> gridLoadRequests;
+    TraverseNode *gridLastRequest = nullptr; // siblings share the same base
     std::vector<CurrentDraw> currentDraws;
-    std::unordered_map<TraverseNode*, SubtilesMerger> opaqueSubtiles;
+    FrameArena frameArena; // temporary containers, reset in clear
+    std::vector<RenderColliderTask> renderedColliders; // for ray casting
+    SubtilesMerger opaqueSubtiles;
     std::map<std::weak_ptr<MapLayer>, CameraMapLayer, std::owner_less<std::weak_ptr<MapLayer>>> layers;
+    std::vector<std::unique_ptr<CameraImpl>> layerCameras; // helpers for concurrent traversal
+    std::vector<std::pair<uint64, uint32>> sortKeys, sortKeysTmp; // sorting opaque draws
+    std::vector<DrawSurfaceTask> sortDraws;
+    std::unordered_map<uint64, RetainedDrawState> retainedDraws;
+    std::unordered_map<TileId, SurfaceSample> surfaceSamples;
+    uint32 maxSurfaceSamples = 256; // all are cleared when exceeded
+    bool persistentSurfaceSamples = false; // complete samples survive meta changes
+    std::shared_ptr<const OcclusionDepth> occlusionDepth;
+    // renderer feedback, may arrive while the camera is traversing
+    //   it is applied at the beginning of the next render update
+    std::mutex feedbackMutex;
+    std::shared_ptr<const OcclusionDepth> feedbackOcclusionDepth;
+    double feedbackResolutionScale = 1;
+    // cameras sharing single traversal
+    std::weak_ptr<CameraImpl> traversalLeader;
+    std::vector<std::weak_ptr<CameraImpl>> traversalFollowers;
+    std::vector<std::shared_ptr<CameraImpl>> traversalGroup; // current frame
     // *Actual = corresponds to current camera settings
     // *Render, *Culling, updated only when camera is NOT detached
     mat4 viewProjActual;
@@ -120,49 +203,148 @@ public:
     double diskNominalDistance = 0;
     uint32 windowWidth = 0;
     uint32 windowHeight = 0;
+    double resolutionScale = 1; // rendered pixels per viewport pixel
+    uint32 occlusionTick = 0;
+    uint32 retainedFrame = 0;
+
+    // camera motion estimation for prefetching
+    vec3 prefetchLastEye, prefetchLastTarget;
+    vec3 prefetchEyeVelocity, prefetchTargetVelocity;
+    bool prefetchMotionValid = false;
+    bool prefetching = false;
+    float prefetchWeight = 1; // scales the priorities while prefetching
+
+    // average download sizes for PriorityModel::ScreenSpaceError
+    //   updated every frame from the download timings
+    double priorityBytesSurfaces = 0, priorityBytesGeodata = 0;
+    bool traversalBudgetHit = false; // in previous frame
+
+    // far field impostor, see CameraOptions::farFieldDistance
+    vec3 farFieldEye = nan3(); // where the impostor was last rendered
+    double farFieldDistance = 0; // the option when it was rendered
+    uint32 farFieldPending = 0; // far nodes still resolving in this frame
+    bool farFieldRefresh = false; // the far nodes are traversed in this frame
+    bool farFieldSettling = false; // some far nodes were not resolved yet
+
+    // render on demand, see Camera::needsRedraw
+    struct RedrawState
+    {
+        std::vector<double> inputs; // view, projection and navigation targets
+        std::vector<double> inputsTmp;
+        std::string options; // json of the camera and navigation options
+        uint64 drawsHash = 0;
+        bool drawsChanged = true;
+        bool moving = false; // the inputs changed in the last update
+        bool tracking = false; // enabled by the first query
+    } redraw;
+
+    // validity of coarseness cached in traverse nodes
+    mat4 coarsenessProj;
+    vec3 coarsenessForward, coarsenessPerpendicular;
+    vec3 coarsenessOffset; // of a follower to its leader
+    uint32 coarsenessEpoch = 0;
+    double coarsenessHeight = 0;
+    bool coarsenessDisks = false;
 
     CameraImpl(MapImpl *map, Camera *cam);
     void clear();
+    Validity resolveBoundLayers(TraverseNode *trav, uint32 subMeshIndex, const MeshPart &part, std::vector<BoundParamInfo> &boundList);
     Validity reorderBoundLayers(TileId tileId, TileId localId, uint32 subMeshIndex, std::vector<BoundParamInfo> &boundList, double priority);
     void touchDraws(TraverseNode *trav);
     bool visibilityTest(TraverseNode *trav);
+    bool frustumTest(TraverseNode *trav);
+    bool horizonTest(TraverseNode *trav);
+    bool occlusionTest(TraverseNode *trav);
     bool coarsenessTest(TraverseNode *trav);
+    bool mergeTest(TraverseNode *trav);
+    bool farFieldTest(const TraverseNode *trav);
+    void updateFarField();
     double coarsenessValue(TraverseNode *trav);
+    double coarsenessCompute(TraverseNode *trav);
+    double coarsenessComputeView(TraverseNode *trav);
+    bool coarsenessViewChanged(const vec3 &leaderPos, double tol);
+    void updateCoarsenessEpoch();
     float getTextSize(float size, const std::string &text);
     void renderText(TraverseNode *trav, float x, float y, const vec4f &color, float size, const std::string &text, bool centerText = true);
     void renderNodeBox(TraverseNode *trav, const vec4f &color);
-    void renderNode(TraverseNode *trav, TraverseNode *orig);
-    void renderNode(TraverseNode *trav);
-    void renderNodeCoarser(TraverseNode *trav, TraverseNode *orig);
-    void renderNodeCoarser(TraverseNode *trav);
+    // the traversal kernels and the node rendering are instantiated
+    //   for each combination of these flags
+    //   so that the disabled features cost nothing per node
+    enum TravFeatures : uint32
+    {
+        TravDebug = 1 << 0, // any of the debug boxes or the tile diagnostics
+        TravBlending = 1 << 1, // lod blending
+        TravFeaturesCombinations = 1 << 2,
+    };
+    uint32 travFeatures() const;
+    void renderNodeDebug(TraverseNode *trav, TraverseNode *orig);
+    template<uint32 F> void renderNode(TraverseNode *trav, TraverseNode *orig);
+    template<uint32 F> void renderNode(TraverseNode *trav);
+    template<uint32 F> void renderNodeCoarser(TraverseNode *trav, TraverseNode *orig);
+    template<uint32 F> void renderNodeCoarser(TraverseNode *trav);
     void renderNodeDraws(TraverseNode *trav, TraverseNode *orig, float blendingCoverage);
     DrawSurfaceTask convert(const RenderSurfaceTask &task);
     DrawSurfaceTask convert(const RenderSurfaceTask &task, const vec4f &uvClip, float blendingCoverage);
     DrawInfographicsTask convert(const RenderInfographicsTask &task);
     DrawColliderTask convert(const RenderColliderTask &task);
     bool generateMonolithicGeodataTrav(TraverseNode *trav);
-    std::shared_ptr<GpuTexture> travInternalTexture(TraverseNode *trav, uint32 subMeshIndex);
+    bool generateVirtualGeodataTrav(TraverseNode *trav, const GeodataPartition *partition, int displaySize);
+    std::shared_ptr<GpuTexture> travInternalTexture(TraverseNode *trav, MeshPart &part, uint32 subMeshIndex);
+    void travRequestMeta(TraverseNode *trav);
+    void travPrefetchChildsMeta(TraverseNode *trav);
     bool travDetermineMeta(TraverseNode *trav);
     bool travDetermineDraws(TraverseNode *trav);
     bool travDetermineDrawsSurface(TraverseNode *trav);
     bool travDetermineDrawsGeodata(TraverseNode *trav);
     double travDistance(TraverseNode *trav, const vec3 pointPhys);
     void updateNodePriority(TraverseNode *trav);
+    float screenSpaceErrorPriority(TraverseNode *trav);
+    double visibleFraction(TraverseNode *trav);
+    double screenSize(TraverseNode *trav);
+    void updatePriorityBytes();
     bool travInit(TraverseNode *trav);
-    void travModeHierarchical(TraverseNode *trav, bool loadOnly);
-    void travModeFlat(TraverseNode *trav);
-    bool travModeStable(TraverseNode *trav, int mode);
-    bool travModeBalanced(TraverseNode *trav, bool renderOnly);
-    void travModeFixed(TraverseNode *trav);
-    void traverseRender(TraverseNode *trav);
+    bool travBudget(TraverseNode *trav);
+    uint32 travChildsOffset(TraverseNode *trav);
+    template<uint32 F, bool LoadOnly> void travModeHierarchical(TraverseNode *trav);
+    template<uint32 F> void travModeFlat(TraverseNode *trav);
+    template<uint32 F, int Mode> bool travModeStable(TraverseNode *trav);
+    template<uint32 F, bool RenderOnly> bool travModeBalanced(TraverseNode *trav);
+    template<uint32 F, bool RenderOnly> bool travModeBalancedChilds(TraverseNode *trav);
+    template<uint32 F> void travModeFixed(TraverseNode *trav);
+    template<uint32 F> void travModeCoherent(TraverseNode *trav, std::vector<TraverseNode*> &frontier);
+    template<uint32 F> void travModeCoherent(TraverseNode *root, CameraMapLayer &layer);
+    template<uint32 F> void traverseRender(TraverseNode *trav, CameraMapLayer &layer);
+    void traverseRender(TraverseNode *trav, CameraMapLayer &layer);
     void gridPreloadRequest(TraverseNode *trav);
     void gridPreloadProcess(TraverseNode *root);
-    void gridPreloadProcess(TraverseNode *trav, const std::vector<TileId> &requests);
+    void gridPreloadProcess(TraverseNode *trav,
+        std::vector<TileId>::iterator begin,
+        std::vector<TileId>::iterator end);
+    void prefetchUpdate();
+    void travModePrefetch(TraverseNode *trav, uint32 &budget);
+    static float prefetchPriority(float priority);
     void resolveBlending(TraverseNode *root, CameraMapLayer &layer);
     void sortOpaqueFrontToBack();
+    void publishRetainedDraws();
+    void shareDraws(CameraImpl &follower);
+    void publishDraws();
+    uint64 drawsSignature() const;
+    void redrawInputs(std::vector<double> &inputs);
+    std::string redrawOptions();
+    void redrawUpdate();
+    bool redrawNeeded();
+    bool redrawInputsChanged();
+    double frameInterval(); // see Map::recommendedFrameInterval
+    void updateTraversalGroup();
+    void updateRenderVariables();
+    void traverseLayer(MapLayer *layer, CameraMapLayer &cameraLayer);
+    void traverseLayers();
+    void copyFrameState(const CameraImpl &other);
+    void mergeLayerCamera(CameraImpl &other);
     void renderUpdate();
     void suggestedNearFar(double &near_, double &far_);
-    bool getSurfaceOverEllipsoid(double &result, const vec3 &navPos, double sampleSize = -1, bool renderDebug = false);
+    bool intersectRay(const vec3 &origin, const vec3 &direction, double &t);
+    bool getSurfaceOverEllipsoid(double &result, const vec3 &navPos, double sampleSize = -1, bool renderDebug = false, bool *complete = nullptr);
     double getSurfaceAltitudeSamples();
 };
 
@@ -158,7 +158,7 @@ double quadrilateralSolver(const vec2 &p,
 double altitudeInterpolation(
     const vec2 &query,
     const vec2 points[4],
-    double values[4])
+    const double values[4])
 {
     return quadrilateralSolver(query,
         points[0], points[1], points[2], points[3],
@@ -166,10 +166,23 @@ double altitudeInterpolation(
     );
 }
 
+bool metaTilesFailed(MapImpl *map, TraverseNode *trav)
+{
+    if (trav->metaTiles.empty())
+        return false;
+    for (const auto &m : trav->metaTiles)
+        if (m && map->getResourceValidity(m) == Validity::Indeterminate)
+            return false;
+    return true;
+}
+
+// complete is false if the search stopped at a node
+//   whose children are still being downloaded
 TraverseNode *findTravSds(CameraImpl *camera, TraverseNode *where,
-        const vec2 &pointSds, uint32 maxLod)
+        const vec2 &pointSds, uint32 maxLod, bool &complete)
 {
     assert(where && where->meta);
+    complete = true;
     if (where->id.lod >= maxLod)
         return where;
 
@@ -190,8 +203,12 @@ TraverseNode *findTravSds(CameraImpl *camera, TraverseNode *where,
                 continue;
         }
         if (!camera->travInit(&ci))
+        {
+            if (!metaTilesFailed(camera->map, &ci))
+                complete = false;
             continue;
-        return findTravSds(camera, &ci, pointSds, maxLod);
+        }
+        return findTravSds(camera, &ci, pointSds, maxLod, complete);
     }
     return where;
 }
@@ -200,18 +217,30 @@ TraverseNode *findTravSds(CameraImpl *camera, TraverseNode *where,
 
 bool CameraImpl::getSurfaceOverEllipsoid(
     double &result, const vec3 &navPos,
-    double sampleSize, bool renderDebug)
+    double sampleSize, bool renderDebug, bool *complete)
 {
     OPTICK_EVENT();
     assert(map->convertor);
     assert(!map->layers.empty());
 
+    if (sampleSize <= 0)
+        sampleSize = getSurfaceAltitudeSamples();
+
+    // the cameras of the application use the heightfield of the map
+    //   the debug visualization needs the nodes of this camera
+    if (camera && !renderDebug && map->options.heightfieldMemoryKB > 0)
+        return map->heightfield->getSurfaceOverEllipsoid(result, navPos,
+            sampleSize, complete);
+
+    // the answer is final unless some of the nodes are still loading
+    bool dummy;
+    bool &done = complete ? *complete : dummy;
+    done = false;
+
     TraverseNode *root = map->layers[0]->traverseRoot.get();
     if (!root || !root->meta)
         return false;
-
-    if (sampleSize <= 0)
-        sampleSize = getSurfaceAltitudeSamples();
+    done = true;
 
     // find surface division coordinates (and appropriate node info)
     vec2 sds;
@@ -249,7 +278,8 @@ bool CameraImpl::getSurfaceOverEllipsoid(
         -std::log2(sampleSize / info->extents().size()));
 
     // find corner positions
-    vec2 points[4];
+    vec2 corners[4];
+    TileId sampleId;
     {
         NodeInfo i = *info;
         while (i.nodeId().lod < desiredLod)
@@ -267,45 +297,78 @@ bool CameraImpl::getSurfaceOverEllipsoid(
         vec2 center = vecFromUblas<vec2>(ext.ll + ext.ur) * 0.5;
         vec2 size = vecFromUblas<vec2>(ext.ur - ext.ll);
         vec2 p = sds;
+        uint32 quadrant = 0;
         if (sds(0) < center(0))
             p(0) -= size(0);
+        else
+            quadrant += 1;
         if (sds(1) < center(1))
+        {
             p(1) -= size(1);
-        points[0] = p;
-        points[1] = p + vec2(size(0), 0);
-        points[2] = p + vec2(0, size(1));
-        points[3] = p + size;
+            quadrant += 2;
+        }
+        corners[0] = p;
+        corners[1] = p + vec2(size(0), 0);
+        corners[2] = p + vec2(0, size(1));
+        corners[3] = p + size;
         // todo periodicity
+        // all queries in the same quadrant share the corners
+        sampleId = vtslibs::vts::children(i.nodeId())[quadrant];
     }
 
     // find the actual corners
-    TraverseNode *travRoot = findTravById(root, info->nodeId());
-    if (!travRoot || !travRoot->meta)
-        return false;
-    double altitudes[4];
-    const TraverseNode *nodes[4];
-    for (int i = 0; i < 4; i++)
+    //   they are reused until any meta node changes
+    //   complete samples of persistent cache do not depend on the nodes
+    if (surfaceSamples.size() >= maxSurfaceSamples)
+        surfaceSamples.clear();
+    const auto ins = surfaceSamples.emplace(sampleId, SurfaceSample());
+    SurfaceSample &sample = ins.first->second;
+    sample.lastAccessTick = map->renderTickIndex;
+    const TraverseNode *nodes[4] = {};
+    if (ins.second || renderDebug
+        || (sample.metaEpoch != map->metaNodesEpoch
+            && !(persistentSurfaceSamples && sample.complete)))
     {
-        auto t = findTravSds(this, travRoot, points[i], desiredLod);
-        if (!t)
-            return false;
-        if (!t->meta->surrogateNav)
-            return false;
-        const math::Extents2 &ext = t->meta->extents;
-        points[i] = vecFromUblas<vec2>(ext.ll + ext.ur) * 0.5;
-        altitudes[i] = *t->meta->surrogateNav;
-        nodes[i] = t;
+        sample.valid = false;
+        sample.complete = false;
+        TraverseNode *travRoot = findTravById(root, info->nodeId());
+        if (travRoot && travRoot->meta)
+        {
+            sample.valid = true;
+            sample.complete = true;
+            for (int i = 0; i < 4; i++)
+            {
+                bool c;
+                auto t = findTravSds(this, travRoot, corners[i],
+                    desiredLod, c);
+                sample.complete = sample.complete && c;
+                if (!t || !t->meta->surrogateNav)
+                {
+                    sample.valid = false;
+                    break;
+                }
+                const math::Extents2 &ext = t->meta->extents;
+                sample.points[i] = vecFromUblas<vec2>(ext.ll + ext.ur) * 0.5;
+                sample.altitudes[i] = *t->meta->surrogateNav;
+                nodes[i] = t;
+            }
+        }
+        // the search itself may have loaded new meta nodes
+        sample.metaEpoch = map->metaNodesEpoch;
     }
+    done = sample.complete;
+    if (!sample.valid)
+        return false;
 
     // interpolate
-    double res = altitudeInterpolation(sds, points, altitudes);
+    double res = altitudeInterpolation(sds, sample.points, sample.altitudes);
 
     // debug visualization
     if (renderDebug)
     {
         RenderInfographicsTask task;
         task.mesh = map->getMesh("internal://data/meshes/sphere.obj");
-        task.mesh->priority = inf1();
+        task.mesh->updatePriority(inf1());
         if (*task.mesh)
         {
             float c = std::isnan(res) ? 0.0 : 1.0;
@@ -31,6 +31,8 @@
 #include "../validity.hpp"
 #include "../gpuResource.hpp"
 #include "../metaTile.hpp"
+#include "../traverseNode.hpp"
+#include "../mapLayer.hpp"
 
 namespace vts
 {
@@ -151,8 +153,14 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
     }
 
     transparent = bound->isTransparent || (!!alpha && *alpha < 1);
+    maskFolded = false;
+
+    if (!watertight && impl->map->options.combineMaskTextures)
+        return prepareMasked(impl, bound->urlExtTex(vars),
+            bound->urlMask(vars), priority);
 
     textureColor = impl->map->getTexture(bound->urlExtTex(vars));
+    textureColor->tileTexture = true;
     textureColor->updatePriority(priority);
     textureColor->updateAvailability(bound->availability);
     switch (impl->map->getResourceValidity(textureColor))
@@ -167,6 +175,7 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
     if (!watertight)
     {
         textureMask = impl->map->getTexture(bound->urlMask(vars));
+        textureMask->tileTexture = true;
         textureMask->updatePriority(priority);
         switch (impl->map->getResourceValidity(textureMask))
         {
@@ -184,6 +193,132 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
     return Validity::Valid;
 }
 
+Validity BoundParamInfo::prepareMasked(CameraImpl *impl,
+    const std::string &colorUrl, const std::string &maskUrl, double priority)
+{
+    MapImpl *map = impl->map;
+    const std::string name = GpuMaskedTexture::nameOf(colorUrl, maskUrl);
+
+    // the mask must be decoded before the color is decoded
+    //   it is no longer needed once the combined texture is ready
+    std::shared_ptr<TextureMask> mask;
+    if (map->getResourceValidity(name) != Validity::Valid)
+    {
+        mask = map->getTextureMask(TextureMask::nameOf(maskUrl));
+        mask->updatePriority(priority);
+        switch (map->getResourceValidity(mask))
+        {
+        case Validity::Indeterminate:
+            return Validity::Indeterminate;
+        case Validity::Invalid:
+            return Validity::Invalid;
+        case Validity::Valid:
+            break;
+        }
+    }
+
+    std::shared_ptr<GpuMaskedTexture> t = map->getMaskedTexture(name);
+    if (mask)
+        t->setMask(mask);
+    t->tileTexture = true;
+    t->updatePriority(priority);
+    t->updateAvailability(bound->availability);
+    textureColor = t;
+    textureMask.reset();
+    maskFolded = true;
+    return map->getResourceValidity(t);
+}
+
+BoundResolved::Layer::Layer(const BoundParamInfo &b) : info(b),
+    textureColor(b.textureColor), textureMask(b.textureMask)
+{
+    if (b.textureColor)
+        nameColor = b.textureColor->name;
+    if (b.textureMask)
+        nameMask = b.textureMask->name;
+    info.textureColor.reset();
+    info.textureMask.reset();
+    info.boundMetaTile.reset();
+}
+
+Validity CameraImpl::resolveBoundLayers(TraverseNode *trav, uint32 subMeshIndex, const MeshPart &part, std::vector<BoundParamInfo> &boundList)
+{
+    if (trav->boundResolved.size() <= subMeshIndex)
+        trav->boundResolved.resize(subMeshIndex + 1);
+    std::unique_ptr<BoundResolved> &resolved = trav->boundResolved[subMeshIndex];
+
+    // the previous resolution skips the bound metatiles and url expansion
+    //   it is discarded if any of its textures has failed
+    if (resolved)
+    {
+        Validity validity = Validity::Valid;
+        const auto &restore = [&](const std::weak_ptr<GpuTexture> &weak,
+            const std::string &name, const BoundInfo *bound)
+        {
+            std::shared_ptr<GpuTexture> t = weak.lock();
+            if (!t)
+                t = map->getTexture(name);
+            t->tileTexture = true;
+            t->updatePriority(trav->priority);
+            if (bound)
+                t->updateAvailability(bound->availability);
+            switch (map->getResourceValidity(t))
+            {
+            case Validity::Invalid:
+                validity = Validity::Invalid;
+                break;
+            case Validity::Indeterminate:
+                if (validity == Validity::Valid)
+                    validity = Validity::Indeterminate;
+                break;
+            case Validity::Valid:
+                break;
+            }
+            return t;
+        };
+        boundList.clear();
+        boundList.reserve(resolved->layers.size());
+        for (const BoundResolved::Layer &l : resolved->layers)
+        {
+            boundList.push_back(l.info);
+            BoundParamInfo &b = boundList.back();
+            if (b.maskFolded)
+            {
+                // the mask would be needed again to restore the texture
+                std::shared_ptr<GpuTexture> t = l.textureColor.lock();
+                if (!t || map->getResourceValidity(t) != Validity::Valid)
+                {
+                    validity = Validity::Invalid;
+                    break;
+                }
+                t->updatePriority(trav->priority);
+                b.textureColor = t;
+                continue;
+            }
+            if (!l.nameColor.empty())
+                b.textureColor = restore(l.textureColor, l.nameColor, b.bound);
+            if (!l.nameMask.empty())
+                b.textureMask = restore(l.textureMask, l.nameMask, nullptr);
+        }
+        if (validity != Validity::Invalid)
+            return validity;
+        resolved.reset();
+    }
+
+    boundList = trav->layer->boundList(trav->surface, part.surfaceReference);
+    if (part.textureLayer)
+        boundList.push_back(BoundParamInfo(View::BoundLayerParams(map->mapconfig->boundLayers.get(part.textureLayer).id)));
+    const Validity validity = reorderBoundLayers(trav->id, trav->meta->localId, subMeshIndex, boundList, trav->priority);
+    if (validity == Validity::Valid)
+    {
+        resolved = std::make_unique<BoundResolved>();
+        resolved->layers.reserve(boundList.size());
+        for (const BoundParamInfo &b : boundList)
+            resolved->layers.emplace_back(b);
+    }
+    return validity;
+}
+
 Validity CameraImpl::reorderBoundLayers(TileId tileId, TileId localId, uint32 subMeshIndex, std::vector<BoundParamInfo> &boundList, double priority)
 {
     std::reverse(boundList.begin(), boundList.end());
@@ -199,7 +334,7 @@ Validity CameraImpl::reorderBoundLayers(TileId tileId, TileId localId, uint32 su
         case Validity::Indeterminate:
             return Validity::Indeterminate;
         case Validity::Valid:
-            transparent = !!it->textureMask || it->transparent;
+            transparent = it->masked() || it->transparent;
             it++;
         }
         if (!transparent)
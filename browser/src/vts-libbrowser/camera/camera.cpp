@@ -38,11 +38,27 @@
 #include "../geodata.hpp"
 
 #include <unordered_set>
+#include <future>
+#include <exception>
+#include <chrono>
 #include <optick.h>
 
 namespace vts
 {
 
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double millisSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(
+        Clock::now() - start).count();
+}
+
+} // namespace
+
 CurrentDraw::CurrentDraw(TraverseNode *trav, TraverseNode *orig) :
     trav(trav), orig(orig)
 {}
@@ -75,8 +91,16 @@ CameraImpl::CameraImpl(MapImpl *map, Camera *cam) :
 void CameraImpl::clear()
 {
     OPTICK_EVENT();
+    frameArena.reset();
     draws.clear();
     credits.clear();
+    renderedColliders.clear();
+    traversalGroup.clear();
+
+    // followers are cleared together with their leader
+    for (auto &it : traversalFollowers)
+        if (auto f = it.lock())
+            f->clear();
 
     // reset statistics
     {
@@ -87,9 +111,23 @@ void CameraImpl::clear()
         }
         statistics.metaNodesTraversedTotal = 0;
         statistics.nodesRenderedTotal = 0;
+        statistics.nodesOccludedTotal = 0;
+        statistics.nodesBeyondHorizonTotal = 0;
+        statistics.nodesSkippedByBudget = 0;
+        statistics.nodesMergedTotal = 0;
+        statistics.nodesBlendingSnapped = 0;
+        farFieldPending = 0;
         statistics.currentNodeMetaUpdates = 0;
         statistics.currentNodeDrawsUpdates = 0;
+        statistics.currentNodeDrawsWaiting = 0;
         statistics.currentGridNodes = 0;
+        statistics.currentPrefetchNodes = 0;
+        statistics.timeUpdate = 0;
+        statistics.timeTraversal = 0;
+        statistics.timeBlending = 0;
+        statistics.timeSorting = 0;
+        statistics.timePrefetch = 0;
+        statistics.timeLayers.clear();
     }
 
     // clear unused camera map layers
@@ -135,7 +173,7 @@ void CameraImpl::touchDraws(TraverseNode *trav)
         map->touchResource(it);
 }
 
-bool CameraImpl::visibilityTest(TraverseNode *trav)
+bool CameraImpl::frustumTest(TraverseNode *trav)
 {
     assert(trav->meta);
     // aabb test
@@ -145,22 +183,136 @@ bool CameraImpl::visibilityTest(TraverseNode *trav)
     if (trav->meta->obb)
     {
         const MetaNode::Obb &obb = *trav->meta->obb;
-        vec4 planes[6];
-        vts::frustumPlanes(viewProjCulling * obb.rotInv, planes);
-        if (!aabbTest(obb.points, planes))
+        if (!obbTest(obb.center, obb.halfAxes, cullingPlanes))
+            return false;
+    }
+    return true;
+}
+
+bool CameraImpl::visibilityTest(TraverseNode *trav)
+{
+    assert(trav->meta);
+    // the far nodes are traversed only to render the impostor
+    //   which covers all directions
+    const bool far = farFieldTest(trav);
+    if (far && (!farFieldRefresh || prefetching))
+        return false;
+    // the group traverses the union of the views
+    //   the node is culled only if it is culled in all of them
+    const auto &culledInAll = [&](const auto &test) {
+        if (!test(this))
             return false;
+        for (auto &f : traversalGroup)
+            if (!test(f.get()))
+                return false;
+        return true;
+    };
+    // frustum test
+    if (!far && culledInAll([&](CameraImpl *c) {
+            return !c->frustumTest(trav); }))
+        return false;
+    // horizon test
+    if (culledInAll([&](CameraImpl *c) { return c->horizonTest(trav); }))
+    {
+        statistics.nodesBeyondHorizonTotal++;
+        return false;
+    }
+    // occlusion test
+    if (!far && culledInAll([&](CameraImpl *c) {
+            return c->occlusionTest(trav); }))
+    {
+        statistics.nodesOccludedTotal++;
+        return false;
     }
     // all tests passed
     return true;
 }
 
+bool CameraImpl::horizonTest(TraverseNode *trav)
+{
+    assert(trav->meta);
+    if (!trav->meta->horizonScaled)
+        return false;
+    const vec3 c = cameraPosPhys.cwiseQuotient(map->mapconfig->horizonRadii);
+    const double horizonSq = dot(c, c) - 1;
+    if (horizonSq <= 0)
+        return false; // the camera is below the occluder
+    const vec3 t = vec3(*trav->meta->horizonScaled - c);
+    const double tc = -dot(t, c);
+    return tc > horizonSq && tc * tc / dot(t, t) > horizonSq;
+}
+
 bool CameraImpl::coarsenessTest(TraverseNode *trav)
 {
     assert(trav->meta);
-    return coarsenessValue(trav)
-        < (trav->layer->isGeodata()
+    const double target = trav->layer->isGeodata()
         ? options.targetPixelRatioGeodata
-        : options.targetPixelRatioSurfaces);
+        : options.targetPixelRatioSurfaces;
+    const double value = coarsenessValue(trav);
+    if (value >= target)
+    {
+        if (!mergeTest(trav))
+            return false;
+        if (!prefetching)
+            statistics.nodesMergedTotal++;
+        return true;
+    }
+    if (options.metaPrefetchRatio > 0
+        && value >= target * options.metaPrefetchRatio)
+        travPrefetchChildsMeta(trav);
+    return true;
+}
+
+bool CameraImpl::mergeTest(TraverseNode *trav)
+{
+    // a node small on screen is drawn instead of its children
+    //   its mesh and texture cover the same area in a single draw
+    //   and it stays cached with the rest of the tree
+    const double limit = options.mergeTilesScreenSize;
+    if (limit <= 0 || !trav->surface || trav->layer->isGeodata())
+        return false;
+    double size = screenSize(trav);
+    for (auto &f : traversalGroup)
+        size = std::max(size, f->screenSize(trav));
+    return size < limit;
+}
+
+bool CameraImpl::farFieldTest(const TraverseNode *trav)
+{
+    assert(trav->meta);
+    if (options.farFieldDistance <= 0 || !traversalGroup.empty()
+        || trav->layer->isGeodata())
+        return false;
+    // distance to the nearest point of the box
+    //   measured from where the impostor was rendered
+    //   so that the near draws fill exactly what the impostor leaves out
+    const vec3 *aabb = trav->meta->aabbPhys;
+    vec3 d;
+    for (uint32 i = 0; i < 3; i++)
+        d[i] = std::max(std::max(aabb[0][i] - farFieldEye[i],
+            farFieldEye[i] - aabb[1][i]), 0.0);
+    return length(d) > farFieldDistance;
+}
+
+void CameraImpl::updateFarField()
+{
+    const double dist = options.farFieldDistance;
+    if (dist <= 0 || !traversalGroup.empty())
+    {
+        farFieldEye = nan3();
+        farFieldRefresh = farFieldSettling = false;
+        return;
+    }
+    // the impostor is rendered again in the following frames
+    //   until all the far nodes are resolved
+    farFieldRefresh = farFieldSettling || dist != farFieldDistance
+        || !(length(vec3(cameraPosPhys - farFieldEye))
+            <= dist * options.farFieldRefreshThreshold);
+    if (farFieldRefresh)
+    {
+        farFieldEye = cameraPosPhys;
+        farFieldDistance = dist;
+    }
 }
 
 namespace
@@ -183,6 +335,49 @@ double distanceToDisk(const vec3 &diskNormal,
 
 } // namespace
 
+bool CameraImpl::coarsenessViewChanged(const vec3 &leaderPos, double tol)
+{
+    // followers are validated by their position relative to the leader
+    const vec3 offset = cameraPosPhys - leaderPos;
+    return coarsenessProj != apiProj
+        || coarsenessHeight != windowHeight * resolutionScale
+        || coarsenessDisks != map->options.debugCoarsenessDisks
+        || length(vec3(forwardUnitVector - coarsenessForward)) >= tol
+        || length(vec3(perpendicularUnitVector - coarsenessPerpendicular))
+            >= tol
+        || length(vec3(offset - coarsenessOffset))
+            > tol * length(coarsenessOffset);
+}
+
+void CameraImpl::updateCoarsenessEpoch()
+{
+    // any change of the projection invalidates all cached coarseness
+    //   whereas the camera position is validated for each node
+    const double tol = options.coarsenessCacheTolerance;
+    if (coarsenessEpoch != 0
+        && tol > 0
+        && !coarsenessViewChanged(cameraPosPhys, tol)
+        && std::none_of(traversalGroup.begin(), traversalGroup.end(),
+            [&](const std::shared_ptr<CameraImpl> &f) {
+                return f->coarsenessEpoch != coarsenessEpoch
+                    || f->coarsenessViewChanged(cameraPosPhys, tol);
+        }))
+        return;
+    coarsenessEpoch = ++map->coarsenessEpochs;
+    const auto &store = [&](CameraImpl *c) {
+        c->coarsenessEpoch = coarsenessEpoch;
+        c->coarsenessProj = c->apiProj;
+        c->coarsenessHeight = c->windowHeight * c->resolutionScale;
+        c->coarsenessDisks = map->options.debugCoarsenessDisks;
+        c->coarsenessForward = c->forwardUnitVector;
+        c->coarsenessPerpendicular = c->perpendicularUnitVector;
+        c->coarsenessOffset = c->cameraPosPhys - cameraPosPhys;
+    };
+    store(this);
+    for (auto &f : traversalGroup)
+        store(f.get());
+}
+
 double CameraImpl::coarsenessValue(TraverseNode *trav)
 {
     assert(trav->meta);
@@ -193,6 +388,47 @@ double CameraImpl::coarsenessValue(TraverseNode *trav)
     if (meta->texelSize == inf1())
         return meta->texelSize;
 
+    const double tol = options.coarsenessCacheTolerance;
+    if (tol <= 0 || prefetching)
+        return coarsenessCompute(trav);
+
+    // the value is inversely proportional to the distance
+    //   moving the camera by tol * distance changes it by about tol
+    if (trav->coarsenessEpoch == coarsenessEpoch
+        && length(vec3(cameraPosPhys - trav->coarsenessEye))
+            <= tol * trav->coarsenessDistance)
+        return trav->coarsenessCache;
+
+    // the nearest view of the group limits the tolerance
+    const auto &distance = [&](const vec3 &pos) {
+        const vec3 nearest = max(meta->aabbPhys[0],
+            min(meta->aabbPhys[1], pos));
+        return length(vec3(nearest - pos));
+    };
+    double dist = distance(cameraPosPhys);
+    for (auto &f : traversalGroup)
+        dist = std::min(dist, distance(f->cameraPosPhys));
+    const double v = coarsenessCompute(trav);
+    trav->coarsenessEpoch = coarsenessEpoch;
+    trav->coarsenessEye = cameraPosPhys;
+    trav->coarsenessDistance = dist;
+    trav->coarsenessCache = v;
+    return v;
+}
+
+double CameraImpl::coarsenessCompute(TraverseNode *trav)
+{
+    // the group refines to the finest detail required by any view
+    double result = coarsenessComputeView(trav);
+    for (auto &f : traversalGroup)
+        result = std::max(result, f->coarsenessComputeView(trav));
+    return result;
+}
+
+double CameraImpl::coarsenessComputeView(TraverseNode *trav)
+{
+    const auto &meta = trav->meta;
+
     if (map->options.debugCoarsenessDisks
         && !std::isnan(meta->diskHalfAngle))
     {
@@ -219,7 +455,7 @@ double CameraImpl::coarsenessValue(TraverseNode *trav)
             double len = std::abs(c2[1] - c1[1]);
             result = std::max(result, len);
         }
-        result *= windowHeight * 0.5;
+        result *= windowHeight * resolutionScale * 0.5;
         return result;
     }
 }
@@ -267,11 +503,11 @@ void CameraImpl::renderText(TraverseNode *trav, float x, float y,
 
     RenderInfographicsTask task;
     task.mesh = map->getMesh("internal://data/meshes/rect.obj");
-    task.mesh->priority = inf1();
+    task.mesh->updatePriority(inf1());
 
     task.textureColor =
         map->getTexture("internal://data/textures/debugFont2.png");
-    task.textureColor->priority = inf1();
+    task.textureColor->updatePriority(inf1());
 
     task.model = translationMatrix(*trav->meta->surrogatePhys);
     task.color = color;
@@ -351,7 +587,7 @@ void CameraImpl::renderNodeBox(TraverseNode *trav, const vec4f &color)
 
     RenderInfographicsTask task;
     task.mesh = map->getMesh("internal://data/meshes/aabb.obj");
-    task.mesh->priority = inf1();
+    task.mesh->updatePriority(inf1());
     if (!task.ready())
         return;
 
@@ -374,6 +610,19 @@ void CameraImpl::renderNodeBox(TraverseNode *trav, const vec4f &color)
     draws.infographics.emplace_back(convert(task));
 }
 
+uint32 CameraImpl::travFeatures() const
+{
+    uint32 f = 0;
+    if (options.debugRenderSurrogates || options.debugRenderMeshBoxes
+        || options.debugRenderTileBoxes || options.debugRenderSubtileBoxes
+        || options.debugRenderTileDiagnostics)
+        f |= TravDebug;
+    if (options.lodBlending)
+        f |= TravBlending;
+    return f;
+}
+
+template<uint32 F>
 void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
 {
     assert(trav && orig);
@@ -393,14 +642,18 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
         trav->id.lod, CameraStatistics::MaxLods - 1)]++;
 
     // credits
-    for (auto &it : trav->credits)
-        map->credits->hit(trav->layer->creditScope, it,
-            trav->meta->localId.lod);
+    if (!trav->credits.empty())
+    {
+        auto lock = map->traversalLock();
+        for (auto &it : trav->credits)
+            map->credits->hit(trav->layer->creditScope, it,
+                trav->meta->localId.lod);
+    }
 
     bool isSubNode = trav != orig;
 
     // surfaces
-    if (options.lodBlending)
+    if (F & TravBlending)
         currentDraws.emplace_back(trav, orig);
     else
         renderNodeDraws(trav, orig, nan1());
@@ -412,14 +665,27 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
             draws.geodata.emplace_back(it);
         for (const RenderColliderTask &r : trav->colliders)
             draws.colliders.emplace_back(convert(r));
+        if (map->options.collisionMeshes)
+        {
+            renderedColliders.insert(renderedColliders.end(),
+                trav->colliders.begin(), trav->colliders.end());
+        }
     }
 
+    if (F & TravDebug)
+        renderNodeDebug(trav, orig);
+}
+
+void CameraImpl::renderNodeDebug(TraverseNode *trav, TraverseNode *orig)
+{
+    bool isSubNode = trav != orig;
+
     // surrogate
     if (options.debugRenderSurrogates && trav->meta->surrogatePhys)
     {
         RenderInfographicsTask task;
         task.mesh = map->getMesh("internal://data/meshes/sphere.obj");
-        task.mesh->priority = inf1();
+        task.mesh->updatePriority(inf1());
         if (task.ready())
         {
             task.model = translationMatrix(*trav->meta->surrogatePhys)
@@ -434,7 +700,7 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
     {
         RenderInfographicsTask task;
         task.mesh = map->getMesh("internal://data/meshes/aabb.obj");
-        task.mesh->priority = inf1();
+        task.mesh->updatePriority(inf1());
         if (task.ready())
         {
             for (RenderSurfaceTask &r : trav->opaque)
@@ -615,9 +881,10 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
     }
 }
 
+template<uint32 F>
 void CameraImpl::renderNode(TraverseNode *trav)
 {
-    renderNode(trav, trav);
+    renderNode<F>(trav, trav);
 }
 
 namespace
@@ -639,17 +906,33 @@ bool findNodeCoarser(TraverseNode *&trav, TraverseNode *orig)
 
 } // namespace
 
+template<uint32 F>
 void CameraImpl::renderNodeCoarser(TraverseNode *trav, TraverseNode *orig)
 {
     if (findNodeCoarser(trav, orig))
-        renderNode(trav, orig);
+        renderNode<F>(trav, orig);
 }
 
+template<uint32 F>
 void CameraImpl::renderNodeCoarser(TraverseNode *trav)
 {
-    renderNodeCoarser(trav, trav);
+    renderNodeCoarser<F>(trav, trav);
 }
 
+// the kernels in traversal.cpp use all combinations of the features
+#define VTS_RENDER_NODE_INSTANTIATE(F) \
+    template void CameraImpl::renderNode<F>(TraverseNode *, TraverseNode *); \
+    template void CameraImpl::renderNode<F>(TraverseNode *); \
+    template void CameraImpl::renderNodeCoarser<F>(TraverseNode *, TraverseNode *); \
+    template void CameraImpl::renderNodeCoarser<F>(TraverseNode *);
+VTS_RENDER_NODE_INSTANTIATE(0)
+VTS_RENDER_NODE_INSTANTIATE(1)
+VTS_RENDER_NODE_INSTANTIATE(2)
+VTS_RENDER_NODE_INSTANTIATE(3)
+#undef VTS_RENDER_NODE_INSTANTIATE
+static_assert(CameraImpl::TravFeaturesCombinations == 4,
+    "instantiate the renderNode for all feature combinations");
+
 namespace
 {
 
@@ -679,6 +962,9 @@ void CameraImpl::renderNodeDraws(TraverseNode *trav,
     orig->lastRenderTime = map->renderTickIndex;
     if (trav->rendersEmpty())
         return;
+    const bool far = farFieldTest(orig);
+    if (far && !farFieldRefresh)
+        return; // the impostor is kept from previous frames
 
     vec4f uvClip;
     if (trav == orig)
@@ -697,11 +983,22 @@ void CameraImpl::renderNodeDraws(TraverseNode *trav,
         }
     }
 
+    if (far)
+    {
+        // the impostor is static, without any blending
+        for (const RenderSurfaceTask &r : trav->opaque)
+            draws.farFieldOpaque.emplace_back(convert(r, uvClip, nan1()));
+        for (const RenderSurfaceTask &r : trav->transparent)
+            draws.farFieldTransparent.emplace_back(convert(r, uvClip,
+                nan1()));
+        return;
+    }
+
     if (trav != orig && std::isnan(blendingCoverage))
     {
         // some neighboring subtiles may be merged together
         //   this will reduce gpu overhead on rasterization
-        opaqueSubtiles[trav].subtiles.emplace_back(orig, uvClip);
+        opaqueSubtiles.add(trav, orig, uvClip);
     }
     else if (options.lodBlendingTransparent
         && !std::isnan(blendingCoverage))
@@ -790,8 +1087,8 @@ void CameraImpl::resolveBlending(TraverseNode *root,
     // apply current draws
     {
         double halfDuration = options.lodBlendingDuration / 2;
-        std::unordered_set<OldDraw, OldHash> currentSet(currentDraws.begin(),
-            currentDraws.end());
+        FrameSet<OldDraw, OldHash> currentSet(currentDraws.begin(),
+            currentDraws.end(), currentDraws.size(), frameArena);
         for (auto &b : layer.blendDraws)
         {
             auto it = currentSet.find(b);
@@ -814,7 +1111,7 @@ void CameraImpl::resolveBlending(TraverseNode *root,
     {
         double halfDuration = options.lodBlendingDuration / 2;
         double duration = options.lodBlendingDuration;
-        std::unordered_set<TileId> opaqueTiles;
+        FrameSet<TileId> opaqueTiles(layer.blendDraws.size(), frameArena);
         for (auto &b : layer.blendDraws)
             if (b.age >= halfDuration && b.age <= duration)
                 opaqueTiles.insert(b.orig);
@@ -838,31 +1135,266 @@ void CameraImpl::resolveBlending(TraverseNode *root,
         }
     }
 
-    // render blend draws
+    struct Blend
+    {
+        OldDraw *draw;
+        TraverseNode *trav;
+        TraverseNode *orig;
+        double centrality;
+    };
+    FrameVector<Blend> blends(frameArena);
+    blends.reserve(layer.blendDraws.size());
+    uint32 blending = 0;
     for (auto &b : layer.blendDraws)
     {
         TraverseNode *trav = findTravById(root, b.trav);
         TraverseNode *orig = findTravById(trav, b.orig);
         if (!orig || !trav->determined)
             continue;
-        renderNodeDraws(trav, orig,
-            timeToBlendingCoverage(b.age, options.lodBlendingDuration));
+        double centrality = inf1(); // fully opaque draws are not limited
+        if (!std::isnan(timeToBlendingCoverage(b.age,
+            options.lodBlendingDuration)))
+        {
+            blending++;
+            const vec3 c = (orig->meta->aabbPhys[0]
+                + orig->meta->aabbPhys[1]) * 0.5;
+            const vec3 d = c - cameraPosPhys;
+            centrality = std::isfinite(c[0]) && length(d) > 0
+                ? dot(normalize(d), forwardUnitVector) : 1;
+        }
+        blends.push_back({ &b, trav, orig, centrality });
+    }
+
+    // snap the draws over the budget, farthest from the screen center first
+    const uint32 budget = options.lodBlendingBudget;
+    if (budget > 0 && blending > budget)
+    {
+        std::sort(blends.begin(), blends.end(),
+            [](const Blend &a, const Blend &b) {
+            return a.centrality > b.centrality;
+        });
+        const double halfDuration = options.lodBlendingDuration / 2;
+        uint32 kept = 0;
+        for (Blend &it : blends)
+        {
+            if (std::isinf(it.centrality) || kept++ < budget)
+                continue;
+            if (it.draw->age < halfDuration)
+                it.draw->age = halfDuration; // appear now
+            else
+                it.draw->age = inf1(); // disappear now
+            statistics.nodesBlendingSnapped++;
+        }
+    }
+
+    // render blend draws
+    const double duration = options.lodBlendingDuration * 3 / 2;
+    for (const Blend &it : blends)
+    {
+        if (it.draw->age > duration)
+            continue;
+        renderNodeDraws(it.trav, it.orig, timeToBlendingCoverage(
+            it.draw->age, options.lodBlendingDuration));
+    }
+    {
+        auto &old = layer.blendDraws;
+        old.erase(std::remove_if(old.begin(), old.end(),
+            [&](const OldDraw &b) {
+                return b.age > duration;
+        }), old.end());
     }
 }
 
-void CameraImpl::renderUpdate()
+void CameraImpl::traverseLayer(MapLayer *layer, CameraMapLayer &cameraLayer)
 {
-    OPTICK_EVENT();
-    clear();
+    OPTICK_EVENT("layer");
+    if (!layer->freeLayerName.empty())
+    {
+        OPTICK_TAG("freeLayerName", layer->freeLayerName.c_str());
+    }
+    {
+        OPTICK_EVENT("traversal");
+        traverseRender(layer->traverseRoot.get(), cameraLayer);
+    }
+    {
+        const auto start = Clock::now();
+        resolveBlending(layer->traverseRoot.get(), cameraLayer);
+        statistics.timeBlending += millisSince(start);
+    }
+    {
+        OPTICK_EVENT("subtileMerging");
+        opaqueSubtiles.resolve(this);
+    }
+    gridPreloadProcess(layer->traverseRoot.get());
+}
 
-    if (!map->mapconfigReady)
+void CameraImpl::traverseLayers()
+{
+    FrameVector<std::pair<MapLayer *, CameraMapLayer *>> work(frameArena);
+    for (auto &it : map->layers)
+    {
+        if (!it->surfaceStack.surfaces.empty())
+            work.emplace_back(it.get(), &layers[it]);
+    }
+
+    const uint32 threads = std::min<uint32>(map->options.traversalThreads,
+        std::max<uint32>(work.size(), 1) - 1);
+    if (threads == 0)
+    {
+        for (auto &it : work)
+        {
+            const auto start = Clock::now();
+            traverseLayer(it.first, *it.second);
+            statistics.timeLayers.push_back(millisSince(start));
+        }
         return;
+    }
 
-    updateNavigation(navigation, map->lastElapsedFrameTime);
+    // each layer is traversed by its own helper camera
+    //   and the draws are merged in the order of the layers
+    //   as if the traversal was sequential
+    while (layerCameras.size() < work.size())
+        layerCameras.push_back(std::make_unique<CameraImpl>(map, camera));
+    for (uint32 i = 0, e = work.size(); i < e; i++)
+        layerCameras[i]->copyFrameState(*this);
 
-    if (windowWidth == 0 || windowHeight == 0)
-        return;
+    std::vector<double> times(work.size());
+    const auto &process = [&](uint32 thread)
+    {
+        for (uint32 i = thread, e = work.size(); i < e; i += threads + 1)
+        {
+            const auto start = Clock::now();
+            layerCameras[i]->traverseLayer(work[i].first, *work[i].second);
+            times[i] = millisSince(start);
+        }
+    };
 
+    std::exception_ptr error;
+    map->resources->map->traversalParallel = true;
+    {
+        std::vector<std::future<void>> futures;
+        futures.reserve(threads);
+        try
+        {
+            for (uint32 t = 1; t <= threads; t++)
+                futures.push_back(std::async(std::launch::async, process, t));
+            process(0);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        for (auto &f : futures)
+        {
+            try
+            {
+                f.get();
+            }
+            catch (...)
+            {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    }
+    map->resources->map->traversalParallel = false;
+    if (error)
+        std::rethrow_exception(error);
+
+    for (uint32 i = 0, e = work.size(); i < e; i++)
+        mergeLayerCamera(*layerCameras[i]);
+    statistics.timeLayers = std::move(times);
+}
+
+void CameraImpl::copyFrameState(const CameraImpl &other)
+{
+    clear();
+    options = other.options;
+    draws.camera = other.draws.camera;
+    viewProjActual = other.viewProjActual;
+    viewProjRender = other.viewProjRender;
+    viewProjCulling = other.viewProjCulling;
+    viewActual = other.viewActual;
+    apiProj = other.apiProj;
+    for (uint32 i = 0; i < 6; i++)
+        cullingPlanes[i] = other.cullingPlanes[i];
+    perpendicularUnitVector = other.perpendicularUnitVector;
+    forwardUnitVector = other.forwardUnitVector;
+    cameraPosPhys = other.cameraPosPhys;
+    focusPosPhys = other.focusPosPhys;
+    eye = other.eye;
+    target = other.target;
+    up = other.up;
+    diskNominalDistance = other.diskNominalDistance;
+    windowWidth = other.windowWidth;
+    windowHeight = other.windowHeight;
+    resolutionScale = other.resolutionScale;
+    occlusionDepth = other.occlusionDepth;
+    occlusionTick = other.occlusionTick;
+    traversalGroup = other.traversalGroup;
+    traversalBudgetHit = other.traversalBudgetHit;
+    coarsenessEpoch = other.coarsenessEpoch;
+    farFieldRefresh = other.farFieldRefresh;
+}
+
+void CameraImpl::mergeLayerCamera(CameraImpl &other)
+{
+    const auto &append = [](auto &a, auto &b) {
+        a.insert(a.end(), std::make_move_iterator(b.begin()),
+            std::make_move_iterator(b.end()));
+        b.clear();
+    };
+    append(draws.opaque, other.draws.opaque);
+    append(draws.transparent, other.draws.transparent);
+    append(draws.farFieldOpaque, other.draws.farFieldOpaque);
+    append(draws.farFieldTransparent, other.draws.farFieldTransparent);
+    append(draws.geodata, other.draws.geodata);
+    append(draws.infographics, other.draws.infographics);
+    append(draws.colliders, other.draws.colliders);
+    append(renderedColliders, other.renderedColliders);
+    other.traversalGroup.clear();
+
+    const CameraStatistics &s = other.statistics;
+    for (uint32 i = 0; i < CameraStatistics::MaxLods; i++)
+    {
+        statistics.metaNodesTraversedPerLod[i]
+            += s.metaNodesTraversedPerLod[i];
+        statistics.nodesRenderedPerLod[i] += s.nodesRenderedPerLod[i];
+    }
+    statistics.metaNodesTraversedTotal += s.metaNodesTraversedTotal;
+    statistics.nodesRenderedTotal += s.nodesRenderedTotal;
+    statistics.nodesOccludedTotal += s.nodesOccludedTotal;
+    statistics.nodesBeyondHorizonTotal += s.nodesBeyondHorizonTotal;
+    statistics.nodesSkippedByBudget += s.nodesSkippedByBudget;
+    statistics.nodesMergedTotal += s.nodesMergedTotal;
+    statistics.nodesBlendingSnapped += s.nodesBlendingSnapped;
+    farFieldPending += other.farFieldPending;
+    statistics.currentNodeMetaUpdates += s.currentNodeMetaUpdates;
+    statistics.currentNodeDrawsUpdates += s.currentNodeDrawsUpdates;
+    statistics.currentNodeDrawsWaiting += s.currentNodeDrawsWaiting;
+    statistics.currentGridNodes += s.currentGridNodes;
+    statistics.timeBlending += s.timeBlending;
+}
+
+void CameraImpl::updateTraversalGroup()
+{
+    traversalFollowers.erase(std::remove_if(traversalFollowers.begin(),
+        traversalFollowers.end(), [](const std::weak_ptr<CameraImpl> &f) {
+            return f.expired();
+    }), traversalFollowers.end());
+    for (auto &it : traversalFollowers)
+    {
+        std::shared_ptr<CameraImpl> f = it.lock();
+        updateNavigation(f->navigation, map->lastElapsedFrameTime);
+        if (f->windowWidth == 0 || f->windowHeight == 0)
+            continue;
+        f->updateRenderVariables();
+        traversalGroup.push_back(f);
+    }
+}
+
+void CameraImpl::updateRenderVariables()
+{
     // render variables
     viewActual = lookAt(eye, target, up);
     viewProjActual = apiProj * viewActual;
@@ -878,14 +1410,15 @@ void CameraImpl::renderUpdate()
         vts::frustumPlanes(viewProjCulling, cullingPlanes);
         cameraPosPhys = eye;
         focusPosPhys = target;
-        diskNominalDistance =  windowHeight * apiProj(1, 1) * 0.5;
+        diskNominalDistance =  windowHeight * resolutionScale
+            * apiProj(1, 1) * 0.5;
     }
     else
     {
         // render original camera
         RenderInfographicsTask task;
         task.mesh = map->getMesh("internal://data/meshes/line.obj");
-        task.mesh->priority = inf1();
+        task.mesh->updatePriority(inf1());
         task.color = vec4f(0, 1, 0, 1);
         if (task.ready())
         {
@@ -933,34 +1466,91 @@ void CameraImpl::renderUpdate()
                 c.altitudeOverSurface = nan1();
         }
     }
+}
 
-    // traverse and generate draws
-    for (auto &it : map->layers)
+void CameraImpl::renderUpdate()
+{
     {
-        if (it->surfaceStack.surfaces.empty())
-            continue;
-        OPTICK_EVENT("layer");
-        if (!it->freeLayerName.empty())
-        {
-            OPTICK_TAG("freeLayerName", it->freeLayerName.c_str());
-        }
-        {
-            OPTICK_EVENT("traversal");
-            traverseRender(it->traverseRoot.get());
-        }
-        resolveBlending(it->traverseRoot.get(), layers[it]);
+        std::lock_guard<std::mutex> lock(feedbackMutex);
+        resolutionScale = feedbackResolutionScale;
+        if (feedbackOcclusionDepth)
         {
-            OPTICK_EVENT("subtileMerging");
-            for (auto &os : opaqueSubtiles)
-                os.second.resolve(os.first, this);
-            opaqueSubtiles.clear();
+            occlusionDepth = std::move(feedbackOcclusionDepth);
+            occlusionTick = map->renderTickIndex;
         }
-        gridPreloadProcess(it->traverseRoot.get());
     }
-    sortOpaqueFrontToBack();
+
+    // the draws of a follower are generated by its leader
+    if (!traversalLeader.expired())
+        return;
+
+    OPTICK_EVENT();
+    const auto start = Clock::now();
+    clear();
+
+    // the retained draws are removed while nothing is rendered
+    if (!map->mapconfigReady)
+    {
+        publishDraws();
+        return;
+    }
+
+    updateNavigation(navigation, map->lastElapsedFrameTime);
+
+    if (windowWidth == 0 || windowHeight == 0)
+    {
+        publishDraws();
+        return;
+    }
+
+    updateRenderVariables();
+    updateTraversalGroup();
+    updateFarField();
+
+    // traverse and generate draws
+    updateCoarsenessEpoch();
+    if (options.priorityModel == PriorityModel::ScreenSpaceError)
+        updatePriorityBytes();
+    {
+        const auto t = Clock::now();
+        traverseLayers();
+        statistics.timeTraversal = millisSince(t);
+    }
+    if (map->statistics.timeToFirstDraw == 0
+        && statistics.nodesRenderedTotal > 0)
+    {
+        map->statistics.timeToFirstDraw = map->millisSinceMapconfigPath();
+        LOG(info3) << "First draws (after "
+            << map->statistics.timeToFirstDraw << " ms).";
+    }
+    farFieldSettling = farFieldRefresh && farFieldPending > 0;
+    draws.farFieldRefresh = farFieldRefresh;
+    traversalBudgetHit = statistics.nodesSkippedByBudget > 0;
+    if (traversalBudgetHit)
+        statistics.framesOverBudget++;
+    {
+        const auto t = Clock::now();
+        sortOpaqueFrontToBack();
+        statistics.timeSorting = millisSince(t);
+    }
+    publishDraws();
+    traversalGroup.clear(); // the prefetch is for the leader only
+
+    // request resources for the predicted view
+    if (!options.debugDetachedCamera)
+    {
+        const auto t = Clock::now();
+        prefetchUpdate();
+        statistics.timePrefetch = millisSince(t);
+    }
 
     // update camera credits
-    map->credits->tick(credits);
+    map->credits->tick(credits, creditsRanking);
+    for (auto &it : traversalFollowers)
+        if (auto f = it.lock())
+            map->credits->publish(f->credits, f->creditsRanking);
+
+    statistics.timeUpdate = millisSince(start);
 }
 
 namespace
@@ -1008,16 +1598,79 @@ void CameraImpl::suggestedNearFar(double &near_, double &far_)
     near_ = std::max(options.minSuggestedNearClipPlaneDistance, std::min(options.maxSuggestedNearClipPlaneDistance, near_));
 }
 
+namespace
+{
+
+uint32 stateBits(const void *ptr, uint32 bits)
+{
+    uint64 h = (uint64)(std::uintptr_t)ptr;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return (uint32)(h >> (64 - bits));
+}
+
+// stable lsd radix sort by 8 bits
+//   passes where all keys share the same byte are skipped
+void radixSort(std::vector<std::pair<uint64, uint32>> &keys,
+    std::vector<std::pair<uint64, uint32>> &tmp)
+{
+    tmp.resize(keys.size());
+    for (uint32 pass = 0; pass < 8; pass++)
+    {
+        const uint32 shift = pass * 8;
+        uint32 counts[256] = {};
+        for (const auto &k : keys)
+            counts[(k.first >> shift) & 0xff]++;
+        if (counts[(keys[0].first >> shift) & 0xff] == keys.size())
+            continue;
+        uint32 sum = 0;
+        for (uint32 &c : counts)
+        {
+            uint32 t = c;
+            c = sum;
+            sum += t;
+        }
+        for (const auto &k : keys)
+            tmp[counts[(k.first >> shift) & 0xff]++] = k;
+        keys.swap(tmp);
+    }
+}
+
+} // namespace
+
 void CameraImpl::sortOpaqueFrontToBack()
 {
     OPTICK_EVENT();
-    vec3 e = rawToVec3(draws.camera.eye);
-    std::sort(draws.opaque.begin(), draws.opaque.end(), [e](
-        const DrawSurfaceTask &a, const DrawSurfaceTask &b) {
-        vec3 va = rawToVec3(a.center).cast<double>() - e;
-        vec3 vb = rawToVec3(b.center).cast<double>() - e;
-        return dot(va, va) < dot(vb, vb);
-    });
+    if (draws.opaque.size() < 2)
+        return;
+
+    // 32 bits of distance, 20 bits of color texture and 12 bits of mesh
+    //   the distance is squared float, whose bits sort as unsigned integers
+    const vec3f e = rawToVec3(draws.camera.eye).cast<float>();
+    sortKeys.clear();
+    sortKeys.reserve(draws.opaque.size());
+    for (uint32 i = 0, n = draws.opaque.size(); i < n; i++)
+    {
+        const DrawSurfaceTask &t = draws.opaque[i];
+        const vec3f v = rawToVec3(t.center) - e;
+        float d = dot(v, v);
+        uint32 depth;
+        memcpy(&depth, &d, sizeof(depth));
+        const uint64 state = (stateBits(t.texColor.get(), 20) << 12)
+            | stateBits(t.mesh.get(), 12);
+        const uint64 key = options.sortOpaqueByState
+            ? (state << 32) | depth : ((uint64)depth << 32) | state;
+        sortKeys.emplace_back(key, i);
+    }
+    radixSort(sortKeys, sortKeysTmp);
+
+    sortDraws.clear();
+    sortDraws.reserve(draws.opaque.size());
+    for (const auto &k : sortKeys)
+        sortDraws.push_back(std::move(draws.opaque[k.second]));
+    draws.opaque.swap(sortDraws);
+    sortDraws.clear();
 }
 
 } // namespace vts
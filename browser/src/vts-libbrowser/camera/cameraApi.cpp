@@ -30,6 +30,8 @@
 #include "../camera.hpp"
 #include "../map.hpp"
 
+#include <dbglog/dbglog.hpp>
+
 namespace vts
 {
 
@@ -52,6 +54,12 @@ void Camera::setViewportSize(uint32 width, uint32 height)
     impl->windowHeight = height;
 }
 
+void Camera::setResolutionScale(double scale)
+{
+    std::lock_guard<std::mutex> lock(impl->feedbackMutex);
+    impl->feedbackResolutionScale = scale;
+}
+
 void Camera::setView(const double eye[3], const double target[3],
     const double up[3])
 {
@@ -91,6 +99,45 @@ void Camera::setProj(const double proj[16])
     impl->apiProj = rawToMat4(proj);
 }
 
+void Camera::setOcclusionDepth(const float *depth,
+    uint32 width, uint32 height, const double viewProj[16])
+{
+    auto d = std::make_shared<const OcclusionDepth>(
+        depth, width, height, rawToMat4(viewProj));
+    std::lock_guard<std::mutex> lock(impl->feedbackMutex);
+    impl->feedbackOcclusionDepth = std::move(d);
+}
+
+void Camera::shareTraversal(const std::shared_ptr<Camera> &leader)
+{
+    if (auto l = impl->traversalLeader.lock())
+    {
+        auto &fs = l->traversalFollowers;
+        fs.erase(std::remove_if(fs.begin(), fs.end(),
+            [&](const std::weak_ptr<CameraImpl> &f) {
+                return f.lock() == impl;
+        }), fs.end());
+        l->coarsenessEpoch = 0;
+    }
+    impl->traversalLeader.reset();
+    if (!leader)
+        return;
+    if (leader.get() == this || leader->impl->map != impl->map)
+    {
+        LOGTHROW(err4, std::logic_error)
+            << "The leader must be another camera of the same map.";
+    }
+    if (!leader->impl->traversalLeader.expired()
+        || !impl->traversalFollowers.empty())
+    {
+        LOGTHROW(err4, std::logic_error)
+            << "Traversal groups cannot be nested.";
+    }
+    impl->traversalLeader = leader->impl;
+    leader->impl->traversalFollowers.push_back(impl);
+    leader->impl->coarsenessEpoch = 0;
+}
+
 void Camera::getViewportSize(uint32 &width, uint32 &height)
 {
     width = impl->windowWidth;
@@ -127,6 +174,40 @@ void Camera::renderUpdate()
     impl->renderUpdate();
 }
 
+bool Camera::needsRedraw() const
+{
+    return impl->redrawNeeded();
+}
+
+bool Camera::intersectRay(const double origin[3], const double direction[3],
+    double &distance)
+{
+    double t = inf1();
+    if (!impl->intersectRay(rawToVec3(origin), rawToVec3(direction), t))
+        return false;
+    distance = t;
+    return true;
+}
+
+bool Camera::intersectRay(const std::array<double, 3> &origin,
+    const std::array<double, 3> &direction, double &distance)
+{
+    return intersectRay(origin.data(), direction.data(), distance);
+}
+
+bool Camera::lineOfSight(const double a[3], const double b[3])
+{
+    const vec3 o = rawToVec3(a);
+    double t = 1;
+    return !impl->intersectRay(o, vec3(rawToVec3(b) - o), t);
+}
+
+bool Camera::lineOfSight(const std::array<double, 3> &a,
+    const std::array<double, 3> &b)
+{
+    return lineOfSight(a.data(), b.data());
+}
+
 CameraStatistics &Camera::statistics()
 {
     return impl->statistics;
@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "../camera.hpp"
+#include "../gpuResource.hpp"
+#include "../utilities/collisionMesh.hpp"
+
+#include <optick.h>
+
+namespace vts
+{
+
+namespace
+{
+
+bool rayBox(const vec3 aabb[2], const vec3 &origin,
+    const vec3 &direction, double t)
+{
+    double t0 = 0, t1 = t;
+    for (uint32 i = 0; i < 3; i++)
+    {
+        double a = (aabb[0][i] - origin[i]) / direction[i];
+        double b = (aabb[1][i] - origin[i]) / direction[i];
+        if (a > b)
+            std::swap(a, b);
+        if (a > t0)
+            t0 = a;
+        if (b < t1)
+            t1 = b;
+        if (t0 > t1)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool CameraImpl::intersectRay(const vec3 &origin, const vec3 &direction,
+    double &t)
+{
+    OPTICK_EVENT();
+    bool hit = false;
+    for (const RenderColliderTask &r : renderedColliders)
+    {
+        const CollisionMesh *c = r.mesh->collision.get();
+        if (!c)
+            continue;
+
+        // bounding box of the mesh in physical srs
+        vec3 box[2] = { vec3(inf1(), inf1(), inf1()), vec3() };
+        box[1] = -box[0];
+        for (uint32 i = 0; i < 8; i++)
+        {
+            vec3 p(c->aabb[i % 2][0], c->aabb[(i / 2) % 2][1],
+                c->aabb[i / 4][2]);
+            p = vec4to3(vec4(r.model * vec3to4(p, 1)));
+            box[0] = min(box[0], p);
+            box[1] = max(box[1], p);
+        }
+        if (!rayBox(box, origin, direction, t))
+            continue;
+
+        // the ray parameter is preserved by the affine transformation
+        const mat4 inv = r.model.inverse();
+        const vec3f o = vec4to3(vec4(inv * vec3to4(origin, 1))).cast<float>();
+        const vec3f d = vec4to3(vec4(inv * vec3to4(direction, 0)))
+            .cast<float>();
+        float tf = (float)std::min<double>(t,
+            std::numeric_limits<float>::max());
+        if (c->intersect(o, d, tf))
+        {
+            t = tf;
+            hit = true;
+        }
+    }
+    return hit;
+}
+
+} // namespace vts
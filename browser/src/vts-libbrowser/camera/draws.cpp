@@ -25,8 +25,12 @@
  */
 
 #include "../camera.hpp"
+#include "../map.hpp"
 #include "../renderTasks.hpp"
 #include "../gpuResource.hpp"
+#include "../navigation.hpp"
+
+#include <optick.h>
 
 namespace vts
 {
@@ -38,6 +42,7 @@ DrawSurfaceTask::DrawSurfaceTask()
     color[3] = 1;
     blendingCoverage = 1;
     vecToRaw(vec4f(-1, -1, 2, 2), uvClip);
+    indicesOffset = indicesCount = 0;
 }
 
 DrawGeodataTask::DrawGeodataTask()
@@ -61,17 +66,29 @@ CameraDraws::Camera::Camera()
     memset(this, 0, sizeof(*this));
 }
 
-CameraDraws::CameraDraws()
+CameraDraws::CameraDraws() : farFieldRefresh(false)
 {}
 
+DrawSurfaceRetained::DrawSurfaceRetained() : id(0), transparent(false)
+{
+    for (uint32 i = 0; i < 16; i++)
+        model[i] = i % 5 == 0 ? 1 : 0;
+}
+
 void CameraDraws::clear()
 {
     camera = Camera();
     opaque.clear();
     transparent.clear();
+    farFieldOpaque.clear();
+    farFieldTransparent.clear();
+    farFieldRefresh = false;
     geodata.clear();
     infographics.clear();
     colliders.clear();
+    retainedAdded.clear();
+    retainedRemoved.clear();
+    retainedTransparentOrder.clear();
 }
 
 bool RenderSurfaceTask::ready() const
@@ -104,6 +121,34 @@ bool RenderColliderTask::ready() const
 namespace
 {
 
+// the view (see lookAt) and the models are affine
+//   the upper three rows of the product are computed
+//   without the temporary matrices
+//   and the floats are written directly into the draw
+void modelViewToRaw(const mat4 &view, const mat4 &model, float out[16])
+{
+    if (model(3, 0) != 0 || model(3, 1) != 0
+        || model(3, 2) != 0 || model(3, 3) != 1)
+    {
+        matToRaw(mat4f(mat4(view * model).cast<float>()), out);
+        return;
+    }
+    assert(view(3, 0) == 0 && view(3, 1) == 0
+        && view(3, 2) == 0 && view(3, 3) == 1);
+    const mat3 rot = view.block<3, 3>(0, 0);
+    for (uint32 c = 0; c < 4; c++)
+    {
+        vec3 v = rot * vec3(model.block<3, 1>(0, c));
+        if (c == 3)
+            v += view.block<3, 1>(0, 3);
+        float *o = out + c * 4;
+        o[0] = (float)v[0];
+        o[1] = (float)v[1];
+        o[2] = (float)v[2];
+        o[3] = c == 3 ? 1 : 0;
+    }
+}
+
 template<class D, class R>
 D convert(CameraImpl *impl, const R &task)
 {
@@ -113,8 +158,7 @@ D convert(CameraImpl *impl, const R &task)
         result.mesh = task.mesh->getUserData();
     if (task.textureColor)
         result.texColor = task.textureColor->getUserData();
-    mat4f mv = mat4(impl->viewActual * task.model).cast<float>();
-    matToRaw(mv, result.mv);
+    modelViewToRaw(impl->viewActual, task.model, result.mv);
     vecToRaw(task.color, result.color);
     return result;
 }
@@ -129,8 +173,8 @@ DrawSurfaceTask CameraImpl::convert(const RenderSurfaceTask &task)
         result.texMask = task.textureMask->getUserData();
     vecToRaw(task.uvTrans, result.uvTrans);
     vecToRaw(vec4f(0, 0, 1, 1), result.uvClip);
-    vec3f c = vec4to3(vec4(task.model * vec4(0, 0, 0, 1))).cast<float>();
-    vecToRaw(c, result.center);
+    for (uint32 i = 0; i < 3; i++)
+        result.center[i] = (float)task.model(i, 3);
     result.externalUv = task.externalUv;
     return result;
 }
@@ -141,9 +185,333 @@ DrawSurfaceTask CameraImpl::convert(const RenderSurfaceTask &task,
     DrawSurfaceTask result = convert(task);
     vecToRaw(uvClip, result.uvClip);
     result.blendingCoverage = blendingCoverage; // may be nan
+
+    // clip within single quarter of the mesh
+    const uint32 qx = uvClip[0] >= 0.5f ? 1 : 0;
+    const uint32 qy = uvClip[1] >= 0.5f ? 1 : 0;
+    if (uvClip[0] >= 0 && uvClip[1] >= 0
+        && uvClip[2] <= 0.5f * (qx + 1) && uvClip[3] <= 0.5f * (qy + 1))
+    {
+        const uint32 q = qx + qy * 2;
+        if (task.mesh->quarterCounts[q])
+        {
+            result.indicesOffset = task.mesh->quarterOffsets[q];
+            result.indicesCount = task.mesh->quarterCounts[q];
+        }
+    }
     return result;
 }
 
+namespace
+{
+
+uint64 hashCombine(uint64 seed, uint64 v)
+{
+    return seed ^ (v + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+// the id depends only on the resources and the clipping
+//   which are same for the same tile in consecutive frames
+uint64 retainedDrawId(const DrawSurfaceTask &t)
+{
+    uint64 h = 0;
+    h = hashCombine(h, (uint64)(std::uintptr_t)t.mesh.get());
+    h = hashCombine(h, (uint64)(std::uintptr_t)t.texColor.get());
+    h = hashCombine(h, (uint64)(std::uintptr_t)t.texMask.get());
+    for (float f : t.uvClip)
+    {
+        uint32 u;
+        memcpy(&u, &f, sizeof(u));
+        h = hashCombine(h, u);
+    }
+    return h;
+}
+
+bool retainedDrawChanged(const RetainedDrawState &s,
+    const DrawSurfaceTask &t, bool transparent)
+{
+    return s.mesh != t.mesh.get()
+        || s.texColor != t.texColor.get()
+        || s.texMask != t.texMask.get()
+        || memcmp(s.uvClip, t.uvClip, sizeof(s.uvClip)) != 0
+        || s.transparent != transparent
+        || s.externalUv != t.externalUv
+        || memcmp(s.uvTrans, t.uvTrans, sizeof(s.uvTrans)) != 0
+        || memcmp(s.color, t.color, sizeof(s.color)) != 0
+        || memcmp(&s.blendingCoverage, &t.blendingCoverage,
+            sizeof(s.blendingCoverage)) != 0;
+}
+
+} // namespace
+
+void CameraImpl::publishRetainedDraws()
+{
+    if (!options.retainedDraws)
+    {
+        retainedDraws.clear();
+        return;
+    }
+
+    OPTICK_EVENT();
+    retainedFrame++;
+    const mat4 viewInv = viewActual.inverse();
+
+    const auto &process = [&](DrawSurfaceTask &t, bool transparent)
+    {
+        uint64 id = retainedDrawId(t);
+        auto it = retainedDraws.find(id);
+        // identical draws share the hash
+        while (it != retainedDraws.end()
+            && it->second.frame == retainedFrame)
+            it = retainedDraws.find(++id);
+        if (transparent)
+            draws.retainedTransparentOrder.push_back(id);
+        if (it != retainedDraws.end()
+            && !retainedDrawChanged(it->second, t, transparent))
+        {
+            it->second.frame = retainedFrame;
+            return;
+        }
+        RetainedDrawState &s = retainedDraws[id];
+        s.mesh = t.mesh.get();
+        s.texColor = t.texColor.get();
+        s.texMask = t.texMask.get();
+        memcpy(s.uvClip, t.uvClip, sizeof(s.uvClip));
+        memcpy(s.uvTrans, t.uvTrans, sizeof(s.uvTrans));
+        memcpy(s.color, t.color, sizeof(s.color));
+        s.blendingCoverage = t.blendingCoverage;
+        s.externalUv = t.externalUv;
+        s.transparent = transparent;
+        s.frame = retainedFrame;
+        draws.retainedAdded.emplace_back();
+        DrawSurfaceRetained &r = draws.retainedAdded.back();
+        matToRaw(mat4(viewInv * rawToMat4(t.mv).cast<double>()), r.model);
+        r.id = id;
+        r.transparent = transparent;
+        r.task = std::move(t);
+    };
+    for (DrawSurfaceTask &t : draws.opaque)
+        process(t, false);
+    for (DrawSurfaceTask &t : draws.transparent)
+        process(t, true);
+    draws.opaque.clear();
+    draws.transparent.clear();
+
+    for (auto it = retainedDraws.begin(); it != retainedDraws.end();)
+    {
+        if (it->second.frame != retainedFrame)
+        {
+            draws.retainedRemoved.push_back(it->first);
+            it = retainedDraws.erase(it);
+        }
+        else
+            it++;
+    }
+}
+
+void CameraImpl::shareDraws(CameraImpl &follower)
+{
+    // the draws are moved from the view of the leader to the follower
+    //   the relative transformation is small for stereo views
+    //   which keeps the single precision of the mv sufficient
+    const mat4 rel = follower.viewActual * viewActual.inverse();
+    const auto &copy = [&](const auto &src, auto &dst) {
+        dst.reserve(dst.size() + src.size());
+        for (const auto &t : src)
+        {
+            dst.push_back(t);
+            auto &d = dst.back();
+            const mat4 mv = rel * rawToMat4(d.mv).template cast<double>();
+            matToRaw(mat4f(mv.cast<float>()), d.mv);
+        }
+    };
+    CameraDraws &f = follower.draws;
+    copy(draws.opaque, f.opaque);
+    copy(draws.transparent, f.transparent);
+    copy(draws.infographics, f.infographics);
+    copy(draws.colliders, f.colliders);
+    f.geodata.insert(f.geodata.end(), draws.geodata.begin(),
+        draws.geodata.end());
+    follower.renderedColliders = renderedColliders;
+    follower.statistics = statistics;
+}
+
+void CameraImpl::publishDraws()
+{
+    for (auto &f : traversalGroup)
+        shareDraws(*f);
+    for (auto &it : traversalFollowers)
+    {
+        if (auto f = it.lock())
+        {
+            f->redrawUpdate();
+            f->publishRetainedDraws();
+        }
+    }
+    redrawUpdate();
+    publishRetainedDraws();
+}
+
+namespace
+{
+
+template<class T>
+uint64 hashValues(uint64 seed, const T *values, uint32 count)
+{
+    static_assert(sizeof(T) <= sizeof(uint64), "unsupported type");
+    for (uint32 i = 0; i < count; i++)
+    {
+        uint64 u = 0;
+        memcpy(&u, values + i, sizeof(T));
+        seed = hashCombine(seed, u);
+    }
+    return seed;
+}
+
+uint64 surfaceHash(const DrawSurfaceTask &t)
+{
+    uint64 h = retainedDrawId(t);
+    h = hashValues(h, t.mv, 16);
+    h = hashValues(h, t.uvTrans, 4);
+    h = hashValues(h, t.color, 4);
+    h = hashValues(h, &t.blendingCoverage, 1);
+    return hashCombine(h, t.externalUv);
+}
+
+uint64 infographicsHash(const DrawInfographicsTask &t)
+{
+    uint64 h = 0;
+    h = hashCombine(h, (uint64)(std::uintptr_t)t.mesh.get());
+    h = hashCombine(h, (uint64)(std::uintptr_t)t.texColor.get());
+    h = hashValues(h, t.mv, 16);
+    h = hashValues(h, t.color, 4);
+    h = hashValues(h, t.data, 4);
+    h = hashValues(h, t.data2, 4);
+    return hashCombine(h, t.type);
+}
+
+} // namespace
+
+// identical draws in consecutive frames produce the same signature
+//   the order of the opaque draws and of the geodata is not significant
+uint64 CameraImpl::drawsSignature() const
+{
+    uint64 h = 0;
+    h = hashValues(h, draws.camera.view, 16);
+    h = hashValues(h, draws.camera.proj, 16);
+    uint64 s = 0;
+    for (const DrawSurfaceTask &t : draws.opaque)
+        s += surfaceHash(t);
+    h = hashCombine(h, s);
+    for (const DrawSurfaceTask &t : draws.transparent)
+        h = hashCombine(h, surfaceHash(t));
+    s = 0;
+    for (const DrawSurfaceTask &t : draws.farFieldOpaque)
+        s += surfaceHash(t);
+    for (const DrawSurfaceTask &t : draws.farFieldTransparent)
+        s += surfaceHash(t);
+    h = hashCombine(h, s);
+    h = hashCombine(h, draws.farFieldRefresh);
+    s = 0;
+    for (const DrawGeodataTask &t : draws.geodata)
+        s += hashCombine(0, (uint64)(std::uintptr_t)t.geodata.get());
+    h = hashCombine(h, s);
+    s = 0;
+    for (const DrawInfographicsTask &t : draws.infographics)
+        s += infographicsHash(t);
+    return hashCombine(h, s);
+}
+
+void CameraImpl::redrawInputs(std::vector<double> &inputs)
+{
+    inputs.clear();
+    const auto &add = [&](const double *values, uint32 count)
+    {
+        inputs.insert(inputs.end(), values, values + count);
+    };
+    add(eye.data(), 3);
+    add(target.data(), 3);
+    add(up.data(), 3);
+    add(apiProj.data(), 16);
+    inputs.push_back(windowWidth);
+    inputs.push_back(windowHeight);
+    {
+        std::lock_guard<std::mutex> lock(feedbackMutex);
+        inputs.push_back(feedbackResolutionScale);
+    }
+    // the navigation api changes the targets
+    //   the view catches up with them in the following updates
+    if (auto nav = navigation.lock())
+    {
+        add(nav->targetPosition.data(), 3);
+        add(nav->targetOrientation.data(), 3);
+        inputs.push_back(nav->targetVerticalExtent);
+        inputs.push_back(nav->verticalFov);
+        inputs.push_back(nav->autoRotation);
+        inputs.push_back((double)(int)nav->type);
+    }
+}
+
+std::string CameraImpl::redrawOptions()
+{
+    std::string r = options.toJson();
+    if (auto nav = navigation.lock())
+        r += nav->options.toJson();
+    return r;
+}
+
+void CameraImpl::redrawUpdate()
+{
+    if (!redraw.tracking)
+        return;
+    OPTICK_EVENT();
+    const uint64 h = drawsSignature();
+    redraw.drawsChanged = h != redraw.drawsHash || traversalBudgetHit;
+    redraw.drawsHash = h;
+    redraw.moving = redrawInputsChanged();
+    redrawInputs(redraw.inputs);
+    redraw.options = redrawOptions();
+}
+
+bool CameraImpl::redrawInputsChanged()
+{
+    std::vector<double> &inputs = redraw.inputsTmp;
+    redrawInputs(inputs);
+    // bitwise comparison, nan is not equal to itself
+    return inputs.size() != redraw.inputs.size() || memcmp(inputs.data(),
+        redraw.inputs.data(), inputs.size() * sizeof(double)) != 0;
+}
+
+bool CameraImpl::redrawNeeded()
+{
+    if (!redraw.tracking)
+    {
+        // the state of the last update is not known yet
+        redraw.tracking = true;
+        return true;
+    }
+    if (redraw.drawsChanged || redrawInputsChanged())
+        return true;
+    return redrawOptions() != redraw.options;
+}
+
+double CameraImpl::frameInterval()
+{
+    const MapRuntimeOptions &o = map->options;
+    if (!redraw.tracking)
+    {
+        redraw.tracking = true;
+        return o.frameIntervalMotion;
+    }
+    // the view keeps moving while the navigation catches up
+    //   with its targets, or the host has changed the view
+    if (redraw.moving || redrawInputsChanged())
+        return o.frameIntervalMotion;
+    if (redraw.drawsChanged || redrawOptions() != redraw.options)
+        return o.frameIntervalTransition;
+    return inf1();
+}
+
 DrawInfographicsTask CameraImpl::convert(const RenderInfographicsTask &task)
 {
     return vts::convert<DrawInfographicsTask,
@@ -156,8 +524,7 @@ DrawColliderTask CameraImpl::convert(const RenderColliderTask &task)
     DrawColliderTask result;
     if (task.mesh)
         result.mesh = task.mesh->getUserData();
-    mat4f mv = mat4(viewActual * task.model).cast<float>();
-    matToRaw(mv, result.mv);
+    modelViewToRaw(viewActual, task.model, result.mv);
     return result;
 }
 
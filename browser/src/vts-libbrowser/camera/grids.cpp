@@ -44,10 +44,8 @@ void tileWrap(TileId::index_type m, TileId::index_type &x, sint32 d)
 uint32 childIndex(const TileId &me, const TileId &child)
 {
     assert(child.lod > me.lod);
-    TileId t(child);
-    while (t.lod > me.lod + 1)
-        t = vtslibs::vts::parent(t);
-    return vtslibs::vts::child(t);
+    uint32 s = child.lod - me.lod - 1;
+    return vtslibs::vts::child(TileId(me.lod + 1, child.x >> s, child.y >> s));
 }
 
 // compare with epsilon
@@ -66,15 +64,24 @@ bool leftNeighbor(const vec4f &a, const vec4f &b)
 
 } // namespace
 
-SubtilesMerger::Subtile::Subtile(TraverseNode *orig, const vec4f &uvClip)
-    : orig(orig), uvClip(uvClip)
+SubtilesMerger::Subtile::Subtile(TraverseNode *trav, TraverseNode *orig,
+    const vec4f &uvClip) : trav(trav), orig(orig), uvClip(uvClip)
 {}
 
-void SubtilesMerger::resolve(TraverseNode *trav, CameraImpl *impl)
+void SubtilesMerger::add(TraverseNode *trav, TraverseNode *orig,
+    const vec4f &uvClip)
 {
-    assert(!subtiles.empty());
+    subtiles.emplace_back(trav, orig, uvClip);
+}
+
+void SubtilesMerger::resolve(CameraImpl *impl)
+{
+    if (subtiles.empty())
+        return;
     std::sort(subtiles.begin(), subtiles.end(),
         [](const Subtile &a, const Subtile &b) {
+        if (a.trav != b.trav)
+            return std::less<TraverseNode*>()(a.trav, b.trav);
         return a.orig->id < b.orig->id;
     });
     // merge consecutive subtiles that form a line in the x direction
@@ -84,7 +91,8 @@ void SubtilesMerger::resolve(TraverseNode *trav, CameraImpl *impl)
     {
         Subtile &p = *prevIt;
         Subtile &n = *it;
-        if (p.orig->id.lod == n.orig->id.lod
+        if (p.trav == n.trav
+            && p.orig->id.lod == n.orig->id.lod
             && p.orig->id.y == n.orig->id.y
             && leftNeighbor(p.uvClip, n.uvClip))
         {
@@ -98,11 +106,12 @@ void SubtilesMerger::resolve(TraverseNode *trav, CameraImpl *impl)
     {
         if (it.orig)
         {
-            for (auto &r : trav->opaque)
+            for (auto &r : it.trav->opaque)
                 impl->draws.opaque.emplace_back(impl->convert(r,
                         it.uvClip, nan1()));
         }
     }
+    subtiles.clear();
 }
 
 void CameraImpl::gridPreloadRequest(TraverseNode *trav)
@@ -119,6 +128,11 @@ void CameraImpl::gridPreloadRequest(TraverseNode *trav)
         trav = trav->parent;
     }
 
+    // all siblings of the same parent request the same neighborhood
+    if (trav == gridLastRequest)
+        return;
+    gridLastRequest = trav;
+
     const sint32 D = options.balancedGridNeighborsDistance;
     const TileId &base = trav->id;
     const TileId::index_type m = 1 << base.lod;
@@ -141,38 +155,44 @@ void CameraImpl::gridPreloadProcess(TraverseNode *root)
     std::sort(glr.begin(), glr.end());
     glr.erase(std::unique(glr.begin(), glr.end()), glr.end());
     statistics.currentGridNodes += glr.size();
-    gridPreloadProcess(root, glr);
+    gridPreloadProcess(root, glr.begin(), glr.end());
     glr.clear();
+    gridLastRequest = nullptr;
 }
 
 void CameraImpl::gridPreloadProcess(TraverseNode *trav,
-    const std::vector<TileId> &requests)
+    std::vector<TileId>::iterator begin,
+    std::vector<TileId>::iterator end)
 {
-    if (requests.empty())
+    if (begin == end)
         return;
     if (!travInit(trav))
         return;
 
+    // the requests are partitioned in place into ranges for each child
+    //   so that each node is visited once, regardless of the number of requests
     const TileId &myId = trav->id;
-    std::vector<TileId> childRequests[4];
-    for (auto &cr : childRequests)
-        cr.reserve(requests.size());
-    for (const TileId &t : requests)
-    {
+    auto it = std::partition(begin, end, [&](const TileId &t) {
         assert(t.lod >= myId.lod);
-        if (t.lod == myId.lod)
-        {
-            assert(t == myId);
-            travDetermineDraws(trav);
-            trav->lastRenderTime = trav->lastAccessTime;
-        }
-        else
-            childRequests[childIndex(myId, t)].push_back(t);
+        return t.lod == myId.lod;
+    });
+    if (it != begin)
+    {
+        assert(*begin == myId);
+        assert(it - begin == 1);
+        travDetermineDraws(trav);
+        trav->lastRenderTime = trav->lastAccessTime;
     }
 
     for (auto &c : trav->childs)
-        gridPreloadProcess(&c, childRequests[
-            childIndex(myId, c.id)]);
+    {
+        uint32 ci = childIndex(myId, c.id);
+        auto e = std::partition(it, end, [&](const TileId &t) {
+            return childIndex(myId, t) == ci;
+        });
+        gridPreloadProcess(&c, it, e);
+        it = e;
+    }
 }
 
 } // namespace vts
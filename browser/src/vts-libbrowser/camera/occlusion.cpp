@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../camera.hpp"
+#include "../traverseNode.hpp"
+#include "../metaTile.hpp"
+#include "../map.hpp"
+
+namespace vts
+{
+
+namespace
+{
+
+// the depth older than this many render ticks is ignored
+const uint32 MaxOcclusionAge = 10;
+
+} // namespace
+
+OcclusionDepth::OcclusionDepth(const float *depth,
+    uint32 width, uint32 height, const mat4 &viewProj)
+    : viewProj(viewProj)
+{
+    if (width * height == 0)
+        return;
+
+    {
+        Level l;
+        l.width = width;
+        l.height = height;
+        l.data.assign(depth, depth + width * height);
+        levels.push_back(std::move(l));
+    }
+
+    // each texel of coarser level is maximum of the 2x2 finer texels
+    //   the last row/column is repeated for odd sizes
+    while (levels.back().width > 1 || levels.back().height > 1)
+    {
+        const Level &s = levels.back();
+        Level l;
+        l.width = (s.width + 1) / 2;
+        l.height = (s.height + 1) / 2;
+        l.data.resize(l.width * l.height);
+        for (uint32 y = 0; y < l.height; y++)
+        {
+            const float *r0 = s.data.data()
+                + std::min(y * 2, s.height - 1) * s.width;
+            const float *r1 = s.data.data()
+                + std::min(y * 2 + 1, s.height - 1) * s.width;
+            for (uint32 x = 0; x < l.width; x++)
+            {
+                const uint32 x0 = std::min(x * 2, s.width - 1);
+                const uint32 x1 = std::min(x * 2 + 1, s.width - 1);
+                l.data[y * l.width + x] = std::max(
+                    std::max(r0[x0], r0[x1]), std::max(r1[x0], r1[x1]));
+            }
+        }
+        levels.push_back(std::move(l));
+    }
+}
+
+bool OcclusionDepth::occluded(const vec3 &center,
+    const vec3 halfAxes[3]) const
+{
+    if (levels.empty())
+        return false;
+
+    // screen space bounding rectangle and the nearest depth of the box
+    double x0 = inf1(), y0 = inf1(), z0 = inf1();
+    double x1 = -inf1(), y1 = -inf1();
+    for (uint32 i = 0; i < 8; i++)
+    {
+        vec3 c = center;
+        for (uint32 a = 0; a < 3; a++)
+            c += (i & (1 << a)) ? halfAxes[a] : vec3(-halfAxes[a]);
+        vec4 p = viewProj * vec3to4(c, 1);
+        if (!(p[3] > 0) || !p.allFinite())
+            return false; // crosses the near plane
+        p /= p[3];
+        x0 = std::min(x0, p[0]);
+        x1 = std::max(x1, p[0]);
+        y0 = std::min(y0, p[1]);
+        y1 = std::max(y1, p[1]);
+        z0 = std::min(z0, p[2]);
+    }
+
+    // nothing is known outside the recorded view
+    if (x0 < -1 || x1 > 1 || y0 < -1 || y1 > 1 || z0 < -1)
+        return false;
+    const double z = z0 * 0.5 + 0.5;
+
+    // find the level where the rectangle covers at most 2x2 texels
+    const Level &b = levels[0];
+    uint32 px0 = (uint32)((x0 * 0.5 + 0.5) * (b.width - 1));
+    uint32 px1 = (uint32)std::ceil((x1 * 0.5 + 0.5) * (b.width - 1));
+    uint32 py0 = (uint32)((y0 * 0.5 + 0.5) * (b.height - 1));
+    uint32 py1 = (uint32)std::ceil((y1 * 0.5 + 0.5) * (b.height - 1));
+    uint32 li = 0;
+    while (li + 1 < levels.size() && (px1 - px0 > 1 || py1 - py0 > 1))
+    {
+        px0 /= 2;
+        px1 /= 2;
+        py0 /= 2;
+        py1 /= 2;
+        li++;
+    }
+
+    const Level &l = levels[li];
+    px1 = std::min(px1, l.width - 1);
+    py1 = std::min(py1, l.height - 1);
+    float m = 0;
+    for (uint32 y = py0; y <= py1; y++)
+        for (uint32 x = px0; x <= px1; x++)
+            m = std::max(m, l.data[y * l.width + x]);
+
+    // far plane (eg. sky) does not occlude anything
+    if (m >= 1 - 1e-7)
+        return false;
+    return z > m;
+}
+
+bool CameraImpl::occlusionTest(TraverseNode *trav)
+{
+    assert(trav->meta);
+    if (!options.occlusionCulling || !occlusionDepth || prefetching
+        || occlusionTick + MaxOcclusionAge < map->renderTickIndex)
+        return false;
+    if (trav->meta->obb)
+    {
+        const MetaNode::Obb &obb = *trav->meta->obb;
+        return occlusionDepth->occluded(obb.center, obb.halfAxes);
+    }
+    const vec3 *aabb = trav->meta->aabbPhys;
+    const vec3 half = (aabb[1] - aabb[0]) * 0.5;
+    const vec3 halfAxes[3] = {
+        vec3(half[0], 0, 0), vec3(0, half[1], 0), vec3(0, 0, half[2]) };
+    return occlusionDepth->occluded((aabb[0] + aabb[1]) * 0.5, halfAxes);
+}
+
+} // namespace vts
@@ -0,0 +1,185 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "../camera.hpp"
+#include "../traverseNode.hpp"
+#include "../mapLayer.hpp"
+#include "../map.hpp"
+
+#include <optick.h>
+
+namespace vts
+{
+
+namespace
+{
+
+// duration (in seconds) over which the camera velocity is smoothed
+static const double MotionSmoothingDuration = 0.3;
+
+// the prefetch is skipped when the predicted view moves less
+//   than this fraction of the distance between the eye and the target
+static const double MinimumPredictedMovement = 0.05;
+
+// maximum number of nodes processed by one prefetch pass
+static const uint32 MaxPrefetchNodes = 500;
+
+// all prefetch priorities are below this value
+// priorities of visible nodes are 1e6 / (distance + 1),
+//   which is above the band for any reasonable distance
+static const float PrefetchPriorityBand = 1e-3f;
+
+vec3 predict(const vec3 &position, const vec3 &velocity, double duration)
+{
+    return position + velocity * duration;
+}
+
+} // namespace
+
+float CameraImpl::prefetchPriority(float priority)
+{
+    return PrefetchPriorityBand * priority / (priority + 1);
+}
+
+void CameraImpl::prefetchUpdate()
+{
+    if (options.prefetchDuration <= 0)
+    {
+        prefetchMotionValid = false;
+        return;
+    }
+
+    // estimate camera velocity
+    const double elapsed = map->lastElapsedFrameTime;
+    if (!prefetchMotionValid || !(elapsed > 0))
+    {
+        prefetchEyeVelocity = prefetchTargetVelocity = vec3(0, 0, 0);
+        prefetchMotionValid = true;
+    }
+    else
+    {
+        const double f = std::min(elapsed / MotionSmoothingDuration, 1.0);
+        prefetchEyeVelocity = interpolate(prefetchEyeVelocity,
+            vec3((eye - prefetchLastEye) / elapsed), f);
+        prefetchTargetVelocity = interpolate(prefetchTargetVelocity,
+            vec3((target - prefetchLastTarget) / elapsed), f);
+    }
+    prefetchLastEye = eye;
+    prefetchLastTarget = target;
+
+    // predict the camera
+    const vec3 predEye = predict(eye, prefetchEyeVelocity,
+        options.prefetchDuration);
+    const vec3 predTarget = predict(target, prefetchTargetVelocity,
+        options.prefetchDuration);
+    {
+        const double threshold = length(vec3(target - eye))
+            * MinimumPredictedMovement;
+        if (length(vec3(predEye - eye)) < threshold
+            && length(vec3(predTarget - target)) < threshold)
+            return;
+    }
+
+    OPTICK_EVENT();
+
+    // temporarily replace the camera with the predicted one
+    const mat4 origViewProjRender = viewProjRender;
+    const mat4 origViewProjCulling = viewProjCulling;
+    const vec3 origPerpendicularUnitVector = perpendicularUnitVector;
+    const vec3 origForwardUnitVector = forwardUnitVector;
+    const vec3 origCameraPosPhys = cameraPosPhys;
+    const vec3 origFocusPosPhys = focusPosPhys;
+    vec4 origCullingPlanes[6];
+    for (uint32 i = 0; i < 6; i++)
+        origCullingPlanes[i] = cullingPlanes[i];
+    const CameraStatistics origStatistics = statistics;
+    {
+        vec3 forward = normalize(vec3(predTarget - predEye));
+        vec3 off = forward * options.cullingOffsetDistance;
+        viewProjRender = apiProj * lookAt(predEye, predTarget, up);
+        viewProjCulling = apiProj * lookAt(predEye - off, predTarget, up);
+        perpendicularUnitVector
+            = normalize(cross(cross(up, forward), forward));
+        forwardUnitVector = forward;
+        vts::frustumPlanes(viewProjCulling, cullingPlanes);
+        cameraPosPhys = predEye;
+        focusPosPhys = predTarget;
+    }
+
+    // traverse
+    prefetching = true;
+    uint32 budget = MaxPrefetchNodes;
+    for (auto &it : map->layers)
+    {
+        if (it->surfaceStack.surfaces.empty())
+            continue;
+        if ((it->isGeodata() ? options.traverseModeGeodata
+            : options.traverseModeSurfaces) == TraverseMode::None)
+            continue;
+        travModePrefetch(it->traverseRoot.get(), budget);
+    }
+    prefetching = false;
+
+    // restore the camera
+    // the prefetch does not count towards the render progress
+    viewProjRender = origViewProjRender;
+    viewProjCulling = origViewProjCulling;
+    perpendicularUnitVector = origPerpendicularUnitVector;
+    forwardUnitVector = origForwardUnitVector;
+    cameraPosPhys = origCameraPosPhys;
+    focusPosPhys = origFocusPosPhys;
+    for (uint32 i = 0; i < 6; i++)
+        cullingPlanes[i] = origCullingPlanes[i];
+    statistics = origStatistics;
+    statistics.currentPrefetchNodes = MaxPrefetchNodes - budget;
+}
+
+void CameraImpl::travModePrefetch(TraverseNode *trav, uint32 &budget)
+{
+    if (budget == 0)
+        return;
+    budget--;
+
+    if (!travInit(trav))
+        return;
+
+    if (!visibilityTest(trav))
+        return;
+
+    if (coarsenessTest(trav) || trav->childs.empty())
+    {
+        // the resources may not be unloaded
+        trav->lastRenderTime = trav->lastAccessTime;
+        travDetermineDraws(trav);
+        return;
+    }
+
+    for (auto &t : trav->childs)
+        travModePrefetch(&t, budget);
+}
+
+} // namespace vts
@@ -33,8 +33,11 @@
 #include "../metaTile.hpp"
 #include "../mapLayer.hpp"
 #include "../mapConfig.hpp"
+#include "../resources.hpp"
 #include "../map.hpp"
 
+#include <unordered_set>
+
 namespace vts
 {
 
@@ -45,20 +48,138 @@ double CameraImpl::travDistance(TraverseNode *trav, const vec3 pointPhys)
     return aabbPointDist(pointPhys, trav->meta->aabbPhys[0], trav->meta->aabbPhys[1]);
 }
 
+namespace
+{
+
+// estimated downloads are compared in multiples of this size
+static const double PriorityBytesUnit = 64 * 1024;
+
+// nodes that would fill a hole in the rendering
+//   are preferred over refinements of drawable ancestors
+static const double PriorityHoleBoost = 4;
+
+// the priorities of visible nodes stay well above the prefetch band
+static const double PriorityScale = 1e3;
+
+// nodes waiting for resources determine their draws at least this often
+static const uint32 WaitingNodeMaxTicks = 10;
+
+double averageBytes(const std::vector<DownloadTimings> &timings,
+    FetchTask::ResourceType type)
+{
+    const uint32 t = (uint32)type;
+    if (t >= timings.size() || timings[t].count == 0)
+        return 0;
+    return (double)timings[t].bytes / timings[t].count;
+}
+
+} // namespace
+
+void CameraImpl::updatePriorityBytes()
+{
+    Resources *r = map->resources.get();
+    std::lock_guard<std::mutex> lock(r->downloadTimingsMutex);
+    priorityBytesSurfaces
+        = averageBytes(r->downloadTimings, FetchTask::ResourceType::Mesh)
+        + averageBytes(r->downloadTimings, FetchTask::ResourceType::Texture);
+    priorityBytesGeodata = averageBytes(r->downloadTimings,
+        FetchTask::ResourceType::GeodataFeatures);
+}
+
+double CameraImpl::visibleFraction(TraverseNode *trav)
+{
+    // screen-space bounding rectangle of the box clipped by the viewport
+    const vec3 *b = trav->meta->aabbPhys;
+    vec2 lo(inf1(), inf1()), hi(-inf1(), -inf1());
+    for (uint32 i = 0; i < 8; i++)
+    {
+        const vec4 p = viewProjActual * vec4(b[(i >> 0) & 1][0],
+            b[(i >> 1) & 1][1], b[(i >> 2) & 1][2], 1);
+        if (p[3] <= 0)
+            return 1; // the camera is inside or next to the box
+        const vec2 s(p[0] / p[3], p[1] / p[3]);
+        lo = lo.cwiseMin(s);
+        hi = hi.cwiseMax(s);
+    }
+    const vec2 size = hi - lo;
+    const double area = size[0] * size[1];
+    if (area <= 0)
+        return 1;
+    const vec2 cl = lo.cwiseMax(vec2(-1, -1));
+    const vec2 ch = hi.cwiseMin(vec2(1, 1));
+    const vec2 cs = vec2(ch - cl).cwiseMax(vec2(0, 0));
+    return cs[0] * cs[1] / area;
+}
+
+double CameraImpl::screenSize(TraverseNode *trav)
+{
+    // larger side of the screen-space bounding rectangle in pixels
+    const vec3 *b = trav->meta->aabbPhys;
+    vec2 lo(inf1(), inf1()), hi(-inf1(), -inf1());
+    for (uint32 i = 0; i < 8; i++)
+    {
+        const vec4 p = viewProjActual * vec4(b[(i >> 0) & 1][0],
+            b[(i >> 1) & 1][1], b[(i >> 2) & 1][2], 1);
+        if (p[3] <= 0)
+            return inf1(); // the camera is inside or next to the box
+        const vec2 s(p[0] / p[3], p[1] / p[3]);
+        lo = lo.cwiseMin(s);
+        hi = hi.cwiseMax(s);
+    }
+    const vec2 size = hi - lo;
+    return 0.5 * resolutionScale * std::max(size[0] * windowWidth,
+        size[1] * windowHeight);
+}
+
+float CameraImpl::screenSpaceErrorPriority(TraverseNode *trav)
+{
+    // the node replaces its parent, which is about twice as coarse
+    //   the error fixed by the node is therefore proportional to its own
+    const double sse = std::min(coarsenessValue(trav), 1e3);
+    const double visible = std::max(visibleFraction(trav), 0.05);
+    double hole = PriorityHoleBoost;
+    for (const TraverseNode *p = trav->parent; p; p = p->parent)
+    {
+        if (p->determined && !p->rendersEmpty())
+        {
+            hole = 1;
+            break;
+        }
+    }
+    const double bytes = trav->layer->isGeodata()
+        ? priorityBytesGeodata : priorityBytesSurfaces;
+    return (float)(PriorityScale * sse * visible * hole
+        / (1 + bytes / PriorityBytesUnit));
+}
+
 void CameraImpl::updateNodePriority(TraverseNode *trav)
 {
     if (trav->meta)
-        trav->priority = (float)(1e6 / (travDistance(trav, focusPosPhys) + 1));
+    {
+        if (options.priorityModel == PriorityModel::ScreenSpaceError)
+            trav->priority = screenSpaceErrorPriority(trav);
+        else
+            trav->priority = (float)(1e6 / (travDistance(trav, focusPosPhys) + 1));
+        if (prefetching)
+            trav->priority = prefetchPriority(trav->priority)
+                * prefetchWeight;
+    }
     else if (trav->parent)
         trav->priority = trav->parent->priority;
     else
         trav->priority = 0;
 }
 
-std::shared_ptr<GpuTexture> CameraImpl::travInternalTexture(TraverseNode *trav, uint32 subMeshIndex)
+std::shared_ptr<GpuTexture> CameraImpl::travInternalTexture(TraverseNode *trav, MeshPart &part, uint32 subMeshIndex)
 {
-    UrlTemplate::Vars vars(trav->id, trav->meta->localId, subMeshIndex);
-    std::shared_ptr<GpuTexture> res = map->getTexture(trav->surface->urlIntTex(vars));
+    // the mesh aggregate belongs to single node and surface
+    if (part.internalTextureName.empty())
+    {
+        UrlTemplate::Vars vars(trav->id, trav->meta->localId, subMeshIndex);
+        part.internalTextureName = trav->surface->urlIntTex(vars);
+    }
+    std::shared_ptr<GpuTexture> res = map->getTexture(part.internalTextureName);
+    res->tileTexture = true;
     map->touchResource(res);
     res->updatePriority(trav->priority);
     return res;
@@ -69,12 +190,120 @@ bool CameraImpl::generateMonolithicGeodataTrav(TraverseNode *trav)
     assert(!!trav->layer->freeLayer);
     assert(!!trav->layer->freeLayerParams);
     const vtslibs::registry::FreeLayer::Geodata &g = boost::get<vtslibs::registry::FreeLayer::Geodata>(trav->layer->freeLayer->definition);
+
+    // large geodata are partitioned into virtual tiles
+    if (map->createOptions.geodataVirtualTileFeatures > 0)
+    {
+        const std::string geoName = trav->layer->surfaceStack.surfaces[0].urlGeodata({});
+        std::shared_ptr<GeodataFeatures> handle;
+        auto features = map->getActualGeoFeatures(trav->layer->freeLayerName, geoName, trav->priority, handle);
+        if (features.first == Validity::Indeterminate)
+            return false;
+        if (features.first == Validity::Valid)
+        {
+            std::shared_ptr<GeodataPartition> partition = map->getGeodataPartition(geoName + "#partition");
+            partition->updatePriority(trav->priority);
+            partition->update(features.second);
+            switch (map->getResourceValidity(partition))
+            {
+            case Validity::Indeterminate:
+                return false;
+            case Validity::Invalid:
+                break;
+            case Validity::Valid:
+                if (!generateVirtualGeodataTrav(trav, partition.get(), g.displaySize))
+                    break;
+                updateNodePriority(trav);
+                return true;
+            }
+        }
+    }
+
     trav->meta = std::make_shared<const MetaNode>(generateMetaNode(map->mapconfig, map->convertor, trav->id, g));
     trav->surface = &trav->layer->surfaceStack.surfaces[0];
     updateNodePriority(trav);
     return true;
 }
 
+bool CameraImpl::generateVirtualGeodataTrav(TraverseNode *trav, const GeodataPartition *partition, int displaySize)
+{
+    const GeodataPartition::Node *node = partition->find(trav->id);
+    if (!trav->parent && (!node || node->features))
+        return false; // small enough to be processed as one tile
+    if (!node)
+    {
+        // the partition has changed, the node is left empty
+        trav->meta = std::make_shared<const MetaNode>(generateMetaNode(map->mapconfig, trav->id, MetaNode().aabbPhys, 0));
+        return true;
+    }
+
+    if (node->features)
+    {
+        // leaf
+        trav->meta = std::make_shared<const MetaNode>(generateMetaNode(map->mapconfig, trav->id, node->aabbPhys, displaySize));
+        trav->surface = &trav->layer->surfaceStack.surfaces[0];
+        trav->geodataFeatures = node->features;
+        return true;
+    }
+
+    // inner nodes have no draws and are always refined
+    trav->meta = std::make_shared<const MetaNode>(generateMetaNode(map->mapconfig, trav->id, node->aabbPhys, 0));
+    vtslibs::vts::Children childs = vtslibs::vts::children(trav->id);
+    trav->childs.ptr = trav->layer->traverseChildsPool->acquire();
+    for (uint32 i = 0; i < 4; i++)
+        if (node->childs[i])
+            trav->childs.ptr->arr.emplace_back(trav->layer, trav, childs[i]);
+    return true;
+}
+
+void CameraImpl::travRequestMeta(TraverseNode *trav)
+{
+    if (!trav->metaTiles.empty())
+        return;
+    const TileId nodeId = trav->id;
+    trav->metaTiles.resize(trav->layer->surfaceStack.surfaces.size());
+    const UrlTemplate::Vars tileIdVars(map->roundId(nodeId));
+    for (uint32 i = 0, e = trav->metaTiles.size(); i != e; i++)
+    {
+        if (trav->parent)
+        {
+            const std::shared_ptr<MetaTile> &p = trav->parent->metaTiles[i];
+            if (!p)
+                continue;
+            TileId pid = vtslibs::vts::parent(nodeId);
+            uint32 idx = (nodeId.x % 2) + (nodeId.y % 2) * 2;
+            const vtslibs::vts::MetaNode &node = p->get(pid);
+            if ((node.flags() & (vtslibs::vts::MetaNode::Flag::ulChild << idx)) == 0)
+                continue;
+        }
+        trav->metaTiles[i] = map->getMetaTile(trav->layer->surfaceStack.surfaces[i].urlMeta(tileIdVars));
+    }
+}
+
+// requests the metatiles of the children of a node that is close to refinement
+//   so that they are already available when the traversal descends
+void CameraImpl::travPrefetchChildsMeta(TraverseNode *trav)
+{
+    if (trav->childs.empty())
+        return;
+    if (trav->layer->freeLayer && trav->layer->freeLayer->type == vtslibs::registry::FreeLayer::Type::geodata)
+        return;
+    const float priority = trav->priority * 0.5f;
+    for (auto &c : trav->childs)
+    {
+        if (c.meta)
+            continue;
+        travRequestMeta(&c);
+        for (const auto &m : c.metaTiles)
+        {
+            if (!m)
+                continue;
+            map->touchResource(m);
+            m->updatePriority(priority);
+        }
+    }
+}
+
 bool CameraImpl::travDetermineMeta(TraverseNode *trav)
 {
     assert(trav->layer);
@@ -86,6 +315,8 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
 
     // statistics
     statistics.currentNodeMetaUpdates++;
+    if (farFieldRefresh && trav->parent && farFieldTest(trav->parent))
+        farFieldPending++;
 
     // handle non-tiled geodata
     if (trav->layer->freeLayer && trav->layer->freeLayer->type == vtslibs::registry::FreeLayer::Type::geodata)
@@ -93,26 +324,7 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
 
     // retrieve metatile resource handles
     const TileId nodeId = trav->id;
-    if (trav->metaTiles.empty())
-    {
-        trav->metaTiles.resize(trav->layer->surfaceStack.surfaces.size());
-        const UrlTemplate::Vars tileIdVars(map->roundId(nodeId));
-        for (uint32 i = 0, e = trav->metaTiles.size(); i != e; i++)
-        {
-            if (trav->parent)
-            {
-                const std::shared_ptr<MetaTile> &p = trav->parent->metaTiles[i];
-                if (!p)
-                    continue;
-                TileId pid = vtslibs::vts::parent(nodeId);
-                uint32 idx = (nodeId.x % 2) + (nodeId.y % 2) * 2;
-                const vtslibs::vts::MetaNode &node = p->get(pid);
-                if ((node.flags() & (vtslibs::vts::MetaNode::Flag::ulChild << idx)) == 0)
-                    continue;
-            }
-            trav->metaTiles[i] = map->getMetaTile(trav->layer->surfaceStack.surfaces[i].urlMeta(tileIdVars));
-        }
-    }
+    travRequestMeta(trav);
 
     // check metatiles download status
     bool determined = true;
@@ -182,7 +394,7 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
     if (childsAvailable[0] || childsAvailable[1] || childsAvailable[2] || childsAvailable[3])
     {
         vtslibs::vts::Children childs = vtslibs::vts::children(nodeId);
-        trav->childs.ptr = std::make_unique<TraverseChildsArray>();
+        trav->childs.ptr = trav->layer->traverseChildsPool->acquire();
         for (uint32 i = 0; i < 4; i++)
             if (childsAvailable[i])
                 trav->childs.ptr->arr.emplace_back(trav->layer, trav, childs[i]);
@@ -204,14 +416,60 @@ bool CameraImpl::travDetermineDraws(TraverseNode *trav)
 
     // statistics
     statistics.currentNodeDrawsUpdates++;
+    if (farFieldRefresh && farFieldTest(trav))
+        farFieldPending++;
 
     // update priority
     updateNodePriority(trav);
 
+    // nothing the node waits for has changed since the last attempt
+    //   the resources are only kept alive and prioritized
+    // the draws are determined at latest after a few ticks anyway,
+    //   to notice changes outside the resources (eg. configs)
+    if (trav->resourcesChanged && !trav->resourcesChanged->exchange(false))
+    {
+        if (trav->waitingSinceTick + WaitingNodeMaxTicks > map->renderTickIndex)
+        {
+            for (const auto &it : trav->resources)
+            {
+                map->touchResource(it);
+                it->updatePriority(trav->priority);
+            }
+            statistics.currentNodeDrawsWaiting++;
+            return false;
+        }
+    }
+
+    // the resources known from previous attempts are watched
+    //   before their validity is read
+    if (trav->resourcesChanged)
+        for (const auto &it : trav->resources)
+            map->resources->addWaiter(it.get(), trav->resourcesChanged);
+
     if (trav->layer->isGeodata())
-        return trav->determined = travDetermineDrawsGeodata(trav);
+        trav->determined = travDetermineDrawsGeodata(trav);
     else
-        return trav->determined = travDetermineDrawsSurface(trav);
+        trav->determined = travDetermineDrawsSurface(trav);
+
+    if (trav->determined || !trav->surface || trav->resources.empty())
+    {
+        trav->resourcesChanged.reset();
+        return trav->determined;
+    }
+
+    // watch the resources for the next attempt
+    //   resources added just now were read before being watched,
+    //   if they are no longer indeterminate, the next attempt is not skipped
+    if (!trav->resourcesChanged)
+        trav->resourcesChanged = std::make_shared<std::atomic<bool>>(false);
+    trav->waitingSinceTick = map->renderTickIndex;
+    for (const auto &it : trav->resources)
+    {
+        if (map->resources->addWaiter(it.get(), trav->resourcesChanged)
+            && map->getResourceValidity(it) != Validity::Indeterminate)
+            *trav->resourcesChanged = true;
+    }
+    return false;
 }
 
 bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
@@ -232,8 +490,9 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
     // aggregate mesh
     std::shared_ptr<MeshAggregate> meshAgg;
     {
-        const std::string name = trav->surface->urlMesh(UrlTemplate::Vars(nodeId, trav->meta->localId));
-        meshAgg = map->getMeshAggregate(name);
+        if (trav->resourceName.empty())
+            trav->resourceName = trav->surface->urlMesh(UrlTemplate::Vars(nodeId, trav->meta->localId));
+        meshAgg = map->getMeshAggregate(trav->resourceName);
         trav->resources.push_back(meshAgg);
     }
     meshAgg->updatePriority(trav->priority);
@@ -256,16 +515,14 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
     decltype(trav->credits) newCredits;
     for (uint32 subMeshIndex = 0, e = meshAgg->submeshes.size(); subMeshIndex != e; subMeshIndex++)
     {
-        const MeshPart &part = meshAgg->submeshes[subMeshIndex];
+        MeshPart &part = meshAgg->submeshes[subMeshIndex];
         std::shared_ptr<GpuMesh> mesh = part.renderable;
 
         // external bound textures
         if (part.externalUv)
         {
-            BoundParamInfo::List bls = trav->layer->boundList(trav->surface, part.surfaceReference);
-            if (part.textureLayer)
-                bls.push_back(BoundParamInfo(vtslibs::registry::View::BoundLayerParams(map->mapconfig->boundLayers.get(part.textureLayer).id)));
-            const Validity validity = reorderBoundLayers(trav->id, trav->meta->localId, subMeshIndex, bls, trav->priority);
+            BoundParamInfo::List bls;
+            const Validity validity = resolveBoundLayers(trav, subMeshIndex, part, bls);
 
             for (const BoundParamInfo &it : bls)
             {
@@ -290,7 +547,7 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
 
             bool anyOpaqueLayer = false;
             for (const BoundParamInfo &b : bls)
-                if (!b.transparent && !b.textureMask)
+                if (!b.transparent && !b.masked())
                     anyOpaqueLayer = true;
 
             bool allTransparent = true;
@@ -320,7 +577,7 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
                 task.boundLayerId = b.id;
 
                 bool renderTransparent = b.transparent;
-                if (!renderTransparent && b.textureMask)
+                if (!renderTransparent && b.masked())
                 {
                     // layers with texture mask should be rendered as transparencies, which ensures consistent ordering
                     // however, there has to be at least one opaque layer to ensure that depth buffer is written
@@ -345,7 +602,7 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
         if (part.internalUv)
         {
             RenderSurfaceTask task;
-            task.textureColor = travInternalTexture(trav, subMeshIndex);
+            task.textureColor = travInternalTexture(trav, part, subMeshIndex);
             trav->resources.push_back(task.textureColor);
             switch (map->getResourceValidity(task.textureColor))
             {
@@ -374,7 +631,8 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
         for (uint32 subMeshIndex = 0, e = meshAgg->submeshes.size(); subMeshIndex != e; subMeshIndex++)
         {
             const MeshPart &part = meshAgg->submeshes[subMeshIndex];
-            std::shared_ptr<GpuMesh> mesh = part.renderable;
+            std::shared_ptr<GpuMesh> mesh = part.collider
+                ? part.collider : part.renderable;
             RenderColliderTask task;
             task.mesh = mesh;
             task.model = part.normToPhys;
@@ -395,28 +653,70 @@ bool CameraImpl::travDetermineDrawsGeodata(TraverseNode *trav)
 {
     assert(!trav->determined);
     assert(trav->rendersEmpty());
-    assert(trav->resources.empty());
+
+    // reuse resource handles from previous frames
+    //   to avoid formatting the urls and searching for the resources
+    std::shared_ptr<GeodataFeatures> featuresHandle;
+    std::shared_ptr<GeodataTile> geo;
+    for (const auto &it : trav->resources)
+    {
+        if (it->resourceType() == FetchTask::ResourceType::GeodataFeatures)
+            featuresHandle = std::static_pointer_cast<GeodataFeatures>(it);
+        else
+            geo = std::static_pointer_cast<GeodataTile>(it);
+    }
 
     const TileId nodeId = trav->id;
-    const std::string geoName = trav->surface->urlGeodata(UrlTemplate::Vars(nodeId, trav->meta->localId));
+    std::string &geoName = trav->resourceName;
+    std::pair<Validity, std::shared_ptr<const std::string>> features;
+    std::shared_ptr<const GeodataParsedFeatures> parsedFeatures;
+    if (trav->geodataFeatures)
+    {
+        // virtual tile of monolithic geodata
+        if (geoName.empty())
+        {
+            geoName = trav->surface->urlGeodata({}) + "#" + std::to_string(nodeId.lod)
+                + "-" + std::to_string(nodeId.x) + "-" + std::to_string(nodeId.y);
+        }
+        features = { Validity::Valid, trav->geodataFeatures };
+    }
+    else
+    {
+        if (geoName.empty())
+            geoName = trav->surface->urlGeodata(UrlTemplate::Vars(nodeId, trav->meta->localId));
+        const bool newHandle = !featuresHandle;
+        features = map->getActualGeoFeatures(trav->layer->freeLayerName, geoName, trav->priority, featuresHandle);
+        if (newHandle && featuresHandle)
+            trav->resources.push_back(featuresHandle);
+        // override geodata are not parsed in advance
+        if (featuresHandle && featuresHandle->data == features.second)
+            parsedFeatures = featuresHandle->parsed;
+    }
 
     auto style = map->getActualGeoStyle(trav->layer->freeLayerName);
-    auto features = map->getActualGeoFeatures(trav->layer->freeLayerName, geoName, trav->priority);
     if (style.first == Validity::Invalid || features.first == Validity::Invalid)
     {
         trav->surface = nullptr;
+        trav->resources.clear();
         return false;
     }
     if (style.first == Validity::Indeterminate || features.first == Validity::Indeterminate)
         return false;
 
-    std::shared_ptr<GeodataTile> geo = map->getGeodata(geoName + "#tile");
+    if (!geo)
+    {
+        geo = map->getGeodata(geoName + "#tile");
+        trav->resources.push_back(geo);
+    }
     geo->updatePriority(trav->priority);
-    geo->update(style.second, features.second, map->mapconfig->browserOptions.value, trav->meta->aabbPhys, trav->id);
+    // monolithic geodata have no coarser tiles to fall back to
+    const double texelSize = trav->layer->freeLayer->type == vtslibs::registry::FreeLayer::Type::geodataTiles ? trav->meta->texelSize : inf1();
+    geo->update(style.second, features.second, parsedFeatures, map->mapconfig->browserOptions.value, trav->meta->aabbPhys, trav->id, texelSize);
     switch (map->getResourceValidity(geo))
     {
     case Validity::Invalid:
         trav->surface = nullptr;
+        trav->resources.clear();
         return false;
     case Validity::Indeterminate:
         return false;
@@ -424,6 +724,9 @@ bool CameraImpl::travDetermineDrawsGeodata(TraverseNode *trav)
         break;
     }
 
+    // the draws keep the tile alive
+    trav->resources.clear();
+
     // determined
     assert(!trav->determined);
     assert(trav->rendersEmpty());
@@ -459,13 +762,16 @@ bool CameraImpl::travInit(TraverseNode *trav)
             if (it)
                 map->touchResource(it);
         }
-        return travDetermineMeta(trav);
+        if (!travDetermineMeta(trav))
+            return false;
+        map->metaNodesEpoch++;
     }
 
     return true;
 }
 
-void CameraImpl::travModeHierarchical(TraverseNode *trav, bool loadOnly)
+template<uint32 F, bool LoadOnly>
+void CameraImpl::travModeHierarchical(TraverseNode *trav)
 {
     if (!travInit(trav))
         return;
@@ -475,7 +781,7 @@ void CameraImpl::travModeHierarchical(TraverseNode *trav, bool loadOnly)
 
     travDetermineDraws(trav);
 
-    if (loadOnly)
+    if (LoadOnly)
         return;
 
     if (!visibilityTest(trav))
@@ -484,7 +790,7 @@ void CameraImpl::travModeHierarchical(TraverseNode *trav, bool loadOnly)
     if (coarsenessTest(trav) || trav->childs.empty())
     {
         if (trav->determined)
-            renderNode(trav);
+            renderNode<F>(trav);
         return;
     }
 
@@ -501,12 +807,18 @@ void CameraImpl::travModeHierarchical(TraverseNode *trav, bool loadOnly)
     }
 
     for (auto &t : trav->childs)
-        travModeHierarchical(&t, !ok);
+    {
+        if (ok)
+            travModeHierarchical<F, false>(&t);
+        else
+            travModeHierarchical<F, true>(&t);
+    }
 
     if (!ok && trav->determined)
-        renderNode(trav);
+        renderNode<F>(trav);
 }
 
+template<uint32 F>
 void CameraImpl::travModeFlat(TraverseNode *trav)
 {
     if (!travInit(trav))
@@ -518,20 +830,21 @@ void CameraImpl::travModeFlat(TraverseNode *trav)
     if (coarsenessTest(trav) || trav->childs.empty())
     {
         if (travDetermineDraws(trav))
-            renderNode(trav);
+            renderNode<F>(trav);
         return;
     }
 
     for (auto &t : trav->childs)
-        travModeFlat(&t);
+        travModeFlat<F>(&t);
 }
 
-// mode == 0 -> default
-// mode == 1 -> load only -> returns true if loaded
-// mode == 2 -> render only
-bool CameraImpl::travModeStable(TraverseNode *trav, int mode)
+// Mode == 0 -> default
+// Mode == 1 -> load only -> returns true if loaded
+// Mode == 2 -> render only
+template<uint32 F, int Mode>
+bool CameraImpl::travModeStable(TraverseNode *trav)
 {
-    if (mode == 2)
+    if (Mode == 2)
     {
         if (!trav->meta)
             return false;
@@ -546,42 +859,42 @@ bool CameraImpl::travModeStable(TraverseNode *trav, int mode)
     if (!visibilityTest(trav))
         return true;
 
-    if (mode == 2)
+    if (Mode == 2)
     {
         if (trav->determined)
         {
             touchDraws(trav);
-            renderNode(trav);
+            renderNode<F>(trav);
         }
         else for (auto &t : trav->childs)
-            travModeStable(&t, 2);
+            travModeStable<F, 2>(&t);
         return true;
     }
 
     if (coarsenessTest(trav) || trav->childs.empty())
     {
         travDetermineDraws(trav);
-        if (mode == 1)
+        if (Mode == 1)
         {
             trav->lastRenderTime = map->renderTickIndex;
             return trav->determined;
         }
         if (trav->determined)
-            renderNode(trav);
+            renderNode<F>(trav);
         else for (auto &t : trav->childs)
-            travModeStable(&t, 2);
+            travModeStable<F, 2>(&t);
         return true;
     }
 
-    if (mode == 0 && trav->determined)
+    if (Mode == 0 && trav->determined)
     {
         bool ok = true;
         for (auto &t : trav->childs)
-            ok = travModeStable(&t, 1) && ok;
+            ok = travModeStable<F, 1>(&t) && ok;
         if (!ok)
         {
             touchDraws(trav);
-            renderNode(trav);
+            renderNode<F>(trav);
             return true;
         }
     }
@@ -589,14 +902,37 @@ bool CameraImpl::travModeStable(TraverseNode *trav, int mode)
     {
         bool ok = true;
         for (auto &t : trav->childs)
-            ok = travModeStable(&t, mode) && ok;
+            ok = travModeStable<F, Mode>(&t) && ok;
         return ok;
     }
 }
 
-bool CameraImpl::travModeBalanced(TraverseNode *trav, bool renderOnly)
+bool CameraImpl::travBudget(TraverseNode *trav)
+{
+    if (options.traversalBudget == 0
+        || statistics.metaNodesTraversedTotal < options.traversalBudget)
+        return true;
+
+    // the node (and its subtree) will be refined in following frames
+    trav->lastAccessTime = map->renderTickIndex;
+    statistics.nodesSkippedByBudget++;
+    return false;
+}
+
+uint32 CameraImpl::travChildsOffset(TraverseNode *trav)
+{
+    // when the budget is exceeded, the children are visited
+    //   in rotating order so that all subtrees get refined eventually
+    const uint32 n = trav->childs.size();
+    if (!traversalBudgetHit || n == 0)
+        return 0;
+    return (map->renderTickIndex + trav->id.lod) % n;
+}
+
+template<uint32 F, bool RenderOnly>
+bool CameraImpl::travModeBalanced(TraverseNode *trav)
 {
-    if (renderOnly)
+    if (RenderOnly)
     {
         if (!trav->meta)
             return false;
@@ -604,19 +940,19 @@ bool CameraImpl::travModeBalanced(TraverseNode *trav, bool renderOnly)
     }
     else
     {
-        if (!travInit(trav))
+        if (!travBudget(trav) || !travInit(trav))
             return false;
     }
 
     if (!visibilityTest(trav))
         return true;
 
-    if (renderOnly)
+    if (RenderOnly)
     {
         if (trav->determined)
         {
             touchDraws(trav);
-            renderNode(trav);
+            renderNode<F>(trav);
             return true;
         }
     }
@@ -625,33 +961,43 @@ bool CameraImpl::travModeBalanced(TraverseNode *trav, bool renderOnly)
         gridPreloadRequest(trav);
         if (travDetermineDraws(trav))
         {
-            renderNode(trav);
+            renderNode<F>(trav);
             return true;
         }
-        renderOnly = true;
+        return travModeBalancedChilds<F, true>(trav);
     }
 
+    return travModeBalancedChilds<F, RenderOnly>(trav);
+}
+
+template<uint32 F, bool RenderOnly>
+bool CameraImpl::travModeBalancedChilds(TraverseNode *trav)
+{
+    TraverseNode *childs = trav->childs.begin();
+    const uint32 n = trav->childs.size();
+    const uint32 off = travChildsOffset(trav);
     Array<bool, 4> oks;
-    oks.resize(trav->childs.size());
-    uint32 i = 0, okc = 0;
-    for (auto &it : trav->childs)
+    oks.resize(n);
+    uint32 okc = 0;
+    for (uint32 j = 0; j < n; j++)
     {
-        bool ok = travModeBalanced(&it, renderOnly);
-        oks[i++] = ok;
+        const uint32 i = (j + off) % n;
+        bool ok = travModeBalanced<F, RenderOnly>(childs + i);
+        oks[i] = ok;
         if (ok)
             okc++;
     }
-    if (okc == 0 && renderOnly)
+    if (okc == 0 && RenderOnly)
         return false;
-    i = 0;
-    for (auto &it : trav->childs)
+    for (uint32 i = 0; i < n; i++)
     {
-        if (!oks[i++])
-            renderNodeCoarser(&it);
+        if (!oks[i])
+            renderNodeCoarser<F>(childs + i);
     }
     return true;
 }
 
+template<uint32 F>
 void CameraImpl::travModeFixed(TraverseNode *trav)
 {
     if (!travInit(trav))
@@ -663,34 +1009,171 @@ void CameraImpl::travModeFixed(TraverseNode *trav)
     if (trav->id.lod >= options.fixedTraversalLod || trav->childs.empty())
     {
         if (travDetermineDraws(trav))
-            renderNode(trav);
+            renderNode<F>(trav);
         return;
     }
 
     for (auto &t : trav->childs)
-        travModeFixed(&t);
+        travModeFixed<F>(&t);
 }
 
-void CameraImpl::traverseRender(TraverseNode *trav)
+template<uint32 F>
+void CameraImpl::travModeCoherent(TraverseNode *trav,
+    std::vector<TraverseNode*> &frontier)
+{
+    if (!travBudget(trav) || !travInit(trav))
+    {
+        frontier.push_back(trav);
+        renderNodeCoarser<F>(trav);
+        return;
+    }
+
+    if (!visibilityTest(trav))
+    {
+        frontier.push_back(trav);
+        return;
+    }
+
+    if (coarsenessTest(trav) || trav->childs.empty())
+    {
+        frontier.push_back(trav);
+        gridPreloadRequest(trav);
+        if (travDetermineDraws(trav))
+            renderNode<F>(trav);
+        else if (!travModeBalanced<F, true>(trav))
+            renderNodeCoarser<F>(trav);
+        return;
+    }
+
+    TraverseNode *childs = trav->childs.begin();
+    const uint32 n = trav->childs.size();
+    const uint32 off = travChildsOffset(trav);
+    for (uint32 j = 0; j < n; j++)
+        travModeCoherent<F>(childs + (j + off) % n, frontier);
+}
+
+template<uint32 F>
+void CameraImpl::travModeCoherent(TraverseNode *root, CameraMapLayer &layer)
+{
+    const uint32 tick = map->renderTickIndex;
+    FrameVector<TraverseNode*> cut(frameArena);
+
+    // the nodes of the previous cut may have been cleared in the meantime
+    //   if the camera was not rendered for several frames
+    const double jump = options.coherentTraversalJump
+            * length(vec3(cameraPosPhys - focusPosPhys));
+    if (layer.coherentFrontier.empty()
+        || layer.coherentTick + 4 < tick
+        || length(vec3(cameraPosPhys - layer.coherentEye)) > jump
+        || length(vec3(forwardUnitVector - layer.coherentForward))
+            > options.coherentTraversalJump)
+    {
+        cut.push_back(root);
+    }
+    else
+    {
+        // coarsen: replace nodes with their parents
+        //   while the parent is invisible or fine enough
+        const uint32 n = layer.coherentFrontier.size();
+        FrameMap<TraverseNode*, bool> merges(n, frameArena);
+        FrameSet<TraverseNode*> unique(n, frameArena);
+        FrameVector<TraverseNode*> coarsened(frameArena);
+        coarsened.reserve(n);
+        for (TraverseNode *t : layer.coherentFrontier)
+        {
+            while (t->parent)
+            {
+                auto it = merges.find(t->parent);
+                if (it == merges.end())
+                {
+                    TraverseNode *p = t->parent;
+                    bool m = !visibilityTest(p) || coarsenessTest(p);
+                    it = merges.emplace(p, m).first;
+                }
+                if (!it->second)
+                    break;
+                t = t->parent;
+            }
+            if (unique.insert(t).second)
+                coarsened.push_back(t);
+        }
+
+        // remove nodes already covered by a coarser node
+        cut.reserve(coarsened.size());
+        for (TraverseNode *t : coarsened)
+        {
+            bool covered = false;
+            for (TraverseNode *p = t->parent; p && !covered; p = p->parent)
+                covered = unique.count(p) > 0;
+            if (!covered)
+                cut.push_back(t);
+        }
+
+        // the inner nodes are not visited by the refinement
+        //   but they must survive the clearing
+        for (TraverseNode *t : cut)
+        {
+            for (TraverseNode *p = t->parent;
+                p && p->lastAccessTime != tick; p = p->parent)
+                p->lastAccessTime = tick;
+        }
+    }
+
+    // refine
+    layer.coherentFrontier.clear();
+    for (TraverseNode *t : cut)
+        travModeCoherent<F>(t, layer.coherentFrontier);
+    layer.coherentEye = cameraPosPhys;
+    layer.coherentForward = forwardUnitVector;
+    layer.coherentTick = tick;
+}
+
+template<uint32 F>
+void CameraImpl::traverseRender(TraverseNode *trav, CameraMapLayer &layer)
 {
     switch (trav->layer->isGeodata() ? options.traverseModeGeodata : options.traverseModeSurfaces)
     {
     case TraverseMode::None:
         break;
     case TraverseMode::Flat:
-        travModeFlat(trav);
+        travModeFlat<F>(trav);
         break;
     case TraverseMode::Stable:
-        travModeStable(trav, 0);
+        travModeStable<F, 0>(trav);
         break;
     case TraverseMode::Balanced:
-        travModeBalanced(trav, false);
+        travModeBalanced<F, false>(trav);
         break;
     case TraverseMode::Hierarchical:
-        travModeHierarchical(trav, false);
+        travModeHierarchical<F, false>(trav);
         break;
     case TraverseMode::Fixed:
-        travModeFixed(trav);
+        travModeFixed<F>(trav);
+        break;
+    case TraverseMode::Coherent:
+        travModeCoherent<F>(trav, layer);
+        break;
+    default:
+        assert(false);
+    }
+}
+
+// picks the kernel for the current options once per layer
+void CameraImpl::traverseRender(TraverseNode *trav, CameraMapLayer &layer)
+{
+    switch (travFeatures())
+    {
+    case 0:
+        traverseRender<0>(trav, layer);
+        break;
+    case TravDebug:
+        traverseRender<TravDebug>(trav, layer);
+        break;
+    case TravBlending:
+        traverseRender<TravBlending>(trav, layer);
+        break;
+    case TravDebug | TravBlending:
+        traverseRender<TravDebug | TravBlending>(trav, layer);
         break;
     default:
         assert(false);
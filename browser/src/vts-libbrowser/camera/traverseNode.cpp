@@ -29,26 +29,157 @@
 #include "../renderTasks.hpp"
 #include "../hashTileId.hpp"
 #include "../geodata.hpp"
+#include "../mapLayer.hpp"
+#include "../renderInfos.hpp"
 
 namespace vts
 {
 
+std::unique_ptr<TraverseChildsArray, TraverseChildsDeleter>
+    TraverseChildsPool::acquire()
+{
+    if (available.empty())
+    {
+        blocks.push_back(std::make_unique<Block>());
+        Block &b = *blocks.back();
+        available.reserve(blocks.size() * BlockSize);
+        for (uint32 i = BlockSize; i-- > 0; )
+            available.push_back(&b[i]);
+    }
+    TraverseChildsArray *a = available.back();
+    available.pop_back();
+    assert(a->arr.empty());
+    return std::unique_ptr<TraverseChildsArray, TraverseChildsDeleter>(
+        a, TraverseChildsDeleter{ this });
+}
+
+void TraverseChildsPool::release(TraverseChildsArray *a)
+{
+    // destroying the children releases their own arrays recursively
+    a->arr.reset();
+    available.push_back(a);
+}
+
+uint64 TraverseChildsPool::memoryCost() const
+{
+    return blocks.size() * sizeof(Block)
+        + available.capacity() * sizeof(TraverseChildsArray *);
+}
+
+TraverseNodeIndex::TraverseNodeIndex()
+{
+    slots.resize(1024);
+}
+
+uint32 TraverseNodeIndex::slot(const TileId &id) const
+{
+    uint64 h = (uint64(id.lod) << 58) ^ (uint64(id.x) << 29) ^ uint64(id.y);
+    h *= 0x9E3779B97F4A7C15ull;
+    return uint32(h >> 32) & (slots.size() - 1);
+}
+
+void TraverseNodeIndex::rehash(uint32 capacity)
+{
+    std::vector<TraverseNode *> old;
+    old.swap(slots);
+    slots.resize(capacity);
+    count = 0;
+    for (TraverseNode *n : old)
+        if (n)
+            insert(n);
+}
+
+void TraverseNodeIndex::insert(TraverseNode *node)
+{
+    // keep the load factor at most one half
+    if ((count + 1) * 2 > slots.size())
+        rehash(slots.size() * 2);
+    const uint32 mask = slots.size() - 1;
+    uint32 i = slot(node->id);
+    while (slots[i])
+    {
+        assert(slots[i] != node);
+        i = (i + 1) & mask;
+    }
+    slots[i] = node;
+    count++;
+}
+
+void TraverseNodeIndex::erase(TraverseNode *node)
+{
+    const uint32 mask = slots.size() - 1;
+    uint32 i = slot(node->id);
+    while (slots[i] != node)
+    {
+        assert(slots[i]);
+        i = (i + 1) & mask;
+    }
+
+    // backward shift the following entries
+    //   so that no tombstones are needed
+    uint32 j = i;
+    while (true)
+    {
+        j = (j + 1) & mask;
+        TraverseNode *n = slots[j];
+        if (!n)
+            break;
+        uint32 k = slot(n->id);
+        // move the entry only if its home slot is not in (i, j]
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+        slots[i] = n;
+        i = j;
+    }
+    slots[i] = nullptr;
+    count--;
+}
+
+uint64 TraverseNodeIndex::memoryCost() const
+{
+    return slots.capacity() * sizeof(TraverseNode *)
+        + (uint64)count * sizeof(TraverseNode);
+}
+
+TraverseNode *TraverseNodeIndex::find(const TileId &id) const
+{
+    const uint32 mask = slots.size() - 1;
+    uint32 i = slot(id);
+    while (TraverseNode *n = slots[i])
+    {
+        if (n->id == id)
+            return n;
+        i = (i + 1) & mask;
+    }
+    return nullptr;
+}
+
 TraverseNode::TraverseNode()
 {}
 
 TraverseNode::TraverseNode(const MapLayer *layer, TraverseNode *parent,
     const TileId &id) : layer(layer), parent(parent), id(id)
-{}
+{
+    if (layer)
+        layer->traverseIndex->insert(this);
+}
 
 TraverseNode::~TraverseNode()
-{}
+{
+    if (layer)
+        layer->traverseIndex->erase(this);
+}
 
 void TraverseNode::clearAll()
 {
     childs.ptr.reset();
     metaTiles.clear();
     meta.reset();
+    coarsenessEpoch = 0;
     surface = nullptr;
+    geodataFeatures.reset();
+    resourceName.clear();
+    boundResolved.clear();
     credits.clear();
     clearRenders();
 }
@@ -56,6 +187,7 @@ void TraverseNode::clearAll()
 void TraverseNode::clearRenders()
 {
     resources.clear();
+    resourcesChanged.reset();
     opaque.clear();
     transparent.clear();
     geodata.clear();
@@ -59,6 +59,11 @@ public:
     vec3 convert(const vec3 &value, const std::string &from, Srs to);
     vec3 convert(const vec3 &value, Srs from, const std::string &to);
 
+    // converts count points, three doubles each
+    //   the convertor is looked up once for the whole array
+    // in and out may point to the same array
+    void convert(const double *in, double *out, std::size_t count, Srs from, Srs to);
+
     vec3 geoDirect(const vec3 &position, double distance, double azimuthIn, double &azimuthOut);
     vec3 geoDirect(const vec3 &position, double distance, double azimuthIn);
     void geoInverse(const vec3 &posA, const vec3 &posB, double &distance, double &azimuthA, double &azimuthB);
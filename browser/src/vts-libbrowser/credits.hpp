@@ -34,6 +34,13 @@
 namespace vts
 {
 
+// the credits last published into one CameraCredits
+struct CreditsRanking
+{
+    std::vector<uint32> order[2]; // dense indices, per scope
+    uint32 epoch = 0;
+};
+
 class Credits : private Immovable
 {
 public:
@@ -48,23 +55,42 @@ public:
     boost::optional<vtslibs::registry::CreditId> find(const std::string &name) const;
     void hit(Scope scope, vtslibs::registry::CreditId id, uint32 lod);
     std::string findId(vtslibs::registry::CreditId id) const;
-    void tick(CameraCredits &credits);
+    // ranks the hits collected since the last tick and publishes them
+    void tick(CameraCredits &credits, CreditsRanking &ranking);
+    // publishes the result of the last tick again (for other cameras)
+    void publish(CameraCredits &credits, CreditsRanking &ranking) const;
     void merge(vtslibs::registry::RegistryBase *reg);
     void merge(vtslibs::registry::Credit credit);
     void purge();
 
 private:
     vtslibs::registry::Credit::dict stor;
-    
-    struct Hit
+
+    // the credits are indexed densely as they are merged
+    //   so that the hits are accumulated in plain arrays
+    struct Entry
     {
-        Hit(vtslibs::registry::CreditId id);
+        std::string notice;
+        std::string url;
+    };
+    std::vector<Entry> entries;
+    std::vector<uint32> denseIndices; // indexed by credit id
 
-        vtslibs::registry::CreditId id;
-        uint32 hits = 0;
-        uint32 maxLod = 0;
+    struct Ranked
+    {
+        uint32 index;
+        uint32 hits;
+        uint32 maxLod;
+    };
+    struct Hits
+    {
+        std::vector<uint32> hits; // indexed by dense index
+        std::vector<uint32> maxLod;
+        std::vector<uint32> touched; // dense indices with non-zero hits
+        std::vector<Ranked> ranked; // result of the last tick
     };
-    std::vector<Hit> hits[(int)Scope::Total_];
+    Hits hits[(int)Scope::Total_];
+    uint32 epoch = 1; // changes with the strings of the entries
 };
 
 } // namespace vts
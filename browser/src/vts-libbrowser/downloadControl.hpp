@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef DOWNLOADCONTROL_HPP_ds5f4g6h8j
+#define DOWNLOADCONTROL_HPP_ds5f4g6h8j
+
+#include <memory>
+#include <string>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+
+#include "include/vts-browser/foundation.hpp"
+
+namespace vts
+{
+
+class Resource;
+
+// adapts the number of concurrent downloads for each host
+// the window grows additively while the replies arrive in time
+//   and shrinks multiplicatively on errors and when the latency inflates
+// a host that keeps failing is blocked for a backoff period
+//   its postponed resources wait and only one probe download is made
+//   after the period, the backoff doubles each time the probe fails
+class DownloadControl : private Immovable
+{
+public:
+    // initial and maximum window size; maximum of zero disables the adaptation
+    void configure(uint32 initial, uint32 maximum);
+
+    // consecutive failures that block a host, zero disables the blocking
+    // backoff in seconds
+    void configureBackoff(uint32 failures, double initial, double maximum);
+
+    // returns true if a download from the host may start now
+    // otherwise the resource is postponed until a download from the host finishes
+    bool acquire(const std::string &host, const std::weak_ptr<Resource> &r);
+
+    // report a finished download
+    // durationMs is negative for cancelled downloads
+    // postponed resources that may continue are appended to wake
+    void release(const std::string &host, double durationMs, uint32 code,
+        std::vector<std::weak_ptr<Resource>> &wake);
+
+    // releases the probes of the hosts whose backoff has elapsed
+    void update(std::vector<std::weak_ptr<Resource>> &wake);
+
+    // sum of the windows of all hosts
+    uint32 totalWindow();
+
+    // number of hosts currently blocked
+    uint32 blockedHosts();
+
+    static std::string hostOf(const std::string &url);
+
+private:
+    struct Host
+    {
+        std::deque<std::weak_ptr<Resource>> postponed;
+        double window = 0;
+        double minRtt = 0; // milliseconds
+        double smoothRtt = 0; // milliseconds
+        double sinceDecrease = 0; // milliseconds since last decrease
+        uint32 inFlight = 0;
+        uint32 failures = 0; // consecutive
+        double backoff = 0; // seconds, zero while the host is healthy
+        std::chrono::steady_clock::time_point blockedUntil;
+        bool probing = false;
+    };
+
+    Host &host(const std::string &name);
+    bool blocked(const Host &h) const;
+    void wakeHost(Host &h, std::vector<std::weak_ptr<Resource>> &wake);
+
+    std::unordered_map<std::string, Host> hosts;
+    std::mutex mut;
+    uint32 initial = 25;
+    uint32 maximum = 0;
+    uint32 backoffFailures = 5;
+    double backoffInitial = 2;
+    double backoffMaximum = 60;
+};
+
+} // namespace vts
+
+#endif
@@ -29,6 +29,8 @@
 
 #include <memory>
 #include <string>
+#include <atomic>
+#include <chrono>
 
 #include "include/vts-browser/fetcher.hpp"
 
@@ -51,6 +53,21 @@ public:
     std::shared_ptr<void> availTest; // vtslibs::registry::BoundLayer::Availability
     std::weak_ptr<Resource> resource;
     uint32 redirectionsCount = 0;
+
+    // content of expired cache entry, reused if the server replies 304
+    Buffer staleContent;
+    std::string staleEtag;
+    std::string staleLastModified;
+
+    // used by the download control
+    std::string host;
+    std::atomic<uint32> urgency{ 0 }; // http priority of the running download
+    std::chrono::steady_clock::time_point fetchStart;
+
+    // set by either fetchDone or cancellation, whichever comes first
+    std::atomic<bool> finished{ false };
+    // the task was abandoned and must not be reused
+    std::atomic<bool> cancelled{ false };
 };
 
 } // namespace vts
@@ -25,8 +25,12 @@
  */
 
 #include "../include/vts-browser/fetcher.hpp"
+#include "recordReplay.hpp"
+#include "../utilities/json.hpp"
 
 #include <fstream>
+#include <unordered_map>
+#include <mutex>
 #include <http/http.hpp>
 #include <http/resourcefetcher.hpp>
 
@@ -51,6 +55,7 @@ public:
     const uint32 id;
     http::ResourceFetcher::Query query;
     std::shared_ptr<FetchTask> task;
+    std::atomic<bool> cancelled;
     bool called;
 };
 
@@ -64,16 +69,18 @@ public:
         if (options.extraFileLog)
         {
             extraLog.open("vts-browser-fetcher.log");
-            if (extraLog)
-                extraLog << time() << " starting_fetcher_log" << std::endl;
+            Json::Value v;
+            v["event"] = "start";
+            log(v);
         }
     }
 
     ~FetcherImpl()
     {
         assert(initCount == 0);
-        if (extraLog)
-            extraLog << time() << " finished_fetcher_log" << std::endl;
+        Json::Value v;
+        v["event"] = "finish";
+        log(v);
     }
 
     virtual void initialize() override
@@ -102,15 +109,51 @@ public:
         assert(initCount > 0);
         assert(task->reply.code == 0);
         auto t = std::make_shared<Task>(this, task);
+        {
+            std::lock_guard<std::mutex> lock(tasksMutex);
+            tasks[task.get()] = t;
+        }
         fetcher.perform(t->query, std::bind(&Task::done, t,
                                             std::placeholders::_1));
         if (extraLog)
         {
-            extraLog << t->begin << " init " << t->id
-                     << " " << task->query.url << std::endl;
+            Json::Value v;
+            v["event"] = "init";
+            v["id"] = t->id;
+            v["url"] = task->query.url;
+            v["resourceType"] = (int)task->query.resourceType;
+            log(v);
         }
     }
 
+    // one json object per line
+    void log(Json::Value &v)
+    {
+        if (!extraLog)
+            return;
+        v["time"] = (Json::UInt64)time();
+        Json::StreamWriterBuilder b;
+        b["indentation"] = "";
+        std::lock_guard<std::mutex> lock(logMutex);
+        extraLog << Json::writeString(b, v) << std::endl;
+    }
+
+    void cancel(const std::shared_ptr<FetchTask> &task) override
+    {
+        // the http library cannot abort a running query,
+        //   the downloaded content is discarded instead
+        std::shared_ptr<Task> t;
+        {
+            std::lock_guard<std::mutex> lock(tasksMutex);
+            auto it = tasks.find(task.get());
+            if (it == tasks.end())
+                return;
+            t = it->second.lock();
+        }
+        if (t)
+            t->cancelled = true;
+    }
+
     uint64 time()
     {
         auto now = std::chrono::high_resolution_clock::now();
@@ -124,12 +167,15 @@ public:
     std::atomic<int> initCount;
     std::atomic<uint32> taskId;
     std::ofstream extraLog;
+    std::mutex logMutex;
+    std::unordered_map<FetchTask*, std::weak_ptr<Task>> tasks;
+    std::mutex tasksMutex;
     std::chrono::high_resolution_clock::time_point begin;
 };
 
 Task::Task(FetcherImpl *impl, const std::shared_ptr<FetchTask> &task)
     : begin(impl->time()), impl(impl), id(impl->taskId++),
-      query(task->query.url), task(task), called(false)
+      query(task->query.url), task(task), cancelled(false), called(false)
 {
     query.timeout(impl->options.timeout);
     for (auto it : task->query.headers)
@@ -155,7 +201,11 @@ void Task::done(utility::ResourceFetcher::MultiQuery &&queries)
     assert(queries.size() == 1);
     assert(task->reply.code == 0);
     http::ResourceFetcher::Query &q = *queries.begin();
-    if (q.valid())
+    if (cancelled)
+    {
+        task->reply.code = FetchTask::ExtraCodes::Cancelled;
+    }
+    else if (q.valid())
     {
         const http::ResourceFetcher::Query::Body &body = q.get();
         if (body.redirect)
@@ -218,12 +268,34 @@ void Task::finish()
 {
     assert(!called);
     called = true;
+    {
+        std::lock_guard<std::mutex> lock(impl->tasksMutex);
+        impl->tasks.erase(task.get());
+    }
     if (impl->extraLog)
     {
-        impl->extraLog << 
-            impl->time() << " done " << id << " " << (impl->time() - begin)
-            << " " << task->reply.code << " " << task->reply.content.size()
-            << " " << task->reply.contentType << std::endl;
+        const FetchTask::Reply &r = task->reply;
+        Json::Value v;
+        v["event"] = "done";
+        v["id"] = id;
+        v["duration"] = (Json::UInt64)(impl->time() - begin);
+        v["code"] = r.code;
+        v["size"] = r.content.size();
+        v["contentType"] = r.contentType;
+        v["resourceType"] = (int)task->query.resourceType;
+        if (r.timeDns >= 0)
+            v["dns"] = r.timeDns;
+        if (r.timeConnect >= 0)
+            v["connect"] = r.timeConnect;
+        if (r.timeTls >= 0)
+            v["tls"] = r.timeTls;
+        if (r.timeFirstByte >= 0)
+            v["firstByte"] = r.timeFirstByte;
+        if (r.timeTransfer >= 0)
+            v["transfer"] = r.timeTransfer;
+        if (!r.httpVersion.empty())
+            v["httpVersion"] = r.httpVersion;
+        impl->log(v);
     }
     task->fetchDone();
 }
@@ -232,8 +304,8 @@ void Task::finish()
 
 std::shared_ptr<Fetcher> Fetcher::create(const FetcherOptions &options)
 {
-    return std::dynamic_pointer_cast<Fetcher>(
-                std::make_shared<FetcherImpl>(options));
+    return createSimulator(options, recordReplayFetcher(options,
+        std::make_shared<FetcherImpl>(options)));
 }
 
 } // namespace vts
@@ -25,25 +25,51 @@
  */
 
 #include "../include/vts-browser/fetcher.hpp"
+#include "recordReplay.hpp"
 
 #import <Foundation/Foundation.h>
 
+#include <mutex>
+#include <unordered_map>
+#include <cmath>
+#include <algorithm>
+
 namespace vts
 {
 
 namespace
 {
 
+// map the resource priority into the range 0 .. 1
+float taskPriority(float priority)
+{
+    if (std::isinf(priority) && priority > 0)
+        return NSURLSessionTaskPriorityHigh;
+    if (std::isnan(priority) || priority <= 0)
+        return NSURLSessionTaskPriorityLow;
+    return std::min(std::log10(priority + 1) / 7, 1.f);
+}
+
 class FetcherImpl : public Fetcher
 {
 public:
     NSURLSession *session;
+    NSOperationQueue *queue;
+    std::unordered_map<FetchTask*, NSURLSessionDataTask*> running;
+    std::mutex runningMutex;
 
     void completed(const std::shared_ptr<FetchTask> &task, NSData *data, NSHTTPURLResponse *response)
     {
         task->reply.contentType = [response.MIMEType UTF8String];
         task->reply.code = response.statusCode;
         task->reply.expires = -2;
+        NSDictionary *headers = response.allHeaderFields;
+        NSString *etag = headers[@"ETag"];
+        if (etag)
+            task->reply.etag = [etag UTF8String];
+        NSString *lastModified = headers[@"Last-Modified"];
+        if (lastModified)
+            task->reply.lastModified = [lastModified UTF8String];
         task->reply.content.allocate([data length]);
         memcpy(task->reply.content.data(), [data bytes], [data length]);
     }
@@ -53,10 +79,33 @@ public:
         std::shared_ptr<FetchTask> task = task_;
         NSString *urlString = [NSString stringWithCString:task->query.url.c_str() encoding:NSUTF8StringEncoding];
         urlString = [urlString stringByAddingPercentEncodingWithAllowedCharacters: NSCharacterSet.URLQueryAllowedCharacterSet];
-            NSURL *url = [NSURL URLWithString:urlString];
-        [[session dataTaskWithURL:url completionHandler:^(NSData *data, NSURLResponse *response, NSError *error)
+        NSURL *url = [NSURL URLWithString:urlString];
+        NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url];
+        for (const auto &it : task->query.headers)
+        {
+            [request setValue:[NSString stringWithUTF8String:it.second.c_str()]
+                forHTTPHeaderField:[NSString stringWithUTF8String:it.first.c_str()]];
+        }
+        NSURLSessionDataTask *dataTask = [session dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error)
         {
-            if (error)
+            {
+                std::lock_guard<std::mutex> lock(runningMutex);
+                auto it = running.find(task.get());
+                if (it != running.end())
+                {
+                    [it->second release];
+                    running.erase(it);
+                }
+            }
+            if (error && error.code == NSURLErrorCancelled)
+            {
+                task->reply.code = FetchTask::ExtraCodes::Cancelled;
+            }
+            else if (error && error.code == NSURLErrorTimedOut)
+            {
+                task->reply.code = FetchTask::ExtraCodes::Timeout;
+            }
+            else if (error)
             {
                 task->reply.code = FetchTask::ExtraCodes::InternalError;
             }
@@ -66,13 +115,56 @@ public:
                 completed(task, data, (NSHTTPURLResponse*)response);
             }
             task->fetchDone();
-        }] resume];
+        }];
+        dataTask.priority = taskPriority(task->query.priority);
+        {
+            std::lock_guard<std::mutex> lock(runningMutex);
+            running[task.get()] = [dataTask retain];
+        }
+        [dataTask resume];
+    }
+
+    virtual void updatePriority(const std::shared_ptr<FetchTask> &task, float priority)
+    {
+        std::lock_guard<std::mutex> lock(runningMutex);
+        auto it = running.find(task.get());
+        if (it != running.end())
+            it->second.priority = taskPriority(priority);
+    }
+
+    virtual void cancel(const std::shared_ptr<FetchTask> &task)
+    {
+        std::lock_guard<std::mutex> lock(runningMutex);
+        auto it = running.find(task.get());
+        if (it != running.end())
+            [it->second cancel];
     }
 
     FetcherImpl(const FetcherOptions &options)
     {
         NSURLSessionConfiguration *config = [NSURLSessionConfiguration defaultSessionConfiguration];
-        session = [NSURLSession sessionWithConfiguration:config];
+        if (options.timeout > 0)
+        {
+            config.timeoutIntervalForRequest = options.timeout * 1e-3;
+            config.timeoutIntervalForResource = options.timeout * 1e-3;
+        }
+        if (options.maxHostConnections > 0)
+            config.HTTPMaximumConnectionsPerHost = options.maxHostConnections;
+        // http/2 is negotiated by the system whenever the server supports it
+        config.HTTPShouldUsePipelining = options.pipelining == 1
+            || options.pipelining == 3;
+        // the browser has its own disk cache
+        config.requestCachePolicy = NSURLRequestReloadIgnoringLocalCacheData;
+        config.URLCache = nil;
+
+        // the completion handlers call fetchDone directly from this queue
+        queue = [[NSOperationQueue alloc] init];
+        queue.name = @"vts-fetcher";
+        queue.qualityOfService = NSQualityOfServiceUserInitiated;
+        queue.maxConcurrentOperationCount = std::max<uint32>(options.threads, 1);
+
+        session = [NSURLSession sessionWithConfiguration:config
+            delegate:nil delegateQueue:queue];
         [session retain];
     }
 
@@ -80,6 +172,7 @@ public:
     {
         [session invalidateAndCancel];
         [session release];
+        [queue release];
     }
 };
 
@@ -87,8 +180,8 @@ public:
 
 std::shared_ptr<Fetcher> Fetcher::create(const FetcherOptions &options)
 {
-    return std::dynamic_pointer_cast<Fetcher>(
-                std::make_shared<FetcherImpl>(options));
+    return createSimulator(options, recordReplayFetcher(options,
+        std::make_shared<FetcherImpl>(options)));
 }
 
 } // namespace vts
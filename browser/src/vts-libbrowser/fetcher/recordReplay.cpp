@@ -0,0 +1,497 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "recordReplay.hpp"
+#include "../utilities/threadName.hpp"
+
+#include <dbglog/dbglog.hpp>
+
+#include <unordered_map>
+#include <condition_variable>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <queue>
+#include <chrono>
+#include <ctime>
+#include <cstring>
+
+namespace vts
+{
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+static const char ArchiveMagic[16] = "vtsfetcharchive";
+static const uint16 ArchiveVersion = 1;
+
+// one download stored in the archive
+struct Record
+{
+    std::string url;
+    std::string contentType;
+    std::string redirectUrl;
+    std::string etag;
+    std::string lastModified;
+    std::string httpVersion;
+    Buffer content;
+    sint64 expires = -1;
+    sint64 downloaded = 0; // time of the download, see std::time
+    uint32 resourceType = 0;
+    uint32 code = 0;
+    float latency = 0; // milliseconds
+};
+
+template<class T>
+void writeValue(std::ostream &s, const T &v)
+{
+    s.write((const char *)&v, sizeof(T));
+}
+
+void writeString(std::ostream &s, const std::string &v)
+{
+    writeValue(s, (uint32)v.size());
+    s.write(v.data(), v.size());
+}
+
+template<class T>
+void readValue(std::istream &s, T &v)
+{
+    s.read((char *)&v, sizeof(T));
+}
+
+void readString(std::istream &s, std::string &v)
+{
+    uint32 size = 0;
+    readValue(s, size);
+    if (!s)
+        return;
+    v.resize(size);
+    s.read(&v[0], size);
+}
+
+// the content is passed separately to avoid copying it
+void writeRecord(std::ostream &s, const Record &r, const Buffer &content)
+{
+    writeString(s, r.url);
+    writeString(s, r.contentType);
+    writeString(s, r.redirectUrl);
+    writeString(s, r.etag);
+    writeString(s, r.lastModified);
+    writeString(s, r.httpVersion);
+    writeValue(s, r.expires);
+    writeValue(s, r.downloaded);
+    writeValue(s, r.resourceType);
+    writeValue(s, r.code);
+    writeValue(s, r.latency);
+    writeValue(s, (uint32)content.size());
+    s.write(content.data(), content.size());
+}
+
+bool readRecord(std::istream &s, Record &r)
+{
+    readString(s, r.url);
+    if (!s)
+        return false; // end of the archive
+    readString(s, r.contentType);
+    readString(s, r.redirectUrl);
+    readString(s, r.etag);
+    readString(s, r.lastModified);
+    readString(s, r.httpVersion);
+    readValue(s, r.expires);
+    readValue(s, r.downloaded);
+    readValue(s, r.resourceType);
+    readValue(s, r.code);
+    readValue(s, r.latency);
+    uint32 size = 0;
+    readValue(s, size);
+    if (!s)
+        LOGTHROW(err3, std::runtime_error) << "Truncated fetch archive";
+    r.content = Buffer(size);
+    s.read(r.content.data(), size);
+    if (!s)
+        LOGTHROW(err3, std::runtime_error) << "Truncated fetch archive";
+    return true;
+}
+
+class RecordingFetcher;
+
+// forwards the download to the platform fetcher
+//   and passes the reply back to the browser once it is recorded
+class RecordingTask : public FetchTask
+{
+public:
+    RecordingTask(RecordingFetcher *fetcher,
+        const std::shared_ptr<FetchTask> &task)
+        : FetchTask(task->query), fetcher(fetcher), task(task),
+        begin(Clock::now())
+    {}
+
+    void fetchDone() override;
+
+    RecordingFetcher *const fetcher;
+    const std::shared_ptr<FetchTask> task;
+    const Clock::time_point begin;
+};
+
+class RecordingFetcher : public Fetcher
+{
+public:
+    RecordingFetcher(const std::string &path,
+        const std::shared_ptr<Fetcher> &fetcher)
+        : path(path), fetcher(fetcher)
+    {
+        archive.open(path, std::ios::binary | std::ios::trunc);
+        if (!archive)
+        {
+            LOGTHROW(err3, std::runtime_error)
+                << "Failed to create fetch archive <" << path << ">";
+        }
+        archive.write(ArchiveMagic, sizeof(ArchiveMagic));
+        writeValue(archive, ArchiveVersion);
+        LOG(info3) << "Recording downloads into <" << path << ">";
+    }
+
+    ~RecordingFetcher()
+    {
+        archive.close();
+        LOG(info3) << "Recorded " << recorded
+            << " downloads into <" << path << ">";
+    }
+
+    void initialize() override
+    {
+        fetcher->initialize();
+    }
+
+    void finalize() override
+    {
+        fetcher->finalize();
+        std::lock_guard<std::mutex> lock(archiveMutex);
+        archive.flush();
+    }
+
+    void update() override
+    {
+        fetcher->update();
+    }
+
+    void fetch(const std::shared_ptr<FetchTask> &task) override
+    {
+        auto t = std::make_shared<RecordingTask>(this, task);
+        {
+            std::lock_guard<std::mutex> lock(tasksMutex);
+            tasks[task.get()] = t;
+        }
+        fetcher->fetch(t);
+    }
+
+    void cancel(const std::shared_ptr<FetchTask> &task) override
+    {
+        std::shared_ptr<RecordingTask> t = find(task);
+        if (t)
+            fetcher->cancel(t);
+    }
+
+    void updatePriority(const std::shared_ptr<FetchTask> &task,
+        float priority) override
+    {
+        std::shared_ptr<RecordingTask> t = find(task);
+        if (t)
+        {
+            t->query.priority = priority;
+            fetcher->updatePriority(t, priority);
+        }
+    }
+
+    void done(RecordingTask *t)
+    {
+        const std::shared_ptr<FetchTask> task = t->task;
+        {
+            std::lock_guard<std::mutex> lock(tasksMutex);
+            tasks.erase(task.get());
+        }
+
+        // cancellations depend on the session and are not replayed
+        if (t->reply.code != FetchTask::ExtraCodes::Cancelled)
+        {
+            Record r;
+            r.url = t->query.url;
+            r.contentType = t->reply.contentType;
+            r.redirectUrl = t->reply.redirectUrl;
+            r.etag = t->reply.etag;
+            r.lastModified = t->reply.lastModified;
+            r.httpVersion = t->reply.httpVersion;
+            r.expires = t->reply.expires;
+            r.downloaded = std::time(nullptr);
+            r.resourceType = (uint32)t->query.resourceType;
+            r.code = t->reply.code;
+            r.latency = std::chrono::duration<float, std::milli>(
+                Clock::now() - t->begin).count();
+            std::lock_guard<std::mutex> lock(archiveMutex);
+            writeRecord(archive, r, t->reply.content);
+            recorded++;
+        }
+
+        task->reply = std::move(t->reply);
+        task->fetchDone();
+    }
+
+private:
+    std::shared_ptr<RecordingTask> find(const std::shared_ptr<FetchTask> &task)
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        auto it = tasks.find(task.get());
+        if (it == tasks.end())
+            return {};
+        return it->second.lock();
+    }
+
+    const std::string path;
+    const std::shared_ptr<Fetcher> fetcher;
+    std::unordered_map<FetchTask *, std::weak_ptr<RecordingTask>> tasks;
+    std::mutex tasksMutex;
+    std::ofstream archive;
+    std::mutex archiveMutex;
+    uint32 recorded = 0;
+};
+
+void RecordingTask::fetchDone()
+{
+    fetcher->done(this);
+}
+
+// answers all downloads from the archive, without network access
+//   the replies are delivered from a separate thread,
+//   optionally after the latencies measured while recording
+class ReplayFetcher : public Fetcher
+{
+public:
+    ReplayFetcher(const std::string &path, bool timings)
+        : timings(timings)
+    {
+        std::ifstream s(path, std::ios::binary);
+        char magic[sizeof(ArchiveMagic)] = {};
+        uint16 version = 0;
+        s.read(magic, sizeof(magic));
+        readValue(s, version);
+        if (!s || memcmp(magic, ArchiveMagic, sizeof(magic)) != 0)
+        {
+            LOGTHROW(err3, std::runtime_error)
+                << "Invalid fetch archive <" << path << ">";
+        }
+        if (version != ArchiveVersion)
+        {
+            LOGTHROW(err3, std::runtime_error)
+                << "Unsupported fetch archive <" << path
+                << "> version <" << version << ">";
+        }
+        uint32 count = 0;
+        while (true)
+        {
+            auto r = std::make_shared<Record>();
+            if (!readRecord(s, *r))
+                break;
+            // repeated downloads of the same url are replayed in order
+            records[r->url].entries.push_back(r);
+            count++;
+        }
+        LOG(info3) << "Replaying " << count << " downloads from <"
+            << path << ">";
+    }
+
+    ~ReplayFetcher()
+    {
+        assert(!thread.joinable());
+    }
+
+    void initialize() override
+    {
+        if (initCount++ == 0)
+        {
+            stop = false;
+            thread = std::thread(&ReplayFetcher::entry, this);
+        }
+    }
+
+    void finalize() override
+    {
+        if (--initCount == 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                stop = true;
+            }
+            con.notify_all();
+            thread.join();
+        }
+    }
+
+    void fetch(const std::shared_ptr<FetchTask> &task) override
+    {
+        std::shared_ptr<const Record> r;
+        Pending p;
+        p.task = task;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            auto it = records.find(task->query.url);
+            if (it != records.end())
+            {
+                Url &u = it->second;
+                r = u.entries[std::min<std::size_t>(u.next++,
+                    u.entries.size() - 1)];
+            }
+            p.record = r;
+            p.due = Clock::now();
+            if (timings && r)
+                p.due += std::chrono::microseconds(
+                    (sint64)(r->latency * 1000));
+            p.order = order++;
+            pending[task.get()] = false;
+            queue.push(std::move(p));
+        }
+        con.notify_all();
+    }
+
+    void cancel(const std::shared_ptr<FetchTask> &task) override
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        auto it = pending.find(task.get());
+        if (it != pending.end())
+            it->second = true;
+    }
+
+private:
+    struct Url
+    {
+        std::vector<std::shared_ptr<const Record>> entries;
+        std::size_t next = 0;
+    };
+
+    struct Pending
+    {
+        std::shared_ptr<FetchTask> task;
+        std::shared_ptr<const Record> record;
+        Clock::time_point due;
+        uint64 order = 0;
+
+        bool operator < (const Pending &other) const
+        {
+            // reversed for the priority queue
+            if (due != other.due)
+                return due > other.due;
+            return order > other.order;
+        }
+    };
+
+    void entry()
+    {
+        setThreadName("fetch replay");
+        std::unique_lock<std::mutex> lock(mut);
+        while (!stop)
+        {
+            if (queue.empty())
+            {
+                con.wait(lock);
+                continue;
+            }
+            const auto due = queue.top().due;
+            if (due > Clock::now())
+            {
+                con.wait_until(lock, due);
+                continue;
+            }
+            Pending p = queue.top();
+            queue.pop();
+            const bool cancelled = pending[p.task.get()];
+            pending.erase(p.task.get());
+            lock.unlock();
+            reply(p, cancelled);
+            lock.lock();
+        }
+    }
+
+    static void reply(const Pending &p, bool cancelled)
+    {
+        FetchTask::Reply &reply = p.task->reply;
+        const Record *r = p.record.get();
+        if (cancelled)
+            reply.code = FetchTask::ExtraCodes::Cancelled;
+        else if (!r)
+        {
+            LOG(warn2) << "Download <" << p.task->query.url
+                << "> is missing in the fetch archive";
+            reply.code = 404;
+        }
+        else
+        {
+            reply.content = r->content.copy();
+            reply.contentType = r->contentType;
+            reply.redirectUrl = r->redirectUrl;
+            reply.etag = r->etag;
+            reply.lastModified = r->lastModified;
+            reply.httpVersion = r->httpVersion;
+            reply.code = r->code;
+            // keep the same lifetime relative to the download
+            reply.expires = r->expires;
+            if (r->expires >= 0)
+                reply.expires += std::time(nullptr) - r->downloaded;
+        }
+        p.task->fetchDone();
+    }
+
+    const bool timings;
+    std::unordered_map<std::string, Url> records;
+    std::priority_queue<Pending> queue;
+    std::unordered_map<FetchTask *, bool> pending; // value = cancelled
+    std::mutex mut;
+    std::condition_variable con;
+    std::thread thread;
+    std::atomic<int> initCount{ 0 };
+    uint64 order = 0;
+    bool stop = false;
+};
+
+} // namespace
+
+std::shared_ptr<Fetcher> recordReplayFetcher(const FetcherOptions &options,
+    const std::shared_ptr<Fetcher> &fetcher)
+{
+    if (!options.replayArchive.empty())
+        return std::make_shared<ReplayFetcher>(options.replayArchive,
+            options.replayTimings);
+    if (!options.recordArchive.empty())
+        return std::make_shared<RecordingFetcher>(options.recordArchive,
+            fetcher);
+    return fetcher;
+}
+
+} // namespace vts
@@ -0,0 +1,434 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/fetcher.hpp"
+#include "../utilities/threadName.hpp"
+
+#include <dbglog/dbglog.hpp>
+
+#include <unordered_map>
+#include <condition_variable>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <limits>
+#include <list>
+
+namespace vts
+{
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+class SimulatorFetcher;
+
+// forwards the download to the wrapped fetcher
+//   and hands the reply over to the simulator
+class SimulatorTask : public FetchTask
+{
+public:
+    SimulatorTask(SimulatorFetcher *fetcher,
+        const std::shared_ptr<FetchTask> &task)
+        : FetchTask(task->query), fetcher(fetcher), task(task)
+    {}
+
+    void fetchDone() override;
+
+    SimulatorFetcher *const fetcher;
+    const std::shared_ptr<FetchTask> task;
+};
+
+// delays the replies of the wrapped fetcher
+//   first by the latency of each download
+//   and then by the transfer of the content,
+//   the bandwidth is divided equally among all transfers in progress
+class SimulatorFetcher : public Fetcher
+{
+public:
+    SimulatorFetcher(const FetcherOptions &options,
+        const std::shared_ptr<Fetcher> &fetcher)
+        : options(options), fetcher(fetcher),
+        random(std::random_device()())
+    {
+        if (options.simulatedLatencyDistribution != "normal"
+            && options.simulatedLatencyDistribution != "uniform"
+            && options.simulatedLatencyDistribution != "exponential")
+        {
+            LOGTHROW(err3, std::invalid_argument)
+                << "Invalid simulated latency distribution <"
+                << options.simulatedLatencyDistribution << ">";
+        }
+        LOG(info3) << "Simulating network conditions, latency: "
+            << options.simulatedLatency << " ms, jitter: "
+            << options.simulatedJitter << " ms ("
+            << options.simulatedLatencyDistribution << "), bandwidth: "
+            << options.simulatedBandwidth << " KB/s, loss rate: "
+            << options.simulatedLossRate << ", error rate: "
+            << options.simulatedErrorRate;
+    }
+
+    ~SimulatorFetcher()
+    {
+        assert(!thread.joinable());
+    }
+
+    void initialize() override
+    {
+        fetcher->initialize();
+        if (initCount++ == 0)
+        {
+            stop = false;
+            thread = std::thread(&SimulatorFetcher::entry, this);
+        }
+    }
+
+    void finalize() override
+    {
+        fetcher->finalize();
+        if (--initCount == 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                stop = true;
+            }
+            con.notify_all();
+            thread.join();
+
+            // every task must still finish exactly once
+            std::list<Entry> remaining;
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                remaining.swap(entries);
+            }
+            for (Entry &e : remaining)
+            {
+                e.task->reply.content.free();
+                e.task->reply.code = FetchTask::ExtraCodes::Cancelled;
+                e.task->fetchDone();
+            }
+        }
+    }
+
+    void update() override
+    {
+        fetcher->update();
+    }
+
+    void fetch(const std::shared_ptr<FetchTask> &task) override
+    {
+        auto t = std::make_shared<SimulatorTask>(this, task);
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            tasks[task.get()] = t;
+        }
+        fetcher->fetch(t);
+    }
+
+    void cancel(const std::shared_ptr<FetchTask> &task) override
+    {
+        std::shared_ptr<SimulatorTask> t;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            auto it = tasks.find(task.get());
+            if (it != tasks.end())
+                t = it->second.lock();
+            else
+            {
+                for (Entry &e : entries)
+                    if (e.task == task)
+                        e.cancelled = true;
+            }
+        }
+        if (t)
+            fetcher->cancel(t);
+        else
+            con.notify_all();
+    }
+
+    void updatePriority(const std::shared_ptr<FetchTask> &task,
+        float priority) override
+    {
+        std::shared_ptr<SimulatorTask> t;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            auto it = tasks.find(task.get());
+            if (it != tasks.end())
+                t = it->second.lock();
+        }
+        if (t)
+        {
+            t->query.priority = priority;
+            fetcher->updatePriority(t, priority);
+        }
+    }
+
+    // the wrapped fetcher has finished the download
+    void arrived(SimulatorTask *t)
+    {
+        const std::shared_ptr<FetchTask> task = t->task;
+        task->reply = std::move(t->reply);
+        if (task->reply.code == FetchTask::ExtraCodes::Cancelled)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                tasks.erase(task.get());
+            }
+            task->fetchDone();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            tasks.erase(task.get());
+            Entry e;
+            e.task = task;
+            const Clock::time_point now = Clock::now();
+            if (chance(options.simulatedLossRate))
+            {
+                // nothing comes back until the timeout
+                e.lost = true;
+                e.due = now + std::chrono::milliseconds(
+                    options.timeout > 0 ? options.timeout : 30000);
+            }
+            else
+            {
+                if (chance(options.simulatedErrorRate))
+                {
+                    task->reply.content.free();
+                    task->reply.code = FetchTask::ExtraCodes::SimulatedError;
+                }
+                e.latency = latency();
+                e.due = now + std::chrono::microseconds(
+                    (sint64)(e.latency * 1000));
+                e.remaining = task->reply.content.size();
+            }
+            entries.push_back(std::move(e));
+        }
+        con.notify_all();
+    }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<FetchTask> task;
+        Clock::time_point due; // end of the latency
+        Clock::time_point transferStart;
+        double remaining = 0; // bytes to transfer
+        double latency = 0; // milliseconds
+        bool transferring = false;
+        bool lost = false;
+        bool cancelled = false;
+    };
+
+    // requires the mutex
+    bool chance(double rate)
+    {
+        if (rate <= 0)
+            return false;
+        return std::uniform_real_distribution<double>(0, 1)(random) < rate;
+    }
+
+    // requires the mutex
+    double latency()
+    {
+        const double l = options.simulatedLatency;
+        const double j = options.simulatedJitter;
+        if (j <= 0)
+            return std::max(l, 0.0);
+        const std::string &d = options.simulatedLatencyDistribution;
+        double r = l;
+        if (d == "uniform")
+            r = std::uniform_real_distribution<double>(l - j, l + j)(random);
+        else if (d == "exponential")
+            r = l + std::exponential_distribution<double>(1 / j)(random);
+        else
+            r = std::normal_distribution<double>(l, j)(random);
+        return std::max(r, 0.0);
+    }
+
+    // the bandwidth is divided equally among the transfers,
+    //   the share of finished transfers goes to the rest
+    // requires the mutex
+    void advanceTransfers(double seconds)
+    {
+        double budget = options.simulatedBandwidth * 1024.0 * seconds;
+        while (budget > 0)
+        {
+            uint32 active = 0;
+            for (const Entry &e : entries)
+                if (e.transferring && e.remaining > 0)
+                    active++;
+            if (active == 0)
+                break;
+            const double share = budget / active;
+            for (Entry &e : entries)
+            {
+                if (!e.transferring || e.remaining <= 0)
+                    continue;
+                const double t = std::min(share, e.remaining);
+                e.remaining -= t;
+                budget -= t;
+            }
+            if (share < 1)
+                break; // less than a byte each
+        }
+    }
+
+    void entry()
+    {
+        setThreadName("fetch simulator");
+        std::unique_lock<std::mutex> lock(mut);
+        Clock::time_point last = Clock::now();
+        while (!stop)
+        {
+            const Clock::time_point now = Clock::now();
+            const bool limited = options.simulatedBandwidth > 0;
+            if (limited)
+                advanceTransfers(
+                    std::chrono::duration<double>(now - last).count());
+            last = now;
+
+            // collect the finished entries
+            std::list<Entry> finished;
+            Clock::time_point wake = Clock::time_point::max();
+            uint32 transfers = 0;
+            double smallest = std::numeric_limits<double>::infinity();
+            for (auto it = entries.begin(); it != entries.end(); )
+            {
+                Entry &e = *it;
+                if (!e.transferring && e.due <= now && !e.lost)
+                {
+                    e.transferring = true;
+                    e.transferStart = now;
+                }
+                const bool done = e.cancelled
+                    || (e.lost ? e.due <= now : (e.transferring
+                        && (!limited || e.remaining <= 0)));
+                if (done)
+                {
+                    auto next = std::next(it);
+                    finished.splice(finished.end(), entries, it);
+                    it = next;
+                    continue;
+                }
+                if (e.transferring)
+                {
+                    transfers++;
+                    smallest = std::min(smallest, e.remaining);
+                }
+                else
+                    wake = std::min(wake, e.due);
+                it++;
+            }
+            if (transfers > 0)
+            {
+                // the soonest transfer to finish, if nothing else changes
+                wake = std::min(wake, now + std::chrono::microseconds(
+                    (sint64)(smallest * transfers * 1e6
+                        / (options.simulatedBandwidth * 1024.0)) + 1));
+            }
+
+            if (!finished.empty())
+            {
+                lock.unlock();
+                for (Entry &e : finished)
+                    reply(e, now);
+                lock.lock();
+                continue;
+            }
+            if (wake == Clock::time_point::max())
+                con.wait(lock);
+            else
+                con.wait_until(lock, wake);
+        }
+    }
+
+    static void reply(Entry &e, Clock::time_point now)
+    {
+        FetchTask::Reply &reply = e.task->reply;
+        if (e.cancelled)
+        {
+            reply.content.free();
+            reply.code = FetchTask::ExtraCodes::Cancelled;
+        }
+        else if (e.lost)
+        {
+            reply.content.free();
+            reply.code = FetchTask::ExtraCodes::Timeout;
+        }
+        else
+        {
+            // the simulated network timings are added to the measured
+            const float transfer = std::chrono::duration<float, std::milli>(
+                now - e.transferStart).count();
+            reply.timeFirstByte = std::max(reply.timeFirstByte, 0.f)
+                + (float)e.latency;
+            reply.timeTransfer = std::max(reply.timeTransfer, 0.f)
+                + transfer;
+        }
+        e.task->fetchDone();
+    }
+
+    const FetcherOptions options;
+    const std::shared_ptr<Fetcher> fetcher;
+    std::unordered_map<FetchTask *, std::weak_ptr<SimulatorTask>> tasks;
+    std::list<Entry> entries; // finished by the wrapped fetcher
+    std::mt19937 random;
+    std::mutex mut;
+    std::condition_variable con;
+    std::thread thread;
+    std::atomic<int> initCount{ 0 };
+    bool stop = false;
+};
+
+void SimulatorTask::fetchDone()
+{
+    fetcher->arrived(this);
+}
+
+bool simulatorEnabled(const FetcherOptions &o)
+{
+    return o.simulatedLatency > 0 || o.simulatedJitter > 0
+        || o.simulatedBandwidth > 0 || o.simulatedLossRate > 0
+        || o.simulatedErrorRate > 0;
+}
+
+} // namespace
+
+std::shared_ptr<Fetcher> Fetcher::createSimulator(
+    const FetcherOptions &options, const std::shared_ptr<Fetcher> &fetcher)
+{
+    if (!simulatorEnabled(options))
+        return fetcher;
+    return std::make_shared<SimulatorFetcher>(options, fetcher);
+}
+
+} // namespace vts
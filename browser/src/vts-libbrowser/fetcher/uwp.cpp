@@ -25,6 +25,7 @@
  */
 
 #include "../include/vts-browser/fetcher.hpp"
+#include "recordReplay.hpp"
 
 #include <Windows.Foundation.h>
 #include <Windows.Web.Http.Headers.h>
@@ -32,6 +33,8 @@
 
 #include <stdexcept>
 #include <vector>
+#include <mutex>
+#include <unordered_map>
 
 using namespace Platform;
 using namespace Concurrency;
@@ -98,6 +101,17 @@ namespace
 class FetcherImpl : public Fetcher
 {
     HttpClient ^client;
+    std::unordered_map<FetchTask*, cancellation_token_source> running;
+    std::mutex runningMutex;
+
+    void done(const std::shared_ptr<FetchTask> &task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(runningMutex);
+            running.erase(task.get());
+        }
+        task->fetchDone();
+    }
 
 public:
     FetcherImpl(const FetcherOptions &options)
@@ -119,14 +133,23 @@ public:
         const std::shared_ptr<FetchTask> task = task_;
         try
         {
-            //auto headers{ client->DefaultRequestHeaders() };
-            //for (auto it : task->query.headers)
-            //    headers.Append(widen(it.first), widen(it.second));
-
             Uri ^requestUri = ref new Uri(widen(task->query.url));
-            create_task(client->GetAsync(requestUri))
+            HttpRequestMessage ^request = ref new HttpRequestMessage(HttpMethod::Get, requestUri);
+            for (const auto &it : task->query.headers)
+                request->Headers->TryAppendWithoutValidation(widen(it.first), widen(it.second));
+
+            cancellation_token_source cts;
+            {
+                std::lock_guard<std::mutex> lock(runningMutex);
+                running[task.get()] = cts;
+            }
+            create_task(client->SendRequestAsync(request), cts.get_token())
                 .then([=](HttpResponseMessage ^response) {
                     task->reply.code = (uint32)response->StatusCode;
+                    if (response->Headers->HasKey("ETag"))
+                        task->reply.etag = narrow(response->Headers->Lookup("ETag"));
+                    if (response->Content->Headers->HasKey("Last-Modified"))
+                        task->reply.lastModified = narrow(response->Content->Headers->Lookup("Last-Modified"));
                     IBuffer ^body = response->Content->ReadAsBufferAsync()->GetResults();
                     Array<unsigned char> ^array = nullptr;
                     CryptographicBuffer::CopyToByteArray(body, &array);
@@ -139,27 +162,39 @@ public:
                     {
                         t.get();
                     }
+                    catch (const task_canceled &)
+                    {
+                        task->reply.code = FetchTask::ExtraCodes::Cancelled;
+                    }
                     catch (...)
                     {
                         task->reply.code = FetchTask::ExtraCodes::InternalError;
                     }
-                    task->fetchDone();
+                    done(task);
                 });
         }
         catch (...)
         {
             task->reply.code = FetchTask::ExtraCodes::InternalError;
-            task->fetchDone();
+            done(task);
         }
     }
+
+    void cancel(const std::shared_ptr<FetchTask> &task) override
+    {
+        std::lock_guard<std::mutex> lock(runningMutex);
+        auto it = running.find(task.get());
+        if (it != running.end())
+            it->second.cancel();
+    }
 };
 
 } // namespace
 
 std::shared_ptr<Fetcher> Fetcher::create(const FetcherOptions &options)
 {
-    return std::dynamic_pointer_cast<Fetcher>(
-        std::make_shared<FetcherImpl>(options));
+    return createSimulator(options, recordReplayFetcher(options,
+        std::make_shared<FetcherImpl>(options)));
 }
 
 } // namespace vts
@@ -24,16 +24,18 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <stdio.h>
 #include <string.h>
+#include <strings.h>
+#include <stdlib.h>
 #include <emscripten/fetch.h>
+#include <emscripten/threading.h>
 
 #include "dbglog/dbglog.hpp"
 #include "../include/vts-browser/fetcher.hpp"
-#include "../utilities/threadQueue.hpp"
 
-#include <list>
-#include <thread>
+#include <string>
+#include <vector>
+#include <unordered_map>
 
 namespace vts
 {
@@ -41,105 +43,168 @@ namespace vts
 namespace
 {
 
+class FetcherImpl;
+
+// all requests are started, finished and cancelled on the main browser
+//   thread, which runs the event loop that invokes the callbacks
+// therefore no locking is needed and no threads are blocked
 class WasmTask
 {
+public:
+    WasmTask(FetcherImpl *impl, const std::shared_ptr<FetchTask> &task)
+        : task(task), impl(impl)
+    {}
+
+    void start(sint32 timeout);
+    void finish(emscripten_fetch_t *fetch);
+    void cancel();
+
     std::shared_ptr<FetchTask> task;
-    emscripten_fetch_t *fetch;
+    // flattened request headers, kept alive for the duration of the request
+    std::vector<std::string> headerStrings;
+    std::vector<const char *> headers;
+    FetcherImpl *const impl;
+    emscripten_fetch_t *fetch = nullptr;
+    bool cancelled = false;
+};
 
+class FetcherImpl : public Fetcher
+{
 public:
-    WasmTask(const std::shared_ptr<FetchTask> &task)
-        : task(task), fetch(nullptr)
+    FetcherImpl(const FetcherOptions &options) : options(options)
+    {}
+
+    void fetch(const std::shared_ptr<FetchTask> &task) override
     {
-        emscripten_fetch_attr_t attr;
-        emscripten_fetch_attr_init(&attr);
-        attr.userData = this;
-        strcpy(attr.requestMethod, "GET");
-        // todo attr.timeoutMSecs
-        // todo attr.requestHeaders
-        attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY
-                //| EMSCRIPTEN_FETCH_WAITABLE
-                | EMSCRIPTEN_FETCH_SYNCHRONOUS;
-        // waitable fetch is not yet implemented in emscripten for WASM
-        // use synchronous fetch as a temporary workaround
-        fetch = emscripten_fetch(&attr, task->query.url.c_str());
+        WasmTask *t = new WasmTask(this, task);
+        emscripten_async_run_in_main_runtime_thread(EM_FUNC_SIG_VI,
+            &FetcherImpl::startMain, t);
     }
 
-    ~WasmTask()
+    void cancel(const std::shared_ptr<FetchTask> &task) override
     {
-        task->fetchDone();
-        emscripten_fetch_close(fetch);
+        // the task is kept alive until the main thread handles it
+        auto *t = new std::shared_ptr<FetchTask>(task);
+        emscripten_async_run_in_main_runtime_thread(EM_FUNC_SIG_VII,
+            &FetcherImpl::cancelMain, this, t);
     }
 
-    WasmTask(const WasmTask &) = delete;
-    WasmTask &operator = (const WasmTask &) = delete;
-
-    bool update()
+    static void startMain(WasmTask *t)
     {
-        auto ret = emscripten_fetch_wait(fetch, 0);
-        if (ret == EMSCRIPTEN_RESULT_TIMED_OUT)
-            return false; // todo handle other error codes
-        task->reply.code = fetch->status;
-        task->reply.content.allocate(fetch->numBytes);
-        memcpy(task->reply.content.data(), fetch->data, fetch->numBytes);
-        return true;
+        t->impl->running[t->task.get()] = t;
+        t->start(t->impl->options.timeout);
     }
-};
-
-class FetcherImpl : public Fetcher
-{
-    //std::list<std::unique_ptr<WasmTask>> tasks;
-    ThreadQueue<std::shared_ptr<FetchTask>> que;
-    std::vector<std::thread> thrs;
 
-public:
-    FetcherImpl(const FetcherOptions &options)
+    static void cancelMain(FetcherImpl *impl, std::shared_ptr<FetchTask> *task)
     {
-        static const uint32 thrsCnt = 20;
-        thrs.reserve(thrsCnt);
-        for (uint32 i = 0; i < thrsCnt; i++)
-            thrs.push_back(std::thread(&FetcherImpl::thrEntry, this));
+        auto it = impl->running.find(task->get());
+        if (it != impl->running.end())
+            it->second->cancel();
+        delete task;
     }
 
-    void thrEntry()
+    static void onDone(emscripten_fetch_t *fetch)
     {
-        while (true)
-        {
-            std::shared_ptr<FetchTask> task;
-            if (!que.waitPop(task))
-                return;
-            auto t = std::make_unique<WasmTask>(task);
-            while (!t->update()) {}
-        }
+        WasmTask *t = (WasmTask*)fetch->userData;
+        t->finish(fetch);
     }
 
-    void finalize() override
+    const FetcherOptions options;
+    std::unordered_map<FetchTask*, WasmTask*> running; // main thread only
+};
+
+void WasmTask::start(sint32 timeout)
+{
+    headerStrings.reserve(task->query.headers.size() * 2);
+    for (const auto &it : task->query.headers)
+    {
+        headerStrings.push_back(it.first);
+        headerStrings.push_back(it.second);
+    }
+    for (const std::string &s : headerStrings)
+        headers.push_back(s.c_str());
+    headers.push_back(nullptr);
+
+    emscripten_fetch_attr_t attr;
+    emscripten_fetch_attr_init(&attr);
+    attr.userData = this;
+    strcpy(attr.requestMethod, "GET");
+    attr.requestHeaders = headers.data();
+    attr.timeoutMSecs = timeout > 0 ? timeout : 0;
+    attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY;
+    attr.onsuccess = &FetcherImpl::onDone;
+    attr.onerror = &FetcherImpl::onDone;
+    // without the synchronous flag, the callbacks are always deferred
+    //   and the task is still alive here
+    fetch = emscripten_fetch(&attr, task->query.url.c_str());
+    if (!fetch)
     {
-        //tasks.clear();
-        que.terminate();
-        for (auto &it : thrs)
-            it.join();
+        task->reply.code = FetchTask::ExtraCodes::InternalError;
+        finish(nullptr);
     }
+}
 
-    void update() override
+void WasmTask::finish(emscripten_fetch_t *f)
+{
+    impl->running.erase(task.get());
+    if (cancelled)
+        task->reply.code = FetchTask::ExtraCodes::Cancelled;
+    else if (f)
     {
-        /*
-        auto it = tasks.begin();
-        while (it != tasks.end())
+        task->reply.code = f->status ? f->status
+            : (uint32)FetchTask::ExtraCodes::InternalError;
+        if (f->status >= 200 && f->status < 300 && f->numBytes > 0)
+        {
+            // take over the memory allocated by the fetch, nothing is copied
+            char *data = (char*)f->data;
+            uint32 size = f->numBytes;
+            f->data = nullptr;
+            f->numBytes = 0;
+            task->reply.content = Buffer(std::shared_ptr<char>(data,
+                [](char *p) { ::free(p); }), data, size);
+        }
+        size_t len = emscripten_fetch_get_response_headers_length(f);
+        if (len > 0)
         {
-            if ((*it)->update())
-                it = tasks.erase(it);
-            else
-                it++;
+            std::vector<char> raw(len + 1);
+            emscripten_fetch_get_response_headers(f, raw.data(), raw.size());
+            char **hs = emscripten_fetch_unpack_response_headers(raw.data());
+            for (char **h = hs; h && h[0] && h[1]; h += 2)
+            {
+                if (strcasecmp(h[0], "content-type") == 0)
+                    task->reply.contentType = h[1];
+                else if (strcasecmp(h[0], "etag") == 0)
+                    task->reply.etag = h[1];
+                else if (strcasecmp(h[0], "last-modified") == 0)
+                    task->reply.lastModified = h[1];
+            }
+            emscripten_fetch_free_unpacked_response_headers(hs);
         }
-        */
     }
+    if (f && fetch)
+        emscripten_fetch_close(f); // not when closed by cancel
+    fetch = nullptr;
+    std::shared_ptr<FetchTask> tmp;
+    std::swap(tmp, task);
+    delete this;
+    tmp->fetchDone();
+}
 
-    void fetch(const std::shared_ptr<FetchTask> &task) override
-    {
-        //tasks.insert(tasks.end(), std::make_unique<WasmTask>(task));
-        que.push(task);
-    }
-};
+void WasmTask::cancel()
+{
+    if (cancelled || !fetch)
+        return;
+    cancelled = true;
+    emscripten_fetch_t *f = fetch;
+    fetch = nullptr;
+    FetcherImpl *i = impl;
+    FetchTask *key = task.get();
+    // closing an active fetch aborts it
+    //   and may invoke the onerror callback, which finishes the task
+    emscripten_fetch_close(f);
+    if (i->running.count(key))
+        finish(nullptr);
+}
 
 } // namespace
 
@@ -150,4 +215,3 @@ std::shared_ptr<Fetcher> Fetcher::create(const FetcherOptions &options)
 }
 
 } // namespace vts
-
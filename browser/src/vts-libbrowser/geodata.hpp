@@ -27,6 +27,9 @@
 #ifndef GEODATA_HPP_o84d6
 #define GEODATA_HPP_o84d6
 
+#include <set>
+#include <map>
+
 #include <vts-libs/registry/referenceframe.hpp>
 
 #include "include/vts-browser/math.hpp"
@@ -48,6 +51,21 @@ class GpuFont;
 class GpuTexture;
 class GpuGeodataSpec;
 
+// groups of features parsed once and shared by all tiles and styles
+struct GeodataParsedFeatures;
+
+std::shared_ptr<const GeodataParsedFeatures> parseGeodataFeatures(
+    const std::string &data, uint64 &memoryCost);
+
+// compact binary encoding of the features
+//   with quantized geometry and shared strings
+extern const char *const GeodataBinaryContentType;
+bool isGeodataBinary(const std::string &data);
+std::shared_ptr<const GeodataParsedFeatures> decodeGeodataBinary(
+    const std::string &data, uint64 &memoryCost);
+std::string encodeGeodataBinary(const std::string &json);
+std::string geodataBinaryToJson(const std::string &data);
+
 class GeodataFeatures : public Resource
 {
 public:
@@ -56,8 +74,29 @@ public:
     FetchTask::ResourceType resourceType() const override;
 
     std::shared_ptr<const std::string> data;
+    std::shared_ptr<const GeodataParsedFeatures> parsed; // may be null
+};
+
+// stylesheet prepared once for processing of all geodata tiles
+struct GeodataCompiledStyle
+{
+    // the stylesheet with resolved inheritance of layers
+    std::shared_ptr<const Json::Value> json;
+
+    // candidate layers for points, lines and polygons
+    std::vector<std::string> typedLayerNames[3];
+
+    // constants that do not depend on individual features
+    //   these are evaluated once per tile
+    std::set<std::string> tileConstants;
+
+    // hash of definition of each layer and everything the layer depends on
+    std::map<std::string, uint64> layerSignatures;
 };
 
+std::shared_ptr<const GeodataCompiledStyle> compileGeodataStyle(
+    const std::string &data);
+
 class GeodataStylesheet : public Resource
 {
 public:
@@ -67,11 +106,17 @@ public:
     FetchTask::ResourceType resourceType() const override;
 
     std::string data;
-    std::shared_ptr<const Json::Value> json;
+    std::shared_ptr<const GeodataCompiledStyle> compiled;
     std::map<std::string, std::shared_ptr<GpuFont>> fonts;
     std::map<std::string, std::shared_ptr<GpuTexture>> bitmaps;
     Validity dependenciesValidity = Validity::Indeterminate;
     bool dependenciesLoaded = false;
+
+    // the merged validity of the fonts and bitmaps
+    //   is evaluated again only when any of them changes
+    std::shared_ptr<std::atomic<bool>> dependenciesChanged
+        = std::make_shared<std::atomic<bool>>(true);
+    Validity dependenciesMerged = Validity::Indeterminate;
 };
 
 class GeodataTile : public Resource
@@ -82,20 +127,60 @@ public:
     void decode() override;
     void upload() override;
     bool requiresUpload() override { return true; }
+    bool uploadRemaining() const override { return uploadIndex > 0; }
+    uint32 decodedMemoryCost() const override;
     FetchTask::ResourceType resourceType() const override;
     void update(
         const std::shared_ptr<GeodataStylesheet> &style,
         const std::shared_ptr<const std::string> &features,
+        const std::shared_ptr<const GeodataParsedFeatures> &parsedFeatures,
         const std::shared_ptr<const Json::Value> &browserOptions,
-        const vec3 aabbPhys[2], const TileId &tileId);
+        const vec3 aabbPhys[2], const TileId &tileId,
+        double texelSize);
+
+    // results of individual style layers from previous decode
+    struct LayerCache
+    {
+        uint64 signature = 0;
+        std::vector<GpuGeodataSpec> specs;
+    };
 
     std::vector<ResourceInfo> renders;
     std::vector<GpuGeodataSpec> specsToUpload;
+    std::vector<ResourceInfo> rendersUploading; // replace renders with the last slice
+    uint32 uploadIndex = 0; // of the next spec to upload
+    std::map<std::string, LayerCache> layersCache;
+    uint64 layersCacheMemory = 0;
     std::shared_ptr<GeodataStylesheet> style;
     std::shared_ptr<const std::string> features;
+    std::shared_ptr<const GeodataParsedFeatures> parsedFeatures; // may be null
     std::shared_ptr<const Json::Value> browserOptions;
     vec3 aabbPhys[2];
     TileId tileId;
+    double texelSize; // inf -> no simplification
+};
+
+// quad-tree of virtual tiles over monolithic geodata
+//   the features are distributed into the leafs by their centers
+//   the inner nodes have no features of their own
+class GeodataPartition : public Resource
+{
+public:
+    struct Node
+    {
+        vec3 aabbPhys[2];
+        std::shared_ptr<const std::string> features; // leafs only
+        bool childs[4] = { false, false, false, false };
+    };
+
+    GeodataPartition(MapImpl *map, const std::string &name);
+    void decode() override;
+    FetchTask::ResourceType resourceType() const override;
+    void update(const std::shared_ptr<const std::string> &features);
+    const Node *find(const TileId &tileId) const;
+
+    std::shared_ptr<const std::string> features;
+    std::map<TileId, Node> nodes;
 };
 
 } // namespace vts
@@ -32,6 +32,7 @@
 
 #include <boost/container/small_vector.hpp>
 #include <vector>
+#include <mutex>
 
 namespace vtslibs { namespace vts {
 struct SubMesh;
@@ -40,6 +41,8 @@ struct SubMesh;
 namespace vts
 {
 
+class CollisionMesh;
+
 class GpuMesh : public Resource
 {
 public:
@@ -48,21 +51,84 @@ public:
     void decode() override;
     void upload() override;
     bool requiresUpload() override { return true; }
+    uint32 decodedMemoryCost() const override;
     FetchTask::ResourceType resourceType() const override;
+    std::shared_ptr<const CollisionMesh> collision; // normalized coordinates
     uint32 faces = 0;
+    // indices of the triangles touching each quarter of the external uv
+    //   placed after the indices of the whole mesh
+    //   zero counts if not available, see MapRuntimeOptions::subtileIndexRanges
+    uint32 quarterOffsets[4] = {};
+    uint32 quarterCounts[4] = {};
 };
 
 class GpuTexture : public Resource
 {
 public:
     GpuTexture(MapImpl *map, const std::string &name);
+    ~GpuTexture();
     void decode() override;
     void upload() override;
     bool requiresUpload() override { return true; }
+    void upgrade() override;
+    uint32 decodedMemoryCost() const override;
     FetchTask::ResourceType resourceType() const override;
     GpuTextureSpec::FilterMode filterMode = GpuTextureSpec::FilterMode::Linear;
     GpuTextureSpec::WrapMode wrapMode = GpuTextureSpec::WrapMode::ClampToEdge;
     uint32 width = 0, height = 0;
+    bool tileTexture = false;
+
+protected:
+    // applied to the freshly decoded image, before mipmaps
+    virtual void foldMask(GpuTextureSpec &spec) {}
+    bool masked = false; // the content depends on another resource
+
+private:
+    // progressive loading, see MapRuntimeOptions::progressiveTextures
+    Buffer progressiveContent; // kept for the full resolution decode
+    ResourceInfo upgradeInfo;
+    uint32 upgradeWidth = 0, upgradeHeight = 0;
+    // the preview may still be referenced by draws
+    std::shared_ptr<void> previewUserData;
+    // content deduplication, see MapRuntimeOptions::deduplicateTextures
+    std::shared_ptr<void> duplicateUserData; // found on decode, used on upload
+    uint64 contentHash = 0;
+    uint32 contentSize = 0;
+};
+
+// bound layer mask decoded for folding into the alpha of a color texture
+//   it is never uploaded, see MapRuntimeOptions::combineMaskTextures
+class TextureMask : public Resource
+{
+public:
+    TextureMask(MapImpl *map, const std::string &name);
+    void decode() override;
+    FetchTask::ResourceType resourceType() const override;
+    std::string fetchUrl() const override;
+    static std::string nameOf(const std::string &maskUrl);
+
+    Buffer buffer; // single channel, bottom-up rows
+    uint32 width = 0, height = 0;
+};
+
+// color texture of a bound layer tile with its mask in the alpha channel
+class GpuMaskedTexture : public GpuTexture
+{
+public:
+    GpuMaskedTexture(MapImpl *map, const std::string &name);
+    std::string fetchUrl() const override;
+    static std::string nameOf(const std::string &colorUrl,
+        const std::string &maskUrl);
+
+    // set by the traversal, the mask must be ready before the decode
+    void setMask(const std::shared_ptr<TextureMask> &mask);
+
+protected:
+    void foldMask(GpuTextureSpec &spec) override;
+
+private:
+    std::weak_ptr<TextureMask> mask;
+    std::mutex maskMutex;
 };
 
 class GpuAtmosphereDensityTexture : public GpuTexture
@@ -70,6 +136,9 @@ class GpuAtmosphereDensityTexture : public GpuTexture
 public:
     GpuAtmosphereDensityTexture(MapImpl *map, const std::string &name);
     void decode() override;
+
+    // freshly generated texture skips the png decode
+    std::shared_ptr<GpuTextureSpec> generated;
 };
 
 class GpuFont : public Resource
@@ -79,6 +148,7 @@ public:
     void decode() override;
     void upload() override;
     bool requiresUpload() override { return true; }
+    uint32 decodedMemoryCost() const override;
     FetchTask::ResourceType resourceType() const override;
 };
 
@@ -86,6 +156,8 @@ class MeshPart
 {
 public:
     std::shared_ptr<GpuMesh> renderable;
+    std::shared_ptr<GpuMesh> collider; // simplified, see MapRuntimeOptions::colliderSimplification
+    std::string internalTextureName; // expanded by the traversal on first use
     mat4 normToPhys;
     uint32 textureLayer = 0;
     uint32 surfaceReference = 0;
@@ -100,6 +172,7 @@ public:
     void decode() override;
     void upload() override;
     bool requiresUpload() override { return true; }
+    uint32 decodedMemoryCost() const override;
     FetchTask::ResourceType resourceType() const override;
 
     boost::container::small_vector<MeshPart, 1> submeshes;
@@ -27,6 +27,17 @@
 #ifndef HASHTILEID_HPP_yxf4rt7uq
 #define HASHTILEID_HPP_yxf4rt7uq
 
+#include <functional>
+
+#include <vts-libs/registry/referenceframe.hpp>
+
+namespace vts
+{
+
+using TileId = vtslibs::registry::ReferenceFrame::Division::Node::Id;
+
+} // namespace vts
+
 namespace std
 {
 
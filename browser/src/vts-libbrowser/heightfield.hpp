@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HEIGHTFIELD_HPP_g8w2qz5m
+#define HEIGHTFIELD_HPP_g8w2qz5m
+
+#include <memory>
+
+#include "include/vts-browser/math.hpp"
+
+namespace vts
+{
+
+class MapImpl;
+class CameraImpl;
+
+// dedicated cache of the surface samples for altitude queries
+//   the internal camera loads the meta nodes on its own
+//   regardless of what is rendered
+// resolved samples are kept until they are evicted by the memory budget
+//   (MapRuntimeOptions::heightfieldMemoryKB)
+//   even after the traverse nodes they came from are cleared
+class Heightfield
+{
+public:
+    explicit Heightfield(MapImpl *map);
+
+    bool getSurfaceOverEllipsoid(double &result, const vec3 &navPos,
+        double sampleSize, bool *complete);
+
+    // evicts the least recently used samples, once per render update
+    void update();
+    void purge();
+    uint32 memoryCost() const;
+
+private:
+    std::shared_ptr<CameraImpl> camera;
+    MapImpl *const map = nullptr;
+};
+
+} // namespace vts
+
+#endif
@@ -34,24 +34,36 @@
 namespace vts
 {
 
+namespace
+{
+
+const unsigned char jpegSignature[] = { 0xFF, 0xD8, 0xFF };
+
+} // namespace
+
+bool isJpeg(const Buffer &in)
+{
+    return in.size() >= sizeof(jpegSignature)
+        && memcmp(in.data(), jpegSignature, sizeof(jpegSignature)) == 0;
+}
+
 void decodeImage(const Buffer &in, Buffer &out,
-                 uint32 &width, uint32 &height, uint32 &components)
+                 uint32 &width, uint32 &height, uint32 &components,
+                 bool flipVertically)
 {
     if (in.size() < 8)
         LOGTHROW(err1, std::runtime_error) << "insufficient image data";
     static const unsigned char pngSignature[]
             = { 137, 80, 78, 71, 13, 10, 26, 10 };
-    static const unsigned char jpegSignature[]
-        = { 0xFF, 0xD8, 0xFF };
     if (memcmp(in.data(), pngSignature, sizeof(pngSignature)) == 0)
     {
         OPTICK_EVENT("decode png");
-        decodePng(in, out, width, height, components);
+        decodePng(in, out, width, height, components, flipVertically);
     }
-    else if (memcmp(in.data(), jpegSignature, sizeof(jpegSignature)) == 0)
+    else if (isJpeg(in))
     {
         OPTICK_EVENT("decode jpeg");
-        decodeJpeg(in, out, width, height, components);
+        decodeJpeg(in, out, width, height, components, flipVertically);
     }
     else
     {
@@ -61,7 +73,18 @@ void decodeImage(const Buffer &in, Buffer &out,
         width = height = std::sqrt(in.size() / components);
         if (in.size() != width * height * components)
             LOGTHROW(err1, std::runtime_error) << "Raw image is not square";
-        out = in.copy();
+        if (flipVertically)
+        {
+            uint32 lineSize = width * components;
+            out = Buffer(in.size());
+            for (uint32 y = 0; y < height; y++)
+            {
+                memcpy(out.data() + (height - y - 1) * lineSize,
+                    in.data() + y * lineSize, lineSize);
+            }
+        }
+        else
+            out = in.copy();
     }
 }
 
@@ -27,19 +27,44 @@
 #ifndef IMAGE_H_erweubdnu
 #define IMAGE_H_erweubdnu
 
+#include <vector>
+
 #include "../include/vts-browser/buffer.hpp"
 
 namespace vts
 {
 
+// flipVertically stores the rows bottom-up (as expected by OpenGL)
+//   the rows are written directly to their final place in the out buffer
+
 void decodePng(const Buffer &in, Buffer &out,
-               uint32 &width, uint32 &height, uint32 &components);
+               uint32 &width, uint32 &height, uint32 &components,
+               bool flipVertically = false);
 
 void decodeJpeg(const Buffer &in, Buffer &out,
-                uint32 &width, uint32 &height, uint32 &components);
+                uint32 &width, uint32 &height, uint32 &components,
+                bool flipVertically = false);
+
+// downscaled by the decoder (1/8 at most, keeping at least 64 pixels)
+// returns the downscale factor, 1 if the image is too small
+uint32 decodeJpegPreview(const Buffer &in, Buffer &out,
+                uint32 &width, uint32 &height, uint32 &components,
+                bool flipVertically = false);
 
 void decodeImage(const Buffer &in, Buffer &out,
-                 uint32 &width, uint32 &height, uint32 &components);
+                 uint32 &width, uint32 &height, uint32 &components,
+                 bool flipVertically = false);
+
+bool isJpeg(const Buffer &in);
+
+// ktx2 container with precompressed mipmap levels
+// the levels are copied into out, starting with the largest
+// supercompressed payloads (eg. basis) are not supported
+bool isKtx2(const Buffer &in);
+
+void decodeKtx2(const Buffer &in, Buffer &out,
+                uint32 &width, uint32 &height, uint32 &components,
+                uint32 &internalFormat, std::vector<uint32> &levels);
 
 void encodePng(const Buffer &in, Buffer &out,
                uint32 width, uint32 height, uint32 components);
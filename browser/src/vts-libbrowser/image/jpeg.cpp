@@ -26,9 +26,12 @@
 
 #include "../include/vts-browser/buffer.hpp"
 
+#include <vector>
 #include <stdio.h> // needed for jpeglib
 #include <jpeglib.h>
 #include <dbglog/dbglog.hpp>
+#include <optick.h>
+#include <algorithm>
 
 namespace vts
 {
@@ -45,10 +48,9 @@ void jpegErrFunc(j_common_ptr cinfo)
             << jpegLastErrorMsg << ">";
 }
 
-} // namespace
-
-void decodeJpeg(const Buffer &in, Buffer &out,
-                uint32 &width, uint32 &height, uint32 &components)
+uint32 decodeJpegScaled(const Buffer &in, Buffer &out,
+                uint32 &width, uint32 &height, uint32 &components,
+                bool flipVertically, uint32 scale)
 {
     jpeg_decompress_struct info;
     jpeg_error_mgr errmgr;
@@ -59,18 +61,28 @@ void decodeJpeg(const Buffer &in, Buffer &out,
         jpeg_create_decompress(&info);
         jpeg_mem_src(&info, (unsigned char*)in.data(), in.size());
         jpeg_read_header(&info, TRUE);
+        while (scale > 1 && std::min(info.image_width,
+            info.image_height) / scale < 64)
+            scale /= 2;
+        info.scale_num = 1;
+        info.scale_denom = scale;
         jpeg_start_decompress(&info);
         width = info.output_width;
         height = info.output_height;
         components = info.num_components;
         uint32 lineSize = components * width;
         out = Buffer(lineSize * height);
+        std::vector<JSAMPROW> rows(height);
+        for (uint32 y = 0; y < height; y++)
+        {
+            uint32 r = flipVertically ? height - y - 1 : y;
+            rows[y] = (JSAMPROW)out.data() + lineSize * r;
+        }
+        // let the decoder output as many rows at once as it can
         while (info.output_scanline < info.output_height)
         {
-            unsigned char *ptr[1];
-            ptr[0] = (unsigned char*)out.data()
-                    + lineSize * info.output_scanline;
-            jpeg_read_scanlines(&info, ptr, 1);
+            jpeg_read_scanlines(&info, rows.data() + info.output_scanline,
+                info.output_height - info.output_scanline);
         }
         jpeg_finish_decompress(&info);
         jpeg_destroy_decompress(&info);
@@ -80,6 +92,26 @@ void decodeJpeg(const Buffer &in, Buffer &out,
         jpeg_destroy_decompress(&info);
         throw;
     }
+    return scale;
+}
+
+} // namespace
+
+void decodeJpeg(const Buffer &in, Buffer &out,
+                uint32 &width, uint32 &height, uint32 &components,
+                bool flipVertically)
+{
+    decodeJpegScaled(in, out, width, height, components,
+        flipVertically, 1);
+}
+
+uint32 decodeJpegPreview(const Buffer &in, Buffer &out,
+                uint32 &width, uint32 &height, uint32 &components,
+                bool flipVertically)
+{
+    OPTICK_EVENT("decode jpeg preview");
+    return decodeJpegScaled(in, out, width, height, components,
+        flipVertically, 8);
 }
 
 } // namespace vts
@@ -0,0 +1,166 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "image.hpp"
+
+#include <dbglog/dbglog.hpp>
+#include <cstring>
+
+namespace vts
+{
+
+namespace
+{
+
+const unsigned char ktx2Signature[] = { 0xAB, 0x4B, 0x54, 0x58, 0x20,
+    0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+struct Ktx2Header
+{
+    unsigned char identifier[12];
+    uint32 vkFormat;
+    uint32 typeSize;
+    uint32 pixelWidth;
+    uint32 pixelHeight;
+    uint32 pixelDepth;
+    uint32 layerCount;
+    uint32 faceCount;
+    uint32 levelCount;
+    uint32 supercompressionScheme;
+    uint32 dfdByteOffset;
+    uint32 dfdByteLength;
+    uint32 kvdByteOffset;
+    uint32 kvdByteLength;
+    uint64 sgdByteOffset;
+    uint64 sgdByteLength;
+};
+
+struct Ktx2Level
+{
+    uint64 byteOffset;
+    uint64 byteLength;
+    uint64 uncompressedByteLength;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "invalid ktx2 header layout");
+static_assert(sizeof(Ktx2Level) == 24, "invalid ktx2 level layout");
+
+struct CompressedFormat
+{
+    uint32 vkFormat;
+    uint32 glFormat;
+    uint32 components;
+};
+
+// vulkan formats (as stored in ktx2) and their opengl equivalents
+const CompressedFormat compressedFormats[] = {
+    { 131, 0x83F0, 3 }, // BC1_RGB -> COMPRESSED_RGB_S3TC_DXT1_EXT
+    { 133, 0x83F1, 4 }, // BC1_RGBA -> COMPRESSED_RGBA_S3TC_DXT1_EXT
+    { 137, 0x83F3, 4 }, // BC3 -> COMPRESSED_RGBA_S3TC_DXT5_EXT
+    { 145, 0x8E8C, 4 }, // BC7 -> COMPRESSED_RGBA_BPTC_UNORM
+    { 147, 0x9274, 3 }, // ETC2_R8G8B8 -> COMPRESSED_RGB8_ETC2
+    { 149, 0x9276, 4 }, // ETC2_R8G8B8A1 -> COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2
+    { 151, 0x9278, 4 }, // ETC2_R8G8B8A8 -> COMPRESSED_RGBA8_ETC2_EAC
+    { 157, 0x93B0, 4 }, // ASTC_4x4 -> COMPRESSED_RGBA_ASTC_4x4_KHR
+};
+
+} // namespace
+
+bool isKtx2(const Buffer &in)
+{
+    return in.size() >= sizeof(ktx2Signature)
+        && memcmp(in.data(), ktx2Signature, sizeof(ktx2Signature)) == 0;
+}
+
+void decodeKtx2(const Buffer &in, Buffer &out,
+                uint32 &width, uint32 &height, uint32 &components,
+                uint32 &internalFormat, std::vector<uint32> &levels)
+{
+    if (in.size() < sizeof(Ktx2Header))
+        LOGTHROW(err1, std::runtime_error) << "insufficient ktx2 data";
+    Ktx2Header header;
+    memcpy(&header, in.data(), sizeof(header));
+    if (header.supercompressionScheme != 0)
+    {
+        LOGTHROW(err1, std::runtime_error)
+            << "supercompressed ktx2 image is not supported";
+    }
+    if (header.pixelDepth > 1 || header.layerCount > 1
+        || header.faceCount != 1 || header.pixelHeight == 0)
+    {
+        LOGTHROW(err1, std::runtime_error)
+            << "ktx2 image is not a simple 2D texture";
+    }
+
+    const CompressedFormat *format = nullptr;
+    for (const CompressedFormat &f : compressedFormats)
+        if (f.vkFormat == header.vkFormat)
+            format = &f;
+    if (!format)
+    {
+        LOGTHROW(err1, std::runtime_error)
+            << "ktx2 image has unsupported format <"
+            << header.vkFormat << ">";
+    }
+
+    // zero levels means that the mipmaps should be generated
+    //   which is not possible for compressed formats
+    const uint32 levelCount = std::max(header.levelCount, 1u);
+    if ((in.size() - sizeof(Ktx2Header)) / sizeof(Ktx2Level) < levelCount)
+        LOGTHROW(err1, std::runtime_error) << "insufficient ktx2 data";
+
+    // the level index starts with the largest level
+    std::vector<Ktx2Level> index(levelCount);
+    memcpy(index.data(), in.data() + sizeof(Ktx2Header),
+        levelCount * sizeof(Ktx2Level));
+    uint64 total = 0;
+    for (const Ktx2Level &l : index)
+    {
+        if (l.byteOffset > in.size()
+            || l.byteLength > in.size() - l.byteOffset)
+            LOGTHROW(err1, std::runtime_error) << "ktx2 level out of data";
+        total += l.byteLength;
+    }
+
+    out = Buffer(total);
+    levels.clear();
+    levels.reserve(levelCount);
+    uint64 off = 0;
+    for (const Ktx2Level &l : index)
+    {
+        memcpy(out.data() + off, in.data() + l.byteOffset, l.byteLength);
+        levels.push_back(l.byteLength);
+        off += l.byteLength;
+    }
+
+    width = header.pixelWidth;
+    height = header.pixelHeight;
+    components = format->components;
+    internalFormat = format->glFormat;
+}
+
+} // namespace vts
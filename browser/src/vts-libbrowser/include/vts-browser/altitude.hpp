@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ALTITUDE_HPP_c8r2kd6w
+#define ALTITUDE_HPP_c8r2kd6w
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+
+#include "foundation.hpp"
+
+namespace vts
+{
+
+class AltitudeTaskImpl;
+class MapImpl;
+
+// resolves altitudes of the surface at many positions at once
+// the resources are downloaded with priority below anything visible
+// the task is processed as long as it is referenced
+//   and the map is updated
+class VTS_API AltitudeTask : private Immovable
+{
+public:
+    explicit AltitudeTask(const double *points, uint32 count,
+        double accuracy);
+
+    const std::vector<double> points; // navigation srs, three per point
+    const double accuracy; // size of the sampled area in meters
+
+    // altitudes over ellipsoid, nan where the surface is not available
+    std::vector<double> altitudes;
+    std::atomic<uint32> pointsDone;
+    std::atomic<bool> done; // do not access the altitudes until this is true
+
+private:
+    std::shared_ptr<AltitudeTaskImpl> impl;
+    friend MapImpl;
+};
+
+} // namespace vts
+
+#endif
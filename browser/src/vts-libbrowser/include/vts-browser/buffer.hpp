@@ -29,6 +29,7 @@
 
 #include <iostream>
 #include <string>
+#include <memory>
 
 #include "foundation.hpp"
 
@@ -41,6 +42,14 @@ public:
     Buffer();
     explicit Buffer(uint32 size); // create preallocated buffer (it is not zeroed)
     explicit Buffer(const std::string &str); // create buffer from string
+
+    // create buffer that refers to memory owned by someone else,
+    //   eg. a memory mapped file or a range inside of another buffer
+    // the owner is kept alive for the lifetime of the buffer
+    //   and the memory must remain valid and writable while the owner exists
+    // nothing is copied
+    explicit Buffer(const std::shared_ptr<void> &owner, char *data, uint32 size);
+
     ~Buffer();
 
     // move semantics
@@ -54,6 +63,17 @@ public:
     // explicitly create a copy
     Buffer copy() const;
 
+    // converts the memory to shared ownership (if it is not already)
+    //   and returns another buffer that refers to the same memory
+    // nothing is copied
+    // the content must not be modified through either buffer afterwards
+    Buffer share();
+
+    // returns a buffer that refers to a range of this buffer
+    //   the memory is converted to shared ownership, see share
+    // nothing is copied
+    Buffer slice(uint32 offset, uint32 size);
+
     // explicitly create string out of the buffer
     std::string str() const;
 
@@ -77,18 +97,50 @@ public:
     char *dataEnd() const { return data_ + size_; }
     uint32 size() const { return size_; }
 
+    // returns whether the memory is owned by someone else
+    bool shared() const { return !!owner_; }
+
 private:
+    std::shared_ptr<void> owner_;
     char *data_;
     uint32 size_;
 };
 
+// the memory of buffers is allocated from a process wide pool
+//   that caches freed blocks of common sizes for reuse
+// the pool is enabled by default
+VTS_API void setBufferPoolEnabled(bool enabled);
+
+// releases the blocks retained in the shared part of the pool
+VTS_API void trimBufferPool();
+
+class VTS_API BufferPoolStatistics
+{
+public:
+    uint64 hits = 0;
+    uint64 misses = 0;
+    uint64 retainedBytes = 0; // cached for reuse
+};
+
+VTS_API BufferPoolStatistics bufferPoolStatistics();
+
 VTS_API void writeLocalFileBuffer(const std::string &path, const Buffer &buffer);
 VTS_API Buffer readLocalFileBuffer(const std::string &path);
 
+// returns a buffer that refers to a private (copy on write) mapping of the file
+//   the mapping is released with the last buffer referring to it
+// the file must not be truncated while the buffer is alive
+// falls back to readLocalFileBuffer in WASM
+VTS_API Buffer mapLocalFileBuffer(const std::string &path);
+
 // this will copy the data and return it in a buffer
 // it is safe to modify/free the buffer
 VTS_API Buffer readInternalMemoryBuffer(const std::string &path);
 
+// returns a buffer that refers directly to the internal memory
+// nothing is copied and the content must not be modified
+VTS_API Buffer shareInternalMemoryBuffer(const std::string &path);
+
 namespace detail
 {
 
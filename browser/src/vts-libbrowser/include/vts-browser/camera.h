@@ -38,6 +38,7 @@ VTS_API void vtsCameraDestroy(vtsHCamera cam);
 
 // camera
 VTS_API void vtsCameraSetViewportSize(vtsHCamera cam, uint32 width, uint32 height);
+VTS_API void vtsCameraSetResolutionScale(vtsHCamera cam, double scale);
 VTS_API void vtsCameraSetView(vtsHCamera cam, const double eye[3], const double target[3], const double up[3]);
 VTS_API void vtsCameraSetViewMatrix(vtsHCamera cam, const double view[16]);
 VTS_API void vtsCameraSetProj(vtsHCamera cam, double fovyDegs, double near_, double far_);
@@ -47,7 +48,12 @@ VTS_API void vtsCameraGetView(vtsHCamera cam, double eye[3], double target[3], d
 VTS_API void vtsCameraGetViewMatrix(vtsHCamera cam, double view[16]);
 VTS_API void vtsCameraGetProjMatrix(vtsHCamera cam, double proj[16]);
 VTS_API void vtsCameraSuggestedNearFar(vtsHCamera cam, double *near_, double *far_);
+VTS_API void vtsCameraSetOcclusionDepth(vtsHCamera cam, const float *depth, uint32 width, uint32 height, const double viewProj[16]);
+VTS_API void vtsCameraShareTraversal(vtsHCamera cam, vtsHCamera leader);
 VTS_API void vtsCameraRenderUpdate(vtsHCamera cam);
+VTS_API bool vtsCameraNeedsRedraw(vtsHCamera cam);
+VTS_API bool vtsCameraIntersectRay(vtsHCamera cam, const double origin[3], const double direction[3], double *distance);
+VTS_API bool vtsCameraLineOfSight(vtsHCamera cam, const double a[3], const double b[3]);
 
 // credits
 VTS_API const char *vtsCameraGetCredits(vtsHCamera cam);
@@ -57,6 +63,7 @@ VTS_API const char *vtsCameraGetCreditsFull(vtsHCamera cam);
 // options & statistics
 VTS_API const char *vtsCameraGetOptions(vtsHCamera cam);
 VTS_API const char *vtsCameraGetStatistics(vtsHCamera cam);
+VTS_API void vtsCameraGetStatisticsStruct(vtsHCamera cam, vtsCCameraStatistics *statistics);
 VTS_API void vtsCameraSetOptions(vtsHCamera cam, const char *options);
 
 // acquire group base for the draw tasks
@@ -69,6 +76,11 @@ VTS_API void vtsDrawsCollidersGroup(vtsHCamera cam, void **group, uint32 *count)
 VTS_API void vtsDrawsSurfaceTask(void *group, uint32 index, void **mesh, void **texColor, void **texMask, vtsCDrawSurfaceBase **baseStruct);
 VTS_API void vtsDrawsColliderTask(void *group, uint32 index, void **mesh, vtsCDrawColliderBase **baseStruct);
 
+// copy all draw tasks of a group at once into caller-provided arrays
+// surfaces: resources has three pointers per task (mesh, texColor, texMask)
+VTS_API void vtsDrawsSurfaceTasks(void *group, uint32 count, vtsCDrawSurfaceBase *baseStructs, void **resources);
+VTS_API void vtsDrawsColliderTasks(void *group, uint32 count, vtsCDrawColliderBase *baseStructs, void **meshes);
+
 VTS_API const vtsCCameraBase *vtsDrawsCamera(vtsHCamera cam);
 
 VTS_API void *vtsDrawsAtmosphereDensityTexture(vtsHMap map);
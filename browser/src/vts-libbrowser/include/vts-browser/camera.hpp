@@ -50,6 +50,11 @@ public:
     explicit Camera(MapImpl *map);
 
     void setViewportSize(uint32 width, uint32 height);
+    // ratio of the rendered resolution to the viewport size
+    // the level of detail is selected for the rendered pixels
+    // may be called while renderUpdate runs in another thread
+    //   and takes effect in the next renderUpdate
+    void setResolutionScale(double scale);
     void setView(const double eye[3], const double target[3], const double up[3]);
     void setView(const std::array<double, 3> &eye, const std::array<double, 3> &target, const std::array<double, 3> &up);
     void setView(const double view[16]);
@@ -64,8 +69,48 @@ public:
 
     void suggestedNearFar(double &near_, double &far_);
 
+    // depth buffer of a previously rendered frame used for occlusion culling
+    // depth values are in 0..1 range, rows are ordered bottom-up
+    // viewProj is the matrix that the frame was rendered with
+    // the data are copied
+    // may be called while renderUpdate runs in another thread
+    //   and takes effect in the next renderUpdate
+    void setOcclusionDepth(const float *depth, uint32 width, uint32 height,
+        const double viewProj[16]);
+
+    // traverse the map once for a group of cameras (eg. stereo views)
+    // the leader traverses the union of the views of the group
+    //   and the followers receive copies of its draws
+    //   transformed to their own views
+    // renderUpdate of a follower does nothing,
+    //   its draws are updated by renderUpdate of the leader
+    // the traversal is controlled by options of the leader
+    // pass nullptr to stop following
+    void shareTraversal(const std::shared_ptr<Camera> &leader);
+
     void renderUpdate();
 
+    // render on demand
+    // returns true if the draws have changed in the last renderUpdate,
+    //   or if the view, projection, viewport, navigation or options
+    //   have changed since then
+    // the loading resources and other changes of the map
+    //   are reported by Map::needsUpdate
+    bool needsRedraw() const;
+
+    // ray casting against the meshes rendered by the last renderUpdate
+    // requires MapRuntimeOptions::collisionMeshes
+    // the positions and directions are in physical srs
+    // distance to the nearest hit is in multiples of the direction
+    bool intersectRay(const double origin[3], const double direction[3],
+        double &distance);
+    bool intersectRay(const std::array<double, 3> &origin,
+        const std::array<double, 3> &direction, double &distance);
+    // returns true if nothing obstructs the segment between the points
+    bool lineOfSight(const double a[3], const double b[3]);
+    bool lineOfSight(const std::array<double, 3> &a,
+        const std::array<double, 3> &b);
+
     CameraCredits &credits();
     CameraDraws &draws();
     CameraOptions &options();
@@ -69,6 +69,32 @@ typedef struct vtsCCameraBase
     double altitudeOverSurface; // altitude of the eye over surface
 } vtsCCameraBase;
 
+// subset of the camera statistics as plain struct
+//   without the json, see vtsCameraGetStatisticsStruct
+typedef struct vtsCCameraStatistics
+{
+    uint32 nodesRenderedTotal;
+    uint32 nodesRenderedPerLod[25];
+    uint32 metaNodesTraversedTotal;
+    uint32 metaNodesTraversedPerLod[25];
+    uint32 nodesOccludedTotal;
+    uint32 nodesBeyondHorizonTotal;
+    uint32 nodesSkippedByBudget;
+    uint32 nodesMergedTotal;
+    uint32 nodesBlendingSnapped;
+    uint32 framesOverBudget;
+    uint32 currentNodeMetaUpdates;
+    uint32 currentNodeDrawsUpdates;
+    uint32 currentNodeDrawsWaiting;
+    uint32 currentGridNodes;
+    uint32 currentPrefetchNodes;
+    double timeUpdate;
+    double timeTraversal;
+    double timeBlending;
+    double timeSorting;
+    double timePrefetch;
+} vtsCCameraStatistics;
+
 #ifdef __cplusplus
 } // extern C
 #endif
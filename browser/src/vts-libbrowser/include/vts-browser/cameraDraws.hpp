@@ -41,6 +41,10 @@ public:
     std::shared_ptr<void> mesh;
     std::shared_ptr<void> texColor;
     std::shared_ptr<void> texMask;
+    // range of the mesh indices to render, zero count = the whole mesh
+    //   the uvClip must be applied anyway, see GpuMeshSpec::indices
+    uint32 indicesOffset;
+    uint32 indicesCount;
     DrawSurfaceTask();
 };
 
@@ -66,6 +70,16 @@ public:
     DrawColliderTask();
 };
 
+class VTS_API DrawSurfaceRetained
+{
+public:
+    DrawSurfaceTask task;
+    double model[16]; // the mv of the task is valid for its frame only
+    uint64 id;
+    bool transparent;
+    DrawSurfaceRetained();
+};
+
 class VTS_API CameraDraws
 {
 public:
@@ -77,6 +91,14 @@ public:
     // (must be rendered in given order)
     std::vector<DrawSurfaceTask> transparent;
 
+    // far field impostor (see CameraOptions::farFieldDistance)
+    //   the surfaces beyond the distance, in all directions around the eye
+    //   provided only in frames when the impostor is to be rendered again
+    // the other frames reuse the impostor, rendered at its own eye
+    std::vector<DrawSurfaceTask> farFieldOpaque;
+    std::vector<DrawSurfaceTask> farFieldTransparent;
+    bool farFieldRefresh;
+
     // geodata
     std::vector<DrawGeodataTask> geodata;
 
@@ -87,6 +109,16 @@ public:
     // each nodes mesh is reported only once
     std::vector<DrawColliderTask> colliders;
 
+    // retained mode (see CameraOptions::retainedDraws)
+    //   opaque and transparent are left empty
+    // draws that are new or have changed since previous frame
+    //   a changed draw replaces the draw with the same id
+    std::vector<DrawSurfaceRetained> retainedAdded;
+    // ids of draws that are no longer rendered
+    std::vector<uint64> retainedRemoved;
+    // ids of all transparent draws in the order of rendering
+    std::vector<uint64> retainedTransparentOrder;
+
     struct VTS_API Camera : public vtsCCameraBase
     {
         Camera();
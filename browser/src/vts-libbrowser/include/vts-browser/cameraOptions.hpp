@@ -52,12 +52,42 @@ public:
     // this is useful to include shadow casters outside camera frustum
     double cullingOffsetDistance = 0;
 
+    // skip nodes hidden behind the terrain
+    //   tested against the depth buffer of previous frame
+    //   which must be provided by the application (see Camera::setOcclusionDepth)
+    bool occlusionCulling = false;
+
+    // surfaces farther than this distance from the camera
+    //   are rendered by the renderer into a far field impostor
+    //   (a cubemap around the eye) composited behind the near surfaces
+    // the far nodes are traversed only in frames when the impostor
+    //   is rendered again, see CameraDraws::farFieldRefresh
+    // not applied to cameras that share traversal
+    // 0 to disable
+    double farFieldDistance = 0;
+
+    // the impostor is rendered again after the camera has moved
+    //   by this fraction of the farFieldDistance
+    double farFieldRefreshThreshold = 0.02;
+
     double minSuggestedNearClipPlaneDistance = 10;
     double maxSuggestedNearClipPlaneDistance = 1e100;
 
     // duration of lod blending in seconds
     double lodBlendingDuration = 1;
 
+    // the camera movement is extrapolated this many seconds ahead
+    //   and resources for the predicted view are requested in advance
+    // the prefetched resources have lower priority than visible resources
+    // 0 to disable
+    double prefetchDuration = 0;
+
+    // nodes whose coarseness is above this fraction of the target pixel ratio
+    //   request the metatiles of their children in advance
+    //   so that zooming in does not wait for a round-trip at each lod
+    // 0 to disable
+    double metaPrefetchRatio = 0.7;
+
     // number of virtual samples to fit the view-extent
     // it is used to determine lod index at which to retrieve
     //   the altitude used to correct camera position
@@ -67,9 +97,36 @@ public:
     // defined in physical length units (meters)
     double fixedTraversalDistance = 10000;
 
+    // coarseness of nodes is reused in following frames
+    //   until the camera moves by more than this fraction
+    //   of the distance to the node
+    //   or rotates by more than this (change of unit vectors)
+    // 0 to recompute every frame
+    double coarsenessCacheTolerance = 0.01;
+
+    // maximum number of meta nodes traversed per frame
+    //   the remaining subtrees are rendered with coarser nodes
+    //   and refined in following frames
+    // applies to balanced and coherent traversal modes
+    //   and to each layer separately when traversed concurrently
+    // 0 to disable
+    uint32 traversalBudget = 0;
+
     // desired lod used with fixed traversal mode
     uint32 fixedTraversalLod = 15;
 
+    // camera movement (relative to the distance to the focus point)
+    //   or rotation (change of the forward unit vector)
+    //   that makes the coherent traversal start over from the root
+    double coherentTraversalJump = 0.2;
+
+    // nodes with surfaces smaller than this many pixels on screen
+    //   are drawn instead of refining to their children
+    //   which merges the many tiny draws at the horizon
+    //   at the cost of coarser textures there
+    // 0 to disable
+    double mergeTilesScreenSize = 0;
+
     // coarser lod offset for grids for use with balanced traversal
     // -1 to disable grids entirely
     uint32 balancedGridLodOffset = 5;
@@ -90,9 +147,27 @@ public:
     TraverseMode traverseModeSurfaces = TraverseMode::Balanced;
     TraverseMode traverseModeGeodata = TraverseMode::Stable;
 
+    // determines the order in which resources are downloaded and processed
+    PriorityModel priorityModel = PriorityModel::Distance;
+
     // move opaque blending draws into transparent group
     bool lodBlendingTransparent = false;
 
+    // maximum number of draws in the middle of the lod blending, per layer
+    //   the draws closest to the screen center keep blending
+    //   the others snap to their final state immediately
+    // 0 = unlimited
+    uint32 lodBlendingBudget = 0;
+
+    // order opaque draws to minimize state changes (textures and meshes)
+    //   instead of front to back order
+    bool sortOpaqueByState = false;
+
+    // publish only changes of the surface draws (see CameraDraws)
+    //   for renderers that keep their own state for each draw
+    // not supported by the vts-renderer library
+    bool retainedDraws = false;
+
     bool debugDetachedCamera = false;
     bool debugRenderSurrogates = false;
     bool debugRenderMeshBoxes = false;
@@ -28,6 +28,7 @@
 #define CAMERA_STATISTICS_HPP_wqieufhbvgjh
 
 #include <string>
+#include <vector>
 
 #include "foundation.hpp"
 
@@ -44,9 +45,25 @@ public:
     uint32 nodesRenderedPerLod[MaxLods] = {};
     uint32 metaNodesTraversedTotal = 0;
     uint32 metaNodesTraversedPerLod[MaxLods] = {};
+    uint32 nodesOccludedTotal = 0;
+    uint32 nodesBeyondHorizonTotal = 0;
+    uint32 nodesSkippedByBudget = 0;
+    uint32 nodesMergedTotal = 0; // drawn instead of children, see CameraOptions::mergeTilesScreenSize
+    uint32 nodesBlendingSnapped = 0; // see CameraOptions::lodBlendingBudget
+    uint32 framesOverBudget = 0; // accumulated over the lifetime of the camera
     uint32 currentNodeMetaUpdates = 0;
     uint32 currentNodeDrawsUpdates = 0;
+    uint32 currentNodeDrawsWaiting = 0; // of the updates, skipped until a resource changes
     uint32 currentGridNodes = 0;
+    uint32 currentPrefetchNodes = 0;
+
+    // cpu time of the last render update in milliseconds
+    double timeUpdate = 0;
+    double timeTraversal = 0; // all layers, including blending
+    double timeBlending = 0; // summed over the layers
+    double timeSorting = 0;
+    double timePrefetch = 0;
+    std::vector<double> timeLayers; // in order of the traversed layers
 };
 
 } // namespace vts
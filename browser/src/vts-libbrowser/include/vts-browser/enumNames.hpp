@@ -71,6 +71,12 @@ UTILITY_GENERATE_ENUM_IO(TraverseMode,
     ((Balanced)("balanced"))
     ((Hierarchical)("hierarchical"))
     ((Fixed)("fixed"))
+    ((Coherent)("coherent"))
+)
+
+UTILITY_GENERATE_ENUM_IO(PriorityModel,
+    ((Distance)("distance"))
+    ((ScreenSpaceError)("screenSpaceError"))
 )
 
 #ifdef UNDEF_UTILITY_GENERATE_ENUM_IO
@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EXECUTOR_HPP_k4j6h2g8f5
+#define EXECUTOR_HPP_k4j6h2g8f5
+
+#include <functional>
+
+#include "foundation.hpp"
+
+namespace vts
+{
+
+// optional host job system for the background work of the map
+//   (cache reads and writes, decoding, atmosphere)
+// when provided, the map spawns no threads for this work
+//   (the fetcher keeps its own thread)
+class VTS_API Executor : private Immovable
+{
+public:
+    enum class Affinity
+    {
+        Io, // mostly waiting for disk
+        Compute,
+    };
+
+    virtual ~Executor();
+
+    // the job must eventually be run, on any thread
+    //   jobs with higher priority should be run first
+    // jobs run after the map was destroyed do nothing
+    // may be called from any thread, including from within other jobs
+    virtual void submit(std::function<void()> &&job,
+        float priority, Affinity affinity) = 0;
+};
+
+} // namespace vts
+
+#endif
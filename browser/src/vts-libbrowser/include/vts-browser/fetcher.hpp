@@ -72,6 +72,8 @@ public:
             ProhibitedContent = 10403,
             // Content is rejected to simulate errors for testing purposes.
             SimulatedError = 10000,
+            // The download was cancelled by the browser.
+            Cancelled = 10499,
         };
     };
 
@@ -81,6 +83,11 @@ public:
         std::map<std::string, std::string> headers;
         ResourceType resourceType;
 
+        // priority of the resource at the time the fetch started
+        //   higher is more important, infinity for essential resources
+        // it is also expressed in the Priority header (RFC 9218 urgency)
+        float priority = 0;
+
         explicit Query(const std::string &url, ResourceType resourceType);
     };
 
@@ -90,6 +97,13 @@ public:
         std::string contentType;
         std::string redirectUrl;
 
+        // validators for conditional requests (ETag and Last-Modified)
+        // the browser sends them back in If-None-Match
+        //   and If-Modified-Since headers when the content expires
+        //   and reuses the cached content on 304 Not Modified
+        std::string etag;
+        std::string lastModified;
+
         // absolute time in seconds, comparable to std::time
         //   -1 = invalid value
         //   -2 = always revalidate
@@ -97,6 +111,18 @@ public:
 
         // http status code, or one of the ExtraCodes
         uint32 code = 0;
+
+        // network timing of the download, in milliseconds
+        // filled in by the fetcher, if available
+        //   negative = unknown
+        float timeDns = -1; // name lookup
+        float timeConnect = -1; // tcp connection
+        float timeTls = -1; // tls handshake
+        float timeFirstByte = -1; // from sending the request
+        float timeTransfer = -1; // from the first byte to the end
+
+        // eg. "1.1" or "2", empty if unknown
+        std::string httpVersion;
     };
 
     Query query;
@@ -123,7 +149,7 @@ public:
     sint32 timeout = 30000;
 
     // create extra file with log entry for each download
-    // the output is meant to be computer readable
+    // the output is meant to be computer readable (one json object per line)
     bool extraFileLog = false;
 
     // curl options
@@ -136,6 +162,44 @@ public:
     // 2 = use http/2, fallback http/1
     // 3 = use http/2, fallback http/1.1
     sint32 pipelining = 2;
+
+    // record all downloads (query and reply) into an archive file
+    //   for later replay
+    std::string recordArchive;
+
+    // answer all downloads from a previously recorded archive
+    //   instead of the network, takes precedence over the recording
+    // disable the disk cache to replay all downloads
+    // not available in web assembly
+    std::string replayArchive;
+
+    // true = deliver the replies after the recorded latencies
+    // false = deliver the replies immediately
+    bool replayTimings = true;
+
+    // network condition simulator
+    //   delays and damages the replies to reproduce slow
+    //   or unreliable networks (eg. 3G or satellite links)
+    //   the simulation is disabled when all of these are zero
+    // not available in web assembly
+
+    // latency added to each download, in milliseconds
+    double simulatedLatency = 0;
+    // variation of the added latency, in milliseconds
+    //   standard deviation of the normal distribution,
+    //   half of the range of the uniform distribution,
+    //   or mean of the tail of the exponential distribution
+    double simulatedJitter = 0;
+    // normal, uniform or exponential
+    std::string simulatedLatencyDistribution = "normal";
+    // bandwidth shared by all downloads in progress,
+    //   in kilobytes per second, 0 = unlimited
+    uint32 simulatedBandwidth = 0;
+    // fraction of downloads that never come back
+    //   they fail with ExtraCodes::Timeout after the timeout
+    double simulatedLossRate = 0;
+    // fraction of downloads that fail with ExtraCodes::SimulatedError
+    double simulatedErrorRate = 0;
 };
 
 class VTS_API Fetcher : private Immovable
@@ -143,11 +207,35 @@ class VTS_API Fetcher : private Immovable
 public:
     static std::shared_ptr<Fetcher> create(const FetcherOptions &options);
 
+    // wraps any fetcher with the network condition simulator
+    //   configured by the options (see FetcherOptions)
+    // returns the fetcher unchanged if no simulation is configured
+    // the fetchers created by create are already wrapped
+    static std::shared_ptr<Fetcher> createSimulator(
+        const FetcherOptions &options, const std::shared_ptr<Fetcher> &fetcher);
+
     virtual ~Fetcher();
     virtual void initialize();
     virtual void finalize();
+    // called from the fetcher thread whenever it wakes up
+    //   (a resource was queued or a download finished)
+    // the thread does not wake up periodically
     virtual void update();
     virtual void fetch(const std::shared_ptr<FetchTask> &) = 0;
+
+    // the browser is no longer interested in the task
+    // the fetcher should abort the download, if possible
+    // the fetchDone must still be called (exactly once),
+    //   preferably with the ExtraCodes::Cancelled code
+    // it may be called from any thread and even for tasks
+    //   that have already finished or that have not been started yet
+    virtual void cancel(const std::shared_ptr<FetchTask> &);
+
+    // the priority of a running download has changed
+    // the fetcher may use it to reprioritize the request (eg. http/2 streams)
+    // it is called from the main thread and only when the http urgency changes
+    virtual void updatePriority(const std::shared_ptr<FetchTask> &,
+        float priority);
 };
 
 } // namespace vts
@@ -116,6 +116,23 @@ enum class TraverseMode
     //   and it will render everything up to some specified distance
     // this mode is designed for use with collider probes
     Fixed,
+
+    // Coherent is like Balanced, but instead of descending from the root
+    //   every frame, it refines or coarsens the cut of the previous frame
+    // it falls back to full traversal when the camera moves a lot
+    Coherent,
+};
+
+enum class PriorityModel
+{
+    // resources closer to the camera are loaded first
+    Distance,
+
+    // combines the screen-space error that the node fixes,
+    //   its visible fraction of the viewport,
+    //   whether any of its ancestors is already drawable,
+    //   and an estimate of the download size
+    ScreenSpaceError,
 };
 
 enum class FreeLayerType
@@ -126,6 +143,22 @@ enum class FreeLayerType
     MonolithicGeodata,
 };
 
+// tiers of releasing memory on request of the operating system
+enum class MemoryPressure
+{
+    // releases resources that were not used in last few frames
+    //   regardless of the memory budgets
+    Moderate,
+
+    // additionally clears the traversal of everything
+    //   that is not needed for the current frame
+    Severe,
+
+    // releases everything that is possible
+    //   the map will be loaded again from the disk cache
+    Critical,
+};
+
 struct Immovable
 {
     Immovable() = default;
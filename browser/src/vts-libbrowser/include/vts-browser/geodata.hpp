@@ -189,7 +189,7 @@ public:
     // properties per item
     std::vector<std::array<float, 6>> iconCoords; // uv x1, uv y1, uv x2, uv y2, pixels width, pixels height
     std::vector<std::string> texts;
-    std::vector<std::string> hysteresisIds;
+    std::vector<uint64> hysteresisIds; // hashes of the hysteresis ids
     std::vector<float> importances;
 
     // global properties
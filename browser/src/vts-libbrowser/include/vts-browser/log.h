@@ -47,6 +47,12 @@ VTS_API void vtsLogClearSinks(void);
 // if anything happens during the logging, it is silently ignored
 VTS_API void vtsLog(uint32 level, const char *message);
 
+// built-in tracer, exports chrome trace json (about:tracing, perfetto)
+VTS_API void vtsTraceSetEnabled(bool enable);
+VTS_API bool vtsTraceGetEnabled();
+VTS_API void vtsTraceClear();
+VTS_API const char *vtsTraceExport();
+
 enum
 {
     vtsLogLevelDebug =    0x0000fu,
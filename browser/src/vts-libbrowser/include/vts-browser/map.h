@@ -33,6 +33,30 @@
 extern "C" {
 #endif
 
+// subset of the map statistics as plain struct
+//   without the json, see vtsMapGetStatisticsStruct
+typedef struct vtsCMapStatistics
+{
+    uint32 resourcesExists;
+    uint32 resourcesActive;
+    uint32 resourcesDownloading;
+    uint32 resourcesPreparing;
+    uint32 resourcesQueueCacheRead;
+    uint32 resourcesQueueCacheWrite;
+    uint32 resourcesQueueDownload;
+    uint32 resourcesQueueDecode;
+    uint32 resourcesQueueUpload;
+    uint32 resourcesQueueAtmosphere;
+    uint32 currentGpuMemUseKB;
+    uint32 currentRamMemUseKB;
+    uint32 currentTraverseMemUseKB;
+    uint32 renderTicks;
+    double dataUploadTime;
+    double timeToMapconfigReady;
+    double timeToFirstDraw;
+    double timeToRenderComplete;
+} vtsCMapStatistics;
+
 // map creation and destruction
 VTS_API vtsHMap vtsMapCreate(const char *createOptions, vtsHFetcher fetcher);
 VTS_API void vtsMapDestroy(vtsHMap map);
@@ -51,6 +75,10 @@ VTS_API bool vtsMapGetConfigReady(vtsHMap map);
 VTS_API bool vtsMapGetRenderComplete(vtsHMap map);
 VTS_API double vtsMapGetRenderProgress(vtsHMap map);
 
+// warm start
+VTS_API const char *vtsMapSaveWorkingSet(vtsHMap map, double seconds);
+VTS_API void vtsMapLoadWorkingSet(vtsHMap map, const char *snapshot);
+
 // position
 VTS_API bool vtsMapGetProjected(vtsHMap map);
 VTS_API void vtsMapGetDefaultPosition(vtsHMap map, vtsHPosition position);
@@ -63,14 +91,18 @@ VTS_API void vtsMapDataFinalize(vtsHMap map);
 // rendering
 VTS_API void vtsMapRenderUpdate(vtsHMap map, double elapsedTime); // seconds since last call
 VTS_API void vtsMapRenderFinalize(vtsHMap map);
+VTS_API bool vtsMapNeedsUpdate(vtsHMap map);
+VTS_API double vtsMapRecommendedFrameInterval(vtsHMap map); // seconds
 
 // options and statistics
 VTS_API const char *vtsMapGetOptions(vtsHMap map);
 VTS_API const char *vtsMapGetStatistics(vtsHMap map);
+VTS_API void vtsMapGetStatisticsStruct(vtsHMap map, vtsCMapStatistics *statistics);
 VTS_API void vtsMapSetOptions(vtsHMap map, const char *options);
 
 // conversion
 VTS_API void vtsMapConvert(vtsHMap map, const double pointFrom[3], double pointTo[3], uint32 srsFrom, uint32 SrsTo);
+VTS_API void vtsMapConvertPoints(vtsHMap map, const double *pointsFrom, double *pointsTo, uint32 count, uint32 srsFrom, uint32 srsTo);
 
 // map view functionality is not yet available in the C API
 
@@ -31,6 +31,7 @@
 #include <memory>
 #include <vector>
 #include <array>
+#include <functional>
 
 #include "foundation.hpp"
 
@@ -46,6 +47,9 @@ class MapRuntimeOptions;
 class MapCelestialBody;
 class MapView;
 class SearchTask;
+class OfflineTask;
+class AltitudeTask;
+class PreloadTask;
 class MapImpl;
 class Position;
 
@@ -56,6 +60,18 @@ public:
     Map();
     explicit Map(const MapCreateOptions &options);
     explicit Map(const MapCreateOptions &options, const std::shared_ptr<Fetcher> &fetcher);
+    // the new map shares all resources of the other map
+    //   (the threads, caches, fetcher, gpu data and memory budgets)
+    //   the resources are deduplicated by name
+    //   and their priority is the maximum over all maps
+    // the resources are decoded with the options and callbacks of the other map
+    //   and the maps should use the same mapconfig
+    // all maps must be updated on the same thread,
+    //   the other map must have renderUpdate called every frame
+    //   and it alone is finalized (the sharing maps must be destroyed first)
+    // only the other map runs the data thread,
+    //   the data functions do nothing on the sharing maps
+    explicit Map(const MapCreateOptions &options, const std::shared_ptr<Map> &resourcesOwner);
     ~Map();
 
     // mapconfigPath: url to mapconfig
@@ -67,12 +83,21 @@ public:
     void purgeViewCache();
     void purgeDiskCache();
 
+    // release memory immediately, eg. when the operating system warns about low memory
+    // it must be called on the render thread, outside of any camera renderUpdate
+    void memoryPressure(MemoryPressure level);
+
+    // returns the directory of the disk cache, empty if disabled
+    // applications may store their own cached data next to it
+    std::string getDiskCachePath() const;
+
     // returns whether the mapconfig has been downloaded and parsed successfully
     // most other functions will not work until this returns true
     bool getMapconfigAvailable() const;
 
     // returns whether the mapconfig and all other required external definitions has been downloaded and parsed successfully
     // some other functions will not work until this returns true
+    // free layers and bound layers are not required, they come online independently as their definitions arrive
     bool getMapconfigReady() const;
 
     // returns whether the map has all resources needed for complete render
@@ -81,11 +106,22 @@ public:
     // returns estimation of progress till complete render
     double getMapRenderProgress() const;
 
+    // warm start
+    // returns a snapshot of the resources used in the last few seconds
+    //   together with the current position of the first camera
+    //   the application may store it on shutdown
+    std::string saveWorkingSet(double seconds = 5) const;
+    // requests all resources in the snapshot at once, in order of their priority
+    //   and restores the position, when the mapconfig becomes available
+    // the snapshot is ignored if the mapconfig path is different
+    void loadWorkingSet(const std::string &snapshot);
+
     bool getMapProjected() const;
 
     Position getMapDefaultPosition() const;
 
     // dataUpdate does at most MapOptions.maxResourceProcessesPerTick operations and returns
+    //   or as many as fit into MapOptions.dataUpdateBudget, when set
     // you should call it periodically
     void dataUpdate();
 
@@ -100,10 +136,35 @@ public:
     //         dataUpdate();
     //     dataFinalize();
     // }
+    // the dataAllRun may be called from multiple threads at once,
+    //   each thread must have its own (shared) context current
+    //   and the uploads must be synchronized by the renderer
+    //   (eg. with ContextOptions::fenceUploads)
     void dataAllRun();
 
     void renderUpdate(double elapsedTime); // seconds since last call
     void renderFinalize();
+
+    // render on demand
+    // returns true if renderUpdate may change anything:
+    //   the mapconfig or some resources are still loading,
+    //   some tasks are pending, the options have changed,
+    //   or Camera::needsRedraw of any of the cameras
+    // when it returns false, the host may skip the whole frame
+    //   (the updates of the map and of the cameras and the rendering)
+    // the host should check Camera::needsRedraw again after the updates
+    //   to skip rendering of draws that have not changed
+    bool needsUpdate() const;
+
+    // frame pacing advisor
+    // returns the interval (in seconds) the host should wait
+    //   before the next update, based on the motion of the cameras,
+    //   changes of the draws and loading of the resources
+    //   (see the frameInterval options in MapRuntimeOptions)
+    // zero means the full frame rate of the host
+    // the host should also account for RenderView::needsRedraw
+    //   (eg. the geodata hysteresis) with the transition interval
+    double recommendedFrameInterval() const;
     double lastRenderUpdateElapsedTime() const;
 
     // create new camera
@@ -119,6 +180,8 @@ public:
     // srs conversion
     void convert(const double pointFrom[3], double pointTo[3], Srs srsFrom, Srs srsTo) const;
     void convert(const std::array<double, 3> &pointFrom, double pointTo[3], Srs srsFrom, Srs srsTo) const;
+    // converts count points, three doubles each, pointsFrom and pointsTo may be the same array
+    void convert(const double *pointsFrom, double *pointsTo, uint32 count, Srs srsFrom, Srs srsTo) const;
 
     // surfaces and layers resources
     std::vector<std::string> getResourceSurfaces() const;
@@ -149,6 +212,23 @@ public:
     std::shared_ptr<SearchTask> search(const std::string &query, const double point[3]); // navigation srs
     std::shared_ptr<SearchTask> search(const std::string &query, const std::array<double, 3> &point); // navigation srs
 
+    // offline regions
+    // downloads the region into the disk cache, see OfflineTask
+    std::shared_ptr<OfflineTask> downloadRegion(const double extentsLl[3], const double extentsUr[3], uint32 lodMin, uint32 lodMax); // navigation srs
+    std::shared_ptr<OfflineTask> downloadRegion(const std::array<double, 3> &extentsLl, const std::array<double, 3> &extentsUr, uint32 lodMin, uint32 lodMax); // navigation srs
+
+    // altitude queries
+    // resolves altitudes at count points (three doubles each), see AltitudeTask
+    // accuracy is the size of the sampled area in meters
+    // the callback is called from renderUpdate when all points are resolved
+    std::shared_ptr<AltitudeTask> queryAltitudes(const double *points, uint32 count, double accuracy, const std::function<void(AltitudeTask &)> &callback = {}); // navigation srs
+
+    // preloading
+    // loads resources for rendering the view from the position, see PreloadTask
+    // duration: seconds after which the task is abandoned, zero for unlimited
+    // priority: relative to other preloads, in range (0, 1]
+    std::shared_ptr<PreloadTask> preload(const Position &position, double duration = 0, double priority = 1);
+
 private:
     std::shared_ptr<MapImpl> impl;
 };
@@ -53,6 +53,11 @@ public:
     // invoked from Map::dataTick()
     std::function<void(class ResourceInfo &, class GpuGeodataSpec &, const std::string &id)> loadGeodata;
 
+    // function callback to query the gpu memory capacity in KB, 0 = unknown
+    // invoked from Map::renderTick()
+    // used by MapRuntimeOptions::autoGpuMemoryBudget
+    std::function<uint32()> gpuMemoryCapacity;
+
     // function callback when the mapconfig is downloaded
     // invoked from Map::renderTick()
     // suitable to change view, position, etc.
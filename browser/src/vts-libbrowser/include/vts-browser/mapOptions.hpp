@@ -28,12 +28,15 @@
 #define MAP_OPTIONS_HPP_kwegfdzvgsdfj
 
 #include <string>
+#include <memory>
 
 #include "foundation.hpp"
 
 namespace vts
 {
 
+class Executor;
+
 // these options are passed to the map when it is being created
 //   and are immutable during the lifetime of the map
 class VTS_API MapCreateOptions
@@ -65,9 +68,75 @@ public:
     std::string customSrs1;
     std::string customSrs2;
 
+    // number of threads used for decoding resources
+    //   (images, meshes, geodata, ...)
+    // all threads share single priority queue
+    uint32 decodeThreads = 1;
+
+    // number of threads reading resources from the disk cache
+    //   more threads keep more reads in flight, which suits ssd drives
+    // all threads share single priority queue
+    uint32 cacheReadThreads = 1;
+
+    // resources with file:// urls are memory mapped on the cache read threads
+    //   instead of copying them into newly allocated buffers
+    //   the operating system is advised to read the whole file ahead
+    // the files must not be truncated while in use
+    // suits tilesets served from a local disk (not available in WASM)
+    bool mapLocalFiles = false;
+
+    // priorities of the worker threads relative to normal threads
+    //   -2 (lowest) to 2 (highest), raising may require privileges
+    //   on apple platforms it selects a qos class instead
+    // io: fetcher and cache threads, decode: decode and atmosphere threads
+    sint32 ioThreadsPriority = 0;
+    sint32 decodeThreadsPriority = 0;
+
+    // bit masks of cores allowed for the worker threads
+    //   0 = no restriction (not available on apple platforms)
+    uint64 ioThreadsAffinity = 0;
+    uint64 decodeThreadsAffinity = 0;
+
+    // host job system for the cache, decode and atmosphere work
+    //   instead of the threads of the library (see executor.hpp)
+    // the thread priorities and affinities above are not applied then
+    // not serialized to json
+    std::shared_ptr<Executor> executor;
+
+    // monolithic geodata free layers are partitioned into quad-tree
+    //   of virtual tiles with at most this many features in each tile
+    //   so that the tiles are culled and loaded as in tiled free layers
+    // 0 = process the whole layer as one tile
+    uint32 geodataVirtualTileFeatures = 5000;
+
     // use hard drive cache for downloads
+    // in WASM, the cache is stored in IndexedDB of the web browser
     bool diskCache;
 
+    // true -> store all cached resources in a few large pack files
+    //         with an index loaded into memory at startup
+    // false -> store each resource in a separate file
+    bool diskCachePacked = false;
+
+    // list of directories with read only pre-built caches
+    //   separated by semicolons
+    // each directory has the same layout as the cachePath
+    //   (files or packed, detected automatically)
+    // the seeds are looked up in order before the local cache
+    //   and are never modified
+    std::string diskCacheSeeds;
+
+    // maximum size of the disk cache
+    // least recently used resources are removed from the cache
+    //   when the limit is exceeded
+    // 0 = unlimited (in WASM, limited by the web browser storage quota)
+    uint32 diskCacheMaxSizeMB = 0;
+
+    // compress cached configs, metatiles, meshes and geodata (zlib)
+    //   images and already compressed content are stored as is
+    // the decompression happens on the cache read threads
+    bool diskCacheCompression = true;
+
     // true -> use new scheme for naming (hashing) files
     //         in a hierarchy of directories in the cache
     // false -> use old scheme where the name of the downloaded resource
@@ -105,18 +174,93 @@ public:
     double renderTilesScale = 1.001;
 
     // memory threshold at which resources start to be released
+    // applies to the sum of ram and gpu memory
     uint32 targetResourcesMemoryKB = 0;
 
+    // separate memory thresholds for ram and gpu
+    // 0 = not used
+    uint32 targetRamMemoryKB = 0;
+    uint32 targetGpuMemoryKB = 0;
+
+    // limit the gpu memory to 3/4 of the capacity reported
+    //   by MapCallbacks::gpuMemoryCapacity
+    // combined with targetGpuMemoryKB, the lower threshold applies
+    bool autoGpuMemoryBudget = false;
+
+    // memory thresholds (ram + gpu) for individual types of resources
+    // 0 = not used
+    uint32 targetMetaTilesMemoryKB = 0;
+    uint32 targetMeshesMemoryKB = 0;
+    uint32 targetTexturesMemoryKB = 0;
+    uint32 targetGeodataMemoryKB = 0;
+
+    // memory budget of the dedicated cache of surface samples
+    //   which answers the altitude queries of the navigation and cameras
+    //   independently of the rendered nodes
+    // 0 = the altitudes are resolved from the traversal of each camera
+    uint32 heightfieldMemoryKB = 1024;
+
     // maximum size of the queue for the resources to be downloaded
+    // with adaptive downloads, this is the initial window for each host
     uint32 maxConcurrentDownloads = 25;
 
+    // upper limit of the adaptive number of concurrent downloads per host
+    // the window grows while the host responds in time
+    //   and shrinks on errors and increasing latency
+    // 0 = adaptation disabled, maxConcurrentDownloads is used for each host
+    uint32 maxAdaptiveDownloads = 0;
+
     // maximum number of items waiting in queue to be written to disk cache
     // new resources will be skipped when the queue is full
     uint32 maxCacheWriteQueueLength = 500;
 
+    // finished downloads wait for room in the cache write queue
+    //   instead of skipping the write
+    //   which slows down the downloads to the speed of the disk
+    // ignored in wasm
+    bool cacheWriteBackpressure = false;
+
     // maximum number of resources processed per dataTick
     uint32 maxResourceProcessesPerTick = 10;
 
+    // time budget (in milliseconds) of one dataUpdate
+    //   replaces maxResourceProcessesPerTick in dataUpdate
+    //   the cost of each upload is estimated from the size of its decoded data
+    //   and the uploads, that would not fit, are deferred to the next call
+    //   meant for applications that call dataUpdate on the render thread
+    //   does not affect dataAllRun
+    // 0 = disabled
+    double dataUpdateBudget = 0;
+
+    // time slice (in milliseconds) of long running decodes (meshes, geodata)
+    //   after which queued decodes with higher priority are processed
+    //   in between, so that heavy resources do not delay visible imagery
+    // 0 = disabled
+    double decodeTimeSlice = 20;
+
+    // time slice (in milliseconds) of geodata uploads on the data thread
+    //   the remaining parts of the tile are uploaded in following dataTicks
+    //   after the other queued uploads, the tile becomes ready with the last part
+    // 0 = disabled
+    double uploadTimeSlice = 5;
+
+    // priorities of queued resources that are no longer accessed
+    //   by the traversal are halved every this many ticks
+    //   so that the queues follow the current view
+    // 0 to disable
+    uint32 queuedPriorityHalfLife = 10;
+
+    // queued resources not accessed for this many ticks
+    //   are removed from the queues (cache read, fetch and decode)
+    //   and their downloads are cancelled
+    uint32 abandonedResourceTicks = 30;
+
+    // when the cache read or the fetch queue is longer than this,
+    //   the lowest priority resources in excess are removed from it
+    //   unless the traversal has accessed them in the last two ticks
+    // 0 = disabled
+    uint32 queueShedThreshold = 2000;
+
     // maximum number of redirections before the download fails
     // this is to prevent infinite loops
     uint32 maxFetchRedirections = 5;
@@ -128,6 +272,30 @@ public:
     // each subsequent retry is delayed twice as long as before
     uint32 fetchFirstRetryTimeOffset = 1;
 
+    // number of consecutive server or transport errors from a single host
+    //   after which the host is blocked for a backoff period
+    // the downloads from the blocked host wait in the queue
+    //   and a single probe is made after the period
+    //   (each failed probe doubles the period)
+    // 0 = disabled, the resources retry independently
+    uint32 hostBlockingFailures = 5;
+
+    // initial and maximum backoff period (in seconds) of a blocked host
+    double hostBackoffInitial = 2;
+    double hostBackoffMaximum = 60;
+
+    // number of additional threads that traverse the map layers
+    //   concurrently with the rendering thread
+    // 0 = all layers are traversed sequentially on the rendering thread
+    uint32 traversalThreads = 0;
+
+    // time budget in milliseconds for releasing stale traverse nodes
+    //   in each renderUpdate
+    // the tree is walked incrementally and the walk continues
+    //   in following frames when the budget is exhausted
+    // 0 = the whole tree is walked in every frame
+    double traverseClearingBudget = 0.5;
+
     // 0 = US customary units
     // 1 = metric
     // when new instance of this structure is created,
@@ -135,6 +303,114 @@ public:
     //   from the environment locale settings
     uint32 measurementUnitsSystem;
 
+    // reorder triangles and vertices of tile meshes at decode time
+    //   for better utilization of the gpu vertex cache
+    bool optimizeMeshes = false;
+
+    // store vertex positions of tile meshes as normalized shorts
+    //   (relative to the tile extents) instead of floats
+    // the position attribute of GpuMeshSpec then has type Short
+    bool quantizeMeshPositions = false;
+
+    // append index ranges of the triangles in each quarter
+    //   of the external uv to the tile meshes
+    // parent tiles drawn in place of their missing children
+    //   then render only the range of the respective quarter
+    // costs up to twice the index memory of the meshes
+    bool subtileIndexRanges = true;
+
+    // compute texture mipmaps on the decode threads
+    //   instead of glGenerateMipmap at upload
+    bool generateMipmapsOnDecode = false;
+
+    // convert tile textures to 16 bit per pixel (rgb565 or rgba4444)
+    //   with an ordered dithering on the decode threads
+    //   halves the gpu memory at the cost of color precision
+    bool reducedPrecisionTextures = false;
+
+    // textures with byte-identical content (eg. ocean or nodata tiles)
+    //   share single gpu object, the decode and upload are skipped
+    //   the gpu memory is accounted to the texture that uploaded it
+    bool deduplicateTextures = false;
+
+    // masks of bound layer tiles are folded into the alpha channel
+    //   of the color textures on the decode threads
+    //   saves the separate gpu texture and its bind for each masked tile
+    // the alpha of the color is multiplied by the mask
+    //   and the pixels below half opacity are discarded
+    // not applicable to precompressed color textures
+    bool combineMaskTextures = false;
+
+    // surfaces and glues with the same tileset ids (in the same reference frame)
+    //   use the url templates of the first one seen
+    //   so that their metatiles, meshes and textures are requested once
+    //   even if other mapconfigs or views reference them through different urls
+    //   (eg. host aliases or rewritten paths)
+    // applies to surface stacks generated after the change
+    bool deduplicateTilesets = false;
+
+    // tile textures in jpeg are first decoded at 1/8 of the resolution
+    //   and become usable immediately
+    //   the full resolution is decoded and uploaded afterwards
+    bool progressiveTextures = false;
+
+    // keep results of individual style layers with each geodata tile
+    //   changing the stylesheet then reprocesses only the modified layers
+    //   at the cost of additional memory
+    bool cacheGeodataLayers = false;
+
+    // parse geodata features once when downloaded
+    //   and share the parsed features with all tiles and stylesheets
+    //   at the cost of additional memory
+    bool cacheParsedGeodataFeatures = true;
+
+    // keep triangles of tile meshes in ram for ray casting
+    //   (see Camera::intersectRay)
+    // the acceleration structure is built on the decode threads
+    bool collisionMeshes = false;
+
+    // maximum displacement of vertices of collider meshes
+    //   (see CameraDraws::colliders), relative to the size of the tile
+    // the colliders are simplified by vertex clustering on the decode threads
+    //   and are separate meshes, independent of the render meshes
+    // 0 = the colliders use the render meshes
+    double colliderSimplification = 0;
+
+    // maximum error (in texels of the tile) introduced by simplification
+    //   of lines and polygons in tiled geodata
+    // the tiles are rendered when their texels are smaller
+    //   than targetPixelRatioGeodata pixels on screen
+    // 0 = no simplification
+    double geodataSimplification = 0.5;
+
+    // number of recent search queries whose results are kept
+    //   so that search as you type does not repeat the same downloads
+    // 0 = disabled
+    uint32 searchCacheCapacity = 20;
+
+    // size of the position bucket (in navigation srs)
+    //   searches within the same bucket share the results
+    //   the distances are still measured from the exact position
+    // 0 = the exact position is used
+    double searchCacheBucket = 0.01;
+
+    // frame intervals (in seconds) recommended by Map::recommendedFrameInterval
+    //   motion: the camera or the navigation is moving
+    //   transition: the draws are changing (lod blending, new resources)
+    //   loading: resources are being downloaded or processed
+    //   idle: nothing is changing
+    // 0 = the full frame rate of the host
+    double frameIntervalMotion = 0;
+    double frameIntervalTransition = 1.0 / 30;
+    double frameIntervalLoading = 0.1;
+    double frameIntervalIdle = 1;
+
+    // profile for battery powered devices
+    //   halves the concurrent downloads, processes the resources
+    //   on single decode thread and doubles the recommended frame intervals
+    //   (the motion is limited to 30 frames per second)
+    bool lowPowerMode = false;
+
     bool debugVirtualSurfaces = true;
     bool debugSaveCorruptedFiles = false;
     bool debugValidateGeodataStyles = false;
@@ -28,12 +28,53 @@
 #define MAP_STATISTICS_HPP_wqieufhbvgjh
 
 #include <string>
+#include <vector>
+#include <map>
 
 #include "foundation.hpp"
 
 namespace vts
 {
 
+// aggregated network timings of downloads of one resource type
+class VTS_API DownloadTimings
+{
+public:
+    // bin i counts durations in range [2^(i-1), 2^i) milliseconds
+    //   bin 0 counts durations below 1 ms, the last bin is unbounded
+    static const uint32 Bins = 16;
+
+    uint32 count = 0;
+    uint64 bytes = 0;
+
+    // measured by the browser, from the start of the fetch to its end
+    uint32 total[Bins] = {};
+
+    // reported by the fetcher, only counted when available
+    uint32 dns[Bins] = {};
+    uint32 connect[Bins] = {};
+    uint32 tls[Bins] = {};
+    uint32 firstByte[Bins] = {};
+    uint32 transfer[Bins] = {};
+
+    std::map<std::string, uint32> httpVersions;
+};
+
+// aggregated durations of processing stages of one resource type
+//   the bins are the same as in DownloadTimings
+//   the downloads themselves are in DownloadTimings
+class VTS_API ResourceLatencies
+{
+public:
+    static const uint32 Bins = DownloadTimings::Bins;
+
+    uint32 cacheRead[Bins] = {}; // waiting for and reading the disk cache
+    uint32 fetchQueue[Bins] = {}; // waiting for the download to start
+    uint32 decodeQueue[Bins] = {}; // waiting for a decode worker
+    uint32 decode[Bins] = {};
+    uint32 uploadQueue[Bins] = {}; // including the upload itself
+};
+
 class VTS_API MapStatistics
 {
 public:
@@ -42,14 +83,24 @@ public:
     uint32 resourcesCreated = 0;
     uint32 resourcesDownloaded = 0;
     uint32 resourcesDiskLoaded = 0;
+    uint32 resourcesCacheSkipped = 0; // definite cache misses, not looked up on disk
+    uint32 resourcesRevalidated = 0; // not modified since cached
     uint32 resourcesDecoded = 0;
+    uint32 resourcesDecodePreempted = 0; // decoded in between a long running decode
     uint32 resourcesUploaded = 0;
+    uint32 resourcesUploadsDeferred = 0; // postponed by MapRuntimeOptions::dataUpdateBudget
+    uint32 resourcesUpgraded = 0; // progressive resources at full quality
+    uint32 resourcesDeduplicated = 0; // textures sharing gpu object with identical content
     uint32 resourcesFailed = 0;
     uint32 resourcesReleased = 0;
+    uint32 resourcesCancelled = 0; // abandoned downloads
+    uint32 resourcesShed = 0; // removed from overloaded queues
 
     uint32 resourcesExists = 0;
     uint32 resourcesActive = 0;
     uint32 resourcesDownloading = 0;
+    uint32 downloadsWindow = 0; // adaptive limit summed over hosts
+    uint32 downloadsBlockedHosts = 0; // hosts in backoff after repeated failures
     uint32 resourcesPreparing = 0;
     uint32 resourcesQueueCacheRead = 0;
     uint32 resourcesQueueCacheWrite = 0;
@@ -59,10 +110,59 @@ public:
     uint32 resourcesQueueAtmosphere = 0;
     uint32 resourcesAccessed = 0;
 
+    // total number of in-place priority updates of queued resources
+    uint32 resourcesQueueReprioritized = 0;
+    // total number of times a queue lock was already held by other thread
+    uint32 resourcesQueueContentions = 0;
+
+    // meshes reordered for the vertex cache (MapRuntimeOptions::optimizeMeshes)
+    // acmr is the average number of vertex transformations per triangle
+    //   simulated with fifo cache of 16 vertices
+    uint32 meshesOptimized = 0;
+    double meshesAcmrBefore = 0;
+    double meshesAcmrAfter = 0;
+
     uint32 currentGpuMemUseKB = 0;
     uint32 currentRamMemUseKB = 0;
+    // ram + gpu, indexed by FetchTask::ResourceType
+    std::vector<uint32> currentMemUsePerTypeKB;
+    // ram + gpu, indexed by name of the resource state
+    //   decoded data waiting for upload is included in the uploadQueue
+    std::map<std::string, uint32> currentMemUsePerStateKB;
+    // traverse trees of all layers, not included in the totals above
+    uint32 currentTraverseMemUseKB = 0;
+    uint32 currentTraverseNodes = 0;
+    // samples cached for altitude queries, not included in the totals above
+    uint32 currentHeightfieldMemUseKB = 0;
+
+    // milliseconds spent uploading resources on the data thread
+    //   since previous render update
+    double dataUploadTime = 0;
+
+    // process wide pool of buffer allocations, see setBufferPoolEnabled
+    uint64 bufferPoolHits = 0;
+    uint64 bufferPoolMisses = 0;
+    uint32 bufferPoolRetainedKB = 0;
 
     uint32 renderTicks = 0;
+
+    // milliseconds since setMapconfigPath, 0 = not yet
+    double timeToMapconfigAvailable = 0;
+    double timeToMapconfigReady = 0; // all other definitions are loaded too
+    double timeToFirstDraw = 0; // first traversal that emits any draws
+    double timeToRenderComplete = 0;
+
+    // stale traverse nodes released by the incremental clearing
+    uint32 traverseNodesCleared = 0;
+
+    // percentage of time each decode (or cache read) worker spent working
+    //   since previous render update
+    std::vector<uint32> decodeWorkersUtilization;
+    std::vector<uint32> cacheReadWorkersUtilization;
+
+    // indexed by FetchTask::ResourceType
+    std::vector<DownloadTimings> downloadTimings;
+    std::vector<ResourceLatencies> resourceLatencies;
 };
 
 } // namespace vts
@@ -96,6 +96,7 @@ VTS_API mat4 orthographicMatrix(double left, double right,
 
 VTS_API double aabbPointDist(const vec3 &point, const vec3 &min, const vec3 &max);
 VTS_API bool aabbTest(const vec3 aabb[2], const vec4 planes[6]);
+VTS_API bool obbTest(const vec3 &center, const vec3 halfAxes[3], const vec4 planes[6]);
 VTS_API void frustumPlanes(const mat4 &vp, vec4 planes[6]);
 
 VTS_API vec2ui16 vec2to2ui16(const vec2 &v, bool normalized = true);
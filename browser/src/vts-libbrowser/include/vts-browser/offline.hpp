@@ -0,0 +1,69 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef OFFLINE_HPP_ngr7h3w2s
+#define OFFLINE_HPP_ngr7h3w2s
+
+#include <memory>
+#include <atomic>
+
+#include "foundation.hpp"
+
+namespace vts
+{
+
+class OfflineTaskImpl;
+class MapImpl;
+
+// downloads all resources needed to render a region into the disk cache
+// the download continues as long as the task is referenced
+//   and the map is updated
+// running the same region again is cheap for everything already cached
+class VTS_API OfflineTask : private Immovable
+{
+public:
+    explicit OfflineTask(const double extentsLl[3], const double extentsUr[3],
+        uint32 lodMin, uint32 lodMax);
+
+    const double extentsLl[3]; // navigation srs, the z is altitude
+    const double extentsUr[3]; // navigation srs, the z is altitude
+    const uint32 lodMin;
+    const uint32 lodMax;
+
+    std::atomic<uint32> tilesDone; // tiles with all resources available
+    std::atomic<uint32> tilesFailed; // tiles whose metadata failed to download
+    std::atomic<uint32> tilesPending; // tiles in progress during last update
+    std::atomic<bool> done;
+
+private:
+    std::shared_ptr<OfflineTaskImpl> impl;
+    friend MapImpl;
+};
+
+} // namespace vts
+
+#endif
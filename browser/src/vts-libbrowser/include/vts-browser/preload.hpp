@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PRELOAD_HPP_b7w3nq5e
+#define PRELOAD_HPP_b7w3nq5e
+
+#include <memory>
+#include <atomic>
+
+#include "foundation.hpp"
+
+namespace vts
+{
+
+class PreloadTaskImpl;
+class MapImpl;
+
+// loads resources needed to render the map from a position ahead of time
+//   eg. the next stop of a tour, so that a later flight there
+//   lands on a fully loaded scene
+// the resources are downloaded with priority below anything visible
+// the task is processed as long as it is referenced,
+//   the map is updated and the duration has not elapsed
+// the loaded resources are kept in memory while the task is processed
+class VTS_API PreloadTask : private Immovable
+{
+public:
+    explicit PreloadTask(double duration, double priority);
+
+    const double duration; // seconds, zero for unlimited
+    const double priority; // relative to other preloads, in range (0, 1]
+
+    std::atomic<double> progress; // estimation, 0 to 1
+    std::atomic<bool> done; // all resources for the view are ready
+
+private:
+    std::shared_ptr<PreloadTaskImpl> impl;
+    friend MapImpl;
+};
+
+} // namespace vts
+
+#endif
@@ -28,6 +28,7 @@
 #define RESOURCES_HPP_jhsegfshg
 
 #include <array>
+#include <vector>
 #include <memory>
 
 #include "buffer.hpp"
@@ -46,9 +47,12 @@ enum class GpuTypeEnum
     UnsignedInt = 0x1405,
     HalfFloat = 0x140B, // two bytes
     Float = 0x1406, // four bytes
+    UnsignedShort565 = 0x8363, // whole rgb pixel packed in two bytes
+    UnsignedShort4444 = 0x8033, // whole rgba pixel packed in two bytes
 };
 
 // number of bytes for one element of that type
+//   the packed types count the whole pixel as one element
 VTS_API uint32 gpuTypeSize(GpuTypeEnum type);
 
 // this is passed to the load* callbacks for the application to fill it in
@@ -69,7 +73,8 @@ class VTS_API GpuTextureSpec
 {
 public:
     GpuTextureSpec() = default;
-    explicit GpuTextureSpec(const Buffer &buffer); // decode jpg or png file
+    explicit GpuTextureSpec(const Buffer &buffer); // decode jpg, png or ktx2 file
+    GpuTextureSpec(const Buffer &buffer, bool flipVertically); // same as decode followed by verticalFlip, but in single pass (ktx2 is never flipped)
     void verticalFlip();
 
     // image resolution
@@ -87,12 +92,42 @@ public:
 
     // raw texture data
     // it has (width * height * components * gpuTypeSize(type)) bytes
+    //   or (width * height * gpuTypeSize(type)) bytes for the packed types
     // the rows are in no way aligned to multi-byte boundaries (GL_UNPACK_ALIGNMENT = 1)
     Buffer buffer;
 
+    // sizes (in bytes) of mipmap levels
+    //   the levels are stored in the buffer one after another, starting with the largest
+    //   each level has half the resolution of the previous one (rounded down, at least 1)
+    // empty if the buffer contains the base level only
+    std::vector<uint32> mipmapLevels;
+
+    // the buffer contains precompressed image (always with mipmapLevels)
+    //   the internalFormat is the compressed format (eg. GL_COMPRESSED_RGBA8_ETC2_EAC)
+    bool compressed = false;
+
+    // the texture is used for surface tiles only (internal or bound layer textures)
+    //   the renderer may store it in a layer of a shared texture array
+    bool tileTexture = false;
+
+    // the alpha channel contains a bound layer mask
+    //   the renderer discards the pixels below half opacity
+    bool alphaMask = false;
+
     // expected size based on width * height * components * gpuTypeSize(type)
+    //   or the sum of mipmapLevels
     uint32 expectedSize() const;
 
+    // compute all mipmap levels with a box filter
+    //   only unsigned byte uncompressed images are supported
+    void generateMipmaps();
+
+    // convert rgb or rgba image (including all mipmap levels)
+    //   into 16 bit per pixel packed type with an ordered dithering
+    //   the internalFormat is set to GL_RGB565 or GL_RGBA4
+    //   only unsigned byte uncompressed images are supported
+    void reducePrecision();
+
     // encode the image into png format
     Buffer encodePng() const;
 
@@ -152,6 +187,8 @@ public:
     Buffer vertices;
 
     // an array of uint16, uint32, or empty if the mesh is not indexed
+    // may contain additional ranges after the first indicesCount indices
+    //   (eg. MapRuntimeOptions::subtileIndexRanges), upload the whole buffer
     Buffer indices;
 
     // description of memory layout in the vertices buffer
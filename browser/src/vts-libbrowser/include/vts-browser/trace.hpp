@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TRACE_HPP_jh4d8fs6g1
+#define TRACE_HPP_jh4d8fs6g1
+
+#include <string>
+
+#include "foundation.hpp"
+
+namespace vts
+{
+
+// built-in lightweight tracing
+// when built without Optick, the profiling events (OPTICK_EVENT etc.)
+//   are recorded into per-thread ring buffers
+// resources record their states as asynchronous spans
+// the tracing is process wide and disabled by default
+VTS_API void setTraceEnabled(bool enable);
+VTS_API bool getTraceEnabled();
+VTS_API void clearTrace();
+
+// the recorded events in the chrome trace event format (json)
+//   viewable in chrome://tracing or in the perfetto ui
+VTS_API std::string exportTrace();
+
+// events in the current thread
+//   the names must be static strings
+VTS_API void traceThread(const char *name);
+VTS_API void traceTag(const char *name, const char *value);
+VTS_API void traceTag(const char *name, double value);
+VTS_API void traceTag(const char *name, sint64 value);
+VTS_API void traceTag(const char *name, uint64 value);
+VTS_API void traceTag(const char *name, sint32 value);
+VTS_API void traceTag(const char *name, uint32 value);
+
+// span of an asynchronous operation identified by the key
+//   the times are in nanoseconds of the steady clock
+VTS_API void traceAsyncSpan(const char *category, const char *name,
+    const std::string &key, sint64 beginNs, sint64 endNs);
+
+// scoped event in the current thread
+class VTS_API TraceScope : private Immovable
+{
+public:
+    // the name is used if not empty, otherwise the function
+    TraceScope(const char *function, const char *name);
+    ~TraceScope();
+
+private:
+    const char *name;
+    sint64 begin; // 0 = not recording
+};
+
+} // namespace vts
+
+#endif
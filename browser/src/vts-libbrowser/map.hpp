@@ -28,6 +28,10 @@
 #define MAP_HPP_cvukikljqwdf
 
 #include <vector>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <chrono>
 
 #include <vts-libs/registry/referenceframe.hpp>
 
@@ -54,11 +58,18 @@ class Credits;
 class MapLayer;
 class CameraImpl;
 class SearchTask;
+class OfflineTask;
+class AltitudeTask;
+class PreloadTask;
+class Heightfield;
+class Position;
 class TraverseNode;
 
 class Resource;
 class GpuTexture;
 class GpuAtmosphereDensityTexture;
+class GpuMaskedTexture;
+class TextureMask;
 class GpuMesh;
 class MetaTile;
 class MeshAggregate;
@@ -71,6 +82,7 @@ class GeodataFeatures;
 class GeodataStylesheet;
 class GeodataStylesheet;
 class GeodataTile;
+class GeodataPartition;
 class GpuFont;
 
 using TileId = vtslibs::registry::ReferenceFrame::Division::Node::Id;
@@ -84,49 +96,98 @@ public:
     MapStatistics statistics;
     MapRuntimeOptions options;
     MapCelestialBody body;
-    std::shared_ptr<Resources> resources;
+    std::shared_ptr<Resources> resources; // resources->map is the owner
+    std::shared_ptr<Map> resourcesOwner; // empty if the resources are not shared
     std::shared_ptr<Cache> cache;
     std::shared_ptr<Fetcher> fetcher;
     std::shared_ptr<AuthConfig> auth;
     std::shared_ptr<Mapconfig> mapconfig;
     std::shared_ptr<CoordManip> convertor;
     std::shared_ptr<Credits> credits;
+    std::shared_ptr<Heightfield> heightfield;
     std::vector<std::shared_ptr<MapLayer>> layers;
     std::vector<std::weak_ptr<CameraImpl>> cameras;
     std::vector<std::weak_ptr<SearchTask>> searchTasks;
+    std::list<std::shared_ptr<SearchTaskImpl>> searchCache; // most recent first
+    std::vector<std::weak_ptr<OfflineTask>> offlineTasks;
+    std::vector<std::weak_ptr<AltitudeTask>> altitudeTasks;
+    std::vector<std::weak_ptr<PreloadTask>> preloadTasks;
     std::string authPath;
     std::string mapconfigPath;
     std::string mapconfigView;
     double lastElapsedFrameTime = 0;
     uint32 progressEstimationMaxResources = 0;
     uint32 renderTickIndex = 0;
+    uint32 coarsenessEpochs = 0; // unique across cameras
+    std::atomic<uint32> metaNodesEpoch{ 0 }; // changes with any meta node
     bool mapconfigAvailable = false;
     bool mapconfigReady = false;
+    std::chrono::steady_clock::time_point mapconfigPathTime;
+
+    // render on demand, see Map::needsUpdate
+    std::string updateOptions; // json of the options in last renderUpdate
+    bool updateTracking = false; // enabled by the first query
+
+    // warm start
+    struct WorkingSetItem
+    {
+        std::string name;
+        std::string type;
+        float priority = 0;
+    };
+    std::vector<WorkingSetItem> workingSetPending; // until the mapconfig is available
+    std::string workingSetMapconfig;
+    std::string workingSetPosition; // json
+    std::vector<std::shared_ptr<Resource>> workingSet; // restored resources, touched until they are ready
 
     MapImpl(Map *map, const MapCreateOptions &options, const std::shared_ptr<Fetcher> &fetcher);
+    MapImpl(Map *map, const MapCreateOptions &options, const std::shared_ptr<Map> &resourcesOwner, MapImpl *owner);
     ~MapImpl();
 
     // map api methods
     void setMapconfigPath(const std::string &mapconfigPath, const std::string &authPath);
     void purgeMapconfig();
     void purgeViewCache();
+    void switchView(); // keeps the layers that have not changed
+    void memoryPressure(MemoryPressure level);
 
     // rendering
     void renderUpdate(double elapsedTime);
+    bool updateNeeded();
     bool prerequisitesCheck();
+    void prerequisitesPrefetch();
+    void freeLayersCheck();
+    double millisSinceMapconfigPath() const;
+
+    // warm start
+    std::string saveWorkingSet(double seconds);
+    void loadWorkingSet(const std::string &snapshot);
+    void workingSetUpdate();
     void initializeNavigation();
     std::pair<Validity, std::shared_ptr<GeodataStylesheet>> getActualGeoStyle(const std::string &name);
-    std::pair<Validity, std::shared_ptr<const std::string>> getActualGeoFeatures(const std::string &name, const std::string &geoName, float priority);
+    std::pair<Validity, std::shared_ptr<const std::string>> getActualGeoFeatures(const std::string &name, const std::string &geoName, float priority, std::shared_ptr<GeodataFeatures> &handle); // the handle is retrieved only if it is empty
     std::pair<Validity, std::shared_ptr<const std::string>> getActualGeoFeatures(const std::string &name);
-    void traverseClearing(TraverseNode *trav);
+    void traverseClearing(TraverseNode *trav, uint32 keepTicks);
+    bool traverseClearing(MapLayer *layer,
+        std::chrono::steady_clock::time_point deadline);
 
     // resources methods
     void touchResource(const std::shared_ptr<Resource> &resource);
+
+    // guards the resources and other shared state of the map
+    //   while the layers are traversed concurrently
+    // the lock is empty when the traversal is sequential
+    // maps sharing resources use the mutex of the owner
+    std::unique_lock<std::recursive_mutex> traversalLock();
+    std::recursive_mutex traversalMutex;
+    bool traversalParallel = false;
     Validity getResourceValidity(const std::string &name);
     Validity getResourceValidity(const std::shared_ptr<Resource> &resource);
 
     std::shared_ptr<GpuTexture> getTexture(const std::string &name);
     std::shared_ptr<GpuAtmosphereDensityTexture> getAtmosphereDensityTexture(const std::string &name);
+    std::shared_ptr<GpuMaskedTexture> getMaskedTexture(const std::string &name);
+    std::shared_ptr<TextureMask> getTextureMask(const std::string &name);
     std::shared_ptr<GpuMesh> getMesh(const std::string &name);
     std::shared_ptr<AuthConfig> getAuthConfig(const std::string &name);
     std::shared_ptr<Mapconfig> getMapconfig(const std::string &name);
@@ -141,12 +202,29 @@ public:
     std::shared_ptr<GeodataStylesheet> getGeoStyle(const std::string &name);
     std::shared_ptr<GeodataStylesheet> newGeoStyle(const std::string &name, const std::string &value);
     std::shared_ptr<GeodataTile> getGeodata(const std::string &name);
+    std::shared_ptr<GeodataPartition> getGeodataPartition(const std::string &name);
     std::shared_ptr<GpuFont> getFont(const std::string &name);
 
     std::shared_ptr<SearchTask> search(const std::string &query, const double point[3]);
     void parseSearchResults(const std::shared_ptr<SearchTask> &task);
 
     void updateSearch();
+
+    std::shared_ptr<OfflineTask> downloadRegion(const double extentsLl[3], const double extentsUr[3], uint32 lodMin, uint32 lodMax);
+    void initializeOffline(OfflineTask *task);
+    void updateOffline();
+
+    // altitude queries
+    std::shared_ptr<AltitudeTask> queryAltitudes(const double *points, uint32 count, double accuracy, const std::function<void(AltitudeTask &)> &callback);
+    void initializeAltitudes(AltitudeTask *task);
+    void updateAltitudes();
+
+    // preloading
+    std::shared_ptr<PreloadTask> preload(const Position &position, double duration, double priority);
+    void initializePreload(PreloadTask *task);
+    bool preloadView(PreloadTask *task);
+    void updatePreloads();
+
     double getMapRenderProgress();
     bool getMapRenderComplete();
     TileId roundId(TileId nodeId);
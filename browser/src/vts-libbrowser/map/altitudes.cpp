@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "../include/vts-browser/altitude.hpp"
+
+#include "../altitudeTask.hpp"
+#include "../camera.hpp"
+#include "../coordsManip.hpp"
+#include "../map.hpp"
+
+#include <optick.h>
+
+namespace vts
+{
+
+namespace
+{
+
+// maximum number of unresolved points processed by one task per update
+static const uint32 MaxAltitudePoints = 1000;
+
+} // namespace
+
+AltitudeTask::AltitudeTask(const double *points, uint32 count,
+    double accuracy) :
+    points(points, points + count * 3), accuracy(accuracy),
+    altitudes(count, nan1()), pointsDone(0), done(false)
+{}
+
+std::shared_ptr<AltitudeTask> MapImpl::queryAltitudes(
+    const double *points, uint32 count, double accuracy,
+    const std::function<void(AltitudeTask &)> &callback)
+{
+    OPTICK_EVENT();
+    if (!(accuracy > 0))
+    {
+        LOGTHROW(err2, std::invalid_argument)
+            << "Invalid accuracy for the altitude query";
+    }
+    auto t = std::make_shared<AltitudeTask>(points, count, accuracy);
+    t->impl = std::make_shared<AltitudeTaskImpl>();
+    t->impl->callback = callback;
+    altitudeTasks.push_back(t);
+    return t;
+}
+
+void MapImpl::initializeAltitudes(AltitudeTask *task)
+{
+    AltitudeTaskImpl *impl = task->impl.get();
+    impl->camera = std::make_shared<CameraImpl>(this, nullptr);
+    const uint32 count = task->altitudes.size();
+    impl->pending.resize(count);
+    for (uint32 i = 0; i < count; i++)
+    {
+        impl->pending[i] = i;
+        task->altitudes[i] = nan1();
+    }
+    task->pointsDone = 0;
+
+    // the tiles are prioritized below anything visible
+    //   the same way as prefetching
+    vec3 center = vec3(0, 0, 0);
+    {
+        std::vector<double> phys(count * 3);
+        convertor->convert(task->points.data(), phys.data(), count,
+            Srs::Navigation, Srs::Physical);
+        for (uint32 i = 0; i < count; i++)
+            center += rawToVec3(phys.data() + i * 3);
+    }
+    if (count > 0)
+        center /= count;
+    impl->camera->focusPosPhys = center;
+    impl->camera->prefetching = true;
+    impl->initialized = true;
+}
+
+void MapImpl::updateAltitudes()
+{
+    OPTICK_EVENT();
+    // the callbacks may start new queries
+    std::vector<std::shared_ptr<AltitudeTask>> finished;
+    auto it = altitudeTasks.begin();
+    while (it != altitudeTasks.end())
+    {
+        std::shared_ptr<AltitudeTask> t = it->lock();
+        if (!t)
+        {
+            it = altitudeTasks.erase(it);
+            continue;
+        }
+        if (!t->impl->initialized)
+            initializeAltitudes(t.get());
+
+        // the points that are still loading are moved to the back
+        //   so that they do not block the others
+        AltitudeTaskImpl *impl = t->impl.get();
+        std::vector<uint32> &pending = impl->pending;
+        const uint32 n = std::min<uint32>(pending.size(), MaxAltitudePoints);
+        std::vector<uint32> waiting;
+        for (uint32 j = 0; j < n; j++)
+        {
+            const uint32 i = pending[j];
+            double altitude = nan1();
+            bool complete = false;
+            bool ok = impl->camera->getSurfaceOverEllipsoid(altitude,
+                rawToVec3(t->points.data() + i * 3), t->accuracy,
+                false, &complete);
+            if (!complete)
+            {
+                waiting.push_back(i);
+                continue;
+            }
+            if (ok)
+                t->altitudes[i] = altitude;
+            t->pointsDone++;
+        }
+        pending.erase(pending.begin(), pending.begin() + n);
+        pending.insert(pending.end(), waiting.begin(), waiting.end());
+
+        if (pending.empty())
+        {
+            t->done = true;
+            finished.push_back(t);
+            it = altitudeTasks.erase(it);
+        }
+        else
+            it++;
+    }
+
+    for (auto &t : finished)
+        if (t->impl->callback)
+            t->impl->callback(*t);
+}
+
+} // namespace vts
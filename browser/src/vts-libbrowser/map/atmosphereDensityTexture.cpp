@@ -44,6 +44,37 @@ namespace vts
 namespace
 {
 
+void gray3ToRgb(GpuTextureSpec &spec, const char *gray)
+{
+    if (spec.components != 1)
+    {
+        LOGTHROW(err2, std::runtime_error) << "Atmosphere density texture has <" << spec.components << "> components, but grayscale is expected.";
+    }
+    spec.components = 3;
+    spec.height /= 3;
+
+    // the three planes are stacked vertically
+    const uint32 plane = spec.width * spec.height;
+    const char *r = gray + plane * 0;
+    const char *g = gray + plane * 1;
+    const char *b = gray + plane * 2;
+
+    spec.buffer.allocate(plane * spec.components);
+    char *res = spec.buffer.data();
+    for (uint32 i = 0; i < plane; i++)
+    {
+        *res++ = r[i];
+        *res++ = g[i];
+        *res++ = b[i];
+    }
+}
+
+void gray3ToRgb(GpuTextureSpec &spec)
+{
+    Buffer orig = std::move(spec.buffer);
+    gray3ToRgb(spec, orig.data());
+}
+
 void generateAtmosphereTexture(const std::shared_ptr<GpuAtmosphereDensityTexture> &tex)
 {
     OPTICK_EVENT();
@@ -51,18 +82,29 @@ void generateAtmosphereTexture(const std::shared_ptr<GpuAtmosphereDensityTexture
     atmosphereDerivedAttributes(tex->map->body, boundaryThickness, horizontalExponent, verticalExponent);
 
     // generate the texture anew
+    //   the name (and therefore the cache entry) encodes the same spec
     vtslibs::vts::AtmosphereTextureSpec gats;
     gats.thickness = boundaryThickness / tex->map->body.majorRadius;
     gats.verticalCoefficient = verticalExponent;
     auto res = vtslibs::vts::generateAtmosphereTexture(gats, vtslibs::vts::AtmosphereTexture::Format::gray3);
 
+    // keep the raw pixels for the upload
+    {
+        std::shared_ptr<GpuTextureSpec> spec = std::make_shared<GpuTextureSpec>();
+        spec->width = res.size.width;
+        spec->height = res.size.height;
+        spec->components = res.components;
+        gray3ToRgb(*spec, (const char *)res.data.data());
+        tex->generated = spec;
+    }
+
     // store the result
     Buffer tmp(res.data.size());
     memcpy(tmp.data(), res.data.data(), res.data.size());
     encodePng(tmp, tex->fetch->reply.content, res.size.width, res.size.height, res.components);
     tex->info.ramMemoryCost = tex->fetch->reply.content.size();
 
-    // write to cache
+    // write to cache, next runs load the png instead of generating
     tex->map->resources->queCacheWrite.push(tex->fetch.get());
 
     // mark the texture ready
@@ -70,33 +112,6 @@ void generateAtmosphereTexture(const std::shared_ptr<GpuAtmosphereDensityTexture
     tex->map->resources->queDecode.push(tex);
 }
 
-void gray3ToRgb(GpuTextureSpec &spec)
-{
-    if (spec.components != 1)
-    {
-        LOGTHROW(err2, std::runtime_error) << "Atmosphere density texture has <" << spec.components << "> components, but grayscale is expected.";
-    }
-    spec.components = 3;
-    spec.height /= 3;
-
-    Buffer orig = std::move(spec.buffer);
-    const char *r = orig.data() + (spec.width * spec.height) * 0;
-    const char *g = orig.data() + (spec.width * spec.height) * 1;
-    const char *b = orig.data() + (spec.width * spec.height) * 2;
-
-    spec.buffer.allocate(spec.width * spec.height * spec.components);
-    char *res = spec.buffer.data();
-    for (uint32 y = 0; y < spec.height; y++)
-    {
-        for (uint32 x = 0; x < spec.width; x++)
-        {
-            res[(y * spec.width + x) * spec.components + 0] = r[y * spec.width + x];
-            res[(y * spec.width + x) * spec.components + 1] = g[y * spec.width + x];
-            res[(y * spec.width + x) * spec.components + 2] = b[y * spec.width + x];
-        }
-    }
-}
-
 } // namespace
 
 GpuAtmosphereDensityTexture::GpuAtmosphereDensityTexture(MapImpl *map, const std::string &name) : GpuTexture(map, name)
@@ -108,12 +123,18 @@ GpuAtmosphereDensityTexture::GpuAtmosphereDensityTexture(MapImpl *map, const std
 void GpuAtmosphereDensityTexture::decode()
 {
     LOG(info1) << "Decoding atmosphere texture <" << name << ">";
-    std::shared_ptr<GpuTextureSpec> spec = std::make_shared<GpuTextureSpec>(fetch->reply.content);
+    std::shared_ptr<GpuTextureSpec> spec;
+    if (generated)
+        spec.swap(generated);
+    else
+    {
+        spec = std::make_shared<GpuTextureSpec>(fetch->reply.content);
+        gray3ToRgb(*spec);
+    }
     this->width = spec->width;
     this->height = spec->height;
     spec->filterMode = filterMode;
     spec->wrapMode = wrapMode;
-    gray3ToRgb(*spec);
     decodeData = std::static_pointer_cast<void>(spec);
 }
 
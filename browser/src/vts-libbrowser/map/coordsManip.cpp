@@ -188,6 +188,24 @@ public:
         //LOG(debug) << "Converted <" << value.transpose() << "><" << f << "> to <" << res.transpose() << "><" << t << ">";
         return res;
     }
+
+    void convert(const double *in, double *out, std::size_t count, const std::string &f, const std::string &t)
+    {
+        if (count == 0)
+            return;
+        const auto &cs = convertor(f, t);
+        math::Point3 p;
+        for (std::size_t i = 0; i < count; i++, in += 3, out += 3)
+        {
+            p(0) = in[0];
+            p(1) = in[1];
+            p(2) = in[2];
+            p = cs(p);
+            out[0] = p(0);
+            out[1] = p(1);
+            out[2] = p(2);
+        }
+    }
 };
 
 } // namespace
@@ -234,6 +252,12 @@ vec3 CoordManip::convert(const vec3 &value, Srs from, const std::string &to)
     return impl->convert(value, impl->srsToProj(from), to);
 }
 
+void CoordManip::convert(const double *in, double *out, std::size_t count, Srs from, Srs to)
+{
+    CoordManipImpl *impl = (CoordManipImpl *)this;
+    impl->convert(in, out, count, impl->srsToProj(from), impl->srsToProj(to));
+}
+
 vec3 CoordManip::geoDirect(const vec3 &position, double distance, double azimuthIn, double &azimuthOut)
 {
     CoordManipImpl *impl = (CoordManipImpl *)this;
@@ -79,16 +79,19 @@ boost::optional<vtslibs::registry::CreditId> Credits::find(
 void Credits::hit(Scope scope, vtslibs::registry::CreditId id, uint32 lod)
 {
     assert(scope < Scope::Total_);
-    Hit tmp(id);
-    std::vector<Hit> &h = hits[(int)scope];
-    auto it = std::lower_bound(h.begin(), h.end(), tmp,
-                [](const Hit &a, const Hit &b){
-                    return a.id < b.id;
-    });
-    if (it == h.end() || it->id != tmp.id)
-        it = h.insert(it, tmp);
-    it->hits++;
-    it->maxLod = std::max(it->maxLod, lod);
+    if (id >= denseIndices.size())
+        return;
+    const uint32 idx = denseIndices[id];
+    if (idx == (uint32)-1)
+        return;
+    Hits &h = hits[(int)scope];
+    if (h.hits[idx]++ == 0)
+    {
+        h.touched.push_back(idx);
+        h.maxLod[idx] = lod;
+    }
+    else
+        h.maxLod[idx] = std::max(h.maxLod[idx], lod);
 }
 
 std::string Credits::findId(vtslibs::registry::CreditId id) const
@@ -101,34 +104,67 @@ std::string Credits::findId(vtslibs::registry::CreditId id) const
 }
 
 
-void Credits::tick(CameraCredits &credits)
+void Credits::tick(CameraCredits &credits, CreditsRanking &ranking)
 {
     OPTICK_EVENT();
+    for (Hits &h : hits)
+    {
+        h.ranked.clear();
+        for (uint32 idx : h.touched)
+        {
+            if (!entries[idx].notice.empty())
+                h.ranked.push_back({ idx, h.hits[idx], h.maxLod[idx] });
+            h.hits[idx] = 0;
+        }
+        h.touched.clear();
+        // ties are ordered by the index to keep the ranking stable
+        std::sort(h.ranked.begin(), h.ranked.end(),
+                  [](const Ranked &a, const Ranked &b){
+            if (a.hits != b.hits)
+                return a.hits > b.hits;
+            return a.index < b.index;
+        });
+    }
+    publish(credits, ranking);
+}
+
+void Credits::publish(CameraCredits &credits, CreditsRanking &ranking) const
+{
+    static_assert(sizeof(ranking.order) / sizeof(ranking.order[0])
+        == (int)Scope::Total_, "ranking scopes mismatch");
     CameraCredits::Scope *scopes[(int)Scope::Total_] = {
         &credits.imagery, &credits.geodata };
     for (int i = 0; i < (int)Scope::Total_; i++)
     {
         CameraCredits::Scope *s = scopes[i];
-        s->credits.clear();
-        for (Hit &it : hits[i])
+        const std::vector<Ranked> &ranked = hits[i].ranked;
+        std::vector<uint32> &order = ranking.order[i];
+
+        // the strings are copied only when the ranking changes
+        bool same = ranking.epoch == epoch
+            && order.size() == ranked.size()
+            && s->credits.size() == ranked.size();
+        for (uint32 j = 0; same && j < ranked.size(); j++)
+            same = order[j] == ranked[j].index;
+        if (!same)
         {
-            CameraCredits::Credit c;
-            auto t = stor(it.id, std::nothrow);
-            if (!t || t->notice.empty())
-                continue;
-            c.notice = t->notice;
-            c.url = t->url ? *t->url : "";
-            c.hits = it.hits;
-            c.maxLod = it.maxLod;
-            s->credits.push_back(c);
+            s->credits.resize(ranked.size());
+            order.resize(ranked.size());
+            for (uint32 j = 0; j < ranked.size(); j++)
+            {
+                const Entry &e = entries[ranked[j].index];
+                s->credits[j].notice = e.notice;
+                s->credits[j].url = e.url;
+                order[j] = ranked[j].index;
+            }
+        }
+        for (uint32 j = 0; j < ranked.size(); j++)
+        {
+            s->credits[j].hits = ranked[j].hits;
+            s->credits[j].maxLod = ranked[j].maxLod;
         }
-        std::sort(s->credits.begin(), s->credits.end(),
-                  [](const CameraCredits::Credit &a,
-                  const CameraCredits::Credit &b){
-            return a.hits > b.hits;
-        });
-        hits[i].clear();
     }
+    ranking.epoch = epoch;
 }
 
 void Credits::merge(vtslibs::registry::RegistryBase *reg)
@@ -141,17 +177,38 @@ void Credits::merge(vtslibs::registry::Credit c)
 {
     c.notice = convertNotice(c.notice);
     stor.replace(c);
+
+    const vtslibs::registry::CreditId id = c.numericId;
+    if (id >= denseIndices.size())
+        denseIndices.resize(id + 1, (uint32)-1);
+    uint32 &idx = denseIndices[id];
+    if (idx == (uint32)-1)
+    {
+        idx = entries.size();
+        entries.emplace_back();
+        for (Hits &h : hits)
+        {
+            h.hits.push_back(0);
+            h.maxLod.push_back(0);
+        }
+    }
+    Entry &e = entries[idx];
+    e.notice = c.notice;
+    e.url = c.url ? *c.url : "";
+    epoch++;
 }
 
 void Credits::purge()
 {
     vtslibs::registry::Credit::dict e;
     std::swap(stor, e);
+    entries.clear();
+    denseIndices.clear();
+    for (Hits &h : hits)
+        h = Hits();
+    epoch++;
 }
 
-Credits::Hit::Hit(vtslibs::registry::CreditId id) : id(id)
-{}
-
 CameraCredits::CameraCredits()
 {}
 
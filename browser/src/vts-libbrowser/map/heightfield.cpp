@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../heightfield.hpp"
+#include "../camera.hpp"
+#include "../coordsManip.hpp"
+#include "../map.hpp"
+
+#include <vector>
+#include <algorithm>
+
+#include <optick.h>
+
+namespace vts
+{
+
+namespace
+{
+
+uint32 sampleMemoryCost()
+{
+    // estimate including the hash table overhead
+    return sizeof(TileId) + sizeof(SurfaceSample) + 4 * sizeof(void*);
+}
+
+} // namespace
+
+Heightfield::Heightfield(MapImpl *map) : map(map)
+{}
+
+bool Heightfield::getSurfaceOverEllipsoid(double &result, const vec3 &navPos,
+    double sampleSize, bool *complete)
+{
+    if (!camera)
+    {
+        camera = std::make_shared<CameraImpl>(map, nullptr);
+        camera->persistentSurfaceSamples = true;
+    }
+    // the loads are prioritized by the distance from the latest query
+    camera->focusPosPhys = map->convertor->navToPhys(navPos);
+    return camera->getSurfaceOverEllipsoid(result, navPos, sampleSize,
+        false, complete);
+}
+
+void Heightfield::update()
+{
+    OPTICK_EVENT();
+    if (!camera)
+        return;
+    const uint32 capacity = map->options.heightfieldMemoryKB * 1024
+        / sampleMemoryCost();
+    // the camera clears all samples only as a last resort
+    camera->maxSurfaceSamples = capacity * 2 + 1;
+    auto &samples = camera->surfaceSamples;
+    if (samples.size() <= capacity)
+        return;
+
+    // keep three quarters of the capacity
+    std::vector<std::pair<uint32, TileId>> ticks;
+    ticks.reserve(samples.size());
+    for (const auto &it : samples)
+        ticks.emplace_back(it.second.lastAccessTick, it.first);
+    const uint32 remove = samples.size() - capacity * 3 / 4;
+    std::nth_element(ticks.begin(), ticks.begin() + remove, ticks.end(),
+        [](const std::pair<uint32, TileId> &a,
+            const std::pair<uint32, TileId> &b) {
+            return a.first < b.first;
+        });
+    for (uint32 i = 0; i < remove; i++)
+        samples.erase(ticks[i].second);
+}
+
+void Heightfield::purge()
+{
+    // the camera holds state of the layers
+    camera.reset();
+}
+
+uint32 Heightfield::memoryCost() const
+{
+    if (!camera)
+        return 0;
+    return camera->surfaceSamples.size() * sampleMemoryCost();
+}
+
+} // namespace vts
@@ -28,6 +28,9 @@
 #include "../include/vts-browser/cameraDraws.hpp"
 #include "../include/vts-browser/cameraOptions.hpp"
 #include "../include/vts-browser/cameraStatistics.hpp"
+#include "../include/vts-browser/offline.hpp"
+#include "../include/vts-browser/altitude.hpp"
+#include "../include/vts-browser/preload.hpp"
 
 #include "../navigation.hpp"
 #include "../camera.hpp"
@@ -38,8 +41,14 @@
 #include "../credits.hpp"
 #include "../coordsManip.hpp"
 #include "../resources.hpp"
+#include "../offlineTask.hpp"
+#include "../altitudeTask.hpp"
+#include "../preloadTask.hpp"
+#include "../heightfield.hpp"
 #include "../map.hpp"
 
+#include <algorithm>
+
 #include <optick.h>
 
 namespace vts
@@ -53,6 +62,19 @@ MapImpl::MapImpl(Map *map, const MapCreateOptions &options,
     this->fetcher = fetcher;
     resources = std::make_shared<Resources>(this);
     credits = std::make_shared<Credits>();
+    heightfield = std::make_shared<Heightfield>(this);
+}
+
+MapImpl::MapImpl(Map *map, const MapCreateOptions &options,
+    const std::shared_ptr<Map> &resourcesOwner, MapImpl *owner) :
+    map(map), createOptions(options), resourcesOwner(resourcesOwner)
+{
+    assert(resourcesOwner);
+    assert(owner && !owner->resourcesOwner);
+    fetcher = owner->fetcher;
+    resources = owner->resources;
+    credits = std::make_shared<Credits>();
+    heightfield = std::make_shared<Heightfield>(this);
 }
 
 MapImpl::~MapImpl()
@@ -63,10 +85,23 @@ void MapImpl::renderUpdate(double elapsedTime)
     OPTICK_EVENT();
     OPTICK_TAG("elapsedTime", (float)elapsedTime);
     lastElapsedFrameTime = elapsedTime;
+    if (updateTracking)
+        updateOptions = options.toJson();
 
-    if (!prerequisitesCheck())
+    const bool ready = prerequisitesCheck();
+    workingSetUpdate();
+    if (!ready)
         return;
 
+    // previous frame of all cameras
+    if (statistics.timeToFirstDraw > 0 && statistics.timeToRenderComplete == 0
+        && getMapRenderComplete())
+    {
+        statistics.timeToRenderComplete = millisSinceMapconfigPath();
+        LOG(info3) << "Map render is complete (after "
+            << statistics.timeToRenderComplete << " ms).";
+    }
+
     assert(!auth || *auth);
     assert(mapconfig && *mapconfig);
     assert(convertor);
@@ -74,6 +109,11 @@ void MapImpl::renderUpdate(double elapsedTime)
     assert(layers[0]->traverseRoot);
 
     updateSearch();
+    updateOffline();
+    updateAltitudes();
+    updatePreloads();
+    heightfield->update();
+    statistics.currentHeightfieldMemUseKB = heightfield->memoryCost() / 1024;
 
     cameras.erase(std::remove_if(cameras.begin(), cameras.end(),
         [&](std::weak_ptr<CameraImpl> &camera) {
@@ -82,8 +122,29 @@ void MapImpl::renderUpdate(double elapsedTime)
 
     {
         OPTICK_EVENT("traverseClearing");
-        for (auto &it : layers)
-            traverseClearing(it->traverseRoot.get());
+        const auto deadline = std::chrono::steady_clock::now()
+            + std::chrono::microseconds(
+                (sint64)(options.traverseClearingBudget * 1000));
+        // start with different layer each frame
+        //   so that all of them progress when the budget is short
+        const uint32 cnt = layers.size();
+        for (uint32 i = 0; i < cnt; i++)
+            if (!traverseClearing(layers[(renderTickIndex + i) % cnt].get(),
+                deadline))
+                break;
+    }
+
+    {
+        uint64 m = 0;
+        uint32 n = 0;
+        for (const auto &l : layers)
+        {
+            m += l->traverseChildsPool->memoryCost()
+                + l->traverseIndex->memoryCost();
+            n += l->traverseIndex->size();
+        }
+        statistics.currentTraverseMemUseKB = m / 1024;
+        statistics.currentTraverseNodes = n;
     }
 }
 
@@ -117,8 +178,16 @@ void MapImpl::purgeMapconfig()
 
     credits->purge();
     searchTasks.clear();
+    searchCache.clear();
+    for (auto &it : offlineTasks)
+    {
+        auto t = it.lock();
+        if (t)
+            t->impl->initialized = false;
+    }
     convertor.reset();
     body = MapCelestialBody();
+    workingSet.clear();
     purgeViewCache();
 
     for (auto &camera : cameras)
@@ -138,6 +207,166 @@ void MapImpl::purgeMapconfig()
     }
 }
 
+namespace
+{
+
+bool sameBoundLayers(const vtslibs::registry::View::BoundLayerParams::list &a,
+    const vtslibs::registry::View::BoundLayerParams::list &b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+        [](const vtslibs::registry::View::BoundLayerParams &x,
+            const vtslibs::registry::View::BoundLayerParams &y) {
+            return x.id == y.id && x.alpha == y.alpha;
+        });
+}
+
+enum class LayerChange
+{
+    None,
+    BoundLayers, // the surface stack is still valid
+    All,
+};
+
+LayerChange compareSurfaces(const vtslibs::registry::View::Surfaces &a,
+    const vtslibs::registry::View::Surfaces &b)
+{
+    if (a.size() != b.size())
+        return LayerChange::All;
+    LayerChange r = LayerChange::None;
+    for (auto ia = a.begin(), ib = b.begin(); ia != a.end(); ia++, ib++)
+    {
+        if (ia->first != ib->first)
+            return LayerChange::All;
+        if (!sameBoundLayers(ia->second, ib->second))
+            r = LayerChange::BoundLayers;
+    }
+    return r;
+}
+
+} // namespace
+
+void MapImpl::switchView()
+{
+    OPTICK_EVENT();
+    if (layers.empty())
+        return purgeViewCache();
+
+    LOG(info2) << "Switch view";
+    mapconfig->consolidateView();
+    const vtslibs::registry::View &view = mapconfig->view;
+
+    std::vector<std::shared_ptr<MapLayer>> previous;
+    previous.swap(layers);
+    std::vector<std::shared_ptr<MapLayer>> reset; // camera state is dropped
+    uint32 kept = 0;
+
+    // main surface stack
+    const std::shared_ptr<MapLayer> &main = previous[0];
+    const LayerChange mainChange
+        = compareSurfaces(main->boundLayerParams, view.surfaces);
+    switch (mainChange)
+    {
+    case LayerChange::All:
+        layers.push_back(std::make_shared<MapLayer>(this));
+        break;
+    case LayerChange::BoundLayers:
+        main->boundLayerParams = view.surfaces;
+        main->resetTraversal();
+        reset.push_back(main);
+        layers.push_back(main);
+        break;
+    case LayerChange::None:
+        layers.push_back(main);
+        kept++;
+        break;
+    }
+
+    // free layers are matched by name
+    for (const auto &it : view.freeLayers)
+    {
+        auto p = std::find_if(previous.begin() + 1, previous.end(),
+            [&](const std::shared_ptr<MapLayer> &l) {
+                return l->freeLayerName == it.first;
+            });
+        if (p == previous.end() || (*p)->freeLayerParams->style
+            != it.second.style || (*p)->prerequisitesFailed)
+        {
+            layers.push_back(std::make_shared<MapLayer>(this, it.first,
+                it.second));
+            continue;
+        }
+        const std::shared_ptr<MapLayer> &l = *p;
+        if (!sameBoundLayers(l->freeLayerParams->boundLayers,
+            it.second.boundLayers))
+        {
+            l->freeLayerParams = it.second;
+            l->boundLayerParams[""] = it.second.boundLayers;
+            l->resetTraversal();
+            reset.push_back(l);
+        }
+        else
+            kept++;
+        layers.push_back(l);
+    }
+
+    LOG(info2) << "Kept " << kept << " out of " << layers.size()
+        << " layers";
+
+    mapconfigReady = false;
+    metaNodesEpoch++;
+    if (mainChange != LayerChange::None)
+        heightfield->purge();
+
+    for (auto &it : altitudeTasks)
+    {
+        auto t = it.lock();
+        if (t)
+            t->impl->initialized = false;
+    }
+
+    for (auto &it : preloadTasks)
+    {
+        auto t = it.lock();
+        if (t)
+            t->impl->initialized = false;
+    }
+
+    for (auto &camera : cameras)
+    {
+        auto cam = camera.lock();
+        if (!cam)
+            continue;
+        // the removed layers are forgotten by the camera on its own
+        //   but the reset ones must not keep pointers to the old nodes
+        for (auto &l : reset)
+            cam->layers.erase(l);
+        cam->credits.clear();
+        if (mainChange != LayerChange::None)
+        {
+            cam->surfaceSamples.clear();
+            if (auto nav = cam->navigation.lock())
+                nav->suspendAltitudeChange = true;
+        }
+    }
+}
+
+bool MapImpl::updateNeeded()
+{
+    if (!updateTracking)
+    {
+        // the state of the last update is not known yet
+        updateTracking = true;
+        return true;
+    }
+    if (!mapconfigReady || !getMapRenderComplete())
+        return true;
+    if (!searchTasks.empty() || !offlineTasks.empty()
+        || !altitudeTasks.empty() || !preloadTasks.empty()
+        || !workingSetPending.empty() || !workingSet.empty())
+        return true;
+    return options.toJson() != updateOptions;
+}
+
 void MapImpl::purgeViewCache()
 {
     OPTICK_EVENT();
@@ -148,6 +377,21 @@ void MapImpl::purgeViewCache()
     mapconfigReady = false;
     mapconfigView = "";
     layers.clear();
+    heightfield->purge();
+
+    for (auto &it : altitudeTasks)
+    {
+        auto t = it.lock();
+        if (t)
+            t->impl->initialized = false;
+    }
+
+    for (auto &it : preloadTasks)
+    {
+        auto t = it.lock();
+        if (t)
+            t->impl->initialized = false;
+    }
 
     for (auto &camera : cameras)
     {
@@ -157,6 +401,7 @@ void MapImpl::purgeViewCache()
             cam->statistics = CameraStatistics();
             cam->draws = CameraDraws();
             cam->credits.clear();
+            cam->surfaceSamples.clear();
             auto nav = cam->navigation.lock();
             if (nav)
             {
@@ -166,6 +411,48 @@ void MapImpl::purgeViewCache()
     }
 }
 
+void MapImpl::memoryPressure(MemoryPressure level)
+{
+    OPTICK_EVENT();
+    const uint64 before = resources->memRamUse + resources->memGpuUse;
+
+    // the traverse nodes hold the resources for their renders
+    if (level != MemoryPressure::Moderate)
+    {
+        OPTICK_EVENT("traverseClearing");
+        for (auto &camera : cameras)
+        {
+            auto cam = camera.lock();
+            if (cam)
+            {
+                for (auto &it : cam->layers)
+                    it.second.coherentFrontier.clear();
+                cam->surfaceSamples.clear();
+            }
+        }
+        heightfield->purge();
+        for (auto &it : layers)
+        {
+            it->traverseClearingStack.clear();
+            if (!it->traverseRoot)
+                continue;
+            if (level == MemoryPressure::Critical)
+            {
+                it->traverseRoot->clearAll();
+                metaNodesEpoch++;
+            }
+            else
+                traverseClearing(it->traverseRoot.get(), 0);
+        }
+    }
+
+    resources->memoryPressure(level);
+
+    const uint64 after = resources->memRamUse + resources->memGpuUse;
+    LOG(info3) << "Memory pressure (level " << (int)level << ") released "
+        << (before > after ? (before - after) / 1024 : 0) << " KB";
+}
+
 void MapImpl::setMapconfigPath(const std::string &mapconfigPath,
     const std::string &authPath)
 {
@@ -174,9 +461,20 @@ void MapImpl::setMapconfigPath(const std::string &mapconfigPath,
         << " authentication";
     this->mapconfigPath = mapconfigPath;
     this->authPath = authPath;
+    mapconfigPathTime = std::chrono::steady_clock::now();
+    statistics.timeToMapconfigAvailable = 0;
+    statistics.timeToMapconfigReady = 0;
+    statistics.timeToFirstDraw = 0;
+    statistics.timeToRenderComplete = 0;
     purgeMapconfig();
 }
 
+double MapImpl::millisSinceMapconfigPath() const
+{
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - mapconfigPathTime).count();
+}
+
 bool MapImpl::prerequisitesCheck()
 {
     OPTICK_EVENT();
@@ -185,7 +483,10 @@ bool MapImpl::prerequisitesCheck()
         auth->checkTime();
 
     if (mapconfigReady)
+    {
+        freeLayersCheck();
         return true;
+    }
 
     if (mapconfigPath.empty())
         return false;
@@ -213,13 +514,16 @@ bool MapImpl::prerequisitesCheck()
         initializeNavigation();
         mapconfig->initializeCelestialBody();
 
-        LOG(info3) << "Mapconfig is available.";
+        statistics.timeToMapconfigAvailable = millisSinceMapconfigPath();
+        LOG(info3) << "Mapconfig is available (after "
+            << statistics.timeToMapconfigAvailable << " ms).";
         mapconfigAvailable = true;
         if (callbacks.mapconfigAvailable)
         {
             // this may change mapconfigAvailable
             callbacks.mapconfigAvailable();
-            return false;
+            if (!mapconfigAvailable)
+                return false;
         }
     }
 
@@ -234,32 +538,90 @@ bool MapImpl::prerequisitesCheck()
                 it.second));
     }
 
-    // check all layers
+    // only the main surfaces are required
+    //   the free layers come online independently
+    freeLayersCheck();
+    if (!layers[0]->prerequisitesCheck())
     {
-        bool ok = true;
-        for (auto &it : layers)
-        {
-            if (!it->prerequisitesCheck())
-                ok = false;
-        }
-        if (!ok)
-            return false;
+        prerequisitesPrefetch();
+        return false;
     }
 
-    LOG(info3) << "Mapconfig is ready.";
+    statistics.timeToMapconfigReady = millisSinceMapconfigPath();
+    LOG(info3) << "Mapconfig is ready (after "
+        << statistics.timeToMapconfigReady << " ms).";
     mapconfigReady = true;
     if (callbacks.mapconfigReady)
         callbacks.mapconfigReady(); // this may change mapconfigReady
     return mapconfigReady;
 }
 
-void MapImpl::traverseClearing(TraverseNode *trav)
+// a slow or failing free layer config does not delay the rest of the map
+void MapImpl::freeLayersCheck()
 {
-    if (std::max(trav->lastAccessTime, trav->lastRenderTime) + 5
+    for (auto &it : layers)
+    {
+        if (!it->freeLayerParams || it->traverseRoot
+            || it->prerequisitesFailed)
+            continue;
+        try
+        {
+            if (it->prerequisitesCheck())
+            {
+                LOG(info2) << "Free layer <" << it->freeLayerName
+                    << "> is ready";
+            }
+        }
+        catch (const MapconfigException &e)
+        {
+            LOG(err3) << "Free layer <" << it->freeLayerName
+                << "> is unavailable: " << e.what();
+            it->prerequisitesFailed = true;
+        }
+    }
+}
+
+// requests everything referenced by the mapconfig at once
+//   instead of waiting for the layers and the traversal to discover it
+// the resources are touched every tick until the map is ready
+void MapImpl::prerequisitesPrefetch()
+{
+    OPTICK_EVENT();
+
+    // bound layers of the view
+    for (const auto &it : mapconfig->view.surfaces)
+        for (const auto &b : it.second)
+            mapconfig->getBoundInfo(b.id);
+    for (const auto &it : mapconfig->view.freeLayers)
+        for (const auto &b : it.second.boundLayers)
+            mapconfig->getBoundInfo(b.id);
+
+    // stylesheets and root metatiles of layers that are already defined
+    const UrlTemplate::Vars rootVars(roundId(TileId()));
+    for (const auto &layer : layers)
+    {
+        if (!layer->traverseRoot)
+            continue;
+        if (layer->isGeodata())
+            getActualGeoStyle(layer->freeLayerName);
+        if (layer->freeLayer && layer->freeLayer->type
+            == vtslibs::registry::FreeLayer::Type::geodata)
+            continue; // monolithic, without metatiles
+        for (const auto &s : layer->surfaceStack.surfaces)
+            getMetaTile(s.urlMeta(rootVars))->updatePriority(inf1());
+    }
+}
+
+void MapImpl::traverseClearing(TraverseNode *trav, uint32 keepTicks)
+{
+    if (std::max(trav->lastAccessTime, trav->lastRenderTime) + keepTicks
                 < renderTickIndex)
     {
         if (trav->meta)
+        {
             trav->clearAll();
+            metaNodesEpoch++;
+        }
         assert(trav->childs.empty());
         assert(trav->rendersEmpty());
         assert(!trav->surface);
@@ -267,7 +629,7 @@ void MapImpl::traverseClearing(TraverseNode *trav)
         return;
     }
 
-    if (trav->lastRenderTime + 5 < renderTickIndex)
+    if (trav->lastRenderTime + keepTicks < renderTickIndex)
     {
         if (trav->determined)
             trav->clearRenders();
@@ -276,7 +638,75 @@ void MapImpl::traverseClearing(TraverseNode *trav)
     }
 
     for (auto &it : trav->childs)
-        traverseClearing(&it);
+        traverseClearing(&it, keepTicks);
+}
+
+// returns false when the budget was exhausted
+bool MapImpl::traverseClearing(MapLayer *layer,
+    std::chrono::steady_clock::time_point deadline)
+{
+    if (!layer->traverseRoot)
+        return true;
+    const bool limited = options.traverseClearingBudget > 0;
+    auto &stack = layer->traverseClearingStack;
+    if (stack.empty())
+        stack.push_back({ layer->traverseRoot.get(), false });
+    const auto stale = [&](const TraverseNode *trav) {
+        return std::max(trav->lastAccessTime, trav->lastRenderTime) + 5
+            < renderTickIndex;
+    };
+    uint32 visited = 0;
+    while (!stack.empty())
+    {
+        if (limited && (++visited % 64) == 0
+            && std::chrono::steady_clock::now() > deadline)
+            return false;
+
+        const MapLayer::ClearingEntry e = stack.back();
+        stack.pop_back();
+        TraverseNode *trav = e.trav;
+
+        if (stale(trav))
+        {
+            if (!trav->meta)
+            {
+                assert(trav->childs.empty());
+                assert(trav->rendersEmpty());
+                assert(!trav->determined);
+                continue;
+            }
+            // large subtrees are released gradually
+            if (!e.childsCleared && !trav->childs.empty())
+            {
+                stack.push_back({ trav, true });
+                for (auto &it : trav->childs)
+                    stack.push_back({ &it, false });
+                continue;
+            }
+            // the children are cleared already
+            //   and their arrays return to the pool of the layer
+            trav->clearAll();
+            metaNodesEpoch++;
+            statistics.traverseNodesCleared++;
+            continue;
+        }
+
+        // the node was used again while its children were being cleared
+        if (e.childsCleared)
+            continue;
+
+        if (trav->lastRenderTime + 5 < renderTickIndex)
+        {
+            if (trav->determined)
+                trav->clearRenders();
+            assert(trav->rendersEmpty());
+            assert(!trav->determined);
+        }
+
+        for (auto &it : trav->childs)
+            stack.push_back({ &it, false });
+    }
+    return true;
 }
 
 TileId MapImpl::roundId(TileId nodeId)
@@ -324,6 +754,8 @@ TraverseNode *findTravById(TraverseNode *trav, const TileId &what)
         return nullptr;
     if (trav->id == what)
         return trav;
+    if (trav->layer)
+        return trav->layer->traverseIndex->find(what);
     while (what.lod <= trav->id.lod)
         trav = trav->parent;
     while (trav->id.lod != what.lod)
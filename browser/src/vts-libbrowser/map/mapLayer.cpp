@@ -43,6 +43,8 @@ MapLayer::MapLayer(MapImpl *map) : map(map),
     creditScope(Credits::Scope::Imagery)
 {
     boundLayerParams = map->mapconfig->view.surfaces;
+    traverseChildsPool = std::make_unique<TraverseChildsPool>();
+    traverseIndex = std::make_unique<TraverseNodeIndex>();
 }
 
 MapLayer::MapLayer(MapImpl *map, const std::string &name,
@@ -51,6 +53,8 @@ MapLayer::MapLayer(MapImpl *map, const std::string &name,
       creditScope(Credits::Scope::Imagery)
 {
     boundLayerParams[""] = params.boundLayers;
+    traverseChildsPool = std::make_unique<TraverseChildsPool>();
+    traverseIndex = std::make_unique<TraverseNodeIndex>();
 }
 
 bool MapLayer::prerequisitesCheck()
@@ -62,6 +66,15 @@ bool MapLayer::prerequisitesCheck()
     return prerequisitesCheckMainSurfaces();
 }
 
+void MapLayer::resetTraversal()
+{
+    traverseClearingStack.clear();
+    if (!traverseRoot)
+        return;
+    traverseRoot = std::make_unique<TraverseNode>(this, nullptr, TileId());
+    traverseRoot->priority = inf1();
+}
+
 bool MapLayer::isGeodata() const
 {
     if (freeLayer)
@@ -176,6 +189,7 @@ MapLayer *getLayer(MapImpl *map, const std::string &name)
 std::pair<Validity, std::shared_ptr<GeodataStylesheet>>
     MapImpl::getActualGeoStyle(const std::string &name)
 {
+    auto lock = traversalLock();
     FreeInfo *f = mapconfig->getFreeInfo(name);
     if (!f)
         return { Validity::Indeterminate, {} };
@@ -227,8 +241,10 @@ std::pair<Validity, std::shared_ptr<GeodataStylesheet>>
 
 std::pair<Validity, std::shared_ptr<const std::string>>
     MapImpl::getActualGeoFeatures(const std::string &name,
-        const std::string &geoName, float priority)
+        const std::string &geoName, float priority,
+        std::shared_ptr<GeodataFeatures> &handle)
 {
+    auto lock = traversalLock();
     MapLayer *layer = getLayer(this, name);
     if (!layer)
         return { Validity::Invalid, {} };
@@ -238,12 +254,16 @@ std::pair<Validity, std::shared_ptr<const std::string>>
             && layer->freeLayer->overrideGeodata)
         return { Validity::Valid, layer->freeLayer->overrideGeodata };
 
-    if (geoName.empty())
-        return { Validity::Invalid, {} };
-
-    auto g = getGeoFeatures(geoName);
-    g->updatePriority(priority);
-    return { getResourceValidity(g), g->data };
+    if (!handle)
+    {
+        if (geoName.empty())
+            return { Validity::Invalid, {} };
+        handle = getGeoFeatures(geoName);
+    }
+    else
+        touchResource(handle);
+    handle->updatePriority(priority);
+    return { getResourceValidity(handle), handle->data };
 }
 
 std::pair<Validity, std::shared_ptr<const std::string>>
@@ -252,8 +272,9 @@ std::pair<Validity, std::shared_ptr<const std::string>>
     MapLayer *layer = getLayer(this, name);
     assert(layer->freeLayer->type
            == vtslibs::registry::FreeLayer::Type::geodata);
+    std::shared_ptr<GeodataFeatures> handle;
     return getActualGeoFeatures(name,
-        layer->surfaceStack.surfaces[0].urlGeodata({}), inf1());
+        layer->surfaceStack.surfaces[0].urlGeodata({}), inf1(), handle);
 }
 
 } // namespace vts
@@ -0,0 +1,253 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "../include/vts-browser/offline.hpp"
+
+#include "../offlineTask.hpp"
+#include "../camera.hpp"
+#include "../traverseNode.hpp"
+#include "../mapLayer.hpp"
+#include "../coordsManip.hpp"
+#include "../map.hpp"
+
+#include <optick.h>
+
+namespace vts
+{
+
+namespace
+{
+
+// maximum number of unfinished tiles processed by one task per update
+//   it bounds the number of downloads issued by the task at any time
+static const uint32 MaxOfflineNodes = 100;
+
+// number of samples along each horizontal axis of the region
+//   used to find its physical bounding box
+static const uint32 RegionSamples = 9;
+
+bool aabbOverlap(const vec3 a[2], const vec3 b[2])
+{
+    for (uint32 i = 0; i < 3; i++)
+        if (a[1][i] < b[0][i] || b[1][i] < a[0][i])
+            return false;
+    return true;
+}
+
+class OfflineTraversal
+{
+public:
+    OfflineTraversal(MapImpl *map, OfflineTask *task, OfflineTaskImpl *impl,
+        std::unordered_set<TileId> &finished, uint32 &budget) :
+        map(map), task(task), impl(impl),
+        camera(impl->camera.get()), finished(finished), budget(budget)
+    {}
+
+    // returns true when the whole subtree is finished
+    bool traverse(TraverseNode *trav)
+    {
+        if (finished.count(trav->id))
+            return true;
+        if (budget == 0)
+            return false;
+
+        if (!camera->travInit(trav))
+        {
+            if (metaTilesFailed(trav))
+            {
+                task->tilesFailed++;
+                finished.insert(trav->id);
+                return true;
+            }
+            budget--;
+            return false;
+        }
+
+        if (!aabbOverlap(trav->meta->aabbPhys, impl->aabbPhys))
+        {
+            finished.insert(trav->id);
+            return true;
+        }
+
+        bool ok = true;
+        const bool inRange = trav->id.lod >= task->lodMin;
+        if (inRange && trav->surface && !trav->determined)
+        {
+            // the resources may not be unloaded
+            trav->lastRenderTime = trav->lastAccessTime;
+            if (!camera->travDetermineDraws(trav) && trav->surface)
+            {
+                budget--;
+                ok = false;
+            }
+        }
+
+        if (trav->id.lod < task->lodMax)
+        {
+            for (auto &t : trav->childs)
+                ok = traverse(&t) && ok;
+        }
+        if (!ok)
+            return false;
+
+        // the finished node covers its entire subtree
+        for (auto &t : trav->childs)
+            finished.erase(t.id);
+        finished.insert(trav->id);
+        if (inRange)
+            task->tilesDone++;
+        return true;
+    }
+
+private:
+    bool metaTilesFailed(TraverseNode *trav)
+    {
+        if (trav->metaTiles.empty())
+            return false;
+        for (const auto &m : trav->metaTiles)
+            if (m && map->getResourceValidity(m) == Validity::Indeterminate)
+                return false;
+        return true;
+    }
+
+    MapImpl *const map;
+    OfflineTask *const task;
+    OfflineTaskImpl *const impl;
+    CameraImpl *const camera;
+    std::unordered_set<TileId> &finished;
+    uint32 &budget;
+};
+
+} // namespace
+
+OfflineTask::OfflineTask(const double extentsLl[3],
+    const double extentsUr[3], uint32 lodMin, uint32 lodMax) :
+    extentsLl{extentsLl[0], extentsLl[1], extentsLl[2]},
+    extentsUr{extentsUr[0], extentsUr[1], extentsUr[2]},
+    lodMin(lodMin), lodMax(lodMax),
+    tilesDone(0), tilesFailed(0), tilesPending(0), done(false)
+{}
+
+std::shared_ptr<OfflineTask> MapImpl::downloadRegion(
+    const double extentsLl[3], const double extentsUr[3],
+    uint32 lodMin, uint32 lodMax)
+{
+    OPTICK_EVENT();
+    if (lodMin > lodMax)
+    {
+        LOGTHROW(err2, std::invalid_argument)
+            << "Invalid lod range for the offline region";
+    }
+    if (!createOptions.diskCache)
+    {
+        LOG(warn3) << "Offline region is downloaded without disk cache";
+    }
+    auto t = std::make_shared<OfflineTask>(
+        extentsLl, extentsUr, lodMin, lodMax);
+    t->impl = std::make_shared<OfflineTaskImpl>();
+    offlineTasks.push_back(t);
+    return t;
+}
+
+void MapImpl::initializeOffline(OfflineTask *task)
+{
+    OfflineTaskImpl *impl = task->impl.get();
+    impl->camera = std::make_shared<CameraImpl>(this, nullptr);
+    impl->finished.clear();
+    impl->finished.resize(layers.size());
+    task->tilesDone = 0;
+    task->tilesFailed = 0;
+    task->tilesPending = 0;
+
+    // physical bounding box of the region
+    const vec3 ll = rawToVec3(task->extentsLl);
+    const vec3 ur = rawToVec3(task->extentsUr);
+    impl->aabbPhys[0] = vec3(inf1(), inf1(), inf1());
+    impl->aabbPhys[1] = -impl->aabbPhys[0];
+    for (uint32 y = 0; y < RegionSamples; y++)
+    {
+        for (uint32 x = 0; x < RegionSamples; x++)
+        {
+            for (uint32 z = 0; z < 2; z++)
+            {
+                vec3 n = vec3(
+                    interpolate(ll[0], ur[0], x / (RegionSamples - 1.0)),
+                    interpolate(ll[1], ur[1], y / (RegionSamples - 1.0)),
+                    z ? ur[2] : ll[2]);
+                vec3 p = convertor->convert(n, Srs::Navigation, Srs::Physical);
+                impl->aabbPhys[0] = min(impl->aabbPhys[0], p);
+                impl->aabbPhys[1] = max(impl->aabbPhys[1], p);
+            }
+        }
+    }
+
+    // the tiles are prioritized below anything visible
+    //   the same way as prefetching
+    impl->camera->focusPosPhys = (impl->aabbPhys[0] + impl->aabbPhys[1]) * 0.5;
+    impl->camera->prefetching = true;
+    impl->initialized = true;
+}
+
+void MapImpl::updateOffline()
+{
+    OPTICK_EVENT();
+    auto it = offlineTasks.begin();
+    while (it != offlineTasks.end())
+    {
+        std::shared_ptr<OfflineTask> t = it->lock();
+        if (!t)
+        {
+            it = offlineTasks.erase(it);
+            continue;
+        }
+        if (!t->impl->initialized)
+            initializeOffline(t.get());
+
+        uint32 budget = MaxOfflineNodes;
+        bool finished = true;
+        for (uint32 i = 0, e = layers.size(); i != e; i++)
+        {
+            const auto &l = layers[i];
+            if (l->surfaceStack.surfaces.empty())
+                continue;
+            OfflineTraversal trav(this, t.get(), t->impl.get(),
+                t->impl->finished[i], budget);
+            finished = trav.traverse(l->traverseRoot.get()) && finished;
+        }
+        t->tilesPending = MaxOfflineNodes - budget;
+
+        if (finished)
+        {
+            t->done = true;
+            it = offlineTasks.erase(it);
+        }
+        else
+            it++;
+    }
+}
+
+} // namespace vts
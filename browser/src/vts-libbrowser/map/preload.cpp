@@ -0,0 +1,262 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/preload.hpp"
+#include "../include/vts-browser/position.hpp"
+
+#include "../preloadTask.hpp"
+#include "../navigation.hpp"
+#include "../camera.hpp"
+#include "../traverseNode.hpp"
+#include "../mapLayer.hpp"
+#include "../position.hpp"
+#include "../map.hpp"
+
+#include <optick.h>
+
+namespace vts
+{
+
+namespace
+{
+
+// maximum number of nodes processed by one task per update
+static const uint32 MaxPreloadNodes = 5000;
+
+// used when no camera of the map has a viewport yet
+static const uint32 DefaultViewportWidth = 1920;
+static const uint32 DefaultViewportHeight = 1080;
+
+bool metaTilesFailed(MapImpl *map, TraverseNode *trav)
+{
+    if (trav->metaTiles.empty())
+        return false;
+    for (const auto &m : trav->metaTiles)
+        if (m && map->getResourceValidity(m) == Validity::Indeterminate)
+            return false;
+    return true;
+}
+
+// load-only traversal of the target view
+struct PreloadTraversal
+{
+    CameraImpl *const camera;
+    uint32 budget = MaxPreloadNodes;
+    uint32 leaves = 0; // nodes that would be rendered
+    uint32 ready = 0; // leaves with all draws determined
+    uint32 pending = 0; // nodes not reached yet
+
+    explicit PreloadTraversal(CameraImpl *camera) : camera(camera)
+    {}
+
+    void traverse(TraverseNode *trav)
+    {
+        if (budget == 0)
+        {
+            pending++;
+            return;
+        }
+        budget--;
+
+        if (!camera->travInit(trav))
+        {
+            if (!metaTilesFailed(camera->map, trav))
+                pending++;
+            return;
+        }
+
+        if (!camera->visibilityTest(trav))
+            return;
+
+        if (camera->coarsenessTest(trav) || trav->childs.empty())
+        {
+            // the resources may not be unloaded
+            trav->lastRenderTime = trav->lastAccessTime;
+            bool determined = camera->travDetermineDraws(trav);
+            if (trav->surface)
+            {
+                leaves++;
+                if (determined)
+                    ready++;
+            }
+            return;
+        }
+
+        for (auto &t : trav->childs)
+            traverse(&t);
+    }
+};
+
+} // namespace
+
+PreloadTask::PreloadTask(double duration, double priority) :
+    duration(duration), priority(priority), progress(0), done(false)
+{}
+
+std::shared_ptr<PreloadTask> MapImpl::preload(const Position &position,
+    double duration, double priority)
+{
+    OPTICK_EVENT();
+    if (!(duration >= 0))
+    {
+        LOGTHROW(err2, std::invalid_argument)
+            << "Invalid duration for the preload";
+    }
+    if (!(priority > 0 && priority <= 1))
+    {
+        LOGTHROW(err2, std::invalid_argument)
+            << "Invalid priority for the preload";
+    }
+    auto t = std::make_shared<PreloadTask>(duration, priority);
+    t->impl = std::make_shared<PreloadTaskImpl>();
+    t->impl->position = p2p(position);
+    t->impl->created = std::chrono::steady_clock::now();
+    preloadTasks.push_back(t);
+    return t;
+}
+
+void MapImpl::initializePreload(PreloadTask *task)
+{
+    PreloadTaskImpl *impl = task->impl.get();
+    impl->camera = std::make_shared<CameraImpl>(this, nullptr);
+    CameraImpl *cam = impl->camera.get();
+
+    // reuse the settings of the first camera with a viewport
+    cam->windowWidth = DefaultViewportWidth;
+    cam->windowHeight = DefaultViewportHeight;
+    for (auto &camera : cameras)
+    {
+        auto c = camera.lock();
+        if (c && c->windowWidth > 0 && c->windowHeight > 0)
+        {
+            cam->options = c->options;
+            cam->windowWidth = c->windowWidth;
+            cam->windowHeight = c->windowHeight;
+            cam->resolutionScale = c->resolutionScale;
+            break;
+        }
+    }
+    cam->options.debugDetachedCamera = false;
+    cam->prefetching = true;
+    cam->prefetchWeight = (float)task->priority;
+    impl->viewResolved = false;
+    impl->initialized = true;
+}
+
+// returns false while the view is only an approximation
+bool MapImpl::preloadView(PreloadTask *task)
+{
+    PreloadTaskImpl *impl = task->impl.get();
+    CameraImpl *cam = impl->camera.get();
+
+    NavigationImpl nav(cam, nullptr);
+    nav.setPosition(impl->position);
+    nav.position = nav.targetPosition;
+    nav.orientation = nav.targetOrientation;
+    nav.verticalExtent = nav.targetVerticalExtent;
+
+    // floating altitude is relative to the surface
+    bool resolved = true;
+    vec3 p = nav.position;
+    if (nav.heightMode == NavigationImpl::HeightMode::floating)
+    {
+        double altitude = 0;
+        bool complete = false;
+        if (cam->getSurfaceOverEllipsoid(altitude, p, -1, false, &complete))
+            p[2] += altitude;
+        resolved = complete;
+    }
+
+    vec3 center, forward, up;
+    nav.positionToCamera(center, forward, up, nav.orientation, p);
+    if (nav.type == NavigationImpl::Type::objective)
+    {
+        cam->eye = center - forward * nav.objectiveDistance();
+        cam->target = center;
+    }
+    else
+    {
+        cam->eye = center;
+        cam->target = center + forward;
+    }
+    cam->up = up;
+
+    double n, f;
+    cam->suggestedNearFar(n, f);
+    cam->apiProj = perspectiveMatrix(nav.verticalFov,
+        (double)cam->windowWidth / (double)cam->windowHeight, n, f);
+    cam->updateRenderVariables();
+    return resolved;
+}
+
+void MapImpl::updatePreloads()
+{
+    OPTICK_EVENT();
+    const auto now = std::chrono::steady_clock::now();
+    auto it = preloadTasks.begin();
+    while (it != preloadTasks.end())
+    {
+        std::shared_ptr<PreloadTask> t = it->lock();
+        if (!t)
+        {
+            it = preloadTasks.erase(it);
+            continue;
+        }
+        PreloadTaskImpl *impl = t->impl.get();
+        if (t->duration > 0 && std::chrono::duration<double>(
+            now - impl->created).count() > t->duration)
+        {
+            impl->camera.reset();
+            it = preloadTasks.erase(it);
+            continue;
+        }
+        if (!impl->initialized)
+            initializePreload(t.get());
+        if (!impl->viewResolved)
+            impl->viewResolved = preloadView(t.get());
+
+        CameraImpl *cam = impl->camera.get();
+        PreloadTraversal trav(cam);
+        for (auto &l : layers)
+        {
+            if (l->surfaceStack.surfaces.empty())
+                continue;
+            if ((l->isGeodata() ? cam->options.traverseModeGeodata
+                : cam->options.traverseModeSurfaces) == TraverseMode::None)
+                continue;
+            trav.traverse(l->traverseRoot.get());
+        }
+        cam->statistics = CameraStatistics();
+
+        const uint32 total = trav.leaves + trav.pending;
+        t->progress = total > 0 ? (double)trav.ready / total : 0.0;
+        t->done = impl->viewResolved && trav.pending == 0
+            && trav.ready == trav.leaves;
+        it++;
+    }
+}
+
+} // namespace vts
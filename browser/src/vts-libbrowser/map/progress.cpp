@@ -25,7 +25,9 @@
  */
 
 #include "../camera.hpp"
+#include "../mapLayer.hpp"
 #include "../map.hpp"
+#include "../resources.hpp"
 
 namespace vts
 {
@@ -35,7 +37,13 @@ namespace
 
 uint32 getActive(const MapImpl * map)
 {
-    uint32 active = map->statistics.resourcesPreparing;
+    // counted over all maps sharing the resources
+    uint32 active = map->resources->map->statistics.resourcesPreparing;
+    for (auto &layer : map->layers)
+    {
+        if (!layer->traverseRoot && !layer->prerequisitesFailed)
+            active++;
+    }
     for (auto &camera : map->cameras)
     {
         auto cam = camera.lock();
@@ -34,6 +34,7 @@
 #include "../map.hpp"
 
 #include <optick.h>
+#include <cmath>
 
 namespace vts
 {
@@ -42,8 +43,16 @@ namespace
 {
 
 std::string generateSearchUrl(MapImpl *impl, const std::string &query,
-    const double center[])
+    const double point[])
 {
+    // nearby searches share the url, and therefore the results
+    double center[2] = { point[0], point[1] };
+    const double bucket = impl->options.searchCacheBucket;
+    if (bucket > 0)
+    {
+        for (double &c : center)
+            c = (std::floor(c / bucket) + 0.5) * bucket;
+    }
     std::string url = impl->mapconfig->browserOptions.searchUrl;
     const auto &replace = [&](const std::string &what,
         const std::string with)
@@ -66,13 +75,6 @@ std::string generateSearchUrl(MapImpl *impl, const std::string &query,
     return url;
 }
 
-void searchToNav(MapImpl *map, double point[3])
-{
-    vec3 p = rawToVec3(point);
-    p = map->convertor->searchToNav(p);
-    vecToRaw(p, point);
-}
-
 // both points are in navigation srs
 double distance(MapImpl *map, const double a[3], const double b[3],
                 double def = nan1())
@@ -94,28 +96,73 @@ double distance(MapImpl *map, const double a[3], const double b[3],
     return def;
 }
 
-double radius(MapImpl *map, const double center[3], const Json::Value &bj)
+// corners of the bounding box in search srs
+//   or nans if the bounds are not available
+void bounds(const Json::Value &bj, double *corners)
 {
+    for (int i = 0; i < 12; i++)
+        corners[i] = nan1();
     std::string s = bj.asString();
     if (s.empty())
-        return nan1();
+        return;
     std::stringstream ss(s);
     char c = 0;
     double r[4] = { nan1(), nan1(), nan1(), nan1() };
     ss >> r[0] >> c >> r[1] >> c >> r[2] >> c >> r[3];
-    double bbs[4][3] = {
+    const double bbs[4][3] = {
         { r[1], r[0], 0 },
         { r[1], r[2], 0 },
         { r[3], r[0], 0 },
         { r[3], r[2], 0 }
     };
-    double radius = 0;
     for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 3; j++)
+            corners[i * 3 + j] = bbs[i][j];
+}
+
+void readSearchItem(SearchItem &item, const Json::Value &v)
+{
+    item.id = v["id"].asString();
+    item.title = v["title"].asString();
+    item.type = v["type"].asString();
+    item.region = v["region"].asString();
+    item.position[0] = v["lon"].asDouble();
+    item.position[1] = v["lat"].asDouble();
+    item.position[2] = 0;
+}
+
+// all points are converted in a single batch
+std::shared_ptr<const std::vector<SearchItem>> convertSearchResults(
+    MapImpl *map, const SearchTaskImpl *impl)
+{
+    OPTICK_EVENT();
+    const uint32 n = impl->items.size();
+    assert(impl->corners.size() == n * 12);
+    std::vector<double> points;
+    points.reserve(n * 15);
+    for (const SearchItem &it : impl->items)
+        points.insert(points.end(), it.position, it.position + 3);
+    points.insert(points.end(), impl->corners.begin(), impl->corners.end());
+    if (n)
+        map->convertor->convert(points.data(), points.data(), n * 5,
+            Srs::Search, Srs::Navigation);
+    auto results = std::make_shared<std::vector<SearchItem>>(impl->items);
+    for (uint32 i = 0; i < n; i++)
     {
-        searchToNav(map, bbs[i]);
-        radius = std::max(radius, distance(map, center, bbs[i]));
+        SearchItem &t = (*results)[i];
+        for (int j = 0; j < 3; j++)
+            t.position[j] = points[i * 3 + j];
+        if (std::isnan(impl->corners[i * 12]))
+            continue;
+        double radius = 0;
+        for (int k = 0; k < 4; k++)
+        {
+            const double *c = points.data() + n * 3 + i * 12 + k * 3;
+            radius = std::max(radius, distance(map, t.position, c));
+        }
+        t.radius = radius;
     }
-    return radius;
+    return results;
 }
 
 } // namespace
@@ -125,26 +172,12 @@ void MapImpl::parseSearchResults(const std::shared_ptr<SearchTask> &task)
     assert(!task->done);
     try
     {
-        Json::Value root;
-        try
-        {
-            root = stringToJson(task->impl->data.str());
-        }
-        catch(const std::exception &e)
-        {
-            LOGTHROW(err2, std::runtime_error)
-                    << "Failed to parse search result json, url: <"
-                    << task->impl->name << ">, error: <"
-                    << e.what() << ">";
-        }
-        for (const Json::Value &it : root["data"])
-        {
-            SearchItem t(jsonToString(it));
-            searchToNav(this, t.position);
+        SearchTaskImpl *impl = task->impl.get();
+        if (!impl->results)
+            impl->results = convertSearchResults(this, impl);
+        task->results = *impl->results;
+        for (SearchItem &t : task->results)
             t.distance = distance(this, task->position, t.position);
-            t.radius = radius(this, t.position, it["bounds"]);
-            task->results.push_back(std::move(t));
-        }
     }
     catch (const std::exception &e)
     {
@@ -163,7 +196,48 @@ SearchTaskImpl::SearchTaskImpl(MapImpl *map, const std::string &name) :
 
 void SearchTaskImpl::decode()
 {
-    data = std::move(fetch->reply.content);
+    OPTICK_EVENT("decode search");
+    items.clear();
+    corners.clear();
+    results.reset();
+    try
+    {
+        Json::Value root;
+        try
+        {
+            root = stringToJson(fetch->reply.content.str());
+        }
+        catch(const std::exception &e)
+        {
+            LOGTHROW(err2, std::runtime_error)
+                    << "Failed to parse search result json, url: <"
+                    << name << ">, error: <"
+                    << e.what() << ">";
+        }
+        const Json::Value &data = root["data"];
+        items.reserve(data.size());
+        corners.resize(data.size() * 12);
+        for (const Json::Value &it : data)
+        {
+            SearchItem t;
+            t.json = jsonToString(it);
+            readSearchItem(t, it);
+            bounds(it["bounds"], corners.data() + items.size() * 12);
+            items.push_back(std::move(t));
+        }
+        corners.resize(items.size() * 12);
+    }
+    catch (const std::exception &e)
+    {
+        LOG(err3) << "Failed to process search results, url: <"
+                  << name << ">, error: <"
+                  << e.what() << ">";
+        items.clear();
+        corners.clear();
+    }
+    info.ramMemoryCost = sizeof(*this) + corners.size() * sizeof(double);
+    for (const SearchItem &it : items)
+        info.ramMemoryCost += sizeof(it) + it.json.size();
 }
 
 FetchTask::ResourceType SearchTaskImpl::resourceType() const
@@ -180,14 +254,7 @@ SearchItem::SearchItem(const std::string &json) :
     SearchItem()
 {
     this->json = json;
-    Json::Value v = stringToJson(json);
-    AJ(id, asString);
-    AJ(title, asString);
-    AJ(type, asString);
-    AJ(region, asString);
-    position[0] = v["lon"].asDouble();
-    position[1] = v["lat"].asDouble();
-    position[2] = 0;
+    readSearchItem(*this, stringToJson(json));
 }
 
 SearchTask::SearchTask(const std::string &query, const double point[3]) :
@@ -215,7 +282,20 @@ std::shared_ptr<SearchTask> MapImpl::search(const std::string &query,
     OPTICK_EVENT();
     auto t = std::make_shared<SearchTask>(query, point);
     t->impl = getSearchTask(generateSearchUrl(this, query, point));
-    t->impl->priority = inf1();
+    t->impl->updatePriority(inf1());
+
+    // recently used searches are kept alive
+    //   so that search as you type does not download the same prefixes again
+    if (options.searchCacheCapacity > 0)
+    {
+        searchCache.remove(t->impl);
+        searchCache.push_front(t->impl);
+        while (searchCache.size() > options.searchCacheCapacity)
+            searchCache.pop_back();
+    }
+    else
+        searchCache.clear();
+
     if (!t->impl->fetch)
         t->impl->fetch = std::make_shared<FetchTaskImpl>(t->impl);
     t->impl->fetch->query.headers["Accept-Language"] = "en-US,en";
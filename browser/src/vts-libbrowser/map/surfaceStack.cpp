@@ -27,6 +27,7 @@
 #include "../mapLayer.hpp"
 #include "../map.hpp"
 #include "../mapConfig.hpp"
+#include "../resources.hpp"
 
 #include <boost/algorithm/string.hpp>
 
@@ -97,6 +98,7 @@ void SurfaceStack::generateTileset(MapImpl *map,
         }
     }
 
+    canonicalize(map);
     colorize();
 }
 
@@ -179,6 +181,7 @@ void SurfaceStack::generateReal(MapImpl *map)
         }
     }
 
+    canonicalize(map);
     colorize();
 }
 
@@ -220,6 +223,33 @@ void SurfaceStack::generateFree(MapImpl *map,
     }
 }
 
+void SurfaceStack::canonicalize(MapImpl *map)
+{
+    if (!map->options.deduplicateTilesets)
+        return;
+    Resources *res = map->resources.get();
+    std::lock_guard<std::mutex> lock(res->canonicalSurfacesMutex);
+    for (auto &it : surfaces)
+    {
+        if (it.name.empty())
+            continue;
+        std::string key = map->mapconfig->referenceFrame.id
+                + ":" + boost::algorithm::join(it.name, "|");
+        auto jt = res->canonicalSurfaces.find(key);
+        if (jt == res->canonicalSurfaces.end())
+        {
+            res->canonicalSurfaces[key]
+                    = std::make_shared<const SurfaceInfo>(it);
+            continue;
+        }
+        const SurfaceInfo &c = *jt->second;
+        LOG(info1) << "Reusing urls of tileset <" << key << ">";
+        it.urlMeta = c.urlMeta;
+        it.urlMesh = c.urlMesh;
+        it.urlIntTex = c.urlIntTex;
+    }
+}
+
 SurfaceInfo::SurfaceInfo(const vtslibs::vts::SurfaceCommonConfig &surface,
                          const std::string &parentPath)
 {
@@ -0,0 +1,232 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/position.hpp"
+#include "../utilities/json.hpp"
+#include "../navigation.hpp"
+#include "../camera.hpp"
+#include "../gpuResource.hpp"
+#include "../metaTile.hpp"
+#include "../resources.hpp"
+#include "../position.hpp"
+#include "../map.hpp"
+
+#include <optick.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace vts
+{
+
+namespace
+{
+
+// only resources that can be recreated from their name alone
+const char *workingSetType(const Resource *r)
+{
+    switch (r->resourceType())
+    {
+    case FetchTask::ResourceType::MetaTile:
+        return "metatile";
+    case FetchTask::ResourceType::Mesh:
+        return "mesh";
+    case FetchTask::ResourceType::Texture:
+        if (dynamic_cast<const GpuAtmosphereDensityTexture *>(r)
+            || dynamic_cast<const GpuMaskedTexture *>(r)
+            || dynamic_cast<const TextureMask *>(r))
+            return nullptr;
+        return "texture";
+    case FetchTask::ResourceType::BoundMetaTile:
+        return "boundmetatile";
+    default:
+        return nullptr;
+    }
+}
+
+} // namespace
+
+std::string MapImpl::saveWorkingSet(double seconds)
+{
+    OPTICK_EVENT();
+    Json::Value v;
+    v["version"] = 1;
+    v["mapconfig"] = mapconfigPath;
+
+    for (auto &camera : cameras)
+    {
+        auto cam = camera.lock();
+        auto nav = cam ? cam->navigation.lock() : nullptr;
+        if (nav && mapconfigAvailable)
+        {
+            v["position"] = stringToJson(p2p(nav->getPosition()).toJson());
+            break;
+        }
+    }
+
+    // the resources are ordered by the last access tick
+    const double frame = std::max(lastElapsedFrameTime, 1.0 / 120);
+    const uint32 tick = resources->map->renderTickIndex;
+    const uint32 ticks = (uint32)std::min<double>(seconds / frame, tick);
+    const uint32 threshold = tick - ticks;
+    Json::Value &rs = v["resources"];
+    rs = Json::arrayValue;
+    for (Resource *r = resources->lruTail; r; r = r->lruPrev)
+    {
+        if (r->lastAccessTick < threshold)
+            break;
+        if (r->state != Resource::State::ready)
+            continue;
+        const char *type = workingSetType(r);
+        if (!type)
+            continue;
+        Json::Value e;
+        e["name"] = r->name;
+        e["type"] = type;
+        e["priority"] = std::isnan(r->priority) ? 0.0 : (double)r->priority;
+        rs.append(e);
+    }
+
+    LOG(info2) << "Saved working set with " << rs.size() << " resources";
+    return jsonToString(v);
+}
+
+void MapImpl::loadWorkingSet(const std::string &snapshot)
+{
+    OPTICK_EVENT();
+    workingSetPending.clear();
+    workingSetPosition.clear();
+    try
+    {
+        Json::Value v = stringToJson(snapshot);
+        if (v["version"].asUInt() != 1)
+        {
+            LOGTHROW(err2, std::runtime_error)
+                << "Unsupported working set version";
+        }
+        workingSetMapconfig = v["mapconfig"].asString();
+        if (v.isMember("position"))
+            workingSetPosition = jsonToString(v["position"]);
+        for (const Json::Value &e : v["resources"])
+        {
+            WorkingSetItem it;
+            it.name = e["name"].asString();
+            it.type = e["type"].asString();
+            it.priority = e["priority"].asFloat();
+            workingSetPending.push_back(std::move(it));
+        }
+    }
+    catch (const std::exception &e)
+    {
+        workingSetPending.clear();
+        workingSetPosition.clear();
+        LOGTHROW(err2, std::runtime_error)
+            << "Failed parsing working set with error <"
+            << e.what() << ">";
+    }
+
+    // the most important resources are requested first
+    std::stable_sort(workingSetPending.begin(), workingSetPending.end(),
+        [](const WorkingSetItem &a, const WorkingSetItem &b) {
+        return a.priority > b.priority;
+    });
+}
+
+void MapImpl::workingSetUpdate()
+{
+    OPTICK_EVENT();
+
+    if (!workingSetPending.empty() || !workingSetPosition.empty())
+    {
+        if (!mapconfigAvailable)
+            return;
+        if (workingSetMapconfig != mapconfigPath)
+        {
+            LOG(info2) << "Discarding working set of different mapconfig";
+            workingSetPending.clear();
+            workingSetPosition.clear();
+            return;
+        }
+
+        if (!workingSetPosition.empty())
+        {
+            const auto pos = p2p(Position(workingSetPosition));
+            for (auto &camera : cameras)
+            {
+                auto cam = camera.lock();
+                auto nav = cam ? cam->navigation.lock() : nullptr;
+                if (!nav)
+                    continue;
+                // jump, do not fly from the default position
+                nav->setPosition(pos);
+                nav->position = nav->targetPosition;
+                nav->orientation = nav->targetOrientation;
+                nav->verticalExtent = nav->targetVerticalExtent;
+            }
+            workingSetPosition.clear();
+        }
+
+        LOG(info2) << "Restoring working set with "
+            << workingSetPending.size() << " resources";
+        workingSet.reserve(workingSetPending.size());
+        for (const WorkingSetItem &it : workingSetPending)
+        {
+            std::shared_ptr<Resource> r;
+            if (it.type == "metatile")
+                r = getMetaTile(it.name);
+            else if (it.type == "mesh")
+                r = getMeshAggregate(it.name);
+            else if (it.type == "texture")
+                r = getTexture(it.name);
+            else if (it.type == "boundmetatile")
+                r = getBoundMetaTile(it.name);
+            if (!r)
+                continue;
+            r->updatePriority(it.priority);
+            workingSet.push_back(std::move(r));
+        }
+        workingSetPending.clear();
+        return;
+    }
+
+    // keep the restored resources alive until they are done
+    //   the traversal takes over once it reaches them
+    workingSet.erase(std::remove_if(workingSet.begin(), workingSet.end(),
+        [&](const std::shared_ptr<Resource> &r) {
+        switch ((Resource::State)r->state)
+        {
+        case Resource::State::ready:
+        case Resource::State::errorFatal:
+        case Resource::State::availFail:
+            return true;
+        default:
+            touchResource(r);
+            return false;
+        }
+    }), workingSet.end());
+}
+
+} // namespace vts
@@ -28,10 +28,12 @@
 #define MAPCONFIG_HPP_sdf45gde5g4
 
 #include <unordered_map>
+#include <mutex>
 
 #include <vts-libs/vts/nodeinfo.hpp>
 #include <vts-libs/vts/mapconfig.hpp>
 
+#include "include/vts-browser/math.hpp"
 #include "resource.hpp"
 
 namespace Json
@@ -93,10 +95,17 @@ public:
 
     BrowserOptions browserOptions;
     std::vector<vtslibs::vts::NodeInfo> referenceDivisionNodeInfos;
-    std::shared_ptr<CoordManip> convertorData; // used in data/decoder thread
+    // the convertors are not thread safe
+    //   each is used by one thread at a time
+    //   more are created when the traversal threads derive metanodes concurrently
+    std::shared_ptr<CoordManip> acquireConvertor();
+    void releaseConvertor(std::shared_ptr<CoordManip> &&convertor);
+    vec3 horizonRadii = vec3(0, 0, 0); // ellipsoid used for horizon culling, zero when disabled
     std::string atmosphereDensityTextureName;
 
 private:
+    std::vector<std::shared_ptr<CoordManip>> convertorsFree;
+    std::mutex convertorsMutex;
     std::unordered_map<std::string, std::shared_ptr<BoundInfo>> boundInfos;
     std::unordered_map<std::string, std::shared_ptr<FreeInfo>> freeInfos;
 };
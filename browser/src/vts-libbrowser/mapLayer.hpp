@@ -36,6 +36,8 @@ namespace vts
 {
 
 class TraverseNode;
+class TraverseChildsPool;
+class TraverseNodeIndex;
 
 class SurfaceInfo
 {
@@ -60,6 +62,7 @@ class SurfaceStack
 public:
     void print();
     void colorize();
+    void canonicalize(MapImpl *map);
 
     void generateVirtual(MapImpl *map, const vtslibs::vts::VirtualSurfaceConfig *virtualSurface);
     void generateTileset(MapImpl *map, const std::vector<std::string> &vsId, const vtslibs::vts::TilesetReferencesList &dataRaw);
@@ -79,6 +82,7 @@ public:
 
     bool prerequisitesCheck();
     bool isGeodata() const;
+    void resetTraversal(); // keeps the surface stacks
 
     BoundParamInfo::List boundList(const SurfaceInfo *surface, sint32 surfaceReference) const;
 
@@ -87,12 +91,27 @@ public:
     std::string freeLayerName;
     boost::optional<FreeInfo> freeLayer;
     boost::optional<vtslibs::registry::View::FreeLayerParams> freeLayerParams;
+    bool prerequisitesFailed = false; // the free layer is unavailable
 
     SurfaceStack surfaceStack;
     boost::optional<SurfaceStack> tilesetStack;
 
+    // the pool and the index must be destroyed after the nodes
+    std::unique_ptr<TraverseChildsPool> traverseChildsPool;
+    std::unique_ptr<TraverseNodeIndex> traverseIndex;
     std::unique_ptr<TraverseNode> traverseRoot;
 
+    // pending nodes of the incremental clearing
+    //   the depth first walk continues across frames
+    //   and stale subtrees are cleared from their leaves up
+    // only the clearing may destroy the nodes referenced here
+    struct ClearingEntry
+    {
+        TraverseNode *trav;
+        bool childsCleared;
+    };
+    std::vector<ClearingEntry> traverseClearingStack;
+
     MapImpl *const map = nullptr;
     Credits::Scope creditScope;
 
@@ -27,6 +27,8 @@
 #ifndef METATILE_HPP_s4h4i476dw3
 #define METATILE_HPP_s4h4i476dw3
 
+#include <mutex>
+
 #include <vts-libs/vts/metatile.hpp>
 
 #include "include/vts-browser/math.hpp"
@@ -55,8 +57,9 @@ class MetaNode
 public:
     struct Obb
     {
-        mat4 rotInv;
-        vec3 points[2];
+        // physical space
+        vec3 center;
+        vec3 halfAxes[3];
     };
 
     TileId tileId;
@@ -66,6 +69,7 @@ public:
     boost::optional<Obb> obb;
     boost::optional<vec3> surrogatePhys;
     boost::optional<float> surrogateNav;
+    boost::optional<vec3> horizonScaled; // horizon culling point, in space scaled by Mapconfig::horizonRadii
     vec3 diskNormalPhys;
     vec2 diskHeightsPhys;
     double diskHalfAngle;
@@ -79,6 +83,7 @@ Extents2 subExtents(const Extents2 &parentExtents, const TileId &parentId, const
 
 MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared_ptr<CoordManip> &cnv, const vtslibs::vts::TileId &id, const vtslibs::vts::MetaNode &meta);
 MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared_ptr<CoordManip> &cnv, const vtslibs::vts::TileId &id, const vtslibs::registry::FreeLayer::Geodata &geo);
+MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const vtslibs::vts::TileId &id, const vec3 aabbPhys[2], int displaySize); // displaySize = 0 -> always refined
 
 class MetaTile : public Resource, public vtslibs::vts::MetaTile
 {
@@ -86,11 +91,31 @@ public:
     MetaTile(MapImpl *map, const std::string &name);
     void decode() override;
     FetchTask::ResourceType resourceType() const override;
+    // the coordinate conversions of the node are done on the first call
+    //   and kept with the metatile in a packed form
+    //   the node is expanded from it on each call
+    // thread safe
     std::shared_ptr<const MetaNode> getNode(const TileId &tileId);
 
 private:
+    // the results of the coordinate conversions
+    //   positions are relative to originPhys
+    struct PackedNode
+    {
+        vec3f cornersPhys[8]; // nan if the extents are empty
+        vec3f surrogatePhys; // nan if not available
+        vec3f horizonScaled; // nan if not available
+        vec3f diskNormalPhys;
+        vec2 diskHeightsPhys;
+        float diskHalfAngle;
+        float surrogateNav;
+    };
+
     std::weak_ptr<Mapconfig> mapconfig;
-    std::vector<boost::optional<MetaNode>> metas;
+    std::vector<PackedNode> packed; // only the derived nodes
+    std::vector<uint32> packedIndices; // indexed by the metatile grid
+    vec3 originPhys;
+    std::mutex packedMutex;
 };
 
 } // namespace vts
@@ -617,9 +617,9 @@ void NavigationImpl::updateNavigation(double elapsedTime)
         vec3 phys = map->convertor->navToPhys(p);
         RenderInfographicsTask r;
         r.mesh = map->getMesh("internal://data/meshes/cube.obj");
-        r.mesh->priority = inf1();
+        r.mesh->updatePriority(inf1());
         r.textureColor = map->getTexture("internal://data/textures/helper.jpg");
-        r.textureColor->priority = inf1();
+        r.textureColor->updatePriority(inf1());
         r.model = translationMatrix(phys) * scaleMatrix(verticalExtent * 0.015);
         if (r.ready())
             camera->draws.infographics.emplace_back(camera->convert(r));
@@ -631,9 +631,9 @@ void NavigationImpl::updateNavigation(double elapsedTime)
         vec3 phys = map->convertor->navToPhys(tp);
         RenderInfographicsTask r;
         r.mesh = map->getMesh("internal://data/meshes/cube.obj");
-        r.mesh->priority = inf1();
+        r.mesh->updatePriority(inf1());
         r.textureColor = map->getTexture("internal://data/textures/helper.jpg");
-        r.textureColor->priority = inf1();
+        r.textureColor->updatePriority(inf1());
         r.model = translationMatrix(phys) * scaleMatrix(targetVerticalExtent * 0.015);
         if (r.ready())
             camera->draws.infographics.emplace_back(camera->convert(r));
@@ -83,14 +83,39 @@ public:
     std::shared_ptr<BoundMetaTile> boundMetaTile;
     const BoundInfo *bound = nullptr;
     bool transparent = false;
+    bool maskFolded = false; // in the alpha of textureColor, see MapRuntimeOptions::combineMaskTextures
+
+    bool masked() const { return textureMask || maskFolded; }
 
 private:
     Validity prepareDepth(CameraImpl *impl, double priority);
+    Validity prepareMasked(CameraImpl *impl, const std::string &colorUrl,
+        const std::string &maskUrl, double priority);
 
     UrlTemplate::Vars orig {0};
     sint32 depth = 0;
 };
 
+// bound layers resolved for a submesh of a node
+//   reused when the draws of the node are determined again
+//   the textures are held weakly so that they may still be released
+class BoundResolved
+{
+public:
+    struct Layer
+    {
+        BoundParamInfo info; // without the resources
+        std::weak_ptr<GpuTexture> textureColor;
+        std::weak_ptr<GpuTexture> textureMask;
+        std::string nameColor;
+        std::string nameMask;
+
+        explicit Layer(const BoundParamInfo &b);
+    };
+
+    std::vector<Layer> layers;
+};
+
 } // namespace vts
 
 #endif
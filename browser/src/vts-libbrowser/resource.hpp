@@ -59,12 +59,48 @@ public:
         availFail,
     };
 
+    static const uint32 StatesCount = (uint32)State::availFail + 1;
+
+    // atomic state that also maintains the number of resources in each state
+    //   and measures the time spent in each state
+    // only the counted resources are included in the numbers
+    class StateHolder
+    {
+    public:
+        StateHolder(Resource *owner, std::atomic<uint32> *counters);
+        ~StateHolder();
+        StateHolder &operator = (State s);
+        operator State () const { return (State)(value & StateMask); }
+        double elapsed() const; // milliseconds in the current state
+        void setCounted(bool counted);
+
+    private:
+        static const uint32 StateMask = 0xff;
+        static const uint32 Counted = 0x100;
+
+        // the state and the counted flag change together
+        std::atomic<uint32> value {(uint32)State::initializing};
+        std::atomic<sint64> entered; // nanoseconds, steady clock
+        Resource *const owner;
+        std::atomic<uint32> *const counters;
+    };
+
     explicit Resource(MapImpl *map, const std::string &name);
     virtual ~Resource();
     virtual void decode() = 0; // eg. decode an image
     virtual void upload() {} // call the resource callback
     virtual bool requiresUpload() { return false; }
+    // sliced uploads continue after the other queued uploads
+    virtual bool uploadRemaining() const { return false; }
+    // progressive resources become ready in a reduced quality first
+    //   then they are decoded and uploaded again in the full quality
+    //   which is put into use on the render thread by this method
+    virtual void upgrade() {}
+    // bytes held by the decoded data until the upload
+    virtual uint32 decodedMemoryCost() const { return 0; }
     virtual FetchTask::ResourceType resourceType() const = 0;
+    // the name of some derived resources is composed of multiple urls
+    virtual std::string fetchUrl() const { return name; }
     bool allowDiskCache() const;
     static bool allowDiskCache(FetchTask::ResourceType type);
     void updatePriority(float priority);
@@ -78,13 +114,35 @@ public:
     MapImpl *const map = nullptr;
     std::shared_ptr<void> decodeData;
     std::shared_ptr<FetchTaskImpl> fetch;
-    std::atomic<State> state {State::initializing};
+    StateHolder state;
     std::time_t retryTime = -1;
     uint32 retryNumber = 0;
     uint32 lastAccessTick = 0;
     float priority = 0;
+    uint32 priorityTick = 0; // when the priority was last updated or decayed
+    bool upgradePending = false; // full quality decode is yet to come
+
+    // intrusive list of resources ordered by lastAccessTick
+    //   managed by Resources on the render thread
+    //   only the resources owned by Resources::resources are linked
+    Resource *lruPrev = nullptr;
+    Resource *lruNext = nullptr;
+    bool lruLinked = false;
+    bool managed = false; // owned by Resources::resources
+
+    // decoded data waiting for upload, set by the decode thread
+    std::atomic<uint32> pendingMemory{ 0 };
+
+    // any dependents registered with Resources::addWaiter
+    std::atomic<bool> hasWaiters{ false };
+
+    // memory cost as included in the totals in Resources
+    uint32 accountedRamMemory = 0;
+    uint32 accountedGpuMemory = 0;
+    State accountedState = State::initializing;
 };
 
+const char *stateName(Resource::State state);
 std::ostream &operator << (std::ostream &stream, Resource::State state);
 bool testAndThrow(Resource::State state, const std::string &message);
 
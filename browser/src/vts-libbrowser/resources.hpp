@@ -34,11 +34,24 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <shared_mutex>
+#include <limits>
+#include <cassert>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <deque>
 
 #include "../include/vts-browser/buffer.hpp"
+#include "../include/vts-browser/executor.hpp"
+#include "../include/vts-browser/mapStatistics.hpp"
 
 #include "../utilities/threadName.hpp"
 #include "../validity.hpp"
+#include "../resource.hpp"
+#include "../downloadControl.hpp"
 
 #include <optick.h>
 
@@ -55,6 +68,7 @@ class SearchTask;
 class SearchTaskImpl;
 class FetchTaskImpl;
 class GeodataTile;
+class SurfaceInfo;
 
 class CacheData
 {
@@ -74,8 +88,12 @@ public:
 
     Buffer buffer;
     std::string name;
+    std::string etag;
+    std::string lastModified;
     sint64 expires = 0;
     bool availFailed = false;
+    bool stale = false; // expired, must be revalidated before use
+    bool compress = false; // worth compressing on write
 };
 
 class UploadData
@@ -90,46 +108,177 @@ public:
     UploadData &operator = (UploadData &&) = default;
 
     void process();
+    uint32 memoryCost() const; // decoded data to upload, zero for destroys
 
 protected:
     std::weak_ptr<Resource> uploadData;
     std::shared_ptr<void> destroyData;
 };
 
+inline const void *resourceProcessorKey(const std::weak_ptr<Resource> &r)
+{
+    return r.lock().get();
+}
+
+inline const void *resourceProcessorKey(const CacheData &)
+{
+    return nullptr;
+}
+
+// priority queue of items waiting for processing
+// implemented as binary max-heap with index of the keyed items
+//   which allows in-place priority updates
+// items with equal priority are processed in fifo order
 template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName>
 class ResourceProcessor : private Immovable
 {
 public:
     void push(const Item &item)
     {
+        Item tmp(item);
+        push(std::move(tmp));
+    }
+
+    void push(Item &&item)
+    {
+        // the priority and key are evaluated outside the lock
+        float p = (resources->*Priority)(item);
+        const void *key = resourceProcessorKey(item);
         {
-            std::lock_guard<std::mutex> lock(mut);
+            std::unique_lock<std::mutex> lock(mut, std::defer_lock);
+            acquire(lock);
             if (stop)
                 return;
-            q.push_back(item);
+            if (key)
+            {
+                auto it = index.find(key);
+                if (it != index.end())
+                {
+                    // the item is already queued
+                    //   (or it is a stale entry of an expired resource
+                    //   that resided at the same address)
+                    Entry &e = q[it->second];
+                    e.item = std::move(item);
+                    setPriority(it->second, p);
+                    return;
+                }
+            }
+            q.emplace_back(std::move(item), key, sanitize(p), order++);
+            if (key)
+                index[key] = q.size() - 1;
+            siftUp(q.size() - 1);
         }
-        con.notify_one();
+        wakeOne();
+        if (executor)
+            submit(p);
     }
 
-    void push(Item &&item)
+    // change priority of already queued item
+    // does nothing if the item is not in this queue
+    void update(const void *key, float p)
+    {
+        assert(key);
+        std::unique_lock<std::mutex> lock(mut, std::defer_lock);
+        acquire(lock);
+        auto it = index.find(key);
+        if (it == index.end())
+            return;
+        setPriority(it->second, p);
+        updates++;
+    }
+
+    // auxiliary job for any of the workers
+    //   jobs take precedence over the queued items
+    //   it is used to split processing of a single item
+    void pushJob(std::function<void()> &&job)
     {
         {
-            std::lock_guard<std::mutex> lock(mut);
+            std::unique_lock<std::mutex> lock(mut, std::defer_lock);
+            acquire(lock);
             if (stop)
                 return;
-            q.push_back(std::move(item));
+            jobs.push_back(std::move(job));
         }
-        con.notify_one();
+        wakeOne();
+        if (executor)
+            submit(std::numeric_limits<float>::infinity());
     }
 
     bool runOne();
 
+    // removes the best item without waiting
+    //   returns false when the queue is empty
+    bool tryPop(Item &item)
+    {
+        std::unique_lock<std::mutex> lock(mut, std::defer_lock);
+        acquire(lock);
+        if (q.empty() || stop)
+            return false;
+        item = getBest();
+        return true;
+    }
+
+    // removes the best item if its priority is higher than the given one
+    //   does not wait for the lock either
+    bool tryPopAbove(float p, Item &item)
+    {
+        std::unique_lock<std::mutex> lock(mut, std::try_to_lock);
+        if (!lock.owns_lock() || q.empty() || stop
+            || !(q.front().priority > sanitize(p)))
+            return false;
+        item = getBest();
+        return true;
+    }
+
+    // removes the lowest priority items in excess of the limit
+    //   if the filter agrees, the removed items are appended to removed
+    template<class Filter>
+    void shed(uint32 limit, Filter filter, std::vector<Item> &removed)
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        if (q.size() <= limit || stop)
+            return;
+        // move the best items in front
+        std::nth_element(q.begin(), q.begin() + limit, q.end(),
+            [](const Entry &a, const Entry &b) { return b < a; });
+        uint32 w = limit;
+        for (uint32 i = limit, e = q.size(); i < e; i++)
+        {
+            if (filter(q[i].item))
+            {
+                if (q[i].key)
+                    index.erase(q[i].key);
+                removed.push_back(std::move(q[i].item));
+                continue;
+            }
+            if (w != i)
+                q[w] = std::move(q[i]);
+            w++;
+        }
+        q.erase(q.begin() + w, q.end());
+        // restore the heap and the index
+        for (uint32 i = 0, e = q.size(); i < e; i++)
+            place(i);
+        for (uint32 i = q.size() / 2; i-- > 0;)
+            siftDown(i);
+    }
+
+    // drops all queued items (the jobs are kept)
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        q.clear();
+        index.clear();
+    }
+
     void terminate()
     {
         {
             std::lock_guard<std::mutex> lock(mut);
             stop = true;
             q.clear();
+            index.clear();
+            jobs.clear();
         }
         con.notify_all();
     }
@@ -139,31 +288,405 @@ public:
         return q.size();
     }
 
-    ResourceProcessor(Resources *resources) : resources(resources)
+    // spawn additional worker threads
+    // all workers pull from the same queue
+    void addWorkers(uint32 count)
+    {
+        assert(ThreadName);
+        for (uint32 i = 0; i < count; i++)
+        {
+            workers.push_back(std::unique_ptr<Worker>(new Worker()));
+            Worker *w = workers.back().get();
+            w->thr = std::thread(&ResourceProcessor::entry, this, w,
+                (uint32)workers.size() - 1);
+        }
+    }
+
+    // limit the number of workers that pull from the queue
+    //   the other workers stay asleep until the limit is raised
+    //   does not apply to the executor
+    void limitWorkers(uint32 count)
+    {
+        count = std::max(count, 1u);
+        if (activeLimit.exchange(count) == count)
+            return;
+        {
+            // prevents missed wakeups of the waiting workers
+            std::lock_guard<std::mutex> lock(mut);
+        }
+        con.notify_all();
+    }
+
+    uint32 activeWorkers() const
+    {
+        return std::min<uint32>(workers.size(), activeLimit);
+    }
+
+    // dispatch the processing through the host executor
+    //   instead of own worker threads
+    // each queued item or job submits one executor job,
+    //   which processes whatever is best at the time it runs
+    void useExecutor(const std::shared_ptr<Executor> &e,
+        Executor::Affinity a)
+    {
+        assert(workers.empty());
+        gate = std::make_shared<ExecutorGate>();
+        gate->processor = [this]() { executeOne(); };
+        affinity = a;
+        executor = e;
+    }
+
+    // fraction of time spent processing (in percents)
+    //   for each worker since last call
+    void utilization(std::vector<uint32> &result)
     {
-        if (ThreadName)
-            thr = std::thread(&ResourceProcessor::entry, this);
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration_cast<
+            std::chrono::nanoseconds>(now - lastUtilization).count();
+        lastUtilization = now;
+        result.resize(workers.size());
+        for (uint32 i = 0, e = workers.size(); i < e; i++)
+        {
+            Worker &w = *workers[i];
+            uint64 busy = w.busy;
+            result[i] = elapsed > 0
+                ? (uint32)(std::min(100.0,
+                    100.0 * (busy - w.lastBusy) / elapsed) + 0.5)
+                : 0;
+            w.lastBusy = busy;
+        }
     }
 
+    // the workers are spawned by the owner with addWorkers
+    ResourceProcessor(Resources *resources) : resources(resources)
+    {}
+
     ~ResourceProcessor()
     {
         terminate();
+        if (gate)
+        {
+            // waits for the running executor jobs
+            std::unique_lock<std::shared_timed_mutex> lock(gate->mut);
+            gate->processor = nullptr;
+        }
+        for (auto &w : workers)
+            if (w->thr.joinable())
+                w->thr.join();
         if (thr.joinable())
             thr.join();
     }
 
+    // shared with the executor jobs, which may outlive the processor
+    struct ExecutorGate
+    {
+        std::shared_timed_mutex mut;
+        std::function<void()> processor;
+    };
+
+    struct Worker
+    {
+        std::thread thr;
+        std::atomic<uint64> busy{ 0 }; // nanoseconds
+        uint64 lastBusy = 0;
+    };
+
+    struct Entry
+    {
+        Item item;
+        const void *key;
+        float priority;
+        uint64 order;
+
+        Entry(Item &&item, const void *key, float priority, uint64 order)
+            : item(std::move(item)), key(key),
+            priority(priority), order(order)
+        {}
+
+        bool operator < (const Entry &other) const
+        {
+            if (priority == other.priority)
+                return order > other.order;
+            return priority < other.priority;
+        }
+    };
+
     // private:
-    std::vector<Item> q;
+    std::vector<Entry> q;
+    std::deque<std::function<void()>> jobs;
+    std::unordered_map<const void *, uint32> index;
     std::mutex mut;
     std::condition_variable con;
-    std::thread thr;
+    std::thread thr; // optional thread not managed by the processor
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::chrono::steady_clock::time_point lastUtilization
+        = std::chrono::steady_clock::now();
     std::atomic<bool> stop{ false };
+    std::atomic<uint32> contentions{ 0 };
+    std::atomic<uint32> updates{ 0 };
+    std::atomic<uint32> activeLimit{ std::numeric_limits<uint32>::max() };
+    uint64 order = 0;
     Resources *const resources;
+    std::shared_ptr<Executor> executor;
+    std::shared_ptr<ExecutorGate> gate;
+    Executor::Affinity affinity = Executor::Affinity::Compute;
 
-    void entry();
+    void entry(Worker *worker, uint32 workerIndex);
+    void executeOne();
+
+    void wakeOne()
+    {
+        // the woken worker might be above the limit and go back to sleep
+        if (activeLimit < workers.size())
+            con.notify_all();
+        else
+            con.notify_one();
+    }
+
+    void submit(float p)
+    {
+        std::shared_ptr<ExecutorGate> g = gate;
+        executor->submit([g]() {
+            std::shared_lock<std::shared_timed_mutex> lock(g->mut);
+            if (g->processor)
+                g->processor();
+        }, sanitize(p), affinity);
+    }
     Item getBest();
+    void acquire(std::unique_lock<std::mutex> &lock);
+    void setPriority(uint32 i, float p);
+    void place(uint32 i);
+    void siftUp(uint32 i);
+    void siftDown(uint32 i);
+
+    static float sanitize(float p)
+    {
+        return std::isnan(p) ? 0 : p;
+    }
+};
+
+// items for the data threads, with multiple producers and multiple consumers
+// bounded lock-free ring (d. vyukov) for the common case
+//   with locked overflow list when the ring is full
+//   so that the producers never block
+//   (the rendering thread may push destroys while being the consumer too)
+// the uploads have no priorities, they are processed in fifo order
+//   (items from the overflow list may be processed out of order)
+class UploadQueue : private Immovable
+{
+public:
+    UploadQueue() : cells(new Cell[Capacity])
+    {
+        for (uint32 i = 0; i < Capacity; i++)
+            cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    ~UploadQueue()
+    {
+        stop = true;
+    }
+
+    void push(UploadData &&item)
+    {
+        if (!tryPush(item))
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            overflow.push_back(std::move(item));
+            overflowSize++;
+            contentions++;
+        }
+        wakeOne();
+    }
+
+    // returns a popped item back, it is the next one to be popped
+    // consumers only
+    void pushFront(UploadData &&item)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            deferred.push_front(std::move(item));
+            deferredSize++;
+        }
+        wakeOne();
+    }
+
+    // processes up to the specified number of items
+    // returns the number of processed items
+    // consumers only
+    uint32 drain(uint32 maxItems)
+    {
+        OPTICK_EVENT("drain");
+        uint32 cnt = 0;
+        UploadData item;
+        while (cnt < maxItems && pop(item))
+        {
+            item.process();
+            item = UploadData();
+            cnt++;
+        }
+        return cnt;
+    }
+
+    // removes one item without processing it
+    // returns false if the queue is empty
+    // consumers only
+    bool pop(UploadData &item)
+    {
+        if (deferredSize > 0)
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            if (!deferred.empty())
+            {
+                item = std::move(deferred.front());
+                deferred.pop_front();
+                deferredSize--;
+                return true;
+            }
+        }
+        // every few items are taken from the overflow
+        //   so that it does not starve while the ring is kept busy
+        if (overflowSize > 0 && (pops++ % OverflowShare) == 0
+            && popOverflow(item))
+            return true;
+        if (tryPop(item))
+            return true;
+        return popOverflow(item);
+    }
+
+    // blocks until there are any items or the wake is requested
+    // consumers only
+    void wait(const std::atomic<bool> &wake)
+    {
+        std::unique_lock<std::mutex> lock(mut);
+        sleeping++;
+        while (empty() && !wake)
+            con.wait(lock);
+        sleeping--;
+    }
+
+    void notify()
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        con.notify_all();
+    }
+
+    bool empty() const
+    {
+        return estimateSize() == 0;
+    }
+
+    uint32 estimateSize() const
+    {
+        const uint64 e = enqueuePos.load();
+        const uint64 d = dequeuePos.load();
+        return (e > d ? uint32(e - d) : 0) + overflowSize + deferredSize;
+    }
+
+    std::atomic<bool> stop{ false };
+    std::atomic<uint32> contentions{ 0 }; // pushes that overflowed the ring
+
+private:
+    static const uint32 Capacity = 1024; // power of two
+    static const uint64 Mask = Capacity - 1;
+    static const uint32 OverflowShare = 4; // every n-th pop
+
+    struct Cell
+    {
+        std::atomic<uint64> seq;
+        UploadData data;
+    };
+
+    bool popOverflow(UploadData &item)
+    {
+        if (overflowSize == 0)
+            return false;
+        std::lock_guard<std::mutex> lock(mut);
+        if (overflow.empty())
+            return false;
+        item = std::move(overflow.front());
+        overflow.pop_front();
+        overflowSize--;
+        return true;
+    }
+
+    void wakeOne()
+    {
+        // pairs with the consumer setting sleeping before testing empty
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load() > 0)
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            con.notify_one();
+        }
+    }
+
+    bool tryPush(UploadData &item)
+    {
+        uint64 pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell *c;
+        while (true)
+        {
+            c = &cells[pos & Mask];
+            const uint64 seq = c->seq.load(std::memory_order_acquire);
+            const sint64 dif = (sint64)seq - (sint64)pos;
+            if (dif == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1,
+                    std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+                return false; // full
+            else
+                pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+        c->data = std::move(item);
+        c->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(UploadData &item)
+    {
+        uint64 pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell *c;
+        while (true)
+        {
+            c = &cells[pos & Mask];
+            const uint64 seq = c->seq.load(std::memory_order_acquire);
+            const sint64 dif = (sint64)seq - (sint64)(pos + 1);
+            if (dif == 0)
+            {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1,
+                    std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+                return false; // empty
+            else
+                pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+        item = std::move(c->data);
+        c->data = UploadData();
+        c->seq.store(pos + Capacity, std::memory_order_release);
+        return true;
+    }
+
+    std::unique_ptr<Cell[]> cells;
+    std::atomic<uint64> enqueuePos{ 0 };
+    std::atomic<uint64> dequeuePos{ 0 };
+    std::deque<UploadData> overflow;
+    std::atomic<uint32> overflowSize{ 0 };
+    std::atomic<uint32> pops{ 0 };
+    std::deque<UploadData> deferred; // see pushFront
+    std::atomic<uint32> deferredSize{ 0 };
+    std::atomic<uint32> sleeping{ 0 }; // number of waiting consumers
+    std::mutex mut;
+    std::condition_variable con;
 };
 
+static const uint32 ResourceTypesCount
+    = (uint32)FetchTask::ResourceType::Font + 1;
+
 class Resources : private Immovable
 {
 public:
@@ -179,20 +702,56 @@ public:
     void dataAllRun();
 
     // private:
+    uint32 drainUploads(uint32 maxItems); // measures the upload time
+    uint32 drainUploadsBudget(double budgetMs); // see MapRuntimeOptions::dataUpdateBudget
     void decodeProcess(const std::shared_ptr<Resource> &r);
+
+    // called by long running decodes between features or submeshes
+    //   once the current decode exceeds its time slice
+    //   queued decodes with higher priority are processed in between
+    //   on the same thread (the nesting is limited to one level)
+    void decodeYield();
+
+    // dependents waiting for a change instead of polling every frame
+    // the flag is raised when the validity of the resource changes
+    //   (it becomes or stops being ready or failed)
+    // the registration lasts until the flag is raised by this resource
+    //   registering the same flag repeatedly has no effect
+    // the flag must be registered before the validity is read
+    // returns false if the flag was already registered
+    bool addWaiter(Resource *r, const std::shared_ptr<std::atomic<bool>> &flag);
+    void wakeWaiters(Resource *r);
+    void removeWaiters(Resource *r);
     void uploadProcess(const std::shared_ptr<Resource> &r);
     void cacheReadProcess(const std::shared_ptr<Resource> &r);
+    void reprioritize(Resource *r);
 
     void fetcherProcessorEntry();
 
+    // applies priority and affinity of the calling worker thread
+    //   role is the ThreadName of its ResourceProcessor
+    void workerThreadInit(int role);
+
     void removeOld();
+    void memoryPressure(MemoryPressure level);
     void checkInitialized();
+    uint32 countPreparing() const;
+
+    void touch(Resource *r);
+    void accountMemory(Resource *r);
+    void unaccountMemory(Resource *r);
+    void lruUnlink(Resource *r);
+    void lruInsertAfter(Resource *r, Resource *prev);
+
+    bool cancelFetch(Resource *r);
+    bool abortFetch(const std::shared_ptr<FetchTaskImpl> &f);
 
+    bool tryRemove(Resource *r);
     bool tryRemove(std::shared_ptr<Resource> &r);
     void saveCorruptedFile(const std::shared_ptr<Resource> &r);
 
     void cacheInit();
-    void cacheWrite(const CacheData &data);
+    void cacheWrite(const std::vector<CacheData> &batch);
     CacheData cacheRead(const std::string &name);
 
     void oneCacheRead(std::weak_ptr<Resource> r);
@@ -200,23 +759,84 @@ public:
     void oneDecode(std::weak_ptr<Resource> r);
     void oneAtmosphere(std::weak_ptr<Resource> r);
     void oneCacheWrite(CacheData r);
-    void oneUpload(UploadData r);
+    void cacheWriteSpaceFreed();
+    void shedQueues();
     float priority(const std::weak_ptr<Resource> &r);
     float priority(const std::weak_ptr<GeodataTile> &r);
     float priority(const CacheData &) { return 0; };
-    float priority(const UploadData &) { return 0; };
+
+    // registry of uploaded textures by content, see MapRuntimeOptions::deduplicateTextures
+    struct DedupEntry
+    {
+        std::weak_ptr<void> userData;
+        uint32 size = 0; // of the encoded content
+        uint32 width = 0, height = 0;
+    };
+    std::shared_ptr<void> dedupFind(uint64 hash, uint32 size, uint32 &width, uint32 &height); // decode threads
+    void dedupInsert(uint64 hash, DedupEntry &&entry); // data thread
 
     ResourceProcessor<std::weak_ptr<Resource>, &Resources::oneFetch, &Resources::priority, 0> queFetching;
     ResourceProcessor<std::weak_ptr<Resource>, &Resources::oneCacheRead, &Resources::priority, 1> queCacheRead;
     ResourceProcessor<CacheData, &Resources::oneCacheWrite, &Resources::priority, 2> queCacheWrite;
+    std::mutex cacheWriteSpaceMutex;
+    std::condition_variable cacheWriteSpace; // see MapRuntimeOptions::cacheWriteBackpressure
     ResourceProcessor<std::weak_ptr<Resource>, &Resources::oneDecode, &Resources::priority, 3> queDecode;
     ResourceProcessor<std::weak_ptr<Resource>, &Resources::oneAtmosphere, &Resources::priority, 4> queAtmosphere;
-    ResourceProcessor<UploadData, &Resources::oneUpload, &Resources::priority, 0> queUpload;
+    UploadQueue queUpload;
+    std::atomic<double> uploadNsPerByte{ 1 }; // estimated throughput of large uploads, shared by the data threads
+
+    void downloadFinished(FetchTaskImpl *f, bool cancelled);
+    void downloadTimed(const FetchTaskImpl *f, double durationMs);
+    void stateTimed(const Resource *r, Resource::State state,
+        double durationMs);
+    void stageTimed(const Resource *r, uint32 stage, double durationMs);
 
     std::unordered_map<std::string, std::shared_ptr<Resource>> resources;
+    DownloadControl downloadControl;
+    Resource *lruHead = nullptr; // least recently used
+    Resource *lruTail = nullptr; // most recently used
+    Resource *lruSweep = nullptr; // position of the incremental sweep
+    Resource *lruEvict = nullptr; // position of the search for eviction candidates
+    uint64 memRamUse = 0;
+    uint64 memGpuUse = 0;
+    uint64 memTypeUse[ResourceTypesCount] = {}; // ram + gpu
+    uint64 memStateUse[Resource::StatesCount] = {}; // ram + gpu
     MapImpl *const map;
     std::atomic<uint32> downloads{ 0 }; // number of active downloads
     std::atomic<uint32> existing{ 0 }; // number of existing resources
+    std::atomic<uint32> stateCounters[Resource::StatesCount] = {}; // number of existing resources in each state
+    std::atomic<uint32> decoded{ 0 }; // pending increment of statistics
+    std::atomic<uint32> decodeFailed{ 0 };
+    std::atomic<uint32> diskLoaded{ 0 }; // pending increment of statistics
+    std::atomic<uint32> decodePreempted{ 0 }; // pending increment of statistics
+    std::atomic<uint32> cacheSkipped{ 0 }; // pending increment of statistics
+    std::unordered_map<const Resource *,
+        std::vector<std::weak_ptr<std::atomic<bool>>>> waiters;
+    std::mutex waitersMutex;
+    std::atomic<uint32> fetchesCancelled{ 0 }; // pending increment of statistics
+    std::atomic<uint32> revalidated{ 0 }; // pending increment of statistics
+    std::atomic<uint64> uploadDuration{ 0 }; // nanoseconds, pending for statistics
+    std::atomic<uint32> uploadsDeferred{ 0 }; // pending increment of statistics
+    std::atomic<uint32> meshesOptimized{ 0 };
+    std::atomic<uint64> meshesOptimizedFaces{ 0 };
+    std::atomic<uint64> meshesMissesBefore{ 0 }; // simulated vertex cache misses
+    std::atomic<uint64> meshesMissesAfter{ 0 };
+    std::vector<DownloadTimings> downloadTimings; // indexed by resource type
+    std::mutex downloadTimingsMutex;
+    // histograms of the stages of ResourceLatencies, in order of its members
+    static const uint32 StagesCount = 5;
+    std::atomic<uint32> stageHistograms[ResourceTypesCount][StagesCount]
+        [DownloadTimings::Bins] = {};
+    std::vector<std::weak_ptr<Resource>> upgrades; // uploaded, not yet in use
+    std::mutex upgradesMutex;
+    std::atomic<uint32> upgradesPending{ 0 }; // progressive resources
+    std::unordered_map<uint64, DedupEntry> dedupEntries;
+    std::mutex dedupMutex;
+    uint32 dedupSweepThreshold = 256; // expired entries are removed when exceeded
+    std::atomic<uint32> deduplicated{ 0 }; // pending increment of statistics
+    // url templates of tilesets by their ids, see MapRuntimeOptions::deduplicateTilesets
+    std::unordered_map<std::string, std::shared_ptr<const SurfaceInfo>> canonicalSurfaces;
+    std::mutex canonicalSurfacesMutex;
     std::atomic<bool> renderFinalizeCalled{ false };
 };
 
@@ -226,7 +846,8 @@ inline bool ResourceProcessor<Item, Process, Priority, ThreadName>::runOne()
     OPTICK_EVENT("runOne");
     Item item;
     {
-        std::unique_lock<std::mutex> lock(mut);
+        std::unique_lock<std::mutex> lock(mut, std::defer_lock);
+        acquire(lock);
         if (q.empty() || stop)
             return false;
         item = getBest();
@@ -239,7 +860,7 @@ inline bool ResourceProcessor<Item, Process, Priority, ThreadName>::runOne()
 }
 
 template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName>
-inline void ResourceProcessor<Item, Process, Priority, ThreadName>::entry()
+inline void ResourceProcessor<Item, Process, Priority, ThreadName>::entry(Worker *worker, uint32 workerIndex)
 {
     constexpr const char *ThreadNames[] =
     {
@@ -250,50 +871,160 @@ inline void ResourceProcessor<Item, Process, Priority, ThreadName>::entry()
         "atmosphere",
     };
 
-    setThreadName(ThreadNames[ThreadName]);
-    OPTICK_THREAD(ThreadNames[ThreadName]);
+    std::string name = ThreadNames[ThreadName];
+    if (workerIndex > 0)
+        name += std::to_string(workerIndex + 1);
+    setThreadName(name.c_str());
+    OPTICK_THREAD(name.c_str());
+    resources->workerThreadInit(ThreadName);
 
     while (!stop)
     {
         Item item;
+        std::function<void()> job;
         {
-            std::unique_lock<std::mutex> lock(mut);
-            while (q.empty() && !stop)
+            std::unique_lock<std::mutex> lock(mut, std::defer_lock);
+            acquire(lock);
+            while ((workerIndex >= activeLimit
+                || (q.empty() && jobs.empty())) && !stop)
                 con.wait(lock);
             if (stop)
                 return;
-            item = getBest();
+            if (!jobs.empty())
+            {
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            else
+                item = getBest();
         }
         {
             OPTICK_EVENT("process");
-            (resources->*Process)(std::move(item));
+            auto start = std::chrono::steady_clock::now();
+            if (job)
+                job();
+            else
+                (resources->*Process)(std::move(item));
+            worker->busy += std::chrono::duration_cast<
+                std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
         }
     }
 }
 
 template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName>
-inline Item ResourceProcessor<Item, Process, Priority, ThreadName>::getBest()
+inline void ResourceProcessor<Item, Process, Priority, ThreadName>::executeOne()
 {
-    OPTICK_EVENT("getBest");
-    auto it = q.begin();
-    auto et = q.end();
-    auto b = it;
-    float p = (resources->*Priority)(*it++);
-    while (it != et)
-    {
-        float r = (resources->*Priority)(*it);
-        if (r > p)
+    Item item;
+    std::function<void()> job;
+    {
+        std::unique_lock<std::mutex> lock(mut, std::defer_lock);
+        acquire(lock);
+        if (stop)
+            return;
+        if (!jobs.empty())
         {
-            b = it;
-            p = r;
+            job = std::move(jobs.front());
+            jobs.pop_front();
         }
-        it++;
+        else if (!q.empty())
+            item = getBest();
+        else
+            return; // the item was processed by an earlier job
+    }
+    OPTICK_EVENT("process");
+    if (job)
+        job();
+    else
+        (resources->*Process)(std::move(item));
+}
+
+template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName>
+inline Item ResourceProcessor<Item, Process, Priority, ThreadName>::getBest()
+{
+    OPTICK_EVENT("getBest");
+    assert(!q.empty());
+    Item r = std::move(q.front().item);
+    if (q.front().key)
+        index.erase(q.front().key);
+    if (q.size() > 1)
+    {
+        q.front() = std::move(q.back());
+        q.pop_back();
+        place(0);
+        siftDown(0);
     }
-    auto r = std::move(*b);
-    q.erase(b);
+    else
+        q.pop_back();
     return r;
 }
 
+template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName>
+inline void ResourceProcessor<Item, Process, Priority, ThreadName>::acquire(std::unique_lock<std::mutex> &lock)
+{
+    if (!lock.try_lock())
+    {
+        contentions++;
+        lock.lock();
+    }
+}
+
+template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName>
+inline void ResourceProcessor<Item, Process, Priority, ThreadName>::setPriority(uint32 i, float p)
+{
+    p = sanitize(p);
+    float old = q[i].priority;
+    q[i].priority = p;
+    if (p > old)
+        siftUp(i);
+    else if (p < old)
+        siftDown(i);
+}
+
+template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName>
+inline void ResourceProcessor<Item, Process, Priority, ThreadName>::place(uint32 i)
+{
+    if (q[i].key)
+        index[q[i].key] = i;
+}
+
+template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName>
+inline void ResourceProcessor<Item, Process, Priority, ThreadName>::siftUp(uint32 i)
+{
+    while (i > 0)
+    {
+        uint32 p = (i - 1) / 2;
+        if (!(q[p] < q[i]))
+            break;
+        std::swap(q[p], q[i]);
+        place(i);
+        i = p;
+    }
+    place(i);
+}
+
+template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName>
+inline void ResourceProcessor<Item, Process, Priority, ThreadName>::siftDown(uint32 i)
+{
+    const uint32 s = q.size();
+    while (true)
+    {
+        uint32 l = i * 2 + 1;
+        uint32 r = l + 1;
+        uint32 b = i;
+        if (l < s && q[b] < q[l])
+            b = l;
+        if (r < s && q[b] < q[r])
+            b = r;
+        if (b == i)
+            break;
+        std::swap(q[b], q[i]);
+        place(i);
+        i = b;
+    }
+    place(i);
+}
+
 } // namespace vts
 
 #endif
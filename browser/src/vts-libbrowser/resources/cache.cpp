@@ -26,38 +26,27 @@
 
 #include "../include/vts-browser/mapOptions.hpp"
 #include "../resources.hpp"
+#include "../cache.hpp"
 #include "../map.hpp"
 
 #include <boost/filesystem.hpp>
+#include <zlib.h>
 #include <utility/path.hpp> // homeDir
 #include <utility/md5.hpp>
 #include <dbglog/dbglog.hpp>
 #include <optick.h>
 
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <ctime>
+
 namespace vts
 {
 
 namespace
 {
 
-static const char Magic[] = "vtscache";
-static const uint16 Version = 4;
-
-enum class CacheFlags : uint16
-{
-    None = 0,
-    AvailFailed = 1 << 0,
-};
-
-struct CacheHeader
-{
-    char magic[16];
-    uint16 version;
-    uint16 flags;
-    uint16 nameLen;
-    sint64 expires;
-};
-
 char digit(unsigned char a)
 {
     assert(a < 16);
@@ -66,62 +55,145 @@ char digit(unsigned char a)
     return a + '0';
 }
 
-} // namespace
+// jpeg, png, gzip and zip are not compressed again
+bool worthCompressing(const Buffer &b)
+{
+    if (b.size() < 64)
+        return false;
+    const unsigned char *p = (const unsigned char *)b.data();
+    if (p[0] == 0xff && p[1] == 0xd8)
+        return false;
+    if (p[0] == 0x89 && p[1] == 'P' && p[2] == 'N' && p[3] == 'G')
+        return false;
+    if (p[0] == 0x1f && p[1] == 0x8b)
+        return false;
+    if (p[0] == 'P' && p[1] == 'K')
+        return false;
+    return true;
+}
+
+// returns empty buffer when the compression does not pay off
+Buffer compressContent(const Buffer &b)
+{
+    uLongf len = compressBound(b.size());
+    Buffer out((uint32)len);
+    if (compress2((Bytef*)out.data(), &len, (const Bytef*)b.data(),
+        b.size(), 1) != Z_OK || len > b.size() / 8 * 7)
+        return {};
+    Buffer r((uint32)len);
+    memcpy(r.data(), out.data(), len);
+    return r;
+}
 
-class Cache
+// bloom filter of the cached file names
+//   insertions on the cache write thread, queries on the data thread
+//   removed files are not removed from the filter
+class NamesFilter
 {
 public:
-    Cache(const MapCreateOptions &options) :
-        root(options.cachePath),
-        disabled(!options.diskCache),
-        hashes(options.hashCachePaths)
+    NamesFilter() : bits(Words)
     {
-        if (options.diskCache)
+        clear();
+    }
+
+    void insert(const std::string &key)
+    {
+        uint64 h1, h2;
+        hash(key, h1, h2);
+        for (uint32 i = 0; i < Probes; i++)
         {
-#ifdef __EMSCRIPTEN__
-            LOGTHROW(err4, std::logic_error)
-                << "Disk Cache is not available in WASM";
-#else
-            if (root.empty())
-            {
-                root = "/home";
-                root = utility::homeDir().string();
-                if (root.empty())
-                {
-                    LOGTHROW(err3, std::runtime_error)
-                        << "Invalid home dir, the cache path must be defined";
-                }
-                root += "/.cache/vts-browser/";
-            }
-            if (root.back() != '/')
-                root += "/";
-            LOG(info2) << "Disk cache path: <" << root << ">";
-#endif
+            uint64 b = (h1 + i * h2) % (Words * 64);
+            bits[b / 64].fetch_or((uint64)1 << (b % 64),
+                std::memory_order_relaxed);
+        }
+    }
+
+    bool test(const std::string &key) const
+    {
+        uint64 h1, h2;
+        hash(key, h1, h2);
+        for (uint32 i = 0; i < Probes; i++)
+        {
+            uint64 b = (h1 + i * h2) % (Words * 64);
+            if ((bits[b / 64].load(std::memory_order_relaxed)
+                & ((uint64)1 << (b % 64))) == 0)
+                return false;
+        }
+        return true;
+    }
+
+    void clear()
+    {
+        for (auto &it : bits)
+            it.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    // 2 MB, about 1 % false positives with 2 million files
+    static const uint32 Words = 1 << 18;
+    static const uint32 Probes = 4;
+
+    static void hash(const std::string &key, uint64 &h1, uint64 &h2)
+    {
+        // fnv-1a
+        uint64 h = 14695981039346656037ull;
+        for (char c : key)
+        {
+            h ^= (unsigned char)c;
+            h *= 1099511628211ull;
         }
+        h1 = h;
+        h2 = (h >> 29) | 1;
+    }
+
+    std::vector<std::atomic<uint64>> bits;
+};
+
+// maximum number of files examined in one maintenance step
+static const uint32 MaxWalkedFiles = 1000;
+
+// maximum number of eviction candidates remembered during one walk
+static const uint32 MaxEvictedFiles = 4096;
+
+// seconds between file access time updates
+static const sint64 AccessTimeResolution = 3600;
+
+class CacheFiles : public Cache
+{
+public:
+    CacheFiles(const MapCreateOptions &options) :
+        root(cacheRoot(options)),
+        maxSize((uint64)options.diskCacheMaxSizeMB * 1024 * 1024),
+        disabled(!options.diskCache),
+        hashes(options.hashCachePaths),
+        readOnly(false)
+    {
+        if (!disabled)
+            names.reset(new NamesFilter());
     }
 
-    void write(const CacheData &cd)
+    // read only cache (seed) at the given root
+    CacheFiles(const MapCreateOptions &options, const std::string &seedRoot) :
+        root(seedRoot), maxSize(0), disabled(false),
+        hashes(options.hashCachePaths), readOnly(true)
+    {
+        LOG(info2) << "Seed cache path: <" << root << ">";
+        names.reset(new NamesFilter());
+    }
+
+    void write(const CacheData &cd) override
     {
 #ifndef __EMSCRIPTEN__
-        if (disabled)
+        if (disabled || readOnly)
             return;
         OPTICK_EVENT();
         try
         {
             std::string name = stripScheme(cd.name);
-            Buffer b(sizeof(CacheHeader) + name.size() + cd.buffer.size());
-            memset(b.data(), 0, sizeof(CacheHeader)); // initialize structure padding
-            CacheHeader *h = (CacheHeader*)b.data();
-            memcpy(h->magic, Magic, sizeof(Magic));
-            h->version = Version;
-            if (cd.availFailed)
-                h->flags |= (uint16)CacheFlags::AvailFailed;
-            h->expires = cd.expires;
-            h->nameLen = name.size();
-            memcpy(b.data() + sizeof(CacheHeader), name.data(), name.size());
-            memcpy(b.data() + sizeof(CacheHeader) + name.size(),
-                cd.buffer.data(), cd.buffer.size());
-            writeLocalFileBuffer(convertNameToCache(name), b);
+            Buffer b = CacheHeader::encode(cd, name);
+            std::string fileName = convertNameToCache(name);
+            writeLocalFileBuffer(fileName, b);
+            names->insert(fileName.substr(root.size()));
         }
         catch (...)
         {
@@ -130,7 +202,7 @@ public:
 #endif
     }
 
-    CacheData read(const std::string &nameParam)
+    CacheData read(const std::string &nameParam) override
     {
 #ifdef __EMSCRIPTEN__
         return {};
@@ -145,37 +217,16 @@ public:
         try
         {
             CacheData cd;
-            Buffer b = readLocalFileBuffer(fileName);
-            if (b.size() < sizeof(CacheHeader))
+            std::shared_ptr<Buffer> b = std::make_shared<Buffer>(
+                readLocalFileBuffer(fileName));
+            const CacheHeader *h = (const CacheHeader*)b->data();
+            if (!h->validate(cd, name, b->size()))
                 return {};
-            CacheHeader *h = (CacheHeader*)b.data();
-            if (memcmp(h->magic, Magic, sizeof(Magic)) != 0)
-                return {};
-            if (h->version != Version)
-                return {};
-            sint64 &expires = cd.expires;
-            expires = h->expires;
-            if (expires == -2)
-                return {}; // must revalidate
-            if (expires > 0 && expires < std::time(nullptr))
-                return {}; // expired
-            if (name.size() != h->nameLen)
-                return {};
-            if (b.size() < sizeof(CacheHeader) + h->nameLen)
-                return {};
-            if (memcmp(b.data() + sizeof(CacheHeader),
-                name.data(), h->nameLen) != 0)
-                return {};
-            uint32 size = b.size() - sizeof(CacheHeader) - h->nameLen;
-            if (size > 0)
-            {
-                cd.buffer.allocate(size);
-                memcpy(cd.buffer.data(), b.data()
-                    + sizeof(CacheHeader) + h->nameLen, size);
-            }
-            cd.availFailed = (h->flags & (uint16)CacheFlags::AvailFailed)
-                == (uint16)CacheFlags::AvailFailed;
+            // the content refers directly into the file buffer
+            cd.buffer = h->content(b, b->size());
             cd.name = nameParam;
+            if (maxSize > 0)
+                touch(fileName);
             return cd;
         }
         catch (...)
@@ -185,30 +236,205 @@ public:
 #endif
     }
 
-    void purge()
+    bool mayContain(const std::string &nameParam) override
+    {
+#ifdef __EMSCRIPTEN__
+        return false;
+#else
+        if (disabled)
+            return false;
+        if (!indexed)
+            return true;
+        try
+        {
+            std::string fileName = convertNameToCache(stripScheme(nameParam));
+            return names->test(fileName.substr(root.size()));
+        }
+        catch (...)
+        {
+            return true;
+        }
+#endif
+    }
+
+    // the filter of existing files is filled in by an incremental walk
+    //   which is driven by the writes
+    //   until it finishes, all names are looked up on disk
+    void indexStep()
+    {
+        boost::system::error_code ec;
+        std::time_t now = std::time(nullptr);
+        if (!indexer)
+        {
+            if (now < nextIndex)
+                return;
+            if (!boost::filesystem::exists(root))
+            {
+                indexed = true;
+                return;
+            }
+            indexer.reset(new boost::filesystem
+                ::recursive_directory_iterator(root, ec));
+            if (ec)
+            {
+                indexer.reset();
+                nextIndex = now + 60;
+                return;
+            }
+        }
+        boost::filesystem::recursive_directory_iterator end;
+        for (uint32 i = 0; i < MaxWalkedFiles && *indexer != end; i++)
+        {
+            const boost::filesystem::path p = (*indexer)->path();
+            if (boost::filesystem::is_regular_file(p, ec))
+            {
+                std::string s = p.generic_string();
+                if (s.size() > root.size())
+                    names->insert(s.substr(root.size()));
+            }
+            indexer->increment(ec);
+            if (ec)
+            {
+                indexer.reset();
+                nextIndex = now + 60;
+                return;
+            }
+        }
+        if (*indexer != end)
+            return;
+        indexer.reset();
+        indexed = true;
+        LOG(info2) << "Disk cache index is ready";
+    }
+
+    // the modification time of the files is used as the last access time
+    void touch(const std::string &fileName)
+    {
+        boost::system::error_code ec;
+        std::time_t now = std::time(nullptr);
+        std::time_t t = boost::filesystem::last_write_time(fileName, ec);
+        if (!ec && t + AccessTimeResolution < now)
+            boost::filesystem::last_write_time(fileName, now, ec);
+    }
+
+    // the cache directory is walked incrementally,
+    //   summing the size of all files
+    //   and remembering the least recently used files
+    // when the walk finishes, the remembered files are deleted
+    //   until the size limit is satisfied
+    void maintenance() override
     {
 #ifndef __EMSCRIPTEN__
         if (disabled)
             return;
         OPTICK_EVENT();
-        LOG(info2) << "Purging disk cache";
-        assert(root.length() > 0 && root[root.length() - 1] == '/');
-        std::string op = root.substr(0, root.length() - 1);
-        if (!boost::filesystem::exists(op))
+        try
+        {
+            if (!indexed)
+                indexStep();
+        }
+        catch (...)
+        {
+            indexer.reset();
+            nextIndex = std::time(nullptr) + 60;
+        }
+        if (maxSize == 0)
             return;
         try
         {
-            std::string np = op + "-deleted";
-            boost::filesystem::rename(op, np);
-            boost::filesystem::remove_all(np);
+            std::time_t now = std::time(nullptr);
+            boost::system::error_code ec;
+            if (!walker)
+            {
+                if (now < nextWalk || !boost::filesystem::exists(root))
+                    return;
+                walker.reset(new boost::filesystem
+                    ::recursive_directory_iterator(root, ec));
+                if (ec)
+                {
+                    walker.reset();
+                    nextWalk = now + 60;
+                    return;
+                }
+                walkSize = 0;
+                candidates.clear();
+            }
+            boost::filesystem::recursive_directory_iterator end;
+            for (uint32 i = 0; i < MaxWalkedFiles && *walker != end; i++)
+            {
+                const boost::filesystem::path p = (*walker)->path();
+                if (boost::filesystem::is_regular_file(p, ec))
+                {
+                    Candidate c;
+                    c.size = boost::filesystem::file_size(p, ec);
+                    c.time = boost::filesystem::last_write_time(p, ec);
+                    walkSize += c.size;
+                    if (candidates.size() < MaxEvictedFiles
+                        || c < candidates.front())
+                    {
+                        c.path = p.string();
+                        candidates.push_back(std::move(c));
+                        std::push_heap(candidates.begin(), candidates.end());
+                        if (candidates.size() > MaxEvictedFiles)
+                        {
+                            std::pop_heap(candidates.begin(),
+                                candidates.end());
+                            candidates.pop_back();
+                        }
+                    }
+                }
+                walker->increment(ec);
+                if (ec)
+                    break;
+            }
+            if (!ec && *walker != end)
+                return; // continue the walk next time
+            walker.reset();
+            nextWalk = now + 600;
+            if (walkSize <= maxSize)
+                return;
+            OPTICK_EVENT("evict");
+            uint64 target = maxSize * 9 / 10;
+            std::sort(candidates.begin(), candidates.end());
+            uint32 cnt = 0;
+            for (const Candidate &c : candidates)
+            {
+                if (walkSize <= target)
+                    break;
+                if (boost::filesystem::remove(c.path, ec))
+                {
+                    walkSize -= c.size;
+                    cnt++;
+                }
+            }
+            candidates.clear();
+            if (walkSize > target)
+                nextWalk = now; // there is more to evict
+            LOG(info2) << "Evicted <" << cnt << "> files from disk cache, "
+                "remaining <" << (walkSize / 1024 / 1024) << "> MB";
         }
         catch (const std::exception &e)
         {
-            LOG(warn3) << "Purging cache failed: <" << e.what() << ">";
+            walker.reset();
+            nextWalk = std::time(nullptr) + 60;
+            LOG(warn2) << "Disk cache maintenance failed, error <"
+                << e.what() << ">";
         }
 #endif
     }
 
+    void purge() override
+    {
+#ifndef __EMSCRIPTEN__
+        if (disabled || readOnly)
+            return;
+        OPTICK_EVENT();
+        LOG(info2) << "Purging disk cache";
+        purgeDirectory(root);
+        names->clear();
+#endif
+    }
+
     std::string convertNameToCache(const std::string &path)
     {
         assert(path == stripScheme(path));
@@ -238,25 +464,331 @@ public:
         }
     }
 
-    std::string stripScheme(const std::string &name)
+    struct Candidate
     {
-        auto p = name.find("://");
-        return p == std::string::npos ? name : name.substr(p + 3);
-    }
+        std::string path;
+        uint64 size = 0;
+        std::time_t time = 0;
+        bool operator < (const Candidate &other) const
+        {
+            return time < other.time;
+        }
+    };
 
     std::string root;
+    const uint64 maxSize;
     const bool disabled;
     const bool hashes;
+    const bool readOnly;
+
+    // maintenance state
+    std::unique_ptr<boost::filesystem::recursive_directory_iterator> walker;
+    std::vector<Candidate> candidates; // max-heap of the oldest files
+    uint64 walkSize = 0;
+    std::time_t nextWalk = 0;
+
+    // index of existing files
+    std::unique_ptr<NamesFilter> names;
+    std::unique_ptr<boost::filesystem::recursive_directory_iterator> indexer;
+    std::time_t nextIndex = 0;
+    std::atomic<bool> indexed{ false };
+};
+
+// read only seeds are looked up first, in order
+//   falling back to the local writable cache
+// fresh seeded entries are never fetched, hence never written locally
+// stale seeded entries are revalidated and the result is stored locally
+class CacheTiered : public Cache
+{
+public:
+    CacheTiered(std::vector<std::shared_ptr<Cache>> &&seeds,
+        const std::shared_ptr<Cache> &local) :
+        seeds(std::move(seeds)), local(local)
+    {}
+
+    void write(const CacheData &cd) override
+    {
+        local->write(cd);
+    }
+
+    void write(const std::vector<CacheData> &batch) override
+    {
+        local->write(batch);
+    }
+
+    CacheData read(const std::string &name) override
+    {
+        CacheData stale;
+        for (const auto &s : seeds)
+        {
+            if (!s->mayContain(name))
+                continue;
+            CacheData cd = s->read(name);
+            if (cd.name.empty())
+                continue;
+            if (!cd.stale)
+                return cd;
+            if (stale.name.empty())
+                stale = std::move(cd);
+        }
+        CacheData cd = local->read(name);
+        if (!cd.name.empty())
+            return cd;
+        return stale;
+    }
+
+    bool mayContain(const std::string &name) override
+    {
+        for (const auto &s : seeds)
+            if (s->mayContain(name))
+                return true;
+        return local->mayContain(name);
+    }
+
+    void purge() override
+    {
+        local->purge();
+    }
+
+    void maintenance() override
+    {
+        local->maintenance();
+        for (const auto &s : seeds)
+            s->maintenance();
+    }
+
+private:
+    const std::vector<std::shared_ptr<Cache>> seeds;
+    const std::shared_ptr<Cache> local;
 };
 
+} // namespace
+
+const char CacheHeader::Magic[] = "vtscache";
+const uint16 CacheHeader::Version = 6;
+
+void CacheHeader::initialize(const CacheData &cd, const std::string &name)
+{
+    memset(this, 0, sizeof(CacheHeader)); // initialize structure padding
+    memcpy(magic, Magic, sizeof(Magic));
+    version = Version;
+    if (cd.availFailed)
+        flags |= (uint16)Flags::AvailFailed;
+    expires = cd.expires;
+    nameLen = name.size();
+    etagLen = cd.etag.size();
+    lastModifiedLen = cd.lastModified.size();
+}
+
+Buffer CacheHeader::encode(const CacheData &cd, const std::string &name)
+{
+    if (name.size() > 0xffff || cd.etag.size() > 0xffff
+        || cd.lastModified.size() > 0xffff)
+    {
+        LOGTHROW(err1, std::runtime_error)
+            << "Name or validators too long for cache entry";
+    }
+    Buffer packed;
+    if (cd.compress && worthCompressing(cd.buffer))
+        packed = compressContent(cd.buffer);
+    const Buffer &content = packed.size() ? packed : cd.buffer;
+    Buffer b(sizeof(CacheHeader) + name.size() + cd.etag.size()
+        + cd.lastModified.size() + content.size());
+    CacheHeader *h = (CacheHeader*)b.data();
+    h->initialize(cd, name);
+    if (packed.size())
+    {
+        h->flags |= (uint16)Flags::Compressed;
+        h->rawSize = cd.buffer.size();
+    }
+    char *p = b.data() + sizeof(CacheHeader);
+    memcpy(p, name.data(), name.size());
+    p += name.size();
+    memcpy(p, cd.etag.data(), cd.etag.size());
+    p += cd.etag.size();
+    memcpy(p, cd.lastModified.data(), cd.lastModified.size());
+    p += cd.lastModified.size();
+    memcpy(p, content.data(), content.size());
+    return b;
+}
+
+Buffer CacheHeader::content(const std::shared_ptr<void> &owner,
+    uint64 available) const
+{
+    const uint32 offset = contentOffset();
+    if (available <= offset)
+        return {};
+    char *data = (char*)this + offset;
+    const uint32 size = available - offset;
+    if ((flags & (uint16)Flags::Compressed) == 0)
+        return Buffer(owner, data, size);
+    Buffer raw(rawSize);
+    uLongf len = rawSize;
+    if (uncompress((Bytef*)raw.data(), &len, (const Bytef*)data, size)
+        != Z_OK || len != rawSize)
+    {
+        LOGTHROW(err1, std::runtime_error)
+            << "Failed to decompress cache entry";
+    }
+    return raw;
+}
+
+uint32 CacheHeader::contentOffset() const
+{
+    return sizeof(CacheHeader) + nameLen + etagLen + lastModifiedLen;
+}
+
+bool CacheHeader::validate(CacheData &cd, const std::string &name,
+    uint64 available) const
+{
+    if (available < sizeof(CacheHeader))
+        return false;
+    if (memcmp(magic, Magic, sizeof(Magic)) != 0)
+        return false;
+    if (version != Version)
+        return false;
+    cd.expires = expires;
+    cd.stale = expires == -2 // must revalidate
+        || (expires > 0 && expires < std::time(nullptr)); // expired
+    if (cd.stale && etagLen == 0 && lastModifiedLen == 0)
+        return false; // cannot be revalidated
+    if (name.size() != nameLen)
+        return false;
+    if (available < contentOffset())
+        return false;
+    const char *p = (const char*)this + sizeof(CacheHeader);
+    if (memcmp(p, name.data(), nameLen) != 0)
+        return false;
+    p += nameLen;
+    cd.etag.assign(p, etagLen);
+    p += etagLen;
+    cd.lastModified.assign(p, lastModifiedLen);
+    cd.availFailed = (flags & (uint16)Flags::AvailFailed)
+        == (uint16)Flags::AvailFailed;
+    return true;
+}
+
+Cache::~Cache()
+{}
+
+void Cache::write(const std::vector<CacheData> &batch)
+{
+    for (const CacheData &cd : batch)
+        write(cd);
+}
+
+void Cache::maintenance()
+{}
+
+bool Cache::mayContain(const std::string &)
+{
+    return true;
+}
+
+std::string Cache::stripScheme(const std::string &name)
+{
+    auto p = name.find("://");
+    return p == std::string::npos ? name : name.substr(p + 3);
+}
+
+std::shared_ptr<Cache> Cache::create(const MapCreateOptions &options)
+{
+#ifdef __EMSCRIPTEN__
+    if (options.diskCache)
+        return createIdbCache(options);
+    return createFilesCache(options);
+#else
+    std::shared_ptr<Cache> local;
+    if (options.diskCache && options.diskCachePacked)
+        local = createPackedCache(options);
+    else
+        local = createFilesCache(options);
+    std::vector<std::shared_ptr<Cache>> seeds;
+    std::string paths = options.diskCacheSeeds;
+    while (!paths.empty())
+    {
+        auto p = paths.find(';');
+        std::string root = paths.substr(0, p);
+        paths = p == std::string::npos ? "" : paths.substr(p + 1);
+        if (root.empty())
+            continue;
+        if (root.back() != '/')
+            root += "/";
+        seeds.push_back(createSeedCache(options, root));
+    }
+    if (seeds.empty())
+        return local;
+    return std::make_shared<CacheTiered>(std::move(seeds), local);
+#endif
+}
+
+std::shared_ptr<Cache> createFilesCache(const MapCreateOptions &options)
+{
+    return std::make_shared<CacheFiles>(options);
+}
+
+std::shared_ptr<Cache> createSeedCache(const MapCreateOptions &options,
+    const std::string &root)
+{
+    // the layout of the seed is detected
+    if (boost::filesystem::exists(root + "packed/index"))
+        return createPackedSeedCache(root);
+    return std::make_shared<CacheFiles>(options, root);
+}
+
+std::string cacheRoot(const MapCreateOptions &options)
+{
+    std::string root = options.cachePath;
+    if (options.diskCache)
+    {
+#ifdef __EMSCRIPTEN__
+        LOGTHROW(err4, std::logic_error)
+            << "Disk Cache is not available in WASM";
+#else
+        if (root.empty())
+        {
+            root = utility::homeDir().string();
+            if (root.empty())
+            {
+                LOGTHROW(err3, std::runtime_error)
+                    << "Invalid home dir, the cache path must be defined";
+            }
+            root += "/.cache/vts-browser/";
+        }
+        if (root.back() != '/')
+            root += "/";
+        LOG(info2) << "Disk cache path: <" << root << ">";
+#endif
+    }
+    return root;
+}
+
+void purgeDirectory(const std::string &root)
+{
+    assert(root.length() > 0 && root[root.length() - 1] == '/');
+    std::string op = root.substr(0, root.length() - 1);
+    if (!boost::filesystem::exists(op))
+        return;
+    try
+    {
+        std::string np = op + "-deleted";
+        boost::filesystem::rename(op, np);
+        boost::filesystem::remove_all(np);
+    }
+    catch (const std::exception &e)
+    {
+        LOG(warn3) << "Purging cache failed: <" << e.what() << ">";
+    }
+}
+
 void Resources::cacheInit()
 {
-    map->cache = std::make_shared<Cache>(map->createOptions);
+    map->cache = Cache::create(map->createOptions);
 }
 
-void Resources::cacheWrite(const CacheData &data)
+void Resources::cacheWrite(const std::vector<CacheData> &batch)
 {
-    map->cache->write(data);
+    map->cache->write(batch);
 }
 
 CacheData Resources::cacheRead(const std::string &name)
@@ -0,0 +1,450 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "../include/vts-browser/mapOptions.hpp"
+#include "../resources.hpp"
+#include "../cache.hpp"
+
+#include <dbglog/dbglog.hpp>
+#include <optick.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#include <emscripten/threading.h>
+
+#include <unordered_map>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include <cstring>
+#include <ctime>
+#endif
+
+namespace vts
+{
+
+#ifdef __EMSCRIPTEN__
+
+namespace
+{
+
+// key of the record with the index of all entries
+static const char IndexKey[] = "vts-cache-index";
+static const uint32 IndexVersion = 1;
+
+// seconds between writes of the index
+static const sint64 IndexWriteInterval = 30;
+
+struct Entry
+{
+    uint64 lastAccess = 0;
+    sint64 expires = 0;
+    uint32 size = 0;
+};
+
+// shared with the pending requests,
+//   which may outlive the cache itself
+struct IdbState
+{
+    std::string db;
+    std::unordered_map<std::string, Entry> index;
+    std::mutex mut;
+    uint64 liveSize = 0;
+    uint64 accessTick = 0;
+    bool indexLoaded = false;
+    bool indexDirty = false;
+};
+
+struct IdbRequest
+{
+    std::shared_ptr<IdbState> state;
+    std::string key;
+    Buffer data;
+
+    // synchronization for reads
+    std::mutex mut;
+    std::condition_variable con;
+    bool done = false;
+};
+
+// the IndexedDB is accessed asynchronously on the main browser thread
+//   whose event loop invokes the callbacks
+// reads block only the calling cache read thread
+// writes and deletes do not wait at all
+class CacheIdb : public Cache
+{
+public:
+    CacheIdb(const MapCreateOptions &options) :
+        state(std::make_shared<IdbState>()),
+        maxSize((uint64)options.diskCacheMaxSizeMB * 1024 * 1024)
+    {
+        state->db = options.cachePath.empty()
+            ? std::string("vts-browser-cache") : options.cachePath;
+        LOG(info2) << "IndexedDB cache database: <" << state->db << ">";
+        IdbRequest *r = new IdbRequest();
+        r->state = state;
+        r->key = IndexKey;
+        emscripten_async_run_in_main_runtime_thread(EM_FUNC_SIG_VI,
+            &CacheIdb::loadIndexMain, r);
+    }
+
+    void write(const CacheData &cd) override
+    {
+        OPTICK_EVENT();
+        try
+        {
+            std::string name = stripScheme(cd.name);
+            IdbRequest *r = new IdbRequest();
+            r->state = state;
+            r->key = name;
+            r->data = CacheHeader::encode(cd, name);
+            {
+                std::lock_guard<std::mutex> lock(state->mut);
+                Entry &e = state->index[name];
+                state->liveSize -= e.size;
+                e.size = r->data.size();
+                e.expires = cd.expires;
+                e.lastAccess = ++state->accessTick;
+                state->liveSize += e.size;
+                state->indexDirty = true;
+            }
+            emscripten_async_run_in_main_runtime_thread(EM_FUNC_SIG_VI,
+                &CacheIdb::storeMain, r);
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn2) << "Failed writing <" << cd.name
+                << "> into IndexedDB cache, error <" << e.what() << ">";
+        }
+    }
+
+    CacheData read(const std::string &nameParam) override
+    {
+        OPTICK_EVENT();
+        // waiting on the main thread would deadlock
+        if (emscripten_is_main_browser_thread())
+            return {};
+        std::string name = stripScheme(nameParam);
+        {
+            std::lock_guard<std::mutex> lock(state->mut);
+            auto it = state->index.find(name);
+            if (it == state->index.end())
+            {
+                if (state->indexLoaded)
+                    return {}; // avoid the round trip
+            }
+            else
+                it->second.lastAccess = ++state->accessTick;
+        }
+        std::shared_ptr<IdbRequest> r = std::make_shared<IdbRequest>();
+        r->state = state;
+        r->key = name;
+        emscripten_async_run_in_main_runtime_thread(EM_FUNC_SIG_VI,
+            &CacheIdb::loadMain, new std::shared_ptr<IdbRequest>(r));
+        {
+            std::unique_lock<std::mutex> lock(r->mut);
+            r->con.wait(lock, [&]() { return r->done; });
+        }
+        try
+        {
+            CacheData cd;
+            const CacheHeader *h = (const CacheHeader*)r->data.data();
+            if (!h->validate(cd, name, r->data.size()))
+                return {};
+            auto b = std::make_shared<Buffer>(std::move(r->data));
+            h = (const CacheHeader*)b->data();
+            cd.buffer = h->content(b, b->size());
+            cd.name = nameParam;
+            return cd;
+        }
+        catch (...)
+        {
+            return {};
+        }
+    }
+
+    bool mayContain(const std::string &nameParam) override
+    {
+        std::string name = stripScheme(nameParam);
+        std::lock_guard<std::mutex> lock(state->mut);
+        return !state->indexLoaded || state->index.count(name) > 0;
+    }
+
+    void purge() override
+    {
+        OPTICK_EVENT();
+        LOG(info2) << "Purging IndexedDB cache";
+        std::vector<std::string> names;
+        {
+            std::lock_guard<std::mutex> lock(state->mut);
+            names.reserve(state->index.size());
+            for (const auto &it : state->index)
+                names.push_back(it.first);
+            state->index.clear();
+            state->liveSize = 0;
+            state->indexDirty = true;
+        }
+        for (const std::string &n : names)
+            remove(n);
+        writeIndex();
+    }
+
+    // evicts entries exceeding the size limit
+    //   and periodically saves the index
+    void maintenance() override
+    {
+        OPTICK_EVENT();
+        if (maxSize > 0)
+            evict();
+        sint64 now = std::time(nullptr);
+        if (now > lastIndexWrite + IndexWriteInterval)
+        {
+            lastIndexWrite = now;
+            writeIndex();
+        }
+    }
+
+private:
+    void evict()
+    {
+        std::vector<std::string> removed;
+        {
+            std::lock_guard<std::mutex> lock(state->mut);
+            if (state->liveSize <= maxSize)
+                return;
+            OPTICK_EVENT("evict");
+            uint64 target = maxSize * 9 / 10;
+            sint64 now = std::time(nullptr);
+            // expired entries first, then the least recently used ones
+            std::vector<std::pair<uint64, const std::string *>> order;
+            order.reserve(state->index.size());
+            for (const auto &it : state->index)
+            {
+                const Entry &e = it.second;
+                bool expired = e.expires == -2
+                    || (e.expires > 0 && e.expires < now);
+                order.emplace_back(expired ? 0 : e.lastAccess, &it.first);
+            }
+            std::sort(order.begin(), order.end());
+            uint64 size = state->liveSize;
+            for (const auto &it : order)
+            {
+                if (size <= target)
+                    break;
+                size -= state->index[*it.second].size;
+                removed.push_back(*it.second);
+            }
+            for (const std::string &n : removed)
+                state->index.erase(n);
+            state->liveSize = size;
+            state->indexDirty = true;
+        }
+        for (const std::string &n : removed)
+            remove(n);
+        LOG(info2) << "Evicted <" << removed.size()
+            << "> entries from IndexedDB cache";
+    }
+
+    void remove(const std::string &name)
+    {
+        IdbRequest *r = new IdbRequest();
+        r->state = state;
+        r->key = name;
+        emscripten_async_run_in_main_runtime_thread(EM_FUNC_SIG_VI,
+            &CacheIdb::deleteMain, r);
+    }
+
+    // record: name length, name, size, expires, last access
+    void writeIndex()
+    {
+        IdbRequest *r = new IdbRequest();
+        r->state = state;
+        r->key = IndexKey;
+        {
+            std::lock_guard<std::mutex> lock(state->mut);
+            if (!state->indexDirty)
+            {
+                delete r;
+                return;
+            }
+            state->indexDirty = false;
+            std::string s;
+            s.append((const char*)&IndexVersion, sizeof(IndexVersion));
+            for (const auto &it : state->index)
+            {
+                uint32 l = it.first.size();
+                s.append((const char*)&l, sizeof(l));
+                s.append(it.first);
+                s.append((const char*)&it.second.size, sizeof(uint32));
+                s.append((const char*)&it.second.expires, sizeof(sint64));
+                s.append((const char*)&it.second.lastAccess, sizeof(uint64));
+            }
+            r->data = Buffer(s);
+        }
+        emscripten_async_run_in_main_runtime_thread(EM_FUNC_SIG_VI,
+            &CacheIdb::storeMain, r);
+    }
+
+    static void parseIndex(IdbState *st, const char *p, uint32 size)
+    {
+        const char *end = p + size;
+        uint32 version = 0;
+        if (size < sizeof(version))
+            return;
+        memcpy(&version, p, sizeof(version));
+        p += sizeof(version);
+        if (version != IndexVersion)
+            return;
+        static const uint32 fixed = sizeof(uint32) + sizeof(sint64)
+            + sizeof(uint64);
+        while (end - p >= (std::ptrdiff_t)sizeof(uint32))
+        {
+            uint32 l = 0;
+            memcpy(&l, p, sizeof(l));
+            p += sizeof(l);
+            if ((uint64)(end - p) < (uint64)l + fixed)
+                return;
+            std::string name(p, l);
+            p += l;
+            Entry e;
+            memcpy(&e.size, p, sizeof(uint32));
+            p += sizeof(uint32);
+            memcpy(&e.expires, p, sizeof(sint64));
+            p += sizeof(sint64);
+            memcpy(&e.lastAccess, p, sizeof(uint64));
+            p += sizeof(uint64);
+            // entries written before the index finished loading win
+            if (st->index.emplace(name, e).second)
+            {
+                st->liveSize += e.size;
+                st->accessTick = std::max(st->accessTick, e.lastAccess);
+            }
+        }
+    }
+
+    // callbacks on the main browser thread
+
+    static void loadIndexMain(IdbRequest *r)
+    {
+        emscripten_idb_async_load(r->state->db.c_str(), r->key.c_str(), r,
+            [](void *arg, void *buf, int size) {
+                IdbRequest *r = (IdbRequest*)arg;
+                {
+                    std::lock_guard<std::mutex> lock(r->state->mut);
+                    parseIndex(r->state.get(), (const char*)buf, size);
+                    r->state->indexLoaded = true;
+                }
+                delete r;
+            },
+            [](void *arg) {
+                IdbRequest *r = (IdbRequest*)arg;
+                {
+                    // no index yet
+                    std::lock_guard<std::mutex> lock(r->state->mut);
+                    r->state->indexLoaded = true;
+                }
+                delete r;
+            });
+    }
+
+    static void loadMain(std::shared_ptr<IdbRequest> *p)
+    {
+        emscripten_idb_async_load(
+            (*p)->state->db.c_str(), (*p)->key.c_str(), p,
+            [](void *arg, void *buf, int size) {
+                auto p = (std::shared_ptr<IdbRequest>*)arg;
+                IdbRequest *r = p->get();
+                {
+                    // the buffer is released after the callback returns
+                    std::lock_guard<std::mutex> lock(r->mut);
+                    r->data.allocate(size);
+                    memcpy(r->data.data(), buf, size);
+                    r->done = true;
+                }
+                r->con.notify_all();
+                delete p;
+            },
+            [](void *arg) {
+                auto p = (std::shared_ptr<IdbRequest>*)arg;
+                IdbRequest *r = p->get();
+                {
+                    std::lock_guard<std::mutex> lock(r->mut);
+                    r->done = true;
+                }
+                r->con.notify_all();
+                delete p;
+            });
+    }
+
+    static void storeMain(IdbRequest *r)
+    {
+        emscripten_idb_async_store(r->state->db.c_str(), r->key.c_str(),
+            r->data.data(), r->data.size(), r,
+            [](void *arg) {
+                delete (IdbRequest*)arg;
+            },
+            [](void *arg) {
+                IdbRequest *r = (IdbRequest*)arg;
+                LOG(warn2) << "Failed storing <" << r->key
+                    << "> into IndexedDB cache";
+                delete r;
+            });
+    }
+
+    static void deleteMain(IdbRequest *r)
+    {
+        emscripten_idb_async_delete(r->state->db.c_str(), r->key.c_str(), r,
+            [](void *arg) {
+                delete (IdbRequest*)arg;
+            },
+            [](void *arg) {
+                delete (IdbRequest*)arg;
+            });
+    }
+
+    std::shared_ptr<IdbState> state;
+    const uint64 maxSize;
+    sint64 lastIndexWrite = 0;
+};
+
+} // namespace
+
+#endif // __EMSCRIPTEN__
+
+std::shared_ptr<Cache> createIdbCache(const MapCreateOptions &options)
+{
+#ifdef __EMSCRIPTEN__
+    return std::make_shared<CacheIdb>(options);
+#else
+    LOGTHROW(err4, std::logic_error)
+        << "IndexedDB cache is available in WASM only";
+    throw;
+#endif
+}
+
+} // namespace vts
@@ -0,0 +1,820 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "../include/vts-browser/mapOptions.hpp"
+#include "../resources.hpp"
+#include "../cache.hpp"
+
+#include <dbglog/dbglog.hpp>
+#include <optick.h>
+
+#ifndef __EMSCRIPTEN__
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <unordered_map>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#endif
+
+namespace vts
+{
+
+#ifndef __EMSCRIPTEN__
+
+namespace
+{
+
+static const char IndexMagic[] = "vtspackindex";
+static const uint16 IndexVersion = 2;
+
+// new pack file is started once the current one exceeds this size
+static const uint64 PackSizeLimit = 64 * 1024 * 1024;
+
+// maximum number of simultaneously mapped pack files
+static const uint32 MaxMappedPacks = 16;
+
+// maximum number of entries evicted in one maintenance step
+static const uint32 MaxEvictedEntries = 4096;
+
+// maximum number of entries relocated in one maintenance step
+static const uint32 MaxRelocatedEntries = 256;
+
+// number of index entries examined while holding the lock
+static const uint32 IndexChunkSize = 10000;
+
+struct IndexHeader
+{
+    char magic[16];
+    uint16 version;
+};
+
+// size == 0 denotes removed entry
+struct IndexRecord
+{
+    uint64 offset;
+    sint64 expires;
+    uint32 pack;
+    uint32 size;
+    uint16 nameLen;
+};
+
+struct Location
+{
+    uint64 offset = 0;
+    uint64 lastAccess = 0;
+    sint64 expires = 0;
+    uint32 pack = 0;
+    uint32 size = 0; // including header, name and validators
+};
+
+struct PackInfo
+{
+    uint64 total = 0; // file size
+    uint64 live = 0; // bytes referenced by the index
+};
+
+struct MappedPack
+{
+    boost::iostreams::mapped_file file;
+    uint32 lastUse = 0;
+};
+
+// all entries are appended into a few large pack files
+//   and their locations are stored in an append-only index
+// reads return buffers pointing directly into the mapped files
+// the index is loaded into memory in the constructor
+// this avoids excessive filesystem metadata operations
+//   when the cache contains millions of small resources
+// maintenance (called on the cache write thread) evicts entries
+//   when the cache exceeds its size limit
+//   and compacts packs with mostly removed entries
+// read only caches (seeds) are never modified, not even purged
+class CachePacked : public Cache
+{
+public:
+    CachePacked(const MapCreateOptions &options) :
+        root(cacheRoot(options) + "packed/"),
+        maxSize((uint64)options.diskCacheMaxSizeMB * 1024 * 1024),
+        readOnly(false)
+    {
+        LOG(info2) << "Packed disk cache path: <" << root << ">";
+        std::lock_guard<std::mutex> lock(mut);
+        open();
+    }
+
+    CachePacked(const std::string &seedRoot) :
+        root(seedRoot + "packed/"), maxSize(0), readOnly(true)
+    {
+        LOG(info2) << "Packed seed cache path: <" << root << ">";
+        std::lock_guard<std::mutex> lock(mut);
+        openReadOnly();
+    }
+
+    ~CachePacked()
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        close();
+    }
+
+    void write(const CacheData &cd) override
+    {
+        OPTICK_EVENT();
+        std::lock_guard<std::mutex> lock(mut);
+        if (!packFile || !indexFile)
+            return;
+        try
+        {
+            std::string name = stripScheme(cd.name);
+            Buffer b = CacheHeader::encode(cd, name);
+            append(name, b.data(), b.size(), cd.expires);
+            flush();
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn2) << "Failed writing <" << cd.name
+                << "> into packed cache, error <" << e.what() << ">";
+        }
+    }
+
+    void write(const std::vector<CacheData> &batch) override
+    {
+        OPTICK_EVENT();
+        // the items are appended sequentially and flushed together
+        std::lock_guard<std::mutex> lock(mut);
+        if (!packFile || !indexFile)
+            return;
+        for (const CacheData &cd : batch)
+        {
+            try
+            {
+                std::string name = stripScheme(cd.name);
+                Buffer b = CacheHeader::encode(cd, name);
+                append(name, b.data(), b.size(), cd.expires);
+            }
+            catch (const std::exception &e)
+            {
+                LOG(warn2) << "Failed writing <" << cd.name
+                    << "> into packed cache, error <" << e.what() << ">";
+            }
+        }
+        try
+        {
+            flush();
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn2) << "Failed flushing packed cache, error <"
+                << e.what() << ">";
+        }
+    }
+
+    CacheData read(const std::string &nameParam) override
+    {
+        OPTICK_EVENT();
+        std::string name = stripScheme(nameParam);
+        std::lock_guard<std::mutex> lock(mut);
+        auto it = index.find(name);
+        if (it == index.end())
+            return {};
+        try
+        {
+            Location &loc = it->second;
+            loc.lastAccess = ++accessTick;
+            std::shared_ptr<MappedPack> m = mapped(loc);
+            if (!m)
+                return {};
+            char *data = (char*)m->file.data() + loc.offset;
+            CacheData cd;
+            const CacheHeader *h = (const CacheHeader*)data;
+            if (!h->validate(cd, name, loc.size))
+                return {};
+            // the content refers directly into the mapped memory
+            //   the mapping is private (copy on write)
+            //   and is kept alive by the buffer
+            cd.buffer = h->content(m, loc.size);
+            cd.name = nameParam;
+            return cd;
+        }
+        catch (...)
+        {
+            return {};
+        }
+    }
+
+    bool mayContain(const std::string &nameParam) override
+    {
+        std::string name = stripScheme(nameParam);
+        std::lock_guard<std::mutex> lock(mut);
+        return index.count(name) > 0;
+    }
+
+    void purge() override
+    {
+        OPTICK_EVENT();
+        if (readOnly)
+            return;
+        LOG(info2) << "Purging packed disk cache";
+        std::lock_guard<std::mutex> lock(mut);
+        close();
+        purgeDirectory(root);
+        open();
+    }
+
+    void maintenance() override
+    {
+        OPTICK_EVENT();
+        try
+        {
+            // the write thread changes these concurrently
+            uint64 live = 0, disk = 0;
+            bool rewrite = false;
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                if (!packFile || !indexFile)
+                    return;
+                live = liveSize;
+                for (const auto &it : packs)
+                    disk += it.second.total;
+                rewrite = indexRecords > 2 * index.size() + IndexChunkSize;
+            }
+            // the limit applies to the files on disk
+            //   which include the removed entries too
+            const bool over = maxSize > 0 && disk > maxSize;
+            if (over && live > maxSize * 9 / 10)
+                evict();
+            else
+                compact(over);
+            if (rewrite)
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                rewriteIndex();
+            }
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn2) << "Packed cache maintenance failed, error <"
+                << e.what() << ">";
+        }
+    }
+
+private:
+    std::string packPath(uint32 pack) const
+    {
+        char buf[32];
+        sprintf(buf, "%08u.pack", pack);
+        return root + buf;
+    }
+
+    static Buffer indexRecord(const std::string &name, const Location &loc)
+    {
+        Buffer r(sizeof(IndexRecord) + name.size());
+        IndexRecord *ir = (IndexRecord*)r.data();
+        memset(ir, 0, sizeof(IndexRecord)); // initialize structure padding
+        ir->offset = loc.offset;
+        ir->expires = loc.expires;
+        ir->pack = loc.pack;
+        ir->size = loc.size;
+        ir->nameLen = name.size();
+        memcpy(r.data() + sizeof(IndexRecord), name.data(), name.size());
+        return r;
+    }
+
+    // must be called with the lock held
+    void appendIndex(const std::string &name, const Location &loc)
+    {
+        Buffer r = indexRecord(name, loc);
+        if (fwrite(r.data(), r.size(), 1, indexFile) != 1)
+        {
+            LOGTHROW(err1, std::runtime_error)
+                << "Failed to write into pack index";
+        }
+        indexRecords++;
+    }
+
+    // must be called with the lock held
+    //   the pack must be flushed before the index
+    //   so that the index never refers to missing data
+    void flush()
+    {
+        if (fflush(packFile) != 0 || fflush(indexFile) != 0)
+        {
+            LOGTHROW(err1, std::runtime_error)
+                << "Failed to flush pack files";
+        }
+    }
+
+    // must be called with the lock held
+    //   call flush afterwards
+    void append(const std::string &name, const char *data, uint32 size,
+        sint64 expires)
+    {
+        if (packSize > 0 && packSize + size > PackSizeLimit)
+            startPack(packIndex + 1);
+
+        Location loc;
+        loc.pack = packIndex;
+        loc.offset = packSize;
+        loc.size = size;
+        loc.expires = expires;
+        loc.lastAccess = ++accessTick;
+        if (fwrite(data, size, 1, packFile) != 1)
+        {
+            LOGTHROW(err1, std::runtime_error)
+                << "Failed to write into pack file";
+        }
+        packSize += size;
+        packs[packIndex].total = packSize;
+
+        appendIndex(name, loc);
+        auto it = index.find(name);
+        if (it != index.end())
+            release(it->second);
+        index[name] = loc;
+        packs[loc.pack].live += loc.size;
+        liveSize += loc.size;
+    }
+
+    // must be called with the lock held
+    void release(const Location &loc)
+    {
+        packs[loc.pack].live -= loc.size;
+        liveSize -= loc.size;
+    }
+
+    // must be called with the lock held
+    void remove(const std::string &name)
+    {
+        auto it = index.find(name);
+        if (it == index.end())
+            return;
+        Location loc = it->second;
+        release(loc);
+        index.erase(it);
+        loc.size = 0;
+        appendIndex(name, loc);
+        flush();
+    }
+
+    // returns false if the index is damaged
+    bool loadIndex(const Buffer &b)
+    {
+        uint64 pos = sizeof(IndexHeader);
+        while (pos < b.size())
+        {
+            if (pos + sizeof(IndexRecord) > b.size())
+                return false;
+            const IndexRecord *ir = (const IndexRecord*)(b.data() + pos);
+            pos += sizeof(IndexRecord);
+            if (pos + ir->nameLen > b.size())
+                return false;
+            std::string name(b.data() + pos, ir->nameLen);
+            pos += ir->nameLen;
+            indexRecords++;
+            if (ir->size == 0)
+            {
+                index.erase(name);
+                continue;
+            }
+            Location &loc = index[name];
+            loc.offset = ir->offset;
+            loc.expires = ir->expires;
+            loc.pack = ir->pack;
+            loc.size = ir->size;
+            loc.lastAccess = ++accessTick; // approximated by write order
+        }
+        return true;
+    }
+
+    // must be called with the lock held
+    void rewriteIndex()
+    {
+        if (indexFile)
+            fclose(indexFile);
+        indexFile = nullptr;
+        Buffer b(sizeof(IndexHeader));
+        IndexHeader *h = (IndexHeader*)b.data();
+        memset(h, 0, sizeof(IndexHeader));
+        memcpy(h->magic, IndexMagic, sizeof(IndexMagic));
+        h->version = IndexVersion;
+        uint64 total = b.size();
+        for (const auto &it : index)
+            total += sizeof(IndexRecord) + it.first.size();
+        b.resize(total);
+        uint64 pos = sizeof(IndexHeader);
+        for (const auto &it : index)
+        {
+            Buffer r = indexRecord(it.first, it.second);
+            memcpy(b.data() + pos, r.data(), r.size());
+            pos += r.size();
+        }
+        std::string indexPath = root + "index";
+        writeLocalFileBuffer(indexPath, b);
+        indexRecords = index.size();
+        indexFile = fopen(indexPath.c_str(), "ab");
+        if (!indexFile)
+            LOGTHROW(err2, std::runtime_error)
+                << "Failed to open pack index";
+    }
+
+    void open()
+    {
+        try
+        {
+            boost::filesystem::create_directories(root);
+            std::string indexPath = root + "index";
+            bool rewrite = true;
+            if (boost::filesystem::exists(indexPath))
+            {
+                Buffer b = readLocalFileBuffer(indexPath);
+                const IndexHeader *h = (const IndexHeader*)b.data();
+                if (b.size() < sizeof(IndexHeader)
+                    || memcmp(h->magic, IndexMagic, sizeof(IndexMagic)) != 0
+                    || h->version != IndexVersion)
+                {
+                    LOG(warn2) << "Packed cache index is incompatible, "
+                        "the cache is purged";
+                    purgeDirectory(root);
+                    boost::filesystem::create_directories(root);
+                }
+                else if (!loadIndex(b))
+                {
+                    LOG(warn2) << "Packed cache index is damaged, "
+                        "recovered <" << index.size() << "> entries";
+                }
+                else
+                    rewrite = false;
+            }
+            if (rewrite)
+                rewriteIndex();
+            else
+            {
+                indexFile = fopen(indexPath.c_str(), "ab");
+                if (!indexFile)
+                    LOGTHROW(err2, std::runtime_error)
+                        << "Failed to open pack index";
+            }
+            uint32 last = 0;
+            for (const auto &it : index)
+            {
+                packs[it.second.pack].live += it.second.size;
+                liveSize += it.second.size;
+                last = std::max(last, it.second.pack);
+            }
+            for (auto &it : packs)
+            {
+                boost::system::error_code ec;
+                it.second.total = boost::filesystem::file_size(
+                    packPath(it.first), ec);
+            }
+            LOG(info2) << "Packed cache index contains <"
+                << index.size() << "> entries, <"
+                << (liveSize / 1024 / 1024) << "> MB";
+            startPack(last);
+        }
+        catch (const std::exception &e)
+        {
+            LOG(err3) << "Failed to initialize packed cache, error <"
+                << e.what() << ">";
+            close();
+        }
+    }
+
+    void openReadOnly()
+    {
+        try
+        {
+            Buffer b = readLocalFileBuffer(root + "index");
+            const IndexHeader *h = (const IndexHeader*)b.data();
+            if (b.size() < sizeof(IndexHeader)
+                || memcmp(h->magic, IndexMagic, sizeof(IndexMagic)) != 0
+                || h->version != IndexVersion)
+            {
+                LOG(warn3) << "Packed seed cache index <" << root
+                    << "> is incompatible, the seed is ignored";
+                return;
+            }
+            if (!loadIndex(b))
+            {
+                LOG(warn3) << "Packed seed cache index <" << root
+                    << "> is damaged, recovered <" << index.size()
+                    << "> entries";
+            }
+            LOG(info2) << "Packed seed cache index contains <"
+                << index.size() << "> entries";
+        }
+        catch (const std::exception &e)
+        {
+            LOG(err3) << "Failed to open packed seed cache, error <"
+                << e.what() << ">";
+            index.clear();
+        }
+    }
+
+    void close()
+    {
+        if (packFile)
+            fclose(packFile);
+        packFile = nullptr;
+        if (indexFile)
+            fclose(indexFile);
+        indexFile = nullptr;
+        maps.clear();
+        index.clear();
+        packs.clear();
+        relocating.clear();
+        liveSize = 0;
+        packSize = 0;
+        packIndex = 0;
+        indexRecords = 0;
+        compactedPack = -1;
+        generation++;
+    }
+
+    void startPack(uint32 pack)
+    {
+        if (packFile)
+            fclose(packFile);
+        packIndex = pack;
+        std::string path = packPath(pack);
+        packFile = fopen(path.c_str(), "ab");
+        if (!packFile)
+            LOGTHROW(err2, std::runtime_error)
+                << "Failed to open pack file <" << path << ">";
+        fseek(packFile, 0, SEEK_END);
+        packSize = ftell(packFile);
+        packs[pack].total = packSize;
+        if (packSize >= PackSizeLimit)
+            startPack(pack + 1);
+    }
+
+    std::shared_ptr<MappedPack> mapped(const Location &loc)
+    {
+        useTick++;
+        auto it = maps.find(loc.pack);
+        if (it != maps.end() && it->second->file.size()
+            < loc.offset + loc.size)
+        {
+            // the pack has grown since it was mapped
+            maps.erase(it);
+            it = maps.end();
+        }
+        if (it == maps.end())
+        {
+            if (maps.size() >= MaxMappedPacks)
+            {
+                auto oldest = maps.begin();
+                for (auto i = maps.begin(); i != maps.end(); i++)
+                    if (i->second->lastUse < oldest->second->lastUse)
+                        oldest = i;
+                maps.erase(oldest);
+            }
+            std::shared_ptr<MappedPack> m = std::make_shared<MappedPack>();
+            boost::iostreams::mapped_file_params params(packPath(loc.pack));
+            params.flags = boost::iostreams::mapped_file::priv;
+            m->file.open(params);
+            if (!m->file.is_open())
+                return nullptr;
+            it = maps.insert(std::make_pair(loc.pack, m)).first;
+        }
+        std::shared_ptr<MappedPack> m = it->second;
+        m->lastUse = useTick;
+        if (m->file.size() < loc.offset + loc.size)
+            return nullptr;
+        return m;
+    }
+
+    // visit all index entries, the lock is held for a chunk of entries only
+    // the index structure is modified on the calling thread only,
+    //   therefore the iterators remain valid between the chunks
+    // returns false if the cache was purged meanwhile
+    template<class F>
+    bool visitIndex(F f)
+    {
+        std::unique_lock<std::mutex> lock(mut);
+        const uint32 gen = generation;
+        uint32 cnt = 0;
+        for (const auto &it : index)
+        {
+            f(it.first, it.second);
+            if (++cnt % IndexChunkSize == 0)
+            {
+                lock.unlock();
+                std::this_thread::yield();
+                lock.lock();
+                if (gen != generation)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // remove expired and least recently used entries
+    void evict()
+    {
+        OPTICK_EVENT("evict");
+        uint64 target = maxSize * 9 / 10;
+        sint64 now = std::time(nullptr);
+        struct Candidate
+        {
+            const std::string *name;
+            uint64 order; // lower is evicted sooner
+            uint32 size;
+            bool operator < (const Candidate &other) const
+            {
+                return order < other.order;
+            }
+        };
+        // max-heap of the oldest entries
+        std::vector<Candidate> heap;
+        heap.reserve(MaxEvictedEntries + 1);
+        const uint32 gen = generation;
+        bool ok = visitIndex([&](const std::string &name, const Location &loc) {
+            Candidate c;
+            c.name = &name;
+            c.size = loc.size;
+            bool expired = loc.expires == -2
+                || (loc.expires > 0 && loc.expires < now);
+            c.order = expired ? 0 : loc.lastAccess;
+            if (heap.size() < MaxEvictedEntries || c < heap.front())
+            {
+                heap.push_back(c);
+                std::push_heap(heap.begin(), heap.end());
+                if (heap.size() > MaxEvictedEntries)
+                {
+                    std::pop_heap(heap.begin(), heap.end());
+                    heap.pop_back();
+                }
+            }
+        });
+        std::sort(heap.begin(), heap.end());
+        std::lock_guard<std::mutex> lock(mut);
+        if (!ok || gen != generation)
+            return;
+        uint32 cnt = 0;
+        for (const Candidate &c : heap)
+        {
+            if (liveSize <= target)
+                break;
+            const std::string name = *c.name; // remove invalidates the name
+            remove(name);
+            cnt++;
+        }
+        LOG(info2) << "Evicted <" << cnt << "> entries from packed cache, "
+            "remaining <" << (liveSize / 1024 / 1024) << "> MB";
+    }
+
+    // move remaining entries out of packs that are mostly unused
+    //   and delete the pack files
+    // urgent: the pack with most removed bytes is compacted
+    //   to get the files under the size limit
+    void compact(bool urgent)
+    {
+        if (compactedPack < 0)
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            uint64 best = 0;
+            for (const auto &it : packs)
+            {
+                if (it.first == packIndex || it.second.total == 0)
+                    continue;
+                const uint64 dead = it.second.total - it.second.live;
+                if (urgent ? dead > best
+                    : it.second.live < it.second.total / 2)
+                {
+                    compactedPack = it.first;
+                    best = dead;
+                    if (!urgent)
+                        break;
+                }
+            }
+        }
+        if (compactedPack < 0)
+            return;
+        OPTICK_EVENT("compact");
+        if (relocating.empty())
+        {
+            if (!visitIndex([&](const std::string &name,
+                const Location &loc) {
+                if (loc.pack == (uint32)compactedPack)
+                    relocating.push_back(name);
+            }))
+            {
+                relocating.clear();
+                return;
+            }
+            if (relocating.empty())
+            {
+                // all entries were relocated, delete the pack
+                std::lock_guard<std::mutex> lock(mut);
+                maps.erase(compactedPack);
+                packs.erase(compactedPack);
+                boost::system::error_code ec;
+                boost::filesystem::remove(packPath(compactedPack), ec);
+                LOG(info2) << "Removed compacted cache pack <"
+                    << compactedPack << ">";
+                compactedPack = -1;
+                return;
+            }
+        }
+        for (uint32 i = 0; i < MaxRelocatedEntries && !relocating.empty();
+            i++)
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            if (relocating.empty())
+                break; // purged meanwhile
+            const std::string name = relocating.back();
+            relocating.pop_back();
+            auto it = index.find(name);
+            if (it == index.end() || it->second.pack != (uint32)compactedPack)
+                continue; // the entry has changed meanwhile
+            Location loc = it->second;
+            std::shared_ptr<MappedPack> m = mapped(loc);
+            if (!m)
+            {
+                remove(name);
+                continue;
+            }
+            append(name, m->file.data() + loc.offset, loc.size, loc.expires);
+            flush();
+            index[name].lastAccess = loc.lastAccess;
+        }
+    }
+
+    const std::string root;
+    const uint64 maxSize;
+    const bool readOnly;
+    std::unordered_map<std::string, Location> index;
+    std::unordered_map<uint32, PackInfo> packs;
+    // mappings may outlive the cache while referenced by buffers
+    std::unordered_map<uint32, std::shared_ptr<MappedPack>> maps;
+    std::vector<std::string> relocating;
+    std::mutex mut;
+    FILE *packFile = nullptr;
+    FILE *indexFile = nullptr;
+    uint64 packSize = 0;
+    uint64 liveSize = 0;
+    uint64 accessTick = 0;
+    uint64 indexRecords = 0;
+    uint32 packIndex = 0;
+    uint32 useTick = 0;
+    uint32 generation = 0; // incremented on purge
+    sint32 compactedPack = -1;
+};
+
+} // namespace
+
+#endif // __EMSCRIPTEN__
+
+std::shared_ptr<Cache> createPackedCache(const MapCreateOptions &options)
+{
+#ifdef __EMSCRIPTEN__
+    LOGTHROW(err4, std::logic_error)
+        << "Disk Cache is not available in WASM";
+    throw;
+#else
+    return std::make_shared<CachePacked>(options);
+#endif
+}
+
+std::shared_ptr<Cache> createPackedSeedCache(const std::string &root)
+{
+#ifdef __EMSCRIPTEN__
+    LOGTHROW(err4, std::logic_error)
+        << "Disk Cache is not available in WASM";
+    throw;
+#else
+    return std::make_shared<CachePacked>(root);
+#endif
+}
+
+} // namespace vts
@@ -0,0 +1,264 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "../downloadControl.hpp"
+#include "../include/vts-browser/fetcher.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace vts
+{
+
+namespace
+{
+
+bool isCongestion(uint32 code)
+{
+    switch (code)
+    {
+    case 429: // too many requests
+    case 503: // service unavailable
+    case 504: // gateway timeout
+    case FetchTask::ExtraCodes::Timeout:
+        return true;
+    default:
+        // transport errors reported by the fetcher
+        return code < 100;
+    }
+}
+
+// the host itself is failing, as opposed to a missing resource
+bool isHostFailure(uint32 code)
+{
+    if (isCongestion(code))
+        return true;
+    return code >= 500 && code < 600;
+}
+
+} // namespace
+
+void DownloadControl::configure(uint32 initial, uint32 maximum)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    initial = std::max(initial, 1u);
+    if (initial == this->initial && maximum == this->maximum)
+        return;
+    this->initial = initial;
+    this->maximum = maximum;
+    for (auto &it : hosts)
+        it.second.window = this->initial;
+}
+
+void DownloadControl::configureBackoff(uint32 failures,
+    double initial, double maximum)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    backoffFailures = failures;
+    backoffInitial = std::max(initial, 0.0);
+    backoffMaximum = std::max(maximum, backoffInitial);
+}
+
+bool DownloadControl::blocked(const Host &h) const
+{
+    return backoffFailures && h.failures >= backoffFailures;
+}
+
+void DownloadControl::wakeHost(Host &h,
+    std::vector<std::weak_ptr<Resource>> &wake)
+{
+    uint32 limit = maximum ? (uint32)h.window : initial;
+    limit = std::max(limit, 1u);
+    if (blocked(h))
+        limit = 1; // single probe
+    uint32 free = limit > h.inFlight ? limit - h.inFlight : 0;
+    while (free > 0 && !h.postponed.empty())
+    {
+        std::weak_ptr<Resource> w = std::move(h.postponed.front());
+        h.postponed.pop_front();
+        if (w.expired())
+            continue;
+        wake.push_back(std::move(w));
+        free--;
+    }
+}
+
+DownloadControl::Host &DownloadControl::host(const std::string &name)
+{
+    auto it = hosts.find(name);
+    if (it != hosts.end())
+        return it->second;
+    Host &h = hosts[name];
+    h.window = initial;
+    return h;
+}
+
+bool DownloadControl::acquire(const std::string &name,
+    const std::weak_ptr<Resource> &r)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    Host &h = host(name);
+    if (blocked(h))
+    {
+        // park the resource until the backoff elapses
+        //   and then let a single probe through
+        if (h.probing || h.inFlight > 0
+            || std::chrono::steady_clock::now() < h.blockedUntil)
+        {
+            h.postponed.push_back(r);
+            return false;
+        }
+        h.probing = true;
+        h.inFlight++;
+        return true;
+    }
+    uint32 limit = maximum ? (uint32)h.window : initial;
+    if (h.inFlight < std::max(limit, 1u))
+    {
+        h.inFlight++;
+        return true;
+    }
+    h.postponed.push_back(r);
+    return false;
+}
+
+void DownloadControl::release(const std::string &name, double durationMs,
+    uint32 code, std::vector<std::weak_ptr<Resource>> &wake)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    Host &h = host(name);
+    assert(h.inFlight > 0);
+    h.inFlight--;
+
+    // health of the host
+    if (durationMs >= 0 && backoffFailures)
+    {
+        // the probe is the only download of a blocked host
+        //   unless the downloads started before the blocking
+        const bool probe = h.probing;
+        const bool wasBlocked = blocked(h);
+        h.probing = false;
+        if (isHostFailure(code))
+        {
+            h.failures++;
+            if (!wasBlocked || probe)
+            {
+                h.backoff = probe
+                    ? std::min(h.backoff * 2, backoffMaximum)
+                    : backoffInitial;
+                if (blocked(h))
+                    h.blockedUntil = std::chrono::steady_clock::now()
+                        + std::chrono::duration_cast<
+                        std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(h.backoff));
+            }
+        }
+        else
+        {
+            // the host has recovered
+            h.failures = 0;
+            h.backoff = 0;
+        }
+    }
+    else if (durationMs < 0)
+        h.probing = false; // cancelled probe
+
+    if (maximum && durationMs >= 0)
+    {
+        if (h.minRtt <= 0 || durationMs < h.minRtt)
+            h.minRtt = std::max(durationMs, 1.0);
+        h.smoothRtt = h.smoothRtt > 0
+            ? h.smoothRtt * 0.875 + durationMs * 0.125 : durationMs;
+        h.sinceDecrease += durationMs / std::max(h.window, 1.0);
+        bool congested = isCongestion(code)
+            || h.smoothRtt > 3 * h.minRtt + 100;
+        if (congested)
+        {
+            // decrease at most once per round trip
+            if (h.sinceDecrease > h.smoothRtt)
+            {
+                h.window = std::max(h.window * 0.5, 1.0);
+                h.sinceDecrease = 0;
+            }
+        }
+        else
+        {
+            // one additional download per window of successful replies
+            h.window = std::min(h.window + 1 / std::max(h.window, 1.0),
+                (double)maximum);
+        }
+    }
+
+    // the blocked hosts are woken by update
+    if (!blocked(h))
+        wakeHost(h, wake);
+}
+
+void DownloadControl::update(std::vector<std::weak_ptr<Resource>> &wake)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    if (!backoffFailures)
+        return;
+    const auto now = std::chrono::steady_clock::now();
+    for (auto &it : hosts)
+    {
+        Host &h = it.second;
+        if (blocked(h) && !h.probing && h.inFlight == 0
+            && now >= h.blockedUntil)
+            wakeHost(h, wake);
+    }
+}
+
+uint32 DownloadControl::totalWindow()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    double sum = 0;
+    for (const auto &it : hosts)
+        sum += maximum ? it.second.window : initial;
+    return (uint32)sum;
+}
+
+uint32 DownloadControl::blockedHosts()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    uint32 cnt = 0;
+    for (const auto &it : hosts)
+        cnt += blocked(it.second);
+    return cnt;
+}
+
+std::string DownloadControl::hostOf(const std::string &url)
+{
+    auto s = url.find("://");
+    if (s == std::string::npos)
+        return "";
+    s += 3;
+    auto e = url.find_first_of("/?#", s);
+    return url.substr(s, e == std::string::npos ? e : e - s);
+}
+
+} // namespace vts
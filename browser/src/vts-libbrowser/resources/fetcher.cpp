@@ -43,6 +43,12 @@ void Fetcher::finalize()
 void Fetcher::update()
 {}
 
+void Fetcher::cancel(const std::shared_ptr<FetchTask> &)
+{}
+
+void Fetcher::updatePriority(const std::shared_ptr<FetchTask> &, float)
+{}
+
 FetchTask::Query::Query(const std::string &url,
                         FetchTask::ResourceType resourceType) :
     url(url), resourceType(resourceType)
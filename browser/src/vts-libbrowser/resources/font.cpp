@@ -27,6 +27,7 @@
 #include "../gpuResource.hpp"
 #include "../fetchTask.hpp"
 #include "../map.hpp"
+#include "../utilities/logFilter.hpp"
 
 #include <dbglog/dbglog.hpp>
 #include <sstream>
@@ -84,7 +85,7 @@ GpuFont::GpuFont(MapImpl *map, const std::string &name) :
 
 void GpuFont::decode()
 {
-    LOG(info2) << "Decoding font <" << name << ">";
+    VTS_LOG(info2) << "Decoding font <" << name << ">";
 
 #ifndef __EMSCRIPTEN__
     if (map->options.debugExtractRawResources)
@@ -106,9 +107,15 @@ void GpuFont::decode()
     decodeData = std::static_pointer_cast<void>(spec);
 }
 
+uint32 GpuFont::decodedMemoryCost() const
+{
+    auto spec = std::static_pointer_cast<const GpuFontSpec>(decodeData);
+    return spec ? sizeof(*spec) + spec->data.size() : 0;
+}
+
 void GpuFont::upload()
 {
-    LOG(info2) << "Uploading font <" << name << ">";
+    VTS_LOG(info2) << "Uploading font <" << name << ">";
     auto spec = std::static_pointer_cast<GpuFontSpec>(decodeData);
     map->callbacks.loadFont(info, *spec, name);
 }
@@ -0,0 +1,394 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "../include/vts-browser/exceptions.hpp"
+#include "../utilities/jsonReader.hpp"
+#include "../geodata.hpp"
+#include "../resources.hpp"
+#include "../map.hpp"
+
+#include <vts-libs/vts/tileop.hpp>
+#include <dbglog/dbglog.hpp>
+
+#include <optick.h>
+#include <algorithm>
+
+namespace vts
+{
+
+namespace
+{
+
+// the tree does not go deeper even if the leafs are too large
+const uint32 MaxPartitionLod = 16;
+
+const char *featureTypes[3] = { "points", "lines", "polygons" };
+
+struct PartitionGroup
+{
+    std::string header; // members of the group other than the features
+    vec3 origin;
+    vec3 scale;
+};
+
+struct PartitionFeature
+{
+    JsonSpan span;
+    vec3 aabb[2];
+    vec3 center;
+    uint32 group = 0;
+    uint32 type = 0;
+};
+
+class Partitioner
+{
+public:
+    // data is the json text of the source
+    Partitioner(const std::shared_ptr<const std::string> &source,
+        const std::string &data, uint32 limit,
+        std::map<TileId, GeodataPartition::Node> &nodes)
+        : source(source), data(data), limit(limit), nodes(nodes)
+    {}
+
+    void run()
+    {
+        read();
+        std::vector<uint32> all;
+        all.reserve(features.size());
+        for (uint32 i = 0, e = features.size(); i < e; i++)
+            all.push_back(i);
+        build(TileId(), all);
+    }
+
+    uint64 memory = 0;
+
+private:
+    void read()
+    {
+        JsonReader reader(data);
+        if (!reader.beginObject())
+            LOGTHROW(err2, std::runtime_error)
+                << "Geodata features must be an object";
+        std::string key;
+        while (reader.nextMember(key))
+        {
+            if (key == "version")
+                version = span(reader.skipValue());
+            else if (key == "groups" && reader.beginArray())
+            {
+                while (reader.nextElement())
+                    readGroup(reader);
+            }
+            else
+                reader.skipValue();
+        }
+    }
+
+    void readGroup(JsonReader &reader)
+    {
+        if (!reader.beginObject())
+            LOGTHROW(err2, std::runtime_error)
+                << "Geodata group must be an object";
+        const uint32 groupIndex = groups.size();
+        const uint32 firstFeature = features.size();
+        PartitionGroup g;
+        JsonSpan bbox, resolution;
+        std::string key;
+        while (reader.nextMember(key))
+        {
+            uint32 type = 0;
+            while (type < 3 && key != featureTypes[type])
+                type++;
+            if (type < 3 && reader.beginArray())
+            {
+                while (reader.nextElement())
+                {
+                    PartitionFeature f;
+                    f.span = reader.skipValue();
+                    f.group = groupIndex;
+                    f.type = type;
+                    features.push_back(f);
+                }
+                continue;
+            }
+            JsonSpan s = reader.skipValue();
+            if (key == "bbox")
+                bbox = s;
+            else if (key == "resolution")
+                resolution = s;
+            if (!g.header.empty())
+                g.header += ",";
+            g.header += Json::valueToQuotedString(key.c_str());
+            g.header += ":";
+            g.header += span(s);
+        }
+        if (!bbox.begin || !resolution.begin)
+            LOGTHROW(err2, std::runtime_error)
+                << "Geodata group is missing bbox or resolution";
+
+        // coordinates are quantized in the bbox of the group
+        const Json::Value b = reader.parse(bbox);
+        const double res = reader.parse(resolution).asDouble();
+        for (uint32 i = 0; i < 3; i++)
+        {
+            g.origin[i] = b[0][i].asDouble();
+            g.scale[i] = (b[1][i].asDouble() - g.origin[i]) / res;
+        }
+        for (uint32 i = firstFeature, e = features.size(); i < e; i++)
+            extents(reader, g, features[i]);
+        groups.push_back(std::move(g));
+    }
+
+    void extents(JsonReader &reader, const PartitionGroup &g,
+        PartitionFeature &f)
+    {
+        f.aabb[0] = inf3();
+        f.aabb[1] = -inf3();
+        const auto &add = [&](const Json::Value &x, const Json::Value &y,
+            const Json::Value &z) {
+            vec3 p = vec3(x.asDouble(), y.asDouble(), z.asDouble());
+            p = g.origin + p.cwiseProduct(g.scale);
+            f.aabb[0] = min(f.aabb[0], p);
+            f.aabb[1] = max(f.aabb[1], p);
+        };
+        const Json::Value v = reader.parse(f.span);
+        switch (f.type)
+        {
+        case 0: // points
+            for (const Json::Value &p : v["points"])
+                add(p[0], p[1], p[2]);
+            break;
+        case 1: // lines
+            for (const Json::Value &l : v["lines"])
+                for (const Json::Value &p : l)
+                    add(p[0], p[1], p[2]);
+            break;
+        case 2: // polygons
+        {
+            const Json::Value &a = v["vertices"];
+            for (uint32 i = 0, e = a.size(); i + 2 < e; i += 3)
+                add(a[i], a[i + 1], a[i + 2]);
+        } break;
+        }
+        if (f.aabb[0][0] > f.aabb[1][0])
+        {
+            // no coordinates, the feature is placed at the group origin
+            f.aabb[0] = f.aabb[1] = g.origin;
+        }
+        f.center = (f.aabb[0] + f.aabb[1]) * 0.5;
+    }
+
+    void build(const TileId &id, std::vector<uint32> &indices)
+    {
+        GeodataPartition::Node &node = nodes[id];
+        node.aabbPhys[0] = inf3();
+        node.aabbPhys[1] = -inf3();
+        memory += sizeof(node) + sizeof(id);
+
+        // extents of feature centers
+        vec3 cs[2] = { inf3(), -inf3() };
+        for (uint32 i : indices)
+        {
+            cs[0] = min(cs[0], features[i].center);
+            cs[1] = max(cs[1], features[i].center);
+        }
+        const vec3 cd = cs[1] - cs[0];
+
+        // split along the two longest axes
+        uint32 axes[3] = { 0, 1, 2 };
+        std::sort(axes, axes + 3, [&](uint32 a, uint32 b) {
+            return cd[a] > cd[b];
+        });
+        if (limit == 0 || indices.size() <= limit || id.lod >= MaxPartitionLod
+            || !(cd[axes[0]] > 0))
+        {
+            if (id.lod == 0)
+                node.features = source; // no partitioning needed
+            else
+                leaf(node, indices);
+            return;
+        }
+
+        const vec3 mid = (cs[0] + cs[1]) * 0.5;
+        std::vector<uint32> parts[4];
+        for (uint32 i : indices)
+        {
+            const vec3 &c = features[i].center;
+            uint32 q = (c[axes[0]] > mid[axes[0]] ? 1 : 0)
+                + (c[axes[1]] > mid[axes[1]] ? 2 : 0);
+            parts[q].push_back(i);
+        }
+        indices.clear();
+        indices.shrink_to_fit();
+
+        const vtslibs::vts::Children childs = vtslibs::vts::children(id);
+        for (uint32 i = 0; i < 4; i++)
+        {
+            if (parts[i].empty())
+                continue;
+            build(childs[i], parts[i]);
+            const GeodataPartition::Node &c = nodes[childs[i]];
+            node.childs[i] = true;
+            node.aabbPhys[0] = min(node.aabbPhys[0], c.aabbPhys[0]);
+            node.aabbPhys[1] = max(node.aabbPhys[1], c.aabbPhys[1]);
+        }
+    }
+
+    void leaf(GeodataPartition::Node &node, const std::vector<uint32> &indices)
+    {
+        for (uint32 i : indices)
+        {
+            node.aabbPhys[0] = min(node.aabbPhys[0], features[i].aabb[0]);
+            node.aabbPhys[1] = max(node.aabbPhys[1], features[i].aabb[1]);
+        }
+
+        // enlarge the box slightly, the features must not be culled
+        //   by the tile on rounding errors
+        const vec3 pad = (node.aabbPhys[1] - node.aabbPhys[0]) * 1e-3
+            + vec3(1e-2, 1e-2, 1e-2);
+        node.aabbPhys[0] -= pad;
+        node.aabbPhys[1] += pad;
+
+        // compose the features of the tile from the original text
+        //   the order of groups and features is preserved
+        std::string out = "{";
+        if (!version.empty())
+            out += "\"version\":" + version + ",";
+        out += "\"groups\":[";
+        uint32 i = 0, e = indices.size();
+        bool firstGroup = true;
+        while (i < e)
+        {
+            const uint32 group = features[indices[i]].group;
+            if (!firstGroup)
+                out += ",";
+            firstGroup = false;
+            out += "{" + groups[group].header;
+            for (uint32 type = 0; type < 3; type++)
+            {
+                bool first = true;
+                for (uint32 j = i; j < e
+                    && features[indices[j]].group == group; j++)
+                {
+                    const PartitionFeature &f = features[indices[j]];
+                    if (f.type != type)
+                        continue;
+                    out += first ? std::string(",\"") + featureTypes[type]
+                        + "\":[" : std::string(",");
+                    out.append(f.span.begin, f.span.end);
+                    first = false;
+                }
+                if (!first)
+                    out += "]";
+            }
+            out += "}";
+            while (i < e && features[indices[i]].group == group)
+                i++;
+        }
+        out += "]}";
+        memory += out.size();
+        node.features = std::make_shared<const std::string>(std::move(out));
+    }
+
+    static std::string span(const JsonSpan &s)
+    {
+        return std::string(s.begin, s.end);
+    }
+
+    const std::shared_ptr<const std::string> source;
+    const std::string &data;
+    const uint32 limit;
+    std::map<TileId, GeodataPartition::Node> &nodes;
+    std::vector<PartitionGroup> groups;
+    std::vector<PartitionFeature> features;
+    std::string version;
+};
+
+} // namespace
+
+GeodataPartition::GeodataPartition(MapImpl *map, const std::string &name)
+    : Resource(map, name)
+{
+    state = Resource::State::ready;
+}
+
+void GeodataPartition::decode()
+{
+    LOG(info2) << "Partitioning geodata <" << name << ">";
+    OPTICK_EVENT("partition geodata");
+
+    // this resource is not meant to be downloaded
+    assert(!fetch);
+
+    nodes.clear();
+    // the binary features are partitioned as json,
+    //   the root keeps the original data if it is not split
+    const std::string text = isGeodataBinary(*features)
+        ? geodataBinaryToJson(*features) : std::string();
+    Partitioner p(features, text.empty() ? *features : text,
+        map->createOptions.geodataVirtualTileFeatures, nodes);
+    p.run();
+    info.ramMemoryCost = sizeof(*this) + p.memory;
+}
+
+FetchTask::ResourceType GeodataPartition::resourceType() const
+{
+    return FetchTask::ResourceType::Undefined;
+}
+
+void GeodataPartition::update(const std::shared_ptr<const std::string> &f)
+{
+    switch ((Resource::State)state)
+    {
+    case Resource::State::initializing:
+        state = Resource::State::errorFatal; // if left in initializing, it would attempt to download it
+        UTILITY_FALLTHROUGH;
+    case Resource::State::errorFatal: // allow reloading when sources change, even if it failed before
+    case Resource::State::ready:
+        if (features != f)
+        {
+            features = f;
+            state = Resource::State::decodeQueue;
+            map->resources->queDecode.push(shared_from_this());
+        }
+        break;
+    default:
+        // nothing
+        break;
+    }
+}
+
+const GeodataPartition::Node *GeodataPartition::find(
+    const TileId &tileId) const
+{
+    auto it = nodes.find(tileId);
+    if (it == nodes.end())
+        return nullptr;
+    return &it->second;
+}
+
+} // namespace vts
@@ -28,6 +28,7 @@
 #include "../include/vts-browser/exceptions.hpp"
 
 #include "../utilities/json.hpp"
+#include "../utilities/jsonReader.hpp"
 #include "../utilities/case.hpp"
 #include "../gpuResource.hpp"
 #include "../geodata.hpp"
@@ -35,20 +36,40 @@
 #include "../mapConfig.hpp"
 #include "../resources.hpp"
 #include "../map.hpp"
+#include "../utilities/logFilter.hpp"
 
 #include <optick.h>
 #include <utf8.h>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
 
 namespace vts
 {
 
 using Json::Value;
 
+struct GeodataParsedFeatures
+{
+    struct Group
+    {
+        Value properties; // all members except the features
+        std::vector<Value> features[3]; // points, lines, polygons
+        uint64 bytes = 0; // size of the group in the json text
+    };
+
+    std::vector<Group> groups;
+    Value version;
+};
+
 namespace
 {
 
 typedef std::map<std::string, const Value> AmpVariables;
+typedef std::unordered_map<std::string, const Value> TileConstants;
+typedef std::unordered_map<std::string, const Value> EmbeddedExpressions;
 typedef std::basic_string<uint32> S32;
 
 S32 s8to32(const std::string &s8)
@@ -104,8 +125,57 @@ struct GpuGeodataSpecComparator
     }
 };
 
+typedef std::set<GpuGeodataSpec, GpuGeodataSpecComparator> GeodataSpecs;
+
+// adds items of the spec into matching spec in the set
+void mergeSpec(GeodataSpecs &specs, GpuGeodataSpec &&spec)
+{
+    auto it = specs.find(spec);
+    if (it == specs.end())
+    {
+        specs.insert(std::move(spec));
+        return;
+    }
+    GpuGeodataSpec &dst = const_cast<GpuGeodataSpec&>(*it);
+    const auto &append = [](auto &a, auto &b) {
+        a.insert(a.end(), std::make_move_iterator(b.begin()),
+            std::make_move_iterator(b.end()));
+    };
+    append(dst.positions, spec.positions);
+    append(dst.iconCoords, spec.iconCoords);
+    append(dst.texts, spec.texts);
+    append(dst.hysteresisIds, spec.hysteresisIds);
+    append(dst.importances, spec.importances);
+}
+
+uint64 specMemory(const GpuGeodataSpec &spec)
+{
+    uint64 m = sizeof(spec)
+        + spec.iconCoords.size() * sizeof(spec.iconCoords[0])
+        + spec.importances.size() * sizeof(spec.importances[0]);
+    for (const auto &p : spec.positions)
+        m += sizeof(p) + p.size() * sizeof(p[0]);
+    for (const std::string &t : spec.texts)
+        m += sizeof(t) + t.size();
+    m += spec.hysteresisIds.size() * sizeof(spec.hysteresisIds[0]);
+    return m;
+}
+
 #define THROW LOGTHROW(err3, GeodataValidationException)
 
+// fnv-1a, stable between tiles and processing threads
+//   zero is reserved for no id
+uint64 hysteresisIdHash(const std::string &s)
+{
+    uint64 h = 14695981039346656037ull;
+    for (char c : s)
+    {
+        h ^= (unsigned char)c;
+        h *= 1099511628211ull;
+    }
+    return h ? h : 1;
+}
+
 bool hasLatin(const std::string &s)
 {
     auto it = s.begin();
@@ -231,6 +301,95 @@ bool isLayerStyleRequested(const Value &v)
     return true;
 }
 
+enum class Function
+{
+    Unknown,
+    Sgn, Sin, Cos, Tan, Asin, Acos, Atan, Sqrt, Abs, Deg2rad, Rad2deg, Log,
+    Round, Add, Sub, Mul, Div, Pow, Atan2, Mod, Random, Clamp, Min, Max, If,
+    Strlen, Str2num, Lowercase, Uppercase, Capitalize, Trim, Find, Replace,
+    Substr, HasLatin, IsCjk, Map, Discrete, Discrete2, Linear, Linear2,
+    LodScaled, LogScale,
+};
+
+// function names are looked up once per evaluation
+//   instead of comparing the name with each function in turn
+const std::unordered_map<std::string, Function> &functionNames()
+{
+    static const std::unordered_map<std::string, Function> names = {
+        { "sgn", Function::Sgn },
+        { "sin", Function::Sin },
+        { "cos", Function::Cos },
+        { "tan", Function::Tan },
+        { "asin", Function::Asin },
+        { "acos", Function::Acos },
+        { "atan", Function::Atan },
+        { "sqrt", Function::Sqrt },
+        { "abs", Function::Abs },
+        { "deg2rad", Function::Deg2rad },
+        { "rad2deg", Function::Rad2deg },
+        { "log", Function::Log },
+        { "round", Function::Round },
+        { "add", Function::Add },
+        { "sub", Function::Sub },
+        { "mul", Function::Mul },
+        { "div", Function::Div },
+        { "pow", Function::Pow },
+        { "atan2", Function::Atan2 },
+        { "mod", Function::Mod },
+        { "random", Function::Random },
+        { "clamp", Function::Clamp },
+        { "min", Function::Min },
+        { "max", Function::Max },
+        { "if", Function::If },
+        { "strlen", Function::Strlen },
+        { "str2num", Function::Str2num },
+        { "lowercase", Function::Lowercase },
+        { "uppercase", Function::Uppercase },
+        { "capitalize", Function::Capitalize },
+        { "trim", Function::Trim },
+        { "find", Function::Find },
+        { "replace", Function::Replace },
+        { "substr", Function::Substr },
+        { "has-latin", Function::HasLatin },
+        { "is-cjk", Function::IsCjk },
+        { "map", Function::Map },
+        { "discrete", Function::Discrete },
+        { "discrete2", Function::Discrete2 },
+        { "linear", Function::Linear },
+        { "linear2", Function::Linear2 },
+        { "lod-scaled", Function::LodScaled },
+        { "logScale", Function::LogScale },
+        { "log-scale", Function::LogScale }
+    };
+    return names;
+}
+
+enum class Filter
+{
+    Unknown,
+    Skip, Equal, NotEqual, GreaterEqual, LessEqual, Greater, Less,
+    Has, In, All, Any, None,
+};
+
+const std::unordered_map<std::string, Filter> &filterNames()
+{
+    static const std::unordered_map<std::string, Filter> names = {
+        { "skip", Filter::Skip },
+        { "==", Filter::Equal },
+        { "!=", Filter::NotEqual },
+        { ">=", Filter::GreaterEqual },
+        { "<=", Filter::LessEqual },
+        { ">", Filter::Greater },
+        { "<", Filter::Less },
+        { "has", Filter::Has },
+        { "in", Filter::In },
+        { "all", Filter::All },
+        { "any", Filter::Any },
+        { "none", Filter::None }
+    };
+    return names;
+}
+
 template<class V>
 static void erase_if(V &v, const std::vector<bool> &pred)
 {
@@ -377,7 +536,7 @@ struct geoContext
 
     static bool getCompatibilityMode(const GeodataTile *data)
     {
-        const Value &style = *data->style->json;
+        const Value &style = *data->style->compiled->json;
         if (style.isMember("compatibility-mode"))
             return style["compatibility-mode"].asBool();
         // todo
@@ -396,68 +555,41 @@ struct geoContext
         return true;
     }
 
-    geoContext(GeodataTile *data)
+    geoContext(GeodataTile *data, const std::set<std::string> &reusedLayers)
         : data(data),
         stylesheet(data->style.get()),
-        style(*data->style->json),
-        features(stringToJson(*data->features)),
+        compiled(data->style->compiled),
+        style(*compiled->json),
+        features(*data->features),
         browserOptions(*data->browserOptions),
         aabbPhys{ data->aabbPhys[0], data->aabbPhys[1] },
         tileId(data->tileId),
         compatibility(getCompatibilityMode(data)),
+        simplifyTolerance(std::isfinite(data->texelSize)
+            ? data->texelSize * data->map->options.geodataSimplification : 0),
+        reusedLayers(reusedLayers),
         currentLayer(nullptr)
-    {}
-
-    // defines which style layers are candidates for a specific feature type
-    std::vector<std::string> filterLayersByType(Type t) const
     {
-        std::vector<std::string> result;
-        const auto allLayerNames = style["layers"].getMemberNames();
-        for (const std::string &layerName : allLayerNames)
+        // the results of each style layer are kept separately
+        for (uint32 t = 0; t < 3; t++)
         {
-            Value layer = style["layers"][layerName];
-            if (layer.isMember("filter") && layer["filter"].isArray()
-                && layer["filter"][0] == "skip")
-                continue;
-            if (layer.isMember("visibility-switch"))
+            for (const std::string &n : compiled->typedLayerNames[t])
             {
-                result.push_back(layerName);
-                continue;
+                if (reusedLayers.count(n) == 0)
+                    processedLayers[t].emplace_back(n, &layersData[n]);
             }
-            bool point = isLayerStyleRequested(layer["point"]);
-            bool line = isLayerStyleRequested(layer["line"]);
-            bool icon = isLayerStyleRequested(layer["icon"]);
-            bool labelScreen = isLayerStyleRequested(layer["label"]);
-            bool labelFlat = isLayerStyleRequested(layer["line-label"]);
-            bool polygon = isLayerStyleRequested(layer["polygon"]);
-            bool ok = false;
-            switch (t)
-            {
-            case Type::Point:
-                ok = point || icon || labelScreen;
-                break;
-            case Type::Line:
-                ok = line || labelFlat; // todo enable degrading line features to point layers
-                break;
-            case Type::Polygon:
-                ok = polygon; // todo enable degrading polygon features to all layer types
-                break;
-            }
-            if (ok)
-                result.push_back(layerName);
         }
-        return result;
     }
 
-    // entry point
-    //   processes all features with all style layers
-    void process()
+    // in validation mode, all errors are reported as validation errors
+    template<class F>
+    static void validate(const F &f)
     {
         if (Validating)
         {
             try
             {
-                return processInternal();
+                return f();
             }
             catch (const GeodataValidationException &)
             {
@@ -476,74 +608,246 @@ struct geoContext
                 THROW << "General error <" << e.what() << ">";
             }
         }
-        return processInternal();
+        return f();
+    }
+
+    // locates all groups of features in the tile
+    //   the groups are independent and may be processed separately
+    static std::vector<JsonSpan> scanGroups(const GeodataTile *data)
+    {
+        std::vector<JsonSpan> groups;
+        validate([&]() {
+            scanGroupsInternal(data, groups);
+        });
+        return groups;
+    }
+
+    static void scanGroupsInternal(const GeodataTile *data,
+        std::vector<JsonSpan> &groups)
+    {
+        JsonReader reader(*data->features);
+        if (!reader.beginObject())
+            THROW << "Geodata features must be an object";
+        Value version;
+        std::string key;
+        while (reader.nextMember(key))
+        {
+            if (key == "version")
+                version = reader.parseValue();
+            else if (key == "groups" && reader.beginArray())
+            {
+                while (reader.nextElement())
+                    groups.push_back(reader.skipValue());
+            }
+            else
+                reader.skipValue();
+        }
+        checkVersion(data, version);
+    }
+
+    // entry point
+    //   processes the features of the groups with all style layers
+    void process(const JsonSpan *groups, uint32 count)
+    {
+        validate([&]() {
+            processInternal(groups, count);
+        });
+    }
+
+    // entry point for features parsed in advance
+    void process(const GeodataParsedFeatures::Group *groups, uint32 count)
+    {
+        validate([&]() {
+            for (uint32 i = 0; i < count; i++)
+                processGroup(groups[i]);
+#ifndef NDEBUG
+            finalAsserts();
+#endif // !NDEBUG
+        });
+    }
+
+    void processInternal(const JsonSpan *groups, uint32 count)
+    {
+        // the features are read incrementally
+        //   only one feature is parsed into json value at a time
+        JsonReader reader(features);
+        for (uint32 i = 0; i < count; i++)
+        {
+            reader.seek(groups[i]);
+            processGroup(reader);
+        }
+
+#ifndef NDEBUG
+        finalAsserts();
+#endif // !NDEBUG
+    }
+
+    // appends results of a context that processed subsequent groups
+    void merge(geoContext &other)
+    {
+        for (auto &l : other.layersData)
+        {
+            GeodataSpecs &dst = layersData[l.first];
+            for (const GpuGeodataSpec &s : l.second)
+                mergeSpec(dst, std::move(const_cast<GpuGeodataSpec&>(s)));
+            l.second.clear();
+        }
+    }
+
+    // combine results of all layers, including the reused ones,
+    //   and put them into queue for upload
+    void finish()
+    {
+        const bool caching = data->map->options.cacheGeodataLayers;
+        std::map<std::string, GeodataTile::LayerCache> cache;
+        uint64 memory = 0;
+        GeodataSpecs all;
+        for (const auto &it : compiled->layerSignatures)
+        {
+            GeodataTile::LayerCache c;
+            c.signature = it.second;
+            if (reusedLayers.count(it.first))
+                c.specs = std::move(data->layersCache[it.first].specs);
+            else
+            {
+                auto l = layersData.find(it.first);
+                if (l != layersData.end())
+                {
+                    for (const GpuGeodataSpec &s : l->second)
+                        c.specs.push_back(
+                            std::move(const_cast<GpuGeodataSpec&>(s)));
+                }
+            }
+            if (caching)
+            {
+                for (const GpuGeodataSpec &s : c.specs)
+                {
+                    memory += specMemory(s);
+                    mergeSpec(all, GpuGeodataSpec(s));
+                }
+                cache[it.first] = std::move(c);
+            }
+            else
+            {
+                for (GpuGeodataSpec &s : c.specs)
+                    mergeSpec(all, std::move(s));
+            }
+        }
+        data->layersCache.swap(cache);
+        data->layersCacheMemory = memory;
+
+        data->specsToUpload.clear();
+        data->specsToUpload.reserve(all.size());
+        for (const GpuGeodataSpec &spec : all)
+            data->specsToUpload.push_back(
+                std::move(const_cast<GpuGeodataSpec&>(spec)));
     }
 
-    void processInternal()
+    static void checkVersion(const GeodataTile *data, const Value &version)
     {
         if (Validating)
         {
-            // check version
-            if (features["version"].asInt() != 1)
+            if (version.asInt() != 1)
             {
                 THROW << "Invalid geodata features <"
                     << data->name << "> version <"
-                    << features["version"].asInt() << ">";
+                    << version.asInt() << ">";
             }
         }
+    }
 
-        solveInheritance();
-
+    void processGroup(JsonReader &reader)
+    {
         static const std::vector<std::pair<Type, std::string>> allTypes
             = { { Type::Point, "points" },
                 { Type::Line, "lines" },
                 { Type::Polygon, "polygons"}
         };
 
-        // style layers filtered by valid feature types
-        std::map<Type, std::vector<std::string>> typedLayerNames;
-        for (Type t : { Type::Point, Type::Line, Type::Polygon })
-            typedLayerNames[t] = filterLayersByType(t);
+        if (!reader.beginObject())
+            return;
 
-        // groups
-        for (const Value &group : features["groups"])
-        {
-            this->group.emplace(group);
-            // types
-            for (const auto &type : allTypes)
+        // the group properties may follow the features
+        //   therefore the features are only located here
+        //   and parsed after the whole group is read
+        Value group;
+        std::vector<JsonSpan> spans[3];
+        std::string key;
+        while (reader.nextMember(key))
+        {
+            auto it = std::find_if(allTypes.begin(), allTypes.end(),
+                [&](const std::pair<Type, std::string> &t) {
+                    return t.second == key;
+                });
+            if (it == allTypes.end())
             {
-                this->type.emplace(type.first);
-                const auto &layers = typedLayerNames[type.first];
-                if (layers.empty())
-                    continue;
-                // features
-                for (const Value &feature : group[type.second])
-                {
-                    this->feature.emplace(feature);
-                    // layers
-                    for (const std::string &layerName : layers)
-                        processFeatureName(layerName);
-                }
-                this->feature.reset();
+                group[key] = reader.parseValue();
+                continue;
+            }
+            auto &s = spans[it - allTypes.begin()];
+            if (processedLayers[(int)it->first].empty()
+                || !reader.beginArray())
+            {
+                reader.skipValue();
+                continue;
             }
-            this->type.reset();
+            while (reader.nextElement())
+                s.push_back(reader.skipValue());
+        }
+
+        this->group.emplace(group);
+        // types
+        for (uint32 ti = 0; ti < allTypes.size(); ti++)
+        {
+            const auto &type = allTypes[ti];
+            this->type.emplace(type.first);
+            const auto &layers = processedLayers[(int)type.first];
+            if (layers.empty())
+                continue;
+            // features
+            for (const JsonSpan &span : spans[ti])
+                processFeature(layers, reader.parse(span));
         }
+        this->type.reset();
         this->group.reset();
+    }
 
-#ifndef NDEBUG
-        finalAsserts();
-#endif // !NDEBUG
+    void processGroup(const GeodataParsedFeatures::Group &group)
+    {
+        this->group.emplace(group.properties);
+        // types
+        for (uint32 ti = 0; ti < 3; ti++)
+        {
+            this->type.emplace((Type)ti);
+            const auto &layers = processedLayers[ti];
+            if (layers.empty())
+                continue;
+            // features
+            for (const Value &feature : group.features[ti])
+                processFeature(layers, feature);
+        }
+        this->type.reset();
+        this->group.reset();
+    }
 
-        // put cache into queue for upload
-        data->specsToUpload.clear();
-        for (const GpuGeodataSpec &spec : cacheData)
-            data->specsToUpload.push_back(
-                std::move(const_cast<GpuGeodataSpec&>(spec)));
+    template<class Layers>
+    void processFeature(const Layers &layers, const Value &feature)
+    {
+        data->map->resources->decodeYield();
+        this->feature.emplace(feature);
+        // layers
+        for (const auto &layer : layers)
+        {
+            cacheData = layer.second;
+            processFeatureName(layer.first);
+        }
+        this->feature.reset();
     }
 
     void finalAsserts()
     {
-        for (const GpuGeodataSpec &spec : cacheData)
+        for (const auto &l : layersData)
+        for (const GpuGeodataSpec &spec : l.second)
         {
             // validate that all vectors are of same length
             {
@@ -589,31 +893,6 @@ struct geoContext
         }
     }
 
-    Value resolveInheritance(const Value &orig) const
-    {
-        if (!orig["inherit"])
-            return orig;
-
-        Value base = resolveInheritance(
-            style["layers"][orig["inherit"].asString()]);
-
-        for (auto n : orig.getMemberNames())
-            base[n] = orig[n];
-
-        base.removeMember("inherit");
-
-        return base;
-    }
-
-    // update style layers with inherit property
-    void solveInheritance()
-    {
-        Value ls;
-        for (const std::string &n : style["layers"].getMemberNames())
-            ls[n] = resolveInheritance(style["layers"][n]);
-        style["layers"].swap(ls);
-    }
-
     // solves @constants, $properties, &variables and #identifiers
     Value replacement(const std::string &name) const
     {
@@ -642,7 +921,15 @@ struct geoContext
         switch (name[0])
         {
         case '@': // constant
-            return evaluate(style["constants"][name]);
+        {
+            if (compiled->tileConstants.count(name) == 0)
+                return evaluate(style["constants"][name]);
+            auto it = tileConstants.find(name);
+            if (it != tileConstants.end())
+                return it->second;
+            return const_cast<TileConstants&>(tileConstants).emplace(
+                    name, evaluate(style["constants"][name])).first->second;
+        }
         case '$': // property
             return (*feature)["properties"][name.substr(1)];
         case '&': // ampersand variable
@@ -884,98 +1171,105 @@ struct geoContext
             if (expression.size() != 1)
                 THROW << "Function must have exactly one member";
         }
-        const std::string fnc = expression.getMemberNames()[0];
+        if (expression.empty())
+            return expression;
+        const auto member = expression.begin();
+        const std::string fnc = member.name();
+        const Value &arg = *member;
+        const auto fit = functionNames().find(fnc);
 
+        switch (fit == functionNames().end() ? Function::Unknown : fit->second)
+        {
         // 'sgn', 'sin', 'cos', 'tan', 'asin', 'acos', 'atan',
         // 'sqrt', 'abs', 'deg2rad', 'rad2deg', 'log'
-        if (fnc == "sgn")
+        case Function::Sgn:
         {
-            double v = convertToDouble(expression[fnc]);
+            double v = convertToDouble(arg);
             if (v < 0) return -1;
             if (v > 0) return 1;
             return 0;
         }
-        if (fnc == "sin")
-            return std::sin(convertToDouble(expression[fnc]));
-        if (fnc == "cos")
-            return std::cos(convertToDouble(expression[fnc]));
-        if (fnc == "tan")
-            return std::tan(convertToDouble(expression[fnc]));
-        if (fnc == "asin")
-            return std::asin(convertToDouble(expression[fnc]));
-        if (fnc == "acos")
-            return std::acos(convertToDouble(expression[fnc]));
-        if (fnc == "atan")
-            return std::atan(convertToDouble(expression[fnc]));
-        if (fnc == "sqrt")
-            return std::sqrt(convertToDouble(expression[fnc]));
-        if (fnc == "abs")
-            return std::abs(convertToDouble(expression[fnc]));
-        if (fnc == "deg2rad")
-            return convertToDouble(expression[fnc]) * M_PI / 180;
-        if (fnc == "rad2deg")
-            return convertToDouble(expression[fnc]) * 180 / M_PI;
-        if (fnc == "log")
-            return std::log(convertToDouble(expression[fnc]));
+        case Function::Sin:
+            return std::sin(convertToDouble(arg));
+        case Function::Cos:
+            return std::cos(convertToDouble(arg));
+        case Function::Tan:
+            return std::tan(convertToDouble(arg));
+        case Function::Asin:
+            return std::asin(convertToDouble(arg));
+        case Function::Acos:
+            return std::acos(convertToDouble(arg));
+        case Function::Atan:
+            return std::atan(convertToDouble(arg));
+        case Function::Sqrt:
+            return std::sqrt(convertToDouble(arg));
+        case Function::Abs:
+            return std::abs(convertToDouble(arg));
+        case Function::Deg2rad:
+            return convertToDouble(arg) * M_PI / 180;
+        case Function::Rad2deg:
+            return convertToDouble(arg) * 180 / M_PI;
+        case Function::Log:
+            return std::log(convertToDouble(arg));
 
         // 'round'
-        if (fnc == "round")
-            return (sint32)std::round(convertToDouble(expression[fnc]));
+        case Function::Round:
+            return (sint32)std::round(convertToDouble(arg));
 
         // 'add', 'sub', 'mul', 'div'
-#define COMP(NAME, OP) \
-if (fnc == #NAME) \
+#define COMP(NAME, ID, OP) \
+case Function::ID: \
 { \
-    validateArrayLength(expression[#NAME], 2, 2, \
+    validateArrayLength(arg, 2, 2, \
         "Function '" #NAME "' is expecting an array with 2 elements."); \
-    double a = convertToDouble(expression[#NAME][0]); \
-    double b = convertToDouble(expression[#NAME][1]); \
+    double a = convertToDouble(arg[0]); \
+    double b = convertToDouble(arg[1]); \
     return a OP b; \
 }
-        COMP(add, +);
-        COMP(sub, -);
-        COMP(mul, *);
-        COMP(div, /);
+        COMP(add, Add, +);
+        COMP(sub, Sub, -);
+        COMP(mul, Mul, *);
+        COMP(div, Div, /);
 #undef COMP
 
         // 'pow', 'atan2', 'mod', 'random'
-        if (fnc == "pow")
+        case Function::Pow:
         {
-            validateArrayLength(expression[fnc], 2, 2,
+            validateArrayLength(arg, 2, 2,
                 "Function 'pow' is expecting an array with 2 elements.");
-            double a = convertToDouble(expression[fnc][0]);
-            double b = convertToDouble(expression[fnc][1]);
+            double a = convertToDouble(arg[0]);
+            double b = convertToDouble(arg[1]);
             return std::pow(a, b);
         }
-        if (fnc == "atan2")
+        case Function::Atan2:
         {
-            validateArrayLength(expression[fnc], 2, 2,
+            validateArrayLength(arg, 2, 2,
                 "Function 'atan2' is expecting an array with 2 elements.");
-            double a = convertToDouble(expression[fnc][0]);
-            double b = convertToDouble(expression[fnc][1]);
+            double a = convertToDouble(arg[0]);
+            double b = convertToDouble(arg[1]);
             return std::atan2(a, b);
         }
-        if (fnc == "mod")
+        case Function::Mod:
         {
-            validateArrayLength(expression[fnc], 2, 2,
+            validateArrayLength(arg, 2, 2,
                 "Function 'mod' is expecting an array with 2 elements.");
-            sint32 a = (sint32)convertToDouble(expression[fnc][0]);
-            sint32 b = (sint32)convertToDouble(expression[fnc][1]);
+            sint32 a = (sint32)convertToDouble(arg[0]);
+            sint32 b = (sint32)convertToDouble(arg[1]);
             return a % b;
         }
-        if (fnc == "random")
+        case Function::Random:
         {
-            validateArrayLength(expression[fnc], 2, 2,
+            validateArrayLength(arg, 2, 2,
                 "Function 'random' is expecting an array with 2 elements.");
-            double a = convertToDouble(expression[fnc][0]);
-            double b = convertToDouble(expression[fnc][1]);
+            double a = convertToDouble(arg[0]);
+            double b = convertToDouble(arg[1]);
             return std::rand() * (b - a) / RAND_MAX;
         }
 
         // 'clamp'
-        if (fnc == "clamp")
+        case Function::Clamp:
         {
-            const Value &arr = expression[fnc];
+            const Value &arr = arg;
             validateArrayLength(arr, 3, 3,
                 "Function 'clamp' must have 3 values");
             double f = convertToDouble(arr[0]);
@@ -991,9 +1285,9 @@ if (fnc == #NAME) \
         }
 
         // 'min', 'max'
-        if (fnc == "min")
+        case Function::Min:
         {
-            const Value &arr = expression[fnc];
+            const Value &arr = arg;
             validateArrayLength(arr, 1, (uint32)-1,
                 "Function 'min' expects an array");
             double t = convertToDouble(arr[0]);
@@ -1001,9 +1295,9 @@ if (fnc == #NAME) \
                 t = std::min(t, convertToDouble(arr[i]));
             return t;
         }
-        if (fnc == "max")
+        case Function::Max:
         {
-            const Value &arr = expression[fnc];
+            const Value &arr = arg;
             validateArrayLength(arr, 1, (uint32)-1,
                 "Function 'max' expects an array");
             double t = convertToDouble(arr[0]);
@@ -1013,9 +1307,9 @@ if (fnc == #NAME) \
         }
 
         // 'if'
-        if (fnc == "if")
+        case Function::If:
         {
-            const Value &arr = expression[fnc];
+            const Value &arr = arg;
             validateArrayLength(arr, 3, 3,
                 "Function 'if' must have 3 values");
             if (filter(arr[0]))
@@ -1025,41 +1319,41 @@ if (fnc == #NAME) \
         }
 
         // 'strlen', 'str2num', 'lowercase', 'uppercase', 'capitalize', 'trim'
-        if (fnc == "strlen")
-            return utf8len(evaluate(expression[fnc]).asString());
-        if (fnc == "str2num")
-            return str2num(evaluate(expression[fnc]).asString());
-        if (fnc == "lowercase")
-            return lowercase(evaluate(expression[fnc]).asString());
-        if (fnc == "uppercase")
-            return uppercase(evaluate(expression[fnc]).asString());
-        if (fnc == "capitalize")
-            return titlecase(evaluate(expression[fnc]).asString());
-        if (fnc == "trim")
-            return utf8trim(evaluate(expression[fnc]).asString());
+        case Function::Strlen:
+            return utf8len(evaluate(arg).asString());
+        case Function::Str2num:
+            return str2num(evaluate(arg).asString());
+        case Function::Lowercase:
+            return lowercase(evaluate(arg).asString());
+        case Function::Uppercase:
+            return uppercase(evaluate(arg).asString());
+        case Function::Capitalize:
+            return titlecase(evaluate(arg).asString());
+        case Function::Trim:
+            return utf8trim(evaluate(arg).asString());
 
         // 'find', 'replace', 'substr'
-        if (fnc == "find")
+        case Function::Find:
         {
-            const auto &arr = expression[fnc];
+            const auto &arr = arg;
             validateArrayLength(arr, 2, 3,
                 "Function 'find' must have 2 or 3 values");
             return utf8find(evaluate(arr[0]).asString(),
                 evaluate(arr[1]).asString(),
                 arr.size() == 3 ? evaluate(arr[2]).asUInt() : 0);
         }
-        if (fnc == "replace")
+        case Function::Replace:
         {
-            const auto &arr = expression[fnc];
+            const auto &arr = arg;
             validateArrayLength(arr, 3, 3,
                 "Function 'replace' must have 3 values");
             return utf8replace(evaluate(arr[0]).asString(),
                 evaluate(arr[1]).asString(),
                 evaluate(arr[2]).asString());
         }
-        if (fnc == "substr")
+        case Function::Substr:
         {
-            const auto &arr = expression[fnc];
+            const auto &arr = arg;
             validateArrayLength(arr, 2, 3,
                 "Function 'substr' must have 2 or 3 values");
             return utf8substr(evaluate(arr[0]).asString(),
@@ -1068,37 +1362,35 @@ if (fnc == #NAME) \
         }
 
         // 'has-fonts', 'has-latin', 'is-cjk'
-        if (fnc == "has-latin")
-            return hasLatin(evaluate(expression[fnc]).asString());
-        if (fnc == "is-cjk")
-            return isCjk(evaluate(expression[fnc]).asString());
+        case Function::HasLatin:
+            return hasLatin(evaluate(arg).asString());
+        case Function::IsCjk:
+            return isCjk(evaluate(arg).asString());
 
         // 'map'
-        if (fnc == "map")
+        case Function::Map:
         {
             // { "map" : [inputValue, [[key, value], ...], defaultValue] }
-            const auto &arr = expression[fnc];
+            const auto &arr = arg;
             validateArrayLength(arr, 3, 3,
                 "Function 'map' must have 3 values");
             return evaluateMap(arr[0], arr[1], arr[2]);
         }
 
         // 'discrete', 'discrete2', 'linear', 'linear2'
-        if (fnc == "discrete")
-            return evaluatePairsArray<false>(tileId.lod, expression[fnc]);
-        if (fnc == "discrete2")
-            return evaluatePairsArray<false>(expression[fnc][0],
-                expression[fnc][1]);
-        if (fnc == "linear")
-            return evaluatePairsArray<true>(tileId.lod, expression[fnc]);
-        if (fnc == "linear2")
-            return evaluatePairsArray<true>(expression[fnc][0],
-                expression[fnc][1]);
+        case Function::Discrete:
+            return evaluatePairsArray<false>(tileId.lod, arg);
+        case Function::Discrete2:
+            return evaluatePairsArray<false>(arg[0], arg[1]);
+        case Function::Linear:
+            return evaluatePairsArray<true>(tileId.lod, arg);
+        case Function::Linear2:
+            return evaluatePairsArray<true>(arg[0], arg[1]);
 
         // 'lod-scaled'
-        if (fnc == "lod-scaled")
+        case Function::LodScaled:
         {
-            Value arr = evaluate(expression["lod-scaled"]);
+            Value arr = evaluate(arg);
             validateArrayLength(arr, 2, 3,
                 "Function 'lod-scaled' must have 2 or 3 values");
             float l = convertToDouble(arr[0]);
@@ -1108,9 +1400,9 @@ if (fnc == #NAME) \
         }
 
         // 'log-scale'
-        if (fnc == "logScale" || fnc == "log-scale")
+        case Function::LogScale:
         {
-            Value arr = evaluate(expression[fnc]);
+            Value arr = evaluate(arg);
             validateArrayLength(arr, 2, 4,
                 "Function 'log-scale' must have 2 to 4 values");
             double v = convertToDouble(arr[0]);
@@ -1122,6 +1414,10 @@ if (fnc == #NAME) \
             return p * std::log(v + 1) + a;
         }
 
+        case Function::Unknown:
+            break;
+        }
+
         // unknown
         if (Validating)
             THROW << "Unknown function <" << fnc << ">";
@@ -1172,18 +1468,28 @@ if (fnc == #NAME) \
                 THROW << "Invalid '{}' in <" << s << ">";
             std::string subs = s.substr(start + 1, end - start - 1);
             Json::Value v;
-            try
-            {
-                v = subs[0] == '{'
-                    ? stringToJson(subs)
-                    : Json::Value(subs);
-            }
-            catch (std::exception &e)
+            if (subs[0] == '{')
             {
-                THROW << "Invalid json <" << subs
-                    << ">, message <" << e.what() << ">";
+                // parse each embedded expression only once per tile
+                auto it = embeddedExpressions.find(subs);
+                if (it == embeddedExpressions.end())
+                {
+                    try
+                    {
+                        it = const_cast<EmbeddedExpressions&>(
+                            embeddedExpressions).emplace(subs,
+                            stringToJson(subs)).first;
+                    }
+                    catch (std::exception &e)
+                    {
+                        THROW << "Invalid json <" << subs
+                            << ">, message <" << e.what() << ">";
+                    }
+                }
+                subs = evaluate(it->second).asString();
             }
-            subs = evaluate(v).asString();
+            else
+                subs = evaluate(Json::Value(subs)).asString();
             std::string res;
             if (start > 0)
                 res += s.substr(0, start);
@@ -1254,33 +1560,32 @@ if (fnc == #NAME) \
         }
 
         const std::string &cond = expression[0].asString();
+        const auto fit = filterNames().find(cond);
 
-        if (cond == "skip")
+        switch (fit == filterNames().end() ? Filter::Unknown : fit->second)
         {
+        case Filter::Skip:
             validateArrayLength(expression, 1, 1,
                 "Invalid filter 'skip' array length.");
             return false;
-        }
 
         // comparison filters
-        {
-            bool equal = cond == "==";
-            bool diff = cond == "!=";
-            if (equal || diff)
-            {
-                validateArrayLength(expression, 3, 3,
-                    equal ? "Invalid filter '==' array length."
-                          : "Invalid filter '!=' array length.");
-                Value a = evaluate(expression[1]);
-                Value b = evaluate(expression[2]);
-                if ((a.isString() || a.isNull())
-                    && (b.isString() || b.isNull()))
-                    return (a.asString() == b.asString()) == equal;
-                return (convertToDouble(a) == convertToDouble(b)) == equal;
-            }
-        }
-#define COMP(OP) \
-        if (cond == #OP) \
+        case Filter::Equal:
+        case Filter::NotEqual:
+        {
+            bool equal = fit->second == Filter::Equal;
+            validateArrayLength(expression, 3, 3,
+                equal ? "Invalid filter '==' array length."
+                      : "Invalid filter '!=' array length.");
+            Value a = evaluate(expression[1]);
+            Value b = evaluate(expression[2]);
+            if ((a.isString() || a.isNull())
+                && (b.isString() || b.isNull()))
+                return (a.asString() == b.asString()) == equal;
+            return (convertToDouble(a) == convertToDouble(b)) == equal;
+        }
+#define COMP(OP, ID) \
+        case Filter::ID: \
         { \
             validateArrayLength(expression, 3, 3, \
                     "Invalid filter '" #OP "' array length."); \
@@ -1288,22 +1593,14 @@ if (fnc == #NAME) \
             double b = convertToDouble(expression[2]); \
             return a OP b; \
         }
-        COMP(>=);
-        COMP(<=);
-        COMP(>);
-        COMP(<);
+        COMP(>=, GreaterEqual);
+        COMP(<=, LessEqual);
+        COMP(>, Greater);
+        COMP(<, Less);
 #undef COMP
 
-        // negative filters
-        if (!cond.empty() && cond[0] == '!')
-        {
-            Value v(expression);
-            v[0] = cond.substr(1);
-            return !filter(v);
-        }
-
         // has filters
-        if (cond == "has")
+        case Filter::Has:
         {
             validateArrayLength(expression, 2, -1,
                 "Invalid filter 'has' array length.");
@@ -1312,7 +1609,7 @@ if (fnc == #NAME) \
         }
 
         // in filters
-        if (cond == "in")
+        case Filter::In:
         {
             validateArrayLength(expression, 2, -1,
                 "Invalid filter 'in' array length.");
@@ -1327,7 +1624,7 @@ if (fnc == #NAME) \
         }
 
         // aggregate filters
-        if (cond == "all")
+        case Filter::All:
         {
             uint32 start;
             const Value &v = aggregateFilterData(expression, start);
@@ -1336,7 +1633,7 @@ if (fnc == #NAME) \
                     return false;
             return true;
         }
-        if (cond == "any")
+        case Filter::Any:
         {
             uint32 start;
             const Value &v = aggregateFilterData(expression, start);
@@ -1345,7 +1642,7 @@ if (fnc == #NAME) \
                     return true;
             return false;
         }
-        if (cond == "none")
+        case Filter::None:
         {
             uint32 start;
             const Value &v = aggregateFilterData(expression, start);
@@ -1355,6 +1652,18 @@ if (fnc == #NAME) \
             return true;
         }
 
+        case Filter::Unknown:
+            break;
+        }
+
+        // negative filters
+        if (!cond.empty() && cond[0] == '!')
+        {
+            Value v(expression);
+            v[0] = cond.substr(1);
+            return !filter(v);
+        }
+
         // unknown filter
         if (Validating)
             THROW << "Unknown filter condition type.";
@@ -1621,7 +1930,7 @@ if (fnc == #NAME) \
             data.iconCoords.push_back(uv);
     }
 
-    std::string getHysteresisIdSpec(const Value &layer,
+    uint64 getHysteresisIdSpec(const Value &layer,
         GpuGeodataSpec &spec)
     {
         std::string hysteresisId;
@@ -1638,13 +1947,15 @@ if (fnc == #NAME) \
             if (Validating && hysteresisId.empty())
                 THROW << "Empty hysteresis id";
         }
-        return hysteresisId;
+        if (hysteresisId.empty())
+            return 0;
+        return hysteresisIdHash(hysteresisId);
     }
 
-    void addHysteresisIdItems(const std::string &hysteresisId,
+    void addHysteresisIdItems(uint64 hysteresisId,
         GpuGeodataSpec &data, uint32 itemsCount)
     {
-        if (hysteresisId.empty())
+        if (hysteresisId == 0)
             return;
         data.hysteresisIds.reserve(data.hysteresisIds.size() + itemsCount);
         for (uint32 i = 0; i < itemsCount; i++)
@@ -1883,7 +2194,8 @@ if (fnc == #NAME) \
             spec.unionData.line.width *= 0.5;
 
         GpuGeodataSpec &data = findSpecData(spec);
-        const auto arr = getFeaturePositions();
+        auto arr = getFeaturePositions();
+        simplifyLines(arr);
         data.positions.reserve(data.positions.size() + arr.size());
         data.positions.insert(data.positions.end(), arr.begin(), arr.end());
         eliminateSingularLines(data);
@@ -1897,7 +2209,7 @@ if (fnc == #NAME) \
         spec.type = GpuGeodataSpec::Type::IconScreen;
         addIconSpec(layer, spec);
 
-        std::string hysteresisId = getHysteresisIdSpec(layer, spec);
+        uint64 hysteresisId = getHysteresisIdSpec(layer, spec);
 
         float importance = getImportanceSpec(layer, spec, spec.commonData.icon.margin);
 
@@ -1941,7 +2253,7 @@ if (fnc == #NAME) \
         // flat labels may not be multi-line
         newLinesToSpaces(text);
 
-        std::string hysteresisId = getHysteresisIdSpec(layer, spec);
+        uint64 hysteresisId = getHysteresisIdSpec(layer, spec);
 
         float importance = getImportanceSpec(layer, spec);
 
@@ -1999,7 +2311,7 @@ if (fnc == #NAME) \
         if (text.empty())
             return;
 
-        std::string hysteresisId = getHysteresisIdSpec(layer, spec);
+        uint64 hysteresisId = getHysteresisIdSpec(layer, spec);
 
         float importance = getImportanceSpec(layer, spec, spec.unionData.labelScreen.margin);
 
@@ -2046,8 +2358,11 @@ if (fnc == #NAME) \
             spec.unionData.triangles.useStencil = v.asBool();
         }
 
+        auto arr = getFeatureTriangles();
+        simplifyTriangles(arr);
+        if (arr[0].empty())
+            return;
         GpuGeodataSpec &data = findSpecData(spec);
-        const auto arr = getFeatureTriangles();
         data.positions.reserve(data.positions.size() + arr.size());
         data.positions.insert(data.positions.end(), arr.begin(), arr.end());
     }
@@ -2055,9 +2370,10 @@ if (fnc == #NAME) \
     GpuGeodataSpec &findSpecData(const GpuGeodataSpec &spec)
     {
         // only modifying attributes not used in comparison
-        auto specIt = cacheData.find(spec);
-        if (specIt == cacheData.end())
-            specIt = cacheData.insert(spec).first;
+        assert(cacheData);
+        auto specIt = cacheData->find(spec);
+        if (specIt == cacheData->end())
+            specIt = cacheData->insert(spec).first;
         GpuGeodataSpec &data = const_cast<GpuGeodataSpec&>(*specIt);
         return data;
     }
@@ -2067,12 +2383,15 @@ if (fnc == #NAME) \
 
     GeodataTile *const data;
     const GeodataStylesheet *const stylesheet;
-    Value style;
-    const Value features;
+    const std::shared_ptr<const GeodataCompiledStyle> compiled;
+    const Value &style;
+    const std::string &features;
     const Value &browserOptions;
     const vec3 aabbPhys[2];
     const TileId tileId;
     const bool compatibility;
+    const double simplifyTolerance; // physical units, 0 = disabled
+    const std::set<std::string> &reusedLayers;
 
     // processing data
     //   fast accessors to currently processed feature
@@ -2092,41 +2411,74 @@ if (fnc == #NAME) \
             vec3 mm = bb - aa;
             double ms = length(mm) * 0.01;
             if (ms < 1e-15)
-                orthonormalize = identityMatrix3();
+                orthonormalize = vec3(1, 1, 1);
             else
-                orthonormalize = mat4to3(scaleMatrix(mm / resolution / ms));
-            assert(!std::isnan(orthonormalize(0, 0)));
+                orthonormalize = mm / resolution / ms;
+            assert(!std::isnan(orthonormalize[0]));
             model = translationMatrix(aa) * scaleMatrix(ms);
+            origin = aa;
+            scale = ms;
         }
 
         Point convertPoint(const Value &v) const
         {
             validateArrayLength(v, 3, 3, "Point must have 3 coordinates");
-            vec3 p = vec3(v[0].asDouble(), v[1].asDouble(), v[2].asDouble());
-            vec3f f = vec3(orthonormalize * p).cast<float>();
-            assert(!std::isnan(f[0]) && !std::isnan(f[1]) && !std::isnan(f[2]));
-            return { f[0], f[1], f[2] };
+            const double c[3] = { v[0].asDouble(), v[1].asDouble(),
+                v[2].asDouble() };
+            Point r;
+            convertPoints(c, &r, 1);
+            return r;
+        }
+
+        // both matrices are diagonal
+        //   so the transformation is a plain per-component multiplication
+        //   over the whole array
+        void convertPoints(const double *coords, Point *out,
+            std::size_t count) const
+        {
+            const double sx = orthonormalize[0];
+            const double sy = orthonormalize[1];
+            const double sz = orthonormalize[2];
+            for (std::size_t i = 0; i < count; i++, coords += 3)
+            {
+                out[i][0] = (float)(coords[0] * sx);
+                out[i][1] = (float)(coords[1] * sy);
+                out[i][2] = (float)(coords[2] * sz);
+                assert(!std::isnan(out[i][0]) && !std::isnan(out[i][1])
+                    && !std::isnan(out[i][2]));
+            }
         }
 
+        // gathers the coordinates first and transforms them in bulk
         std::vector<Point> convertArray(const Value &v, bool relative) const
         {
             (void)relative; // todo
-            std::vector<Point> a;
-            a.reserve(v.size());
+            const uint32 n = v.size();
+            std::vector<double> coords;
+            coords.reserve(n * 3);
             for (const Value &p : v)
-                a.push_back(convertPoint(p));
+            {
+                validateArrayLength(p, 3, 3, "Point must have 3 coordinates");
+                coords.push_back(p[0].asDouble());
+                coords.push_back(p[1].asDouble());
+                coords.push_back(p[2].asDouble());
+            }
+            std::vector<Point> a(n);
+            convertPoints(coords.data(), a.data(), n);
             return a;
         }
 
         vec3 m2w(const Point &p) const
         {
-            return vec4to3(vec4(model * vec3to4(rawToVec3(p.data()).cast<double>(), 1.0)));
+            return origin + rawToVec3(p.data()).cast<double>() * scale;
         }
 
         mat4 model;
 
     private:
-        mat3 orthonormalize;
+        vec3 orthonormalize; // diagonal of the scale matrix
+        vec3 origin; // translation of the model matrix
+        double scale = 1; // uniform scale of the model matrix
     };
 
     boost::optional<Group> group;
@@ -2175,14 +2527,14 @@ if (fnc == #NAME) \
             }
         }
         std::vector<Point> vertices;
-        vertices.reserve(array1.size());
-        for (uint32 i = 0, e = array1.size(); i < e; i += 3)
         {
-            Value v;
-            v.resize(3);
-            for (uint32 j = 0; j < 3; j++)
-                v[j] = array1[i + j];
-            vertices.push_back(group->convertPoint(v));
+            std::vector<double> coords;
+            coords.reserve(array1.size());
+            for (const Value &c : array1)
+                coords.push_back(c.asDouble());
+            vertices.resize(coords.size() / 3);
+            group->convertPoints(coords.data(), vertices.data(),
+                vertices.size());
         }
         const Value &surface = (*feature)["surface"];
         if (Validating)
@@ -2224,6 +2576,102 @@ if (fnc == #NAME) \
         }), fps.end());
     }
 
+    // tolerance for simplification in the model space of current group
+    double modelTolerance() const
+    {
+        return simplifyTolerance / group->model(0, 0);
+    }
+
+    // douglas-peucker simplification
+    //   the endpoints of each line are always kept
+    void simplifyLines(std::vector<std::vector<Point>> &lines) const
+    {
+        if (!(simplifyTolerance > 0))
+            return;
+        const double tol = modelTolerance();
+        const double tol2 = tol * tol;
+        std::vector<bool> keep;
+        std::vector<std::pair<uint32, uint32>> stack;
+        for (std::vector<Point> &line : lines)
+        {
+            const uint32 n = line.size();
+            if (n < 3)
+                continue;
+            keep.assign(n, false);
+            keep[0] = keep[n - 1] = true;
+            stack.emplace_back(0, n - 1);
+            while (!stack.empty())
+            {
+                const auto r = stack.back();
+                stack.pop_back();
+                const vec3 a = rawToVec3(line[r.first].data()).cast<double>();
+                const vec3 b = rawToVec3(line[r.second].data()).cast<double>();
+                const vec3 ab = b - a;
+                const double abl = dot(ab, ab);
+                double best = tol2;
+                uint32 bi = 0;
+                for (uint32 i = r.first + 1; i < r.second; i++)
+                {
+                    const vec3 p = rawToVec3(line[i].data()).cast<double>();
+                    double t = abl > 0 ? dot(p - a, ab) / abl : 0;
+                    t = clamp(t, 0.0, 1.0);
+                    const vec3 d = p - (a + ab * t);
+                    const double dd = dot(d, d);
+                    if (dd > best)
+                    {
+                        best = dd;
+                        bi = i;
+                    }
+                }
+                if (bi)
+                {
+                    keep[bi] = true;
+                    stack.emplace_back(r.first, bi);
+                    stack.emplace_back(bi, r.second);
+                }
+            }
+            uint32 j = 0;
+            for (uint32 i = 0; i < n; i++)
+                if (keep[i])
+                    line[j++] = line[i];
+            line.resize(j);
+        }
+    }
+
+    // vertex clustering on a grid with the tolerance sized cells
+    //   all vertices snap deterministically, therefore triangles
+    //   sharing vertices (also across features) stay connected
+    //   triangles collapsed by the snapping are removed
+    void simplifyTriangles(std::vector<std::vector<Point>> &triangles) const
+    {
+        if (!(simplifyTolerance > 0))
+            return;
+        // the snap moves the vertices by at most half of the cell diagonal
+        const double cell = modelTolerance() * 2 / std::sqrt(3.0);
+        const auto &snap = [&](Point &p) {
+            for (uint32 i = 0; i < 3; i++)
+                p[i] = (std::floor(p[i] / cell) + 0.5) * cell;
+        };
+        for (std::vector<Point> &tris : triangles)
+        {
+            assert((tris.size() % 3) == 0);
+            uint32 j = 0;
+            for (uint32 i = 0, e = tris.size(); i < e; i += 3)
+            {
+                Point a = tris[i + 0], b = tris[i + 1], c = tris[i + 2];
+                snap(a);
+                snap(b);
+                snap(c);
+                if (a == b || b == c || c == a)
+                    continue;
+                tris[j++] = a;
+                tris[j++] = b;
+                tris[j++] = c;
+            }
+            tris.resize(j);
+        }
+    }
+
     void eliminateSingularLines(GpuGeodataSpec &data) const
     {
         std::vector<bool> removes;
@@ -2251,61 +2699,1073 @@ if (fnc == #NAME) \
     // cache data
     //   temporary data generated while processing features
 
-    std::set<GpuGeodataSpec, GpuGeodataSpecComparator> cacheData;
+    std::map<std::string, GeodataSpecs> layersData;
+    std::vector<std::pair<std::string, GeodataSpecs *>> processedLayers[3];
+    GeodataSpecs *cacheData = nullptr; // of the currently processed layer
     AmpVariables ampVariables;
+    TileConstants tileConstants;
+    EmbeddedExpressions embeddedExpressions;
     const Value *currentLayer;
 };
 
-} // namespace
-
-void GeodataTile::decode()
+Value resolveInheritance(const Value &layers, const Value &orig)
 {
-    LOG(info2) << "Decoding geodata tile <" << name << ">";
-    OPTICK_EVENT("decode geodata tile");
-    OPTICK_TAG("name", name.c_str());
+    if (!orig["inherit"])
+        return orig;
 
-    // this resource is not meant to be downloaded
-    assert(!fetch);
+    Value base = resolveInheritance(layers,
+        layers[orig["inherit"].asString()]);
 
-    assert(state == Resource::State::decodeQueue);
-    map->statistics.resourcesDecoded++;
+    for (auto n : orig.getMemberNames())
+        base[n] = orig[n];
 
-    if (map->options.debugValidateGeodataStyles)
-    {
-        geoContext<true> ctx(this);
-        ctx.process();
-    }
-    else
-    {
-        geoContext<false> ctx(this);
-        ctx.process();
-    }
+    base.removeMember("inherit");
+
+    return base;
 }
 
-void GeodataTile::upload()
+// update style layers with inherit property
+void solveInheritance(Value &style)
 {
-    LOG(info2) << "Uploading geodata tile <" << name << ">";
-
-    assert(state == Resource::State::uploadQueue);
-    map->statistics.resourcesUploaded++;
+    Value ls;
+    const Value &layers = style["layers"];
+    for (const std::string &n : layers.getMemberNames())
+        ls[n] = resolveInheritance(layers, layers[n]);
+    style["layers"].swap(ls);
+}
 
-    // upload
-    renders.clear();
-    renders.reserve(specsToUpload.size());
-    uint32 index = 0;
-    for (auto &spec : specsToUpload)
+// defines which style layers are candidates for a specific feature type
+std::vector<std::string> filterLayersByType(const Value &style,
+    geoContext<false>::Type t)
+{
+    typedef geoContext<false>::Type Type;
+    std::vector<std::string> result;
+    const auto allLayerNames = style["layers"].getMemberNames();
+    for (const std::string &layerName : allLayerNames)
     {
-        ResourceInfo t;
-        std::stringstream ss;
-        ss << name << "#" << index++;
-        map->callbacks.loadGeodata(t, spec, ss.str());
-        renders.push_back(std::move(t));
+        const Value &layer = style["layers"][layerName];
+        if (layer.isMember("filter") && layer["filter"].isArray()
+            && layer["filter"][0] == "skip")
+            continue;
+        if (layer.isMember("visibility-switch"))
+        {
+            result.push_back(layerName);
+            continue;
+        }
+        bool point = isLayerStyleRequested(layer["point"]);
+        bool line = isLayerStyleRequested(layer["line"]);
+        bool icon = isLayerStyleRequested(layer["icon"]);
+        bool labelScreen = isLayerStyleRequested(layer["label"]);
+        bool labelFlat = isLayerStyleRequested(layer["line-label"]);
+        bool polygon = isLayerStyleRequested(layer["polygon"]);
+        bool ok = false;
+        switch (t)
+        {
+        case Type::Point:
+            ok = point || icon || labelScreen;
+            break;
+        case Type::Line:
+            ok = line || labelFlat; // todo enable degrading line features to point layers
+            break;
+        case Type::Polygon:
+            ok = polygon; // todo enable degrading polygon features to all layer types
+            break;
+        }
+        if (ok)
+            result.push_back(layerName);
     }
+    return result;
+}
+
+// collects names of layers, that the layer may refer to
+//   returns false if the reference cannot be determined statically
+bool layerReferences(const Value &layers, const std::string &name,
+    std::set<std::string> &result)
+{
+    if (!result.insert(name).second)
+        return true;
+    const Value &layer = layers[name];
+    std::vector<const Value*> refs;
+    if (layer.isMember("next-pass"))
+        refs.push_back(&layer["next-pass"][1]);
+    if (layer.isMember("visibility-switch"))
+    {
+        for (const Value &vs : layer["visibility-switch"])
+            if (vs.isArray() && !vs[1].empty())
+                refs.push_back(&vs[1]);
+    }
+    for (const Value *r : refs)
+    {
+        if (!r->isString())
+            return false;
+        const std::string n = r->asString();
+        if (n.find_first_of("{@$&#") != std::string::npos)
+            return false;
+        if (!layerReferences(layers, n, result))
+            return false;
+    }
+    return true;
+}
+
+// tests whether the expression depends on the tile only
+//   the test is conservative: any ($property), (&variable)
+//   or (#identifier) reference, and the random function, makes it dependent
+bool isTileConstant(const Value &constants, const Value &expression,
+    std::set<std::string> &visiting)
+{
+    if (expression.isString())
+    {
+        const std::string s = expression.asString();
+        if (s.find_first_of("$&#") != s.npos)
+            return false;
+        if (s.find('@') == s.npos)
+            return true;
+        if (s[0] != '@' || s.find('{') != s.npos
+            || !constants.isMember(s) || !visiting.insert(s).second)
+            return false;
+        bool r = isTileConstant(constants, constants[s], visiting);
+        visiting.erase(s);
+        return r;
+    }
+    if (expression.isArray() || expression.isObject())
+    {
+        for (auto it = expression.begin(), e = expression.end();
+            it != e; it++)
+        {
+            if (expression.isObject() && it.name() == "random")
+                return false;
+            if (!isTileConstant(constants, *it, visiting))
+                return false;
+        }
+    }
+    return true;
+}
+
+// smaller tiles are not worth splitting
+static const uint32 ParallelProcessingThreshold = 256 * 1024; // bytes
+
+// groups of features of a single tile processed by multiple decode workers
+template<bool Validating>
+struct GeodataParts
+{
+    std::vector<std::unique_ptr<geoContext<Validating>>> contexts;
+    std::vector<uint32> ranges; // index of first group of each part
+    std::vector<JsonSpan> groups;
+    std::shared_ptr<const GeodataParsedFeatures> parsed; // replaces groups
+    std::atomic<uint32> next{ 0 };
+    std::mutex mut;
+    std::condition_variable con;
+    std::exception_ptr error;
+    uint32 finished = 0;
+
+    // claims and processes parts until none are left
+    void run()
+    {
+        while (true)
+        {
+            const uint32 i = next++;
+            if (i >= contexts.size())
+                return;
+            try
+            {
+                if (parsed)
+                    contexts[i]->process(parsed->groups.data() + ranges[i],
+                        ranges[i + 1] - ranges[i]);
+                else
+                    contexts[i]->process(groups.data() + ranges[i],
+                        ranges[i + 1] - ranges[i]);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                if (!error)
+                    error = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mut);
+                finished++;
+            }
+            con.notify_all();
+        }
+    }
+};
+
+template<bool Validating>
+void processGeodataTile(GeodataTile *tile)
+{
+    typedef geoContext<Validating> Context;
+
+    // layers with unchanged definitions keep their previous results
+    std::set<std::string> reused;
+    const auto &signatures = tile->style->compiled->layerSignatures;
+    if (tile->map->options.cacheGeodataLayers)
+    {
+        for (const auto &it : signatures)
+        {
+            auto c = tile->layersCache.find(it.first);
+            if (c != tile->layersCache.end()
+                && c->second.signature == it.second)
+                reused.insert(it.first);
+        }
+    }
+    if (reused.size() == signatures.size())
+    {
+        Context ctx(tile, reused);
+        ctx.finish();
+        return;
+    }
+
+    // the groups are either shared from the features resource
+    //   or located in the json text of this tile
+    const std::shared_ptr<const GeodataParsedFeatures> parsed
+        = tile->parsedFeatures;
+    std::vector<JsonSpan> groups;
+    std::vector<uint64> sizes;
+    if (parsed)
+    {
+        Context::checkVersion(tile, parsed->version);
+        sizes.reserve(parsed->groups.size());
+        for (const auto &g : parsed->groups)
+            sizes.push_back(g.bytes);
+    }
+    else
+    {
+        groups = Context::scanGroups(tile);
+        sizes.reserve(groups.size());
+        for (const JsonSpan &g : groups)
+            sizes.push_back(g.end - g.begin);
+    }
+
+    uint32 partsCount = 1;
+    const uint32 threads = tile->map->options.lowPowerMode
+        ? 1 : tile->map->createOptions.decodeThreads;
+    if (threads > 1 && tile->features->size() >= ParallelProcessingThreshold)
+        partsCount = std::min<uint32>(sizes.size(), threads);
+    if (partsCount <= 1)
+    {
+        Context ctx(tile, reused);
+        if (parsed)
+            ctx.process(parsed->groups.data(), parsed->groups.size());
+        else
+            ctx.process(groups.data(), groups.size());
+        ctx.finish();
+        return;
+    }
+
+    // split the groups into consecutive parts of similar size
+    //   the decoding thread itself takes parts too
+    //   the merge in order of the parts retains the sequential results
+    auto parts = std::make_shared<GeodataParts<Validating>>();
+    {
+        uint64 total = 0;
+        for (uint64 s : sizes)
+            total += s;
+        uint64 accumulated = 0;
+        parts->ranges.push_back(0);
+        for (uint32 i = 0, e = sizes.size(); i < e; i++)
+        {
+            accumulated += sizes[i];
+            if (accumulated * partsCount
+                >= total * parts->ranges.size() && i + 1 < e)
+                parts->ranges.push_back(i + 1);
+        }
+        parts->ranges.push_back(sizes.size());
+        partsCount = parts->ranges.size() - 1;
+    }
+    parts->groups.swap(groups);
+    parts->parsed = parsed;
+    for (uint32 i = 0; i < partsCount; i++)
+        parts->contexts.push_back(
+            std::unique_ptr<Context>(new Context(tile, reused)));
+    for (uint32 i = 1; i < partsCount; i++)
+        tile->map->resources->queDecode.pushJob([parts]() {
+            parts->run();
+        });
+    parts->run();
+    {
+        std::unique_lock<std::mutex> lock(parts->mut);
+        while (parts->finished < partsCount)
+            parts->con.wait(lock);
+    }
+    if (parts->error)
+        std::rethrow_exception(parts->error);
+
+    Context &ctx = *parts->contexts[0];
+    for (uint32 i = 1; i < partsCount; i++)
+        ctx.merge(*parts->contexts[i]);
+    ctx.finish();
+}
+
+// approximate memory used by a json value
+uint64 jsonMemory(const Value &v)
+{
+    uint64 r = sizeof(Value);
+    switch (v.type())
+    {
+    case Json::stringValue:
+    {
+        const char *b = nullptr, *e = nullptr;
+        if (v.getString(&b, &e))
+            r += e - b;
+    } break;
+    case Json::arrayValue:
+    case Json::objectValue:
+        for (auto it = v.begin(), et = v.end(); it != et; it++)
+        {
+            // the members are kept in a map
+            //   the names are stored with the keys
+            r += 4 * sizeof(void*) + it.name().size() + jsonMemory(*it);
+        }
+        break;
+    default:
+        break;
+    }
+    return r;
+}
+
+} // namespace
+
+std::shared_ptr<const GeodataParsedFeatures> parseGeodataFeatures(
+    const std::string &data, uint64 &memoryCost)
+{
+    static const char *const typeNames[3]
+        = { "points", "lines", "polygons" };
+
+    auto r = std::make_shared<GeodataParsedFeatures>();
+    uint64 memory = sizeof(GeodataParsedFeatures);
+    JsonReader reader(data);
+    if (!reader.beginObject())
+        THROW << "Geodata features must be an object";
+    std::string key;
+    while (reader.nextMember(key))
+    {
+        if (key == "version")
+            r->version = reader.parseValue();
+        else if (key == "groups" && reader.beginArray())
+        {
+            while (reader.nextElement())
+            {
+                const JsonSpan span = reader.skipValue();
+                r->groups.emplace_back();
+                GeodataParsedFeatures::Group &g = r->groups.back();
+                g.bytes = span.end - span.begin;
+                JsonReader gr(span.begin, span.end);
+                if (!gr.beginObject())
+                    continue;
+                while (gr.nextMember(key))
+                {
+                    const auto it = std::find(typeNames, typeNames + 3, key);
+                    if (it == typeNames + 3)
+                    {
+                        g.properties[key] = gr.parseValue();
+                        continue;
+                    }
+                    auto &fs = g.features[it - typeNames];
+                    if (!gr.beginArray())
+                    {
+                        gr.skipValue();
+                        continue;
+                    }
+                    while (gr.nextElement())
+                    {
+                        fs.push_back(gr.parseValue());
+                        memory += jsonMemory(fs.back());
+                    }
+                }
+                memory += sizeof(g) + jsonMemory(g.properties) - sizeof(Value);
+                for (const auto &fs : g.features)
+                    memory += (fs.capacity() - fs.size()) * sizeof(Value);
+            }
+        }
+        else
+            reader.skipValue();
+    }
+    r->groups.shrink_to_fit();
+    memoryCost = memory;
+    return r;
+}
+
+// binary geodata features
+//   the same structure as the json features, the geometry is stored
+//   as quantized integers and all strings are shared in a table
+// integers are varints (7 bits per byte, least significant first),
+//   signed integers are zigzag encoded
+// data:        magic "VTSG", format version,
+//              strings count, strings, groups count, groups
+// string:      bytes count, utf-8 bytes
+// group:       bbox (6 doubles, little endian), resolution,
+//              value with the other members of the group,
+//              for points, lines and polygons: features count, features
+// point:       value with the other members, coordinates
+// line:        value with the other members, lines count,
+//              coordinates for each line
+// polygon:     value with the other members, coordinates of the vertices,
+//              surface indices count, indices as signed differences,
+//              middle count (0 or 1), coordinates (signed)
+// coordinates: points count, x, y and z of each point
+//              as signed differences to the previous point
+// value:       tag, followed by its content:
+//              0 null, 1 false, 2 true, 3 signed integer,
+//              4 double, 5 string (index into the table),
+//              6 array (count, values),
+//              7 object (count, key index and value for each member)
+
+namespace
+{
+
+const char GeodataBinaryMagic[4] = { 'V', 'T', 'S', 'G' };
+const uint32 GeodataBinaryVersion = 1;
+const uint32 GeodataBinaryMaxDepth = 64; // nested arrays and objects
+
+enum class BinaryTag : uint8
+{
+    Null, False, True, Int, Real, String, Array, Object
+};
+
+class GeodataBinaryReader
+{
+public:
+    explicit GeodataBinaryReader(const std::string &data)
+        : begin(data.data()), p(data.data()), e(data.data() + data.size())
+    {}
+
+    uint64 position() const
+    {
+        return p - begin;
+    }
+
+    void header()
+    {
+        if (e - p < 4 || memcmp(p, GeodataBinaryMagic, 4) != 0)
+            THROW << "Binary geodata have invalid magic";
+        p += 4;
+        const uint64 version = varint();
+        if (version != GeodataBinaryVersion)
+            THROW << "Binary geodata have unsupported version <"
+                << version << ">";
+        const uint32 n = count();
+        strings.reserve(n);
+        for (uint32 i = 0; i < n; i++)
+        {
+            const uint32 l = count();
+            strings.emplace_back(p, p + l);
+            p += l;
+        }
+    }
+
+    uint64 varint()
+    {
+        uint64 r = 0;
+        for (uint32 shift = 0; shift < 64; shift += 7)
+        {
+            if (p == e)
+                THROW << "Binary geodata are truncated";
+            const uint8 b = *p++;
+            r |= uint64(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+                return r;
+        }
+        THROW << "Binary geodata have invalid varint";
+        return 0;
+    }
+
+    sint64 signedVarint()
+    {
+        const uint64 u = varint();
+        return (sint64)(u >> 1) ^ -(sint64)(u & 1);
+    }
+
+    // each counted element takes at least one byte
+    //   which bounds the allocations for corrupted data
+    uint32 count()
+    {
+        const uint64 c = varint();
+        if (c > (uint64)(e - p))
+            THROW << "Binary geodata have invalid count";
+        return (uint32)c;
+    }
+
+    double real()
+    {
+        if (e - p < 8)
+            THROW << "Binary geodata are truncated";
+        uint64 u = 0;
+        for (uint32 i = 0; i < 8; i++)
+            u |= uint64((uint8)p[i]) << (i * 8);
+        p += 8;
+        double d;
+        memcpy(&d, &u, sizeof(d));
+        return d;
+    }
+
+    const std::string &string()
+    {
+        const uint64 i = varint();
+        if (i >= strings.size())
+            THROW << "Binary geodata have invalid string index";
+        return strings[i];
+    }
+
+    Value value(uint32 depth = 0)
+    {
+        if (depth > GeodataBinaryMaxDepth)
+            THROW << "Binary geodata are nested too deep";
+        if (p == e)
+            THROW << "Binary geodata are truncated";
+        switch ((BinaryTag)*p++)
+        {
+        case BinaryTag::Null:
+            return Value();
+        case BinaryTag::False:
+            return Value(false);
+        case BinaryTag::True:
+            return Value(true);
+        case BinaryTag::Int:
+            return Value((Json::Int64)signedVarint());
+        case BinaryTag::Real:
+            return Value(real());
+        case BinaryTag::String:
+            return Value(string());
+        case BinaryTag::Array:
+        {
+            Value r(Json::arrayValue);
+            const uint32 n = count();
+            for (uint32 i = 0; i < n; i++)
+                r.append(value(depth + 1));
+            return r;
+        }
+        case BinaryTag::Object:
+        {
+            Value r(Json::objectValue);
+            const uint32 n = count();
+            for (uint32 i = 0; i < n; i++)
+            {
+                const std::string &k = string();
+                r[k] = value(depth + 1);
+            }
+            return r;
+        }
+        default:
+            THROW << "Binary geodata have invalid value tag";
+            return Value();
+        }
+    }
+
+    // array of points, each an array of three integers
+    Value points()
+    {
+        Value r(Json::arrayValue);
+        const uint32 n = count();
+        sint64 c[3] = { 0, 0, 0 };
+        for (uint32 i = 0; i < n; i++)
+        {
+            Value &pt = r[i];
+            for (uint32 j = 0; j < 3; j++)
+            {
+                c[j] += signedVarint();
+                pt[j] = (Json::Int64)c[j];
+            }
+        }
+        return r;
+    }
+
+    // flat array of coordinates of the points
+    Value flatPoints()
+    {
+        Value r(Json::arrayValue);
+        const uint32 n = count();
+        if (n)
+            r.resize(n * 3);
+        sint64 c[3] = { 0, 0, 0 };
+        for (uint32 i = 0; i < n; i++)
+        {
+            for (uint32 j = 0; j < 3; j++)
+            {
+                c[j] += signedVarint();
+                r[i * 3 + j] = (Json::Int64)c[j];
+            }
+        }
+        return r;
+    }
+
+    Value feature(uint32 type)
+    {
+        Value f = value();
+        if (!f.isObject())
+            THROW << "Binary geodata feature must be an object";
+        switch (type)
+        {
+        case 0: // points
+            f["points"] = points();
+            break;
+        case 1: // lines
+        {
+            Value &ls = f["lines"] = Value(Json::arrayValue);
+            const uint32 n = count();
+            for (uint32 i = 0; i < n; i++)
+                ls.append(points());
+        } break;
+        case 2: // polygons
+        {
+            f["vertices"] = flatPoints();
+            Value &s = f["surface"] = Value(Json::arrayValue);
+            const uint32 n = count();
+            if (n)
+                s.resize(n);
+            sint64 index = 0;
+            for (uint32 i = 0; i < n; i++)
+            {
+                index += signedVarint();
+                if (index < 0)
+                    THROW << "Binary geodata have invalid surface index";
+                s[i] = (Json::UInt64)index;
+            }
+            if (count())
+            {
+                Value &m = f["middle"];
+                for (uint32 j = 0; j < 3; j++)
+                    m[j] = (Json::Int64)signedVarint();
+            }
+        } break;
+        }
+        return f;
+    }
+
+private:
+    const char *const begin;
+    const char *p;
+    const char *const e;
+    std::vector<std::string> strings;
+};
+
+class GeodataBinaryWriter
+{
+public:
+    void varint(uint64 v)
+    {
+        while (v >= 0x80)
+        {
+            body.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        body.push_back((char)v);
+    }
+
+    void signedVarint(sint64 v)
+    {
+        varint(((uint64)v << 1) ^ (uint64)(v >> 63));
+    }
+
+    void real(double d)
+    {
+        uint64 u;
+        memcpy(&u, &d, sizeof(u));
+        for (uint32 i = 0; i < 8; i++)
+            body.push_back((char)(u >> (i * 8)));
+    }
+
+    void string(const std::string &s)
+    {
+        auto it = stringIndices.find(s);
+        if (it == stringIndices.end())
+        {
+            it = stringIndices.emplace(s, (uint32)strings.size()).first;
+            strings.push_back(&it->first);
+        }
+        varint(it->second);
+    }
+
+    // members listed in skip are written as geometry instead
+    void value(const Value &v, const char *const *skip = nullptr,
+        uint32 skipCount = 0)
+    {
+        switch (v.type())
+        {
+        case Json::nullValue:
+            tag(BinaryTag::Null);
+            break;
+        case Json::booleanValue:
+            tag(v.asBool() ? BinaryTag::True : BinaryTag::False);
+            break;
+        case Json::intValue:
+            tag(BinaryTag::Int);
+            signedVarint(v.asInt64());
+            break;
+        case Json::uintValue:
+            if (v.asUInt64() > (uint64)std::numeric_limits<sint64>::max())
+            {
+                tag(BinaryTag::Real);
+                real(v.asDouble());
+            }
+            else
+            {
+                tag(BinaryTag::Int);
+                signedVarint(v.asInt64());
+            }
+            break;
+        case Json::realValue:
+            tag(BinaryTag::Real);
+            real(v.asDouble());
+            break;
+        case Json::stringValue:
+            tag(BinaryTag::String);
+            string(v.asString());
+            break;
+        case Json::arrayValue:
+            tag(BinaryTag::Array);
+            varint(v.size());
+            for (const Value &a : v)
+                value(a);
+            break;
+        case Json::objectValue:
+        {
+            std::vector<std::string> names = v.getMemberNames();
+            names.erase(std::remove_if(names.begin(), names.end(),
+                [&](const std::string &n) {
+                    return std::find(skip, skip + skipCount, n)
+                        != skip + skipCount;
+                }), names.end());
+            tag(BinaryTag::Object);
+            varint(names.size());
+            for (const std::string &n : names)
+            {
+                string(n);
+                value(v[n]);
+            }
+        } break;
+        }
+    }
+
+    static sint64 coordinate(const Value &v)
+    {
+        if (!v.isIntegral())
+            THROW << "Geodata coordinates must be quantized integers";
+        return v.asInt64();
+    }
+
+    void points(const Value &v)
+    {
+        varint(v.size());
+        sint64 c[3] = { 0, 0, 0 };
+        for (const Value &pt : v)
+        {
+            validateArrayLength(pt, 3, 3, "Point must have 3 coordinates");
+            for (uint32 j = 0; j < 3; j++)
+            {
+                const sint64 x = coordinate(pt[j]);
+                signedVarint(x - c[j]);
+                c[j] = x;
+            }
+        }
+    }
+
+    void flatPoints(const Value &v)
+    {
+        if (v.size() % 3)
+            THROW << "Polygon vertices must be an array with size divisible by 3";
+        const uint32 n = v.size() / 3;
+        varint(n);
+        sint64 c[3] = { 0, 0, 0 };
+        for (uint32 i = 0; i < n; i++)
+        {
+            for (uint32 j = 0; j < 3; j++)
+            {
+                const sint64 x = coordinate(v[i * 3 + j]);
+                signedVarint(x - c[j]);
+                c[j] = x;
+            }
+        }
+    }
+
+    void feature(const Value &f, uint32 type)
+    {
+        static const char *const geometry[3][3] = {
+            { "points" }, { "lines" }, { "vertices", "surface", "middle" } };
+        static const uint32 geometryCount[3] = { 1, 1, 3 };
+        if (!f.isObject())
+            THROW << "Geodata feature must be an object";
+        value(f, geometry[type], geometryCount[type]);
+        switch (type)
+        {
+        case 0: // points
+            points(f["points"]);
+            break;
+        case 1: // lines
+        {
+            const Value &ls = f["lines"];
+            varint(ls.size());
+            for (const Value &l : ls)
+                points(l);
+        } break;
+        case 2: // polygons
+        {
+            flatPoints(f["vertices"]);
+            const Value &s = f["surface"];
+            varint(s.size());
+            sint64 index = 0;
+            for (const Value &i : s)
+            {
+                const sint64 x = coordinate(i);
+                signedVarint(x - index);
+                index = x;
+            }
+            const Value &m = f["middle"];
+            if (m.isArray())
+            {
+                validateArrayLength(m, 3, 3, "Point must have 3 coordinates");
+                varint(1);
+                for (uint32 j = 0; j < 3; j++)
+                    signedVarint(coordinate(m[j]));
+            }
+            else
+                varint(0);
+        } break;
+        }
+    }
+
+    void group(const GeodataParsedFeatures::Group &g)
+    {
+        static const char *const skip[2] = { "bbox", "resolution" };
+        const Value &bbox = g.properties["bbox"];
+        for (uint32 i = 0; i < 2; i++)
+            for (uint32 j = 0; j < 3; j++)
+                real(bbox[i][j].asDouble());
+        varint(g.properties["resolution"].asUInt64());
+        value(g.properties, skip, 2);
+        for (uint32 type = 0; type < 3; type++)
+        {
+            varint(g.features[type].size());
+            for (const Value &f : g.features[type])
+                feature(f, type);
+        }
+    }
+
+    // the string table precedes the body
+    std::string finish()
+    {
+        std::string b;
+        std::swap(b, body);
+        body.append(GeodataBinaryMagic, 4);
+        varint(GeodataBinaryVersion);
+        varint(strings.size());
+        for (const std::string *s : strings)
+        {
+            varint(s->size());
+            body += *s;
+        }
+        body += b;
+        return std::move(body);
+    }
+
+private:
+    void tag(BinaryTag t)
+    {
+        body.push_back((char)t);
+    }
+
+    std::string body;
+    std::unordered_map<std::string, uint32> stringIndices;
+    std::vector<const std::string *> strings;
+};
+
+} // namespace
+
+const char *const GeodataBinaryContentType
+    = "application/vnd.vts.geodata+binary";
+
+bool isGeodataBinary(const std::string &data)
+{
+    return data.size() >= 4 && memcmp(data.data(), GeodataBinaryMagic, 4) == 0;
+}
+
+std::shared_ptr<const GeodataParsedFeatures> decodeGeodataBinary(
+    const std::string &data, uint64 &memoryCost)
+{
+    auto r = std::make_shared<GeodataParsedFeatures>();
+    uint64 memory = sizeof(GeodataParsedFeatures);
+    GeodataBinaryReader reader(data);
+    reader.header();
+    r->version = 1; // the structure of version 1 of the json features
+    const uint32 groups = reader.count();
+    r->groups.resize(groups);
+    for (GeodataParsedFeatures::Group &g : r->groups)
+    {
+        const uint64 start = reader.position();
+        double bbox[6];
+        for (double &b : bbox)
+            b = reader.real();
+        const uint64 resolution = reader.varint();
+        g.properties = reader.value();
+        if (!g.properties.isObject())
+            THROW << "Binary geodata group must be an object";
+        for (uint32 i = 0; i < 2; i++)
+            for (uint32 j = 0; j < 3; j++)
+                g.properties["bbox"][i][j] = bbox[i * 3 + j];
+        g.properties["resolution"] = (Json::UInt64)resolution;
+        for (uint32 type = 0; type < 3; type++)
+        {
+            const uint32 n = reader.count();
+            auto &fs = g.features[type];
+            fs.reserve(n);
+            for (uint32 i = 0; i < n; i++)
+            {
+                fs.push_back(reader.feature(type));
+                memory += jsonMemory(fs.back());
+            }
+        }
+        g.bytes = reader.position() - start;
+        memory += sizeof(g) + jsonMemory(g.properties) - sizeof(Value);
+    }
+    memoryCost = memory;
+    return r;
+}
+
+std::string encodeGeodataBinary(const std::string &json)
+{
+    uint64 memory = 0;
+    const auto parsed = parseGeodataFeatures(json, memory);
+    GeodataBinaryWriter writer;
+    writer.varint(parsed->groups.size());
+    for (const auto &g : parsed->groups)
+        writer.group(g);
+    return writer.finish();
+}
+
+std::string geodataBinaryToJson(const std::string &data)
+{
+    uint64 memory = 0;
+    const auto parsed = decodeGeodataBinary(data, memory);
+    static const char *const typeNames[3]
+        = { "points", "lines", "polygons" };
+    Value r(Json::objectValue);
+    r["version"] = parsed->version;
+    Value &groups = r["groups"] = Value(Json::arrayValue);
+    for (const auto &g : parsed->groups)
+    {
+        Value v = g.properties;
+        for (uint32 type = 0; type < 3; type++)
+        {
+            if (g.features[type].empty())
+                continue;
+            Value &fs = v[typeNames[type]] = Value(Json::arrayValue);
+            for (const Value &f : g.features[type])
+                fs.append(f);
+        }
+        groups.append(std::move(v));
+    }
+    return jsonToString(r);
+}
+
+std::shared_ptr<const GeodataCompiledStyle> compileGeodataStyle(
+    const std::string &data)
+{
+    typedef geoContext<false>::Type Type;
+    auto r = std::make_shared<GeodataCompiledStyle>();
+    Value style = stringToJson(data);
+    solveInheritance(style);
+    for (Type t : { Type::Point, Type::Line, Type::Polygon })
+        r->typedLayerNames[(int)t] = filterLayersByType(style, t);
+    const Value &constants = style["constants"];
+    for (const std::string &n : constants.getMemberNames())
+    {
+        std::set<std::string> visiting;
+        if (isTileConstant(constants, constants[n], visiting))
+            r->tileConstants.insert(n);
+    }
+
+    // signatures of the parts of the style that affect each layer
+    {
+        const Value &layers = style["layers"];
+        Value common = style;
+        common.removeMember("layers");
+        const std::string commonStr = jsonToString(common);
+        const std::string allStr = jsonToString(layers);
+        std::hash<std::string> hash;
+        for (const std::string &n : layers.getMemberNames())
+        {
+            std::set<std::string> refs;
+            std::string str = commonStr;
+            if (layerReferences(layers, n, refs))
+            {
+                Value subset(Json::objectValue);
+                for (const std::string &rn : refs)
+                    subset[rn] = layers[rn];
+                str += jsonToString(subset);
+            }
+            else
+                str += allStr;
+            r->layerSignatures[n] = hash(str);
+        }
+    }
+
+    r->json = std::make_shared<const Value>(std::move(style));
+    return r;
+}
+
+void GeodataTile::decode()
+{
+    VTS_LOG(info2) << "Decoding geodata tile <" << name << ">";
+    OPTICK_EVENT("decode geodata tile");
+    OPTICK_TAG("name", name.c_str());
+
+    // this resource is not meant to be downloaded
+    assert(!fetch);
+
+    assert(state == Resource::State::decodeQueue);
+    map->resources->decoded++;
+    uploadIndex = 0;
+    std::vector<ResourceInfo>().swap(rendersUploading);
+
+    if (map->options.debugValidateGeodataStyles)
+        processGeodataTile<true>(this);
+    else
+        processGeodataTile<false>(this);
+}
+
+uint32 GeodataTile::decodedMemoryCost() const
+{
+    uint64 m = 0;
+    for (const GpuGeodataSpec &spec : specsToUpload)
+        m += specMemory(spec);
+    return m;
+}
+
+void GeodataTile::upload()
+{
+    assert(state == Resource::State::uploadQueue);
+    if (uploadIndex == 0)
+    {
+        VTS_LOG(info2) << "Uploading geodata tile <" << name << ">";
+        map->statistics.resourcesUploaded++;
+        rendersUploading.clear();
+        rendersUploading.reserve(specsToUpload.size());
+    }
+
+    // upload
+    const double slice = map->options.uploadTimeSlice;
+    const auto start = std::chrono::steady_clock::now();
+    while (uploadIndex < specsToUpload.size())
+    {
+        ResourceInfo t;
+        std::stringstream ss;
+        ss << name << "#" << uploadIndex;
+        map->callbacks.loadGeodata(t, specsToUpload[uploadIndex], ss.str());
+        rendersUploading.push_back(std::move(t));
+        specsToUpload[uploadIndex++] = GpuGeodataSpec();
+        if (slice > 0 && uploadIndex < specsToUpload.size()
+            && std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count() > slice)
+            return; // continues in following data tick
+    }
+    uploadIndex = 0;
     std::vector<GpuGeodataSpec>().swap(specsToUpload);
+    renders.swap(rendersUploading);
+    std::vector<ResourceInfo>().swap(rendersUploading);
 
     // memory consumption
     info.ramMemoryCost = sizeof(*this)
-        + renders.size() * sizeof(ResourceInfo);
+        + renders.size() * sizeof(ResourceInfo)
+        + layersCacheMemory;
     for (const ResourceInfo &it : renders)
     {
         info.gpuMemoryCost += it.gpuMemoryCost;
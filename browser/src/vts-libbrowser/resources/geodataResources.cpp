@@ -31,6 +31,7 @@
 #include "../gpuResource.hpp"
 #include "../resources.hpp"
 #include "../utilities/json.hpp"
+#include "../utilities/logFilter.hpp"
 
 #include <dbglog/dbglog.hpp>
 
@@ -42,8 +43,46 @@ GeodataFeatures::GeodataFeatures(vts::MapImpl *map, const std::string &name) : R
 
 void GeodataFeatures::decode()
 {
-    LOG(info2) << "Decoding geodata features <" << name << ">";
+    VTS_LOG(info2) << "Decoding geodata features <" << name << ">";
     data = std::make_shared<const std::string>(fetch->reply.content.str());
+    parsed.reset();
+    info.ramMemoryCost = sizeof(*this) + data->size();
+
+    // binary features are always decoded here,
+    //   the tiles cannot read them as json
+    //   (the cache does not keep the content type, hence the magic)
+    if (fetch->reply.contentType == GeodataBinaryContentType
+        || isGeodataBinary(*data))
+    {
+        try
+        {
+            uint64 memory = 0;
+            parsed = decodeGeodataBinary(*data, memory);
+            info.ramMemoryCost += memory;
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn2) << "Failed to decode binary geodata features <"
+                << name << ">, with error <" << e.what() << ">";
+        }
+    }
+
+    // the parsed features are shared by all tiles that use them
+    //   invalid features are left for the tiles to report
+    else if (map->options.cacheParsedGeodataFeatures)
+    {
+        try
+        {
+            uint64 memory = 0;
+            parsed = parseGeodataFeatures(*data, memory);
+            info.ramMemoryCost += memory;
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn2) << "Failed to parse geodata features <"
+                << name << ">, with error <" << e.what() << ">";
+        }
+    }
 
 #ifndef __EMSCRIPTEN__
     if (map->options.debugExtractRawResources)
@@ -75,6 +114,7 @@ void GeodataStylesheet::decode()
     LOG(info2) << "Decoding geodata stylesheet <" << name << ">";
     data = fetch->reply.content.str();
     dependenciesLoaded = false;
+    *dependenciesChanged = true;
 
 #ifndef __EMSCRIPTEN__
     if (map->options.debugExtractRawResources)
@@ -164,8 +204,8 @@ Validity GeodataStylesheet::dependencies()
         bitmaps.clear();
         try
         {
-            json = std::make_shared<const Json::Value>(stringToJson(data));
-            auto &s = *json;
+            compiled = compileGeodataStyle(data);
+            auto &s = *compiled->json;
             for (const auto &n : s["fonts"].getMemberNames())
             {
                 std::string p = s["fonts"][n].asString();
@@ -190,19 +230,27 @@ Validity GeodataStylesheet::dependencies()
         dependenciesValidity = Validity::Valid;
     }
 
+    for (const auto &it : fonts)
+        map->touchResource(std::static_pointer_cast<Resource>(it.second));
+    for (const auto &it : bitmaps)
+        map->touchResource(std::static_pointer_cast<Resource>(it.second));
+    if (!dependenciesChanged->exchange(false))
+        return dependenciesMerged;
+
     Validity valid = dependenciesValidity;
     for (const auto &it : fonts)
     {
-        auto r = std::static_pointer_cast<Resource>(it.second);
-        map->touchResource(r);
-        valid = merge(valid, map->getResourceValidity(r));
+        map->resources->addWaiter(it.second.get(), dependenciesChanged);
+        valid = merge(valid, map->getResourceValidity(
+            std::static_pointer_cast<Resource>(it.second)));
     }
     for (const auto &it : bitmaps)
     {
-        auto r = std::static_pointer_cast<Resource>(it.second);
-        map->touchResource(r);
-        valid = merge(valid, map->getResourceValidity(r));
+        map->resources->addWaiter(it.second.get(), dependenciesChanged);
+        valid = merge(valid, map->getResourceValidity(
+            std::static_pointer_cast<Resource>(it.second)));
     }
+    dependenciesMerged = valid;
     return valid;
 }
 
@@ -218,6 +266,7 @@ GeodataTile::GeodataTile(MapImpl *map, const std::string &name) : Resource(map,
     // initialize aabb to universe
     aabbPhys[0] = -inf3();
     aabbPhys[1] = inf3();
+    texelSize = inf1();
 }
 
 GeodataTile::~GeodataTile()
@@ -236,7 +285,7 @@ FetchTask::ResourceType GeodataTile::resourceType() const
     return FetchTask::ResourceType::Undefined;
 }
 
-void GeodataTile::update(const std::shared_ptr<GeodataStylesheet> &s, const std::shared_ptr<const std::string> &f, const std::shared_ptr<const Json::Value> &b, const vec3 ab[2], const TileId &tid)
+void GeodataTile::update(const std::shared_ptr<GeodataStylesheet> &s, const std::shared_ptr<const std::string> &f, const std::shared_ptr<const GeodataParsedFeatures> &pf, const std::shared_ptr<const Json::Value> &b, const vec3 ab[2], const TileId &tid, double ts)
 {
     switch ((Resource::State)state)
     {
@@ -245,14 +294,22 @@ void GeodataTile::update(const std::shared_ptr<GeodataStylesheet> &s, const std:
         UTILITY_FALLTHROUGH;
     case Resource::State::errorFatal: // allow reloading when sources change, even if it failed before
     case Resource::State::ready:
-        if (style != s || features != f || browserOptions != b || tileId != tid || ab[0] != aabbPhys[0] || ab[1] != aabbPhys[1])
+        if (style != s || features != f || browserOptions != b || tileId != tid || ab[0] != aabbPhys[0] || ab[1] != aabbPhys[1] || texelSize != ts)
         {
+            // cached layers are valid for the same features only
+            if (features != f || browserOptions != b || tileId != tid || ab[0] != aabbPhys[0] || ab[1] != aabbPhys[1] || texelSize != ts)
+            {
+                layersCache.clear();
+                layersCacheMemory = 0;
+            }
             style = s;
             features = f;
+            parsedFeatures = pf;
             browserOptions = b;
             aabbPhys[0] = ab[0];
             aabbPhys[1] = ab[1];
             tileId = tid;
+            texelSize = ts;
             state = Resource::State::decodeQueue;
             map->resources->queDecode.push(shared_from_this());
             return;
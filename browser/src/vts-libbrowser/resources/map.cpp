@@ -45,30 +45,50 @@ template<class T>
 std::shared_ptr<T> getMapResource(MapImpl *map, const std::string &name)
 {
     assert(!name.empty());
+    auto lock = map->traversalLock();
     map->statistics.resourcesAccessed++;
     auto it = map->resources->resources.find(name);
     if (it == map->resources->resources.end())
     {
-        auto r = std::make_shared<T>(map, name);
+        // the resources belong to the map that owns them
+        //   so that they do not outlive the sharing maps
+        auto r = std::make_shared<T>(map->resources->map, name);
         it = map->resources->resources.insert(std::make_pair(name, r)).first;
+        r->managed = true;
+        r->state.setCounted(true);
         map->statistics.resourcesCreated++;
     }
     assert(it->second);
     map->touchResource(it->second);
-    auto res = std::dynamic_pointer_cast<T>(it->second);
-    assert(res);
-    return res;
+    // the names of resources of different types never collide
+    assert(std::dynamic_pointer_cast<T>(it->second));
+    return std::static_pointer_cast<T>(it->second);
 }
 
 } // namespace
 
+std::unique_lock<std::recursive_mutex> MapImpl::traversalLock()
+{
+    MapImpl *owner = resources->map;
+    if (owner->traversalParallel)
+        return std::unique_lock<std::recursive_mutex>(owner->traversalMutex);
+    return {};
+}
+
 void MapImpl::touchResource(const std::shared_ptr<Resource> &resource)
 {
-    resource->lastAccessTick = renderTickIndex;
+    auto lock = traversalLock();
+    // the ticks of the owner are used for eviction
+    const uint32 tick = resources->map->renderTickIndex;
+    if (resource->lastAccessTick == tick && resource->lruLinked)
+        return;
+    resource->lastAccessTick = tick;
+    resources->touch(resource.get());
 }
 
 Validity MapImpl::getResourceValidity(const std::string &name)
 {
+    auto lock = traversalLock();
     auto it = resources->resources.find(name);
     if (it == resources->resources.end())
         return Validity::Invalid;
@@ -102,6 +122,18 @@ MapImpl::getAtmosphereDensityTexture(
     return getMapResource<GpuAtmosphereDensityTexture>(this, name);
 }
 
+std::shared_ptr<GpuMaskedTexture> MapImpl::getMaskedTexture(
+    const std::string &name)
+{
+    return getMapResource<GpuMaskedTexture>(this, name);
+}
+
+std::shared_ptr<TextureMask> MapImpl::getTextureMask(
+    const std::string &name)
+{
+    return getMapResource<TextureMask>(this, name);
+}
+
 std::shared_ptr<GpuMesh> MapImpl::getMesh(const std::string &name)
 {
     return getMapResource<GpuMesh>(this, name);
@@ -174,7 +206,7 @@ std::shared_ptr<GeodataStylesheet> MapImpl::newGeoStyle(
 {
     auto res = std::make_shared<GeodataStylesheet>(this, name);
     res->data = value;
-    res->json.reset();
+    res->compiled.reset();
     res->dependenciesLoaded = false;
     res->state = Resource::State::ready;
     return res;
@@ -185,6 +217,12 @@ std::shared_ptr<GeodataTile> MapImpl::getGeodata(const std::string &name)
     return getMapResource<GeodataTile>(this, name);
 }
 
+std::shared_ptr<GeodataPartition> MapImpl::getGeodataPartition(
+        const std::string &name)
+{
+    return getMapResource<GeodataPartition>(this, name);
+}
+
 std::shared_ptr<GpuFont> MapImpl::getFont(const std::string &name)
 {
     return getMapResource<GpuFont>(this, name);
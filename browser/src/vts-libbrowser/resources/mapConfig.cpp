@@ -33,9 +33,89 @@
 
 #include <vts-libs/vts/mapconfig-json.hpp>
 
+#include <list>
+#include <mutex>
+#include <cstring>
+
 namespace vts
 {
 
+namespace
+{
+
+// parsed mapconfigs shared by all maps in the process
+//   reloading unchanged content (revalidation, purge, another map)
+//   copies the parsed structures instead of parsing the json again
+class ParsedMapconfigs
+{
+public:
+    static const uint32 Capacity = 4;
+
+    struct Entry
+    {
+        std::string name;
+        std::string content;
+        uint64 hash = 0;
+        std::shared_ptr<const vtslibs::vts::MapConfig> parsed;
+    };
+
+    static uint64 contentHash(const Buffer &b)
+    {
+        // fnv-1a
+        uint64 h = 14695981039346656037ull;
+        const unsigned char *p = (const unsigned char *)b.data();
+        for (uint32 i = 0, e = b.size(); i < e; i++)
+        {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    std::shared_ptr<const vtslibs::vts::MapConfig> find(
+        const std::string &name, const Buffer &content, uint64 hash)
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        for (auto it = entries.begin(); it != entries.end(); it++)
+        {
+            if (it->hash != hash || it->name != name
+                || it->content.size() != content.size()
+                || memcmp(it->content.data(), content.data(),
+                    content.size()) != 0)
+                continue;
+            entries.splice(entries.begin(), entries, it);
+            return entries.front().parsed;
+        }
+        return nullptr;
+    }
+
+    void insert(const std::string &name, const Buffer &content,
+        uint64 hash, const vtslibs::vts::MapConfig &parsed)
+    {
+        Entry e;
+        e.name = name;
+        e.content = std::string(content.data(), content.size());
+        e.hash = hash;
+        e.parsed = std::make_shared<const vtslibs::vts::MapConfig>(parsed);
+        std::lock_guard<std::mutex> lock(mut);
+        entries.push_front(std::move(e));
+        while (entries.size() > Capacity)
+            entries.pop_back();
+    }
+
+private:
+    std::list<Entry> entries; // most recently used first
+    std::mutex mut;
+};
+
+ParsedMapconfigs &parsedMapconfigs()
+{
+    static ParsedMapconfigs cache;
+    return cache;
+}
+
+} // namespace
+
 Mapconfig::Mapconfig(MapImpl *map, const std::string &name)
     : Resource(map, name)
 {
@@ -54,14 +134,29 @@ void Mapconfig::decode()
     *(vtslibs::vts::MapConfig*)this = vtslibs::vts::MapConfig();
     browserOptions = BrowserOptions();
     atmosphereDensityTextureName = "";
-    convertorData.reset();
+    {
+        std::lock_guard<std::mutex> lock(convertorsMutex);
+        convertorsFree.clear();
+    }
     boundInfos.clear();
     freeInfos.clear();
 
     // load
     {
-        detail::BufferStream w(fetch->reply.content);
-        vtslibs::vts::loadMapConfig(*this, w, name);
+        const Buffer &content = fetch->reply.content;
+        const uint64 hash = ParsedMapconfigs::contentHash(content);
+        auto parsed = parsedMapconfigs().find(name, content, hash);
+        if (parsed)
+        {
+            LOG(info1) << "Reusing parsed mapconfig <" << name << ">";
+            *(vtslibs::vts::MapConfig*)this = *parsed;
+        }
+        else
+        {
+            detail::BufferStream w(content);
+            vtslibs::vts::loadMapConfig(*this, w, name);
+            parsedMapconfigs().insert(name, content, hash, *this);
+        }
     }
 
     // search url on earth
@@ -116,8 +211,18 @@ void Mapconfig::decode()
         referenceDivisionNodeInfos.emplace_back(referenceFrame, it.first, true, *this);
     }
 
-    // convertor for use in decode thread
-    convertorData = CoordManip::create(*this, browserOptions.searchSrs, map->createOptions.customSrs1, map->createOptions.customSrs2);
+    // the first convertor is created here to validate the srs
+    releaseConvertor(acquireConvertor());
+
+    // horizon culling ellipsoid
+    //   it is shrunk to stay below the lowest terrain
+    horizonRadii = vec3(0, 0, 0);
+    if (navigationSrsType() != vtslibs::registry::Srs::Type::projected)
+    {
+        auto r = geo::ellipsoid(srs(referenceFrame.model.physicalSrs).srsDef);
+        const double margin = isEarth() ? 500 : r[0] * 0.0025;
+        horizonRadii = vec3(r[0] - margin, r[1] - margin, r[2] - margin);
+    }
 
     // memory use
     info.ramMemoryCost += sizeof(*this);
@@ -133,6 +238,26 @@ vtslibs::registry::Srs::Type Mapconfig::navigationSrsType() const
     return srs.get(referenceFrame.model.navigationSrs).type;
 }
 
+std::shared_ptr<CoordManip> Mapconfig::acquireConvertor()
+{
+    {
+        std::lock_guard<std::mutex> lock(convertorsMutex);
+        if (!convertorsFree.empty())
+        {
+            std::shared_ptr<CoordManip> c = std::move(convertorsFree.back());
+            convertorsFree.pop_back();
+            return c;
+        }
+    }
+    return CoordManip::create(*this, browserOptions.searchSrs, map->createOptions.customSrs1, map->createOptions.customSrs2);
+}
+
+void Mapconfig::releaseConvertor(std::shared_ptr<CoordManip> &&convertor)
+{
+    std::lock_guard<std::mutex> lock(convertorsMutex);
+    convertorsFree.push_back(std::move(convertor));
+}
+
 BoundInfo *Mapconfig::getBoundInfo(const std::string &id)
 {
     auto it = boundInfos.find(id);
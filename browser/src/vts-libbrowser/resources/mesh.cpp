@@ -25,19 +25,117 @@
  */
 
 #include "../utilities/obj.hpp"
+#include "../utilities/meshOptimizer.hpp"
+#include "../utilities/collisionMesh.hpp"
+#include "../resources.hpp"
 #include "../gpuResource.hpp"
 #include "../fetchTask.hpp"
 #include "../map.hpp"
+#include "../utilities/logFilter.hpp"
 
 #include <dbglog/dbglog.hpp>
 #include <vts-libs/vts/mesh.hpp>
 #include <vts-libs/vts/meshio.hpp>
 
 #include <optick.h>
+#include <cmath>
+#include <cstring>
 
 namespace vts
 {
 
+namespace
+{
+
+// convert directly from the ublas points into the interleaved vertex buffer
+
+void writePosition(char *out, const math::Point3 &p)
+{
+    float *o = (float*)out;
+    o[0] = (float)p(0);
+    o[1] = (float)p(1);
+    o[2] = (float)p(2);
+}
+
+// the normalized positions are in range -1 .. 1
+//   and are stored as normalized shorts, padded to 4 components
+void writeQuantizedPosition(char *out, const math::Point3 &p)
+{
+    sint16 *o = (sint16*)out;
+    for (uint32 i = 0; i < 3; i++)
+    {
+        double v = std::round(p(i) * 32767.0);
+        o[i] = (sint16)std::min(std::max(v, -32767.0), 32767.0);
+    }
+    o[3] = 0;
+}
+
+void writeUv(char *out, const math::Point2 &p)
+{
+    uint16 *o = (uint16*)out;
+    for (uint32 i = 0; i < 2; i++)
+    {
+        float v = (float)p(i) * 65535.0f;
+        o[i] = (uint16)std::min(std::max(v, 0.0f), 65535.0f);
+    }
+}
+
+// the triangles crossing the middle of the uv are repeated in all
+//   quarters they touch, the clipping in the shader still applies
+void appendQuarterRanges(GpuMeshSpec &spec,
+    uint32 offsets[4], uint32 counts[4])
+{
+    const GpuMeshSpec::VertexAttribute &a = spec.attributes[2];
+    assert(a.enable && a.type == GpuTypeEnum::UnsignedShort);
+    const uint16 *indices = (const uint16*)spec.indices.data();
+    const auto &uv = [&](uint16 i) -> vec2f {
+        const uint16 *p = (const uint16*)(spec.vertices.data()
+            + a.offset + (std::size_t)a.stride * i);
+        return vec2f(p[0], p[1]) / 65535.f;
+    };
+
+    std::vector<uint16> quarters[4];
+    for (uint32 i = 0; i < spec.indicesCount; i += 3)
+    {
+        vec2f l = uv(indices[i]);
+        vec2f u = l;
+        for (uint32 j = 1; j < 3; j++)
+        {
+            const vec2f p = uv(indices[i + j]);
+            l = l.cwiseMin(p);
+            u = u.cwiseMax(p);
+        }
+        for (uint32 q = 0; q < 4; q++)
+        {
+            const vec2f ql = vec2f(q % 2, q / 2) * 0.5f;
+            if (u[0] < ql[0] || l[0] > ql[0] + 0.5f
+                || u[1] < ql[1] || l[1] > ql[1] + 0.5f)
+                continue;
+            quarters[q].insert(quarters[q].end(), indices + i, indices + i + 3);
+        }
+    }
+
+    uint32 total = spec.indicesCount;
+    for (uint32 q = 0; q < 4; q++)
+    {
+        offsets[q] = total;
+        counts[q] = quarters[q].size();
+        total += counts[q];
+    }
+    Buffer b;
+    b.allocate(total * sizeof(uint16));
+    memcpy(b.data(), indices, spec.indicesCount * sizeof(uint16));
+    for (uint32 q = 0; q < 4; q++)
+    {
+        if (counts[q])
+            memcpy(b.data() + offsets[q] * sizeof(uint16),
+                quarters[q].data(), counts[q] * sizeof(uint16));
+    }
+    spec.indices = std::move(b);
+}
+
+} // namespace
+
 GpuMeshSpec::GpuMeshSpec(const Buffer &buffer) :
     verticesCount(0), indicesCount(0),
     faceMode(FaceMode::Triangles), indexMode(GpuTypeEnum::UnsignedShort)
@@ -80,7 +178,12 @@ GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
     assert(m.facesTc.size() == m.faces.size() || m.facesTc.empty());
     assert(m.etc.size() == m.vertices.size() || m.etc.empty());
 
-    uint32 vertexSize = sizeof(vec3f);
+    const bool quantized = map->options.quantizeMeshPositions;
+    const uint32 positionSize = quantized
+        ? 4 * sizeof(sint16) : sizeof(vec3f);
+    const auto position = quantized ? &writeQuantizedPosition : &writePosition;
+
+    uint32 vertexSize = positionSize;
     if (m.tc.size())
         vertexSize += sizeof(vec2ui16);
     if (m.etc.size())
@@ -98,7 +201,12 @@ GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
             spec.attributes[0].components = 3;
             spec.attributes[0].offset = offset;
             spec.attributes[0].stride = vertexSize;
-            offset += sizeof(vec3f);
+            if (quantized)
+            {
+                spec.attributes[0].type = GpuTypeEnum::Short;
+                spec.attributes[0].normalized = true;
+            }
+            offset += positionSize;
         }
 
         if (!m.tc.empty())
@@ -145,24 +253,21 @@ GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
         }
 
         { // positions
-            vec3f *o = (vec3f*)(spec.vertices.data()
-                                + spec.attributes[0].offset);
+            char *o = spec.vertices.data() + spec.attributes[0].offset;
             for (const auto &it : m.vertices)
             {
-                vec3 v = vecFromUblas<vec3>(it);
-                *o = v.cast<float>();
-                o = (vec3f*)((char*)o + vertexSize);
+                position(o, it);
+                o += vertexSize;
             }
         }
 
         if (spec.attributes[2].enable)
         { // external uvs
-            vec2ui16 *o = (vec2ui16*)(spec.vertices.data()
-                                      + spec.attributes[2].offset);
+            char *o = spec.vertices.data() + spec.attributes[2].offset;
             for (const auto &it : m.etc)
             {
-                *o = vec2to2ui16(vecFromUblas<vec2f>(it));
-                o = (vec2ui16*)((char*)o + vertexSize);
+                writeUv(o, it);
+                o += vertexSize;
             }
         }
     }
@@ -184,10 +289,9 @@ GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
             assert((char*)io == spec.indices.dataEnd());
         }
 
-        // vertex data
-        char *ps = spec.vertices.data() + spec.attributes[0].offset;
-        char *is = spec.vertices.data() + spec.attributes[1].offset;
-        char *es = spec.vertices.data() + spec.attributes[2].offset;
+        // map each output vertex onto its source vertex
+        //   so that every output vertex is converted only once
+        std::vector<uint32> sources(spec.verticesCount, 0);
         for (uint32 fi = 0, fc = m.facesTc.size(); fi != fc; fi++)
         {
             for (uint32 vi = 0; vi < 3; vi++)
@@ -196,25 +300,58 @@ GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
                 assert(oi < spec.verticesCount);
                 uint32 ii = m.faces[fi][vi];
                 assert(ii < m.vertices.size());
-                { // position
-                    vec3 v = vecFromUblas<vec3>(m.vertices[ii]);
-                    *(vec3f*)(ps + oi * vertexSize) = v.cast<float>();
-                }
-                { // internal uv
-                    vec2ui16 uv = vec2to2ui16(vecFromUblas<vec2f>(m.tc[oi]));
-                    *(vec2ui16*)(is + oi * vertexSize) = uv;
-                }
-                if (spec.attributes[2].enable)
-                { // external uv
-                    vec2ui16 uv = vec2to2ui16(vecFromUblas<vec2f>(m.etc[ii]));
-                    *(vec2ui16*)(es + oi * vertexSize) = uv;
-                }
+                sources[oi] = ii;
             }
         }
+
+        // vertex data, written sequentially
+        char *o = spec.vertices.data();
+        for (uint32 oi = 0; oi != spec.verticesCount; oi++)
+        {
+            uint32 ii = sources[oi];
+            position(o + spec.attributes[0].offset, m.vertices[ii]);
+            writeUv(o + spec.attributes[1].offset, m.tc[oi]);
+            if (spec.attributes[2].enable)
+                writeUv(o + spec.attributes[2].offset, m.etc[ii]);
+            o += vertexSize;
+        }
+    }
+
+    if (map->options.optimizeMeshes && spec.indicesCount > 0)
+    {
+        OPTICK_EVENT("optimize mesh");
+        uint16 *indices = (uint16*)spec.indices.data();
+        const uint32 before = simulateVertexCache(indices, spec.indicesCount);
+        optimizeVertexCache(indices, spec.indicesCount, spec.verticesCount);
+        optimizeVertexFetch(spec.vertices.data(), vertexSize,
+            spec.verticesCount, indices, spec.indicesCount);
+        const uint32 after = simulateVertexCache(indices, spec.indicesCount);
+        Resources *r = map->resources.get();
+        r->meshesOptimized++;
+        r->meshesOptimizedFaces += spec.indicesCount / 3;
+        r->meshesMissesBefore += before;
+        r->meshesMissesAfter += after;
     }
 
     faces = spec.indicesCount / 3;
 
+    if (map->options.subtileIndexRanges && spec.attributes[2].enable
+        && spec.indicesCount > 0)
+        appendQuarterRanges(spec, quarterOffsets, quarterCounts);
+
+    if (map->options.collisionMeshes && !m.faces.empty())
+    {
+        OPTICK_EVENT("collision mesh");
+        std::vector<vec3f> triangles;
+        triangles.reserve(m.faces.size() * 3);
+        for (const auto &it : m.faces)
+            for (uint32 j = 0; j < 3; j++)
+                triangles.push_back(vecFromUblas<vec3>(
+                    m.vertices[it[j]]).cast<float>());
+        collision = std::make_shared<const CollisionMesh>(
+            std::move(triangles));
+    }
+
 #else // indexed
 
     spec.verticesCount = m.faces.size() * 3;
@@ -288,7 +425,7 @@ GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
 
 void GpuMesh::decode()
 {
-    LOG(info1) << "Decoding (gpu) mesh '" << name << "'";
+    VTS_LOG(info1) << "Decoding (gpu) mesh '" << name << "'";
     OPTICK_EVENT("decode gpu mesh");
     std::shared_ptr<GpuMeshSpec> spec
         = std::make_shared<GpuMeshSpec>(fetch->reply.content);
@@ -303,12 +440,21 @@ void GpuMesh::decode()
     decodeData = std::static_pointer_cast<void>(spec);
 }
 
+uint32 GpuMesh::decodedMemoryCost() const
+{
+    auto spec = std::static_pointer_cast<const GpuMeshSpec>(decodeData);
+    return spec ? sizeof(*spec) + spec->vertices.size()
+        + spec->indices.size() : 0;
+}
+
 void GpuMesh::upload()
 {
-    LOG(info1) << "Uploading (gpu) mesh '" << name << "'";
+    VTS_LOG(info1) << "Uploading (gpu) mesh '" << name << "'";
     auto spec = std::static_pointer_cast<GpuMeshSpec>(decodeData);
     map->callbacks.loadMesh(info, *spec, name);
     info.ramMemoryCost += sizeof(*this);
+    if (collision)
+        info.ramMemoryCost += collision->memoryCost();
 }
 
 FetchTask::ResourceType GpuMesh::resourceType() const
@@ -330,6 +476,45 @@ const mat4 findNormToPhys(const math::Extents3 &extents)
     return tr * sc;
 }
 
+// positions only mesh for physics, in normalized coordinates
+std::shared_ptr<GpuMesh> makeColliderMesh(MapImpl *map,
+    const std::string &name, const vtslibs::vts::SubMesh &m)
+{
+    std::vector<vec3f> positions;
+    positions.reserve(m.vertices.size());
+    for (const auto &it : m.vertices)
+        positions.push_back(vecFromUblas<vec3>(it).cast<float>());
+    std::vector<uint16> indices;
+    indices.reserve(m.faces.size() * 3);
+    for (const auto &it : m.faces)
+        for (uint32 j = 0; j < 3; j++)
+            indices.push_back(it[j]);
+
+    // the normalized coordinates span 2 units
+    //   and the farthest point of a cell is its diagonal away
+    const float cellSize = map->options.colliderSimplification
+        * 2 / std::sqrt(3.0);
+    simplifyVertexClustering(positions, indices, cellSize);
+
+    GpuMeshSpec spec;
+    spec.attributes[0].enable = true;
+    spec.attributes[0].components = 3;
+    spec.attributes[0].stride = sizeof(vec3f);
+    spec.verticesCount = positions.size();
+    spec.vertices.allocate(positions.size() * sizeof(vec3f));
+    memcpy(spec.vertices.data(), positions.data(), spec.vertices.size());
+    spec.indicesCount = indices.size();
+    spec.indices.allocate(indices.size() * sizeof(uint16));
+    memcpy(spec.indices.data(), indices.data(), spec.indices.size());
+
+    auto c = std::make_shared<GpuMesh>(map, name);
+    // owned by the aggregate, same as the render submeshes
+    c->state = Resource::State::errorFatal;
+    c->faces = spec.indicesCount / 3;
+    c->decodeData = std::make_shared<GpuMeshSpec>(std::move(spec));
+    return c;
+}
+
 } // namespace
 
 MeshAggregate::MeshAggregate(MapImpl *map, const std::string &name) :
@@ -338,7 +523,7 @@ MeshAggregate::MeshAggregate(MapImpl *map, const std::string &name) :
 
 void MeshAggregate::decode()
 {
-    LOG(info2) << "Decoding (aggregated) mesh <" << name << ">";
+    VTS_LOG(info2) << "Decoding (aggregated) mesh <" << name << ">";
     OPTICK_EVENT("decode aggregated mesh");
 
     detail::BufferStream w(fetch->reply.content);
@@ -367,6 +552,11 @@ void MeshAggregate::decode()
         part.externalUv = spec.attributes[2].enable;
         part.textureLayer = m.textureLayer ? *m.textureLayer : 0;
         part.surfaceReference = m.surfaceReference;
+        if (map->options.colliderSimplification > 0 && !m.faces.empty())
+        {
+            OPTICK_EVENT("collider mesh");
+            part.collider = makeColliderMesh(map, ss.str() + "#collider", m);
+        }
         submeshes.push_back(part);
 
 #ifndef __EMSCRIPTEN__
@@ -407,21 +597,45 @@ void MeshAggregate::decode()
             }
         }
 #endif // emscripten
+
+        // the source mesh is no longer needed
+        //   release it early to lower the peak memory of the decode
+        meshes[mi].submesh = vtslibs::vts::SubMesh();
+
+        map->resources->decodeYield();
     }
 }
 
+uint32 MeshAggregate::decodedMemoryCost() const
+{
+    // the submeshes hold the decoded data
+    uint32 m = 0;
+    for (const auto &it : submeshes)
+    {
+        m += it.renderable->decodedMemoryCost();
+        if (it.collider)
+            m += it.collider->decodedMemoryCost();
+    }
+    return m;
+}
+
 void MeshAggregate::upload()
 {
-    LOG(info2) << "Uploading (aggregated) mesh <" << name << ">";
+    VTS_LOG(info2) << "Uploading (aggregated) mesh <" << name << ">";
 
     info.ramMemoryCost += sizeof(*this) + submeshes.size() * sizeof(MeshPart);
     for (const auto &it : submeshes)
     {
-        it.renderable->upload();
-        info.gpuMemoryCost += it.renderable->info.gpuMemoryCost;
-        info.ramMemoryCost += it.renderable->info.ramMemoryCost;
-        it.renderable->decodeData.reset();
-        it.renderable->state = Resource::State::ready;
+        for (GpuMesh *m : { it.renderable.get(), it.collider.get() })
+        {
+            if (!m)
+                continue;
+            m->upload();
+            info.gpuMemoryCost += m->info.gpuMemoryCost;
+            info.ramMemoryCost += m->info.ramMemoryCost;
+            m->decodeData.reset();
+            m->state = Resource::State::ready;
+        }
     }
 }
 
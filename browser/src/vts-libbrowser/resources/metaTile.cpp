@@ -127,18 +127,24 @@ void generateMetaNodeBoxes(MetaNode &node, const std::array<vec3, 8> &cornersPhy
         vec3 u = cp[4] + cp[5] + cp[6] + cp[7] - cp[0] - cp[1] - cp[2] - cp[3];
         mat4 t = lookAt(center, center + f, u);
 
-        MetaNode::Obb obb;
-        obb.rotInv = t.inverse();
-        obb.points[0] = inf3();
-        obb.points[1] = -inf3();
-
+        vec3 points[2] = { inf3(), -inf3() };
         for (uint32 i = 0; i < 8; i++)
         {
             vec3 p = vec4to3(vec4(t * vec3to4(cornersPhys[i], 1)), false);
-            obb.points[0] = min(obb.points[0], p);
-            obb.points[1] = max(obb.points[1], p);
+            points[0] = min(points[0], p);
+            points[1] = max(points[1], p);
         }
 
+        // center and axes are transformed back to physical space
+        //   so that the culling does not need to transform the frustum
+        mat4 rotInv = t.inverse();
+        vec3 half = (points[1] - points[0]) * 0.5;
+        MetaNode::Obb obb;
+        obb.center = vec4to3(vec4(rotInv
+            * vec3to4(vec3((points[0] + points[1]) * 0.5), 1)), false);
+        for (uint32 i = 0; i < 3; i++)
+            obb.halfAxes[i] = vec3(rotInv.block<3, 1>(0, i) * half[i]);
+
         node.obb = obb;
     }
 
@@ -154,6 +160,45 @@ void generateMetaNodeBoxes(MetaNode &node, const std::array<vec3, 8> &cornersPhy
     }
 }
 
+// based on the horizon culling in Cesium
+//   the points are scaled so that the occluding ellipsoid becomes unit sphere
+//   the resulting point is hidden by the ellipsoid
+//     only if all of the points are hidden
+void generateMetaNodeHorizon(MetaNode &node, const std::shared_ptr<Mapconfig> &m, const std::shared_ptr<CoordManip> &cnv, const std::string &srs, const vec2 &fl, const vec2 &fu, double height)
+{
+    const vec3 &radii = m->horizonRadii;
+    if (radii[0] <= 0)
+        return;
+
+    // points covering the top of the tile
+    vec3 points[9];
+    vec3 dir = vec3(0, 0, 0);
+    for (uint32 i = 0; i < 9; i++)
+    {
+        vec2 f = vec2(fu - fl).cwiseProduct(vec2(i % 3, i / 3) * 0.5) + fl;
+        points[i] = cnv->convert(vec2to3(f, height), srs, Srs::Physical).cwiseQuotient(radii);
+        dir += points[i];
+    }
+    dir = normalize(dir);
+
+    double magnitude = 0;
+    for (const vec3 &p : points)
+    {
+        double l = length(p);
+        const vec3 n = p / l;
+        const double cosAlpha = dot(n, dir);
+        const double sinAlpha = length(cross(n, dir));
+        l = std::max(l, 1.0);
+        const double cosBeta = 1 / l;
+        const double sinBeta = std::sqrt(l * l - 1) * cosBeta;
+        const double d = cosAlpha * cosBeta - sinAlpha * sinBeta;
+        if (d <= 0)
+            return; // the tile is too large
+        magnitude = std::max(magnitude, 1 / d);
+    }
+    node.horizonScaled = vec3(dir * magnitude);
+}
+
 void generateMetaNodeApplyDisplaySize(MetaNode &node, int displaySize)
 {
     if (node.aabbPhys[1][0] != inf1())
@@ -164,14 +209,16 @@ void generateMetaNodeApplyDisplaySize(MetaNode &node, int displaySize)
     }
 }
 
-MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared_ptr<CoordManip> &cnv, const vtslibs::vts::TileId &id, const vtslibs::vts::MetaNode &meta)
+namespace
+{
+
+// the part of the node that requires the coordinate conversions
+void generateMetaNodeTile(MetaNode &node, std::array<vec3, 8> &cornersPhys, const std::shared_ptr<Mapconfig> &m, const std::shared_ptr<CoordManip> &cnv, const vtslibs::vts::TileId &id, const vtslibs::vts::MetaNode &meta)
 {
-    MetaNode node;
     std::string srs;
     generateMetaNodeInit(node, srs, m, id);
 
-    // corners
-    std::array<vec3, 8> cornersPhys; // oriented trapezoid bounding box corners
+    // corners of oriented trapezoid bounding box
     if (!vtslibs::vts::empty(meta.geomExtents) && !srs.empty())
     {
         const bool projected = m->navigationSrsType() == vtslibs::registry::Srs::Type::projected;
@@ -206,6 +253,9 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared
             sds = vec2to3(fu, double(meta.geomExtents.z.min));
             vec3 vc = cnv->convert(sds, srs, Srs::Physical);
             node.diskHalfAngle = std::acos(dot(node.diskNormalPhys, vc.normalized()));
+
+            // horizon
+            generateMetaNodeHorizon(node, m, cnv, srs, fl, fu, double(meta.geomExtents.z.max));
         }
     }
     else
@@ -215,8 +265,6 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared
         LOG(warn1) << "Tile <" << id << "> has empty geomExtents or no srs";
     }
 
-    generateMetaNodeBoxes(node, cornersPhys);
-
     // surrogate
     if (vtslibs::vts::GeomExtents::validSurrogate(meta.geomExtents.surrogate))
     {
@@ -226,8 +274,11 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared
         node.surrogatePhys = cnv->convert(sds, srs, Srs::Physical);
         node.surrogateNav = cnv->convert(sds, srs, Srs::Navigation)[2];
     }
+}
 
-    // texelSize
+// requires the aabb
+void generateMetaNodeTexelSize(MetaNode &node, const vtslibs::vts::MetaNode &meta)
+{
     if (meta.flags() & vtslibs::vts::MetaNode::Flag::applyTexelSize)
     {
         if (node.aabbPhys[1][0] != inf1())
@@ -237,7 +288,25 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared
     {
         generateMetaNodeApplyDisplaySize(node, meta.displaySize);
     }
+}
 
+const uint32 InvalidPacked = (uint32)-1;
+
+vec3f packedNan()
+{
+    const float n = std::numeric_limits<float>::quiet_NaN();
+    return vec3f(n, n, n);
+}
+
+} // namespace
+
+MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared_ptr<CoordManip> &cnv, const vtslibs::vts::TileId &id, const vtslibs::vts::MetaNode &meta)
+{
+    MetaNode node;
+    std::array<vec3, 8> cornersPhys;
+    generateMetaNodeTile(node, cornersPhys, m, cnv, id, meta);
+    generateMetaNodeBoxes(node, cornersPhys);
+    generateMetaNodeTexelSize(node, meta);
     return node;
 }
 
@@ -280,6 +349,18 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared
     return node;
 }
 
+MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const vtslibs::vts::TileId &id, const vec3 aabbPhys[2], int displaySize)
+{
+    MetaNode node;
+    std::string srs;
+    generateMetaNodeInit(node, srs, m, id);
+    node.aabbPhys[0] = aabbPhys[0];
+    node.aabbPhys[1] = aabbPhys[1];
+    if (displaySize > 0)
+        generateMetaNodeApplyDisplaySize(node, displaySize);
+    return node;
+}
+
 void MetaTile::decode()
 {
     OPTICK_EVENT("decode meta tile");
@@ -296,18 +377,17 @@ void MetaTile::decode()
         *(vtslibs::vts::MetaTile*)this = vtslibs::vts::loadMetaTile(w, m->referenceFrame.metaBinaryOrder, name);
     }
 
-    // precompute metanodes
-    metas.resize(size_ * size_);
-    vtslibs::vts::MetaTile::for_each([&](const vtslibs::vts::TileId &id, vtslibs::vts::MetaNode &node)
+    // the metanodes are derived in getNode
+    vtslibs::vts::MetaTile::for_each([&](const vtslibs::vts::TileId &, vtslibs::vts::MetaNode &node)
         {
-            if (node.flags() == 0)
-                return;
             node.displaySize = 1024; // forced override
-            metas[(id.y - origin_.y) * size_ + id.x - origin_.x] = generateMetaNode(m, m->convertorData, id, node);
         });
+    originPhys = nan3();
+    packedIndices.assign(size_ * size_, InvalidPacked);
+    packed.clear();
 
     info.ramMemoryCost += sizeof(*this);
-    info.ramMemoryCost += size_ * size_ * (sizeof(vtslibs::vts::MetaNode) + sizeof(MetaNode));
+    info.ramMemoryCost += size_ * size_ * (sizeof(vtslibs::vts::MetaNode) + sizeof(uint32));
 }
 
 FetchTask::ResourceType MetaTile::resourceType() const
@@ -318,9 +398,84 @@ FetchTask::ResourceType MetaTile::resourceType() const
 std::shared_ptr<const MetaNode> MetaTile::getNode(const TileId &tileId)
 {
     const auto idx = index(tileId, false);
-    const boost::optional<MetaNode> &mn = metas[idx];
-    assert(mn);
-    return std::shared_ptr<const MetaNode>(shared_from_this(), mn.get_ptr());
+    const vtslibs::vts::MetaNode &meta = get(tileId);
+    assert(meta.flags() != 0);
+    std::shared_ptr<Mapconfig> m = mapconfig.lock();
+    assert(m);
+
+    PackedNode p;
+    vec3 origin;
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(packedMutex);
+        if (packedIndices[idx] != InvalidPacked)
+        {
+            p = packed[packedIndices[idx]];
+            origin = originPhys;
+            found = true;
+        }
+    }
+
+    if (!found)
+    {
+        // the conversions run without holding the lock
+        //   concurrent threads may convert the same node, only one is kept
+        MetaNode n;
+        std::array<vec3, 8> cornersPhys;
+        {
+            std::shared_ptr<CoordManip> cnv = m->acquireConvertor();
+            generateMetaNodeTile(n, cornersPhys, m, cnv, tileId, meta);
+            m->releaseConvertor(std::move(cnv));
+        }
+        std::lock_guard<std::mutex> lock(packedMutex);
+        if (packedIndices[idx] == InvalidPacked)
+        {
+            const auto &pack = [&](const vec3 &v) -> vec3f {
+                if (std::isnan(v[0]))
+                    return packedNan();
+                if (std::isnan(originPhys[0]))
+                    originPhys = v;
+                return vec3(v - originPhys).cast<float>();
+            };
+            PackedNode q;
+            for (uint32 i = 0; i < 8; i++)
+                q.cornersPhys[i] = pack(cornersPhys[i]);
+            q.surrogatePhys = pack(n.surrogatePhys ? *n.surrogatePhys : nan3());
+            q.horizonScaled = n.horizonScaled
+                ? vec3f(n.horizonScaled->cast<float>()) : packedNan();
+            q.diskNormalPhys = n.diskNormalPhys.cast<float>();
+            q.diskHeightsPhys = n.diskHeightsPhys;
+            q.diskHalfAngle = n.diskHalfAngle;
+            q.surrogateNav = n.surrogateNav ? *n.surrogateNav : nan1();
+            packedIndices[idx] = packed.size();
+            packed.push_back(q);
+            // picked up by the incremental memory accounting
+            info.ramMemoryCost += sizeof(PackedNode);
+        }
+        p = packed[packedIndices[idx]];
+        origin = originPhys;
+    }
+
+    // the boxes are derived from the corners only when the node is used
+    auto node = std::make_shared<MetaNode>();
+    std::string srs;
+    generateMetaNodeInit(*node, srs, m, tileId);
+    std::array<vec3, 8> cornersPhys;
+    for (uint32 i = 0; i < 8; i++)
+        cornersPhys[i] = p.cornersPhys[i].cast<double>() + origin;
+    generateMetaNodeBoxes(*node, cornersPhys);
+    generateMetaNodeTexelSize(*node, meta);
+    if (!std::isnan(p.surrogatePhys[0]))
+    {
+        node->surrogatePhys = vec3(p.surrogatePhys.cast<double>() + origin);
+        node->surrogateNav = p.surrogateNav;
+    }
+    if (!std::isnan(p.horizonScaled[0]))
+        node->horizonScaled = vec3(p.horizonScaled.cast<double>());
+    node->diskNormalPhys = p.diskNormalPhys.cast<double>();
+    node->diskHeightsPhys = p.diskHeightsPhys;
+    node->diskHalfAngle = p.diskHalfAngle;
+    return node;
 }
 
 } // namespace vts
@@ -28,11 +28,15 @@
 #include "../resource.hpp"
 #include "../fetchTask.hpp"
 #include "../map.hpp"
+#include "../include/vts-browser/trace.hpp"
+#include "../utilities/logFilter.hpp"
+
+#include <chrono>
 
 namespace vts
 {
 
-FetchTaskImpl::FetchTaskImpl(const std::shared_ptr<Resource> &resource) : FetchTask(resource->name, resource->resourceType()), name(resource->name), map(resource->map), resource(resource)
+FetchTaskImpl::FetchTaskImpl(const std::shared_ptr<Resource> &resource) : FetchTask(resource->fetchUrl(), resource->resourceType()), name(resource->name), map(resource->map), resource(resource)
 {
     reply.expires = -1;
 }
@@ -60,20 +64,114 @@ bool FetchTaskImpl::performAvailTest() const
     return true;
 }
 
-Resource::Resource(vts::MapImpl *map, const std::string &name) : name(name), map(map), priority(nan1())
+namespace
+{
+
+sint64 stateClock()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+Resource::StateHolder::StateHolder(Resource *owner,
+    std::atomic<uint32> *counters)
+    : entered(stateClock()), owner(owner), counters(counters)
+{}
+
+Resource::StateHolder::~StateHolder()
+{
+    const uint32 v = value;
+    if (v & Counted)
+        counters[v & StateMask]--;
+}
+
+void Resource::StateHolder::setCounted(bool counted)
+{
+    uint32 old = value;
+    while (!value.compare_exchange_weak(old,
+        counted ? (old | Counted) : (old & ~Counted)))
+        continue;
+    if (!!(old & Counted) == counted)
+        return;
+    if (counted)
+        counters[old & StateMask]++;
+    else
+        counters[old & StateMask]--;
+}
+
+namespace
+{
+
+// same classification as MapImpl::getResourceValidity
+sint32 stateValidity(Resource::State s)
 {
-    LOG(debug) << "Constructing resource <" << name << "> at <" << this << ">";
+    switch (s)
+    {
+    case Resource::State::ready:
+        return 1;
+    case Resource::State::errorFatal:
+    case Resource::State::availFail:
+        return -1;
+    default:
+        return 0;
+    }
+}
+
+} // namespace
+
+Resource::StateHolder &Resource::StateHolder::operator = (State s)
+{
+    uint32 v = value;
+    while (!value.compare_exchange_weak(v, (v & Counted) | (uint32)s))
+        continue;
+    const State old = (State)(v & StateMask);
+    if (old != s)
+    {
+        if (owner->hasWaiters && stateValidity(old) != stateValidity(s))
+            owner->map->resources->wakeWaiters(owner);
+        if (v & Counted)
+        {
+            counters[(uint32)old]--;
+            counters[(uint32)s]++;
+        }
+        const sint64 now = stateClock();
+        const sint64 prev = entered.exchange(now);
+        owner->map->resources->stateTimed(owner, old, (now - prev) * 1e-6);
+        if (getTraceEnabled())
+            traceAsyncSpan("resource", stateName(old),
+                           owner->name, prev, now);
+    }
+    return *this;
+}
+
+double Resource::StateHolder::elapsed() const
+{
+    return (stateClock() - entered) * 1e-6;
+}
+
+Resource::Resource(vts::MapImpl *map, const std::string &name) : name(name), map(map), state(this, map->resources->stateCounters), priority(nan1())
+{
+    VTS_LOG(debug) << "Constructing resource <" << name << "> at <" << this << ">";
     map->resources->existing++;
 }
 
 Resource::~Resource()
 {
-    LOG(debug) << "Destroying resource <" << name << "> at <" << this << ">";
+    VTS_LOG(debug) << "Destroying resource <" << name << "> at <" << this << ">";
+    assert(!lruLinked);
+    if (hasWaiters)
+        map->resources->removeWaiters(this);
+    if (fetch && state == State::fetching)
+        map->resources->abortFetch(fetch);
     if (info.userData)
     {
         assert(!map->resources->queUpload.stop);
         map->resources->queUpload.push(UploadData(info.userData, 0));
     }
+    if (upgradePending)
+        map->resources->upgradesPending--;
     map->resources->existing--;
 }
 
@@ -99,10 +197,17 @@ bool Resource::allowDiskCache(FetchTask::ResourceType type)
 
 void Resource::updatePriority(float p)
 {
-    if (!std::isnan(priority))
+    auto lock = map->traversalLock();
+    float old = priority;
+    // the highest priority of the current tick replaces the older ones
+    const uint32 tick = map->resources->map->renderTickIndex;
+    if (!std::isnan(priority) && priorityTick == tick)
         priority = std::max(priority, p);
     else
         priority = p;
+    priorityTick = tick;
+    if (priority != old && !(std::isnan(priority) && std::isnan(old)))
+        map->resources->reprioritize(this);
 }
 
 void Resource::updateAvailability(const std::shared_ptr<void> &availTest)
@@ -121,6 +226,42 @@ void Resource::updateAvailability(const std::shared_ptr<void> &availTest)
     }
 }
 
+bool Resources::addWaiter(Resource *r,
+    const std::shared_ptr<std::atomic<bool>> &flag)
+{
+    std::lock_guard<std::mutex> lock(waitersMutex);
+    auto &list = waiters[r];
+    for (const auto &it : list)
+        if (it.lock() == flag)
+            return false;
+    list.push_back(flag);
+    r->hasWaiters = true;
+    return true;
+}
+
+void Resources::wakeWaiters(Resource *r)
+{
+    std::vector<std::weak_ptr<std::atomic<bool>>> list;
+    {
+        std::lock_guard<std::mutex> lock(waitersMutex);
+        auto it = waiters.find(r);
+        if (it == waiters.end())
+            return;
+        list.swap(it->second);
+        waiters.erase(it);
+        r->hasWaiters = false;
+    }
+    for (const auto &it : list)
+        if (auto f = it.lock())
+            *f = true;
+}
+
+void Resources::removeWaiters(Resource *r)
+{
+    std::lock_guard<std::mutex> lock(waitersMutex);
+    waiters.erase(r);
+}
+
 void Resource::forceRedownload()
 {
     retryNumber = 0;
@@ -137,48 +278,41 @@ std::shared_ptr<void> Resource::getUserData() const
     return std::shared_ptr<void>(shared_from_this(), info.userData.get());
 }
 
-std::ostream &operator << (std::ostream &stream, Resource::State state)
+const char *stateName(Resource::State state)
 {
     switch (state)
     {
         case Resource::State::initializing:
-            stream << "initializing";
-            break;
+            return "initializing";
         case Resource::State::cacheReadQueue:
-            stream << "cacheReadQueue";
-            break;
+            return "cacheReadQueue";
         case Resource::State::fetchQueue:
-            stream << "fetchQueue";
-            break;
+            return "fetchQueue";
         case Resource::State::fetching:
-            stream << "fetching";
-            break;
+            return "fetching";
         case Resource::State::decodeQueue:
-            stream << "decodeQueue";
-            break;
+            return "decodeQueue";
         case Resource::State::atmosphereQueue:
-            stream << "atmosphereQueue";
-            break;
+            return "atmosphereQueue";
         case Resource::State::uploadQueue:
-            stream << "uploadQueue";
-            break;
+            return "uploadQueue";
         case Resource::State::ready:
-            stream << "ready";
-            break;
+            return "ready";
         case Resource::State::errorFatal:
-            stream << "errorFatal";
-            break;
+            return "errorFatal";
         case Resource::State::errorRetry:
-            stream << "errorRetry";
-            break;
+            return "errorRetry";
         case Resource::State::availFail:
-            stream << "availFail";
-            break;
+            return "availFail";
         default:
             LOGTHROW(fatal, std::invalid_argument) << "invalid resource state enum";
             throw;
     }
-    return stream;
+}
+
+std::ostream &operator << (std::ostream &stream, Resource::State state)
+{
+    return stream << stateName(state);
 }
 
 uint32 gpuTypeSize(GpuTypeEnum type)
@@ -191,6 +325,8 @@ uint32 gpuTypeSize(GpuTypeEnum type)
     case GpuTypeEnum::Short:
     case GpuTypeEnum::UnsignedShort:
     case GpuTypeEnum::HalfFloat:
+    case GpuTypeEnum::UnsignedShort565:
+    case GpuTypeEnum::UnsignedShort4444:
         return 2;
     case GpuTypeEnum::Int:
     case GpuTypeEnum::UnsignedInt:
@@ -30,7 +30,10 @@
 #include "../map.hpp"
 #include "../authConfig.hpp"
 #include "../resources.hpp"
+#include "../cache.hpp"
 #include "../utilities/dataUrl.hpp"
+#include "../utilities/threadPriority.hpp"
+#include "../utilities/logFilter.hpp"
 
 #include <optick.h>
 
@@ -48,6 +51,16 @@ bool startsWith(const std::string &text, const std::string &start)
     return text.substr(0, start.length()) == start;
 }
 
+// in order of the members of ResourceLatencies
+enum Stage
+{
+    StageCacheRead,
+    StageFetchQueue,
+    StageDecodeQueue,
+    StageDecode,
+    StageUploadQueue,
+};
+
 } // namespace
 
 void Resources::saveCorruptedFile(const std::shared_ptr<Resource> &r)
@@ -59,7 +72,7 @@ void Resources::saveCorruptedFile(const std::shared_ptr<Resource> &r)
     {
         std::string path = std::string() + "corrupted/" + convertNameToPath(r->name, false);
         writeLocalFileBuffer(path, r->fetch->reply.content);
-        LOG(info1) << "Resource <" << r->name << "> saved into file <" << path << "> for further inspection";
+        VTS_LOG(info1) << "Resource <" << r->name << "> saved into file <" << path << "> for further inspection";
     }
     catch (...)
     {
@@ -83,22 +96,76 @@ void UploadData::process()
         r->map->resources->uploadProcess(r);
 }
 
+uint32 UploadData::memoryCost() const
+{
+    auto r = uploadData.lock();
+    return r ? r->pendingMemory.load() : 0;
+}
+
 ////////////////////////////
 // A FETCH THREAD
 ////////////////////////////
 
-CacheData::CacheData(FetchTaskImpl *task, bool availFailed) : buffer(task->reply.content.copy()), name(task->name), expires(task->reply.expires), availFailed(availFailed)
-{}
+namespace
+{
+
+bool compressibleType(FetchTask::ResourceType type)
+{
+    switch (type)
+    {
+    case FetchTask::ResourceType::Texture: // jpeg, png or ktx2
+    case FetchTask::ResourceType::NavTile: // png
+        return false;
+    default:
+        return true;
+    }
+}
+
+} // namespace
+
+CacheData::CacheData(FetchTaskImpl *task, bool availFailed) : buffer(task->reply.content.share()), name(task->name), etag(task->reply.etag), lastModified(task->reply.lastModified), expires(task->reply.expires), availFailed(availFailed)
+{
+    compress = task->map->createOptions.diskCacheCompression
+        && compressibleType(task->query.resourceType);
+}
 
 void FetchTaskImpl::fetchDone()
 {
     OPTICK_EVENT();
-    LOG(debug) << "Resource <" << name << "> finished downloading, " << "http code: " << reply.code << ", content type: <" << reply.contentType << ">, size: " << reply.content.size() << ", expires: " << reply.expires;
+    if (finished.exchange(true))
+    {
+        // the download was cancelled, nobody is interested in the result
+        VTS_LOG(debug) << "Cancelled resource <" << name << "> finished downloading";
+        reply.content.free();
+        return;
+    }
+    VTS_LOG(debug) << "Resource <" << name << "> finished downloading, " << "http code: " << reply.code << ", content type: <" << reply.contentType << ">, size: " << reply.content.size() << ", expires: " << reply.expires;
     assert(map);
-    map->resources->downloads--;
-    map->resources->queFetching.con.notify_one();
+    map->resources->downloadFinished(this, false);
     Resource::State state = Resource::State::fetching;
 
+    // the expired cached content is still valid
+    if (reply.code == 304 && (!staleEtag.empty() || !staleLastModified.empty()))
+    {
+        VTS_LOG(debug) << "Resource <" << name << "> revalidated";
+        reply.content = std::move(staleContent);
+        if (reply.etag.empty())
+            reply.etag = staleEtag;
+        if (reply.lastModified.empty())
+            reply.lastModified = staleLastModified;
+        reply.code = 200;
+        map->resources->revalidated++;
+    }
+    if (reply.code < 300 || reply.code >= 400)
+    {
+        // keep the conditional request for redirections
+        staleContent.free();
+        staleEtag.clear();
+        staleLastModified.clear();
+        query.headers.erase("If-None-Match");
+        query.headers.erase("If-Modified-Since");
+    }
+
     // handle error or invalid codes
     if (reply.code >= 400 || reply.code < 200)
     {
@@ -119,7 +186,7 @@ void FetchTaskImpl::fetchDone()
     // availability tests
     if (state == Resource::State::fetching && !performAvailTest())
     {
-        LOG(info1) << "Resource <" << name << "> failed availability test";
+        VTS_LOG(info1) << "Resource <" << name << "> failed availability test";
         state = Resource::State::availFail;
     }
 
@@ -134,16 +201,31 @@ void FetchTaskImpl::fetchDone()
         else
         {
             query.url.swap(reply.redirectUrl);
-            LOG(info1) << "Download of <" << name << "> redirected to <" << query.url << ">, http code " << reply.code;
+            VTS_LOG(info1) << "Download of <" << name << "> redirected to <" << query.url << ">, http code " << reply.code;
             reply = Reply();
             state = Resource::State::initializing;
         }
     }
 
     // write to cache
-    if ((state == Resource::State::availFail || state == Resource::State::fetching) && map->resources->queCacheWrite.estimateSize() < map->options.maxCacheWriteQueueLength)
+    if ((state == Resource::State::availFail || state == Resource::State::fetching) && map->options.cacheWriteBackpressure)
+    {
+#ifndef __EMSCRIPTEN__
+        // slow down the downloads instead of dropping the write
+        Resources *rs = map->resources.get();
+        auto &q = rs->queCacheWrite;
+        std::unique_lock<std::mutex> lock(rs->cacheWriteSpaceMutex);
+        rs->cacheWriteSpace.wait(lock, [&]() {
+            return q.estimateSize() < map->options.maxCacheWriteQueueLength
+                || q.stop;
+        });
+#endif // !__EMSCRIPTEN__
+    }
+    if ((state == Resource::State::availFail || state == Resource::State::fetching)
+        && (map->options.cacheWriteBackpressure
+            || map->resources->queCacheWrite.estimateSize() < map->options.maxCacheWriteQueueLength))
     {
-        // this makes copy of the content buffer
+        // the content is shared with the decode queue, nothing is copied
         map->resources->queCacheWrite.push(CacheData(this,
             state == Resource::State::availFail));
     }
@@ -180,29 +262,106 @@ void FetchTaskImpl::fetchDone()
 // DECODE THREAD
 ////////////////////////////
 
+namespace
+{
+
+// the decode running on this thread
+struct DecodeSlice
+{
+    Resource *current = nullptr;
+    std::chrono::steady_clock::time_point start;
+    uint32 depth = 0;
+};
+
+thread_local DecodeSlice decodeSlice;
+
+} // namespace
+
+void Resources::decodeYield()
+{
+    DecodeSlice &s = decodeSlice;
+    if (!s.current || s.depth != 1)
+        return;
+    const double slice = map->options.decodeTimeSlice;
+    if (!(slice > 0))
+        return;
+    const auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double, std::milli>(now - s.start).count()
+        < slice)
+        return;
+    OPTICK_EVENT("decodeYield");
+    Resource *current = s.current;
+    std::weak_ptr<Resource> w;
+    while (queDecode.tryPopAbove(current->priority, w))
+    {
+        decodePreempted++;
+        oneDecode(std::move(w));
+        w.reset();
+    }
+    s.current = current;
+    s.start = std::chrono::steady_clock::now();
+}
+
 void Resources::decodeProcess(const std::shared_ptr<Resource> &r)
 {
-    assert(r->state == Resource::State::decodeQueue);
-    map->statistics.resourcesDecoded++;
-    r->info.gpuMemoryCost = r->info.ramMemoryCost = 0;
+    // this may run on multiple decode threads concurrently
+    // a ready resource is decoded again to upgrade its quality
+    const bool upgrade = r->state == Resource::State::ready;
+    assert(r->state == Resource::State::decodeQueue || upgrade);
+    if (!upgrade)
+    {
+        decoded++;
+        r->info.gpuMemoryCost = r->info.ramMemoryCost = 0;
+        stageTimed(r.get(), StageDecodeQueue, r->state.elapsed());
+    }
+    const DecodeSlice previous = decodeSlice;
+    decodeSlice.current = r.get();
+    decodeSlice.start = std::chrono::steady_clock::now();
+    decodeSlice.depth = previous.depth + 1;
     try
     {
+        const auto start = decodeSlice.start;
         r->decode();
-        if (r->requiresUpload())
+        r->pendingMemory = r->decodedMemoryCost();
+        if (!upgrade)
         {
-            r->state = Resource::State::uploadQueue;
-            queUpload.push(UploadData(r));
+            stageTimed(r.get(), StageDecode,
+                std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count());
         }
+        if (upgrade)
+            queUpload.push(UploadData(r));
         else
-            r->state = Resource::State::ready;
+        {
+            if (r->upgradePending)
+                upgradesPending++;
+            if (r->requiresUpload())
+            {
+                r->state = Resource::State::uploadQueue;
+                queUpload.push(UploadData(r));
+            }
+            else
+                r->state = Resource::State::ready;
+        }
     }
     catch (const std::exception &e)
     {
-        LOG(err3) << "Failed decoding resource <" << r->name << ">, exception <" << e.what() << ">";
-        saveCorruptedFile(r);
-        map->statistics.resourcesFailed++;
-        r->state = Resource::State::errorFatal;
+        if (upgrade)
+        {
+            // keep the reduced quality
+            LOG(err3) << "Failed upgrading resource <" << r->name << ">, exception <" << e.what() << ">";
+            r->upgradePending = false;
+            upgradesPending--;
+        }
+        else
+        {
+            LOG(err3) << "Failed decoding resource <" << r->name << ">, exception <" << e.what() << ">";
+            saveCorruptedFile(r);
+            decodeFailed++;
+            r->state = Resource::State::errorFatal;
+        }
     }
+    decodeSlice = previous;
     r->fetch.reset();
 }
 
@@ -222,50 +381,210 @@ float Resources::priority(const std::weak_ptr<Resource> &w)
     return inf1();
 }
 
+namespace
+{
+
+// urgency as defined by RFC 9218, 0 is the most urgent, 7 the least
+// the traversal priority is inversely proportional to the distance
+//   from the camera, each order of magnitude lowers the urgency
+uint32 httpUrgency(float priority)
+{
+    if (std::isinf(priority) && priority > 0)
+        return 0;
+    if (std::isnan(priority) || priority <= 0)
+        return 7;
+    float l = std::log10(priority + 1);
+    return (uint32)std::max(7.f - std::floor(l), 1.f);
+}
+
+} // namespace
+
+void Resources::reprioritize(Resource *r)
+{
+    switch ((Resource::State)r->state)
+    {
+    case Resource::State::fetching:
+    {
+        auto f = r->fetch;
+        uint32 u = httpUrgency(r->priority);
+        if (f && f->urgency.exchange(u) != u)
+            map->fetcher->updatePriority(f, r->priority);
+    } break;
+    case Resource::State::cacheReadQueue:
+        queCacheRead.update(r, r->priority);
+        break;
+    case Resource::State::fetchQueue:
+        queFetching.update(r, r->priority);
+        break;
+    case Resource::State::decodeQueue:
+        queDecode.update(r, r->priority);
+        break;
+    case Resource::State::ready:
+        if (r->upgradePending)
+            queDecode.update(r, r->priority);
+        break;
+    default:
+        break;
+    }
+}
+
+std::shared_ptr<void> Resources::dedupFind(uint64 hash, uint32 size,
+    uint32 &width, uint32 &height)
+{
+    std::lock_guard<std::mutex> lock(dedupMutex);
+    auto it = dedupEntries.find(hash);
+    if (it == dedupEntries.end() || it->second.size != size)
+        return {};
+    std::shared_ptr<void> u = it->second.userData.lock();
+    if (!u)
+    {
+        dedupEntries.erase(it);
+        return {};
+    }
+    width = it->second.width;
+    height = it->second.height;
+    deduplicated++;
+    return u;
+}
+
 ////////////////////////////
 // DATA THREAD
 ////////////////////////////
 
-void Resources::oneUpload(UploadData r)
+void Resources::dedupInsert(uint64 hash, DedupEntry &&entry)
 {
-    r.process();
+    std::lock_guard<std::mutex> lock(dedupMutex);
+    dedupEntries[hash] = std::move(entry);
+    if (dedupEntries.size() > dedupSweepThreshold)
+    {
+        for (auto it = dedupEntries.begin(); it != dedupEntries.end();)
+        {
+            if (it->second.userData.expired())
+                it = dedupEntries.erase(it);
+            else
+                it++;
+        }
+        dedupSweepThreshold = std::max<uint32>(256,
+            dedupEntries.size() * 2);
+    }
 }
 
 void Resources::uploadProcess(const std::shared_ptr<Resource> &r)
 {
-    assert(r->state == Resource::State::uploadQueue);
-    map->statistics.resourcesUploaded++;
+    const bool upgrade = r->state == Resource::State::ready;
+    assert(r->state == Resource::State::uploadQueue || upgrade);
+    if (!r->uploadRemaining())
+        map->statistics.resourcesUploaded++;
     try
     {
         r->upload();
-        r->state = Resource::State::ready;
+        if (r->uploadRemaining())
+        {
+            // queued again behind the uploads waiting already
+            //   several data threads may be draining the queue
+            queUpload.push(UploadData(r));
+            return;
+        }
+        if (upgrade)
+        {
+            // put into use on the render thread
+            std::lock_guard<std::mutex> lock(upgradesMutex);
+            upgrades.push_back(r);
+        }
+        else
+        {
+            r->state = Resource::State::ready;
+            // the full quality is decoded in order of the priority
+            if (r->upgradePending)
+                queDecode.push(r);
+        }
     }
     catch (const std::exception &e)
     {
-        LOG(err3) << "Failed uploading resource <" << r->name << ">, exception <" << e.what() << ">";
-        saveCorruptedFile(r);
-        map->statistics.resourcesFailed++;
-        r->state = Resource::State::errorFatal;
+        if (upgrade)
+        {
+            LOG(err3) << "Failed upgrading resource <" << r->name << ">, exception <" << e.what() << ">";
+            r->upgradePending = false;
+            upgradesPending--;
+        }
+        else
+        {
+            LOG(err3) << "Failed uploading resource <" << r->name << ">, exception <" << e.what() << ">";
+            saveCorruptedFile(r);
+            map->statistics.resourcesFailed++;
+            r->state = Resource::State::errorFatal;
+        }
     }
     r->decodeData.reset();
+    r->pendingMemory = 0;
 }
 
-void Resources::dataUpdate()
+uint32 Resources::drainUploads(uint32 maxItems)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const uint32 cnt = queUpload.drain(maxItems);
+    if (cnt)
+        uploadDuration += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    return cnt;
+}
+
+uint32 Resources::drainUploadsBudget(double budgetMs)
 {
     OPTICK_EVENT();
-    for (uint32 proc = 0; proc < map->options.maxResourceProcessesPerTick; proc++)
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    const uint64 budget = uint64(budgetMs * 1e6);
+    uint32 cnt = 0;
+    UploadData item;
+    while (queUpload.pop(item))
     {
-        if (!queUpload.runOne())
-            return;
+        const uint64 elapsed = std::chrono::duration_cast<
+            std::chrono::nanoseconds>(Clock::now() - start).count();
+        const uint32 bytes = item.memoryCost();
+        // at least one upload per call guarantees progress
+        if (cnt > 0 && elapsed + uint64(bytes * uploadNsPerByte) > budget)
+        {
+            // keeps its place ahead of the uploads queued meanwhile
+            queUpload.pushFront(std::move(item));
+            uploadsDeferred++;
+            break;
+        }
+        const auto itemStart = Clock::now();
+        item.process();
+        item = UploadData();
+        cnt++;
+        // small uploads are dominated by the per call overhead
+        if (bytes >= 64 * 1024)
+        {
+            const double ns = std::chrono::duration_cast<
+                std::chrono::nanoseconds>(Clock::now() - itemStart).count();
+            // updates from concurrent data threads may override each other
+            //   which is fine for the estimate
+            uploadNsPerByte = uploadNsPerByte.load() * 0.8 + ns / bytes * 0.2;
+        }
     }
+    if (cnt)
+        uploadDuration += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - start).count();
+    return cnt;
+}
+
+void Resources::dataUpdate()
+{
+    OPTICK_EVENT();
+    if (map->options.dataUpdateBudget > 0)
+        drainUploadsBudget(map->options.dataUpdateBudget);
+    else
+        drainUploads(map->options.maxResourceProcessesPerTick);
 }
 
 void Resources::dataFinalize()
 {
-    while (!queUpload.q.empty() || existing > 0)
+    while (!queUpload.empty() || existing > 0)
     {
-        while (!queUpload.q.empty())
-            queUpload.runOne();
+        while (drainUploads((uint32)-1) > 0)
+            continue;
         if (existing > 0)
         {
             using namespace std::chrono_literals;
@@ -281,13 +600,9 @@ void Resources::dataAllRun()
 
     while (!renderFinalizeCalled)
     {
-        {
-            std::unique_lock<std::mutex> lock(queUpload.mut);
-            while (queUpload.q.empty() && !renderFinalizeCalled)
-                queUpload.con.wait(lock);
-        }
+        queUpload.wait(renderFinalizeCalled);
         if (!renderFinalizeCalled)
-            queUpload.runOne();
+            dataUpdate();
     }
 
     dataFinalize();
@@ -297,10 +612,44 @@ void Resources::dataAllRun()
 // CACHE WRITE THREAD
 ////////////////////////////
 
+namespace
+{
+
+// the queued writes are combined into batches of up to this size
+static const uint32 MaxCacheWriteBatchItems = 64;
+static const uint64 MaxCacheWriteBatchBytes = 4 * 1024 * 1024;
+
+} // namespace
+
+void Resources::cacheWriteSpaceFreed()
+{
+    // taking the mutex orders this with the predicate check of the waiters
+    {
+        std::lock_guard<std::mutex> lock(cacheWriteSpaceMutex);
+    }
+    cacheWriteSpace.notify_all();
+}
+
 void Resources::oneCacheWrite(CacheData r)
 {
-    if (!r.name.empty())
-        cacheWrite(std::move(r));
+    std::vector<CacheData> batch;
+    uint64 bytes = 0;
+    const auto add = [&](CacheData &&cd) {
+        if (cd.name.empty())
+            return;
+        bytes += cd.buffer.size();
+        batch.push_back(std::move(cd));
+    };
+    add(std::move(r));
+    CacheData next;
+    while (batch.size() < MaxCacheWriteBatchItems
+        && bytes < MaxCacheWriteBatchBytes
+        && queCacheWrite.tryPop(next))
+        add(std::move(next));
+    cacheWriteSpaceFreed();
+    if (!batch.empty())
+        cacheWrite(batch);
+    map->cache->maintenance();
 }
 
 ////////////////////////////
@@ -318,21 +667,49 @@ void Resources::oneCacheRead(std::weak_ptr<Resource> w)
     }
     catch (const std::exception &)
     {
-        LOG(debug) << "Reading <" << r->name << "> from cache has failed, initializing fetch instead";
+        VTS_LOG(debug) << "Reading <" << r->name << "> from cache has failed, initializing fetch instead";
         r->state = Resource::State::fetchQueue;
         r->map->resources->queFetching.push(r);
     }
 }
 
+namespace
+{
+
+void prepareFetch(const std::shared_ptr<Resource> &r)
+{
+    if (!r->fetch || r->fetch->cancelled)
+    {
+        // the cancelled task may still be held by the fetcher
+        auto f = std::make_shared<FetchTaskImpl>(r);
+        if (r->fetch)
+            f->availTest = r->fetch->availTest;
+        r->fetch = f;
+    }
+    r->info.gpuMemoryCost = r->info.ramMemoryCost = 0;
+}
+
+// resources with these schemes are resolved on the cache read thread
+bool localScheme(const std::string &name)
+{
+    return startsWith(name, "data:")
+        || startsWith(name, "file://")
+        || startsWith(name, "internal://")
+        || startsWith(name, "atmdensity://");
+}
+
+} // namespace
+
 void Resources::cacheReadProcess(const std::shared_ptr<Resource> &r)
 {
     OPTICK_EVENT("cacheReadProcess");
     assert(r->state == Resource::State::cacheReadQueue);
-    if (!r->fetch)
-        r->fetch = std::make_shared<FetchTaskImpl>(r);
-    r->info.gpuMemoryCost = r->info.ramMemoryCost = 0;
-    CacheData cd;
-    if (r->allowDiskCache() && (cd = cacheRead(r->name)).name == r->name)
+    prepareFetch(r);
+    // local resources are never stored in the disk cache
+    CacheData cd = localScheme(r->name) ? CacheData() : cacheRead(r->name);
+    if (cd.name != r->name)
+        cd = CacheData();
+    if (!cd.name.empty() && !cd.stale && r->allowDiskCache())
     {
         r->fetch->reply.expires = cd.expires;
         r->fetch->reply.content = std::move(cd.buffer);
@@ -344,25 +721,27 @@ void Resources::cacheReadProcess(const std::shared_ptr<Resource> &r)
             r->state = Resource::State::decodeQueue;
             queDecode.push(r);
         }
-        map->statistics.resourcesDiskLoaded++;
+        diskLoaded++;
     }
     else if (startsWith(r->name, "data:"))
     {
-        readDataUrl(r->name, r->fetch->reply.content, r->fetch->reply.contentType);
+        readDataUrl(r->fetchUrl(), r->fetch->reply.content, r->fetch->reply.contentType);
         r->fetch->reply.code = 200;
         r->state = Resource::State::decodeQueue;
         queDecode.push(r);
     }
     else if (startsWith(r->name, "file://"))
     {
-        r->fetch->reply.content = readLocalFileBuffer(r->name.substr(7));
+        const std::string path = r->fetchUrl().substr(7);
+        r->fetch->reply.content = map->createOptions.mapLocalFiles
+            ? mapLocalFileBuffer(path) : readLocalFileBuffer(path);
         r->fetch->reply.code = 200;
         r->state = Resource::State::decodeQueue;
         queDecode.push(r);
     }
     else if (startsWith(r->name, "internal://"))
     {
-        r->fetch->reply.content = readInternalMemoryBuffer(r->name.substr(11));
+        r->fetch->reply.content = shareInternalMemoryBuffer(r->fetchUrl().substr(11));
         r->fetch->reply.code = 200;
         r->state = Resource::State::decodeQueue;
         queDecode.push(r);
@@ -374,6 +753,18 @@ void Resources::cacheReadProcess(const std::shared_ptr<Resource> &r)
     }
     else
     {
+        if (!cd.name.empty() && cd.stale)
+        {
+            // conditional request, the content is reused on 304
+            FetchTaskImpl *f = r->fetch.get();
+            f->staleContent = std::move(cd.buffer);
+            f->staleEtag = cd.etag;
+            f->staleLastModified = cd.lastModified;
+            if (!cd.etag.empty())
+                f->query.headers["If-None-Match"] = cd.etag;
+            if (!cd.lastModified.empty())
+                f->query.headers["If-Modified-Since"] = cd.lastModified;
+        }
         r->state = Resource::State::fetchQueue;
         queFetching.push(r);
     }
@@ -388,22 +779,151 @@ void Resources::oneFetch(std::weak_ptr<Resource> w)
     std::shared_ptr<Resource> r = w.lock();
     if (!r)
         return;
+    const std::shared_ptr<FetchTaskImpl> f = r->fetch;
+    f->host = DownloadControl::hostOf(f->query.url);
+    if (!downloadControl.acquire(f->host, w))
+        return; // postponed, the host is busy
+    f->finished = false;
+    f->fetchStart = std::chrono::steady_clock::now();
+    f->query.priority = r->priority;
+    f->urgency = httpUrgency(r->priority);
+    f->query.headers["Priority"] = std::string() + "u=" + std::to_string((uint32)f->urgency);
     r->state = Resource::State::fetching;
     r->map->resources->downloads++;
-    LOG(debug) << "Initializing fetch of <" << r->name << ">";
-    r->fetch->query.headers["X-Vts-Client-Id"] = r->map->createOptions.clientId;
+    VTS_LOG(debug) << "Initializing fetch of <" << r->name << ">";
+    f->query.headers["X-Vts-Client-Id"] = r->map->createOptions.clientId;
     if (r->map->auth)
         r->map->auth->authorize(r);
-    r->map->fetcher->fetch(r->fetch);
+    r->map->fetcher->fetch(f);
     r->map->statistics.resourcesDownloaded++;
 }
 
+namespace
+{
+
+uint32 histogramBin(double ms)
+{
+    uint32 bin = 0;
+    while (bin + 1 < DownloadTimings::Bins && ms >= (1u << bin))
+        bin++;
+    return bin;
+}
+
+void histogramAdd(uint32 (&h)[DownloadTimings::Bins], double ms)
+{
+    if (ms < 0)
+        return; // unknown
+    h[histogramBin(ms)]++;
+}
+
+} // namespace
+
+void Resources::downloadTimed(const FetchTaskImpl *f, double durationMs)
+{
+    const FetchTask::Reply &r = f->reply;
+    uint32 type = (uint32)f->query.resourceType;
+    std::lock_guard<std::mutex> lock(downloadTimingsMutex);
+    if (downloadTimings.size() <= type)
+        downloadTimings.resize(type + 1);
+    DownloadTimings &t = downloadTimings[type];
+    t.count++;
+    t.bytes += r.content.size();
+    histogramAdd(t.total, durationMs);
+    histogramAdd(t.dns, r.timeDns);
+    histogramAdd(t.connect, r.timeConnect);
+    histogramAdd(t.tls, r.timeTls);
+    histogramAdd(t.firstByte, r.timeFirstByte);
+    histogramAdd(t.transfer, r.timeTransfer);
+    if (!r.httpVersion.empty())
+        t.httpVersions[r.httpVersion]++;
+}
+
+void Resources::stateTimed(const Resource *r, Resource::State state,
+    double durationMs)
+{
+    switch (state)
+    {
+    case Resource::State::cacheReadQueue:
+        stageTimed(r, StageCacheRead, durationMs);
+        break;
+    case Resource::State::fetchQueue:
+        stageTimed(r, StageFetchQueue, durationMs);
+        break;
+    case Resource::State::uploadQueue:
+        stageTimed(r, StageUploadQueue, durationMs);
+        break;
+    default:
+        // the decode queue is timed separately in decodeProcess
+        break;
+    }
+}
+
+void Resources::stageTimed(const Resource *r, uint32 stage, double durationMs)
+{
+    const uint32 type = (uint32)r->resourceType();
+    assert(type < ResourceTypesCount && stage < StagesCount);
+    stageHistograms[type][stage][histogramBin(durationMs)]++;
+}
+
+void Resources::downloadFinished(FetchTaskImpl *f, bool cancelled)
+{
+    double duration = -1;
+    if (!cancelled)
+    {
+        duration = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - f->fetchStart).count();
+        downloadTimed(f, duration);
+    }
+    std::vector<std::weak_ptr<Resource>> wake;
+    downloadControl.release(f->host, duration, f->reply.code, wake);
+    downloads--;
+    for (auto &it : wake)
+        queFetching.push(std::move(it));
+    {
+        // synchronize with the fetcher thread evaluating its wait condition
+        std::lock_guard<std::mutex> lock(queFetching.mut);
+    }
+    queFetching.con.notify_one();
+}
+
+void Resources::workerThreadInit(int role)
+{
+    const MapCreateOptions &o = map->createOptions;
+    switch (role)
+    {
+    case 0: // fetcher
+    case 1: // cacheRead
+    case 2: // cacheWrite
+        setThreadPriority(o.ioThreadsPriority, o.ioThreadsAffinity);
+        break;
+    default: // decode, atmosphere
+        setThreadPriority(o.decodeThreadsPriority, o.decodeThreadsAffinity);
+        break;
+    }
+}
+
 void Resources::fetcherProcessorEntry()
 {
     OPTICK_THREAD("fetcher");
     setLogThreadName("fetcher");
+    workerThreadInit(0);
     map->fetcher->initialize();
 
+    const auto &canFetch = [this]() {
+        uint32 limit = map->options.maxAdaptiveDownloads
+            ? map->options.maxAdaptiveDownloads
+            : map->options.maxConcurrentDownloads;
+        if (map->options.lowPowerMode)
+            limit = std::max(limit / 2, 1u);
+        return downloads < limit;
+    };
+
+    // the windows of all hosts are reset on reconfiguration
+    uint32 configuredInitial = 0, configuredMaximum = 0;
+    uint32 configuredFailures = 0;
+    double configuredBackoff[2] = {};
+    bool configured = false;
+
     while (!queFetching.stop)
     {
         {
@@ -411,12 +931,16 @@ void Resources::fetcherProcessorEntry()
             map->fetcher->update();
         }
 
-        if (!(downloads < map->options.maxConcurrentDownloads && queFetching.runOne()))
-        {
-            using namespace std::chrono_literals;
-            std::unique_lock<std::mutex> lock(queFetching.mut);
-            queFetching.con.wait_for(lock, 10ms);
-        }
+        if (canFetch() && queFetching.runOne())
+            continue;
+
+        // sleep until a new resource is queued or a download finishes
+        OPTICK_EVENT("wait");
+        std::unique_lock<std::mutex> lock(queFetching.mut);
+        queFetching.con.wait(lock, [&]() {
+            return queFetching.stop
+                || (!queFetching.q.empty() && canFetch());
+        });
     }
 
     map->fetcher->finalize();
@@ -426,19 +950,181 @@ void Resources::fetcherProcessorEntry()
 // MAIN THREAD
 ////////////////////////////
 
-Resources::Resources(MapImpl *map) : queFetching(this), queCacheRead(this), queCacheWrite(this), queDecode(this), queAtmosphere(this), queUpload(this), map(map)
+Resources::Resources(MapImpl *map) : queFetching(this), queCacheRead(this), queCacheWrite(this), queDecode(this), queAtmosphere(this), map(map)
 {
     cacheInit();
     queFetching.thr = std::thread(&Resources::fetcherProcessorEntry, this);
+    if (const auto &e = map->createOptions.executor)
+    {
+        queCacheRead.useExecutor(e, Executor::Affinity::Io);
+        queCacheWrite.useExecutor(e, Executor::Affinity::Io);
+        queDecode.useExecutor(e, Executor::Affinity::Compute);
+        queAtmosphere.useExecutor(e, Executor::Affinity::Compute);
+        return;
+    }
+    // the workers are spawned only now that the map is accessible to them
+    queCacheRead.addWorkers(std::max(map->createOptions.cacheReadThreads, 1u));
+    queCacheWrite.addWorkers(1);
+    queDecode.addWorkers(std::max(map->createOptions.decodeThreads, 1u));
+    queAtmosphere.addWorkers(1);
 }
 
 Resources::~Resources()
 {}
 
+namespace
+{
+
+// maximum number of resources examined by one step of the sweep
+static const uint32 MaxSweptResources = 1000;
+
+// maximum number of resources considered for eviction in one step
+static const uint32 MaxEvictionCandidates = 1000;
+
+bool isUnconditionalRemove(Resource::State state)
+{
+    switch (state)
+    {
+    case Resource::State::initializing:
+    case Resource::State::errorFatal:
+    case Resource::State::errorRetry:
+    case Resource::State::availFail:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// resources with low priority that were not used for long time go first
+float evictionScore(const Resource *r, uint32 tick)
+{
+    float p = std::isnan(r->priority) ? 0.f : std::max(r->priority, 0.f);
+    return p / (tick - r->lastAccessTick + 1);
+}
+
+} // namespace
+
+void Resources::touch(Resource *r)
+{
+    // unmanaged resources are released by their owners at any time
+    //   they must never be reachable from the list
+    if (!r->managed)
+        return;
+    if (r->lruLinked)
+        lruUnlink(r);
+    lruInsertAfter(r, lruTail);
+    accountMemory(r);
+}
+
+void Resources::accountMemory(Resource *r)
+{
+    unaccountMemory(r);
+    // decoded data waiting for upload is not yet included in the info
+    r->accountedRamMemory = r->info.ramMemoryCost + r->pendingMemory;
+    r->accountedGpuMemory = r->info.gpuMemoryCost;
+    r->accountedState = r->state;
+    memRamUse += r->accountedRamMemory;
+    memGpuUse += r->accountedGpuMemory;
+    memTypeUse[(uint32)r->resourceType()]
+        += r->accountedRamMemory + r->accountedGpuMemory;
+    memStateUse[(uint32)r->accountedState]
+        += r->accountedRamMemory + r->accountedGpuMemory;
+}
+
+void Resources::unaccountMemory(Resource *r)
+{
+    memRamUse -= r->accountedRamMemory;
+    memGpuUse -= r->accountedGpuMemory;
+    memTypeUse[(uint32)r->resourceType()]
+        -= r->accountedRamMemory + r->accountedGpuMemory;
+    memStateUse[(uint32)r->accountedState]
+        -= r->accountedRamMemory + r->accountedGpuMemory;
+    r->accountedRamMemory = 0;
+    r->accountedGpuMemory = 0;
+}
+
+void Resources::lruUnlink(Resource *r)
+{
+    assert(r->lruLinked);
+    if (lruSweep == r)
+        lruSweep = r->lruNext;
+    if (lruEvict == r)
+        lruEvict = r->lruNext;
+    if (r->lruPrev)
+        r->lruPrev->lruNext = r->lruNext;
+    else
+        lruHead = r->lruNext;
+    if (r->lruNext)
+        r->lruNext->lruPrev = r->lruPrev;
+    else
+        lruTail = r->lruPrev;
+    r->lruPrev = r->lruNext = nullptr;
+    r->lruLinked = false;
+}
+
+void Resources::lruInsertAfter(Resource *r, Resource *prev)
+{
+    assert(!r->lruLinked);
+    r->lruPrev = prev;
+    r->lruNext = prev ? prev->lruNext : lruHead;
+    if (r->lruPrev)
+        r->lruPrev->lruNext = r;
+    else
+        lruHead = r;
+    if (r->lruNext)
+        r->lruNext->lruPrev = r;
+    else
+        lruTail = r;
+    r->lruLinked = true;
+}
+
+bool Resources::abortFetch(const std::shared_ptr<FetchTaskImpl> &f)
+{
+    if (f->finished.exchange(true))
+        return false; // the download has finished already
+    f->cancelled = true;
+    VTS_LOG(debug) << "Cancelling download of <" << f->name << ">";
+    downloadFinished(f.get(), true);
+    map->fetcher->cancel(f);
+    fetchesCancelled++;
+    return true;
+}
+
+bool Resources::cancelFetch(Resource *r)
+{
+    if (r->state != Resource::State::fetching || !r->fetch)
+        return false;
+    if (!abortFetch(r->fetch))
+        return false;
+    r->info.gpuMemoryCost = r->info.ramMemoryCost = 0;
+    r->state = Resource::State::initializing;
+    return true;
+}
+
+bool Resources::tryRemove(Resource *r)
+{
+    auto it = resources.find(r->name);
+    if (it == resources.end() || it->second.get() != r)
+    {
+        // resource that is no longer managed
+        unaccountMemory(r);
+        lruUnlink(r);
+        return false;
+    }
+    return tryRemove(it->second);
+}
+
 bool Resources::tryRemove(std::shared_ptr<Resource> &r)
 {
     const std::string name = r->name;
     assert(resources.count(name) == 1);
+    // the resource may be destroyed in here
+    //   so it must be unlinked beforehand
+    Resource *prev = r->lruPrev;
+    const bool linked = r->lruLinked;
+    unaccountMemory(r.get());
+    if (linked)
+        lruUnlink(r.get());
     {
         // release the pointer if we are the last one holding it
         std::weak_ptr<Resource> w = r;
@@ -458,100 +1144,274 @@ bool Resources::tryRemove(std::shared_ptr<Resource> &r)
     }
     if (!r)
     {
-        LOG(info1) << "Released resource <" << name << ">";
+        VTS_LOG(info1) << "Released resource <" << name << ">";
         resources.erase(name);
         map->statistics.resourcesReleased++;
         return true;
     }
+    accountMemory(r.get());
+    if (linked)
+        lruInsertAfter(r.get(), prev);
     return false;
 }
 
-void Resources::removeOld()
+void Resources::shedQueues()
 {
+    const uint32 limit = map->options.queueShedThreshold;
+    if (limit == 0)
+        return;
     OPTICK_EVENT();
-    struct Res
-    {
-        const std::string *n; // name
-        uint32 m; // memory used
-        uint32 a; // lastAccessTick
-        Res(const std::string *n, uint32 m, uint32 a) : n(n), m(m), a(a)
-        {}
+    const uint32 tick = map->renderTickIndex;
+    // resources that are still accessed by the traversal are kept
+    //   they would be queued again right away
+    const auto filter = [&](const std::weak_ptr<Resource> &w) {
+        std::shared_ptr<Resource> r = w.lock();
+        return !r || (!std::isinf(r->priority)
+            && r->lastAccessTick + 1 < tick);
     };
-    // successfully loaded resources are removed
-    //   only when we are tight on memory
-    std::vector<Res> resourcesToRemove;
-    resourcesToRemove.reserve(resources.size() / 4);
-    // resources that errored are removed immediately
-    std::vector<Res> unconditionalToRemove;
-    unconditionalToRemove.reserve(resources.size() / 4);
-    uint64 memRamUse = 0;
-    uint64 memGpuUse = 0;
-    // find resource candidates for removal
-    for (const auto &it : resources)
-    {
-        memRamUse += it.second->info.ramMemoryCost;
-        memGpuUse += it.second->info.gpuMemoryCost;
+    std::vector<std::weak_ptr<Resource>> removed;
+    queFetching.shed(limit, filter, removed);
+    queCacheRead.shed(limit, filter, removed);
+    for (auto &w : removed)
+    {
+        std::shared_ptr<Resource> r = w.lock();
+        if (!r)
+            continue;
+        map->statistics.resourcesShed++;
+        auto it = resources.find(r->name);
+        if (it != resources.end() && it->second == r)
+        {
+            r.reset();
+            if (tryRemove(it->second))
+                continue;
+            r = w.lock();
+            if (!r)
+                continue;
+        }
+        // still held elsewhere, parked until another access queues it again
+        r->state = Resource::State::initializing;
+    }
+}
+
+void Resources::removeOld()
+{
+    OPTICK_EVENT();
+    const uint32 tick = map->renderTickIndex;
+    const auto old = [&](const Resource *r) {
         // skip recently used resources
-        if (it.second->lastAccessTick + 5 < map->renderTickIndex)
+        return r && r->lastAccessTick + 5 < tick;
+    };
+
+    // resources that errored are removed unconditionally
+    // the sweep continues where it stopped last time
+    //   to bound the amount of work per frame
+    {
+        OPTICK_EVENT("sweep");
+        Resource *r = lruSweep ? lruSweep : lruHead;
+        for (uint32 i = 0; i < MaxSweptResources && old(r); i++)
         {
-            Res r(&it.second->name,
-                it.second->info.ramMemoryCost + it.second->info.gpuMemoryCost,
-                it.second->lastAccessTick);
-            switch ((vts::Resource::State)it.second->state)
+            Resource *next = r->lruNext;
+            accountMemory(r);
+            if (isUnconditionalRemove(r->state))
+                tryRemove(r);
+            else if (std::isinf(r->priority))
             {
-            case Resource::State::initializing:
-            case Resource::State::errorFatal:
-            case Resource::State::errorRetry:
-            case Resource::State::availFail:
-                unconditionalToRemove.push_back(std::move(r));
-                break;
-            default:
-                resourcesToRemove.push_back(std::move(r));
-                break;
+                // essential resources are never abandoned
+            }
+            else if (r->lastAccessTick + map->options.abandonedResourceTicks
+                < tick)
+            {
+                // nobody is waiting for the resource anymore
+                switch ((Resource::State)r->state)
+                {
+                case Resource::State::fetching:
+                    if (cancelFetch(r))
+                        tryRemove(r);
+                    break;
+                case Resource::State::cacheReadQueue:
+                case Resource::State::fetchQueue:
+                case Resource::State::decodeQueue:
+                    tryRemove(r);
+                    break;
+                default:
+                    break;
+                }
+            }
+            else if (map->options.queuedPriorityHalfLife
+                && !std::isnan(r->priority) && r->priorityTick < tick)
+            {
+                switch ((Resource::State)r->state)
+                {
+                case Resource::State::fetching:
+                case Resource::State::cacheReadQueue:
+                case Resource::State::fetchQueue:
+                case Resource::State::decodeQueue:
+                    r->priority *= (float)std::pow(0.5,
+                        double(tick - r->priorityTick)
+                        / map->options.queuedPriorityHalfLife);
+                    r->priorityTick = tick;
+                    reprioritize(r);
+                    break;
+                default:
+                    break;
+                }
             }
+            r = next;
         }
+        lruSweep = old(r) ? r : nullptr;
     }
+
     map->statistics.currentGpuMemUseKB = memGpuUse / 1024;
     map->statistics.currentRamMemUseKB = memRamUse / 1024;
-    uint64 memUse = memRamUse + memGpuUse;
-    OPTICK_TAG("memUse", memUse);
-    // remove unconditionalToRemove
-    for (const Res &res : unconditionalToRemove)
+    map->statistics.currentMemUsePerTypeKB.resize(ResourceTypesCount);
+    for (uint32 t = 0; t < ResourceTypesCount; t++)
+        map->statistics.currentMemUsePerTypeKB[t] = memTypeUse[t] / 1024;
+    map->statistics.currentMemUsePerStateKB.clear();
+    for (uint32 s = 0; s < Resource::StatesCount; s++)
     {
-        if (tryRemove(resources[*res.n]))
-            memUse -= res.m;
+        if (memStateUse[s])
+            map->statistics.currentMemUsePerStateKB[
+                stateName((Resource::State)s)] = memStateUse[s] / 1024;
     }
-    // remove resourcesToRemove
-    uint64 trs = (uint64)map->options.targetResourcesMemoryKB * 1024;
-    if (memUse > trs)
+    OPTICK_TAG("memUse", memRamUse + memGpuUse);
+
+    // memory budgets
+    const MapRuntimeOptions &o = map->options;
+    const uint64 limTotal = (uint64)o.targetResourcesMemoryKB * 1024;
+    const uint64 limRam = (uint64)o.targetRamMemoryKB * 1024;
+    uint64 limGpu = (uint64)o.targetGpuMemoryKB * 1024;
+    if (o.autoGpuMemoryBudget && map->callbacks.gpuMemoryCapacity)
+    {
+        const uint64 a = (uint64)map->callbacks.gpuMemoryCapacity()
+            * 1024 / 4 * 3;
+        if (a && (!limGpu || a < limGpu))
+            limGpu = a;
+    }
+    uint64 limType[ResourceTypesCount] = {};
+    limType[(uint32)FetchTask::ResourceType::MetaTile]
+        = (uint64)o.targetMetaTilesMemoryKB * 1024;
+    limType[(uint32)FetchTask::ResourceType::Mesh]
+        = (uint64)o.targetMeshesMemoryKB * 1024;
+    limType[(uint32)FetchTask::ResourceType::Texture]
+        = (uint64)o.targetTexturesMemoryKB * 1024;
+    limType[(uint32)FetchTask::ResourceType::GeodataFeatures]
+        = (uint64)o.targetGeodataMemoryKB * 1024;
+    const auto overType = [&](uint32 t) {
+        return limType[t] && memTypeUse[t] > limType[t];
+    };
+    const auto overRam = [&]() {
+        return limRam && memRamUse > limRam;
+    };
+    const auto overGpu = [&]() {
+        return limGpu && memGpuUse > limGpu;
+    };
+    const auto overTotal = [&]() {
+        return memRamUse + memGpuUse > limTotal;
+    };
+    const auto exceeded = [&]() {
+        if (overTotal() || overRam() || overGpu())
+            return true;
+        for (uint32 t = 0; t < ResourceTypesCount; t++)
+            if (overType(t))
+                return true;
+        return false;
+    };
+    // whether removing the resource helps with any exceeded budget
+    const auto helps = [&](const Resource *r) {
+        if (overTotal())
+            return true;
+        if (r->accountedRamMemory && overRam())
+            return true;
+        if (r->accountedGpuMemory && overGpu())
+            return true;
+        return (r->accountedRamMemory || r->accountedGpuMemory)
+            && overType((uint32)r->resourceType());
+    };
+
+    // successfully loaded resources are removed
+    //   only when we are tight on memory
+    if (exceeded())
     {
         OPTICK_EVENT("removing");
-        std::sort(resourcesToRemove.begin(), resourcesToRemove.end(),
-            [](const Res &a, const Res &b) {
-                return a.a < b.a; // least recently used first
+        // removing a resource may release others
+        //   the candidates are revalidated before each removal
+        struct Candidate
+        {
+            std::weak_ptr<Resource> w;
+            float score;
+        };
+        std::vector<Candidate> candidates;
+        candidates.reserve(MaxEvictionCandidates);
+        Resource *r = lruEvict ? lruEvict : lruHead;
+        for (uint32 i = 0; i < MaxEvictionCandidates && old(r); i++)
+        {
+            accountMemory(r);
+            if (helps(r))
+                candidates.push_back({
+                    std::weak_ptr<Resource>(r->shared_from_this()),
+                    evictionScore(r, tick) });
+            r = r->lruNext;
+        }
+        lruEvict = old(r) ? r : nullptr;
+        std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate &a, const Candidate &b) {
+                return a.score < b.score;
             });
-        for (const Res &res : resourcesToRemove)
+        for (const Candidate &c : candidates)
         {
-            if (tryRemove(resources[*res.n]))
-            {
-                memUse -= res.m;
-                if (memUse < trs)
-                    break;
-            }
+            if (!exceeded())
+                break;
+            std::shared_ptr<Resource> s = c.w.lock();
+            if (!s || !s->managed || !helps(s.get()))
+                continue;
+            auto it = resources.find(s->name);
+            assert(it != resources.end() && it->second == s);
+            // the map must hold the last reference for the removal
+            s.reset();
+            tryRemove(it->second);
         }
     }
 }
 
+void Resources::memoryPressure(MemoryPressure level)
+{
+    OPTICK_EVENT();
+
+    // pending writes to the disk cache hold whole downloaded files
+    queCacheWrite.clear();
+    cacheWriteSpaceFreed();
+
+    // the resources waiting in other queues are released here too
+    //   the queues hold weak pointers only
+    const uint32 tick = map->renderTickIndex;
+    const uint32 keepTicks = level == MemoryPressure::Moderate ? 5 : 0;
+    Resource *r = lruHead;
+    while (r && (level == MemoryPressure::Critical
+        || r->lastAccessTick + keepTicks < tick))
+    {
+        Resource *next = r->lruNext;
+        accountMemory(r);
+        if (r->state == Resource::State::fetching)
+            cancelFetch(r);
+        tryRemove(r);
+        r = next;
+    }
+
+    if (level == MemoryPressure::Critical)
+        trimBufferPool();
+}
+
 void Resources::checkInitialized()
 {
     OPTICK_EVENT();
     const std::time_t current = std::time(nullptr);
 
-    for (const auto &it : resources)
+    // only resources accessed in last few ticks are processed
+    //   they are at the end of the list
+    for (Resource *p = lruTail; p
+        && p->lastAccessTick + 3 >= map->renderTickIndex; p = p->lruPrev)
     {
-        const std::shared_ptr<Resource> &r = it.second;
-        if (r->lastAccessTick + 3 < map->renderTickIndex)
-            continue; // skip resources that were not accessed last few tick
+        Resource *r = p;
         switch ((Resource::State)r->state)
         {
         case Resource::State::errorRetry:
@@ -571,12 +1431,21 @@ void Resources::checkInitialized()
             if (r->retryTime > current)
                 break;
             r->retryNumber++;
-            LOG(info2) << "Trying again to download resource <" << r->name << "> (attempt " << r->retryNumber << ")";
+            VTS_LOG(info2) << "Trying again to download resource <" << r->name << "> (attempt " << r->retryNumber << ")";
             r->retryTime = -1;
             UTILITY_FALLTHROUGH;
         case Resource::State::initializing:
+            if (!localScheme(r->name) && !map->cache->mayContain(r->name))
+            {
+                // definite cache miss, go straight to the fetcher
+                prepareFetch(r->shared_from_this());
+                r->state = Resource::State::fetchQueue;
+                queFetching.push(r->shared_from_this());
+                cacheSkipped++;
+                break;
+            }
             r->state = Resource::State::cacheReadQueue;
-            queCacheRead.push(r);
+            queCacheRead.push(r->shared_from_this());
             break;
         default:
             break;
@@ -584,6 +1453,34 @@ void Resources::checkInitialized()
     }
 }
 
+uint32 Resources::countPreparing() const
+{
+    // the counters are updated by multiple threads
+    //   and their sum may be off transiently
+    sint64 cnt = 0;
+    for (uint32 i = 0; i < Resource::StatesCount; i++)
+    {
+        switch ((Resource::State)i)
+        {
+        case Resource::State::initializing:
+        case Resource::State::cacheReadQueue:
+        case Resource::State::fetchQueue:
+        case Resource::State::fetching:
+        case Resource::State::decodeQueue:
+        case Resource::State::atmosphereQueue:
+        case Resource::State::uploadQueue:
+        case Resource::State::errorRetry:
+            cnt += (sint32)stateCounters[i].load();
+            break;
+        case Resource::State::ready:
+        case Resource::State::errorFatal:
+        case Resource::State::availFail:
+            break;
+        }
+    }
+    return (uint32)std::max<sint64>(cnt, 0);
+}
+
 void Resources::renderFinalize()
 {
     OPTICK_EVENT();
@@ -592,61 +1489,155 @@ void Resources::renderFinalize()
     map->purgeMapconfig();
 
     // clear the resources now while all the necessary things are still working
+    while (lruHead)
+        lruUnlink(lruHead);
+    for (auto &it : resources)
+    {
+        it.second->managed = false;
+        it.second->state.setCounted(false);
+    }
     resources.clear();
 
     // terminate all worker threads (except upload)
     queCacheRead.terminate();
     queCacheWrite.terminate();
+    cacheWriteSpaceFreed();
     queFetching.terminate();
     queDecode.terminate();
     queAtmosphere.terminate();
 
     // signal the data thread that it should terminate
     renderFinalizeCalled = true;
-    queUpload.con.notify_one();
+    queUpload.notify();
 }
 
 void Resources::renderUpdate()
 {
     OPTICK_EVENT();
 
+    {
+        // the draws generated earlier keep the reduced quality
+        std::vector<std::weak_ptr<Resource>> ups;
+        {
+            std::lock_guard<std::mutex> lock(upgradesMutex);
+            std::swap(ups, upgrades);
+        }
+        for (const auto &w : ups)
+        {
+            std::shared_ptr<Resource> r = w.lock();
+            if (!r || !r->upgradePending)
+                continue;
+            r->upgrade();
+            r->upgradePending = false;
+            upgradesPending--;
+            map->statistics.resourcesUpgraded++;
+        }
+    }
+
     {
         OPTICK_EVENT("statistics");
 
         // resourcesPreparing is used to determine mapRenderComplete and must be updated every frame
-        map->statistics.resourcesPreparing = 0;
-        for (const auto &it : resources)
+        map->statistics.resourcesPreparing = countPreparing()
+            + upgradesPending;
+
+        map->statistics.resourcesDecoded += decoded.exchange(0);
+        map->statistics.resourcesDiskLoaded += diskLoaded.exchange(0);
+        map->statistics.resourcesDecodePreempted += decodePreempted.exchange(0);
+        map->statistics.resourcesCacheSkipped += cacheSkipped.exchange(0);
+        map->statistics.resourcesDeduplicated += deduplicated.exchange(0);
+        map->statistics.resourcesFailed += decodeFailed.exchange(0);
+        map->statistics.resourcesCancelled += fetchesCancelled.exchange(0);
+        map->statistics.resourcesRevalidated += revalidated.exchange(0);
+        map->statistics.dataUploadTime = uploadDuration.exchange(0) * 1e-6;
+        map->statistics.resourcesUploadsDeferred += uploadsDeferred.exchange(0);
+        map->statistics.meshesOptimized = meshesOptimized;
+        if (uint64 faces = meshesOptimizedFaces)
+        {
+            map->statistics.meshesAcmrBefore = (double)meshesMissesBefore / faces;
+            map->statistics.meshesAcmrAfter = (double)meshesMissesAfter / faces;
+        }
         {
-            switch ((Resource::State)it.second->state)
+            std::lock_guard<std::mutex> lock(downloadTimingsMutex);
+            map->statistics.downloadTimings = downloadTimings;
+        }
+        {
+            auto &ls = map->statistics.resourceLatencies;
+            ls.resize(ResourceTypesCount);
+            for (uint32 t = 0; t < ResourceTypesCount; t++)
             {
-            case Resource::State::initializing:
-            case Resource::State::cacheReadQueue:
-            case Resource::State::fetchQueue:
-            case Resource::State::fetching:
-            case Resource::State::decodeQueue:
-            case Resource::State::atmosphereQueue:
-            case Resource::State::uploadQueue:
-            case Resource::State::errorRetry:
-                map->statistics.resourcesPreparing++;
-                break;
-            case Resource::State::ready:
-            case Resource::State::errorFatal:
-            case Resource::State::availFail:
-                break;
+                uint32 *const dst[StagesCount] = { ls[t].cacheRead,
+                    ls[t].fetchQueue, ls[t].decodeQueue, ls[t].decode,
+                    ls[t].uploadQueue };
+                for (uint32 s = 0; s < StagesCount; s++)
+                    for (uint32 b = 0; b < DownloadTimings::Bins; b++)
+                        dst[s][b] = stageHistograms[t][s][b];
             }
         }
-
+        queDecode.utilization(map->statistics.decodeWorkersUtilization);
+        queCacheRead.utilization(map->statistics.cacheReadWorkersUtilization);
         map->statistics.resourcesExists = existing;
+        {
+            const BufferPoolStatistics bp = bufferPoolStatistics();
+            map->statistics.bufferPoolHits = bp.hits;
+            map->statistics.bufferPoolMisses = bp.misses;
+            map->statistics.bufferPoolRetainedKB = bp.retainedBytes / 1024;
+        }
         map->statistics.resourcesActive = resources.size();
         map->statistics.resourcesDownloading = downloads;
+        {
+            const MapRuntimeOptions &o = map->options;
+            uint32 initial = o.maxConcurrentDownloads;
+            uint32 maximum = o.maxAdaptiveDownloads;
+            if (o.lowPowerMode)
+            {
+                // fewer radio wakeups and less decoding in parallel
+                initial = std::max(initial / 2, 1u);
+                maximum = maximum ? std::max(maximum / 2, 1u) : 0;
+            }
+            if (!configured || initial != configuredInitial
+                || maximum != configuredMaximum)
+            {
+                downloadControl.configure(initial, maximum);
+                configuredInitial = initial;
+                configuredMaximum = maximum;
+            }
+            if (!configured || o.hostBlockingFailures != configuredFailures
+                || o.hostBackoffInitial != configuredBackoff[0]
+                || o.hostBackoffMaximum != configuredBackoff[1])
+            {
+                downloadControl.configureBackoff(o.hostBlockingFailures,
+                    o.hostBackoffInitial, o.hostBackoffMaximum);
+                configuredFailures = o.hostBlockingFailures;
+                configuredBackoff[0] = o.hostBackoffInitial;
+                configuredBackoff[1] = o.hostBackoffMaximum;
+            }
+            configured = true;
+            queDecode.limitWorkers(o.lowPowerMode ? 1
+                : map->createOptions.decodeThreads);
+            queCacheRead.limitWorkers(o.lowPowerMode ? 1
+                : map->createOptions.cacheReadThreads);
+        }
+        map->statistics.downloadsWindow = downloadControl.totalWindow();
+        map->statistics.downloadsBlockedHosts = downloadControl.blockedHosts();
+        {
+            std::vector<std::weak_ptr<Resource>> wake;
+            downloadControl.update(wake);
+            for (auto &it : wake)
+                queFetching.push(std::move(it));
+        }
         map->statistics.resourcesQueueDownload = queFetching.estimateSize();
         map->statistics.resourcesQueueCacheRead = queCacheRead.estimateSize();
         map->statistics.resourcesQueueCacheWrite = queCacheWrite.estimateSize();
         map->statistics.resourcesQueueDecode = queDecode.estimateSize();
         map->statistics.resourcesQueueAtmosphere = queAtmosphere.estimateSize();
         map->statistics.resourcesQueueUpload = queUpload.estimateSize();
+        map->statistics.resourcesQueueReprioritized = queFetching.updates + queCacheRead.updates + queDecode.updates;
+        map->statistics.resourcesQueueContentions = queFetching.contentions + queCacheRead.contentions + queCacheWrite.contentions + queDecode.contentions + queAtmosphere.contentions + queUpload.contentions;
     }
 
+    shedQueues();
+
     // split workload into multiple render frames
     switch (map->renderTickIndex % 2)
     {
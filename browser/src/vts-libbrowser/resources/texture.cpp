@@ -26,17 +26,125 @@
 
 #include "../image/image.hpp"
 #include "../gpuResource.hpp"
+#include "../resources.hpp"
 #include "../fetchTask.hpp"
 #include "../map.hpp"
+#include "../utilities/logFilter.hpp"
 
 #include <dbglog/dbglog.hpp>
 
 namespace vts
 {
 
-GpuTextureSpec::GpuTextureSpec(const Buffer &buffer)
+namespace
 {
-    decodeImage(buffer, this->buffer, width, height, components);
+
+// 2x2 box filter, the last row/column is repeated for odd sizes
+void downsample(const unsigned char *src, uint32 w, uint32 h,
+    unsigned char *dst, uint32 dw, uint32 dh, uint32 components)
+{
+    const uint32 stride = w * components;
+    for (uint32 y = 0; y < dh; y++)
+    {
+        const unsigned char *r0 = src + std::min(y * 2, h - 1) * stride;
+        const unsigned char *r1 = src + std::min(y * 2 + 1, h - 1) * stride;
+        for (uint32 x = 0; x < dw; x++)
+        {
+            const uint32 x0 = std::min(x * 2, w - 1) * components;
+            const uint32 x1 = std::min(x * 2 + 1, w - 1) * components;
+            for (uint32 i = 0; i < components; i++)
+            {
+                *dst++ = (r0[x0 + i] + r0[x1 + i]
+                    + r1[x0 + i] + r1[x1 + i] + 2) / 4;
+            }
+        }
+    }
+}
+
+// 4x4 bayer matrix, centered around zero, in units of 1/16
+const int bayer4x4[16] = {
+    -8, 0, -6, 2,
+    4, -4, 6, -2,
+    -5, 3, -7, 1,
+    7, -1, 5, -3,
+};
+
+// quantize an 8 bit channel to the given number of bits
+//   the threshold is scaled to the quantization step of the target
+inline uint32 ditherChannel(uint32 v, int threshold, uint32 bits)
+{
+    const int step = 256 >> bits;
+    const int d = (int)v + threshold * step / 16;
+    return (uint32)std::min(std::max(d, 0), 255) >> (8 - bits);
+}
+
+// fnv-1a of the encoded content and of the parameters affecting the decode
+uint64 textureContentHash(const Buffer &b, uint32 filterMode,
+    uint32 wrapMode, bool tileTexture)
+{
+    uint64 h = 14695981039346656037ull;
+    const auto mix = [&](unsigned char c) {
+        h ^= c;
+        h *= 1099511628211ull;
+    };
+    const unsigned char *p = (const unsigned char *)b.data();
+    for (uint32 i = 0, e = b.size(); i < e; i++)
+        mix(p[i]);
+    for (uint32 i = 0; i < 4; i++)
+    {
+        mix((unsigned char)(filterMode >> (i * 8)));
+        mix((unsigned char)(wrapMode >> (i * 8)));
+    }
+    mix(tileTexture);
+    return h;
+}
+
+void packLevel(const unsigned char *src, uint32 w, uint32 h,
+    uint16 *dst, uint32 components)
+{
+    for (uint32 y = 0; y < h; y++)
+    {
+        const int *row = bayer4x4 + (y % 4) * 4;
+        for (uint32 x = 0; x < w; x++)
+        {
+            const int t = row[x % 4];
+            if (components == 3)
+            {
+                *dst++ = (uint16)((ditherChannel(src[0], t, 5) << 11)
+                    | (ditherChannel(src[1], t, 6) << 5)
+                    | ditherChannel(src[2], t, 5));
+            }
+            else
+            {
+                *dst++ = (uint16)((ditherChannel(src[0], t, 4) << 12)
+                    | (ditherChannel(src[1], t, 4) << 8)
+                    | (ditherChannel(src[2], t, 4) << 4)
+                    | ditherChannel(src[3], t, 4));
+            }
+            src += components;
+        }
+    }
+}
+
+} // namespace
+
+GpuTextureSpec::GpuTextureSpec(const Buffer &buffer) :
+    GpuTextureSpec(buffer, false)
+{}
+
+GpuTextureSpec::GpuTextureSpec(const Buffer &buffer, bool flipVertically)
+{
+    if (isKtx2(buffer))
+    {
+        // compressed blocks cannot be flipped cheaply
+        //   the image must be authored with bottom-up rows
+        decodeKtx2(buffer, this->buffer, width, height, components,
+            internalFormat, mipmapLevels);
+        compressed = true;
+        return;
+    }
+    decodeImage(buffer, this->buffer, width, height, components,
+        flipVertically);
 }
 
 void GpuTextureSpec::verticalFlip()
@@ -56,37 +164,193 @@ void GpuTextureSpec::verticalFlip()
 
 uint32 GpuTextureSpec::expectedSize() const
 {
-    return width * height * components * gpuTypeSize(type);
+    if (!mipmapLevels.empty())
+    {
+        uint32 sum = 0;
+        for (uint32 l : mipmapLevels)
+            sum += l;
+        return sum;
+    }
+    switch (type)
+    {
+    case GpuTypeEnum::UnsignedShort565:
+    case GpuTypeEnum::UnsignedShort4444:
+        return width * height * gpuTypeSize(type);
+    default:
+        return width * height * components * gpuTypeSize(type);
+    }
 }
 
 Buffer GpuTextureSpec::encodePng() const
 {
-    if (type != GpuTypeEnum::UnsignedByte)
+    if (type != GpuTypeEnum::UnsignedByte || !mipmapLevels.empty())
     {
-        LOGTHROW(err2, std::runtime_error) << "Unsigned byte is the only "
-                                    "supported image type for png encode.";
+        LOGTHROW(err2, std::runtime_error) << "Unsigned byte without mipmaps "
+                                    "is the only supported image type for png encode.";
     }
     Buffer out;
     vts::encodePng(buffer, out, width, height, components);
     return out;
 }
 
+void GpuTextureSpec::generateMipmaps()
+{
+    if (type != GpuTypeEnum::UnsignedByte || !mipmapLevels.empty())
+    {
+        LOGTHROW(err2, std::runtime_error) << "Unsigned byte without mipmaps "
+                                    "is the only supported image type for mipmaps generation.";
+    }
+
+    // sizes of all levels, down to 1x1
+    std::vector<uint32> levels;
+    uint32 total = 0;
+    {
+        uint32 w = width, h = height;
+        while (true)
+        {
+            levels.push_back(w * h * components);
+            total += levels.back();
+            if (w <= 1 && h <= 1)
+                break;
+            w = std::max(w / 2, 1u);
+            h = std::max(h / 2, 1u);
+        }
+    }
+
+    Buffer out(total);
+    memcpy(out.data(), buffer.data(), levels[0]);
+    unsigned char *src = (unsigned char*)out.data();
+    uint32 w = width, h = height;
+    for (uint32 l = 1, e = levels.size(); l < e; l++)
+    {
+        const uint32 dw = std::max(w / 2, 1u);
+        const uint32 dh = std::max(h / 2, 1u);
+        unsigned char *dst = src + levels[l - 1];
+        downsample(src, w, h, dst, dw, dh, components);
+        src = dst;
+        w = dw;
+        h = dh;
+    }
+
+    buffer = std::move(out);
+    mipmapLevels.swap(levels);
+}
+
+void GpuTextureSpec::reducePrecision()
+{
+    if (type != GpuTypeEnum::UnsignedByte || compressed
+        || (components != 3 && components != 4))
+    {
+        LOGTHROW(err2, std::runtime_error) << "Unsigned byte rgb or rgba "
+                    "is the only supported image type for precision reduction.";
+    }
+
+    std::vector<uint32> levels;
+    if (mipmapLevels.empty())
+        levels.push_back(width * height * components);
+    else
+        levels = mipmapLevels;
+
+    Buffer out(expectedSize() / components * 2);
+    const unsigned char *src = (const unsigned char*)buffer.data();
+    uint16 *dst = (uint16*)out.data();
+    uint32 w = width, h = height;
+    for (uint32 &l : levels)
+    {
+        packLevel(src, w, h, dst, components);
+        src += l;
+        dst += w * h;
+        l = w * h * 2;
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+
+    buffer = std::move(out);
+    if (!mipmapLevels.empty())
+        mipmapLevels.swap(levels);
+    if (components == 3)
+    {
+        type = GpuTypeEnum::UnsignedShort565;
+        internalFormat = 0x8D62; // GL_RGB565
+    }
+    else
+    {
+        type = GpuTypeEnum::UnsignedShort4444;
+        internalFormat = 0x8056; // GL_RGBA4
+    }
+}
+
 GpuTexture::GpuTexture(MapImpl *map, const std::string &name) :
     Resource(map, name)
 {}
 
+GpuTexture::~GpuTexture()
+{
+    // the gpu objects must be destroyed on the data thread
+    if (previewUserData)
+        map->resources->queUpload.push(UploadData(previewUserData, 0));
+    if (upgradeInfo.userData)
+        map->resources->queUpload.push(UploadData(upgradeInfo.userData, 0));
+}
+
 void GpuTexture::decode()
 {
-    LOG(info1) << "Decoding texture <" << name << ">";
-    std::shared_ptr<GpuTextureSpec> spec
-        = std::make_shared<GpuTextureSpec>(fetch->reply.content);
-    this->width = spec->width;
-    this->height = spec->height;
+    std::shared_ptr<GpuTextureSpec> spec;
+    if (upgradePending)
+    {
+        // full resolution of a texture that has been previewed
+        VTS_LOG(info1) << "Decoding full resolution of texture <" << name << ">";
+        spec = std::make_shared<GpuTextureSpec>(progressiveContent, true);
+        progressiveContent.free();
+        upgradeWidth = spec->width;
+        upgradeHeight = spec->height;
+    }
+    else
+    {
+        VTS_LOG(info1) << "Decoding texture <" << name << ">";
+        const Buffer &content = fetch->reply.content;
+        if (map->options.deduplicateTextures && !masked)
+        {
+            contentHash = textureContentHash(content, (uint32)filterMode,
+                (uint32)wrapMode, tileTexture);
+            contentSize = content.size();
+            duplicateUserData = map->resources->dedupFind(contentHash,
+                contentSize, this->width, this->height);
+            if (duplicateUserData)
+            {
+                VTS_LOG(info1) << "Texture <" << name
+                    << "> is identical to already uploaded texture";
+                return;
+            }
+        }
+        if (map->options.progressiveTextures && tileTexture
+            && !masked && isJpeg(content))
+        {
+            spec = std::make_shared<GpuTextureSpec>();
+            if (decodeJpegPreview(content, spec->buffer, spec->width,
+                spec->height, spec->components, true) > 1)
+            {
+                progressiveContent = fetch->reply.content.share();
+                info.ramMemoryCost += progressiveContent.size();
+                upgradePending = true;
+            }
+        }
+        else
+        {
+            // decoded directly in the bottom-up order required for upload
+            spec = std::make_shared<GpuTextureSpec>(content, true);
+        }
+        this->width = spec->width;
+        this->height = spec->height;
+    }
     spec->filterMode = filterMode;
     spec->wrapMode = wrapMode;
+    spec->tileTexture = tileTexture;
+    foldMask(*spec);
 
 #ifndef __EMSCRIPTEN__
-    if (map->options.debugExtractRawResources)
+    if (map->options.debugExtractRawResources && !spec->compressed
+        && fetch)
     {
         static const std::string prefix = "extracted/";
         std::string b, c;
@@ -96,24 +360,76 @@ void GpuTexture::decode()
         if (!boost::filesystem::exists(path))
         {
             boost::filesystem::create_directories(prefix + b);
-            Buffer out;
-            encodePng(spec->buffer, out,
-                spec->width, spec->height, spec->components);
-            writeLocalFileBuffer(path, out);
+            writeLocalFileBuffer(path,
+                GpuTextureSpec(fetch->reply.content).encodePng());
         }
     }
 #endif
 
-    spec->verticalFlip();
+    if (map->options.generateMipmapsOnDecode && !spec->compressed
+        && spec->type == GpuTypeEnum::UnsignedByte)
+    {
+        switch (spec->filterMode)
+        {
+        case GpuTextureSpec::FilterMode::Nearest:
+        case GpuTextureSpec::FilterMode::Linear:
+            break;
+        default:
+            spec->generateMipmaps();
+            break;
+        }
+    }
+
+    if (map->options.reducedPrecisionTextures && tileTexture
+        && !spec->compressed && spec->type == GpuTypeEnum::UnsignedByte
+        && (spec->components == 3 || spec->components == 4))
+        spec->reducePrecision();
+
     decodeData = std::static_pointer_cast<void>(spec);
 }
 
+uint32 GpuTexture::decodedMemoryCost() const
+{
+    auto spec = std::static_pointer_cast<const GpuTextureSpec>(decodeData);
+    return spec ? sizeof(*spec) + spec->buffer.size() : 0;
+}
+
 void GpuTexture::upload()
 {
-    LOG(info2) << "Uploading texture <" << name << ">";
+    VTS_LOG(info2) << "Uploading texture <" << name << ">";
+    if (duplicateUserData)
+    {
+        // the gpu memory is accounted to the original texture
+        info.userData = std::move(duplicateUserData);
+        info.ramMemoryCost += sizeof(*this);
+        return;
+    }
     auto spec = std::static_pointer_cast<GpuTextureSpec>(decodeData);
-    map->callbacks.loadTexture(info, *spec, name);
-    info.ramMemoryCost += sizeof(*this);
+    // the full resolution is put into use later by upgrade
+    const bool upgrade = state == Resource::State::ready;
+    ResourceInfo &target = upgrade ? upgradeInfo : info;
+    map->callbacks.loadTexture(target, *spec, name);
+    target.ramMemoryCost += sizeof(*this);
+    if (contentHash && (upgrade || !upgradePending))
+    {
+        Resources::DedupEntry e;
+        e.userData = target.userData;
+        e.size = contentSize;
+        e.width = spec->width;
+        e.height = spec->height;
+        map->resources->dedupInsert(contentHash, std::move(e));
+    }
+}
+
+void GpuTexture::upgrade()
+{
+    previewUserData = std::move(info.userData);
+    info.userData = std::move(upgradeInfo.userData);
+    info.ramMemoryCost = upgradeInfo.ramMemoryCost;
+    info.gpuMemoryCost += upgradeInfo.gpuMemoryCost;
+    upgradeInfo = ResourceInfo();
+    width = upgradeWidth;
+    height = upgradeHeight;
 }
 
 FetchTask::ResourceType GpuTexture::resourceType() const
@@ -121,4 +437,114 @@ FetchTask::ResourceType GpuTexture::resourceType() const
     return FetchTask::ResourceType::Texture;
 }
 
+TextureMask::TextureMask(MapImpl *map, const std::string &name) :
+    Resource(map, name)
+{}
+
+void TextureMask::decode()
+{
+    VTS_LOG(info1) << "Decoding texture mask <" << name << ">";
+    Buffer decoded;
+    uint32 components = 0;
+    // same row order as the color texture
+    decodeImage(fetch->reply.content, decoded, width, height,
+        components, true);
+    if (components == 1)
+        buffer = std::move(decoded);
+    else
+    {
+        buffer = Buffer(width * height);
+        const char *src = decoded.data();
+        for (uint32 i = 0, e = width * height; i < e; i++)
+            buffer.data()[i] = src[i * components];
+    }
+    info.ramMemoryCost = sizeof(*this) + buffer.size();
+}
+
+FetchTask::ResourceType TextureMask::resourceType() const
+{
+    return FetchTask::ResourceType::Texture;
+}
+
+std::string TextureMask::fetchUrl() const
+{
+    return name.substr(0, name.rfind(' '));
+}
+
+std::string TextureMask::nameOf(const std::string &maskUrl)
+{
+    // urls never contain spaces
+    return maskUrl + " mask";
+}
+
+GpuMaskedTexture::GpuMaskedTexture(MapImpl *map, const std::string &name) :
+    GpuTexture(map, name)
+{
+    masked = true;
+}
+
+std::string GpuMaskedTexture::fetchUrl() const
+{
+    return name.substr(0, name.find(' '));
+}
+
+std::string GpuMaskedTexture::nameOf(const std::string &colorUrl,
+    const std::string &maskUrl)
+{
+    return colorUrl + " masked " + maskUrl;
+}
+
+void GpuMaskedTexture::setMask(const std::shared_ptr<TextureMask> &mask)
+{
+    std::lock_guard<std::mutex> lock(maskMutex);
+    this->mask = mask;
+}
+
+void GpuMaskedTexture::foldMask(GpuTextureSpec &spec)
+{
+    std::shared_ptr<TextureMask> m;
+    {
+        std::lock_guard<std::mutex> lock(maskMutex);
+        m = mask.lock();
+    }
+    if (!m || m->state != Resource::State::ready)
+    {
+        LOGTHROW(err2, std::runtime_error) << "Mask of texture <"
+            << name << "> is not available.";
+    }
+    if (spec.type != GpuTypeEnum::UnsignedByte || spec.compressed
+        || (spec.components != 3 && spec.components != 4))
+    {
+        LOGTHROW(err2, std::runtime_error) << "Unsigned byte rgb or rgba "
+                    "is the only supported image type for mask folding.";
+    }
+
+    // the mask is resampled to the resolution of the color
+    const uint32 w = spec.width, h = spec.height;
+    const uint32 components = spec.components;
+    Buffer out(w * h * 4);
+    const unsigned char *src = (const unsigned char*)spec.buffer.data();
+    unsigned char *dst = (unsigned char*)out.data();
+    for (uint32 y = 0; y < h; y++)
+    {
+        const unsigned char *row = (const unsigned char*)m->buffer.data()
+            + (uint64)y * m->height / h * m->width;
+        for (uint32 x = 0; x < w; x++)
+        {
+            const uint32 a = components == 4 ? src[3] : 255;
+            const uint32 v = row[(uint64)x * m->width / w];
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = (unsigned char)((a * v + 127) / 255);
+            src += components;
+            dst += 4;
+        }
+    }
+
+    spec.buffer = std::move(out);
+    spec.components = 4;
+    spec.alphaMask = true;
+}
+
 } // namespace vts
@@ -27,6 +27,7 @@
 #ifndef SEARCHTASK_HPP_ysdr457u89
 #define SEARCHTASK_HPP_ysdr457u89
 
+#include "include/vts-browser/search.hpp"
 #include "resource.hpp"
 
 namespace vts
@@ -39,7 +40,14 @@ public:
     void decode() override;
     FetchTask::ResourceType resourceType() const override;
 
-    Buffer data;
+    // parsed on the decode thread, positions in search srs
+    std::vector<SearchItem> items;
+    std::vector<double> corners; // four bounding points for each item, nan if not available
+
+    // converted to navigation srs once on the render thread
+    //   and shared by all searches with the same url
+    std::shared_ptr<const std::vector<SearchItem>> results;
+
     const std::string validityUrl;
     const std::string validitySrs;
 };
@@ -37,17 +37,24 @@ namespace vts
 class TraverseNode;
 class CameraImpl;
 
+// collects subtiles of all nodes in one flat vector
+//   which keeps its capacity across frames
 class SubtilesMerger : private Immovable
 {
 public:
     struct Subtile
     {
+        TraverseNode *trav;
         TraverseNode *orig;
         vec4f uvClip;
-        Subtile(TraverseNode *orig, const vec4f &uvClip);
+        Subtile(TraverseNode *trav, TraverseNode *orig, const vec4f &uvClip);
     };
+    void add(TraverseNode *trav, TraverseNode *orig, const vec4f &uvClip);
+    // emits the (merged) draws and clears the subtiles
+    void resolve(CameraImpl *impl);
+
+private:
     std::vector<Subtile> subtiles;
-    void resolve(TraverseNode *trav, CameraImpl *impl);
 };
 
 } // namespace vts
@@ -33,6 +33,7 @@
 #include "metaTile.hpp"
 
 #include <boost/container/small_vector.hpp>
+#include <atomic>
 
 namespace vts
 {
@@ -42,10 +43,20 @@ class SurfaceInfo;
 class Resource;
 class MeshAggregate;
 class GeodataTile;
+class BoundResolved;
+
+struct TraverseChildsArray;
+class TraverseChildsPool;
+
+struct TraverseChildsDeleter
+{
+    TraverseChildsPool *pool = nullptr;
+    void operator () (TraverseChildsArray *a) const;
+};
 
 struct TraverseChildsContainer
 {
-    std::unique_ptr<struct TraverseChildsArray> ptr;
+    std::unique_ptr<TraverseChildsArray, TraverseChildsDeleter> ptr;
 
     TraverseNode *begin();
     TraverseNode *end();
@@ -57,24 +68,37 @@ class TraverseNode : private Immovable
 {
 public:
     // traversal
+    // the fields read by the traversal of each node are kept together
     TraverseChildsContainer childs;
+    std::shared_ptr<const MetaNode> meta;
+    uint32 lastAccessTime = 0;
+    uint32 lastRenderTime = 0;
+    float priority = nan1();
+    bool determined = false; // draws are fully loaded (may be empty)
     const MapLayer *const layer = nullptr;
     TraverseNode *const parent = nullptr;
     const TileId id;
 
+    // coarseness cached by the last camera that computed it
+    vec3 coarsenessEye;
+    double coarsenessDistance = 0;
+    double coarsenessCache = 0;
+    uint32 coarsenessEpoch = 0;
+
     // metadata
     boost::container::small_vector<vtslibs::registry::CreditId, 8> credits;
     boost::container::small_vector<std::shared_ptr<MetaTile>, 1> metaTiles;
-    std::shared_ptr<const MetaNode> meta;
     const SurfaceInfo *surface = nullptr;
-
-    uint32 lastAccessTime = 0;
-    uint32 lastRenderTime = 0;
-    float priority = nan1();
+    std::shared_ptr<const std::string> geodataFeatures; // virtual tiles of monolithic geodata only
+    std::string resourceName; // expanded url of the mesh or geodata, kept when the renders are evicted
+    std::vector<std::unique_ptr<BoundResolved>> boundResolved; // for each submesh, kept when the renders are evicted
 
     // renders
-    bool determined = false; // draws are fully loaded (may be empty)
     std::vector<std::shared_ptr<Resource>> resources;
+    // raised when any of the resources changes validity
+    //   the draws are not determined again until then
+    std::shared_ptr<std::atomic<bool>> resourcesChanged;
+    uint32 waitingSinceTick = 0;
     boost::container::small_vector<RenderSurfaceTask, 1> opaque;
     boost::container::small_vector<RenderSurfaceTask, 1> transparent;
     boost::container::small_vector<DrawGeodataTask, 1> geodata;
@@ -94,6 +118,54 @@ struct TraverseChildsArray
     Array<TraverseNode, 4> arr;
 };
 
+// recycles arrays of children of the traverse nodes
+//   the arrays are allocated in blocks
+//   so that creating and clearing the nodes avoids the heap
+// each map layer has its own pool
+//   and it must outlive the traverse nodes of the layer
+class TraverseChildsPool : private Immovable
+{
+public:
+    std::unique_ptr<TraverseChildsArray, TraverseChildsDeleter> acquire();
+    void release(TraverseChildsArray *a);
+    uint64 memoryCost() const;
+
+private:
+    static const uint32 BlockSize = 64;
+    typedef std::array<TraverseChildsArray, BlockSize> Block;
+    std::vector<std::unique_ptr<Block>> blocks;
+    std::vector<TraverseChildsArray *> available;
+};
+
+// finds the traverse nodes of a layer by their tile id
+//   open addressing with linear probing
+//   the nodes register themselves on construction and destruction
+// each map layer has its own index
+//   and it must outlive the traverse nodes of the layer
+class TraverseNodeIndex : private Immovable
+{
+public:
+    TraverseNodeIndex();
+    void insert(TraverseNode *node);
+    void erase(TraverseNode *node);
+    TraverseNode *find(const TileId &id) const;
+    uint32 size() const { return count; }
+    uint64 memoryCost() const; // including the registered nodes
+
+private:
+    uint32 slot(const TileId &id) const;
+    void rehash(uint32 capacity);
+
+    std::vector<TraverseNode *> slots; // nullptr is empty slot
+    uint32 count = 0;
+};
+
+inline void TraverseChildsDeleter::operator () (TraverseChildsArray *a) const
+{
+    assert(pool);
+    pool->release(a);
+}
+
 inline TraverseNode *TraverseChildsContainer::begin()
 {
     if (ptr)
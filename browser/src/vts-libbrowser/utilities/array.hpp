@@ -51,6 +51,15 @@ public:
         s_ = s;
     }
     void push_back(T &&v) { resize(s_ + 1); a_[s_ - 1] = std::move(v); }
+    void reset() // like clear, but works with non-assignable types
+    {
+        for (unsigned int i = 0; i < s_; i++)
+        {
+            a_[i].~T();
+            new (&a_[i]) T();
+        }
+        s_ = 0;
+    }
     unsigned int size() const { return s_; }
     unsigned int capacity() const { return N; }
     bool empty() const { return s_ == 0; }
@@ -0,0 +1,210 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "collisionMesh.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+namespace vts
+{
+
+namespace
+{
+
+// maximum number of triangles in leaf nodes
+static const uint32 LeafSize = 4;
+
+// the depth of the hierarchy is about log2 of the triangles count
+//   and the meshes have at most 65536 vertices
+static const uint32 StackSize = 64;
+
+bool rayBox(const vec3f aabb[2], const vec3f &origin,
+    const vec3f &invDirection, float t)
+{
+    float t0 = 0, t1 = t;
+    for (uint32 i = 0; i < 3; i++)
+    {
+        float a = (aabb[0][i] - origin[i]) * invDirection[i];
+        float b = (aabb[1][i] - origin[i]) * invDirection[i];
+        if (a > b)
+            std::swap(a, b);
+        // nan (0 * inf) is skipped by the comparisons
+        if (a > t0)
+            t0 = a;
+        if (b < t1)
+            t1 = b;
+        if (t0 > t1)
+            return false;
+    }
+    return true;
+}
+
+// moller-trumbore
+bool rayTriangle(const vec3f *tri, const vec3f &origin,
+    const vec3f &direction, float &t)
+{
+    const vec3f e1 = tri[1] - tri[0];
+    const vec3f e2 = tri[2] - tri[0];
+    const vec3f p = direction.cross(e2);
+    const float det = e1.dot(p);
+    if (std::abs(det) < 1e-12f)
+        return false; // parallel
+    const float inv = 1 / det;
+    const vec3f s = origin - tri[0];
+    const float u = s.dot(p) * inv;
+    if (u < 0 || u > 1)
+        return false;
+    const vec3f q = s.cross(e1);
+    const float v = direction.dot(q) * inv;
+    if (v < 0 || u + v > 1)
+        return false;
+    const float r = e2.dot(q) * inv;
+    if (r < 0 || r >= t)
+        return false;
+    t = r;
+    return true;
+}
+
+} // namespace
+
+CollisionMesh::CollisionMesh(std::vector<vec3f> &&tris)
+{
+    triangles.swap(tris);
+    const uint32 count = triangles.size() / 3;
+    aabb[0] = vec3f(inf1(), inf1(), inf1());
+    aabb[1] = -aabb[0];
+    if (count == 0)
+        return;
+
+    std::vector<uint32> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<vec3f> centroids(count);
+    for (uint32 i = 0; i < count; i++)
+    {
+        centroids[i] = (triangles[i * 3 + 0] + triangles[i * 3 + 1]
+            + triangles[i * 3 + 2]) / 3;
+    }
+    nodes.reserve(count);
+    build(order, centroids, 0, count);
+    aabb[0] = nodes[0].aabb[0];
+    aabb[1] = nodes[0].aabb[1];
+
+    // store the triangles in the order of the leaves
+    std::vector<vec3f> sorted;
+    sorted.reserve(triangles.size());
+    for (uint32 i : order)
+        for (uint32 j = 0; j < 3; j++)
+            sorted.push_back(triangles[i * 3 + j]);
+    triangles.swap(sorted);
+    nodes.shrink_to_fit();
+}
+
+uint32 CollisionMesh::build(std::vector<uint32> &order,
+    const std::vector<vec3f> &centroids, uint32 start, uint32 count)
+{
+    const uint32 index = nodes.size();
+    nodes.emplace_back();
+
+    vec3f box[2] = { vec3f(inf1(), inf1(), inf1()), vec3f() };
+    box[1] = -box[0];
+    vec3f cbox[2] = { box[0], box[1] };
+    for (uint32 i = start; i < start + count; i++)
+    {
+        const uint32 o = order[i];
+        for (uint32 j = 0; j < 3; j++)
+        {
+            box[0] = box[0].cwiseMin(triangles[o * 3 + j]);
+            box[1] = box[1].cwiseMax(triangles[o * 3 + j]);
+        }
+        cbox[0] = cbox[0].cwiseMin(centroids[o]);
+        cbox[1] = cbox[1].cwiseMax(centroids[o]);
+    }
+    nodes[index].aabb[0] = box[0];
+    nodes[index].aabb[1] = box[1];
+
+    // split at the median along the longest axis of the centroids
+    uint32 axis = 0;
+    const vec3f size = cbox[1] - cbox[0];
+    size.maxCoeff(&axis);
+    if (count <= LeafSize || !(size[axis] > 0))
+    {
+        nodes[index].start = start;
+        nodes[index].count = count;
+        return index;
+    }
+    const uint32 half = count / 2;
+    std::nth_element(order.begin() + start, order.begin() + start + half,
+        order.begin() + start + count, [&](uint32 a, uint32 b) {
+            return centroids[a][axis] < centroids[b][axis];
+    });
+    build(order, centroids, start, half); // first child follows the node
+    const uint32 second = build(order, centroids, start + half,
+        count - half);
+    nodes[index].start = second;
+    nodes[index].count = 0;
+    return index;
+}
+
+bool CollisionMesh::intersect(const vec3f &origin, const vec3f &direction,
+    float &t) const
+{
+    if (nodes.empty())
+        return false;
+    const vec3f invDirection = direction.cwiseInverse();
+    bool hit = false;
+    uint32 stack[StackSize];
+    uint32 top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const uint32 index = stack[--top];
+        const Node &n = nodes[index];
+        if (!rayBox(n.aabb, origin, invDirection, t))
+            continue;
+        if (n.count)
+        {
+            for (uint32 i = n.start; i < n.start + n.count; i++)
+                hit = rayTriangle(&triangles[i * 3], origin, direction, t)
+                    || hit;
+            continue;
+        }
+        assert(top + 2 <= StackSize);
+        stack[top++] = n.start;
+        stack[top++] = index + 1;
+    }
+    return hit;
+}
+
+uint32 CollisionMesh::memoryCost() const
+{
+    return sizeof(*this) + triangles.capacity() * sizeof(vec3f)
+        + nodes.capacity() * sizeof(Node);
+}
+
+} // namespace vts
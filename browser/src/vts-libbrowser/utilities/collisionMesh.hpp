@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COLLISIONMESH_H_q7w2ne5k
+#define COLLISIONMESH_H_q7w2ne5k
+
+#include <vector>
+
+#include "../include/vts-browser/math.hpp"
+
+namespace vts
+{
+
+// triangles with bounding volume hierarchy for ray casting
+class CollisionMesh : private Immovable
+{
+public:
+    // three vertices per triangle
+    explicit CollisionMesh(std::vector<vec3f> &&triangles);
+
+    // finds the nearest intersection of the ray with any triangle
+    //   at parameter from 0 to t, both sides of triangles are hit
+    // on input t is the maximum, on output the parameter of the hit
+    // returns false and leaves t unchanged when there is no hit
+    bool intersect(const vec3f &origin, const vec3f &direction,
+        float &t) const;
+
+    uint32 memoryCost() const;
+
+    vec3f aabb[2];
+
+private:
+    struct Node
+    {
+        vec3f aabb[2];
+        uint32 start; // first triangle of leaf or index of second child
+        uint32 count; // 0 for inner nodes
+    };
+
+    uint32 build(std::vector<uint32> &order,
+        const std::vector<vec3f> &centroids, uint32 start, uint32 count);
+
+    std::vector<vec3f> triangles;
+    std::vector<Node> nodes;
+};
+
+} // namespace vts
+
+#endif
@@ -55,9 +55,14 @@ void readDataUrl(const std::string &url,
     else
         contentType = url.substr(5, comma - 5);
 
-    buff = Buffer(base64
+    // the decoded string is adopted by the buffer without copying
+    auto s = std::make_shared<std::string>(base64
         ? utility::base64::decode(url.begin() + comma + 1, url.end())
         : utility::urlDecode(url.begin() + comma + 1, url.end()));
+    if (s->empty())
+        buff = Buffer();
+    else
+        buff = Buffer(s, &(*s)[0], s->size());
 }
 
 } // namespace vts
@@ -0,0 +1,171 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FRAMEARENA_H_q8v2nd5k
+#define FRAMEARENA_H_q8v2nd5k
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../include/vts-browser/foundation.hpp"
+
+namespace vts
+{
+
+// linear allocator for temporary containers, that live within one frame
+//   the individual deallocations are no-ops
+//   and all memory is reclaimed at once with reset
+// the blocks are retained between frames, so that the steady state frames
+//   do not allocate at all
+// not thread safe, each thread (eg. helper camera) needs its own arena
+class FrameArena : private Immovable
+{
+public:
+    explicit FrameArena(std::size_t blockSize = 64 * 1024)
+        : blockSize(blockSize)
+    {}
+
+    void *allocate(std::size_t size, std::size_t align)
+    {
+        if (!blocks.empty())
+        {
+            Block &b = blocks[current];
+            std::size_t p = (used + align - 1) & ~(align - 1);
+            if (p + size <= b.size)
+            {
+                used = p + size;
+                return b.data.get() + p;
+            }
+            if (current + 1 < blocks.size()
+                && size + align <= blocks[current + 1].size)
+            {
+                // the next retained block
+                current++;
+                used = 0;
+                return allocate(size, align);
+            }
+        }
+        // new block, the arena grows until it covers whole frame
+        const std::size_t s = std::max(blockSize, size + align);
+        Block b;
+        b.data.reset(new unsigned char[s]);
+        b.size = s;
+        blocks.push_back(std::move(b));
+        current = blocks.size() - 1;
+        used = 0;
+        total += s;
+        return allocate(size, align);
+    }
+
+    // invalidates all allocations from the arena
+    void reset()
+    {
+        // the frame needed multiple blocks
+        //   they are merged into one for the next frames
+        if (blocks.size() > 1 && current > 0)
+        {
+            blocks.clear();
+            blockSize = std::max(blockSize, total);
+            total = 0;
+        }
+        current = 0;
+        used = 0;
+    }
+
+    std::size_t memory() const
+    {
+        return total;
+    }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<unsigned char[]> data;
+        std::size_t size = 0;
+    };
+
+    std::vector<Block> blocks;
+    std::size_t blockSize = 0;
+    std::size_t current = 0;
+    std::size_t used = 0;
+    std::size_t total = 0;
+};
+
+// std compatible allocator, to be used with standard containers
+template<class T>
+class FrameAllocator
+{
+public:
+    typedef T value_type;
+
+    FrameAllocator(FrameArena &arena) : arena(&arena)
+    {}
+
+    template<class U>
+    FrameAllocator(const FrameAllocator<U> &other) : arena(other.arena)
+    {}
+
+    T *allocate(std::size_t n)
+    {
+        return (T*)arena->allocate(n * sizeof(T), alignof(T));
+    }
+
+    void deallocate(T *, std::size_t)
+    {}
+
+    template<class U>
+    bool operator == (const FrameAllocator<U> &other) const
+    {
+        return arena == other.arena;
+    }
+
+    template<class U>
+    bool operator != (const FrameAllocator<U> &other) const
+    {
+        return arena != other.arena;
+    }
+
+    FrameArena *arena;
+};
+
+template<class T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+template<class K, class H = std::hash<K>>
+using FrameSet = std::unordered_set<K, H, std::equal_to<K>,
+    FrameAllocator<K>>;
+
+template<class K, class V, class H = std::hash<K>>
+using FrameMap = std::unordered_map<K, V, H, std::equal_to<K>,
+    FrameAllocator<std::pair<const K, V>>>;
+
+} // namespace vts
+
+#endif
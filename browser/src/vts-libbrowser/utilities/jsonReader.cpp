@@ -0,0 +1,220 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "jsonReader.hpp"
+
+#include <dbglog/dbglog.hpp>
+
+#include <cstring>
+#include <cassert>
+
+namespace vts
+{
+
+JsonReader::JsonReader(const char *begin, const char *end)
+    : pos(begin), end(end)
+{
+    // same settings as in stringToJson
+    //   except that the parsed values need not be objects or arrays
+    Json::CharReaderBuilder builder;
+    builder.strictMode(&builder.settings_);
+    builder.settings_["allowSingleQuotes"] = true;
+    builder.settings_["strictRoot"] = false;
+    reader.reset(builder.newCharReader());
+}
+
+JsonReader::JsonReader(const std::string &text)
+    : JsonReader(text.data(), text.data() + text.size())
+{}
+
+JsonReader::~JsonReader()
+{}
+
+void JsonReader::skipWhitespace()
+{
+    while (pos < end && (*pos == ' ' || *pos == '\t'
+        || *pos == '\n' || *pos == '\r'))
+        pos++;
+}
+
+void JsonReader::skipString()
+{
+    assert(pos < end && (*pos == '"' || *pos == '\''));
+    const char quote = *pos++;
+    while (pos < end && *pos != quote)
+    {
+        if (*pos == '\\')
+            pos++;
+        pos++;
+    }
+    if (pos >= end)
+        LOGTHROW(err2, std::runtime_error) << "Unterminated json string";
+    pos++;
+}
+
+void JsonReader::expect(char c)
+{
+    skipWhitespace();
+    if (pos >= end || *pos != c)
+    {
+        LOGTHROW(err2, std::runtime_error) << "Expected <" << c
+            << "> in json";
+    }
+    pos++;
+}
+
+bool JsonReader::beginObject()
+{
+    skipWhitespace();
+    if (pos >= end || *pos != '{')
+        return false;
+    pos++;
+    return true;
+}
+
+bool JsonReader::nextMember(std::string &key)
+{
+    skipWhitespace();
+    if (pos < end && *pos == ',')
+    {
+        pos++;
+        skipWhitespace();
+    }
+    if (pos < end && *pos == '}')
+    {
+        pos++;
+        return false;
+    }
+    if (pos >= end || (*pos != '"' && *pos != '\''))
+        LOGTHROW(err2, std::runtime_error) << "Expected json object key";
+    const char *b = pos;
+    skipString();
+    if (memchr(b, '\\', pos - b))
+        key = parse({ b, pos }).asString();
+    else
+        key.assign(b + 1, pos - 1);
+    expect(':');
+    return true;
+}
+
+bool JsonReader::beginArray()
+{
+    skipWhitespace();
+    if (pos >= end || *pos != '[')
+        return false;
+    pos++;
+    return true;
+}
+
+bool JsonReader::nextElement()
+{
+    skipWhitespace();
+    if (pos < end && *pos == ',')
+        pos++;
+    skipWhitespace();
+    if (pos < end && *pos == ']')
+    {
+        pos++;
+        return false;
+    }
+    if (pos >= end)
+        LOGTHROW(err2, std::runtime_error) << "Unterminated json array";
+    return true;
+}
+
+JsonSpan JsonReader::skipValue()
+{
+    skipWhitespace();
+    JsonSpan s;
+    s.begin = pos;
+    if (pos >= end)
+        LOGTHROW(err2, std::runtime_error) << "Expected json value";
+    switch (*pos)
+    {
+    case '"':
+    case '\'':
+        skipString();
+        break;
+    case '{':
+    case '[':
+    {
+        uint32 depth = 0;
+        while (pos < end)
+        {
+            switch (*pos)
+            {
+            case '"':
+            case '\'':
+                skipString();
+                continue;
+            case '{':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ']':
+                depth--;
+                break;
+            }
+            pos++;
+            if (depth == 0)
+                break;
+        }
+        if (depth != 0)
+            LOGTHROW(err2, std::runtime_error) << "Unterminated json value";
+    } break;
+    default:
+        // number, boolean or null
+        while (pos < end && !strchr(",}] \t\r\n", *pos))
+            pos++;
+        break;
+    }
+    s.end = pos;
+    return s;
+}
+
+Json::Value JsonReader::parseValue()
+{
+    return parse(skipValue());
+}
+
+void JsonReader::seek(const JsonSpan &span)
+{
+    pos = span.begin;
+    end = span.end;
+}
+
+Json::Value JsonReader::parse(const JsonSpan &span)
+{
+    Json::Value val;
+    std::string errs;
+    if (!reader->parse(span.begin, span.end, &val, &errs))
+        LOGTHROW(err2, std::runtime_error) << errs;
+    return val;
+}
+
+} // namespace vts
@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef JSONREADER_HPP_fh47dhw9s
+#define JSONREADER_HPP_fh47dhw9s
+
+#include "json.hpp"
+
+#include <memory>
+
+namespace vts
+{
+
+// range of characters with a single json value
+struct JsonSpan
+{
+    const char *begin = nullptr;
+    const char *end = nullptr;
+};
+
+// incremental reader of json text
+//   walks objects and arrays without building the document
+//   and parses only the selected values into Json::Value
+class JsonReader
+{
+public:
+    JsonReader(const char *begin, const char *end);
+    explicit JsonReader(const std::string &text);
+    ~JsonReader();
+
+    // consumes opening bracket, returns false if the value is not an object
+    bool beginObject();
+    // consumes next key, returns false at the end of the object
+    bool nextMember(std::string &key);
+
+    // consumes opening bracket, returns false if the value is not an array
+    bool beginArray();
+    // returns false at the end of the array
+    bool nextElement();
+
+    // moves past the next value
+    JsonSpan skipValue();
+
+    // parses the next value
+    Json::Value parseValue();
+
+    // parses previously skipped value
+    Json::Value parse(const JsonSpan &span);
+
+    // continues reading in previously skipped value
+    void seek(const JsonSpan &span);
+
+private:
+    void skipWhitespace();
+    void skipString();
+    void expect(char c);
+
+    const char *pos;
+    const char *end;
+    std::unique_ptr<Json::CharReader> reader;
+};
+
+} // namespace vts
+
+#endif
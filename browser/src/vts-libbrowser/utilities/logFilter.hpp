@@ -0,0 +1,60 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef LOG_FILTER_HPP_se4f8t6h
+#define LOG_FILTER_HPP_se4f8t6h
+
+#include <dbglog/dbglog.hpp>
+
+// minimum level of log statements compiled into the library
+//   see VTS_BROWSER_LOG_MIN_LEVEL in cmake
+// the value is an index into the levels below, 0 keeps all statements
+#ifndef VTS_LOG_MIN_LEVEL
+#define VTS_LOG_MIN_LEVEL 0
+#endif
+
+namespace vts { namespace logFilter
+{
+
+enum Level
+{
+    debug, info1, info2, info3, info4,
+    warn1, warn2, warn3, warn4,
+    err1, err2, err3, err4, fatal,
+};
+
+} } // namespace vts::logFilter
+
+// same as LOG, for statements in frequently executed code
+// statements below the minimum level are removed by the compiler,
+//   including the evaluation of their arguments
+// levels filtered at runtime are left to dbglog,
+//   which tests the level before formatting the arguments
+#define VTS_LOG(level) \
+    if (::vts::logFilter::level < VTS_LOG_MIN_LEVEL) {} \
+    else LOG(level)
+
+#endif
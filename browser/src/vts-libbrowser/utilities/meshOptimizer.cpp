@@ -0,0 +1,351 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "meshOptimizer.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+
+namespace vts
+{
+
+namespace
+{
+
+const uint32 CacheSize = VertexCacheSize;
+const float CacheDecayPower = 1.5f;
+const float LastTriScore = 0.75f;
+const float ValenceBoostScale = 2.0f;
+const float ValenceBoostPower = 0.5f;
+const uint32 Invalid = (uint32)-1;
+
+struct Vertex
+{
+    uint32 adjacencyStart = 0;
+    uint32 remaining = 0; // number of triangles not yet emitted
+    uint32 cachePos = Invalid;
+    float score = 0;
+};
+
+float vertexScore(const Vertex &v)
+{
+    if (v.remaining == 0)
+        return -1;
+    float score = 0;
+    if (v.cachePos != Invalid)
+    {
+        if (v.cachePos < 3)
+        {
+            // the vertices of the last triangle get fixed score
+            //   so that the next triangle does not just reuse them
+            score = LastTriScore;
+        }
+        else
+        {
+            assert(v.cachePos < CacheSize);
+            const float scaler = 1.0f / (CacheSize - 3);
+            score = std::pow(1.0f - (v.cachePos - 3) * scaler,
+                CacheDecayPower);
+        }
+    }
+    // boost vertices with few remaining triangles
+    //   to finish them and avoid leaving lonely triangles behind
+    score += ValenceBoostScale * std::pow((float)v.remaining,
+        -ValenceBoostPower);
+    return score;
+}
+
+} // namespace
+
+void optimizeVertexCache(uint16 *indices, uint32 indicesCount,
+                         uint32 verticesCount)
+{
+    assert((indicesCount % 3) == 0);
+    const uint32 trianglesCount = indicesCount / 3;
+    if (trianglesCount < 2)
+        return;
+
+    // triangle adjacency of each vertex
+    std::vector<Vertex> verts(verticesCount);
+    for (uint32 i = 0; i < indicesCount; i++)
+    {
+        assert(indices[i] < verticesCount);
+        verts[indices[i]].remaining++;
+    }
+    {
+        uint32 off = 0;
+        for (Vertex &v : verts)
+        {
+            v.adjacencyStart = off;
+            off += v.remaining;
+        }
+    }
+    std::vector<uint32> adjacency(indicesCount);
+    {
+        std::vector<uint32> filled(verticesCount, 0);
+        for (uint32 i = 0; i < indicesCount; i++)
+        {
+            const Vertex &v = verts[indices[i]];
+            adjacency[v.adjacencyStart + filled[indices[i]]++] = i / 3;
+        }
+    }
+
+    // initial scores
+    for (Vertex &v : verts)
+        v.score = vertexScore(v);
+    std::vector<float> triScores(trianglesCount);
+    std::vector<bool> triEmitted(trianglesCount, false);
+    for (uint32 t = 0; t < trianglesCount; t++)
+    {
+        triScores[t] = verts[indices[t * 3 + 0]].score
+            + verts[indices[t * 3 + 1]].score
+            + verts[indices[t * 3 + 2]].score;
+    }
+
+    std::vector<uint16> result;
+    result.reserve(indicesCount);
+    std::vector<uint32> cache, newCache;
+    cache.reserve(CacheSize + 3);
+    newCache.reserve(CacheSize + 3);
+    uint32 bestTri = Invalid;
+
+    for (uint32 emitted = 0; emitted < trianglesCount; emitted++)
+    {
+        if (bestTri == Invalid)
+        {
+            // no candidate in the cache, search all triangles
+            float bestScore = -1;
+            for (uint32 t = 0; t < trianglesCount; t++)
+            {
+                if (!triEmitted[t] && triScores[t] > bestScore)
+                {
+                    bestScore = triScores[t];
+                    bestTri = t;
+                }
+            }
+        }
+        assert(bestTri != Invalid);
+
+        // emit the triangle
+        const uint16 *tri = indices + bestTri * 3;
+        triEmitted[bestTri] = true;
+        for (uint32 j = 0; j < 3; j++)
+        {
+            result.push_back(tri[j]);
+
+            // remove the triangle from the adjacency of the vertex
+            Vertex &v = verts[tri[j]];
+            uint32 *adj = adjacency.data() + v.adjacencyStart;
+            for (uint32 k = 0; k < v.remaining; k++)
+            {
+                if (adj[k] == bestTri)
+                {
+                    adj[k] = adj[v.remaining - 1];
+                    break;
+                }
+            }
+            assert(v.remaining > 0);
+            v.remaining--;
+        }
+
+        // move the vertices of the triangle to the front of the cache
+        newCache.clear();
+        for (uint32 j = 0; j < 3; j++)
+        {
+            bool dup = false;
+            for (uint32 c : newCache)
+                dup = dup || c == tri[j];
+            if (!dup)
+                newCache.push_back(tri[j]);
+        }
+        for (uint32 c : cache)
+        {
+            if (c != tri[0] && c != tri[1] && c != tri[2])
+                newCache.push_back(c);
+        }
+        for (uint32 i = 0, e = newCache.size(); i < e; i++)
+        {
+            verts[newCache[i]].cachePos = i < CacheSize ? i : Invalid;
+            verts[newCache[i]].score = vertexScore(verts[newCache[i]]);
+        }
+        if (newCache.size() > CacheSize)
+            newCache.resize(CacheSize);
+        std::swap(cache, newCache);
+
+        // update scores of the affected triangles
+        //   newCache now holds the previous cache
+        //   with the vertices that fell out of the cache
+        bestTri = Invalid;
+        float bestScore = -1;
+        for (uint32 c : newCache)
+        {
+            const Vertex &v = verts[c];
+            if (v.cachePos != Invalid)
+                continue; // already handled in the cache
+            const uint32 *adj = adjacency.data() + v.adjacencyStart;
+            for (uint32 k = 0; k < v.remaining; k++)
+            {
+                const uint16 *t = indices + adj[k] * 3;
+                triScores[adj[k]] = verts[t[0]].score
+                    + verts[t[1]].score + verts[t[2]].score;
+            }
+        }
+        for (uint32 c : cache)
+        {
+            const Vertex &v = verts[c];
+            const uint32 *adj = adjacency.data() + v.adjacencyStart;
+            for (uint32 k = 0; k < v.remaining; k++)
+            {
+                const uint16 *t = indices + adj[k] * 3;
+                float s = verts[t[0]].score
+                    + verts[t[1]].score + verts[t[2]].score;
+                triScores[adj[k]] = s;
+                if (s > bestScore)
+                {
+                    bestScore = s;
+                    bestTri = adj[k];
+                }
+            }
+        }
+    }
+
+    assert(result.size() == indicesCount);
+    memcpy(indices, result.data(), indicesCount * sizeof(uint16));
+}
+
+void optimizeVertexFetch(char *vertices, uint32 vertexSize,
+                         uint32 verticesCount,
+                         uint16 *indices, uint32 indicesCount)
+{
+    std::vector<uint32> remap(verticesCount, Invalid);
+    uint32 next = 0;
+    for (uint32 i = 0; i < indicesCount; i++)
+    {
+        uint32 &r = remap[indices[i]];
+        if (r == Invalid)
+            r = next++;
+        indices[i] = r;
+    }
+
+    // vertices not referenced by any triangle are kept at the end
+    for (uint32 &r : remap)
+        if (r == Invalid)
+            r = next++;
+    assert(next == verticesCount);
+
+    std::vector<char> tmp(vertices, vertices + verticesCount * vertexSize);
+    for (uint32 i = 0; i < verticesCount; i++)
+    {
+        memcpy(vertices + remap[i] * vertexSize,
+            tmp.data() + i * vertexSize, vertexSize);
+    }
+}
+
+uint32 simulateVertexCache(const uint16 *indices, uint32 indicesCount,
+                           uint32 cacheSize)
+{
+    // most recently used first
+    std::vector<uint32> lru;
+    lru.reserve(cacheSize + 1);
+    uint32 misses = 0;
+    for (uint32 i = 0; i < indicesCount; i++)
+    {
+        auto it = std::find(lru.begin(), lru.end(), (uint32)indices[i]);
+        if (it == lru.end())
+        {
+            misses++;
+            lru.insert(lru.begin(), indices[i]);
+            if (lru.size() > cacheSize)
+                lru.pop_back();
+        }
+        else
+            std::rotate(lru.begin(), it, it + 1);
+    }
+    return misses;
+}
+
+void simplifyVertexClustering(std::vector<vec3f> &positions,
+                              std::vector<uint16> &indices, float cellSize)
+{
+    if (cellSize <= 0)
+        return;
+
+    // 21 bits per axis, wrapping is harmless for normalized coordinates
+    const auto key = [&](const vec3f &p) -> uint64 {
+        uint64 k = 0;
+        for (uint32 i = 0; i < 3; i++)
+        {
+            sint64 c = (sint64)std::floor(p[i] / cellSize);
+            k = (k << 21) | ((uint64)c & 0x1fffff);
+        }
+        return k;
+    };
+
+    std::unordered_map<uint64, uint16> cells;
+    cells.reserve(positions.size());
+    std::vector<uint16> remap(positions.size());
+    std::vector<vec3f> sums;
+    std::vector<uint32> counts;
+    for (uint32 i = 0, e = positions.size(); i < e; i++)
+    {
+        auto it = cells.emplace(key(positions[i]), (uint16)sums.size());
+        if (it.second)
+        {
+            sums.push_back(vec3f(0, 0, 0));
+            counts.push_back(0);
+        }
+        const uint16 c = it.first->second;
+        remap[i] = c;
+        sums[c] += positions[i];
+        counts[c]++;
+    }
+    for (uint32 c = 0, e = sums.size(); c < e; c++)
+        sums[c] /= (float)counts[c];
+
+    std::vector<uint16> out;
+    out.reserve(indices.size());
+    for (uint32 i = 0, e = indices.size(); i + 2 < e; i += 3)
+    {
+        const uint16 a = remap[indices[i + 0]];
+        const uint16 b = remap[indices[i + 1]];
+        const uint16 c = remap[indices[i + 2]];
+        if (a == b || b == c || c == a)
+            continue;
+        out.push_back(a);
+        out.push_back(b);
+        out.push_back(c);
+    }
+
+    positions.swap(sums);
+    indices.swap(out);
+}
+
+} // namespace vts
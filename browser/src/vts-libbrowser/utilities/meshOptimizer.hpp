@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef MESHOPTIMIZER_H_dh38cm1z
+#define MESHOPTIMIZER_H_dh38cm1z
+
+#include <vector>
+
+#include "../include/vts-browser/math.hpp"
+
+namespace vts
+{
+
+// size of the modeled lru post-transform vertex cache
+static const uint32 VertexCacheSize = 32;
+
+// reorder triangles for better utilization of the post-transform vertex cache
+// uses the linear-speed algorithm by Tom Forsyth
+void optimizeVertexCache(uint16 *indices, uint32 indicesCount,
+                         uint32 verticesCount);
+
+// reorder vertices in the order of their first use by the indices
+// the indices are updated accordingly
+void optimizeVertexFetch(char *vertices, uint32 vertexSize,
+                         uint32 verticesCount,
+                         uint16 *indices, uint32 indicesCount);
+
+// number of vertex transformations with simulated lru cache
+//   the same cache model as used by optimizeVertexCache
+// divide by the number of triangles to obtain the acmr
+uint32 simulateVertexCache(const uint16 *indices, uint32 indicesCount,
+                           uint32 cacheSize = VertexCacheSize);
+
+// merge vertices falling into same cell of a uniform grid
+//   each cell is represented by the average of its vertices
+//   triangles collapsed by the merge are removed
+// the positions are compacted and the indices updated accordingly
+void simplifyVertexClustering(std::vector<vec3f> &positions,
+                              std::vector<uint16> &indices, float cellSize);
+
+} // namespace vts
+
+#endif
@@ -0,0 +1,108 @@
+/**
+* Copyright (c) 2017 Melown Technologies SE
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* *  Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+*
+* *  Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef VC_EXTRALEAN
+#define VC_EXTRALEAN
+#endif
+#include <windows.h>
+#endif // _WIN32
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __APPLE__
+#include <pthread.h>
+#include <sys/qos.h>
+#endif
+
+#include <algorithm>
+#include <dbglog/dbglog.hpp>
+
+#include "threadPriority.hpp"
+
+namespace vts
+{
+
+void setThreadPriority(sint32 priority, uint64 affinity)
+{
+    priority = std::max(-2, std::min(2, priority));
+
+#ifdef _WIN32
+    if (priority != 0 && !SetThreadPriority(GetCurrentThread(), priority))
+        LOG(warn2) << "Failed to set thread priority <" << priority << ">";
+    if (affinity && !SetThreadAffinityMask(GetCurrentThread(),
+        (DWORD_PTR)affinity))
+        LOG(warn2) << "Failed to set thread affinity <" << affinity << ">";
+#endif
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+    // the niceness applies to individual threads on linux
+    if (priority != 0 && setpriority(PRIO_PROCESS,
+        (id_t)syscall(SYS_gettid), -5 * priority) != 0)
+        LOG(warn2) << "Failed to set thread priority <" << priority << ">";
+    if (affinity)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (uint32 i = 0; i < 64 && i < CPU_SETSIZE; i++)
+            if (affinity & ((uint64)1 << i))
+                CPU_SET(i, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            LOG(warn2) << "Failed to set thread affinity <"
+                << affinity << ">";
+    }
+#endif
+
+#ifdef __APPLE__
+    // there is no affinity on apple platforms
+    if (priority != 0)
+    {
+        static const qos_class_t classes[] = {
+            QOS_CLASS_BACKGROUND,
+            QOS_CLASS_UTILITY,
+            QOS_CLASS_DEFAULT,
+            QOS_CLASS_USER_INITIATED,
+            QOS_CLASS_USER_INTERACTIVE,
+        };
+        if (pthread_set_qos_class_self_np(classes[priority + 2], 0) != 0)
+            LOG(warn2) << "Failed to set thread qos <" << priority << ">";
+    }
+#endif
+
+    (void)priority;
+    (void)affinity;
+}
+
+} // namespace vts
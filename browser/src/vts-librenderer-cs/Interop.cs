@@ -56,6 +56,9 @@ public static extern void vtsLoadGlFunctions(GLADloadproc functionLoader);
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern IntPtr vtsRenderContextCreate();
 
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+public static extern IntPtr vtsRenderContextCreateShared(IntPtr shareWith);
+
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern void vtsRenderContextDestroy(IntPtr context);
 
@@ -43,6 +43,13 @@ namespace vts
             Util.CheckInterop();
         }
 
+        // shares the gpu resources of another context (in the same gl share group)
+        public RenderContext(RenderContext shareWith)
+        {
+            Handle = RendererInterop.vtsRenderContextCreateShared(shareWith.Handle);
+            Util.CheckInterop();
+        }
+
         public void BindLoadFunctions(Map map)
         {
             RendererInterop.vtsRenderContextBindLoadFunctions(Handle, map.Handle);
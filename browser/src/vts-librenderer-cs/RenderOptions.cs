@@ -29,25 +29,35 @@ using System.Runtime.InteropServices;
 
 namespace vts
 {
+    // blittable mirror of vtsCRenderOptionsBase
+    //   the bools are single bytes, as in c
     [StructLayout(LayoutKind.Sequential)]
     public struct RenderOptions
     {
-        [MarshalAs(UnmanagedType.R4)] public float textScale;
-        [MarshalAs(UnmanagedType.U4)] public uint width;
-        [MarshalAs(UnmanagedType.U4)] public uint height;
-        [MarshalAs(UnmanagedType.U4)] public uint targetFrameBuffer;
-        [MarshalAs(UnmanagedType.U4)] public uint targetViewportX;
-        [MarshalAs(UnmanagedType.U4)] public uint targetViewportY;
-        [MarshalAs(UnmanagedType.U4)] public uint targetViewportW;
-        [MarshalAs(UnmanagedType.U4)] public uint targetViewportH;
-        [MarshalAs(UnmanagedType.U4)] public uint antialiasingSamples;
-        [MarshalAs(UnmanagedType.U4)] public uint renderGeodataDebug;
-        [MarshalAs(UnmanagedType.I1)] public bool renderAtmosphere;
-        [MarshalAs(UnmanagedType.I1)] public bool renderPolygonEdges;
-        [MarshalAs(UnmanagedType.I1)] public bool flatShading;
-        [MarshalAs(UnmanagedType.I1)] public bool geodataHysteresis;
-        [MarshalAs(UnmanagedType.I1)] public bool debugDepthFeedback;
-        [MarshalAs(UnmanagedType.I1)] public bool colorToTargetFrameBuffer;
-        [MarshalAs(UnmanagedType.I1)] public bool colorToTexture;
+        public float textScale;
+        public uint width;
+        public uint height;
+        public uint targetFrameBuffer;
+        public uint targetViewportX;
+        public uint targetViewportY;
+        public uint targetViewportW;
+        public uint targetViewportH;
+        public uint antialiasingSamples;
+        public uint debugGeodataMode;
+        public byte renderAtmosphere;
+        public byte geodataHysteresis;
+        public byte colorRenderWithAlpha;
+        public byte debugFlatShading;
+        public byte debugWireframe;
+        public byte debugDepthFeedback;
+        public byte colorToTargetFrameBuffer;
+        public byte colorToTexture;
+        public float geodataJobsReuse;
+        public byte reverseDepth;
+        public float dynamicResolutionBudget;
+        public float dynamicResolutionMinScale;
+        public uint backgroundDownscale;
+        public uint farFieldResolution;
+        public uint recordingThreads;
     }
 }
@@ -66,29 +66,30 @@ namespace vts
             return res;
         }
 
-        public RenderOptions Options
+        // the structs are copied directly from/to the native memory
+        public unsafe RenderOptions Options
         {
             get
             {
                 IntPtr p = RendererInterop.vtsRenderViewOptions(Handle);
                 Util.CheckInterop();
-                return (RenderOptions)Marshal.PtrToStructure(p, typeof(RenderOptions));
+                return *(RenderOptions*)p;
             }
             set
             {
                 IntPtr p = RendererInterop.vtsRenderViewOptions(Handle);
                 Util.CheckInterop();
-                Marshal.StructureToPtr(value, p, false);
+                *(RenderOptions*)p = value;
             }
         }
 
-        public RenderVariables Variables
+        public unsafe RenderVariables Variables
         {
             get
             {
                 IntPtr p = RendererInterop.vtsRenderViewVariables(Handle);
                 Util.CheckInterop();
-                return (RenderVariables)Marshal.PtrToStructure(p, typeof(RenderVariables));
+                return *(RenderVariables*)p;
             }
         }
 
@@ -27,6 +27,9 @@
 #include "renderer.hpp"
 
 #include <thread>
+#include <algorithm>
+#include <tuple>
+#include <sstream>
 
 #include <optick.h>
 
@@ -85,6 +88,56 @@ void setDebugLabel(GLenum type, GLuint id, std::string name)
 
 } // namespace
 
+struct Shader::Pending
+{
+    std::string binaryPath; // empty = do not store
+    std::string vertexSource;
+    std::string fragmentSource;
+    uint32 vertex = 0;
+    uint32 fragment = 0;
+    std::vector<std::pair<std::string, uint32>> uniforms; // name, index
+    std::vector<std::pair<std::string, uint32>> textures;
+    std::vector<std::pair<std::string, uint32>> blocks;
+};
+
+std::string Shader::binaryCachePath;
+
+namespace
+{
+
+std::string programBinaryPath(const std::string &vertexShader,
+    const std::string &fragmentShader)
+{
+    if (Shader::binaryCachePath.empty() || programBinaryFormats.empty())
+        return "";
+
+    // fnv-1a of the driver identification and the sources
+    uint64 hash = 14695981039346656037ull;
+    const auto add = [&](const std::string &str) {
+        for (char c : str)
+        {
+            hash ^= (unsigned char)c;
+            hash *= 1099511628211ull;
+        }
+        hash ^= 0xff;
+        hash *= 1099511628211ull;
+    };
+    add((const char *)glGetString(GL_VENDOR));
+    add((const char *)glGetString(GL_RENDERER));
+    add((const char *)glGetString(GL_VERSION));
+    add(vertexShader);
+    add(fragmentShader);
+
+    std::stringstream ss;
+    ss << Shader::binaryCachePath;
+    if (Shader::binaryCachePath.back() != '/')
+        ss << '/';
+    ss << std::hex << hash << ".bin";
+    return ss.str();
+}
+
+} // namespace
+
 Shader::Shader()
 {
     uniformLocations.reserve(20);
@@ -92,6 +145,12 @@ Shader::Shader()
 
 void Shader::clear()
 {
+    if (pending)
+    {
+        glDeleteShader(pending->vertex);
+        glDeleteShader(pending->fragment);
+        pending.reset();
+    }
     if (id)
         glDeleteProgram(id);
     id = 0;
@@ -110,6 +169,8 @@ void Shader::setDebugId(const std::string &name)
 
 void Shader::bind()
 {
+    if (pending)
+        finishLoad();
     assert(id > 0);
     glUseProgram(id);
 }
@@ -117,13 +178,18 @@ void Shader::bind()
 int Shader::loadShader(const std::string &source, int stage) const
 {
     GLuint s = glCreateShader(stage);
+    GLchar *src = (GLchar*)source.c_str();
+    GLint len = source.length();
+    glShaderSource(s, 1, &src, &len);
+    glCompileShader(s);
+    return s;
+}
+
+void Shader::checkShader(int s, const std::string &source) const
+{
     try
     {
-        GLchar *src = (GLchar*)source.c_str();
-        GLint len = source.length();
-        glShaderSource(s, 1, &src, &len);
-        glCompileShader(s);
-
+        GLint len = 0;
         glGetShaderiv(s, GL_INFO_LOG_LENGTH, &len);
         if (len > 5)
         {
@@ -142,36 +208,114 @@ int Shader::loadShader(const std::string &source, int stage) const
     }
     catch (...)
     {
-        glDeleteShader(s);
         vts::log(vts::LogLevel::err4,
             std::string("shader source: \n") + source);
         vts::log(vts::LogLevel::err4,
             std::string("shader name: <" + debugId + ">"));
         throw;
     }
-    return s;
+}
+
+bool Shader::loadBinary(const std::string &path)
+{
+    Buffer buf;
+    try
+    {
+        buf = readLocalFileBuffer(path);
+    }
+    catch (...)
+    {
+        return false;
+    }
+    if (buf.size() <= sizeof(uint32))
+        return false;
+    uint32 format = 0;
+    memcpy(&format, buf.data(), sizeof(uint32));
+    if (std::find(programBinaryFormats.begin(), programBinaryFormats.end(),
+        format) == programBinaryFormats.end())
+        return false;
+
+    // the driver may reject the binary without raising an error
+    glProgramBinary(id, format, buf.data() + sizeof(uint32),
+        buf.size() - sizeof(uint32));
+    GLint status = 0;
+    glGetProgramiv(id, GL_LINK_STATUS, &status);
+    CHECK_GL("load shader program binary");
+    return status == GL_TRUE;
+}
+
+void Shader::storeBinary(const std::string &path)
+{
+    GLint len = 0;
+    glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &len);
+    if (len <= 0)
+        return;
+    Buffer buf(len + sizeof(uint32));
+    GLenum format = 0;
+    glGetProgramBinary(id, len, &len, &format,
+        buf.data() + sizeof(uint32));
+    CHECK_GL("store shader program binary");
+    uint32 f = format;
+    memcpy(buf.data(), &f, sizeof(uint32));
+    try
+    {
+        writeLocalFileBuffer(path, buf);
+    }
+    catch (const std::exception &e)
+    {
+        vts::log(vts::LogLevel::warn2,
+            std::string("failed to store shader program binary: ")
+            + e.what());
+    }
 }
 
 void Shader::load(const std::string &vertexShader,
                   const std::string &fragmentShader)
 {
     clear();
+    std::string vert = preamble + "#define VTS_STAGE_VERTEX\n"
+        + vertexShader;
+    std::string frag = preamble + "#define VTS_STAGE_FRAGMENT\n"
+        + fragmentShader;
+    std::string binaryPath = programBinaryPath(vert, frag);
     id = glCreateProgram();
+    if (!binaryPath.empty() && loadBinary(binaryPath))
+    {
+        setDebugId(debugId);
+        CHECK_GL("load shader program");
+        return;
+    }
+
+    pending = std::make_unique<Pending>();
+    pending->binaryPath = binaryPath;
+    pending->vertex = loadShader(vert, GL_VERTEX_SHADER);
+    pending->fragment = loadShader(frag, GL_FRAGMENT_SHADER);
+    pending->vertexSource = std::move(vert);
+    pending->fragmentSource = std::move(frag);
+    glAttachShader(id, pending->vertex);
+    glAttachShader(id, pending->fragment);
+    if (!binaryPath.empty())
+        glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(id);
+    setDebugId(debugId);
+
+    // the driver compiles the program in background
+    //   until the status is queried
+    if (!parallelShaderCompile)
+        finishLoad();
+}
+
+void Shader::finishLoad()
+{
+    assert(pending);
+    std::unique_ptr<Pending> p = std::move(pending);
     try
     {
-        GLuint v = loadShader(preamble
-            + "#define VTS_STAGE_VERTEX\n"
-            + vertexShader,
-            GL_VERTEX_SHADER);
-        GLuint f = loadShader(preamble
-            + "#define VTS_STAGE_FRAGMENT\n"
-            + fragmentShader,
-            GL_FRAGMENT_SHADER);
-        glAttachShader(id, v);
-        glAttachShader(id, f);
-        glLinkProgram(id);
-        glDeleteShader(v);
-        glDeleteShader(f);
+        checkShader(p->vertex, p->vertexSource);
+        checkShader(p->fragment, p->fragmentSource);
+        glDeleteShader(p->vertex);
+        glDeleteShader(p->fragment);
+        p->vertex = p->fragment = 0;
 
         GLint len = 0;
         glGetProgramiv(id, GL_INFO_LOG_LENGTH, &len);
@@ -190,19 +334,32 @@ void Shader::load(const std::string &vertexShader,
     }
     catch(...)
     {
+        glDeleteShader(p->vertex);
+        glDeleteShader(p->fragment);
         glDeleteProgram(id);
         id = 0;
         throw;
     }
-    setDebugId(debugId);
+
+    for (auto &it : p->uniforms)
+        uniformLocations[it.second] = glGetUniformLocation(id,
+            it.first.c_str());
+    glUseProgram(id);
+    for (auto &it : p->textures)
+        glUniform1i(glGetUniformLocation(id, it.first.c_str()), it.second);
+    for (auto &it : p->blocks)
+        glUniformBlockBinding(id,
+            glGetUniformBlockIndex(id, it.first.c_str()), it.second);
+    if (!p->binaryPath.empty())
+        storeBinary(p->binaryPath);
     CHECK_GL("load shader program");
 }
 
 void Shader::loadInternal(const std::string &vertexName,
                   const std::string &fragmentName)
 {
-    Buffer vert = readInternalMemoryBuffer(vertexName);
-    Buffer frag = readInternalMemoryBuffer(fragmentName);
+    Buffer vert = shareInternalMemoryBuffer(vertexName);
+    Buffer frag = shareInternalMemoryBuffer(fragmentName);
     load(vert.str(), frag.str());
 }
 
@@ -275,8 +432,17 @@ uint32 Shader::getId() const
 
 uint32 Shader::loadUniformLocations(const std::vector<const char *> &names)
 {
-    bind();
     uint32 res = uniformLocations.size();
+    if (pending)
+    {
+        for (auto &it : names)
+        {
+            pending->uniforms.emplace_back(it, uniformLocations.size());
+            uniformLocations.push_back(-1);
+        }
+        return res;
+    }
+    bind();
     for (auto &it : names)
         uniformLocations.push_back(glGetUniformLocation(id, it));
     return res;
@@ -285,6 +451,12 @@ uint32 Shader::loadUniformLocations(const std::vector<const char *> &names)
 void Shader::bindTextureLocations(
     const std::vector<std::pair<const char *, uint32>> &binds)
 {
+    if (pending)
+    {
+        for (auto &it : binds)
+            pending->textures.emplace_back(it.first, it.second);
+        return;
+    }
     bind();
     for (auto &it : binds)
         glUniform1i(glGetUniformLocation(id, it.first), it.second);
@@ -293,6 +465,12 @@ void Shader::bindTextureLocations(
 void Shader::bindUniformBlockLocations(
     const std::vector<std::pair<const char *, uint32>> &binds)
 {
+    if (pending)
+    {
+        for (auto &it : binds)
+            pending->blocks.emplace_back(it.first, it.second);
+        return;
+    }
     for (auto &it : binds)
         glUniformBlockBinding(id,
             glGetUniformBlockIndex(id, it.first), it.second);
@@ -303,9 +481,20 @@ Texture::Texture()
 
 void Texture::clear()
 {
+    if (page)
+    {
+        // the texture array is owned by the page
+        page->release(layer);
+        page.reset();
+        id = 0;
+    }
     if (id)
         glDeleteTextures(1, &id);
     id = 0;
+    layer = 0;
+    if (uploadFence)
+        glDeleteSync((GLsync)uploadFence);
+    uploadFence = nullptr;
 }
 
 Texture::~Texture()
@@ -316,13 +505,21 @@ Texture::~Texture()
 void Texture::setDebugId(const std::string &name)
 {
     this->debugId = name;
-    setDebugLabel(GL_TEXTURE, id, name);
+    if (!page)
+        setDebugLabel(GL_TEXTURE, id, name);
 }
 
 void Texture::bind()
 {
     assert(id > 0);
-    glBindTexture(GL_TEXTURE_2D, id);
+    if (uploadFence)
+    {
+        // waits on the gpu, the cpu continues
+        glWaitSync((GLsync)uploadFence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync((GLsync)uploadFence);
+        uploadFence = nullptr;
+    }
+    glBindTexture(page ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, id);
 }
 
 namespace
@@ -445,6 +642,30 @@ void enforceUsingMipMaps(GpuTextureSpec::FilterMode &filterMode)
     }
 }
 
+bool usesMipmaps(GpuTextureSpec::FilterMode filterMode)
+{
+    switch (filterMode)
+    {
+    case GpuTextureSpec::FilterMode::Nearest:
+    case GpuTextureSpec::FilterMode::Linear:
+        return false;
+    default:
+        return true;
+    }
+}
+
+uint32 mipmapLevelsCount(uint32 w, uint32 h)
+{
+    uint32 levels = 1;
+    while (w > 1 || h > 1)
+    {
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+        levels++;
+    }
+    return levels;
+}
+
 bool gpuTypeInteger(GpuTypeEnum type)
 {
     switch (type)
@@ -466,16 +687,94 @@ bool gpuTypeInteger(GpuTypeEnum type)
 void Texture::load(ResourceInfo &info, vts::GpuTextureSpec &spec,
     const std::string &debugId)
 {
-    assert(spec.buffer.size() == spec.width * spec.height
-           * spec.components * gpuTypeSize(spec.type)
-           || spec.buffer.size() == 0);
+    clear();
+    loadImpl(info, spec, false, debugId);
+}
 
+void Texture::loadStaged(ResourceInfo &info, vts::GpuTextureSpec &spec,
+    uint32 unpackBuffer, const std::string &debugId)
+{
     clear();
+    if (spec.buffer.size() == 0)
+    {
+        loadImpl(info, spec, false, debugId);
+        return;
+    }
+
+    // orphaning the previous storage avoids waiting for previous uploads
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, spec.buffer.size(),
+        nullptr, GL_STREAM_DRAW);
+    void *ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+        spec.buffer.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!ptr)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        throw std::runtime_error("failed to map texture staging buffer");
+    }
+    memcpy(ptr, spec.buffer.data(), spec.buffer.size());
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    loadImpl(info, spec, true, debugId);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    fenceUpload();
+    CHECK_GL("load texture staged");
+}
+
+void Texture::fenceUpload()
+{
+    if (uploadFence)
+        glDeleteSync((GLsync)uploadFence);
+    uploadFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush(); // the fence must be visible to other contexts
+}
+
+void Texture::loadImpl(ResourceInfo &info, vts::GpuTextureSpec &spec,
+    bool staged, const std::string &debugId)
+{
+    assert(spec.buffer.size() == spec.expectedSize()
+           || spec.buffer.size() == 0);
+
+    // source pointer is an offset into the unpack buffer when staged
+    const auto src = [&](uint32 off) -> const void * {
+        if (staged)
+            return (const void*)(intptr_t)off;
+        return spec.buffer.data() + off;
+    };
+
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_2D, id);
-    glTexImage2D(GL_TEXTURE_2D, 0, findInternalFormat(spec),
-                 spec.width, spec.height, 0,
-                 findFormat(spec), (GLenum)spec.type, spec.buffer.data());
+    if (spec.mipmapLevels.empty())
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, findInternalFormat(spec),
+                     spec.width, spec.height, 0,
+                     findFormat(spec), (GLenum)spec.type,
+                     spec.buffer.size() ? src(0) : nullptr);
+    }
+    else
+    {
+        // upload all prepared mipmap levels
+        const GLenum internalFormat = findInternalFormat(spec);
+        uint32 w = spec.width, h = spec.height, off = 0;
+        for (uint32 l = 0, e = spec.mipmapLevels.size(); l < e; l++)
+        {
+            if (spec.compressed)
+            {
+                glCompressedTexImage2D(GL_TEXTURE_2D, l, internalFormat,
+                    w, h, 0, spec.mipmapLevels[l], src(off));
+            }
+            else
+            {
+                glTexImage2D(GL_TEXTURE_2D, l, internalFormat,
+                    w, h, 0, findFormat(spec), (GLenum)spec.type,
+                    src(off));
+            }
+            off += spec.mipmapLevels[l];
+            w = std::max(w / 2, 1u);
+            h = std::max(h / 2, 1u);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+            spec.mipmapLevels.size() - 1);
+    }
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
         (GLenum)spec.filterMode);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
@@ -498,22 +797,58 @@ void Texture::load(ResourceInfo &info, vts::GpuTextureSpec &spec,
     case GpuTextureSpec::FilterMode::Linear:
         break;
     default:
-        glGenerateMipmap(GL_TEXTURE_2D);
+        // unless the mipmaps were already uploaded
+        if (spec.mipmapLevels.empty())
+            glGenerateMipmap(GL_TEXTURE_2D);
         break;
     }
 
     grayscale = spec.components == 1;
+    alphaMask = spec.alphaMask;
     setDebugId(debugId);
     CHECK_GL("load texture");
     info.ramMemoryCost += sizeof(*this);
     info.gpuMemoryCost += spec.buffer.size();
 }
 
+void Texture::loadLayer(ResourceInfo &info, vts::GpuTextureSpec &spec,
+    const std::shared_ptr<privat::TextureArrayPage> &page, uint32 layer)
+{
+    assert(spec.buffer.size() == spec.expectedSize());
+    assert(!spec.compressed);
+
+    clear();
+    this->page = page;
+    this->layer = layer;
+    id = page->id;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+    const GLenum format = findFormat(spec);
+    const uint32 levels = std::min(page->levels,
+        std::max((uint32)spec.mipmapLevels.size(), 1u));
+    uint32 w = spec.width, h = spec.height, off = 0;
+    for (uint32 l = 0; l < levels; l++)
+    {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, l, 0, 0, layer, w, h, 1,
+            format, (GLenum)spec.type, spec.buffer.data() + off);
+        off += spec.mipmapLevels.empty() ? spec.buffer.size()
+            : spec.mipmapLevels[l];
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+
+    grayscale = spec.components == 1;
+    alphaMask = spec.alphaMask;
+    CHECK_GL("load texture layer");
+    info.ramMemoryCost += sizeof(*this);
+    info.gpuMemoryCost += off;
+}
+
 void Texture::setId(uint32 id)
 {
     clear();
     this->id = id;
     this->grayscale = false;
+    this->alphaMask = false;
 }
 
 uint32 Texture::getId() const
@@ -521,23 +856,86 @@ uint32 Texture::getId() const
     return id;
 }
 
+uint32 Texture::getLayer() const
+{
+    return layer;
+}
+
+bool Texture::getArray() const
+{
+    return !!page;
+}
+
 bool Texture::getGrayscale() const
 {
     return grayscale;
 }
 
+bool Texture::getAlphaMask() const
+{
+    return alphaMask;
+}
+
 void RenderContext::loadTexture(ResourceInfo &info, GpuTextureSpec &spec,
     const std::string &debugId)
 {
     OPTICK_EVENT();
 
+    // all gpu resources are created by the root context of the share group
+    if (impl->sharedWith)
+        return impl->sharedWith->loadTexture(info, spec, debugId);
+
     if (impl->options.enforceUsingMipMaps)
         enforceUsingMipMaps(spec.filterMode);
 
+    if (spec.compressed
+        && std::find(compressedTextureFormats.begin(),
+            compressedTextureFormats.end(), spec.internalFormat)
+            == compressedTextureFormats.end())
+    {
+        throw std::invalid_argument("compressed texture format "
+            "is not supported by the gpu");
+    }
+
     auto r = std::make_shared<Texture>();
-    r->load(info, spec, debugId);
+    if (impl->options.textureArrays && spec.tileTexture && !spec.compressed
+        && spec.type == GpuTypeEnum::UnsignedByte && spec.buffer.size() > 0)
+    {
+        TextureArrayPool::Key key;
+        key.internalFormat = findInternalFormat(spec);
+        key.width = spec.width;
+        key.height = spec.height;
+        key.levels = usesMipmaps(spec.filterMode)
+            ? mipmapLevelsCount(spec.width, spec.height) : 1;
+        key.filterMode = (uint32)spec.filterMode;
+        key.wrapMode = (uint32)spec.wrapMode;
+        if (key.levels > 1 && spec.mipmapLevels.empty())
+            spec.generateMipmaps();
+        uint32 layer = 0;
+        auto page = impl->textureArrays.acquire(key, layer);
+        r->loadLayer(info, spec, page, layer);
+        r->setDebugId(debugId);
+    }
+#ifndef __EMSCRIPTEN__
+    else if (impl->options.stagedTextureUploads)
+    {
+        r->loadStaged(info, spec, impl->textureStagingBuffer(), debugId);
+        info.userData = r;
+        return; // the fence replaces glFinish
+    }
+#endif // !__EMSCRIPTEN__
+    else
+        r->load(info, spec, debugId);
     info.userData = r;
 
+#ifndef __EMSCRIPTEN__
+    if (impl->options.fenceUploads)
+    {
+        r->fenceUpload();
+        return;
+    }
+#endif // !__EMSCRIPTEN__
+
     if (impl->options.callGlFinishAfterUploadingData)
     {
         OPTICK_EVENT("glFinish");
@@ -545,16 +943,288 @@ void RenderContext::loadTexture(ResourceInfo &info, GpuTextureSpec &spec,
     }
 }
 
+namespace privat
+{
+
+TextureArrayPage::TextureArrayPage(uint32 layers)
+{
+    freeLayers.reserve(layers);
+    for (uint32 i = 0; i < layers; i++)
+        freeLayers.push_back(layers - i - 1);
+}
+
+TextureArrayPage::~TextureArrayPage()
+{
+    if (id)
+        glDeleteTextures(1, &id);
+}
+
+bool TextureArrayPage::acquire(uint32 &layer)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    if (freeLayers.empty())
+        return false;
+    layer = freeLayers.back();
+    freeLayers.pop_back();
+    return true;
+}
+
+void TextureArrayPage::release(uint32 layer)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    freeLayers.push_back(layer);
+}
+
+} // namespace privat
+
+bool TextureArrayPool::Key::operator < (const Key &other) const
+{
+    return std::tie(internalFormat, width, height, levels,
+        filterMode, wrapMode) < std::tie(other.internalFormat,
+        other.width, other.height, other.levels,
+        other.filterMode, other.wrapMode);
+}
+
+std::shared_ptr<privat::TextureArrayPage> TextureArrayPool::acquire(
+    const Key &key, uint32 &layer)
+{
+    static const uint32 LayersPerPage = 32;
+
+    std::lock_guard<std::mutex> lock(mut);
+    auto &list = pages[key];
+
+    // reuse existing page with a free layer
+    for (auto it = list.begin(); it != list.end(); )
+    {
+        auto p = it->lock();
+        if (!p)
+        {
+            it = list.erase(it);
+            continue;
+        }
+        if (p->acquire(layer))
+            return p;
+        it++;
+    }
+
+    // allocate new page
+    auto p = std::make_shared<privat::TextureArrayPage>(LayersPerPage);
+    p->levels = key.levels;
+    glGenTextures(1, &p->id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, p->id);
+    {
+        uint32 w = key.width, h = key.height;
+        for (uint32 l = 0; l < key.levels; l++)
+        {
+            // format and type are irrelevant without data
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, l, key.internalFormat,
+                w, h, LayersPerPage, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            w = std::max(w / 2, 1u);
+            h = std::max(h / 2, 1u);
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL,
+        key.levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+        key.filterMode);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER,
+        (GLenum)magFilter((GpuTextureSpec::FilterMode)key.filterMode));
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, key.wrapMode);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, key.wrapMode);
+    if (GLAD_GL_EXT_texture_filter_anisotropic)
+    {
+        glTexParameterf(GL_TEXTURE_2D_ARRAY,
+                        GL_TEXTURE_MAX_ANISOTROPY_EXT,
+                        maxAnisotropySamples);
+    }
+    setDebugLabel(GL_TEXTURE, p->id, "textureArrayPage");
+    CHECK_GL("allocate texture array page");
+    list.push_back(p);
+    bool ok = p->acquire(layer);
+    assert(ok);
+    (void)ok;
+    return p;
+}
+
+namespace privat
+{
+
+uint32 MeshSlab::aligned(uint32 size)
+{
+    return (size + Alignment - 1) / Alignment * Alignment;
+}
+
+MeshSlab::MeshSlab(uint32 target, uint32 capacity, bool fenced)
+    : target(target), capacity(capacity), fenced(fenced)
+{
+    freeRanges[0] = capacity;
+}
+
+MeshSlab::~MeshSlab()
+{
+    for (const Parked &p : parked)
+        glDeleteSync((GLsync)p.fence);
+    if (id)
+        glDeleteBuffers(1, &id);
+}
+
+bool MeshSlab::acquire(uint32 size, uint32 &offset)
+{
+    size = aligned(size);
+    std::lock_guard<std::mutex> lock(mut);
+    reclaimParked();
+    // best fit keeps the large ranges for large meshes
+    auto best = freeRanges.end();
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); it++)
+    {
+        if (it->second >= size
+            && (best == freeRanges.end() || it->second < best->second))
+            best = it;
+    }
+    if (best == freeRanges.end())
+        return false;
+    offset = best->first;
+    uint32 rest = best->second - size;
+    freeRanges.erase(best);
+    if (rest)
+        freeRanges[offset + size] = rest;
+    return true;
+}
+
+void MeshSlab::release(uint32 offset, uint32 size)
+{
+    size = aligned(size);
+#ifndef __EMSCRIPTEN__
+    if (fenced)
+    {
+        // draws queued in other contexts may still read the range
+        //   gl does not order the commands across contexts
+        void *fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush(); // the fence must be visible to other contexts
+        std::lock_guard<std::mutex> lock(mut);
+        parked.push_back({ offset, size, fence });
+        return;
+    }
+#endif // !__EMSCRIPTEN__
+    std::lock_guard<std::mutex> lock(mut);
+    insertFree(offset, size);
+}
+
+void MeshSlab::reclaimParked()
+{
+#ifndef __EMSCRIPTEN__
+    for (auto it = parked.begin(); it != parked.end(); )
+    {
+        const GLenum r = glClientWaitSync((GLsync)it->fence, 0, 0);
+        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED)
+        {
+            it++;
+            continue;
+        }
+        glDeleteSync((GLsync)it->fence);
+        insertFree(it->offset, it->size);
+        it = parked.erase(it);
+    }
+#endif // !__EMSCRIPTEN__
+}
+
+void MeshSlab::insertFree(uint32 offset, uint32 size)
+{
+    auto it = freeRanges.emplace(offset, size).first;
+    assert(it->second == size);
+
+    // coalesce with neighbors
+    auto next = std::next(it);
+    if (next != freeRanges.end() && it->first + it->second == next->first)
+    {
+        it->second += next->second;
+        freeRanges.erase(next);
+    }
+    if (it != freeRanges.begin())
+    {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == it->first)
+        {
+            prev->second += it->second;
+            freeRanges.erase(it);
+        }
+    }
+}
+
+uint32 MeshSlab::usedEnd()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    if (freeRanges.empty())
+        return capacity;
+    auto last = std::prev(freeRanges.end());
+    if (last->first + last->second == capacity)
+        return last->first;
+    return capacity;
+}
+
+} // namespace privat
+
+MeshSlabPool::MeshSlabPool(uint32 target) : target(target)
+{}
+
+std::shared_ptr<privat::MeshSlab> MeshSlabPool::acquire(
+    uint32 size, uint32 &offset, bool fenced)
+{
+    static const uint32 SlabCapacity = 4 * 1024 * 1024;
+    if (privat::MeshSlab::aligned(size) > SlabCapacity / 4)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(mut);
+
+    // reuse existing slab with enough free space
+    for (auto it = slabs.begin(); it != slabs.end(); )
+    {
+        auto p = it->lock();
+        if (!p)
+        {
+            it = slabs.erase(it);
+            continue;
+        }
+        if (p->fenced == fenced && p->acquire(size, offset))
+            return p;
+        it++;
+    }
+
+    // allocate new slab
+    auto p = std::make_shared<privat::MeshSlab>(target, SlabCapacity, fenced);
+    glGenBuffers(1, &p->id);
+    glBindBuffer(target, p->id);
+    glBufferData(target, SlabCapacity, nullptr, GL_STATIC_DRAW);
+    setDebugLabel(GL_BUFFER, p->id, "meshSlab");
+    CHECK_GL("allocate mesh slab");
+    slabs.push_back(p);
+    bool ok = p->acquire(size, offset);
+    assert(ok);
+    (void)ok;
+    return p;
+}
+
 Mesh::Mesh()
 {}
 
 void Mesh::clear()
 {
-    if (vbo)
+    if (vertexSlab)
+        vertexSlab->release(vertexOffset, vertexSize);
+    else if (vbo)
         glDeleteBuffers(1, &vbo);
-    if (vio)
+    if (indexSlab)
+        indexSlab->release(indexOffset, indexSize);
+    else if (vio)
         glDeleteBuffers(1, &vio);
+    vertexSlab.reset();
+    indexSlab.reset();
     vbo = vio = 0;
+    vertexOffset = indexOffset = 0;
+    vertexSize = indexSize = 0;
+    if (uploadFence)
+        glDeleteSync((GLsync)uploadFence);
+    uploadFence = nullptr;
 }
 
 Mesh::~Mesh()
@@ -565,12 +1235,22 @@ Mesh::~Mesh()
 void Mesh::setDebugId(const std::string &id)
 {
     this->debugId = id;
-    setDebugLabel(GL_BUFFER, vbo, debugId);
-    setDebugLabel(GL_BUFFER, vio, debugId);
+    // the slabs are shared by many meshes
+    if (!vertexSlab)
+        setDebugLabel(GL_BUFFER, vbo, debugId);
+    if (!indexSlab)
+        setDebugLabel(GL_BUFFER, vio, debugId);
 }
 
 void Mesh::bind()
 {
+    if (uploadFence)
+    {
+        // waits on the gpu, the cpu continues
+        glWaitSync((GLsync)uploadFence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync((GLsync)uploadFence);
+        uploadFence = nullptr;
+    }
     if (vbo)
     {
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -584,14 +1264,14 @@ void Mesh::bind()
                 {
                     glVertexAttribIPointer(i,
                         a.components, (GLenum)a.type,
-                        a.stride, (void*)(intptr_t)a.offset);
+                        a.stride, (void*)(intptr_t)(a.offset + vertexOffset));
                 }
                 else
                 {
                     glVertexAttribPointer(i,
                         a.components, (GLenum)a.type,
                         a.normalized ? GL_TRUE : GL_FALSE,
-                        a.stride, (void*)(intptr_t)a.offset);
+                        a.stride, (void*)(intptr_t)(a.offset + vertexOffset));
                 }
             }
             else
@@ -610,7 +1290,7 @@ void Mesh::dispatch()
 {
     if (spec.indicesCount > 0)
         glDrawElements((GLenum)spec.faceMode, spec.indicesCount,
-                       (GLenum)spec.indexMode, nullptr);
+                       (GLenum)spec.indexMode, (void*)(intptr_t)indexOffset);
     else
         glDrawArrays((GLenum)spec.faceMode, 0, spec.verticesCount);
     CHECK_GL("dispatch mesh");
@@ -620,12 +1300,37 @@ void Mesh::dispatch(uint32 offset, uint32 count)
 {
     if (spec.indicesCount > 0)
         glDrawElements((GLenum)spec.faceMode, count, (GLenum)spec.indexMode,
-            (void*)(std::size_t)(gpuTypeSize(spec.indexMode) * offset));
+            (void*)(std::size_t)(gpuTypeSize(spec.indexMode) * offset
+                + indexOffset));
     else
         glDrawArrays((GLenum)spec.faceMode, offset, count);
     CHECK_GL("dispatch mesh");
 }
 
+void Mesh::dispatchInstanced(uint32 instances)
+{
+    if (spec.indicesCount > 0)
+        glDrawElementsInstanced((GLenum)spec.faceMode, spec.indicesCount,
+            (GLenum)spec.indexMode, (void*)(intptr_t)indexOffset, instances);
+    else
+        glDrawArraysInstanced((GLenum)spec.faceMode, 0, spec.verticesCount,
+            instances);
+    CHECK_GL("dispatch mesh instanced");
+}
+
+void Mesh::dispatchInstanced(uint32 instances, uint32 offset, uint32 count)
+{
+    if (spec.indicesCount > 0)
+        glDrawElementsInstanced((GLenum)spec.faceMode, count,
+            (GLenum)spec.indexMode, (void*)(std::size_t)(
+                gpuTypeSize(spec.indexMode) * offset + indexOffset),
+            instances);
+    else
+        glDrawArraysInstanced((GLenum)spec.faceMode, offset, count,
+            instances);
+    CHECK_GL("dispatch mesh instanced");
+}
+
 void Mesh::dispatchWireframeSlow()
 {
     assert((GLenum)spec.faceMode == GL_TRIANGLES);
@@ -634,7 +1339,8 @@ void Mesh::dispatchWireframeSlow()
         for (uint32 i = 0; i < spec.indicesCount; i += 3)
         {
             glDrawElements(GL_LINE_LOOP, 3, (GLenum)spec.indexMode,
-                (void*)(std::size_t)(gpuTypeSize(spec.indexMode) * i));
+                (void*)(std::size_t)(gpuTypeSize(spec.indexMode) * i
+                    + indexOffset));
         }
     }
     else
@@ -673,6 +1379,41 @@ void Mesh::load(ResourceInfo &info, GpuMeshSpec &specp,
     spec.indices.free();
 }
 
+void Mesh::loadSlabs(ResourceInfo &info, GpuMeshSpec &specp,
+    const std::shared_ptr<privat::MeshSlab> &vertexSlab,
+    uint32 vertexOffset,
+    const std::shared_ptr<privat::MeshSlab> &indexSlab,
+    uint32 indexOffset, const std::string &debugId)
+{
+    assert(vertexSlab);
+    clear();
+    spec = std::move(specp);
+    this->vertexSlab = vertexSlab;
+    this->vertexOffset = vertexOffset;
+    vertexSize = spec.vertices.size();
+    vbo = vertexSlab->id;
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, vertexOffset,
+        spec.vertices.size(), spec.vertices.data());
+    if (indexSlab)
+    {
+        this->indexSlab = indexSlab;
+        this->indexOffset = indexOffset;
+        indexSize = spec.indices.size();
+        vio = indexSlab->id;
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vio);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexOffset,
+            spec.indices.size(), spec.indices.data());
+    }
+    this->debugId = debugId;
+    CHECK_GL("load mesh into slabs");
+    info.ramMemoryCost += sizeof(*this);
+    info.gpuMemoryCost += privat::MeshSlab::aligned(vertexSize)
+        + privat::MeshSlab::aligned(indexSize);
+    spec.vertices.free();
+    spec.indices.free();
+}
+
 uint32 Mesh::getVbo() const
 {
     return vbo;
@@ -683,15 +1424,54 @@ uint32 Mesh::getVio() const
     return vio;
 }
 
+void Mesh::fenceUpload()
+{
+    if (uploadFence)
+        glDeleteSync((GLsync)uploadFence);
+    uploadFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush(); // the fence must be visible to other contexts
+}
+
 void RenderContext::loadMesh(ResourceInfo &info, GpuMeshSpec &spec,
     const std::string &debugId)
 {
     OPTICK_EVENT();
 
+    if (impl->sharedWith)
+        return impl->sharedWith->loadMesh(info, spec, debugId);
+
     auto r = std::make_shared<Mesh>();
-    r->load(info, spec, debugId);
+    std::shared_ptr<privat::MeshSlab> vs, is;
+    uint32 vo = 0, io = 0;
+    if (impl->options.meshSlabs && spec.verticesCount)
+    {
+        const bool fenced = impl->options.fenceUploads;
+        vs = impl->meshVertexSlabs.acquire(spec.vertices.size(), vo, fenced);
+        if (vs && spec.indicesCount)
+        {
+            is = impl->meshIndexSlabs.acquire(spec.indices.size(), io,
+                fenced);
+            if (!is)
+            {
+                vs->release(vo, spec.vertices.size());
+                vs.reset();
+            }
+        }
+    }
+    if (vs)
+        r->loadSlabs(info, spec, vs, vo, is, io, debugId);
+    else
+        r->load(info, spec, debugId);
     info.userData = r;
 
+#ifndef __EMSCRIPTEN__
+    if (impl->options.fenceUploads)
+    {
+        r->fenceUpload();
+        return;
+    }
+#endif // !__EMSCRIPTEN__
+
     if (impl->options.callGlFinishAfterUploadingData)
     {
         OPTICK_EVENT("glFinish");
@@ -1,11 +1,28 @@
 
+#ifdef VTS_UPSAMPLE
+uniform sampler2D texBackground;
+in vec2 varUv;
+#elif defined(VTS_FAR_FIELD)
+uniform samplerCube texFarField;
 in vec3 varFragDir;
+#else
+in vec3 varFragDir;
+#endif
 
 layout(location = 0) out vec4 outColor;
 
 void main()
 {
+#ifdef VTS_UPSAMPLE
+    // the far depth and the depth test keep the surfaces intact
+    outColor = texture(texBackground, varUv);
+#elif defined(VTS_FAR_FIELD)
+    // directions not covered by any far surface keep the atmosphere
+    outColor = texture(texFarField, varFragDir);
+    if (outColor.a < 0.5)
+        discard;
+#else
     float atmosphere = atmDensityDir(varFragDir, 1001.0);
     outColor = atmColor(atmosphere, vec4(0.0, 0.0, 0.0, 1.0));
+#endif
 }
-
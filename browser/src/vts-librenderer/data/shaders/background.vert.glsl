@@ -1,16 +1,19 @@
 
 uniform vec3 uniCorners[4];
+uniform float uniFarDepth;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inUv;
 
 out vec3 varFragDir;
+out vec2 varUv;
 
 void main()
 {
-    gl_Position = vec4(inPosition.xy, 1.0, 1.0);
+    gl_Position = vec4(inPosition.xy, uniFarDepth, 1.0);
     varFragDir = mix(
         mix(uniCorners[0], uniCorners[1], inUv.x),
         mix(uniCorners[2], uniCorners[3], inUv.x), inUv.y);
+    varUv = inUv;
 }
 
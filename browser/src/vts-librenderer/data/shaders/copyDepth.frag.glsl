@@ -1,5 +1,6 @@
 
 uniform sampler2D texDepth;
+uniform float uniReversed;
 
 out vec4 outDepth;
 
@@ -15,7 +16,9 @@ vec4 packFloatToVec4(float value)
 
 void main()
 {
-    outDepth = packFloatToVec4(texelFetch(texDepth,
-        ivec2(gl_FragCoord) * 3, 0).r);
+    float d = texelFetch(texDepth, ivec2(gl_FragCoord) * 3, 0).r;
+    if (uniReversed > 0.5)
+        d = 1.0 - d; // back to the standard range
+    outDepth = packFloatToVec4(d);
 }
 
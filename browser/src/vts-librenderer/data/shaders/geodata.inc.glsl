@@ -2,7 +2,7 @@
 layout(std140) uniform uboCameraData
 {
     mat4 uniProj;
-    vec4 uniCameraParams; // screen width in pixels, screen height in pixels, view extent in meters
+    vec4 uniCameraParams; // screen width in pixels, screen height in pixels, view extent in meters, reversed depth
 };
 
 layout(std140) uniform uboViewData
@@ -15,9 +15,9 @@ layout(std140) uniform uboViewData
 
 #ifdef VTS_STAGE_VERTEX
 
-float testVisibility(vec4 visibilities, vec3 modelPos, vec3 modelUp)
+float testVisibility(mat4 mv, vec4 visibilities, vec3 modelPos, vec3 modelUp)
 {
-    vec3 pos = vec3(uniMv * vec4(modelPos, 1.0));
+    vec3 pos = vec3(mv * vec4(modelPos, 1.0));
     float distance = length(pos);
     if (!isnan(visibilities[0]) && distance > visibilities[0])
         return 0.0;
@@ -28,17 +28,44 @@ float testVisibility(vec4 visibilities, vec3 modelPos, vec3 modelUp)
         return 0.0;
     if (!isnan(visibilities[3]))
     {
-        vec3 up = vec3(uniMv * vec4(modelUp, 0.0));
+        vec3 up = vec3(mv * vec4(modelUp, 0.0));
         if (dot(normalize(-pos), normalize(up)) < visibilities[3])
             return 0.0;
     }
     return 1.0;
 }
 
+float testVisibility(vec4 visibilities, vec3 modelPos, vec3 modelUp)
+{
+    return testVisibility(uniMv, visibilities, modelPos, modelUp);
+}
+
+uniform sampler2D texDepthTest;
+
+// point: ndc position, w = enabled
+// returns 0 if the point is hidden behind the depth buffer
+float testDepth(vec4 point)
+{
+    if (point.w < 0.5 || any(greaterThan(abs(point.xy), vec2(1.0))))
+        return 1.0;
+    ivec2 size = textureSize(texDepthTest, 0);
+    if (size.x * size.y == 0)
+        return 1.0;
+    ivec2 p = ivec2((point.xy * 0.5 + 0.5) * vec2(size - 1));
+    uvec4 c = uvec4(texelFetch(texDepthTest, p, 0) * 255.0 + 0.5);
+    float d = uintBitsToFloat(c.x | (c.y << 8) | (c.z << 16) | (c.w << 24));
+    if (d >= 1.0 - 1e-7)
+        return 1.0; // far plane - no depth
+    return point.z < d * 2.0 - 1.0 ? 1.0 : 0.0;
+}
+
 void cullingCorrection()
 {
     // avoid culling geodata by near camera plane
-    gl_Position.z = max(gl_Position.z, -gl_Position.w + 1e-7);
+    if (uniCameraParams[3] > 0.5)
+        gl_Position.z = min(gl_Position.z, gl_Position.w - 1e-7);
+    else
+        gl_Position.z = max(gl_Position.z, -gl_Position.w + 1e-7);
 }
 
 #endif
@@ -1,20 +1,49 @@
 
+#ifdef VTS_INSTANCED
+
+// must match IconInstances in the renderer
+#define VTS_INSTANCES 128
+
+struct IconInstance
+{
+    mat3x4 screen;
+    vec4 clipPos;
+    vec4 color;
+    vec4 uvs;
+    vec4 depthTest;
+};
+
+layout(std140) uniform uboIconData
+{
+    IconInstance uniInstances[VTS_INSTANCES];
+};
+
+flat in int varInstance;
+#define uniColor uniInstances[varInstance].color
+
+#else
+
 layout(std140) uniform uboIconData
 {
     mat3x4 uniScreen;
     vec4 uniModelPos;
     vec4 uniColor;
     vec4 uniUvs;
+    vec4 uniDepthTest;
 };
 
+#endif
+
 uniform sampler2D texIcons;
 
 layout(location = 0) out vec4 outColor;
 
 in vec2 varUv;
+in float varOpacity;
 
 void main()
 {
     outColor = uniColor * texture(texIcons, varUv);
+    outColor.a *= varOpacity;
 }
 
@@ -1,21 +1,57 @@
 
+#ifdef VTS_INSTANCED
+
+// must match IconInstances in the renderer
+#define VTS_INSTANCES 128
+
+struct IconInstance
+{
+    mat3x4 screen;
+    vec4 clipPos;
+    vec4 color;
+    vec4 uvs;
+    vec4 depthTest;
+};
+
+layout(std140) uniform uboIconData
+{
+    IconInstance uniInstances[VTS_INSTANCES];
+};
+
+flat out int varInstance;
+#define uniScreen uniInstances[gl_InstanceID].screen
+#define uniUvs uniInstances[gl_InstanceID].uvs
+#define uniDepthTest uniInstances[gl_InstanceID].depthTest
+
+#else
+
 layout(std140) uniform uboIconData
 {
     mat3x4 uniScreen;
     vec4 uniModelPos;
     vec4 uniColor;
     vec4 uniUvs;
+    vec4 uniDepthTest;
 };
 
+#endif
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inUv;
 
 out vec2 varUv;
+out float varOpacity;
 
 void main()
 {
     varUv = mix(uniUvs.xy, uniUvs.zw, inUv);
+    varOpacity = testDepth(uniDepthTest);
+#ifdef VTS_INSTANCED
+    varInstance = gl_InstanceID;
+    gl_Position = uniInstances[gl_InstanceID].clipPos;
+#else
     gl_Position = uniMvp * vec4(uniModelPos);
+#endif
     gl_Position.xy += vec2(mat3(uniScreen) * vec3(inPosition.xy, 1.0)) * gl_Position.w;
     cullingCorrection();
 }
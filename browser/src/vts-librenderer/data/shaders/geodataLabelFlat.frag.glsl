@@ -4,6 +4,7 @@ layout(std140) uniform uboLabelFlat
     vec4 uniColor[2];
     vec4 uniOutline;
     vec4 uniPosition; // xyz
+    vec4 uniDepthTest;
     vec4 uniCoordinates[1000];
     // even xyzw: clip space position
     // odd zw: uv (zw for compatibility with screen labels)
@@ -15,6 +16,7 @@ uniform sampler2D texGlyphs;
 uniform int uniPass;
 
 in vec2 varUv;
+in float varOpacity;
 flat in int varPlane;
 
 layout(location = 0) out vec4 outColor;
@@ -27,6 +29,6 @@ void main()
     float d = uniOutline[uniPass + 2];
     float a = smoothstep(c - d, c + d, t);
     outColor = uniColor[uniPass];
-    outColor.a *= a;
+    outColor.a *= a * varOpacity;
 }
 
@@ -4,6 +4,7 @@ layout(std140) uniform uboLabelFlat
     vec4 uniColor[2];
     vec4 uniOutline;
     vec4 uniPosition; // xyz
+    vec4 uniDepthTest;
     vec4 uniCoordinates[1000];
     // even xyzw: clip space position
     // odd zw: uv (zw for compatibility with screen labels)
@@ -11,6 +12,7 @@ layout(std140) uniform uboLabelFlat
 };
 
 out vec2 varUv;
+out float varOpacity;
 flat out int varPlane;
 
 void main()
@@ -32,6 +34,7 @@ void main()
     varPlane = int(coord.z) / 2;
     varUv = coord.zw;
     varUv.x -= float(varPlane * 2);
+    varOpacity = testDepth(uniDepthTest);
     cullingCorrection();
 }
 
@@ -5,6 +5,7 @@ layout(std140) uniform uboLabelScreen
     vec4 uniOutline;
     vec4 uniPosition; // xyz, scale
     vec4 uniOffset;
+    vec4 uniDepthTest;
     vec4 uniCoordinates[500];
     // 0, 1: position
     // 2, 3: uv
@@ -16,6 +17,7 @@ uniform sampler2D texGlyphs;
 uniform int uniPass;
 
 in vec2 varUv;
+in float varOpacity;
 flat in int varPlane;
 
 layout(location = 0) out vec4 outColor;
@@ -28,6 +30,6 @@ void main()
     float d = uniOutline[uniPass + 2];
     float a = smoothstep(c - d, c + d, t);
     outColor = uniColor[uniPass];
-    outColor.a *= a;
+    outColor.a *= a * varOpacity;
 }
 
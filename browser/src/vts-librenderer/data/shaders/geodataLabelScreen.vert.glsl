@@ -5,6 +5,7 @@ layout(std140) uniform uboLabelScreen
     vec4 uniOutline;
     vec4 uniPosition; // xyz, scale
     vec4 uniOffset;
+    vec4 uniDepthTest;
     vec4 uniCoordinates[500];
     // 0, 1: position
     // 2, 3: uv
@@ -12,6 +13,7 @@ layout(std140) uniform uboLabelScreen
 };
 
 out vec2 varUv;
+out float varOpacity;
 flat out int varPlane;
 
 void main()
@@ -33,6 +35,7 @@ void main()
     varPlane = int(coord.z) / 2;
     varUv = coord.zw;
     varUv.x -= float(varPlane * 2);
+    varOpacity = testDepth(uniDepthTest);
     gl_Position = uniMvp * vec4(uniPosition.xyz, 1.0);
     gl_Position.xy += gl_Position.w * uniOffset.xy;
     gl_Position.xy += gl_Position.w * uniPosition.w
@@ -6,16 +6,47 @@ layout(std140) uniform uboTriangleData
     ivec4 uniFlags; // shading
 };
 
+#ifdef VTS_MERGED
+
+// must match GeodataPage::Slots in the renderer
+#define VTS_SLOTS 128
+
+struct TileSlot
+{
+    mat4 mvp;
+    mat4 mv;
+};
+
+layout(std140) uniform uboSlotsData
+{
+    TileSlot uniSlots[VTS_SLOTS];
+};
+
+layout(location = 0) in vec4 inPositionSlot; // xyz, slot
+
+#else
+
 layout(location = 0) in vec3 inPosition;
 
+#endif
+
 out float varOpacity;
 out vec3 varViewPosition;
 
 void main()
 {
-    varViewPosition = (uniMv * vec4(inPosition, 1.0)).xyz;
-    varOpacity = testVisibility(uniVisibilities, inPosition, vec3(0.0));
-    gl_Position = uniMvp * vec4(inPosition, 1.0);
+#ifdef VTS_MERGED
+    vec3 inPosition = inPositionSlot.xyz;
+    TileSlot slot = uniSlots[int(inPositionSlot.w)];
+    mat4 mv = slot.mv;
+    mat4 mvp = slot.mvp;
+#else
+    mat4 mv = uniMv;
+    mat4 mvp = uniMvp;
+#endif
+    varViewPosition = (mv * vec4(inPosition, 1.0)).xyz;
+    varOpacity = testVisibility(mv, uniVisibilities, inPosition, vec3(0.0));
+    gl_Position = mvp * vec4(inPosition, 1.0);
     cullingCorrection();
 }
 
@@ -6,7 +6,7 @@ layout(std140) uniform uboInfographics
 {
     mat4 uniMvp;
     vec4 uniColor;
-    vec4 uniFlags; // type, useTexture, useDepth
+    vec4 uniFlags; // type, useTexture, useDepth, reversedDepth
     vec4 data;
     vec4 data2;
 };
@@ -24,7 +24,8 @@ void main()
     if (uniFlags[2] > 0.5)
     {
         float depthNorm = texelFetch(texDepth, ivec2(gl_FragCoord.xy), 0).x;
-        if (gl_FragCoord.z > depthNorm)
+        if (uniFlags[3] > 0.5 ? gl_FragCoord.z < depthNorm
+            : gl_FragCoord.z > depthNorm)
             outColor.a *= 0.1;
     }
 }
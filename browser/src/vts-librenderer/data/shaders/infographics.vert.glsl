@@ -3,7 +3,7 @@ layout(std140) uniform uboInfographics
 {
     mat4 uniMvp;
     vec4 uniColor;
-    vec4 uniFlags; // type, useTexture, useDepth
+    vec4 uniFlags; // type, useTexture, useDepth, reversedDepth
     vec4 data;
     vec4 data2;
 };
@@ -1,8 +1,36 @@
 
 uniform sampler2D texColor;
 uniform sampler2D texMask;
+uniform mediump sampler2DArray texColorArray;
+uniform mediump sampler2DArray texMaskArray;
 uniform lowp sampler2DArray texBlueNoise;
 
+#ifdef VTS_INSTANCED
+
+#define VTS_INSTANCES 64
+
+struct SurfaceInstance
+{
+    mat4 mv;
+    vec4 uvTrans;
+    vec4 uvClip;
+    vec4 color;
+    ivec4 flags;
+};
+
+layout(std140) uniform uboSurface
+{
+    mat4 uniP;
+    SurfaceInstance uniInstances[VTS_INSTANCES];
+};
+
+flat in int varInstance;
+#define uniUvClip uniInstances[varInstance].uvClip
+#define uniColor uniInstances[varInstance].color
+#define uniFlags uniInstances[varInstance].flags
+
+#else
+
 layout(std140) uniform uboSurface
 {
     mat4 uniP;
@@ -10,9 +38,11 @@ layout(std140) uniform uboSurface
     vec4 uniUvTrans; // scale-x, scale-y, offset-x, offset-y
     vec4 uniUvClip;
     vec4 uniColor;
-    ivec4 uniFlags; // mask, monochromatic, flat shading, uv source, lodBlendingWithDithering, ..., blendingCoverage, frameIndex
+    ivec4 uniFlags; // mask, monochromatic, flat shading, uv source, lodBlendingWithDithering, color array, mask array, mask in color alpha; layers; blendingCoverage; frameIndex
 };
 
+#endif
+
 in vec2 varUvTex;
 #ifdef VTS_NO_CLIP
 in vec2 varUvExternal;
@@ -53,7 +83,26 @@ void main()
     {
         // assuming mipmaps are not needed:
         //   is textureLod more efficient than regular texture access?
-        if (textureLod(texMask, varUvTex, 0.0).r < 0.5)
+        float m;
+        if (getFlag(6))
+            m = textureLod(texMaskArray, vec3(varUvTex,
+                float(uniFlags[1] >> 16)), 0.0).r;
+        else
+            m = textureLod(texMask, varUvTex, 0.0).r;
+        if (m < 0.5)
+            discard;
+    }
+
+    // mask folded into the color texture
+    if (getFlag(7))
+    {
+        float m;
+        if (getFlag(5))
+            m = textureLod(texColorArray, vec3(varUvTex,
+                float(uniFlags[1] & 0xFFFF)), 0.0).a;
+        else
+            m = textureLod(texColor, varUvTex, 0.0).a;
+        if (m < 0.5)
             discard;
     }
 
@@ -75,7 +124,11 @@ void main()
     else
     {
         // base color
-        outColor = textureGrad(texColor, varUvTex, uvDx, uvDy);
+        if (getFlag(5))
+            outColor = textureGrad(texColorArray, vec3(varUvTex,
+                float(uniFlags[1] & 0xFFFF)), uvDx, uvDy);
+        else
+            outColor = textureGrad(texColor, varUvTex, uvDx, uvDy);
 
         // monochromatic texture
         if (getFlag(1))
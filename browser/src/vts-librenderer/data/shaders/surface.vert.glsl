@@ -1,4 +1,33 @@
 
+#ifdef VTS_INSTANCED
+
+// must match SurfaceInstances in the renderer
+#define VTS_INSTANCES 64
+
+struct SurfaceInstance
+{
+    mat4 mv;
+    vec4 uvTrans;
+    vec4 uvClip;
+    vec4 color;
+    ivec4 flags;
+};
+
+layout(std140) uniform uboSurface
+{
+    mat4 uniP;
+    SurfaceInstance uniInstances[VTS_INSTANCES];
+};
+
+flat out int varInstance;
+#define uniMv uniInstances[gl_InstanceID].mv
+#define uniUvTrans uniInstances[gl_InstanceID].uvTrans
+#define uniUvClip uniInstances[gl_InstanceID].uvClip
+#define uniColor uniInstances[gl_InstanceID].color
+#define uniFlags uniInstances[gl_InstanceID].flags
+
+#else
+
 layout(std140) uniform uboSurface
 {
     mat4 uniP;
@@ -9,6 +38,8 @@ layout(std140) uniform uboSurface
     ivec4 uniFlags; // mask, monochromatic, flat shading, uv source, lodBlendingWithDithering, ..., blendingCoverage, frameIndex
 };
 
+#endif
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inUvInternal;
 layout(location = 2) in vec2 inUvExternal;
@@ -33,6 +64,9 @@ bool getFlag(int i)
 
 void main()
 {
+#ifdef VTS_INSTANCED
+    varInstance = gl_InstanceID;
+#endif
 #ifdef VTS_NO_CLIP
     varUvExternal = inUvExternal;
 #else
@@ -24,6 +24,8 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <vts-browser/camera.hpp>
+
 #include <optick.h>
 
 #include "renderer.hpp"
@@ -47,6 +49,13 @@ DepthBuffer::DepthBuffer()
 
 DepthBuffer::~DepthBuffer()
 {
+    for (Pick &p : picksInFlight)
+    {
+        glDeleteSync(p.fence);
+        picksPbos.push_back(p.pbo);
+    }
+    if (!picksPbos.empty())
+        glDeleteBuffers(picksPbos.size(), picksPbos.data());
     glDeleteFramebuffers(1, &fbo);
     glDeleteTextures(1, &tex);
     glDeleteBuffers(PboCount, pbo);
@@ -57,12 +66,14 @@ const mat4 &DepthBuffer::getConv() const
     return conv[index];
 }
 
-void DepthBuffer::performCopy(uint32 sourceTexture,
-    uint32 paramW, uint32 paramH,
-    const mat4 &storeConv)
+uint32 DepthBuffer::gpuTexture() const
+{
+    return tex;
+}
+
+void DepthBuffer::copyToTexture(uint32 sourceTexture,
+    uint32 paramW, uint32 paramH, bool reversed)
 {
-    paramW /= 3;
-    paramH /= 3;
     glViewport(0, 0, paramW, paramH);
 
     // copy depth to texture (perform conversion)
@@ -92,11 +103,27 @@ void DepthBuffer::performCopy(uint32 sourceTexture,
 
         glBindTexture(GL_TEXTURE_2D, sourceTexture);
         shaderCopyDepth->bind();
+        shaderCopyDepth->uniform(1, reversed ? 1.f : 0.f);
         meshQuad->bind();
         meshQuad->dispatch();
 
         CHECK_GL("read the depth (conversion)");
     }
+}
+
+void DepthBuffer::performGpuCopy(uint32 sourceTexture,
+    uint32 paramW, uint32 paramH, bool reversed)
+{
+    copyToTexture(sourceTexture, paramW / 3, paramH / 3, reversed);
+}
+
+void DepthBuffer::performCopy(uint32 sourceTexture,
+    uint32 paramW, uint32 paramH, bool reversed,
+    const mat4 &storeConv)
+{
+    paramW /= 3;
+    paramH /= 3;
+    copyToTexture(sourceTexture, paramW, paramH, reversed);
 
     // copy texture to pbo
     {
@@ -156,6 +183,157 @@ void DepthBuffer::performCopy(uint32 sourceTexture,
     }
 }
 
+void DepthBuffer::occlusionFeedback(Camera *camera)
+{
+    if (w[index] * h[index] == 0)
+        return;
+    camera->setOcclusionDepth((const float *)buffer.data(),
+        w[index], h[index], conv[index].data());
+}
+
+void DepthBuffer::pick(uint32 x, uint32 y, uint32 w, uint32 h,
+    RenderView::PickCallback &&callback)
+{
+    Pick p;
+    p.callback = std::move(callback);
+    p.x = x;
+    p.y = y;
+    p.w = std::max(w, 1u);
+    p.h = std::max(h, 1u);
+    picksQueued.push_back(std::move(p));
+}
+
+void DepthBuffer::performPicks(uint32 paramW, uint32 paramH,
+    float scale, const mat4 &storeConv)
+{
+    if (picksQueued.empty() || tw * th == 0)
+        return;
+
+    OPTICK_EVENT("read_depth_picks");
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    for (Pick &p : picksQueued)
+    {
+        // screen rect (top-down) to converted depth pixels (bottom-up)
+        //   the screen is scaled to the render resolution
+        //   and the conversion samples every third pixel
+        uint32 sx0 = std::min(uint32(p.x * scale), paramW - 1);
+        uint32 sy0 = std::min(uint32(p.y * scale), paramH - 1);
+        uint32 sx1 = std::min(std::max(uint32((p.x + p.w) * scale), 1u),
+            paramW) - 1;
+        uint32 sy1 = std::min(std::max(uint32((p.y + p.h) * scale), 1u),
+            paramH) - 1;
+        sx1 = std::max(sx1, sx0);
+        sy1 = std::max(sy1, sy0);
+        uint32 x0 = std::min(sx0 / 3, tw - 1);
+        uint32 x1 = std::min(sx1 / 3, tw - 1);
+        uint32 y0 = std::min((paramH - 1 - sy1) / 3, th - 1);
+        uint32 y1 = std::min((paramH - 1 - sy0) / 3, th - 1);
+        p.x = x0;
+        p.y = y0;
+        p.w = x1 - x0 + 1;
+        p.h = y1 - y0 + 1;
+        p.conv = storeConv;
+        p.screenW = paramW;
+        p.screenH = paramH;
+
+        if (picksPbos.empty())
+        {
+            uint32 b = 0;
+            glGenBuffers(1, &b);
+            picksPbos.push_back(b);
+        }
+        p.pbo = picksPbos.back();
+        picksPbos.pop_back();
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, p.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, p.w * p.h * sizeof(uint32),
+            nullptr, GL_STREAM_READ);
+        glReadPixels(p.x, p.y, p.w, p.h, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        p.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        picksInFlight.push_back(std::move(p));
+    }
+    picksQueued.clear();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    CHECK_GL("read the depth (picks)");
+}
+
+void DepthBuffer::processPicks()
+{
+    if (picksInFlight.empty())
+        return;
+
+    OPTICK_EVENT("process_depth_picks");
+    std::vector<Pick> finished;
+    for (auto it = picksInFlight.begin(); it != picksInFlight.end();)
+    {
+        GLenum r = glClientWaitSync(it->fence, 0, 0);
+        if (r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED)
+        {
+            finished.push_back(std::move(*it));
+            it = picksInFlight.erase(it);
+        }
+        else
+            it++;
+    }
+
+    // the callbacks may request more picks
+    for (Pick &p : finished)
+        finishPick(p);
+}
+
+void DepthBuffer::finishPick(Pick &p)
+{
+    glDeleteSync(p.fence);
+    p.fence = 0;
+
+    uint32 reqsiz = p.w * p.h * sizeof(uint32);
+    if (picksBuffer.size() < reqsiz)
+        picksBuffer.allocate(reqsiz);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, p.pbo);
+#ifdef __EMSCRIPTEN__
+    EM_ASM_(
+    {
+        Module.ctx.getBufferSubData(Module.ctx.PIXEL_PACK_BUFFER, 0, HEAPU8.subarray($0, $0 + $1));
+    }, picksBuffer.data(), reqsiz);
+#else
+    void *ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+        0, reqsiz, GL_MAP_READ_BIT);
+    assert(ptr);
+    memcpy(picksBuffer.data(), ptr, reqsiz);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+#endif
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    picksPbos.push_back(p.pbo);
+    CHECK_GL("read the depth (pick to cpu)");
+
+    // unproject, the rows are reordered top-down
+    const mat4 inv = p.conv.inverse();
+    const float *depths = (const float *)picksBuffer.data();
+    std::vector<double> result;
+    result.reserve(p.w * p.h * 3);
+    for (uint32 y = 0; y < p.h; y++)
+    {
+        uint32 py = p.y + p.h - 1 - y;
+        for (uint32 x = 0; x < p.w; x++)
+        {
+            uint32 px = p.x + x;
+            double d = depths[(p.h - 1 - y) * p.w + x];
+            vec3 r = nan3();
+            if (d < 1 - 1e-15)
+            {
+                double nx = (px * 3 + 1.5) / p.screenW * 2 - 1;
+                double ny = (py * 3 + 1.5) / p.screenH * 2 - 1;
+                r = vec4to3(vec4(inv * vec4(nx, ny, d * 2 - 1, 1)), true);
+            }
+            result.push_back(r[0]);
+            result.push_back(r[1]);
+            result.push_back(r[2]);
+        }
+    }
+    p.callback(result.data(), p.w, p.h);
+}
+
 double DepthBuffer::valuePix(uint32 x, uint32 y)
 {
     if (w[index] * h[index] == 0)
@@ -211,6 +211,9 @@ void RenderContext::loadFont(ResourceInfo &info, GpuFontSpec &spec,
 {
     OPTICK_EVENT();
 
+    if (impl->sharedWith)
+        return impl->sharedWith->loadFont(info, spec, debugId);
+
     auto r = std::make_shared<Font>();
     r->load(info, spec, debugId);
     info.userData = r;
@@ -26,6 +26,8 @@
 
 #include "renderer.hpp"
 
+#include <algorithm>
+
 void initializeRenderData();
 namespace
 {
@@ -46,6 +48,10 @@ namespace vts { namespace renderer
 
 uint32 maxAntialiasingSamples = 1;
 float maxAnisotropySamples = 0.f;
+std::vector<uint32> compressedTextureFormats;
+ClipControlProc clipControl = nullptr;
+std::vector<uint32> programBinaryFormats;
+bool parallelShaderCompile = false;
 
 void checkGlImpl(const char *name)
 {
@@ -210,6 +216,93 @@ void loadGlFunctions(GLADloadproc functionLoader)
     maxAntialiasingSamples = 0;
     glGetIntegerv(GL_MAX_SAMPLES, (GLint*)&maxAntialiasingSamples);
 
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+        compressedTextureFormats.resize(count);
+        if (count > 0)
+            glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS,
+                (GLint*)compressedTextureFormats.data());
+    }
+
+    clipControl = nullptr;
+    programBinaryFormats.clear();
+    parallelShaderCompile = false;
+#ifndef __EMSCRIPTEN__
+    {
+        std::vector<std::string> extensions;
+        {
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+            for (GLint i = 0; i < count; i++)
+            {
+                const char *e = (const char *)glGetStringi(GL_EXTENSIONS, i);
+                if (e)
+                    extensions.push_back(e);
+            }
+        }
+        const auto extension = [&](const char *name) {
+            return std::find(extensions.begin(), extensions.end(), name)
+                != extensions.end();
+        };
+#ifndef VTSR_OPENGLES
+        const uint32 version = GLVersion.major * 10 + GLVersion.minor;
+#else
+        const uint32 version = 0;
+#endif
+
+        // clip control
+        if (version >= 45 || extension("GL_ARB_clip_control")
+            || extension("GL_EXT_clip_control"))
+        {
+            clipControl = (ClipControlProc)functionLoader("glClipControl");
+            if (!clipControl)
+                clipControl = (ClipControlProc)
+                    functionLoader("glClipControlEXT");
+        }
+
+        // program binaries
+#ifndef VTSR_OPENGLES
+        // not part of the loaded core profile
+        if (version >= 41 || extension("GL_ARB_get_program_binary"))
+        {
+            glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)
+                functionLoader("glGetProgramBinary");
+            glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)
+                functionLoader("glProgramBinary");
+            glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)
+                functionLoader("glProgramParameteri");
+        }
+#endif
+        if (glGetProgramBinary && glProgramBinary && glProgramParameteri)
+        {
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+            programBinaryFormats.resize(count);
+            if (count > 0)
+                glGetIntegerv(GL_PROGRAM_BINARY_FORMATS,
+                    (GLint*)programBinaryFormats.data());
+        }
+
+        // parallel shader compilation
+        {
+            typedef void (*MaxThreadsProc)(GLuint count);
+            MaxThreadsProc maxThreads = nullptr;
+            if (extension("GL_KHR_parallel_shader_compile"))
+                maxThreads = (MaxThreadsProc)
+                    functionLoader("glMaxShaderCompilerThreadsKHR");
+            else if (extension("GL_ARB_parallel_shader_compile"))
+                maxThreads = (MaxThreadsProc)
+                    functionLoader("glMaxShaderCompilerThreadsARB");
+            if (maxThreads)
+            {
+                maxThreads(0xFFFFFFFF); // implementation specific maximum
+                parallelShaderCompile = true;
+            }
+        }
+    }
+#endif
+
     checkGlImpl("load gl extensions and attributes");
 
     vts::log(vts::LogLevel::info2, std::string("OpenGL vendor: ")
@@ -224,7 +317,12 @@ void loadGlFunctions(GLADloadproc functionLoader)
         std::stringstream ss;
         ss << "GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT: " << maxAnisotropySamples
             << ", GL_MAX_SAMPLES: " << maxAntialiasingSamples
-            << ", GL_KHR_debug: " << GLAD_GL_KHR_debug;
+            << ", GL_KHR_debug: " << GLAD_GL_KHR_debug
+            << ", glClipControl: " << !!clipControl
+            << ", program binary formats: " << programBinaryFormats.size()
+            << ", parallel shader compile: " << parallelShaderCompile
+            << ", compressed texture formats: "
+            << compressedTextureFormats.size();
         vts::log(vts::LogLevel::info1, ss.str());
     }
 }
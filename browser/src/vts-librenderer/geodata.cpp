@@ -36,6 +36,12 @@ namespace vts { namespace renderer
 GeodataTile::GeodataTile() : renderer(nullptr), info(nullptr)
 {}
 
+GeodataTile::~GeodataTile()
+{
+    if (page)
+        page->release(pageOffset, pageSize, pageSlot);
+}
+
 void GeodataTile::load(RenderContextImpl *renderer, ResourceInfo &info,
     GpuGeodataSpec &specp, const std::string &debugId)
 {
@@ -85,11 +91,18 @@ void GeodataTile::load(RenderContextImpl *renderer, ResourceInfo &info,
     std::vector<std::string>().swap(spec.texts);
     std::vector<std::shared_ptr<void>>().swap(spec.fontCascade);
 
+    // only the flat labels regenerate their glyphs along the lines
+    //   the other types have their positions in the mesh or in the points
+    if (spec.type != GpuGeodataSpec::Type::LabelFlat)
+        decltype(spec.positions)().swap(spec.positions);
+
     // compute memory requirements
     this->info->ramMemoryCost += getTotalPoints()
         * sizeof(decltype(spec.positions[0][0]));
     this->info->ramMemoryCost += spec.iconCoords.size()
         * sizeof(decltype(spec.iconCoords[0]));
+    this->info->ramMemoryCost += points.size()
+        * sizeof(decltype(points[0]));
     this->info->ramMemoryCost += sizeof(spec) + sizeof(*this);
     this->info = nullptr;
     renderer = nullptr;
@@ -126,18 +139,12 @@ vec3f GeodataTile::modelUp(const vec3f &modelPos)
 
 void GeodataTile::copyPoints()
 {
-    mat4 model = rawToMat4(spec.model);
     assert(points.empty());
     points.reserve(spec.positions.size());
     for (const auto &it : spec.positions)
     {
-        Point t;
-        t.modelPosition = rawToVec3(it[0].data());
-        t.worldPosition = vec4to3(vec4(model
-            * vec3to4(t.modelPosition, 1).cast<double>()));
-        t.worldUp = normalize(t.worldPosition).cast<float>();
-        assert(!std::isnan(t.worldPosition[0]));
-        points.push_back(t);
+        points.push_back(rawToVec3(it[0].data()));
+        assert(!std::isnan(points.back()[0]));
     }
 }
 
@@ -150,21 +157,21 @@ GeodataJob::GeodataJob(const std::shared_ptr<GeodataTile> &g,
 vec3f GeodataJob::modelPosition() const
 {
     assert(itemIndex != (uint32)-1);
-    return g->points[itemIndex].modelPosition;
+    return g->points[itemIndex];
 }
 
 vec3 GeodataJob::worldPosition() const
 {
     assert(itemIndex != (uint32)-1);
-    const auto res = g->points[itemIndex].worldPosition;
+    const vec3 res = vec4to3(vec4(g->model
+        * vec3to4(g->points[itemIndex], 1).cast<double>()));
     assert(!std::isnan(res[0]));
     return res;
 }
 
 vec3f GeodataJob::worldUp() const
 {
-    assert(itemIndex != (uint32)-1);
-    return g->points[itemIndex].worldUp;
+    return normalize(worldPosition()).cast<float>();
 }
 
 namespace
@@ -174,6 +181,14 @@ namespace
         vec2f s = vec2f(impl->width, impl->height);
         return Rect(r.a.cwiseProduct(s), r.b.cwiseProduct(s));
     }
+
+    // zero if the job does not use hysteresis
+    uint64 hysteresisId(const GeodataJob &j)
+    {
+        if (j.itemIndex == (uint32)-1 || j.g->spec.hysteresisIds.empty())
+            return 0;
+        return j.g->spec.hysteresisIds[j.itemIndex];
+    }
 }
 
 bool RenderViewImpl::collides(const GeodataJob &a, const GeodataJob &b)
@@ -274,6 +289,10 @@ bool RenderViewImpl::geodataDepthVisibility(const vec3 &pos, float threshold)
         return df < de + threshold;
     }
 
+    // tested on gpu instead
+    if (!options.debugDepthFeedback)
+        return true;
+
     // compare to the depth buffer
     vec3 p3 = pos + dir * threshold;
     vec4 p4 = depthBuffer.getConv() * vec3to4(p3, 1);
@@ -286,6 +305,21 @@ bool RenderViewImpl::geodataDepthVisibility(const vec3 &pos, float threshold)
     return true;
 }
 
+vec4f RenderViewImpl::geodataDepthTestPoint(const GeodataJob &job) const
+{
+    // same as geodataDepthVisibility, but with the current frame depth
+    const float threshold = job.g->spec.commonData.depthVisibilityThreshold;
+    if (options.debugDepthFeedback || std::isnan(threshold))
+        return vec4f(0, 0, 0, 0);
+    const vec3 pos = job.worldPosition();
+    const vec3 diff = vec3(rawToVec3(draws->camera.eye) - pos);
+    if (diff.squaredNorm() > 1e13)
+        return vec4f(0, 0, 0, 0); // compared with ellipsoid on cpu
+    const vec3 p3 = pos + normalize(diff) * threshold;
+    const vec3 ndc = vec4to3(vec4(viewProj * vec3to4(p3, 1)), true);
+    return vec3to4(ndc.cast<float>(), 1.f);
+}
+
 mat4 RenderViewImpl::depthOffsetCorrection(
     const std::shared_ptr<GeodataTile> &g) const
 {
@@ -412,7 +446,7 @@ void RenderViewImpl::bindUboView(const std::shared_ptr<GeodataTile> &g)
 
     mat4 model = rawToMat4(g->spec.model);
     mat4 mv = depthOffsetCorrection(g) * view * model;
-    mat4 mvp = proj * mv;
+    mat4 mvp = projRender * mv;
     mat4 mvInv = mv.inverse();
     mat4 mvpInv = mvp.inverse();
 
@@ -450,11 +484,16 @@ void RenderViewImpl::renderGeodata()
     filterJobsByResolvingCollisions();
     processJobsHysteresis();
     sortJobsByZIndexAndDepth();
+    glActiveTexture(GL_TEXTURE0 + 4);
+    glBindTexture(GL_TEXTURE_2D, depthBuffer.gpuTexture());
+    glActiveTexture(GL_TEXTURE0 + 0);
     renderJobs();
     if (options.debugGeodataMode == 2)
         renderJobsDebugRects();
     if (options.debugGeodataMode == 3)
         renderJobsDebugGlyphs();
+    stats.geodataJobs = geodataJobs.size();
+    stats.geodataHysteresisJobs = hysteresisJobs.size();
     geodataJobs.clear();
 
     glDepthMask(GL_TRUE);
@@ -507,12 +546,12 @@ void RenderViewImpl::bindUboCamera()
     struct UboCameraData
     {
         mat4f proj;
-        vec4f cameraParams; // screen width in pixels, screen height in pixels, view extent in meters
+        vec4f cameraParams; // screen width in pixels, screen height in pixels, view extent in meters, reversed depth
     } data;
 
-    data.proj = proj.cast<float>();
+    data.proj = projRender.cast<float>();
     data.cameraParams = vec4f(width, height,
-        draws->camera.viewExtent, 0);
+        draws->camera.viewExtent, reverseDepth ? 1 : 0);
 
     useDisposableUbo(0, data)->setDebugId("uboGeodataCamera");
 }
@@ -696,6 +735,74 @@ bool RenderViewImpl::regenerateJob(GeodataJob &j)
     return true;
 }
 
+void RenderViewImpl::generateTileJobs(GeodataTileJobs &c,
+    const std::shared_ptr<GeodataTile> &g)
+{
+    // the visibility tests are the expensive part
+    //   and their results are kept while the camera moves only slightly
+    //   the depth buffer changes even with static camera, therefore
+    //   the tests are also repeated periodically
+    static const uint32 rebuildFrames = 10;
+    const vec3 eye = rawToVec3(draws->camera.eye);
+    const vec3 forward = normalize(vec4to3(vec4(viewInv
+        * vec4(0, 0, -1, 0)), false));
+    const float threshold = options.geodataJobsReuse;
+    const bool full = c.g != g
+        || c.width != width || c.height != height
+        || c.textScale != options.textScale
+        || !(threshold > 0)
+        || frameIndex - c.rebuildFrame >= rebuildFrames
+        || length(vec3(eye - c.eye))
+            > threshold * draws->camera.targetDistance
+        || std::acos(std::min(dot(forward, c.forward), 1.0)) > threshold;
+
+    if (full)
+    {
+        c.jobs.clear();
+        for (uint32 index = 0, indexEnd = g->points.size();
+            index < indexEnd; index++)
+        {
+            GeodataJob j(g, index);
+
+            if (!geodataTestVisibility(
+                g->spec.commonData.visibilities,
+                j.worldPosition(), j.worldUp()))
+                continue;
+
+            if (!geodataDepthVisibility(j.worldPosition(),
+                g->spec.commonData.depthVisibilityThreshold))
+                continue;
+
+            if (regenerateJob(j))
+                c.jobs.push_back(std::move(j));
+        }
+        c.g = g;
+        c.eye = eye;
+        c.forward = forward;
+        c.textScale = options.textScale;
+        c.width = width;
+        c.height = height;
+        c.rebuildFrame = frameIndex;
+    }
+    else if (c.viewProj != viewProj
+        || g->spec.type == GpuGeodataSpec::Type::LabelFlat)
+    {
+        // keep the visible items, update their screen-space data only
+        //   flat labels store glyph rects in the tile itself,
+        //   which may have been overwritten by other views
+        std::vector<GeodataJob> jobs;
+        jobs.reserve(c.jobs.size());
+        for (const auto &it : c.jobs)
+        {
+            GeodataJob j(g, it.itemIndex);
+            if (regenerateJob(j))
+                jobs.push_back(std::move(j));
+        }
+        std::swap(jobs, c.jobs);
+    }
+    c.viewProj = viewProj;
+}
+
 void RenderViewImpl::generateJobs()
 {
     geodataJobs.clear();
@@ -734,26 +841,23 @@ void RenderViewImpl::generateJobs()
                 continue;
 
             // individual jobs for each icon/label
-            for (uint32 index = 0, indexEnd = g->points.size();
-                index < indexEnd; index++)
-            {
-                GeodataJob j(g, index);
-
-                if (!geodataTestVisibility(
-                    g->spec.commonData.visibilities,
-                    j.worldPosition(), j.worldUp()))
-                    continue;
-
-                if (!geodataDepthVisibility(j.worldPosition(),
-                    g->spec.commonData.depthVisibilityThreshold))
-                    continue;
-
-                if (regenerateJob(j))
-                    geodataJobs.push_back(std::move(j));
-            }
+            GeodataTileJobs &c = tilesJobs[g.get()];
+            c.usedFrame = frameIndex;
+            generateTileJobs(c, g);
+            geodataJobs.insert(geodataJobs.end(),
+                c.jobs.begin(), c.jobs.end());
         } break;
         }
     }
+
+    // forget tiles that are no longer rendered
+    for (auto it = tilesJobs.begin(); it != tilesJobs.end(); )
+    {
+        if (it->second.usedFrame != frameIndex)
+            it = tilesJobs.erase(it);
+        else
+            it++;
+    }
 }
 
 void RenderViewImpl::sortJobsByZIndexAndImportance()
@@ -841,9 +945,33 @@ void RenderViewImpl::renderJobsDebugImportance()
 
 void RenderViewImpl::filterJobsByResolvingCollisions()
 {
+    // accepted jobs are bucketed into a uniform screen-space grid
+    //   so that each job is tested against its neighbors only
+    static const uint32 cellPixels = 64;
+    const uint32 gw = std::max((width + cellPixels - 1) / cellPixels, 1u);
+    const uint32 gh = std::max((height + cellPixels - 1) / cellPixels, 1u);
+    for (auto &c : collisionGrid)
+        c.clear();
+    collisionGrid.resize(gw * gh);
+    collisionStamps.clear();
+    const auto &cellRange = [&](const Rect &r, uint32 range[4])
+    {
+        const auto &clamp = [](float v, uint32 n) -> uint32
+        {
+            // ndc (-1..1) to cell index
+            float c = (v * 0.5f + 0.5f) * n;
+            return (uint32)std::min(std::max(c, 0.f), n - 1.f);
+        };
+        range[0] = clamp(r.a[0], gw);
+        range[1] = clamp(r.a[1], gh);
+        range[2] = clamp(r.b[0], gw);
+        range[3] = clamp(r.b[1], gh);
+    };
+
     const float pixels = width * height;
     uint32 index = 0;
-    std::vector<GeodataJob> result;
+    uint32 stamp = 0;
+    std::vector<GeodataJob> &result = geodataJobsTmp;
     result.reserve(geodataJobs.size());
     for (auto &it : geodataJobs)
     {
@@ -851,17 +979,28 @@ void RenderViewImpl::filterJobsByResolvingCollisions()
             .featuresLimitPerPixelSquared;
         if (index > limitFactor * pixels)
             continue;
+        uint32 range[4];
         if (it.collisionRect.valid())
         {
+            cellRange(it.collisionRect, range);
+            stamp++;
             bool ok = true;
-            for (const auto &r : result)
+            for (uint32 y = range[1]; ok && y <= range[3]; y++)
             {
-                if (!r.collisionRect.valid())
-                    continue;
-                if (collides(it, r))
+                for (uint32 x = range[0]; ok && x <= range[2]; x++)
                 {
-                    ok = false;
-                    break;
+                    for (uint32 i : collisionGrid[y * gw + x])
+                    {
+                        // jobs spanning multiple cells are tested once
+                        if (collisionStamps[i] == stamp)
+                            continue;
+                        collisionStamps[i] = stamp;
+                        if (collides(it, result[i]))
+                        {
+                            ok = false;
+                            break;
+                        }
+                    }
                 }
             }
             if (!ok)
@@ -869,9 +1008,18 @@ void RenderViewImpl::filterJobsByResolvingCollisions()
         }
         if (!std::isnan(limitFactor))
             index++;
+        if (it.collisionRect.valid())
+        {
+            uint32 i = result.size();
+            for (uint32 y = range[1]; y <= range[3]; y++)
+                for (uint32 x = range[0]; x <= range[2]; x++)
+                    collisionGrid[y * gw + x].push_back(i);
+        }
+        collisionStamps.push_back(0);
         result.push_back(std::move(it));
     }
     std::swap(result, geodataJobs);
+    result.clear(); // keeps the capacity for the next frame
 }
 
 void RenderViewImpl::processJobsHysteresis()
@@ -882,52 +1030,63 @@ void RenderViewImpl::processJobsHysteresis()
         return;
     }
 
-    for (auto it = hysteresisJobs.begin(); it != hysteresisJobs.end(); )
+    // current jobs ordered by their ids
+    //   hysteresisJobs from previous frame are kept in the same order
+    //   so that both can be merged in a single pass
+    hysteresisOrder.clear();
+    for (uint32 i = 0, e = geodataJobs.size(); i < e; i++)
     {
-        it->second.opacity -= elapsedTime
-            / it->second.g->spec.commonData.hysteresisDuration[1];
-        if (it->second.opacity < -0.5f)
-            it = hysteresisJobs.erase(it);
-        else
-            it++;
+        uint64 id = hysteresisId(geodataJobs[i]);
+        if (id)
+            hysteresisOrder.emplace_back(id, i);
     }
+    std::sort(hysteresisOrder.begin(), hysteresisOrder.end());
 
-    for (auto &it : geodataJobs)
+    std::vector<GeodataJob> &next = hysteresisJobsTmp;
+    next.reserve(hysteresisOrder.size() + hysteresisJobs.size());
+    auto old = hysteresisJobs.begin();
+    const auto oldEnd = hysteresisJobs.end();
+    const auto &fadeOut = [&](GeodataJob &j)
     {
-        if (it.itemIndex == (uint32)-1 || it.g->spec.hysteresisIds.empty())
-            continue;
-        const std::string &id = it.g->spec.hysteresisIds[it.itemIndex];
-        auto hit = hysteresisJobs.find(id);
-        if (hit == hysteresisJobs.end())
-            it.opacity = -0.5f;
-        else
+        j.opacity -= elapsedTime / j.g->spec.commonData.hysteresisDuration[1];
+        if (j.opacity > 0.f)
+        {
+            regenerateJob(j);
+            geodataJobs.push_back(j);
+            next.push_back(std::move(j));
+        }
+    };
+    for (const auto &o : hysteresisOrder)
+    {
+        // previous jobs that are no longer present
+        while (old != oldEnd && hysteresisId(*old) < o.first)
+            fadeOut(*old++);
+
+        GeodataJob &it = geodataJobs[o.second];
+        const bool first = next.empty() || hysteresisId(next.back()) != o.first;
+        if (first && old != oldEnd && hysteresisId(*old) == o.first)
         {
-            it.opacity = hit->second.opacity;
-            hysteresisJobs.erase(hit);
+            it.opacity = std::max(old->opacity - float(elapsedTime
+                / old->g->spec.commonData.hysteresisDuration[1]), -0.5f);
+            old++;
         }
+        else
+            it.opacity = -0.5f;
         it.opacity +=
             + elapsedTime / it.g->spec.commonData.hysteresisDuration[0]
             + elapsedTime / it.g->spec.commonData.hysteresisDuration[1];
         it.opacity = std::min(it.opacity, 1.f);
+        if (first)
+            next.push_back(it);
     }
-
-    for (auto &it : hysteresisJobs)
-    {
-        if (it.second.opacity > 0.f)
-        {
-            regenerateJob(it.second);
-            geodataJobs.push_back(std::move(it.second));
-        }
-    }
-    hysteresisJobs.clear();
+    while (old != oldEnd)
+        fadeOut(*old++);
+    std::swap(next, hysteresisJobs);
+    next.clear();
 
     geodataJobs.erase(std::remove_if(geodataJobs.begin(),
         geodataJobs.end(), [&](GeodataJob &it) {
-        if (it.itemIndex == (uint32)-1 || it.g->spec.hysteresisIds.empty())
-            return false;
-        const std::string &id = it.g->spec.hysteresisIds[it.itemIndex];
-        hysteresisJobs.insert(std::make_pair(id, it));
-        return it.opacity <= 0;
+        return hysteresisId(it) && it.opacity <= 0;
     }), geodataJobs.end());
 }
 
@@ -978,6 +1137,7 @@ void RenderViewImpl::renderIcon(const GeodataJob &job)
         vec4f modelPos;
         vec4f color;
         vec4f uvs;
+        vec4f depthTest;
     } data;
 
     const auto &icon = job.g->spec.commonData.icon;
@@ -987,6 +1147,7 @@ void RenderViewImpl::renderIcon(const GeodataJob &job)
     data.color = rawToVec4(icon.color);
     data.color[3] *= job.opacity;
     data.uvs = rawToVec4(job.g->spec.iconCoords[job.itemIndex].data());
+    data.depthTest = geodataDepthTestPoint(job);
 
     useDisposableUbo(2, data)->setDebugId("UboIcon");
 
@@ -997,6 +1158,115 @@ void RenderViewImpl::renderIcon(const GeodataJob &job)
     context->meshQuad->dispatch();
 }
 
+namespace
+{
+
+// must match VTS_INSTANCES in the icon shaders
+const uint32 IconInstances = 128;
+
+struct UboIconInstance
+{
+    mat3x4f screen;
+    vec4f clipPos;
+    vec4f color;
+    vec4f uvs;
+    vec4f depthTest;
+};
+
+} // namespace
+
+uint32 RenderViewImpl::renderIconsInstanced(uint32 i)
+{
+    // consecutive icons without sticks sharing the bitmap
+    //   are drawn with one call, preserving their order
+    UboIconInstance data[IconInstances];
+    const void *bitmap = geodataJobs[i].g->spec.bitmap.get();
+    const GeodataTile *lastTile = nullptr;
+    mat4f mvp;
+    uint32 n = 0;
+    for (const uint32 e = geodataJobs.size(); i < e && n < IconInstances; i++)
+    {
+        const GeodataJob &job = geodataJobs[i];
+        const auto &g = job.g;
+        if (g->spec.type != GpuGeodataSpec::Type::IconScreen
+            || g->spec.bitmap.get() != bitmap
+            || job.stickRect.valid())
+            break;
+        if (!geodataTestVisibility(
+            g->spec.commonData.visibilities,
+            job.worldPosition(), job.worldUp()))
+            continue;
+        if (g.get() != lastTile)
+        {
+            // same as the mvp in the view ubo
+            lastTile = g.get();
+            mvp = mat4(projRender * depthOffsetCorrection(g) * view
+                * rawToMat4(g->spec.model)).cast<float>();
+            bindUboView(g);
+        }
+
+        const auto &icon = g->spec.commonData.icon;
+        UboIconInstance &d = data[n++];
+        d.screen = rectTransform(job, job.iconRect);
+        d.clipPos = mvp * vec3to4(job.modelPosition(), 1.f);
+        d.color = rawToVec4(icon.color);
+        d.color[3] *= job.opacity;
+        d.uvs = rawToVec4(g->spec.iconCoords[job.itemIndex].data());
+        d.depthTest = geodataDepthTestPoint(job);
+    }
+    if (n == 0)
+        return i;
+
+    // the whole block is bound, as declared in the shader
+    useDisposableUbo(2, data)->setDebugId("UboIconInstanced");
+
+    ((Texture*)bitmap)->bind();
+
+    context->shaderGeodataIconScreenInstanced->bind();
+    context->meshQuad->bind();
+    context->meshQuad->dispatchInstanced(n);
+    return i;
+}
+
+uint32 RenderViewImpl::renderTrianglesMerged(uint32 i)
+{
+    // consecutive jobs from the same page are drawn with one call
+    //   slots of tiles not drawn now keep zero matrices
+    struct UboSlot
+    {
+        mat4f mvp;
+        mat4f mv;
+    };
+    std::vector<UboSlot> data(privat::GeodataPage::Slots);
+    memset(data.data(), 0, data.size() * sizeof(UboSlot));
+    privat::GeodataPage *page = geodataJobs[i].g->page.get();
+    for (const uint32 e = geodataJobs.size(); i < e; i++)
+    {
+        const auto &g = geodataJobs[i].g;
+        if (g->page.get() != page)
+            break;
+        mat4 mv = depthOffsetCorrection(g) * view * g->model;
+        UboSlot &s = data[g->pageSlot];
+        s.mv = mv.cast<float>();
+        s.mvp = mat4(projRender * mv).cast<float>();
+    }
+
+    context->shaderGeodataTriangleMerged->bind();
+    page->uniform->bindToIndex(2);
+    useDisposableUbo(3, data.data(), data.size() * sizeof(UboSlot))
+        ->setDebugId("UboSlotsData");
+    page->bind();
+    bool stencil = geodataJobs[i - 1].g->spec.unionData.triangles.useStencil;
+    if (stencil)
+        glEnable(GL_STENCIL_TEST);
+    glDepthMask(GL_TRUE);
+    page->dispatch();
+    glDepthMask(GL_FALSE);
+    if (stencil)
+        glDisable(GL_STENCIL_TEST);
+    return i;
+}
+
 void RenderViewImpl::renderLabelFlat(const GeodataJob &job)
 {
     struct UboLabelFlat
@@ -1004,6 +1274,7 @@ void RenderViewImpl::renderLabelFlat(const GeodataJob &job)
         vec4f color[2];
         vec4f outline;
         vec4f position; // xyz
+        vec4f depthTest;
         vec4f coordinates[1000];
     } data;
 
@@ -1032,7 +1303,7 @@ void RenderViewImpl::renderLabelFlat(const GeodataJob &job)
         assert(worldPos.size() == worldFwd.size());
         for (auto &it : worldFwd)
             it = normalize(it);
-        mat4 vp = proj * depthOffsetCorrection(g) * view;
+        mat4 vp = projRender * depthOffsetCorrection(g) * view;
         vec4f *c = data.coordinates;
         for (uint32 i = 0, e = worldPos.size(); i != e; i++)
         {
@@ -1057,6 +1328,7 @@ void RenderViewImpl::renderLabelFlat(const GeodataJob &job)
     data.outline = fontOutline(t.size,
         rawToVec4(g->spec.unionData.labelFlat.outline));
     data.position = vec3to4(job.modelPosition(), 0);
+    data.depthTest = geodataDepthTestPoint(job);
     assert(t.coordinates.size() <= 500);
 
     context->shaderGeodataLabelFlat->bind();
@@ -1064,7 +1336,7 @@ void RenderViewImpl::renderLabelFlat(const GeodataJob &job)
 #ifdef __EMSCRIPTEN__
         sizeof(UboLabelFlat) // webgl restrictions
 #else
-        16 * sizeof(float) + 4 * sizeof(float) * t.coordinates.size() * 2
+        20 * sizeof(float) + 4 * sizeof(float) * t.coordinates.size() * 2
 #endif
     )->setDebugId("UboLabelFlat");
 
@@ -1089,6 +1361,7 @@ void RenderViewImpl::renderLabelScreen(const GeodataJob &job)
         vec4f outline;
         vec4f position; // xyz, scale
         vec4f offset;
+        vec4f depthTest;
         vec4f coordinates[500];
     } data;
 
@@ -1103,6 +1376,7 @@ void RenderViewImpl::renderLabelScreen(const GeodataJob &job)
         rawToVec4(g->spec.unionData.labelScreen.outline));
     data.position = vec3to4(job.modelPosition(), options.textScale * 2);
     data.offset = vec4f(job.labelOffset[0], job.labelOffset[1], 0, 0);
+    data.depthTest = geodataDepthTestPoint(job);
     assert(t.coordinates.size() <= 500);
     std::copy(t.coordinates.begin(), t.coordinates.end(), data.coordinates);
 
@@ -1111,7 +1385,7 @@ void RenderViewImpl::renderLabelScreen(const GeodataJob &job)
 #ifdef __EMSCRIPTEN__
         sizeof(UboLabelScreen) // webgl restrictions
 #else
-        20 * sizeof(float) + 4 * sizeof(float) * t.coordinates.size()
+        24 * sizeof(float) + 4 * sizeof(float) * t.coordinates.size()
 #endif
     )->setDebugId("UboLabelScreen");
 
@@ -1130,8 +1404,9 @@ void RenderViewImpl::renderLabelScreen(const GeodataJob &job)
 
 void RenderViewImpl::renderJobs()
 {
-    for (const GeodataJob &job : geodataJobs)
+    for (uint32 i = 0, e = geodataJobs.size(); i < e;)
     {
+        const GeodataJob &job = geodataJobs[i++];
         const auto &g = job.g;
 
         switch (g->spec.type)
@@ -1170,6 +1445,12 @@ void RenderViewImpl::renderJobs()
 
         case GpuGeodataSpec::Type::IconScreen:
         {
+            if (!job.stickRect.valid())
+            {
+                i = renderIconsInstanced(i - 1);
+                continue;
+            }
+
             if (!geodataTestVisibility(
                 g->spec.commonData.visibilities,
                 job.worldPosition(), job.worldUp()))
@@ -1208,6 +1489,11 @@ void RenderViewImpl::renderJobs()
         case GpuGeodataSpec::Type::Triangles:
         {
             assert(job.itemIndex == (uint32)-1);
+            if (g->page)
+            {
+                i = renderTrianglesMerged(i - 1);
+                continue;
+            }
             bindUboView(g);
             context->shaderGeodataTriangle->bind();
             g->uniform->bindToIndex(2);
@@ -1232,6 +1518,9 @@ void RenderContext::loadGeodata(ResourceInfo &info, GpuGeodataSpec &spec,
 {
     OPTICK_EVENT();
 
+    if (impl->sharedWith)
+        return impl->sharedWith->loadGeodata(info, spec, debugId);
+
     auto r = std::make_shared<GeodataTile>();
     r->load(&*impl, info, spec, debugId);
     info.userData = r;
@@ -31,6 +31,9 @@
 #include <vts-browser/cameraDraws.hpp>
 #include "renderer.hpp"
 
+#include <list>
+#include <unordered_map>
+
 namespace vts { namespace renderer
 {
 
@@ -57,11 +60,52 @@ struct Text
     float size = -1;
 };
 
-struct Point
+struct TmpGlyph
+{
+    std::shared_ptr<Font> font;
+    vec2f position; // screen units
+    vec2f size; // screen units
+    vec2f offset; // font units
+    float advance; // font units
+    uint16 glyphIndex;
+
+    TmpGlyph() : position(0, 0), offset(0, 0), advance(0), glyphIndex(0)
+    {}
+};
+
+struct TmpLine
 {
-    vec3 worldPosition;
-    vec3f worldUp;
-    vec3f modelPosition;
+    std::vector<TmpGlyph> glyphs;
+    float width; // screen units
+
+    TmpLine() : width(0)
+    {}
+};
+
+// least recently used shaped texts, shared by all geodata tiles
+//   the shaping does not depend on the size of the text
+//   and the script is deduced from the text itself
+class ShapedTextsCache : private Immovable
+{
+public:
+    std::vector<TmpLine> shape(const std::string &text,
+        const std::vector<std::shared_ptr<Font>> &fontCascade,
+        uint32 capacity);
+    void statistics(ContextStatistics &stats);
+
+private:
+    struct Entry
+    {
+        std::string key;
+        std::vector<std::shared_ptr<Font>> fontCascade; // keeps the fonts alive
+        std::vector<TmpLine> lines;
+    };
+
+    std::mutex mut;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    uint64 hits = 0;
+    uint64 misses = 0;
 };
 
 class GeodataTile : public std::enable_shared_from_this<GeodataTile>
@@ -78,13 +122,20 @@ public:
     std::shared_ptr<Mesh> mesh;
     std::shared_ptr<Texture> texture;
     std::unique_ptr<UniformBuffer> uniform;
+    std::shared_ptr<privat::GeodataPage> page; // merged triangles
+    uint32 pageOffset = 0;
+    uint32 pageSize = 0;
+    uint32 pageSlot = 0;
 
     std::vector<std::shared_ptr<Font>> fontCascade;
     std::vector<Text> texts;
 
-    std::vector<Point> points;
+    // model position of each icon or label (the anchor of its job)
+    //   the world position and up vector are derived on demand
+    std::vector<vec3f> points;
 
     GeodataTile();
+    ~GeodataTile();
     void load(RenderContextImpl *renderer, ResourceInfo &info, GpuGeodataSpec &specp, const std::string &debugId);
     void addMemory(ResourceInfo &other);
     uint32 getTotalPoints() const;
@@ -97,6 +148,7 @@ public:
     void loadLabelFlats();
     void loadIcons();
     void loadTriangles();
+    bool loadTrianglesMerged();
     bool checkTextures();
 };
 
@@ -77,8 +77,133 @@ float oneMeterInModel(const mat4 &model, const mat4 &modelInv)
     return length(vec4to3(c)); // measure the change in model space
 }
 
+struct UboTriangleData
+{
+    vec4f color;
+    vec4f visibilities;
+    vec4si32 flags; // shading
+};
+
 } // namespace
 
+namespace privat
+{
+
+GeodataPage::GeodataPage() : slab(GL_ARRAY_BUFFER, Capacity)
+{
+    freeSlots.reserve(Slots);
+    for (uint32 i = Slots; i-- > 0;)
+        freeSlots.push_back(i);
+}
+
+bool GeodataPage::acquire(uint32 size, uint32 &offset, uint32 &slot)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    if (freeSlots.empty() || !slab.acquire(size, offset))
+        return false;
+    slot = freeSlots.back();
+    freeSlots.pop_back();
+    return true;
+}
+
+void GeodataPage::release(uint32 offset, uint32 size, uint32 slot)
+{
+    // the page is drawn whole, the released range must be degenerate
+    Buffer zeros(size);
+    zeros.zero();
+    glBindBuffer(GL_ARRAY_BUFFER, slab.id);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, zeros.data());
+    CHECK_GL("release geodata page range");
+    slab.release(offset, size);
+    std::lock_guard<std::mutex> lock(mut);
+    freeSlots.push_back(slot);
+}
+
+void GeodataPage::bind()
+{
+    glBindBuffer(GL_ARRAY_BUFFER, slab.id);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, VertexSize, nullptr);
+    for (uint32 i = 1; i < 4; i++)
+        glDisableVertexAttribArray(i);
+    CHECK_GL("bind geodata page");
+}
+
+void GeodataPage::dispatch()
+{
+    glDrawArrays(GL_TRIANGLES, 0, slab.usedEnd() / VertexSize);
+    CHECK_GL("dispatch geodata page");
+}
+
+} // namespace privat
+
+bool GeodataPagePool::Key::operator < (const Key &other) const
+{
+    if (std::tie(style, stencil) != std::tie(other.style, other.stencil))
+        return std::tie(style, stencil) < std::tie(other.style, other.stencil);
+    int c = memcmp(color, other.color, sizeof(color));
+    if (c != 0)
+        return c < 0;
+    return memcmp(visibilities, other.visibilities,
+        sizeof(visibilities)) < 0;
+}
+
+std::shared_ptr<privat::GeodataPage> GeodataPagePool::acquire(
+    const Key &key, uint32 size, uint32 &offset, uint32 &slot)
+{
+    using privat::GeodataPage;
+    if (size > GeodataPage::Capacity / 4)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(mut);
+    auto &list = pages[key];
+
+    // reuse existing page with enough free space
+    for (auto it = list.begin(); it != list.end(); )
+    {
+        auto p = it->lock();
+        if (!p)
+        {
+            it = list.erase(it);
+            continue;
+        }
+        if (p->acquire(size, offset, slot))
+            return p;
+        it++;
+    }
+
+    // allocate new page
+    auto p = std::make_shared<GeodataPage>();
+    {
+        Buffer zeros(GeodataPage::Capacity);
+        zeros.zero();
+        glGenBuffers(1, &p->slab.id);
+        glBindBuffer(GL_ARRAY_BUFFER, p->slab.id);
+        glBufferData(GL_ARRAY_BUFFER, GeodataPage::Capacity,
+            zeros.data(), GL_STATIC_DRAW);
+        if (GLAD_GL_KHR_debug)
+        {
+            glObjectLabel(GL_BUFFER, p->slab.id, -1, "geodataPage");
+        }
+    }
+    {
+        UboTriangleData data;
+        data.color = rawToVec4(key.color);
+        data.visibilities = rawToVec4(key.visibilities);
+        data.flags = vec4si32(key.style, 0, 0, 0);
+        p->uniform = std::make_unique<UniformBuffer>();
+        p->uniform->setDebugId("geodataPage");
+        p->uniform->bind();
+        p->uniform->load(data, GL_STATIC_DRAW);
+    }
+    CHECK_GL("allocate geodata page");
+    list.push_back(p);
+    bool ok = p->acquire(size, offset, slot);
+    assert(ok);
+    (void)ok;
+    return p;
+}
+
 void GeodataTile::loadLines()
 {
     uint32 totalPoints = getTotalPoints(); // example: 7
@@ -327,11 +452,51 @@ void GeodataTile::loadIcons()
 {
     assert(spec.iconCoords.size() == spec.positions.size());
     copyPoints();
-    info->ramMemoryCost += points.size() * sizeof(decltype(points[0]));
+}
+
+bool GeodataTile::loadTrianglesMerged()
+{
+    GeodataPagePool::Key key;
+    for (uint32 i = 0; i < 4; i++)
+    {
+        key.color[i] = spec.unionData.triangles.color[i];
+        key.visibilities[i] = spec.commonData.visibilities[i];
+    }
+    key.style = (sint32)spec.unionData.triangles.style;
+    key.stencil = spec.unionData.triangles.useStencil;
+
+    const uint32 verticesCount = getTotalPoints();
+    const uint32 size = verticesCount * privat::GeodataPage::VertexSize;
+    page = renderer->geodataPages.acquire(key, size, pageOffset, pageSlot);
+    if (!page)
+        return false;
+    pageSize = size;
+
+    Buffer vertices(size);
+    float *f = (float*)vertices.data();
+    for (const auto &it1 : spec.positions)
+    {
+        for (const auto &it2 : it1)
+        {
+            for (float it : it2)
+                *f++ = it;
+            *f++ = pageSlot;
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, page->slab.id);
+    glBufferSubData(GL_ARRAY_BUFFER, pageOffset, size, vertices.data());
+    CHECK_GL("load merged geodata triangles");
+    info->gpuMemoryCost += size;
+    return true;
 }
 
 void GeodataTile::loadTriangles()
 {
+    if (renderer->options.geodataMerging
+        && getTotalPoints() % 3 == 0
+        && loadTrianglesMerged())
+        return;
+
     // prepare mesh
     {
         GpuMeshSpec msh;
@@ -352,12 +517,6 @@ void GeodataTile::loadTriangles()
 
     // prepare UBO
     {
-        struct UboTriangleData
-        {
-            vec4f color;
-            vec4f visibilities;
-            vec4si32 flags; // shading
-        };
         UboTriangleData uboTriangleData;
 
         uboTriangleData.color = rawToVec4(spec.unionData.triangles.color);
@@ -26,6 +26,7 @@
 
 #include <list>
 #include <map>
+#include <algorithm>
 
 #include "geodata.hpp"
 #include "font.hpp"
@@ -41,28 +42,6 @@ namespace vts { namespace renderer
 namespace
 {
 
-struct TmpGlyph
-{
-    std::shared_ptr<Font> font;
-    vec2f position; // screen units
-    vec2f size; // screen units
-    vec2f offset; // font units
-    float advance; // font units
-    uint16 glyphIndex;
-
-    TmpGlyph() : position(0, 0), offset(0, 0), advance(0), glyphIndex(0)
-    {}
-};
-
-struct TmpLine
-{
-    std::vector<TmpGlyph> glyphs;
-    float width; // screen units
-
-    TmpLine() : width(0)
-    {}
-};
-
 struct BidiAlgorithm
 {
     SBAlgorithmRef algorithm;
@@ -508,13 +487,8 @@ void textLinePositions(GeodataTile *g,
         uint32 i = 0;
         float f;
         arrayPosition<float>(lvp, 0, i, f);
-        Point t;
-        t.modelPosition = interpolate(rawToVec3(positions[i].data()),
-            rawToVec3(positions[i + 1].data()), (float)f);
-        t.worldPosition = interpolate(m2w(positions[i]),
-            m2w(positions[i + 1]), (double)f);
-        t.worldUp = normalize(t.worldPosition).cast<float>();
-        g->points.push_back(t);
+        g->points.push_back(interpolate(rawToVec3(positions[i].data()),
+            rawToVec3(positions[i + 1].data()), (float)f));
     }
 }
 
@@ -569,6 +543,65 @@ float labelFlatScale(const RenderViewImpl *rv,
 
 } // namespace
 
+std::vector<TmpLine> ShapedTextsCache::shape(const std::string &text,
+    const std::vector<std::shared_ptr<Font>> &fontCascade,
+    uint32 capacity)
+{
+    if (capacity == 0)
+        return textToGlyphs(text, fontCascade);
+
+    // the key is the identity of the fonts and the text
+    std::string key;
+    key.reserve(1 + fontCascade.size() * sizeof(void*) + text.size());
+    key.push_back((char)fontCascade.size());
+    for (const auto &f : fontCascade)
+    {
+        const Font *p = f.get();
+        key.append((const char*)&p, sizeof(p));
+    }
+    key += text;
+
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        auto it = index.find(key);
+        if (it != index.end())
+        {
+            hits++;
+            entries.splice(entries.begin(), entries, it->second);
+            return it->second->lines;
+        }
+        misses++;
+    }
+
+    // shaping is done without the lock
+    std::vector<TmpLine> lines = textToGlyphs(text, fontCascade);
+
+    std::lock_guard<std::mutex> lock(mut);
+    if (index.find(key) == index.end())
+    {
+        entries.emplace_front();
+        Entry &e = entries.front();
+        e.key = key;
+        e.fontCascade = fontCascade;
+        e.lines = lines;
+        index[std::move(key)] = entries.begin();
+        while (entries.size() > capacity)
+        {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+    }
+    return lines;
+}
+
+void ShapedTextsCache::statistics(ContextStatistics &stats)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    stats.shapedTextsCacheHits = hits;
+    stats.shapedTextsCacheMisses = misses;
+    stats.shapedTextsCacheEntries = entries.size();
+}
+
 void GeodataTile::copyFonts()
 {
     fontCascade.reserve(spec.fontCascade.size());
@@ -585,8 +618,9 @@ void GeodataTile::loadLabelScreens()
     float align = numericAlign(spec.unionData.labelScreen.textAlign);
     for (uint32 i = 0, e = spec.texts.size(); i != e; i++)
     {
-        std::vector<TmpLine> lines = textToGlyphs(
-            spec.texts[i], fontCascade);
+        std::vector<TmpLine> lines = renderer->shapedTexts->shape(
+            spec.texts[i], fontCascade,
+            renderer->options.shapedTextsCacheSize);
         vec2f originSize = textLayout(
             spec.unionData.labelScreen.size,
             align, lines);
@@ -609,8 +643,9 @@ void GeodataTile::loadLabelFlats()
     for (uint32 i = 0, e = spec.texts.size(); i != e; i++)
     {
         assert(spec.positions[i].size() > 1); // line must have at least two points
-        std::vector<TmpLine> lines = textToGlyphs(
-            spec.texts[i], fontCascade);
+        std::vector<TmpLine> lines = renderer->shapedTexts->shape(
+            spec.texts[i], fontCascade,
+            renderer->options.shapedTextsCacheSize);
         float size = spec.unionData.labelFlat.units
             == GpuGeodataSpec::Units::Meters
             ? 25 : spec.unionData.labelFlat.size;
@@ -629,15 +664,39 @@ void GeodataTile::loadLabelFlats()
 
 bool GeodataTile::checkTextures()
 {
+    // the glyph pages are requested only when a subtext uses them
+    // the pages are requested again every frame, which keeps them alive
+    //   in the map, but lets it evict (and later reload) the pages
+    //   when the memory is short
+    struct Page
+    {
+        const Font *font;
+        std::shared_ptr<Texture> texture;
+        uint16 fileIndex;
+    };
+    std::vector<Page> pages;
+    pages.reserve(4);
     bool ok = true;
     for (auto &t : texts)
     {
         for (auto &w : t.subtexts)
         {
-            if (w.texture)
-                continue;
-            w.texture = std::static_pointer_cast<Texture>(
-                w.font->fontHandle->requestTexture(w.fileIndex));
+            auto it = std::find_if(pages.begin(), pages.end(),
+                [&](const Page &p) {
+                    return p.font == w.font.get()
+                        && p.fileIndex == w.fileIndex;
+                });
+            if (it == pages.end())
+            {
+                Page p;
+                p.font = w.font.get();
+                p.fileIndex = w.fileIndex;
+                p.texture = std::static_pointer_cast<Texture>(
+                    w.font->fontHandle->requestTexture(w.fileIndex));
+                it = pages.insert(pages.end(), std::move(p));
+            }
+            // releases an evicted page
+            w.texture = it->texture;
             ok = ok && !!w.texture;
         }
     }
@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "renderer.hpp"
+
+namespace vts { namespace renderer
+{
+
+GpuTimers::GpuTimers()
+{
+#if !defined(VTSR_OPENGLES) && !defined(__EMSCRIPTEN__)
+    available = !!glGetQueryObjectui64v;
+#endif
+    for (uint32 f = 0; f < FramesCount; f++)
+        for (uint32 p = 0; p < PassesCount; p++)
+            issued[f][p] = false;
+    if (available)
+        glGenQueries(FramesCount * PassesCount, &queries[0][0]);
+}
+
+GpuTimers::~GpuTimers()
+{
+    if (available)
+        glDeleteQueries(FramesCount * PassesCount, &queries[0][0]);
+}
+
+void GpuTimers::frame(RenderStatistics &stats)
+{
+    assert(active < 0);
+    if (!available)
+        return;
+    index = (index + 1) % FramesCount;
+
+    // results of the frame that used this set of queries
+    double *const targets[PassesCount] = {
+        &stats.gpuTimeOpaque,
+        &stats.gpuTimeBackground,
+        &stats.gpuTimeTransparent,
+        &stats.gpuTimeWireframe,
+        &stats.gpuTimeDepthCopy,
+        &stats.gpuTimeGeodata,
+        &stats.gpuTimeFinalize,
+    };
+    bool any = false;
+    for (uint32 p = 0; p < PassesCount; p++)
+    {
+        if (!issued[index][p])
+        {
+            *targets[p] = 0;
+            continue;
+        }
+        GLuint ready = 0;
+        glGetQueryObjectuiv(queries[index][p],
+            GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready)
+            continue; // keep the previous value
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[index][p], GL_QUERY_RESULT, &ns);
+        *targets[p] = ns * 1e-6;
+        issued[index][p] = false;
+        any = true;
+    }
+    if (any)
+    {
+        stats.gpuTimeTotal = 0;
+        for (uint32 p = 0; p < PassesCount; p++)
+            stats.gpuTimeTotal += *targets[p];
+    }
+    CHECK_GL("gpu timers results");
+}
+
+void GpuTimers::begin(Pass pass)
+{
+    assert(active < 0);
+    // a query still waiting for its result is not restarted
+    if (!available || issued[index][pass])
+        return;
+    glBeginQuery(GL_TIME_ELAPSED, queries[index][pass]);
+    active = pass;
+}
+
+void GpuTimers::end()
+{
+    if (active < 0)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    issued[index][active] = true;
+    active = -1;
+}
+
+} } // namespace vts renderer
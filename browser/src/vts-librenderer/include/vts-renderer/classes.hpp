@@ -51,6 +51,9 @@ private:
 #endif
 };
 
+class TextureArrayPage;
+class MeshSlab;
+
 } // namespace privat
 
 class VTSR_API Shader : private privat::ResourceBase
@@ -86,10 +89,22 @@ public:
 
     static std::string preamble;
 
+    // directory for caching linked program binaries, empty = disabled
+    //   must be set before the programs are loaded
+    static std::string binaryCachePath;
+
 private:
+    // with parallel shader compilation, the link status is checked
+    //   and the locations are resolved on first use
+    struct Pending;
+    std::unique_ptr<Pending> pending;
     uint32 id = 0;
 
     int loadShader(const std::string &source, int stage) const;
+    void checkShader(int shader, const std::string &source) const;
+    bool loadBinary(const std::string &path);
+    void storeBinary(const std::string &path);
+    void finishLoad();
 };
 
 class VTSR_API Texture : private privat::ResourceBase
@@ -103,13 +118,33 @@ public:
     void clear();
     void bind();
     void load(ResourceInfo &info, GpuTextureSpec &spec, const std::string &debugId);
+    // the pixels are copied through the pixel unpack buffer
+    //   and the upload completes asynchronously
+    // the first bind makes the gpu wait for the upload (in any shared context)
+    void loadStaged(ResourceInfo &info, GpuTextureSpec &spec,
+        uint32 unpackBuffer, const std::string &debugId);
+    void loadLayer(ResourceInfo &info, GpuTextureSpec &spec,
+        const std::shared_ptr<privat::TextureArrayPage> &page, uint32 layer);
+    // places a fence after the upload commands
+    // the first bind makes the gpu wait for it (in any shared context)
+    void fenceUpload();
     void setId(uint32 id);
-    uint32 getId() const;
+    uint32 getId() const; // id of the texture array if stored in a layer
+    uint32 getLayer() const;
+    bool getArray() const;
     bool getGrayscale() const;
+    bool getAlphaMask() const;
 
 private:
+    std::shared_ptr<privat::TextureArrayPage> page;
+    void *uploadFence = nullptr; // GLsync
     uint32 id = 0;
+    uint32 layer = 0;
     bool grayscale = false;
+    bool alphaMask = false;
+
+    void loadImpl(ResourceInfo &info, GpuTextureSpec &spec, bool staged,
+        const std::string &debugId);
 };
 
 class VTSR_API Mesh : private privat::ResourceBase
@@ -125,13 +160,28 @@ public:
     void dispatch();
     void dispatch(uint32 offset, uint32 count); // offset: number of indices/vertices to skip; count: number of indices/vertices to render
     void dispatchWireframeSlow();
+    void dispatchInstanced(uint32 instances);
+    void dispatchInstanced(uint32 instances, uint32 offset, uint32 count);
     void load(ResourceInfo &info, GpuMeshSpec &spec, const std::string &debugId);
+    // the index slab may be null if the mesh has no indices
+    void loadSlabs(ResourceInfo &info, GpuMeshSpec &spec,
+        const std::shared_ptr<privat::MeshSlab> &vertexSlab,
+        uint32 vertexOffset,
+        const std::shared_ptr<privat::MeshSlab> &indexSlab,
+        uint32 indexOffset, const std::string &debugId);
+    // places a fence after the upload commands
+    // the first bind makes the gpu wait for it (in any shared context)
+    void fenceUpload();
     uint32 getVbo() const;
     uint32 getVio() const;
 
 private:
     GpuMeshSpec spec;
+    std::shared_ptr<privat::MeshSlab> vertexSlab, indexSlab;
+    void *uploadFence = nullptr; // GLsync
     uint32 vbo = 0, vio = 0;
+    uint32 vertexOffset = 0, indexOffset = 0; // bytes, within the slabs
+    uint32 vertexSize = 0, indexSize = 0;
 };
 
 class VTSR_API UniformBuffer : private privat::ResourceBase
@@ -45,6 +45,10 @@ VTSR_API void vtsCheckGlFramebuffer(uint32 target);
 // should be called once after the gl context has been created
 VTSR_API void vtsLoadGlFunctions(GLADloadproc functionLoader);
 
+// directory for caching linked shader programs, empty or null = disabled
+// should be called before creating the render context
+VTSR_API void vtsSetShaderBinaryCachePath(const char *path);
+
 #ifdef __cplusplus
 } // extern C
 #endif
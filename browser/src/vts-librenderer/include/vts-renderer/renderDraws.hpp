@@ -51,6 +51,7 @@ public:
     RenderDraws();
     explicit RenderDraws(Camera *cam);
 
+    // call on the render thread, the released draws destroy gpu resources
     void swap(Camera *cam);
 
     CameraDraws draws;
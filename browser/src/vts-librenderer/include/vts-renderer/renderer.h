@@ -38,6 +38,7 @@ typedef struct vtsCRenderContext *vtsHRenderContext;
 typedef struct vtsCRenderView *vtsHRenderView;
 
 VTSR_API vtsHRenderContext vtsRenderContextCreate();
+VTSR_API vtsHRenderContext vtsRenderContextCreateShared(vtsHRenderContext shareWith);
 VTSR_API void vtsRenderContextDestroy(vtsHRenderContext context);
 VTSR_API void vtsRenderContextBindLoadFunctions(vtsHRenderContext context, vtsHMap map);
 VTSR_API vtsHRenderView vtsRenderContextCreateView(vtsHRenderContext context, vtsHCamera camera);
@@ -46,8 +47,11 @@ VTSR_API void vtsRenderViewDestroy(vtsHRenderView view);
 VTSR_API vtsCRenderOptionsBase *vtsRenderViewOptions(vtsHRenderView view);
 VTSR_API const vtsCRenderVariablesBase *vtsRenderViewVariables(vtsHRenderView view);
 VTSR_API void vtsRenderViewRender(vtsHRenderView view);
+VTSR_API bool vtsRenderViewNeedsRedraw(vtsHRenderView view);
 VTSR_API void vtsRenderViewRenderCompas(vtsHRenderView view, const double screenPosSize[3], const double mapRotation[3]);
 VTSR_API void vtsRenderViewGetWorldPosition(vtsHRenderView view, const double screenPosIn[2], double worldPosOut[3]);
+typedef void (*vtsRenderPickCallbackType)(const double *worldPositions, uint32 width, uint32 height, void *userData);
+VTSR_API void vtsRenderViewPickWorldPositions(vtsHRenderView view, uint32 screenX, uint32 screenY, uint32 width, uint32 height, vtsRenderPickCallbackType callback, void *userData);
 
 #ifdef __cplusplus
 } // extern C
@@ -29,6 +29,7 @@
 
 #include <string>
 #include <memory>
+#include <functional>
 
 #include "rendererCommon.h"
 #include "foundation.hpp"
@@ -61,6 +62,47 @@ struct VTSR_API ContextOptions : public vtsCContextOptionsBase
     std::string toJson() const;
 };
 
+struct VTSR_API ContextStatistics
+{
+    ContextStatistics();
+
+    uint64 shapedTextsCacheHits;
+    uint64 shapedTextsCacheMisses;
+    uint32 shapedTextsCacheEntries;
+
+    // driver reported video memory, 0 = unknown
+    uint32 gpuMemoryCapacityKB;
+    uint32 gpuMemoryAvailableKB;
+};
+
+struct VTSR_API RenderStatistics
+{
+    RenderStatistics();
+
+    // gpu time of the render passes in milliseconds
+    // measured with timer queries, the values lag a few frames behind
+    // zero if the timer queries are not available
+    double gpuTimeOpaque;
+    double gpuTimeBackground;
+    double gpuTimeTransparent;
+    double gpuTimeWireframe;
+    double gpuTimeDepthCopy;
+    double gpuTimeGeodata; // including infographics
+    double gpuTimeFinalize;
+    double gpuTimeTotal; // sum of the passes above
+
+    // render resolution relative to the output, see dynamicResolutionBudget
+    float resolutionScale;
+
+    // memory of the uniform buffers with per-draw data
+    uint32 uboMemoryKB;
+
+    // geodata jobs of the last frame
+    //   the hysteresis keeps the fading jobs from previous frames
+    uint32 geodataJobs;
+    uint32 geodataHysteresisJobs;
+};
+
 struct VTSR_API RenderOptions : public vtsCRenderOptionsBase
 {
     RenderOptions();
@@ -82,6 +124,7 @@ public:
     Camera *camera();
     RenderOptions &options();
     const RenderVariables &variables() const;
+    const RenderStatistics &statistics() const;
 
     void render(RenderDraws *draws = nullptr);
 
@@ -90,11 +133,42 @@ public:
     void renderGeodata();
     void renderFinalize();
 
+    // render on demand
+    // returns true if the last render has labels fading in or out,
+    //   or if some readbacks or picks are pending,
+    //   which requires more calls to render even with unchanged draws
+    // see Map::needsUpdate and Camera::needsRedraw
+    bool needsRedraw() const;
+
     // reconstruct world position for mouse picking
     // uses data from last call to render
     // returns NaN if the position cannot be obtained
     void getWorldPosition(const double screenPosIn[2], double worldPosOut[3]);
 
+    // asynchronous picking
+    // reads back only the depth inside the rectangle (screen pixels)
+    //   in one of the following calls to render
+    // the callback is invoked from a later render,
+    //   once the gpu has finished the readback
+    // the world positions are row-major starting from the top-left corner,
+    //   at the resolution of the depth buffer (a third of the screen)
+    // positions without depth are NaN
+    typedef std::function<void(const double *worldPositions,
+        uint32 width, uint32 height)> PickCallback;
+    void pickWorldPositions(uint32 screenX, uint32 screenY,
+        uint32 width, uint32 height, PickCallback callback);
+    void pickWorldPosition(const double screenPos[2],
+        std::function<void(const double worldPos[3])> callback);
+
+    // asynchronous readback of the rendered color
+    //   the color of the next call to render is copied into a pbo
+    // the callback is invoked from a later render (or renderFinalize),
+    //   once the gpu has finished the copy
+    // the pixels are rgb8, rows bottom-up, at the render resolution
+    typedef std::function<void(const unsigned char *pixels,
+        uint32 width, uint32 height)> ColorCallback;
+    void readbackColor(ColorCallback callback);
+
     void renderCompass(const double screenPosSize[3], const double mapRotation[3]);
 
 private:
@@ -108,10 +182,18 @@ public:
     // load all shaders and initialize all state required for the rendering
     RenderContext();
 
+    // reuse the shaders, meshes and all loaded resources of another context
+    //   the gl contexts must be in one share group
+    //   and this context must be current while creating it
+    // the loads, including bindLoadFunctions, are forwarded to the other context
+    //   which is kept alive while any context shares its resources
+    explicit RenderContext(const std::shared_ptr<RenderContext> &shareWith);
+
     // clear the loaded shaders etc.
     ~RenderContext();
 
     ContextOptions &options();
+    ContextStatistics statistics() const;
 
     // can be directly bound to MapCallbacks
     void loadTexture(ResourceInfo &info, GpuTextureSpec &spec, const std::string &debugId);
@@ -48,6 +48,41 @@ typedef struct vtsCContextOptionsBase
     // enforce using mipmaps on all textures
     // this is useful when using targetPixelRatioSurfaces far from its default
     bool enforceUsingMipMaps;
+
+    // store tile textures of same format and resolution in layers
+    //   of shared texture arrays
+    // this reduces number of texture binds when rendering surfaces
+    bool textureArrays;
+
+    // upload textures through a pixel unpack buffer and synchronize
+    //   with a fence at the first use instead of glFinish
+    // ignored on webgl
+    bool stagedTextureUploads;
+
+    // place a fence after each mesh and texture upload
+    //   and make the gpu wait for it at the first use instead of glFinish
+    // this allows uploading from multiple data threads,
+    //   each with its own shared context
+    // ignored on webgl
+    bool fenceUploads;
+
+    // store tile meshes in large shared vertex and index buffers
+    //   instead of creating separate buffers for each mesh
+    bool meshSlabs;
+
+    // render consecutive opaque surfaces that share mesh and textures
+    //   with a single instanced draw call
+    // works best together with texture arrays and sorting draws by state
+    bool instancedSurfaces;
+
+    // store triangle geodata of the same style from multiple tiles
+    //   in shared vertex buffers and draw each buffer with single call
+    bool geodataMerging;
+
+    // maximum number of shaped geodata texts kept for reuse
+    //   by other labels and tiles with the same text
+    // 0 = disabled
+    uint32 shapedTextsCacheSize;
 } vtsCContextOptionsBase;
 
 // options provided from the application (you set these)
@@ -82,6 +117,40 @@ typedef struct vtsCRenderOptionsBase
     // where to copy the result (and resolve multisampling)
     bool colorToTargetFrameBuffer;
     bool colorToTexture; // accessible as RenderVariables::colorReadTexId
+
+    // the options below are appended to keep the layout
+    //   of the preceding fields for the bindings
+
+    // camera change (relative to target distance, or radians)
+    //   up to which visibility of geodata labels and icons is reused
+    //   zero will test the visibility every frame
+    float geodataJobsReuse;
+
+    // floating point depth buffer with reversed range (near = 1, far = 0)
+    //   improves depth precision at large distances
+    //   requires glClipControl (GL 4.5, ARB_clip_control or EXT_clip_control)
+    //   ignored when not available
+    bool reverseDepth;
+
+    // target gpu time of the frame in milliseconds, zero = disabled
+    //   the render resolution is lowered (down to dynamicResolutionMinScale)
+    //   and the result is upscaled to the output
+    //   requires gpu timer queries (see RenderStatistics)
+    float dynamicResolutionBudget;
+    float dynamicResolutionMinScale;
+
+    // the atmosphere background is rendered at 1 / backgroundDownscale
+    //   of the render resolution and upsampled behind the surfaces
+    //   1 = full resolution
+    uint32 backgroundDownscale;
+
+    // size of the cube map faces of the far field impostor
+    //   see CameraOptions::farFieldDistance
+    uint32 farFieldResolution;
+
+    // number of helper threads that prepare the uniform data
+    //   of large surface passes, 0 = render thread only
+    uint32 recordingThreads;
 } vtsCRenderOptionsBase;
 
 // these variables are controlled by the library
@@ -25,12 +25,25 @@
  */
 
 #include "renderer.hpp"
+#include "geodata.hpp"
 
 #include <vts-browser/resources.hpp>
 
 namespace vts { namespace renderer
 {
 
+namespace
+{
+
+// GL_NVX_gpu_memory_info
+const GLenum GpuMemoryDedicatedNvx = 0x9047;
+const GLenum GpuMemoryCurrentAvailableNvx = 0x9049;
+
+// GL_ATI_meminfo
+const GLenum TextureFreeMemoryAti = 0x87FC;
+
+} // namespace
+
 void ShaderAtm::initializeAtmosphere()
 {
     bindUniformBlockLocations({
@@ -41,11 +54,15 @@ void ShaderAtm::initializeAtmosphere()
         });
 }
 
-RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
+RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api),
+    meshVertexSlabs(GL_ARRAY_BUFFER),
+    meshIndexSlabs(GL_ELEMENT_ARRAY_BUFFER),
+    shapedTexts(std::make_unique<ShapedTextsCache>()),
+    gpuMemoryCapacityKB(0), gpuMemoryAvailableKB(0)
 {
-    std::string atm = readInternalMemoryBuffer(
+    std::string atm = shareInternalMemoryBuffer(
         "data/shaders/atmosphere.inc.glsl").str();
-    std::string geo = readInternalMemoryBuffer(
+    std::string geo = shareInternalMemoryBuffer(
         "data/shaders/geodata.inc.glsl").str();
 
     // global VAO
@@ -57,9 +74,8 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
     // load texture compas
     {
         texCompas = std::make_shared<Texture>();
-        GpuTextureSpec spec(vts::readInternalMemoryBuffer(
-            "data/textures/compas.png"));
-        spec.verticalFlip();
+        GpuTextureSpec spec(vts::shareInternalMemoryBuffer(
+            "data/textures/compas.png"), true);
         ResourceInfo ri;
         texCompas->load(ri, spec, "data/textures/compas.png");
     }
@@ -73,13 +89,12 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         {
             std::stringstream ss;
             ss << "data/textures/blueNoise/" << i << ".png";
-            GpuTextureSpec spec(vts::readInternalMemoryBuffer(ss.str()));
+            GpuTextureSpec spec(vts::shareInternalMemoryBuffer(ss.str()), true);
             assert(spec.width == 64);
             assert(spec.height == 64);
             assert(spec.components == 1);
             assert(spec.type == GpuTypeEnum::UnsignedByte);
             assert(spec.buffer.size() == 64 * 64);
-            spec.verticalFlip();
             memcpy(buff.data() + (64 * 64 * i), spec.buffer.data(), 64 * 64);
         }
         glActiveTexture(GL_TEXTURE0 + 9);
@@ -123,9 +138,9 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderSurface = std::make_shared<ShaderAtm>();
         shaderSurface->setDebugId(
             "data/shaders/surface.*.glsl");
-        Buffer vert = readInternalMemoryBuffer(
+        Buffer vert = shareInternalMemoryBuffer(
             "data/shaders/surface.vert.glsl");
-        Buffer frag = readInternalMemoryBuffer(
+        Buffer frag = shareInternalMemoryBuffer(
             "data/shaders/surface.frag.glsl");
         shaderSurface->load(atm + vert.str(), atm + frag.str());
         shaderSurface->bindUniformBlockLocations({
@@ -134,9 +149,29 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderSurface->bindTextureLocations({
                 { "texColor", 0 },
                 { "texMask", 1 },
+                { "texColorArray", 2 },
+                { "texMaskArray", 3 },
                 { "texBlueNoise", 9 }
             });
         shaderSurface->initializeAtmosphere();
+
+        shaderSurfaceInstanced = std::make_shared<ShaderAtm>();
+        shaderSurfaceInstanced->setDebugId(
+            "data/shaders/surface.*.glsl (instanced)");
+        static const std::string instanced = "#define VTS_INSTANCED\n";
+        shaderSurfaceInstanced->load(instanced + atm + vert.str(),
+            instanced + atm + frag.str());
+        shaderSurfaceInstanced->bindUniformBlockLocations({
+                 { "uboSurface", 1 }
+             });
+        shaderSurfaceInstanced->bindTextureLocations({
+                { "texColor", 0 },
+                { "texMask", 1 },
+                { "texColorArray", 2 },
+                { "texMaskArray", 3 },
+                { "texBlueNoise", 9 }
+            });
+        shaderSurfaceInstanced->initializeAtmosphere();
     }
 
     // load shader infographic
@@ -161,18 +196,49 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderBackground = std::make_shared<ShaderAtm>();
         shaderBackground->setDebugId(
             "data/shaders/background.*.glsl");
-        Buffer vert = readInternalMemoryBuffer(
+        Buffer vert = shareInternalMemoryBuffer(
             "data/shaders/background.vert.glsl");
-        Buffer frag = readInternalMemoryBuffer(
+        Buffer frag = shareInternalMemoryBuffer(
             "data/shaders/background.frag.glsl");
         shaderBackground->load(vert.str(), atm + frag.str());
         shaderBackground->loadUniformLocations({
                 "uniCorners[0]",
                 "uniCorners[1]",
                 "uniCorners[2]",
-                "uniCorners[3]"
+                "uniCorners[3]",
+                "uniFarDepth"
             });
         shaderBackground->initializeAtmosphere();
+
+        shaderBackgroundUpsample = std::make_shared<Shader>();
+        shaderBackgroundUpsample->setDebugId(
+            "data/shaders/background.*.glsl (upsample)");
+        static const std::string upsample = "#define VTS_UPSAMPLE\n";
+        shaderBackgroundUpsample->load(upsample + vert.str(),
+            upsample + frag.str());
+        shaderBackgroundUpsample->loadUniformLocations({
+                "uniFarDepth"
+            });
+        shaderBackgroundUpsample->bindTextureLocations({
+                { "texBackground", 0 }
+            });
+
+        shaderFarField = std::make_shared<Shader>();
+        shaderFarField->setDebugId(
+            "data/shaders/background.*.glsl (far field)");
+        static const std::string farField = "#define VTS_FAR_FIELD\n";
+        shaderFarField->load(farField + vert.str(),
+            farField + frag.str());
+        shaderFarField->loadUniformLocations({
+                "uniCorners[0]",
+                "uniCorners[1]",
+                "uniCorners[2]",
+                "uniCorners[3]",
+                "uniFarDepth"
+            });
+        shaderFarField->bindTextureLocations({
+                { "texFarField", 0 }
+            });
     }
 
     // load shader copy depth
@@ -184,7 +250,8 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
             "data/shaders/copyDepth.vert.glsl",
             "data/shaders/copyDepth.frag.glsl");
         shaderCopyDepth->loadUniformLocations({
-                "uniTexPos"
+                "uniTexPos",
+                "uniReversed"
             });
         shaderCopyDepth->bindTextureLocations({
                 { "texDepth", 0 }
@@ -194,7 +261,7 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
     // load mesh quad
     {
         meshQuad = std::make_shared<Mesh>();
-        vts::GpuMeshSpec spec(vts::readInternalMemoryBuffer(
+        vts::GpuMeshSpec spec(vts::shareInternalMemoryBuffer(
             "data/meshes/quad.obj"));
         assert(spec.faceMode == vts::GpuMeshSpec::FaceMode::Triangles);
         spec.attributes[0].enable = true;
@@ -211,7 +278,7 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
     // load mesh rect
     {
         meshRect = std::make_shared<Mesh>();
-        vts::GpuMeshSpec spec(vts::readInternalMemoryBuffer(
+        vts::GpuMeshSpec spec(vts::shareInternalMemoryBuffer(
             "data/meshes/rect.obj"));
         assert(spec.faceMode == vts::GpuMeshSpec::FaceMode::Triangles);
         spec.attributes[0].enable = true;
@@ -228,7 +295,7 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
     // load mesh line
     {
         meshLine = std::make_shared<Mesh>();
-        vts::GpuMeshSpec spec(vts::readInternalMemoryBuffer(
+        vts::GpuMeshSpec spec(vts::shareInternalMemoryBuffer(
             "data/meshes/line.obj"));
         assert(spec.faceMode == vts::GpuMeshSpec::FaceMode::Lines);
         spec.attributes[0].enable = true;
@@ -255,9 +322,9 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
     {
         shaderGeodataColor = std::make_shared<Shader>();
         shaderGeodataColor->setDebugId("data/shaders/geodataColor.*.glsl");
-        Buffer vert = readInternalMemoryBuffer(
+        Buffer vert = shareInternalMemoryBuffer(
             "data/shaders/geodataColor.vert.glsl");
-        Buffer frag = readInternalMemoryBuffer(
+        Buffer frag = shareInternalMemoryBuffer(
             "data/shaders/geodataColor.frag.glsl");
         shaderGeodataColor->load(geo + vert.str(), geo + frag.str());
         shaderGeodataColor->bindUniformBlockLocations({
@@ -272,9 +339,9 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderGeodataPointFlat = std::make_shared<Shader>();
         shaderGeodataPointFlat->setDebugId(
             "data/shaders/geodataPointFlat.*.glsl");
-        Buffer vert = readInternalMemoryBuffer(
+        Buffer vert = shareInternalMemoryBuffer(
             "data/shaders/geodataPointFlat.vert.glsl");
-        Buffer frag = readInternalMemoryBuffer(
+        Buffer frag = shareInternalMemoryBuffer(
             "data/shaders/geodataPoint.frag.glsl");
         shaderGeodataPointFlat->load(geo + vert.str(), geo + frag.str());
         shaderGeodataPointFlat->bindTextureLocations({
@@ -292,9 +359,9 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderGeodataPointScreen = std::make_shared<Shader>();
         shaderGeodataPointScreen->setDebugId(
             "data/shaders/geodataPointScreen.*.glsl");
-        Buffer vert = readInternalMemoryBuffer(
+        Buffer vert = shareInternalMemoryBuffer(
             "data/shaders/geodataPointScreen.vert.glsl");
-        Buffer frag = readInternalMemoryBuffer(
+        Buffer frag = shareInternalMemoryBuffer(
             "data/shaders/geodataPoint.frag.glsl");
         shaderGeodataPointScreen->load(geo + vert.str(), geo + frag.str());
         shaderGeodataPointScreen->bindTextureLocations({
@@ -312,9 +379,9 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderGeodataLineFlat = std::make_shared<Shader>();
         shaderGeodataLineFlat->setDebugId(
             "data/shaders/geodataLineFlat.*.glsl");
-        Buffer vert = readInternalMemoryBuffer(
+        Buffer vert = shareInternalMemoryBuffer(
             "data/shaders/geodataLineFlat.vert.glsl");
-        Buffer frag = readInternalMemoryBuffer(
+        Buffer frag = shareInternalMemoryBuffer(
             "data/shaders/geodataLine.frag.glsl");
         shaderGeodataLineFlat->load(geo + vert.str(), geo + frag.str());
         shaderGeodataLineFlat->bindTextureLocations({
@@ -332,9 +399,9 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderGeodataLineScreen = std::make_shared<Shader>();
         shaderGeodataLineScreen->setDebugId(
             "data/shaders/geodataLineScreen.*.glsl");
-        Buffer vert = readInternalMemoryBuffer(
+        Buffer vert = shareInternalMemoryBuffer(
             "data/shaders/geodataLineScreen.vert.glsl");
-        Buffer frag = readInternalMemoryBuffer(
+        Buffer frag = shareInternalMemoryBuffer(
             "data/shaders/geodataLine.frag.glsl");
         shaderGeodataLineScreen->load(geo + vert.str(), geo + frag.str());
         shaderGeodataLineScreen->bindTextureLocations({
@@ -352,19 +419,36 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderGeodataIconScreen = std::make_shared<Shader>();
         shaderGeodataIconScreen->setDebugId(
             "data/shaders/geodataIcon.*.glsl");
-        Buffer vert = readInternalMemoryBuffer(
+        Buffer vert = shareInternalMemoryBuffer(
             "data/shaders/geodataIcon.vert.glsl");
-        Buffer frag = readInternalMemoryBuffer(
+        Buffer frag = shareInternalMemoryBuffer(
             "data/shaders/geodataIcon.frag.glsl");
         shaderGeodataIconScreen->load(geo + vert.str(), geo + frag.str());
         shaderGeodataIconScreen->bindTextureLocations({
-                { "texIcons", 0 }
+                { "texIcons", 0 },
+                { "texDepthTest", 4 }
             });
         shaderGeodataIconScreen->bindUniformBlockLocations({
                 { "uboCameraData", 0 },
                 { "uboViewData", 1 },
                 { "uboIconData", 2 }
             });
+
+        shaderGeodataIconScreenInstanced = std::make_shared<Shader>();
+        shaderGeodataIconScreenInstanced->setDebugId(
+            "data/shaders/geodataIcon.*.glsl (instanced)");
+        static const std::string instanced = "#define VTS_INSTANCED\n";
+        shaderGeodataIconScreenInstanced->load(instanced + geo + vert.str(),
+            instanced + geo + frag.str());
+        shaderGeodataIconScreenInstanced->bindTextureLocations({
+                { "texIcons", 0 },
+                { "texDepthTest", 4 }
+            });
+        shaderGeodataIconScreenInstanced->bindUniformBlockLocations({
+                { "uboCameraData", 0 },
+                { "uboViewData", 1 },
+                { "uboIconData", 2 }
+            });
     }
 
     // load shader geodata label flat
@@ -372,13 +456,14 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderGeodataLabelFlat = std::make_shared<Shader>();
         shaderGeodataLabelFlat->setDebugId(
             "data/shaders/geodataLabelFlat.*.glsl");
-        Buffer vert = readInternalMemoryBuffer(
+        Buffer vert = shareInternalMemoryBuffer(
             "data/shaders/geodataLabelFlat.vert.glsl");
-        Buffer frag = readInternalMemoryBuffer(
+        Buffer frag = shareInternalMemoryBuffer(
             "data/shaders/geodataLabelFlat.frag.glsl");
         shaderGeodataLabelFlat->load(geo + vert.str(), geo + frag.str());
         shaderGeodataLabelFlat->bindTextureLocations({
-                { "texGlyphs", 0 }
+                { "texGlyphs", 0 },
+                { "texDepthTest", 4 }
             });
         shaderGeodataLabelFlat->bindUniformBlockLocations({
                 { "uboCameraData", 0 },
@@ -395,13 +480,14 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderGeodataLabelScreen = std::make_shared<Shader>();
         shaderGeodataLabelScreen->setDebugId(
             "data/shaders/geodataLabelScreen.*.glsl");
-        Buffer vert = readInternalMemoryBuffer(
+        Buffer vert = shareInternalMemoryBuffer(
             "data/shaders/geodataLabelScreen.vert.glsl");
-        Buffer frag = readInternalMemoryBuffer(
+        Buffer frag = shareInternalMemoryBuffer(
             "data/shaders/geodataLabelScreen.frag.glsl");
         shaderGeodataLabelScreen->load(geo + vert.str(), geo + frag.str());
         shaderGeodataLabelScreen->bindTextureLocations({
-                { "texGlyphs", 0 }
+                { "texGlyphs", 0 },
+                { "texDepthTest", 4 }
             });
         shaderGeodataLabelScreen->bindUniformBlockLocations({
                 { "uboCameraData", 0 },
@@ -418,9 +504,9 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderGeodataTriangle = std::make_shared<Shader>();
         shaderGeodataTriangle->setDebugId(
             "data/shaders/geodataTriangle.*.glsl");
-        Buffer vert = readInternalMemoryBuffer(
+        Buffer vert = shareInternalMemoryBuffer(
             "data/shaders/geodataTriangle.vert.glsl");
-        Buffer frag = readInternalMemoryBuffer(
+        Buffer frag = shareInternalMemoryBuffer(
             "data/shaders/geodataTriangle.frag.glsl");
         shaderGeodataTriangle->load(geo + vert.str(), geo + frag.str());
         shaderGeodataTriangle->bindUniformBlockLocations({
@@ -428,14 +514,126 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
                 { "uboViewData", 1 },
                 { "uboTriangleData", 2 }
             });
+
+        shaderGeodataTriangleMerged = std::make_shared<Shader>();
+        shaderGeodataTriangleMerged->setDebugId(
+            "data/shaders/geodataTriangle.*.glsl (merged)");
+        static const std::string merged = "#define VTS_MERGED\n";
+        shaderGeodataTriangleMerged->load(merged + geo + vert.str(),
+            merged + geo + frag.str());
+        shaderGeodataTriangleMerged->bindUniformBlockLocations({
+                { "uboCameraData", 0 },
+                { "uboViewData", 1 },
+                { "uboTriangleData", 2 },
+                { "uboSlotsData", 3 }
+            });
     }
 
+    detectGpuMemory();
+
     CHECK_GL("initialize");
 }
 
+RenderContextImpl::RenderContextImpl(RenderContext *api,
+    const std::shared_ptr<RenderContext> &sharedWith,
+    RenderContextImpl *loader) : api(api),
+    meshVertexSlabs(GL_ARRAY_BUFFER),
+    meshIndexSlabs(GL_ELEMENT_ARRAY_BUFFER),
+    sharedWith(sharedWith), loader(loader),
+    gpuMemoryCapacityKB(0), gpuMemoryAvailableKB(0)
+{
+    assert(sharedWith && loader && !loader->sharedWith);
+    options = loader->options;
+
+    glGenVertexArrays(1, &globalVao);
+    glBindVertexArray(globalVao);
+
+    texCompas = loader->texCompas;
+    texBlueNoise = loader->texBlueNoise;
+    shaderSurface = loader->shaderSurface;
+    shaderSurfaceInstanced = loader->shaderSurfaceInstanced;
+    shaderBackground = loader->shaderBackground;
+    shaderBackgroundUpsample = loader->shaderBackgroundUpsample;
+    shaderFarField = loader->shaderFarField;
+    shaderInfographics = loader->shaderInfographics;
+    shaderTexture = loader->shaderTexture;
+    shaderCopyDepth = loader->shaderCopyDepth;
+    shaderGeodataColor = loader->shaderGeodataColor;
+    shaderGeodataPointFlat = loader->shaderGeodataPointFlat;
+    shaderGeodataPointScreen = loader->shaderGeodataPointScreen;
+    shaderGeodataLineFlat = loader->shaderGeodataLineFlat;
+    shaderGeodataLineScreen = loader->shaderGeodataLineScreen;
+    shaderGeodataIconScreen = loader->shaderGeodataIconScreen;
+    shaderGeodataIconScreenInstanced = loader->shaderGeodataIconScreenInstanced;
+    shaderGeodataLabelFlat = loader->shaderGeodataLabelFlat;
+    shaderGeodataLabelScreen = loader->shaderGeodataLabelScreen;
+    shaderGeodataTriangle = loader->shaderGeodataTriangle;
+    shaderGeodataTriangleMerged = loader->shaderGeodataTriangleMerged;
+    meshQuad = loader->meshQuad;
+    meshRect = loader->meshRect;
+    meshLine = loader->meshLine;
+    meshEmpty = loader->meshEmpty;
+
+    detectGpuMemory();
+
+    CHECK_GL("initialize shared");
+}
+
+// video memory info extensions
+void RenderContextImpl::detectGpuMemory()
+{
+    GLint n = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for (GLint i = 0; i < n; i++)
+    {
+        const char *e = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (!e)
+            continue;
+        if (strcmp(e, "GL_NVX_gpu_memory_info") == 0)
+            gpuMemoryNvx = true;
+        else if (strcmp(e, "GL_ATI_meminfo") == 0)
+            gpuMemoryAti = true;
+    }
+    queryGpuMemory();
+}
+
+void RenderContextImpl::queryGpuMemory()
+{
+    if (gpuMemoryNvx)
+    {
+        GLint dedicated = 0, available = 0;
+        glGetIntegerv(GpuMemoryDedicatedNvx, &dedicated);
+        glGetIntegerv(GpuMemoryCurrentAvailableNvx, &available);
+        gpuMemoryCapacityKB = std::max(dedicated, 0);
+        gpuMemoryAvailableKB = std::max(available, 0);
+    }
+    else if (gpuMemoryAti)
+    {
+        // the extension does not report the total size
+        //   the free memory seen at startup is the best estimate
+        GLint info[4] = {};
+        glGetIntegerv(TextureFreeMemoryAti, info);
+        uint32 available = std::max(info[0], 0);
+        gpuMemoryAvailableKB = available;
+        if (gpuMemoryCapacityKB == 0)
+            gpuMemoryCapacityKB = available;
+    }
+}
+
 RenderContextImpl::~RenderContextImpl()
 {
     glDeleteVertexArrays(1, &globalVao);
+    for (auto &it : textureStagingBuffers)
+        glDeleteBuffers(1, &it.second);
+}
+
+uint32 RenderContextImpl::textureStagingBuffer()
+{
+    std::lock_guard<std::mutex> lock(textureStagingMutex);
+    uint32 &b = textureStagingBuffers[std::this_thread::get_id()];
+    if (!b)
+        glGenBuffers(1, &b);
+    return b;
 }
 
 } } // namespace vts renderer
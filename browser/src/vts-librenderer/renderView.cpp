@@ -26,12 +26,20 @@
 
 #include <vts-browser/resources.hpp>
 #include <vts-browser/cameraDraws.hpp>
+#include <vts-browser/cameraOptions.hpp>
+#include <vts-browser/camera.hpp>
 #include <vts-browser/celestial.hpp>
 
 #include <optick.h>
 
+#include <future>
+
 #include "renderer.hpp"
 
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
 namespace vts { namespace renderer
 {
 
@@ -51,34 +59,187 @@ void enableClipDistance(bool enable)
 #endif
 }
 
-UboCache::UboCache() : current(0), last(0), prev(0)
+UboCache::UboCache()
+{}
+
+UboCache::~UboCache()
+{
+    for (Frame &f : pending)
+        if (f.fence)
+            glDeleteSync(f.fence);
+}
+
+UniformBuffer *UboCache::get(uint32 size)
 {
-    // initialize the buffer
-    data.reserve(1000);
-    data.resize(10);
+    if (available.empty())
+    {
+        Entry e;
+        e.ubo = std::make_unique<UniformBuffer>();
+        available.push_back(std::move(e));
+    }
+    current.used.push_back(std::move(available.back()));
+    available.pop_back();
+    Entry &e = current.used.back();
+    if (size > e.size)
+    {
+        // the buffer is reallocated to the exact size
+        memorySize += size - e.size;
+        e.size = size;
+    }
+    return e.ubo.get();
 }
 
-UniformBuffer *UboCache::get()
+bool UboCache::finished(Frame &f)
 {
-    if ((current + 1) % data.size() == prev)
+#ifdef __EMSCRIPTEN__
+    // no fences, assume that the frame is finished by now
+    (void)f;
+    return pending.size() > 3;
+#else
+    if (!f.fence)
+        return true;
+    GLenum r;
+    if (pending.size() > MaxFrames)
     {
-        // grow the buffer
-        data.insert(data.begin() + prev, nullptr);
-        prev++;
-        if (last > current)
-            last++;
+        // usually signaled long ago
+        r = glClientWaitSync(f.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+            1000000000);
     }
-    auto &c = data[current];
-    current = (current + 1) % data.size();
-    if (!c)
-        c = std::make_unique<UniformBuffer>();
-    return &*c;
+    else
+        r = glClientWaitSync(f.fence, 0, 0);
+    return r != GL_TIMEOUT_EXPIRED;
+#endif
 }
 
 void UboCache::frame()
 {
-    prev = last;
-    last = current;
+    const uint32 used = current.used.size();
+    if (used > 0)
+    {
+#ifndef __EMSCRIPTEN__
+        current.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+        pending.push_back(std::move(current));
+        current = Frame();
+    }
+
+    // return the buffers of the frames finished by the gpu
+    while (!pending.empty() && finished(pending.front()))
+    {
+        Frame &f = pending.front();
+        if (f.fence)
+            glDeleteSync(f.fence);
+        for (Entry &e : f.used)
+            available.push_back(std::move(e));
+        pending.pop_front();
+    }
+
+    // free the buffers above the decaying high-water mark
+    highWater = std::max(used, highWater - (highWater + 31) / 32);
+    while (available.size() > highWater)
+    {
+        memorySize -= available.back().size;
+        available.pop_back();
+    }
+}
+
+UboRing::UboRing() : fences{}
+{}
+
+UboRing::~UboRing()
+{
+    for (GLsync &f : fences)
+        if (f)
+            glDeleteSync(f);
+    if (ubo)
+        glDeleteBuffers(1, &ubo);
+}
+
+void UboRing::grow(uint32 required)
+{
+    if (!ubo)
+    {
+        GLint a = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &a);
+        alignment = std::max(a, 1);
+        glGenBuffers(1, &ubo);
+    }
+
+    // the old storage is orphaned and kept by the driver
+    //   until the draws that use it are finished
+    partSize = std::max(std::max(partSize * 2, required), 65536u);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, partSize * Frames,
+        nullptr, GL_STREAM_DRAW);
+    for (GLsync &f : fences)
+    {
+        if (f)
+            glDeleteSync(f);
+        f = 0;
+    }
+    offset = 0;
+    CHECK_GL("ubo ring grow");
+}
+
+void UboRing::use(uint32 bindIndex, const void *data, uint32 size)
+{
+    bind(bindIndex, upload(data, size), size);
+}
+
+uint32 UboRing::alignedSize(uint32 size)
+{
+    if (!ubo)
+        grow(size);
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+uint32 UboRing::upload(const void *data, uint32 size)
+{
+    const uint32 aligned = alignedSize(size);
+    if (offset + aligned > partSize)
+        grow(aligned);
+
+    const uint32 start = part * partSize + offset;
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+#ifdef __EMSCRIPTEN__
+    glBufferSubData(GL_UNIFORM_BUFFER, start, size, data);
+#else
+    // the fence of this partition was waited for in frame
+    void *ptr = glMapBufferRange(GL_UNIFORM_BUFFER, start, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT
+        | GL_MAP_UNSYNCHRONIZED_BIT);
+    assert(ptr);
+    memcpy(ptr, data, size);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+#endif
+    offset += aligned;
+    return start;
+}
+
+void UboRing::bind(uint32 bindIndex, uint32 offset, uint32 size)
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, bindIndex, ubo, offset, size);
+}
+
+void UboRing::frame()
+{
+    if (!ubo)
+        return;
+#ifndef __EMSCRIPTEN__
+    if (fences[part])
+        glDeleteSync(fences[part]);
+    fences[part] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+    part = (part + 1) % Frames;
+    offset = 0;
+    if (fences[part])
+    {
+        // usually signaled long ago
+        glClientWaitSync(fences[part], GL_SYNC_FLUSH_COMMANDS_BIT,
+            1000000000);
+        glDeleteSync(fences[part]);
+        fences[part] = 0;
+    }
 }
 
 RenderViewImpl::RenderViewImpl(
@@ -92,6 +253,22 @@ RenderViewImpl::RenderViewImpl(
     depthBuffer.shaderCopyDepth = context->shaderCopyDepth;
 }
 
+RenderViewImpl::~RenderViewImpl()
+{
+    for (ColorReadback &r : readbacksInFlight)
+    {
+        glDeleteSync(r.fence);
+        readbacksPbos.push_back(r.pbo);
+    }
+    if (!readbacksPbos.empty())
+        glDeleteBuffers(readbacksPbos.size(), readbacksPbos.data());
+    glDeleteFramebuffers(1, &backgroundFrameBufferId);
+    glDeleteTextures(1, &backgroundTexId);
+    glDeleteFramebuffers(1, &farFieldFrameBufferId);
+    glDeleteRenderbuffers(1, &farFieldDepthId);
+    glDeleteTextures(1, &farFieldTexId);
+}
+
 void RenderViewImpl::clearGlState()
 {
     glDisable(GL_CULL_FACE);
@@ -114,31 +291,45 @@ void RenderViewImpl::clearGlState()
 UniformBuffer *RenderViewImpl::useDisposableUbo(uint32 bindIndex,
     void *data, uint32 size)
 {
-    UniformBuffer *ubo = size > 256 ? uboCacheLarge.get() : uboCacheSmall.get();
+    UniformBuffer *ubo = size > 256 ? uboCacheLarge.get(size)
+                                    : uboCacheSmall.get(size);
     ubo->bind();
     ubo->load(data, size, GL_DYNAMIC_DRAW);
     ubo->bindToIndex(bindIndex);
     return ubo;
 }
 
-void RenderViewImpl::drawSurface(const DrawSurfaceTask &t, bool wireframeSlow)
+namespace
 {
-    Texture *tex = (Texture*)t.texColor.get();
-    Mesh *m = (Mesh*)t.mesh.get();
-    if (!m || !tex)
-        return;
 
-    struct UboSurface
-    {
-        mat4f p;
-        mat4f mv;
-        vec4f uvTrans; // scale-x, scale-y, offset-x, offset-y
-        vec4f uvClip;
-        vec4f color;
-        vec4si32 flags; // mask, monochromatic, flat shading, uv source, lodBlendingWithDithering, ..., blendingCoverage, frameIndex
-    } data;
+// must match VTS_INSTANCES in the surface shaders
+const uint32 SurfaceInstances = 64;
 
-    data.p = proj.cast<float>();
+struct UboSurfaceInstance
+{
+    mat4f mv;
+    vec4f uvTrans; // scale-x, scale-y, offset-x, offset-y
+    vec4f uvClip;
+    vec4f color;
+    vec4si32 flags; // mask, monochromatic, flat shading, uv source, lodBlendingWithDithering, color array, mask array; layers; blendingCoverage; frameIndex
+};
+
+struct UboSurface
+{
+    mat4f p;
+    UboSurfaceInstance s;
+};
+
+struct UboSurfaceInstanced
+{
+    mat4f p;
+    UboSurfaceInstance s[SurfaceInstances];
+};
+
+void fillSurface(UboSurfaceInstance &data, const DrawSurfaceTask &t,
+    bool lodBlendingWithDithering, bool flatShading, uint32 frameIndex)
+{
+    Texture *tex = (Texture*)t.texColor.get();
     data.mv = rawToMat4(t.mv);
     data.uvTrans = rawToVec4(t.uvTrans);
     data.uvClip = rawToVec4(t.uvClip);
@@ -149,7 +340,9 @@ void RenderViewImpl::drawSurface(const DrawSurfaceTask &t, bool wireframeSlow)
         flags |= 1 << 0;
     if (tex->getGrayscale())
         flags |= 1 << 1;
-    if (options.debugFlatShading)
+    if (tex->getAlphaMask())
+        flags |= 1 << 7;
+    if (flatShading)
         flags |= 1 << 2;
     if (t.externalUv)
         flags |= 1 << 3;
@@ -163,24 +356,225 @@ void RenderViewImpl::drawSurface(const DrawSurfaceTask &t, bool wireframeSlow)
         else
             data.color[3] *= t.blendingCoverage;
     }
+    Texture *mask = (Texture*)t.texMask.get();
+    if (tex->getArray())
+    {
+        flags |= 1 << 5;
+        data.flags[1] |= tex->getLayer();
+    }
+    if (mask && mask->getArray())
+    {
+        flags |= 1 << 6;
+        data.flags[1] |= mask->getLayer() << 16;
+    }
+}
 
-    useDisposableUbo(1, data)->setDebugId("UboSurface");
+uint32 textureId(const std::shared_ptr<void> &t)
+{
+    return t ? ((Texture*)t.get())->getId() : 0;
+}
 
-    if (t.texMask)
+// the draws may be rendered in one instanced call
+//   the layers of texture arrays are specified per instance
+bool sameBinds(const DrawSurfaceTask &a, const DrawSurfaceTask &b)
+{
+    return a.mesh == b.mesh
+        && a.indicesOffset == b.indicesOffset
+        && a.indicesCount == b.indicesCount
+        && textureId(a.texColor) == textureId(b.texColor)
+        && textureId(a.texMask) == textureId(b.texMask);
+}
+
+} // namespace
+
+void RenderViewImpl::useSurfaceUbo(const void *data, uint32 size)
+{
+#ifdef VTSR_UWP
+    // angle/directx does not like changing a buffer
+    useDisposableUbo(1, (void*)data, size)->setDebugId("UboSurface");
+#else
+    uboRingSurfaces.use(1, data, size);
+#endif
+}
+
+void RenderViewImpl::bindSurface(const DrawSurfaceTask &t)
+{
+    Texture *tex = (Texture*)t.texColor.get();
+    Texture *mask = (Texture*)t.texMask.get();
+    Mesh *m = (Mesh*)t.mesh.get();
+
+    // texture arrays are on separate units
+    //   consecutive tiles often share the same array
+    // consecutive draws often share the state
+    //   when the draws are sorted by state
+    if (mask)
+    {
+        if (!mask->getArray())
+        {
+            if (mask->getId() != boundMaskTexture)
+            {
+                glActiveTexture(GL_TEXTURE0 + 1);
+                mask->bind();
+                glActiveTexture(GL_TEXTURE0 + 0);
+                boundMaskTexture = mask->getId();
+            }
+        }
+        else if (mask->getId() != boundMaskArray)
+        {
+            glActiveTexture(GL_TEXTURE0 + 3);
+            mask->bind();
+            glActiveTexture(GL_TEXTURE0 + 0);
+            boundMaskArray = mask->getId();
+        }
+    }
+    if (!tex->getArray())
+    {
+        if (tex->getId() != boundColorTexture)
+        {
+            tex->bind();
+            boundColorTexture = tex->getId();
+        }
+    }
+    else if (tex->getId() != boundColorArray)
     {
-        glActiveTexture(GL_TEXTURE0 + 1);
-        ((Texture*)t.texMask.get())->bind();
+        glActiveTexture(GL_TEXTURE0 + 2);
+        tex->bind();
         glActiveTexture(GL_TEXTURE0 + 0);
+        boundColorArray = tex->getId();
     }
-    tex->bind();
 
-    m->bind();
+    if (m != boundMesh)
+    {
+        m->bind();
+        boundMesh = m;
+    }
+}
+
+void RenderViewImpl::drawSurface(const DrawSurfaceTask &t, bool wireframeSlow)
+{
+    Texture *tex = (Texture*)t.texColor.get();
+    Mesh *m = (Mesh*)t.mesh.get();
+    if (!m || !tex)
+        return;
+
+    UboSurface data;
+    data.p = projRender.cast<float>();
+    fillSurface(data.s, t, lodBlendingWithDithering,
+        options.debugFlatShading, frameIndex);
+    useSurfaceUbo(&data, sizeof(data));
+    bindSurface(t);
     if (wireframeSlow)
         m->dispatchWireframeSlow();
+    else if (t.indicesCount)
+        m->dispatch(t.indicesOffset, t.indicesCount);
     else
         m->dispatch();
 }
 
+void RenderViewImpl::drawSurfacesInstanced(
+    const std::vector<DrawSurfaceTask> &tasks)
+{
+    UboSurfaceInstanced data;
+    data.p = projRender.cast<float>();
+    for (std::size_t i = 0, e = tasks.size(); i < e;)
+    {
+        const DrawSurfaceTask &t = tasks[i];
+        if (!t.mesh || !t.texColor)
+        {
+            i++;
+            continue;
+        }
+        uint32 n = 0;
+        std::size_t j = i;
+        while (j < e && n < SurfaceInstances && sameBinds(t, tasks[j]))
+            fillSurface(data.s[n++], tasks[j++], lodBlendingWithDithering,
+                options.debugFlatShading, frameIndex);
+        // the whole block is bound, as declared in the shader
+        useSurfaceUbo(&data, sizeof(data));
+        bindSurface(t);
+        if (t.indicesCount)
+            ((Mesh*)t.mesh.get())->dispatchInstanced(n,
+                t.indicesOffset, t.indicesCount);
+        else
+            ((Mesh*)t.mesh.get())->dispatchInstanced(n);
+        i = j;
+    }
+}
+
+void RenderViewImpl::drawSurfacesRecorded(
+    const std::vector<DrawSurfaceTask> &tasks)
+{
+#ifdef VTSR_UWP
+    for (const DrawSurfaceTask &t : tasks)
+        drawSurface(t);
+#else
+    // record: the uniform blocks of all the draws are prepared up front
+    //   large passes are split between helper threads
+    //   and the whole pass is uploaded with single buffer map
+    // submit: only the bindings and the draw calls remain
+    const uint32 cnt = tasks.size();
+    if (cnt == 0)
+        return;
+    const uint32 stride = uboRingSurfaces.alignedSize(sizeof(UboSurface));
+    surfacesRecording.resize(cnt * stride);
+    const mat4f p = projRender.cast<float>();
+    const auto &record = [&](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; i++)
+        {
+            const DrawSurfaceTask &t = tasks[i];
+            if (!t.mesh || !t.texColor)
+                continue;
+            UboSurface &data = *(UboSurface *)(surfacesRecording.data()
+                + i * stride);
+            data.p = p;
+            fillSurface(data.s, t, lodBlendingWithDithering,
+                options.debugFlatShading, frameIndex);
+        }
+    };
+    // each helper thread must be worth its startup
+    static const uint32 MinDrawsPerThread = 2000;
+    const uint32 threads = std::min(options.recordingThreads,
+        cnt / MinDrawsPerThread);
+    if (threads == 0)
+        record(0, cnt);
+    else
+    {
+        const uint32 chunk = (cnt + threads) / (threads + 1);
+        std::vector<std::future<void>> futures;
+        futures.reserve(threads);
+        for (uint32 t = 1; t <= threads; t++)
+            futures.push_back(std::async(std::launch::async, record,
+                std::min(t * chunk, cnt), std::min((t + 1) * chunk, cnt)));
+        record(0, std::min(chunk, cnt));
+        for (auto &f : futures)
+            f.get();
+    }
+    const uint32 start = uboRingSurfaces.upload(surfacesRecording.data(),
+        surfacesRecording.size());
+
+    for (uint32 i = 0; i < cnt; i++)
+    {
+        const DrawSurfaceTask &t = tasks[i];
+        if (!t.mesh || !t.texColor)
+            continue;
+        uboRingSurfaces.bind(1, start + i * stride, sizeof(UboSurface));
+        bindSurface(t);
+        Mesh *m = (Mesh*)t.mesh.get();
+        if (t.indicesCount)
+            m->dispatch(t.indicesOffset, t.indicesCount);
+        else
+            m->dispatch();
+    }
+#endif
+}
+
+void RenderViewImpl::resetSurfaceBinds()
+{
+    boundColorTexture = boundMaskTexture = 0;
+    boundMesh = nullptr;
+}
+
 void RenderViewImpl::drawInfographics(const DrawInfographicsTask &t)
 {
     Mesh *m = (Mesh*)t.mesh.get();
@@ -191,18 +585,18 @@ void RenderViewImpl::drawInfographics(const DrawInfographicsTask &t)
     {
         mat4f mvp;
         vec4f color;
-        vec4f flags; // type, useTexture, useDepth
+        vec4f flags; // type, useTexture, useDepth, reversedDepth
         vec4f data;
         vec4f data2;
     } data;
 
-    data.mvp = proj.cast<float>() * rawToMat4(t.mv);
+    data.mvp = projRender.cast<float>() * rawToMat4(t.mv);
     data.color = rawToVec4(t.color);
     data.flags = vec4f(
         t.type,
         !!t.texColor,
         t.type ? 0 : 1,
-        0
+        reverseDepth ? 1 : 0
     );
     data.data = rawToVec4(t.data);
     data.data2 = rawToVec4(t.data2);
@@ -219,16 +613,48 @@ void RenderViewImpl::drawInfographics(const DrawInfographicsTask &t)
     m->dispatch();
 }
 
+void RenderViewImpl::updateResolutionScale()
+{
+    // the scale moves in coarse steps and only after several frames
+    //   so that the framebuffers and the lod selection stay stable
+    static const float Step = 1.f / 16;
+    static const uint32 Frames = 10;
+    float &scale = stats.resolutionScale;
+    if (options.dynamicResolutionBudget <= 0 || options.colorToTexture)
+        scale = 1;
+    else if (++resolutionFrames >= Frames && stats.gpuTimeTotal > 0)
+    {
+        resolutionFrames = 0;
+        // the cost is roughly proportional to the number of pixels
+        float desired = scale * std::sqrt(options.dynamicResolutionBudget
+                        / (float)stats.gpuTimeTotal);
+        float minScale = clamp(options.dynamicResolutionMinScale, Step, 1.f);
+        if (desired < scale)
+            scale = std::floor(desired / Step) * Step;
+        else if (desired > scale + Step)
+            scale += Step;
+        scale = clamp(scale, minScale, 1.f);
+    }
+    camera->setResolutionScale(scale);
+}
+
 void RenderViewImpl::updateFramebuffers()
 {
     OPTICK_EVENT();
 
-    if (options.width != width || options.height != height || options.antialiasingSamples != antialiasingSamplesPrev || options.colorRenderWithAlpha != colorRenderWithAlphaPrev)
+    const uint32 rw = std::max(uint32(options.width * stats.resolutionScale + 0.5f), 1u);
+    const uint32 rh = std::max(uint32(options.height * stats.resolutionScale + 0.5f), 1u);
+    if (options.width != width || options.height != height || rw != renderWidth || rh != renderHeight || options.antialiasingSamples != antialiasingSamplesPrev || options.colorRenderWithAlpha != colorRenderWithAlphaPrev || reverseDepth != reverseDepthPrev)
     {
         width = options.width;
         height = options.height;
+        renderWidth = rw;
+        renderHeight = rh;
         antialiasingSamplesPrev = std::max(std::min(options.antialiasingSamples, maxAntialiasingSamples), 1u);
         colorRenderWithAlphaPrev = options.colorRenderWithAlpha;
+        reverseDepthPrev = reverseDepth;
+        const GLenum depthInternalFormat = reverseDepth ? GL_DEPTH32F_STENCIL8 : GL_DEPTH24_STENCIL8;
+        const GLenum depthTransferType = reverseDepth ? GL_FLOAT_32_UNSIGNED_INT_24_8_REV : GL_UNSIGNED_INT_24_8;
 
         vars.textureTargetType = antialiasingSamplesPrev > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
 
@@ -258,11 +684,11 @@ void RenderViewImpl::updateFramebuffers()
         }
         if (antialiasingSamplesPrev > 1)
         {
-            glTexImage2DMultisample(vars.textureTargetType, antialiasingSamplesPrev, GL_DEPTH24_STENCIL8, options.width, options.height, GL_TRUE);
+            glTexImage2DMultisample(vars.textureTargetType, antialiasingSamplesPrev, depthInternalFormat, renderWidth, renderHeight, GL_TRUE);
         }
         else
         {
-            glTexImage2D(vars.textureTargetType, 0, GL_DEPTH24_STENCIL8, options.width, options.height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+            glTexImage2D(vars.textureTargetType, 0, depthInternalFormat, renderWidth, renderHeight, 0, GL_DEPTH_STENCIL, depthTransferType, nullptr);
             glTexParameteri(vars.textureTargetType, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             glTexParameteri(vars.textureTargetType, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         }
@@ -278,7 +704,7 @@ void RenderViewImpl::updateFramebuffers()
             {
                 glObjectLabel(GL_TEXTURE, vars.depthReadTexId, -1, "depthReadTexId");
             }
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, options.width, options.height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+            glTexImage2D(GL_TEXTURE_2D, 0, depthInternalFormat, renderWidth, renderHeight, 0, GL_DEPTH_STENCIL, depthTransferType, nullptr);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         }
@@ -301,11 +727,11 @@ void RenderViewImpl::updateFramebuffers()
         }
         if (antialiasingSamplesPrev > 1)
         {
-            glTexImage2DMultisample(vars.textureTargetType, antialiasingSamplesPrev, colorInternalFormat, options.width, options.height, GL_TRUE);
+            glTexImage2DMultisample(vars.textureTargetType, antialiasingSamplesPrev, colorInternalFormat, renderWidth, renderHeight, GL_TRUE);
         }
         else
         {
-            glTexImage2D(vars.textureTargetType, 0, colorInternalFormat, options.width, options.height, 0, colorTransferFormat, GL_UNSIGNED_BYTE, nullptr);
+            glTexImage2D(vars.textureTargetType, 0, colorInternalFormat, renderWidth, renderHeight, 0, colorTransferFormat, GL_UNSIGNED_BYTE, nullptr);
             glTexParameteri(vars.textureTargetType, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             glTexParameteri(vars.textureTargetType, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         }
@@ -321,7 +747,7 @@ void RenderViewImpl::updateFramebuffers()
             {
                 glObjectLabel(GL_TEXTURE, vars.colorReadTexId, -1, "colorReadTexId");
             }
-            glTexImage2D(GL_TEXTURE_2D, 0, colorInternalFormat, options.width, options.height, 0, colorTransferFormat, GL_UNSIGNED_BYTE, nullptr);
+            glTexImage2D(GL_TEXTURE_2D, 0, colorInternalFormat, renderWidth, renderHeight, 0, colorTransferFormat, GL_UNSIGNED_BYTE, nullptr);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         }
@@ -368,28 +794,53 @@ void RenderViewImpl::entryInitialize()
 
     uboCacheLarge.frame();
     uboCacheSmall.frame();
+    uboRingSurfaces.frame();
+    stats.uboMemoryKB = (uboCacheLarge.memory() + uboCacheSmall.memory()
+        + uboRingSurfaces.memory()) / 1024;
     clearGlState();
+    gpuTimers.frame(stats);
     frameIndex++;
+    if ((frameIndex % 60) == 0)
+        context->queryGpuMemory();
 
     if (options.width <= 0 || options.height <= 0)
     {
-        view = proj = mat4(scaleMatrix(0));
+        view = proj = projRender = mat4(scaleMatrix(0));
         return;
     }
 
     view = rawToMat4(draws->camera.view);
     proj = rawToMat4(draws->camera.proj);
 
+    // reversed depth remaps the clip space z from -w .. w to w .. 0
+    //   the cpu side keeps using the standard proj
+    reverseDepth = options.reverseDepth && clipControl;
+    projRender = proj;
+    if (reverseDepth)
+    {
+        mat4 r = identityMatrix4();
+        r(2, 2) = -0.5;
+        r(2, 3) = 0.5;
+        projRender = r * proj;
+        clipControl(ClipLowerLeft, ClipZeroToOne);
+    }
+
+    updateResolutionScale();
     updateFramebuffers();
 
     // initialize opengl
-    glViewport(0, 0, options.width, options.height);
-    glScissor(0, 0, options.width, options.height);
+    glViewport(0, 0, renderWidth, renderHeight);
+    glScissor(0, 0, renderWidth, renderHeight);
     glBindFramebuffer(GL_FRAMEBUFFER, vars.frameRenderBufferId);
     CHECK_GL_FRAMEBUFFER(GL_FRAMEBUFFER);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glEnable(GL_CULL_FACE);
     glClearColor(0, 0, 0, 0);
+#ifdef VTSR_OPENGLES
+    glClearDepthf(reverseDepth ? 0 : 1);
+#else
+    glClearDepth(reverseDepth ? 0 : 1);
+#endif
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
     CHECK_GL("initialized opengl state");
 
@@ -402,7 +853,7 @@ void RenderViewImpl::entryInitialize()
     viewProjInv = viewProj.inverse();
 
     // update atmosphere
-    updateAtmosphereBuffer();
+    updateAtmosphereBuffer(view);
 }
 
 void RenderViewImpl::entrySurfaces()
@@ -411,27 +862,59 @@ void RenderViewImpl::entrySurfaces()
         return;
     OPTICK_EVENT();
 
+    // the arrays may have been reallocated since previous frame
+    boundColorArray = boundMaskArray = 0;
+
+    // render far field impostor
+    if (camera->options().farFieldDistance <= 0)
+        farFieldValid = false;
+    else if (draws->farFieldRefresh)
+    {
+        OPTICK_EVENT("far_field");
+        renderFarField();
+        CHECK_GL("rendered far field");
+    }
+
     // render opaque
     if (!draws->opaque.empty())
     {
         OPTICK_EVENT("opaque");
+        gpuTimers.begin(GpuTimers::Opaque);
         glDisable(GL_BLEND);
         glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LEQUAL);
-        context->shaderSurface->bind();
+        glDepthFunc(reverseDepth ? GL_GEQUAL : GL_LEQUAL);
+        resetSurfaceBinds();
         enableClipDistance(true);
-        for (const DrawSurfaceTask &t : draws->opaque)
-            drawSurface(t);
+        if (context->options.instancedSurfaces)
+        {
+            context->shaderSurfaceInstanced->bind();
+            drawSurfacesInstanced(draws->opaque);
+        }
+        else
+        {
+            context->shaderSurface->bind();
+            drawSurfacesRecorded(draws->opaque);
+        }
         enableClipDistance(false);
+        gpuTimers.end();
         CHECK_GL("rendered opaque");
     }
 
+    // composite far field impostor
+    if (farFieldValid)
+    {
+        OPTICK_EVENT("far_field_composite");
+        compositeFarField();
+        CHECK_GL("composited far field");
+    }
+
     // render background (atmosphere)
     if (options.renderAtmosphere
         && !projected
         && atmosphereDensityTexture)
     {
         OPTICK_EVENT("background");
+        gpuTimers.begin(GpuTimers::Background);
         // corner directions
         vec3 camPos = rawToVec3(draws->camera.eye) / body->majorRadius;
         mat4 inv = (viewProj * scaleMatrix(body->majorRadius)).inverse();
@@ -446,11 +929,42 @@ void RenderViewImpl::entrySurfaces()
             cornerDirs[i] = normalize(vec3(vec4to3(cornerDirsD[i], true)
                 - camPos)).cast<float>();
 
+        const uint32 downscale = std::max(options.backgroundDownscale, 1u);
+        const uint32 bw = std::max(renderWidth / downscale, 1u);
+        const uint32 bh = std::max(renderHeight / downscale, 1u);
+        if (downscale > 1)
+        {
+            // the scattering is evaluated at the reduced resolution only
+            updateBackgroundFramebuffer(bw, bh);
+            glBindFramebuffer(GL_FRAMEBUFFER, backgroundFrameBufferId);
+            glViewport(0, 0, bw, bh);
+            glScissor(0, 0, bw, bh);
+            glDisable(GL_DEPTH_TEST);
+        }
+
         context->shaderBackground->bind();
         for (uint32 i = 0; i < 4; i++)
             context->shaderBackground->uniformVec3(i, cornerDirs[i].data());
+        context->shaderBackground->uniform(4, reverseDepth ? 0.f : 1.f);
         context->meshQuad->bind();
         context->meshQuad->dispatch();
+
+        if (downscale > 1)
+        {
+            // upsample into the pixels not covered by the surfaces
+            glBindFramebuffer(GL_FRAMEBUFFER, vars.frameRenderBufferId);
+            glViewport(0, 0, renderWidth, renderHeight);
+            glScissor(0, 0, renderWidth, renderHeight);
+            glEnable(GL_DEPTH_TEST);
+            glDepthMask(GL_FALSE);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, backgroundTexId);
+            context->shaderBackgroundUpsample->bind();
+            context->shaderBackgroundUpsample->uniform(0, reverseDepth ? 0.f : 1.f);
+            context->meshQuad->dispatch();
+            glDepthMask(GL_TRUE);
+        }
+        gpuTimers.end();
         CHECK_GL("rendered background");
     }
 
@@ -458,18 +972,20 @@ void RenderViewImpl::entrySurfaces()
     if (!draws->transparent.empty())
     {
         OPTICK_EVENT("transparent");
+        gpuTimers.begin(GpuTimers::Transparent);
         glEnable(GL_BLEND);
         glEnable(GL_POLYGON_OFFSET_FILL);
-        glPolygonOffset(0, -10);
+        glPolygonOffset(0, reverseDepth ? 10 : -10);
         glDepthMask(GL_FALSE);
         context->shaderSurface->bind();
+        resetSurfaceBinds();
         enableClipDistance(true);
-        for (const DrawSurfaceTask &t : draws->transparent)
-            drawSurface(t);
+        drawSurfacesRecorded(draws->transparent);
         enableClipDistance(false);
         glDepthMask(GL_TRUE);
         glDisable(GL_POLYGON_OFFSET_FILL);
         glPolygonOffset(0, 0);
+        gpuTimers.end();
         CHECK_GL("rendered transparent");
     }
 
@@ -477,15 +993,17 @@ void RenderViewImpl::entrySurfaces()
     if (options.debugWireframe)
     {
         OPTICK_EVENT("polygon_edges");
+        gpuTimers.begin(GpuTimers::Wireframe);
         glDisable(GL_BLEND);
 #ifndef __EMSCRIPTEN__
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        glPolygonOffset(0, -1000);
+        glPolygonOffset(0, reverseDepth ? 1000 : -1000);
 #ifndef VTSR_OPENGLES
         glEnable(GL_POLYGON_OFFSET_LINE);
 #endif
 #endif
         context->shaderSurface->bind();
+        resetSurfaceBinds();
         enableClipDistance(true);
         for (const DrawSurfaceTask &it : draws->opaque)
         {
@@ -506,10 +1024,12 @@ void RenderViewImpl::entrySurfaces()
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 #endif
         glEnable(GL_BLEND);
+        gpuTimers.end();
         CHECK_GL("rendered polygon edges");
     }
 
     // copy the depth (resolve multisampling)
+    gpuTimers.begin(GpuTimers::DepthCopy);
     if (vars.depthReadTexId != vars.depthRenderTexId)
     {
         OPTICK_EVENT("copy_depth_resolve_multisampling");
@@ -517,7 +1037,7 @@ void RenderViewImpl::entrySurfaces()
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, vars.frameReadBufferId);
         CHECK_GL_FRAMEBUFFER(GL_READ_FRAMEBUFFER);
         CHECK_GL_FRAMEBUFFER(GL_DRAW_FRAMEBUFFER);
-        glBlitFramebuffer(0, 0, options.width, options.height, 0, 0, options.width, options.height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
         glBindFramebuffer(GL_FRAMEBUFFER, vars.frameRenderBufferId);
         CHECK_GL("copied the depth (resolved multisampling)");
     }
@@ -526,19 +1046,41 @@ void RenderViewImpl::entrySurfaces()
     {
         OPTICK_EVENT("copy_depth_to_cpu");
         clearGlState();
+        const bool occlusion = camera->options().occlusionCulling;
+        bool converted = false;
         if ((frameIndex % 2) == 1)
         {
-            uint32 dw = width;
-            uint32 dh = height;
-            if (!options.debugDepthFeedback)
+            uint32 dw = renderWidth;
+            uint32 dh = renderHeight;
+            if (!options.debugDepthFeedback && !occlusion)
                 dw = dh = 0;
-            depthBuffer.performCopy(vars.depthReadTexId, dw, dh, viewProj);
+            depthBuffer.performCopy(vars.depthReadTexId, dw, dh,
+                reverseDepth, viewProj);
+            if (occlusion)
+                depthBuffer.occlusionFeedback(camera);
+            converted = dw * dh > 0;
+        }
+
+        // without the feedback, the labels test the depth on gpu
+        if (!options.debugDepthFeedback)
+        {
+            depthBuffer.performGpuCopy(vars.depthReadTexId,
+                renderWidth, renderHeight,
+                reverseDepth);
+            converted = true;
         }
-        glViewport(0, 0, options.width, options.height);
-        glScissor(0, 0, options.width, options.height);
+
+        // the picks read from the converted texture
+        depthBuffer.processPicks();
+        if (converted)
+            depthBuffer.performPicks(renderWidth, renderHeight,
+                stats.resolutionScale, viewProj);
+        glViewport(0, 0, renderWidth, renderHeight);
+        glScissor(0, 0, renderWidth, renderHeight);
         glBindFramebuffer(GL_FRAMEBUFFER, vars.frameRenderBufferId);
         glEnable(GL_BLEND);
         glEnable(GL_DEPTH_TEST);
+        gpuTimers.end();
         CHECK_GL("copy depth");
     }
 }
@@ -553,6 +1095,7 @@ void RenderViewImpl::entryGeodata()
     OPTICK_EVENT();
 
     // render geodata
+    gpuTimers.begin(GpuTimers::Geodata);
     renderGeodata();
     CHECK_GL("rendered geodata");
 
@@ -566,6 +1109,7 @@ void RenderViewImpl::entryGeodata()
             drawInfographics(t);
         CHECK_GL("rendered infographics");
     }
+    gpuTimers.end();
 }
 
 void RenderViewImpl::entryFinalize()
@@ -573,6 +1117,7 @@ void RenderViewImpl::entryFinalize()
     if (options.width <= 0 || options.height <= 0)
         return;
     OPTICK_EVENT();
+    gpuTimers.begin(GpuTimers::Finalize);
 
     // copy the color to output texture
     if (options.colorToTexture  && vars.colorReadTexId != vars.colorRenderTexId)
@@ -582,30 +1127,147 @@ void RenderViewImpl::entryFinalize()
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, vars.frameReadBufferId);
         CHECK_GL_FRAMEBUFFER(GL_READ_FRAMEBUFFER);
         CHECK_GL_FRAMEBUFFER(GL_DRAW_FRAMEBUFFER);
-        glBlitFramebuffer(0, 0, options.width, options.height, 0, 0, options.width, options.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
         glBindFramebuffer(GL_FRAMEBUFFER, vars.frameRenderBufferId);
         CHECK_GL("copied the color to texture");
     }
 
+    // read the color for the application
+    processReadbacks();
+    performReadbacks();
+
     // copy the color to target frame buffer
     if (options.colorToTargetFrameBuffer)
     {
         OPTICK_EVENT("colorToTargetFrameBuffer");
         uint32 w = options.targetViewportW ? options.targetViewportW : options.width;
         uint32 h = options.targetViewportH ? options.targetViewportH : options.height;
-        bool same = w == options.width && h == options.height;
+        bool same = w == renderWidth && h == renderHeight;
         glBindFramebuffer(GL_READ_FRAMEBUFFER, vars.frameRenderBufferId);
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, options.targetFrameBuffer);
         CHECK_GL_FRAMEBUFFER(GL_READ_FRAMEBUFFER);
         CHECK_GL_FRAMEBUFFER(GL_DRAW_FRAMEBUFFER);
-        glBlitFramebuffer(0, 0, options.width, options.height, options.targetViewportX, options.targetViewportY, options.targetViewportX + w, options.targetViewportY + h, GL_COLOR_BUFFER_BIT, same ? GL_NEAREST : GL_LINEAR);
+        glBlitFramebuffer(0, 0, renderWidth, renderHeight, options.targetViewportX, options.targetViewportY, options.targetViewportX + w, options.targetViewportY + h, GL_COLOR_BUFFER_BIT, same ? GL_NEAREST : GL_LINEAR);
         CHECK_GL("copied the color to target frame buffer");
     }
+    gpuTimers.end();
+
+    // restore the standard depth range for the application
+    if (reverseDepth)
+    {
+        clipControl(ClipLowerLeft, ClipNegativeOneToOne);
+#ifdef VTSR_OPENGLES
+        glClearDepthf(1);
+#else
+        glClearDepth(1);
+#endif
+        glDepthFunc(GL_LEQUAL);
+    }
 
     // clear the state
     clearGlState();
 }
 
+bool RenderViewImpl::needsRedraw() const
+{
+    if (!readbacksQueued.empty() || !readbacksInFlight.empty()
+        || depthBuffer.picksPending())
+        return true;
+    for (const GeodataJob &j : hysteresisJobs)
+        if (j.opacity < 1)
+            return true;
+    return false;
+}
+
+void RenderViewImpl::performReadbacks()
+{
+    if (readbacksQueued.empty())
+        return;
+
+    OPTICK_EVENT("read_color");
+    // the multisampled color must be resolved first
+    if (vars.frameReadBufferId != vars.frameRenderBufferId
+        && !options.colorToTexture)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, vars.frameRenderBufferId);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, vars.frameReadBufferId);
+        glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0,
+            renderWidth, renderHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, vars.frameReadBufferId);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    for (ColorReadback &r : readbacksQueued)
+    {
+        r.w = renderWidth;
+        r.h = renderHeight;
+        if (readbacksPbos.empty())
+        {
+            uint32 b = 0;
+            glGenBuffers(1, &b);
+            readbacksPbos.push_back(b);
+        }
+        r.pbo = readbacksPbos.back();
+        readbacksPbos.pop_back();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, r.w * r.h * 3,
+            nullptr, GL_STREAM_READ);
+        glReadPixels(0, 0, r.w, r.h, GL_RGB, GL_UNSIGNED_BYTE, 0);
+        r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        readbacksInFlight.push_back(std::move(r));
+    }
+    readbacksQueued.clear();
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, vars.frameRenderBufferId);
+    CHECK_GL("read the color");
+}
+
+void RenderViewImpl::processReadbacks()
+{
+    if (readbacksInFlight.empty())
+        return;
+
+    OPTICK_EVENT("process_color_readbacks");
+    std::vector<ColorReadback> finished;
+    for (auto it = readbacksInFlight.begin(); it != readbacksInFlight.end();)
+    {
+        GLenum r = glClientWaitSync(it->fence, 0, 0);
+        if (r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED)
+        {
+            finished.push_back(std::move(*it));
+            it = readbacksInFlight.erase(it);
+        }
+        else
+            it++;
+    }
+
+    // the callbacks may request more readbacks
+    for (ColorReadback &r : finished)
+    {
+        glDeleteSync(r.fence);
+        uint32 reqsiz = r.w * r.h * 3;
+        if (readbacksBuffer.size() < reqsiz)
+            readbacksBuffer.allocate(reqsiz);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+#ifdef __EMSCRIPTEN__
+        EM_ASM_(
+        {
+            Module.ctx.getBufferSubData(Module.ctx.PIXEL_PACK_BUFFER, 0, HEAPU8.subarray($0, $0 + $1));
+        }, readbacksBuffer.data(), reqsiz);
+#else
+        void *ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+            0, reqsiz, GL_MAP_READ_BIT);
+        assert(ptr);
+        memcpy(readbacksBuffer.data(), ptr, reqsiz);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+#endif
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readbacksPbos.push_back(r.pbo);
+        CHECK_GL("read the color (to cpu)");
+        r.callback((const unsigned char *)readbacksBuffer.data(), r.w, r.h);
+    }
+}
+
 ShaderAtm::AtmBlock::AtmBlock()
 {
 #if __GNUC__ > 8
@@ -619,7 +1281,223 @@ ShaderAtm::AtmBlock::AtmBlock()
 #endif
 }
 
-void RenderViewImpl::updateAtmosphereBuffer()
+void RenderViewImpl::updateBackgroundFramebuffer(uint32 w, uint32 h)
+{
+    if (w == backgroundWidth && h == backgroundHeight && backgroundTexId)
+        return;
+    backgroundWidth = w;
+    backgroundHeight = h;
+
+    glDeleteFramebuffers(1, &backgroundFrameBufferId);
+    glDeleteTextures(1, &backgroundTexId);
+
+    glActiveTexture(GL_TEXTURE0);
+    glGenTextures(1, &backgroundTexId);
+    glBindTexture(GL_TEXTURE_2D, backgroundTexId);
+    if (GLAD_GL_KHR_debug)
+    {
+        glObjectLabel(GL_TEXTURE, backgroundTexId, -1, "backgroundTexId");
+    }
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    CHECK_GL("update background texture");
+
+    glGenFramebuffers(1, &backgroundFrameBufferId);
+    glBindFramebuffer(GL_FRAMEBUFFER, backgroundFrameBufferId);
+    if (GLAD_GL_KHR_debug)
+    {
+        glObjectLabel(GL_FRAMEBUFFER, backgroundFrameBufferId, -1, "backgroundFrameBufferId");
+    }
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, backgroundTexId, 0);
+    CHECK_GL_FRAMEBUFFER(GL_FRAMEBUFFER);
+    CHECK_GL("update background frame buffer");
+}
+
+void RenderViewImpl::updateFarFieldFramebuffer(uint32 size)
+{
+    if (size == farFieldSize && farFieldTexId)
+        return;
+    farFieldSize = size;
+
+    glDeleteFramebuffers(1, &farFieldFrameBufferId);
+    glDeleteRenderbuffers(1, &farFieldDepthId);
+    glDeleteTextures(1, &farFieldTexId);
+
+    glActiveTexture(GL_TEXTURE0);
+    glGenTextures(1, &farFieldTexId);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, farFieldTexId);
+    if (GLAD_GL_KHR_debug)
+    {
+        glObjectLabel(GL_TEXTURE, farFieldTexId, -1, "farFieldTexId");
+    }
+    for (uint32 i = 0; i < 6; i++)
+    {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA8,
+            size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    CHECK_GL("update far field texture");
+
+    glGenRenderbuffers(1, &farFieldDepthId);
+    glBindRenderbuffer(GL_RENDERBUFFER, farFieldDepthId);
+    if (GLAD_GL_KHR_debug)
+    {
+        glObjectLabel(GL_RENDERBUFFER, farFieldDepthId, -1, "farFieldDepthId");
+    }
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, size, size);
+    CHECK_GL("update far field depth");
+
+    glGenFramebuffers(1, &farFieldFrameBufferId);
+    glBindFramebuffer(GL_FRAMEBUFFER, farFieldFrameBufferId);
+    if (GLAD_GL_KHR_debug)
+    {
+        glObjectLabel(GL_FRAMEBUFFER, farFieldFrameBufferId, -1, "farFieldFrameBufferId");
+    }
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, farFieldDepthId);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X, farFieldTexId, 0);
+    CHECK_GL_FRAMEBUFFER(GL_FRAMEBUFFER);
+    CHECK_GL("update far field frame buffer");
+}
+
+void RenderViewImpl::renderFarField()
+{
+    const uint32 size = std::max(options.farFieldResolution, 16u);
+    updateFarFieldFramebuffer(size);
+
+    // the faces share the eye of the current view
+    //   the near plane is pushed out to the far field distance
+    //   the far plane is recovered from the projection of the camera
+    const vec3 eye = rawToVec3(draws->camera.eye);
+    const double dist = camera->options().farFieldDistance;
+    double far_ = proj(2, 3) / (proj(2, 2) + 1);
+    if (!(far_ > dist))
+        far_ = dist * 1000;
+    mat4 faceProj = perspectiveMatrix(90, 1, dist * 0.5, far_);
+    if (reverseDepth)
+    {
+        mat4 r = identityMatrix4();
+        r(2, 2) = -0.5;
+        r(2, 3) = 0.5;
+        faceProj = r * faceProj;
+    }
+
+    // directions and ups of the faces in the order of the cube map
+    static const vec3 faces[6][2] = {
+        { vec3(+1, 0, 0), vec3(0, -1, 0) },
+        { vec3(-1, 0, 0), vec3(0, -1, 0) },
+        { vec3(0, +1, 0), vec3(0, 0, +1) },
+        { vec3(0, -1, 0), vec3(0, 0, -1) },
+        { vec3(0, 0, +1), vec3(0, -1, 0) },
+        { vec3(0, 0, -1), vec3(0, -1, 0) },
+    };
+
+    const mat4 projPrev = projRender;
+    projRender = faceProj;
+    glBindFramebuffer(GL_FRAMEBUFFER, farFieldFrameBufferId);
+    glViewport(0, 0, size, size);
+    glScissor(0, 0, size, size);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(reverseDepth ? GL_GEQUAL : GL_LEQUAL);
+    enableClipDistance(true);
+
+    std::vector<DrawSurfaceTask> tasks;
+    const auto &transform = [&](const std::vector<DrawSurfaceTask> &src,
+        const mat4 &rel)
+    {
+        tasks = src;
+        for (DrawSurfaceTask &t : tasks)
+        {
+            mat4 mv = rel * rawToMat4(t.mv).cast<double>();
+            matToRaw(mat4f(mv.cast<float>()), t.mv);
+        }
+    };
+
+    for (uint32 face = 0; face < 6; face++)
+    {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+            GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, farFieldTexId, 0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        const mat4 faceView = lookAt(eye, eye + faces[face][0],
+            faces[face][1]);
+        const mat4 rel = faceView * viewInv;
+        updateAtmosphereBuffer(faceView);
+
+        glDisable(GL_BLEND);
+        resetSurfaceBinds();
+        transform(draws->farFieldOpaque, rel);
+        if (context->options.instancedSurfaces)
+        {
+            context->shaderSurfaceInstanced->bind();
+            drawSurfacesInstanced(tasks);
+        }
+        else
+        {
+            context->shaderSurface->bind();
+            drawSurfacesRecorded(tasks);
+        }
+
+        glEnable(GL_BLEND);
+        glDepthMask(GL_FALSE);
+        context->shaderSurface->bind();
+        resetSurfaceBinds();
+        transform(draws->farFieldTransparent, rel);
+        drawSurfacesRecorded(tasks);
+        glDepthMask(GL_TRUE);
+    }
+
+    enableClipDistance(false);
+    glDisable(GL_BLEND);
+    projRender = projPrev;
+    updateAtmosphereBuffer(view);
+    resetSurfaceBinds();
+    glBindFramebuffer(GL_FRAMEBUFFER, vars.frameRenderBufferId);
+    glViewport(0, 0, renderWidth, renderHeight);
+    glScissor(0, 0, renderWidth, renderHeight);
+    farFieldValid = true;
+}
+
+void RenderViewImpl::compositeFarField()
+{
+    // corner directions in world space, the cube map is axis aligned
+    const vec3 eye = rawToVec3(draws->camera.eye);
+    vec3f cornerDirs[4];
+    {
+        const vec2 corners[4] = {
+            vec2(-1, -1), vec2(+1, -1), vec2(-1, +1), vec2(+1, +1)
+        };
+        for (uint32 i = 0; i < 4; i++)
+        {
+            vec4 c = viewProjInv * vec4(corners[i](0), corners[i](1), 0, 1);
+            cornerDirs[i] = normalize(vec3(vec4to3(c, true) - eye))
+                .cast<float>();
+        }
+    }
+
+    // the impostor is placed just in front of the far plane
+    //   the atmosphere background, rendered at the far plane, stays behind it
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(reverseDepth ? GL_GEQUAL : GL_LEQUAL);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, farFieldTexId);
+    context->shaderFarField->bind();
+    for (uint32 i = 0; i < 4; i++)
+        context->shaderFarField->uniformVec3(i, cornerDirs[i].data());
+    context->shaderFarField->uniform(4,
+        reverseDepth ? 1e-6f : 1.f - 1e-6f);
+    context->meshQuad->bind();
+    context->meshQuad->dispatch();
+}
+
+void RenderViewImpl::updateAtmosphereBuffer(const mat4 &view)
 {
     OPTICK_EVENT();
 
@@ -658,7 +1536,7 @@ void RenderViewImpl::updateAtmosphereBuffer()
         atmBlock.uniAtmCameraPosition = camPos.cast<float>();
 
         // view inv
-        mat4 vi = rawToMat4(draws->camera.view).inverse();
+        mat4 vi = view.inverse();
         atmBlock.uniAtmViewInv = vi.cast<float>();
 
         // colors
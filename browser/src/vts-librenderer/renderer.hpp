@@ -28,6 +28,11 @@
 #define RENDERER_HPP_deh4f6d4hj
 
 #include <unordered_map>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
 
 #include <vts-browser/log.hpp>
 #include <vts-browser/math.hpp>
@@ -50,6 +55,7 @@ namespace renderer
 
 class RenderContextImpl;
 class GeodataTile;
+class ShapedTextsCache;
 struct Text;
 
 // reading depth immediately requires implicit sync between cpu and gpu, which is wasteful
@@ -58,7 +64,24 @@ struct Text;
 class DepthBuffer
 {
 private:
+    // region readback for asynchronous picking
+    //   each request has its own pbo and a fence
+    //   the callback runs once the fence has signaled
+    struct Pick
+    {
+        mat4 conv;
+        RenderView::PickCallback callback;
+        uint32 x, y, w, h; // in converted depth pixels
+        uint32 screenW, screenH;
+        uint32 pbo = 0;
+        GLsync fence = 0;
+    };
+
     static const uint32 PboCount = 2;
+    std::vector<Pick> picksQueued;
+    std::vector<Pick> picksInFlight;
+    std::vector<uint32> picksPbos; // unused pbos
+    Buffer picksBuffer;
     Buffer buffer;
     mat4 conv[PboCount];
     uint32 w[PboCount], h[PboCount];
@@ -68,6 +91,9 @@ private:
     uint32 index;
 
     double valuePix(uint32 x, uint32 y);
+    void copyToTexture(uint32 sourceTexture, uint32 w, uint32 h,
+        bool reversed);
+    void finishPick(Pick &p);
 
 public:
     DepthBuffer();
@@ -75,7 +101,34 @@ public:
 
     const mat4 &getConv() const;
 
-    void performCopy(uint32 sourceTexture, uint32 w, uint32 h, const mat4 &storeConv);
+    // reversed depth is converted back to the standard range
+    //   therefore the stored values are always compatible with storeConv
+    void performCopy(uint32 sourceTexture, uint32 w, uint32 h,
+        bool reversed, const mat4 &storeConv);
+
+    // converts the depth without reading it back to cpu
+    //   the result is available in gpuTexture (packed float in rgba8)
+    void performGpuCopy(uint32 sourceTexture, uint32 w, uint32 h,
+        bool reversed);
+    uint32 gpuTexture() const;
+
+    // passes the depth read back to cpu to the camera for occlusion culling
+    void occlusionFeedback(Camera *camera);
+
+    // rect in screen pixels, origin in top-left corner
+    void pick(uint32 x, uint32 y, uint32 w, uint32 h,
+        RenderView::PickCallback &&callback);
+    // issues readbacks of the queued picks from the converted texture
+    //   conv is the view-projection used for the conversion
+    //   scale converts the screen pixels to the depth buffer pixels
+    void performPicks(uint32 screenW, uint32 screenH, float scale,
+        const mat4 &conv);
+    // invokes callbacks of the picks whose readback has finished
+    void processPicks();
+    bool picksPending() const
+    {
+        return !picksQueued.empty() || !picksInFlight.empty();
+    }
 
     // xy in -1..1
     // returns 0..1 in logarithmic depth
@@ -85,6 +138,43 @@ public:
     std::shared_ptr<Mesh> meshQuad;
 };
 
+// gpu time measurement of the render passes
+//   each frame uses its own set of timer queries
+//   the results are read only once available, without stalling the pipeline
+class GpuTimers
+{
+public:
+    enum Pass
+    {
+        Opaque,
+        Background,
+        Transparent,
+        Wireframe,
+        DepthCopy,
+        Geodata,
+        Finalize,
+        PassesCount
+    };
+
+    GpuTimers();
+    ~GpuTimers();
+
+    // reads available results and advances to next frame
+    void frame(RenderStatistics &stats);
+
+    // the passes may not be nested
+    void begin(Pass pass);
+    void end();
+
+private:
+    static const uint32 FramesCount = 2;
+    uint32 queries[FramesCount][PassesCount];
+    bool issued[FramesCount][PassesCount];
+    uint32 index = 0;
+    int active = -1;
+    bool available = false;
+};
+
 class ShaderAtm : public Shader
 {
 public:
@@ -122,18 +212,102 @@ struct GeodataJob
     vec3f worldUp() const;
 };
 
+// jobs of a single geodata tile kept across frames
+struct GeodataTileJobs
+{
+    std::shared_ptr<GeodataTile> g;
+    std::vector<GeodataJob> jobs;
+    mat4 viewProj; // view used for the screen-space data
+    vec3 eye; // camera position at the last full rebuild
+    vec3 forward;
+    float textScale = 0;
+    uint32 width = 0;
+    uint32 height = 0;
+    uint32 rebuildFrame = 0;
+    uint32 usedFrame = 0;
+};
+
 extern uint32 maxAntialiasingSamples;
 extern float maxAnisotropySamples;
+extern std::vector<uint32> compressedTextureFormats;
+
+// glClipControl, null if not available
+typedef void (APIENTRY *ClipControlProc)(GLenum origin, GLenum depth);
+extern ClipControlProc clipControl;
+const GLenum ClipLowerLeft = 0x8CA1;
+const GLenum ClipNegativeOneToOne = 0x935E;
+const GLenum ClipZeroToOne = 0x935F;
+
+extern std::vector<uint32> programBinaryFormats; // empty if not available
+extern bool parallelShaderCompile;
 
 void enableClipDistance(bool enable);
 
-struct UboCache
+// pool of uniform buffers, each written once per draw
+//   the buffers used in a frame are returned to the pool
+//   once a fence signals that the gpu has finished the frame
+// the pool is trimmed to a decaying high-water mark of the usage
+class UboCache : private Immovable
 {
-    std::vector<std::unique_ptr<UniformBuffer>> data;
-    uint32 current, last, prev;
+public:
     UboCache();
-    UniformBuffer *get();
+    ~UboCache();
+    UniformBuffer *get(uint32 size);
+    void frame();
+    uint32 memory() const { return memorySize; } // bytes
+
+private:
+    struct Entry
+    {
+        std::unique_ptr<UniformBuffer> ubo;
+        uint32 size = 0;
+    };
+
+    struct Frame
+    {
+        std::vector<Entry> used;
+        GLsync fence = 0;
+    };
+
+    static const uint32 MaxFrames = 6; // in flight
+    std::vector<Entry> available;
+    std::deque<Frame> pending; // oldest first
+    Frame current;
+    uint32 highWater = 0; // buffers used per frame
+    uint32 memorySize = 0;
+
+    bool finished(Frame &f);
+};
+
+// single uniform buffer suballocated for per-draw data
+//   the buffer is split into partitions, one per frame in flight,
+//   and each partition is guarded by a fence before it is written again
+// the writes use unsynchronized mapping (glBufferSubData on webgl)
+class UboRing : private Immovable
+{
+public:
+    UboRing();
+    ~UboRing();
+    // copies the data and binds the range to the index
+    void use(uint32 bindIndex, const void *data, uint32 size);
+    // blocks of the size placed one after another keep the offset alignment
+    uint32 alignedSize(uint32 size);
+    // copies the data at once, returns its offset for bind
+    uint32 upload(const void *data, uint32 size);
+    void bind(uint32 bindIndex, uint32 offset, uint32 size);
     void frame();
+    uint32 memory() const { return partSize * Frames; } // bytes
+
+private:
+    static const uint32 Frames = 3;
+    GLsync fences[Frames];
+    uint32 ubo = 0;
+    uint32 partSize = 0;
+    uint32 alignment = 0;
+    uint32 part = 0;
+    uint32 offset = 0; // within the current partition
+
+    void grow(uint32 required);
 };
 
 class RenderViewImpl
@@ -145,11 +319,20 @@ public:
 
     RenderVariables vars;
     RenderOptions options;
+    RenderStatistics stats;
     DepthBuffer depthBuffer;
+    GpuTimers gpuTimers;
     UboCache uboCacheSmall;
     UboCache uboCacheLarge;
+    UboRing uboRingSurfaces;
     std::vector<GeodataJob> geodataJobs;
-    std::unordered_map<std::string, GeodataJob> hysteresisJobs;
+    std::vector<GeodataJob> hysteresisJobs; // ordered by hysteresis ids
+    std::vector<GeodataJob> geodataJobsTmp, hysteresisJobsTmp; // swapped each frame
+    std::vector<std::pair<uint64, uint32>> hysteresisOrder;
+    std::unordered_map<const GeodataTile *, GeodataTileJobs> tilesJobs;
+    std::vector<unsigned char> surfacesRecording; // uniform blocks of one pass
+    std::vector<std::vector<uint32>> collisionGrid;
+    std::vector<uint32> collisionStamps;
     CameraDraws *draws = nullptr;
     const MapCelestialBody *body = nullptr;
     Texture *atmosphereDensityTexture = nullptr;
@@ -160,19 +343,40 @@ public:
     mat4 projInv;
     mat4 viewProj;
     mat4 viewProjInv;
+    mat4 projRender; // proj with the depth range of the framebuffer
     mat4 davidProj;
     mat4 davidProjInv;
     vec3 zBufferOffsetValues;
     double elapsedTime = 0;
-    uint32 width = 0;
+    uint32 width = 0; // output resolution
     uint32 height = 0;
+    uint32 renderWidth = 0; // framebuffers resolution
+    uint32 renderHeight = 0;
+    uint32 resolutionFrames = 0;
+    uint32 backgroundWidth = 0; // reduced resolution background
+    uint32 backgroundHeight = 0;
+    uint32 backgroundTexId = 0;
+    uint32 backgroundFrameBufferId = 0;
+    uint32 farFieldSize = 0; // cube map impostor of the far surfaces
+    uint32 farFieldTexId = 0;
+    uint32 farFieldDepthId = 0;
+    uint32 farFieldFrameBufferId = 0;
     uint32 antialiasingSamplesPrev = 0;
     uint32 frameIndex = 0;
+    uint32 boundColorArray = 0;
+    uint32 boundMaskArray = 0;
+    uint32 boundColorTexture = 0;
+    uint32 boundMaskTexture = 0;
+    Mesh *boundMesh = nullptr;
     bool projected = false;
     bool lodBlendingWithDithering = false;
     bool colorRenderWithAlphaPrev = false;
+    bool reverseDepth = false;
+    bool reverseDepthPrev = false;
+    bool farFieldValid = false;
 
     RenderViewImpl(Camera *camera, RenderView *api, RenderContextImpl *context);
+    ~RenderViewImpl();
 
     void clearGlState();
 
@@ -181,10 +385,20 @@ public:
     UniformBuffer *useDisposableUbo(uint32 bindIndex, const T &value)
     { return useDisposableUbo(bindIndex, (void*)&value, sizeof(value)); }
 
+    void useSurfaceUbo(const void *data, uint32 size);
+    void bindSurface(const DrawSurfaceTask &t);
     void drawSurface(const DrawSurfaceTask &t, bool wireframeSlow = false);
+    void drawSurfacesInstanced(const std::vector<DrawSurfaceTask> &tasks);
+    void drawSurfacesRecorded(const std::vector<DrawSurfaceTask> &tasks);
+    void resetSurfaceBinds();
     void drawInfographics(const DrawInfographicsTask &t);
+    void updateResolutionScale();
     void updateFramebuffers();
-    void updateAtmosphereBuffer();
+    void updateBackgroundFramebuffer(uint32 w, uint32 h);
+    void updateFarFieldFramebuffer(uint32 size);
+    void updateAtmosphereBuffer(const mat4 &view);
+    void renderFarField();
+    void compositeFarField();
     void getWorldPosition(const double screenPos[2], double worldPos[3]);
     void renderCompass(const double screenPosSize[3], const double mapRotation[3]);
 
@@ -192,10 +406,27 @@ public:
     void entrySurfaces();
     void entryGeodata();
     void entryFinalize();
+    bool needsRedraw() const;
+
+    // color readbacks, each with its own pbo and a fence
+    struct ColorReadback
+    {
+        RenderView::ColorCallback callback;
+        uint32 w = 0, h = 0;
+        uint32 pbo = 0;
+        GLsync fence = 0;
+    };
+    std::vector<ColorReadback> readbacksQueued;
+    std::vector<ColorReadback> readbacksInFlight;
+    std::vector<uint32> readbacksPbos; // unused pbos
+    Buffer readbacksBuffer;
+    void performReadbacks();
+    void processReadbacks();
 
     bool collides(const GeodataJob &a, const GeodataJob &b);
     bool geodataTestVisibility(const float visibility[4], const vec3 &pos, const vec3f &up);
     bool geodataDepthVisibility(const vec3 &pos, float threshold);
+    vec4f geodataDepthTestPoint(const GeodataJob &job) const;
     mat4 depthOffsetCorrection(const std::shared_ptr<GeodataTile> &g) const;
     void renderGeodataQuad(const GeodataJob &job, const Rect &rect, const vec4f &color);
     void bindUboView(const std::shared_ptr<GeodataTile> &gg);
@@ -209,6 +440,8 @@ public:
     bool regenerateJobLabelFlat(GeodataJob &j);
     void regenerateJobLabelScreen(GeodataJob &j);
     bool regenerateJob(GeodataJob &j);
+    void generateTileJobs(GeodataTileJobs &c,
+        const std::shared_ptr<GeodataTile> &g);
     void generateJobs();
     void sortJobsByZIndexAndImportance();
     void renderJobsDebugRects();
@@ -220,11 +453,157 @@ public:
     void renderStick(const GeodataJob &job);
     void renderPointOrLine(const GeodataJob &job);
     void renderIcon(const GeodataJob &job);
+    uint32 renderIconsInstanced(uint32 first);
     void renderLabelFlat(const GeodataJob &job);
     void renderLabelScreen(const GeodataJob &job);
+    uint32 renderTrianglesMerged(uint32 first);
     void renderJobs();
 };
 
+namespace privat
+{
+
+// one texture array with layers shared by multiple tile textures
+class TextureArrayPage : private Immovable
+{
+public:
+    TextureArrayPage(uint32 layers);
+    ~TextureArrayPage();
+    bool acquire(uint32 &layer);
+    void release(uint32 layer);
+
+    uint32 id = 0;
+    uint32 levels = 0;
+
+private:
+    std::mutex mut;
+    std::vector<uint32> freeLayers;
+};
+
+// one gpu buffer with ranges shared by multiple tile meshes
+// fenced: the ranges are uploaded from other contexts
+//   (see RenderOptions::fenceUploads)
+//   and a released range is reused only after the gpu has finished
+//   the commands issued before its release
+class MeshSlab : private Immovable
+{
+public:
+    static const uint32 Alignment = 16;
+    static uint32 aligned(uint32 size);
+
+    MeshSlab(uint32 target, uint32 capacity, bool fenced = false);
+    ~MeshSlab();
+    bool acquire(uint32 size, uint32 &offset);
+    void release(uint32 offset, uint32 size);
+    uint32 usedEnd(); // offset past the last acquired range
+
+    const uint32 target;
+    const uint32 capacity;
+    const bool fenced;
+    uint32 id = 0;
+
+private:
+    struct Parked
+    {
+        uint32 offset;
+        uint32 size;
+        void *fence;
+    };
+
+    void insertFree(uint32 offset, uint32 size);
+    void reclaimParked();
+
+    std::mutex mut;
+    std::map<uint32, uint32> freeRanges; // offset -> size
+    std::vector<Parked> parked; // released ranges waiting for their fences
+};
+
+// triangle geodata of one style merged from multiple tiles
+//   each vertex is xyz and index of the slot of its tile
+//   the slots hold the per tile matrices, provided when rendering
+class GeodataPage : private Immovable
+{
+public:
+    static const uint32 Slots = 128; // must match VTS_SLOTS in the shader
+    static const uint32 Capacity = 2 * 1024 * 1024;
+    static const uint32 VertexSize = sizeof(float) * 4;
+
+    GeodataPage();
+    bool acquire(uint32 size, uint32 &offset, uint32 &slot);
+    void release(uint32 offset, uint32 size, uint32 slot);
+    void bind();
+    void dispatch();
+
+    MeshSlab slab;
+    std::unique_ptr<UniformBuffer> uniform; // style of the triangles
+
+private:
+    std::mutex mut;
+    std::vector<uint32> freeSlots;
+};
+
+} // namespace privat
+
+// texture arrays grouped by format and resolution of the layers
+class TextureArrayPool
+{
+public:
+    struct Key
+    {
+        uint32 internalFormat = 0;
+        uint32 width = 0, height = 0, levels = 0;
+        uint32 filterMode = 0;
+        uint32 wrapMode = 0;
+        bool operator < (const Key &other) const;
+    };
+
+    std::shared_ptr<privat::TextureArrayPage> acquire(const Key &key,
+        uint32 &layer);
+
+private:
+    std::mutex mut;
+    std::map<Key, std::vector<std::weak_ptr<privat::TextureArrayPage>>> pages;
+};
+
+// geodata pages grouped by the style
+class GeodataPagePool
+{
+public:
+    struct Key
+    {
+        float color[4] = {};
+        float visibilities[4] = {}; // compared bitwise, may be nan
+        sint32 style = 0;
+        bool stencil = false;
+        bool operator < (const Key &other) const;
+    };
+
+    // returns null if the data are too large for a page
+    std::shared_ptr<privat::GeodataPage> acquire(const Key &key,
+        uint32 size, uint32 &offset, uint32 &slot);
+
+private:
+    std::mutex mut;
+    std::map<Key, std::vector<std::weak_ptr<privat::GeodataPage>>> pages;
+};
+
+// mesh slabs for one buffer target
+//   a slab is deleted once all its meshes are deleted
+class MeshSlabPool
+{
+public:
+    explicit MeshSlabPool(uint32 target);
+
+    // returns null if the data are too large for a slab
+    std::shared_ptr<privat::MeshSlab> acquire(uint32 size, uint32 &offset,
+        bool fenced);
+
+private:
+    std::mutex mut;
+    std::vector<std::weak_ptr<privat::MeshSlab>> slabs;
+    const uint32 target;
+};
+
 class RenderContextImpl
 {
 public:
@@ -235,7 +614,10 @@ public:
     std::shared_ptr<Texture> texCompas;
     std::shared_ptr<Texture> texBlueNoise; // uses texture array!
     std::shared_ptr<ShaderAtm> shaderSurface;
+    std::shared_ptr<ShaderAtm> shaderSurfaceInstanced;
     std::shared_ptr<ShaderAtm> shaderBackground;
+    std::shared_ptr<Shader> shaderBackgroundUpsample;
+    std::shared_ptr<Shader> shaderFarField;
     std::shared_ptr<Shader> shaderInfographics;
     std::shared_ptr<Shader> shaderTexture;
     std::shared_ptr<Shader> shaderCopyDepth;
@@ -245,17 +627,45 @@ public:
     std::shared_ptr<Shader> shaderGeodataLineFlat;
     std::shared_ptr<Shader> shaderGeodataLineScreen;
     std::shared_ptr<Shader> shaderGeodataIconScreen;
+    std::shared_ptr<Shader> shaderGeodataIconScreenInstanced;
     std::shared_ptr<Shader> shaderGeodataLabelFlat;
     std::shared_ptr<Shader> shaderGeodataLabelScreen;
     std::shared_ptr<Shader> shaderGeodataTriangle;
+    std::shared_ptr<Shader> shaderGeodataTriangleMerged;
     std::shared_ptr<Mesh> meshQuad; // positions: -1 .. 1
     std::shared_ptr<Mesh> meshRect; // positions: 0 .. 1
     std::shared_ptr<Mesh> meshLine;
     std::shared_ptr<Mesh> meshEmpty;
-    uint32 globalVao = 0;
+    TextureArrayPool textureArrays;
+    MeshSlabPool meshVertexSlabs;
+    MeshSlabPool meshIndexSlabs;
+    GeodataPagePool geodataPages;
+    // one staging buffer per uploading thread
+    std::mutex textureStagingMutex;
+    std::unordered_map<std::thread::id, uint32> textureStagingBuffers;
+    std::unique_ptr<ShapedTextsCache> shapedTexts;
+    uint32 globalVao = 0; // vertex arrays are never shared between gl contexts
+
+    // the context whose resources are shared, empty for the root context
+    std::shared_ptr<RenderContext> sharedWith;
+    RenderContextImpl *const loader = this; // the root context
+
+    // driver reported video memory, in KB, 0 = unknown
+    //   read by the map in its render update
+    std::atomic<uint32> gpuMemoryCapacityKB;
+    std::atomic<uint32> gpuMemoryAvailableKB;
+    bool gpuMemoryNvx = false;
+    bool gpuMemoryAti = false;
 
     RenderContextImpl(RenderContext *api);
+    RenderContextImpl(RenderContext *api,
+        const std::shared_ptr<RenderContext> &sharedWith,
+        RenderContextImpl *loader);
     ~RenderContextImpl();
+    uint32 textureStagingBuffer(); // for the calling thread
+
+    void detectGpuMemory();
+    void queryGpuMemory();
 };
 
 } // namespace renderer
@@ -28,6 +28,7 @@
 #include "../vts-libbrowser/mapApiC.hpp"
 
 #include "include/vts-renderer/renderer.hpp"
+#include "include/vts-renderer/classes.hpp"
 
 #ifdef __cplusplus
 extern "C" {
@@ -54,6 +55,13 @@ void vtsLoadGlFunctions(GLADloadproc functionLoader)
     C_END
 }
 
+void vtsSetShaderBinaryCachePath(const char *path)
+{
+    C_BEGIN
+    vts::renderer::Shader::binaryCachePath = path ? path : "";
+    C_END
+}
+
 typedef struct vtsCRenderContext
 {
     std::shared_ptr<vts::renderer::RenderContext> p;
@@ -74,6 +82,16 @@ vtsHRenderContext vtsRenderContextCreate()
     return nullptr;
 }
 
+vtsHRenderContext vtsRenderContextCreateShared(vtsHRenderContext shareWith)
+{
+    C_BEGIN
+    vtsHRenderContext r = new vtsCRenderContext();
+    r->p = std::make_shared<vts::renderer::RenderContext>(shareWith->p);
+    return r;
+    C_END
+    return nullptr;
+}
+
 void vtsRenderContextDestroy(vtsHRenderContext context)
 {
     C_BEGIN
@@ -132,6 +150,14 @@ void vtsRenderViewRender(vtsHRenderView view)
     C_END
 }
 
+bool vtsRenderViewNeedsRedraw(vtsHRenderView view)
+{
+    C_BEGIN
+    return view->p->needsRedraw();
+    C_END
+    return false;
+}
+
 void vtsRenderViewRenderCompas(vtsHRenderView view,
     const double screenPosSize[3], const double mapRotation[3])
 {
@@ -148,6 +174,18 @@ void vtsRenderViewGetWorldPosition(vtsHRenderView view,
     C_END
 }
 
+void vtsRenderViewPickWorldPositions(vtsHRenderView view,
+    uint32 screenX, uint32 screenY, uint32 width, uint32 height,
+    vtsRenderPickCallbackType callback, void *userData)
+{
+    C_BEGIN
+    view->p->pickWorldPositions(screenX, screenY, width, height,
+        [=](const double *worldPositions, uint32 w, uint32 h) {
+            callback(worldPositions, w, h, userData);
+        });
+    C_END
+}
+
 #ifdef __cplusplus
 } // extern C
 #endif
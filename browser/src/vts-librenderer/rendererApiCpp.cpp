@@ -33,6 +33,7 @@
 #include <optick.h>
 
 #include "renderer.hpp"
+#include "geodata.hpp"
 #include "include/vts-renderer/renderDraws.hpp"
 
 namespace vts { namespace renderer
@@ -44,6 +45,7 @@ ContextOptions::ContextOptions()
 #ifndef __EMSCRIPTEN__
     callGlFinishAfterUploadingData = true;
 #endif // !__EMSCRIPTEN__
+    shapedTextsCacheSize = 10000;
 }
 
 ContextOptions::ContextOptions(const std::string &json)
@@ -57,6 +59,13 @@ void ContextOptions::applyJson(const std::string &json)
     Json::Value v = stringToJson(json);
     AJ(callGlFinishAfterUploadingData, asBool);
     AJ(enforceUsingMipMaps, asBool);
+    AJ(textureArrays, asBool);
+    AJ(stagedTextureUploads, asBool);
+    AJ(fenceUploads, asBool);
+    AJ(meshSlabs, asBool);
+    AJ(instancedSurfaces, asBool);
+    AJ(geodataMerging, asBool);
+    AJ(shapedTextsCacheSize, asUInt);
 }
 
 std::string ContextOptions::toJson() const
@@ -64,6 +73,13 @@ std::string ContextOptions::toJson() const
     Json::Value v;
     TJ(callGlFinishAfterUploadingData, asBool);
     TJ(enforceUsingMipMaps, asBool);
+    TJ(textureArrays, asBool);
+    TJ(stagedTextureUploads, asBool);
+    TJ(fenceUploads, asBool);
+    TJ(meshSlabs, asBool);
+    TJ(instancedSurfaces, asBool);
+    TJ(geodataMerging, asBool);
+    TJ(shapedTextsCacheSize, asUInt);
     return jsonToString(v);
 }
 
@@ -78,6 +94,11 @@ RenderOptions::RenderOptions()
 #endif // !VTSR_EMBEDDED
     renderAtmosphere = true;
     geodataHysteresis = true;
+    geodataJobsReuse = 0.01;
+    dynamicResolutionMinScale = 0.5;
+    backgroundDownscale = 1;
+    farFieldResolution = 512;
+    recordingThreads = 0;
     debugDepthFeedback = true;
     colorToTargetFrameBuffer = true;
 }
@@ -96,10 +117,17 @@ void RenderOptions::applyJson(const std::string &json)
     AJ(debugGeodataMode, asUInt);
     AJ(renderAtmosphere, asBool);
     AJ(geodataHysteresis, asBool);
+    AJ(geodataJobsReuse, asFloat);
+    AJ(dynamicResolutionBudget, asFloat);
+    AJ(dynamicResolutionMinScale, asFloat);
+    AJ(backgroundDownscale, asUInt);
+    AJ(farFieldResolution, asUInt);
+    AJ(recordingThreads, asUInt);
     AJ(colorRenderWithAlpha, asBool);
     AJ(debugFlatShading, asBool);
     AJ(debugWireframe, asBool);
     AJ(debugDepthFeedback, asBool);
+    AJ(reverseDepth, asBool);
 }
 
 std::string RenderOptions::toJson() const
@@ -110,13 +138,33 @@ std::string RenderOptions::toJson() const
     TJ(debugGeodataMode, asUInt);
     TJ(renderAtmosphere, asBool);
     TJ(geodataHysteresis, asBool);
+    TJ(geodataJobsReuse, asFloat);
+    TJ(dynamicResolutionBudget, asFloat);
+    TJ(dynamicResolutionMinScale, asFloat);
+    TJ(backgroundDownscale, asUInt);
+    TJ(farFieldResolution, asUInt);
+    TJ(recordingThreads, asUInt);
     TJ(colorRenderWithAlpha, asBool);
     TJ(debugFlatShading, asBool);
     TJ(debugWireframe, asBool);
     TJ(debugDepthFeedback, asBool);
+    TJ(reverseDepth, asBool);
     return jsonToString(v);
 }
 
+ContextStatistics::ContextStatistics()
+    : shapedTextsCacheHits(0), shapedTextsCacheMisses(0),
+    shapedTextsCacheEntries(0),
+    gpuMemoryCapacityKB(0), gpuMemoryAvailableKB(0)
+{}
+
+RenderStatistics::RenderStatistics()
+    : gpuTimeOpaque(0), gpuTimeBackground(0), gpuTimeTransparent(0),
+    gpuTimeWireframe(0), gpuTimeDepthCopy(0), gpuTimeGeodata(0),
+    gpuTimeFinalize(0), gpuTimeTotal(0), resolutionScale(1),
+    uboMemoryKB(0), geodataJobs(0), geodataHysteresisJobs(0)
+{}
+
 RenderVariables::RenderVariables()
 {
     memset(this, 0, sizeof(*this));
@@ -127,6 +175,16 @@ RenderContext::RenderContext()
     impl = std::make_shared<RenderContextImpl>(this);
 }
 
+RenderContext::RenderContext(const std::shared_ptr<RenderContext> &shareWith)
+{
+    assert(shareWith);
+    // share groups have a single root
+    std::shared_ptr<RenderContext> root = shareWith->impl->sharedWith;
+    if (!root)
+        root = shareWith;
+    impl = std::make_shared<RenderContextImpl>(this, root, root->impl.get());
+}
+
 RenderContext::~RenderContext()
 {}
 
@@ -135,9 +193,20 @@ ContextOptions &RenderContext::options()
     return impl->options;
 }
 
+ContextStatistics RenderContext::statistics() const
+{
+    ContextStatistics s;
+    impl->loader->shapedTexts->statistics(s);
+    s.gpuMemoryCapacityKB = impl->gpuMemoryCapacityKB;
+    s.gpuMemoryAvailableKB = impl->gpuMemoryAvailableKB;
+    return s;
+}
+
 void RenderContext::bindLoadFunctions(Map *map)
 {
     assert(map);
+    if (impl->sharedWith)
+        return impl->sharedWith->bindLoadFunctions(map);
     map->callbacks().loadTexture = std::bind(&RenderContext::loadTexture, this,
         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
     map->callbacks().loadMesh = std::bind(&RenderContext::loadMesh, this,
@@ -146,6 +215,10 @@ void RenderContext::bindLoadFunctions(Map *map)
         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
     map->callbacks().loadGeodata = std::bind(&RenderContext::loadGeodata, this,
         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+    RenderContextImpl *i = impl.get();
+    map->callbacks().gpuMemoryCapacity = [i]() -> uint32 {
+        return i->gpuMemoryCapacityKB;
+    };
 }
 
 std::shared_ptr<RenderView> RenderContext::createView(Camera *cam)
@@ -171,6 +244,10 @@ void RenderDraws::swap(Camera *cam)
 {
     map = cam->map();
     std::swap(draws, cam->draws());
+    // the previous draws may hold the last references to gpu resources
+    //   they are released here, on the thread with the gl context
+    //   only the capacity is handed back to the camera
+    cam->draws().clear();
     body = map->celestialBody();
     projected = map->getMapProjected();
     lodBlendingWithDithering
@@ -203,6 +280,11 @@ const RenderVariables &RenderView::variables() const
     return impl->vars;
 }
 
+const RenderStatistics &RenderView::statistics() const
+{
+    return impl->stats;
+}
+
 void RenderView::render(RenderDraws *draws)
 {
     OPTICK_EVENT();
@@ -262,6 +344,11 @@ void RenderView::renderFinalize()
     impl->atmosphereDensityTexture = nullptr;
 }
 
+bool RenderView::needsRedraw() const
+{
+    return impl->needsRedraw();
+}
+
 void RenderView::renderCompass(const double screenPosSize[3],
                    const double mapRotation[3])
 {
@@ -274,5 +361,30 @@ void RenderView::getWorldPosition(const double screenPosIn[2],
     impl->getWorldPosition(screenPosIn, worldPosOut);
 }
 
+void RenderView::pickWorldPositions(uint32 screenX, uint32 screenY,
+    uint32 width, uint32 height, PickCallback callback)
+{
+    impl->depthBuffer.pick(screenX, screenY, width, height,
+        std::move(callback));
+}
+
+void RenderView::readbackColor(ColorCallback callback)
+{
+    RenderViewImpl::ColorReadback r;
+    r.callback = std::move(callback);
+    impl->readbacksQueued.push_back(std::move(r));
+}
+
+void RenderView::pickWorldPosition(const double screenPos[2],
+    std::function<void(const double worldPos[3])> callback)
+{
+    double x = std::max(screenPos[0], 0.0);
+    double y = std::max(screenPos[1], 0.0);
+    pickWorldPositions((uint32)x, (uint32)y, 1, 1,
+        [callback](const double *worldPositions, uint32, uint32) {
+            callback(worldPositions);
+        });
+}
+
 } } // namespace vts renderer
 